@@ -0,0 +1,134 @@
+// ============================================
+// bench_alert_rules - Alert rules evaluated across a station fleet
+// ============================================
+// Fills an AlertRuleEngine with a fleet's debouncer outputs and times a
+// full evaluate() of every rule against the same rules interpreted one
+// station at a time (AlertRuleEngine::test(), a lookup and a scalar run of
+// the program per station, as an evaluator driven by each station's events
+// would do). Figures are per station x rule.
+//
+// Usage: bench_alert_rules [--counters] [--stations N] [--rules N] [--repeat N] [--filter SUBSTR]
+// ============================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "alert_rules.h"
+#include "bench_harness.h"
+
+namespace {
+
+const char* kRules[] = {
+    "spo2 stable < 90 for 10 s",
+    "bpm stable > 120 while height session active",
+    "bpm stable < 45 for 30 s",
+    "bpm < 40 or bpm > 180",
+    "not spo2 active and bpm active for 5 s",
+    "height stable > 195 or height stable < 60",
+    "spo2 stable <= 92 and bpm stable >= 100 for 1 min",
+    "not (height stable or bpm stable or spo2 stable) and height active for 20 s",
+};
+const size_t kRuleCount = sizeof(kRules) / sizeof(kRules[0]);
+
+/**
+ * Every station's channels in a random mix of stable, active and idle
+ */
+void fillFleet(AlertRuleEngine& engine, uint32_t stations) {
+    uint32_t state = 99;
+    for (uint32_t station = 0; station < stations; ++station) {
+        for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+            state = state * 1664525u + 1013904223u;
+            float value = channel == CHANNEL_HEIGHT ? static_cast<float>(50 + (state >> 24) % 160)
+                        : channel == CHANNEL_BPM ? static_cast<float>(35 + (state >> 24) % 160)
+                                                 : static_cast<float>(80 + (state >> 24) % 21);
+            DebounceEvent event;
+            event.deviceId = station;
+            event.timeMs = 1000 + (state >> 12) % 60000;
+            event.value = value;
+            event.channel = channel;
+            event.type = (state & 3) == 0 ? DEBOUNCE_EVENT_INVALID_RESET : DEBOUNCE_EVENT_ACCEPTED;
+            engine.onDebounceEvent(event);
+            if ((state & 3) >= 2) {
+                StabilityTransition transition;
+                transition.deviceId = station;
+                transition.timeMs = event.timeMs;
+                transition.value = value;
+                transition.channel = channel;
+                transition.stable = true;
+                engine.onTransition(transition);
+            }
+        }
+    }
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--counters] [--stations N] [--rules N] [--repeat N] [--filter SUBSTR]\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool useCounters = false;
+    uint32_t stations = 100000;
+    size_t rules = kRuleCount;
+    unsigned repeat = 5;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--counters") == 0) {
+            useCounters = true;
+        } else if (std::strcmp(argv[i], "--stations") == 0 && i + 1 < argc) {
+            stations = static_cast<uint32_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rules = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (stations == 0 || rules == 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // Rules beyond the built-in set repeat it
+    AlertRuleEngine engine(stations);
+    for (size_t r = 0; r < rules; ++r) {
+        engine.addRule(kRules[r % kRuleCount], kRules[r % kRuleCount]);
+    }
+    fillFleet(engine, stations);
+
+    const uint64_t pairs = static_cast<uint64_t>(stations) * rules;
+    std::printf("# %u stations x %lu rules\n", stations, static_cast<unsigned long>(rules));
+
+    BenchRunner runner(useCounters, repeat, filter);
+    runner.printHeader();
+    std::vector<AlertEvent> events;
+    events.reserve(pairs);
+    runner.run("rules/per-station", pairs, [&]() {
+        size_t holding = 0;
+        for (size_t r = 0; r < rules; ++r) {
+            for (uint32_t station = 0; station < stations; ++station) {
+                holding += engine.test(r, station) ? 1 : 0;
+            }
+        }
+        benchKeep(holding);
+    });
+    runner.run("rules/batched", pairs, [&]() {
+        events.clear();
+        benchKeep(engine.evaluate(events));
+    });
+
+    size_t firing = 0;
+    for (size_t r = 0; r < engine.getRuleCount(); ++r) {
+        firing += engine.getFiringCount(r);
+    }
+    std::printf("# %lu station x rule pairs firing\n", static_cast<unsigned long>(firing));
+    return 0;
+}
@@ -0,0 +1,165 @@
+// ============================================
+// bench_debouncer_bank - Page backing and NUMA placement of debouncer state
+// ============================================
+// Random updates across millions of ReadingDebouncer<float> channels, as
+// an aggregation server sees them. Compares a plain vector touched by the
+// main thread against ShardedDebouncerBank shards with 4 KiB, transparent
+// and explicit huge pages. With --counters the dTLB-miss column shows the
+// page-walk difference.
+//
+// Usage: bench_debouncer_bank [--counters] [--channels N] [--updates N]
+//                             [--shards N] [--repeat N] [--filter SUBSTR]
+// ============================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "bench_harness.h"
+#include "config.h"
+#include "debouncer_bank.h"
+
+namespace {
+
+// Random channel updates within one worker's slice
+void hammer(ReadingDebouncer<float>* debouncers, size_t count, uint64_t updates, uint32_t seed) {
+    uint32_t state = seed | 1u;
+    unsigned long timeMs = 0;
+    size_t untilTick = count;
+    for (uint64_t i = 0; i < updates; ++i) {
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        size_t channel = static_cast<size_t>(state % count);
+        float value = (state & 0xF00u) == 0 ? 0.0f : 72.0f + static_cast<float>(state & 3u);
+        debouncers[channel].update(value, timeMs);
+
+        // One update per channel per sample interval on average
+        if (--untilTick == 0) {
+            untilTick = count;
+            timeMs += BPM_SAMPLE_INTERVAL_MS;
+        }
+    }
+    benchKeep(debouncers[0].isStable());
+}
+
+ReadingDebouncer<float> bpmPrototype() {
+    return ReadingDebouncer<float>(BPM_TOLERANCE, BPM_STABILITY_DURATION_MS, BPM_SAMPLE_INTERVAL_MS,
+                                   BPM_MIN_VALID, BPM_MAX_VALID);
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--counters] [--channels N] [--updates N] [--shards N] [--repeat N]\n"
+                         "          [--filter SUBSTR]\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool useCounters = false;
+    size_t channels = 4000000;
+    uint64_t updates = 20000000;
+    size_t shards = 0;
+    unsigned repeat = 3;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--counters") == 0) {
+            useCounters = true;
+        } else if (std::strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            channels = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--updates") == 0 && i + 1 < argc) {
+            updates = std::strtoull(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shards = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (channels == 0 || updates == 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    NumaTopology topology = NumaTopology::detect();
+    if (shards == 0) {
+        shards = topology.getCpuCount();
+    }
+    if (shards > channels) {
+        shards = channels;
+    }
+    uint64_t updatesPerShard = updates / shards;
+    uint64_t totalUpdates = updatesPerShard * shards;
+
+    std::printf("# %lu node(s), %lu CPU(s), %lu shard(s), %lu channels (%.1f MiB of state)\n",
+                static_cast<unsigned long>(topology.getNodeCount()),
+                static_cast<unsigned long>(topology.getCpuCount()), static_cast<unsigned long>(shards),
+                static_cast<unsigned long>(channels),
+                static_cast<double>(channels * sizeof(ReadingDebouncer<float>)) / (1024.0 * 1024.0));
+    if (topology.getNodeCount() == 1) {
+        std::printf("# Single NUMA node: shards use first-touch placement without mbind\n");
+    }
+
+    BenchRunner runner(useCounters, repeat, filter);
+
+    // Baseline: one allocation, first touched by the main thread, workers unpinned
+    std::vector<ReadingDebouncer<float> > shared(channels, bpmPrototype());
+    size_t sliceSize = channels / shards;
+
+    const HugePageMode modes[] = { HUGE_PAGES_NONE, HUGE_PAGES_TRANSPARENT, HUGE_PAGES_EXPLICIT };
+    const char* const names[] = { "bank/4k", "bank/thp", "bank/hugetlb" };
+    std::vector<ShardedDebouncerBank<float>*> banks;
+    for (size_t m = 0; m < 3; ++m) {
+        DebouncerBankOptions options;
+        options.shards = shards;
+        options.hugePages = modes[m];
+        ShardedDebouncerBank<float>* bank = new ShardedDebouncerBank<float>(channels, bpmPrototype(), options);
+        if (!bank->init()) {
+            std::fprintf(stderr, "%s: could not allocate shard memory\n", names[m]);
+            delete bank;
+            bank = NULL;
+        } else if (bank->getShard(0).region.hugePages != modes[m]) {
+            std::printf("# %s: fell back to %s pages\n", names[m], hugePageModeName(bank->getShard(0).region.hugePages));
+        }
+        banks.push_back(bank);
+    }
+
+    runner.printHeader();
+
+    runner.run("vector/main-touched", totalUpdates, [&]() {
+        std::vector<std::thread> workers;
+        for (size_t s = 0; s < shards; ++s) {
+            ReadingDebouncer<float>* slice = &shared[s * sliceSize];
+            size_t count = s + 1 == shards ? channels - s * sliceSize : sliceSize;
+            workers.push_back(std::thread(hammer, slice, count, updatesPerShard, static_cast<uint32_t>(s + 1)));
+        }
+        for (size_t s = 0; s < workers.size(); ++s) {
+            workers[s].join();
+        }
+    });
+
+    for (size_t m = 0; m < banks.size(); ++m) {
+        ShardedDebouncerBank<float>* bank = banks[m];
+        if (bank == NULL) {
+            continue;
+        }
+        runner.run(names[m], totalUpdates, [&]() {
+            bank->runOnShards([updatesPerShard](DebouncerShard<float>& shard) {
+                hammer(shard.debouncers, shard.channelCount, updatesPerShard, static_cast<uint32_t>(shard.index + 1));
+            });
+        });
+    }
+
+    for (size_t m = 0; m < banks.size(); ++m) {
+        delete banks[m];
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+// ============================================
+// bench_debouncers - Microbenchmarks for the debouncer update path
+// ============================================
+// Feeds pre-generated reading streams through HeightDebouncer and
+// ReadingDebouncer and reports ns/sample, optionally with hardware
+// counters (IPC, branch and cache misses per sample).
+//
+// Usage: bench_debouncers [--counters] [--samples N] [--repeat N] [--filter SUBSTR]
+// ============================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "bench_harness.h"
+#include "config.h"
+#include "height_debouncer.h"
+#include "reading_debouncer.h"
+
+namespace {
+
+// Number of debouncers in the bank cases; large enough to spill L1/L2
+const size_t kBankSize = 4096;
+
+struct Inputs {
+    std::vector<int> heightSteady;
+    std::vector<int> heightNoisy;
+    std::vector<float> bpmSteady;
+    std::vector<float> bpmNoisy;
+    std::vector<int> spo2Steady;
+};
+
+uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+void generateInputs(size_t samples, Inputs& inputs) {
+    uint32_t state = 2024;
+    inputs.heightSteady.resize(samples);
+    inputs.heightNoisy.resize(samples);
+    inputs.bpmSteady.resize(samples);
+    inputs.bpmNoisy.resize(samples);
+    inputs.spo2Steady.resize(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        // Within tolerance of one person standing still
+        inputs.heightSteady[i] = 150 + static_cast<int>(nextRandom(state) % 3) - 1;
+        // People stepping on and off: unpredictable resets
+        inputs.heightNoisy[i] = static_cast<int>(nextRandom(state) % HEIGHT_MAX_DISTANCE_CM);
+        inputs.bpmSteady[i] = 72.0f + static_cast<float>(nextRandom(state) % 400) / 100.0f;
+        // Finger slipping: a quarter of the readings are invalid zeros
+        inputs.bpmNoisy[i] = (nextRandom(state) % 4 == 0) ? 0.0f : 60.0f + static_cast<float>(nextRandom(state) % 60);
+        inputs.spo2Steady[i] = 97 + static_cast<int>(nextRandom(state) % 2);
+    }
+}
+
+template<typename Debouncer, typename T>
+void feedSingle(Debouncer& debouncer, const std::vector<T>& values, unsigned long stepMs) {
+    unsigned long timeMs = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        timeMs += stepMs;
+        debouncer.update(values[i], timeMs);
+    }
+    benchKeep(debouncer.isStable());
+}
+
+template<typename Debouncer, typename T>
+void feedBank(std::vector<Debouncer>& bank, const std::vector<T>& values, unsigned long stepMs) {
+    // Round-robin across the bank so every update touches a cold debouncer
+    unsigned long timeMs = 0;
+    size_t slot = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        bank[slot].update(values[i], timeMs);
+        if (++slot == bank.size()) {
+            slot = 0;
+            timeMs += stepMs;
+        }
+    }
+    benchKeep(bank[0].isStable());
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--counters] [--samples N] [--repeat N] [--filter SUBSTR]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool useCounters = false;
+    size_t samples = 1000000;
+    unsigned repeat = 5;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--counters") == 0) {
+            useCounters = true;
+        } else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (samples == 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    Inputs inputs;
+    generateInputs(samples, inputs);
+
+    BenchRunner runner(useCounters, repeat, filter);
+    runner.printHeader();
+
+    const unsigned long heightStep = DEBOUNCE_SAMPLE_INTERVAL_MS;
+
+    runner.run("height/steady", samples, [&]() {
+        HeightDebouncer debouncer;
+        feedSingle(debouncer, inputs.heightSteady, heightStep);
+    });
+    runner.run("height/noisy", samples, [&]() {
+        HeightDebouncer debouncer;
+        feedSingle(debouncer, inputs.heightNoisy, heightStep);
+    });
+    runner.run("height/rate-limited", samples, [&]() {
+        // Sampling 10x faster than the interval: most updates are dropped early
+        HeightDebouncer debouncer;
+        feedSingle(debouncer, inputs.heightSteady, heightStep / 10);
+    });
+    runner.run("height/bank-4096", samples, [&]() {
+        std::vector<HeightDebouncer> bank(kBankSize);
+        feedBank(bank, inputs.heightNoisy, heightStep);
+    });
+
+    runner.run("reading<float>/bpm-steady", samples, [&]() {
+        ReadingDebouncer<float> debouncer(BPM_TOLERANCE, BPM_STABILITY_DURATION_MS, BPM_SAMPLE_INTERVAL_MS,
+                                          BPM_MIN_VALID, BPM_MAX_VALID);
+        feedSingle(debouncer, inputs.bpmSteady, BPM_SAMPLE_INTERVAL_MS);
+    });
+    runner.run("reading<float>/bpm-dropouts", samples, [&]() {
+        ReadingDebouncer<float> debouncer(BPM_TOLERANCE, BPM_STABILITY_DURATION_MS, BPM_SAMPLE_INTERVAL_MS,
+                                          BPM_MIN_VALID, BPM_MAX_VALID);
+        feedSingle(debouncer, inputs.bpmNoisy, BPM_SAMPLE_INTERVAL_MS);
+    });
+    runner.run("reading<int>/spo2-steady", samples, [&]() {
+        ReadingDebouncer<int> debouncer(SPO2_TOLERANCE, SPO2_STABILITY_DURATION_MS, SPO2_SAMPLE_INTERVAL_MS,
+                                        SPO2_MIN_VALID, SPO2_MAX_VALID);
+        feedSingle(debouncer, inputs.spo2Steady, SPO2_SAMPLE_INTERVAL_MS);
+    });
+    runner.run("reading<float>/bank-4096", samples, [&]() {
+        std::vector<ReadingDebouncer<float> > bank(kBankSize, ReadingDebouncer<float>(
+            BPM_TOLERANCE, BPM_STABILITY_DURATION_MS, BPM_SAMPLE_INTERVAL_MS, BPM_MIN_VALID, BPM_MAX_VALID));
+        feedBank(bank, inputs.bpmNoisy, BPM_SAMPLE_INTERVAL_MS);
+    });
+
+    return 0;
+}
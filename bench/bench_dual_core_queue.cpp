@@ -0,0 +1,189 @@
+// ============================================
+// bench_dual_core_queue - Oximeter frames handed between two pinned tasks
+// ============================================
+// Times the sampling -> present hand-off of the ESP32 oximeter split on
+// the host: a producer PinnedTask on core 1 pushes report frames and a
+// consumer on core 0 pops them, through SpscQueue and, for comparison,
+// through the same ring behind a std::mutex. The "same-thread" case is
+// one push and one pop without contention. Figures are per frame.
+//
+// Usage: bench_dual_core_queue [--counters] [--frames N] [--repeat N] [--filter SUBSTR]
+// ============================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include "bench_harness.h"
+#include "pinned_task.h"
+#include "spsc_queue.h"
+
+namespace {
+
+const size_t kQueueDepth = 64;
+
+/**
+ * A report as the oximeter's sampling task queues it
+ */
+struct Frame {
+    uint32_t sequence;
+    unsigned long timeMs;
+    float bpm;
+    uint8_t spo2;
+    bool bpmStable;
+    bool spo2Stable;
+};
+
+/**
+ * The SpscQueue ring with every operation under one lock
+ */
+template<typename T, size_t Capacity>
+class MutexQueue {
+public:
+    MutexQueue() : head_(0), tail_(0) {}
+
+    bool push(const T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tail_ - head_ == Capacity) {
+            return false;
+        }
+        slots_[tail_++ % Capacity] = item;
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (head_ == tail_) {
+            return false;
+        }
+        item = slots_[head_++ % Capacity];
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    size_t head_;
+    size_t tail_;
+    T slots_[Capacity];
+};
+
+template<typename Queue>
+struct Handoff {
+    Queue* queue;
+    uint32_t frames;
+    uint64_t checksum;
+
+    static void produce(void* arg) {
+        Handoff* self = static_cast<Handoff*>(arg);
+        Frame frame;
+        std::memset(&frame, 0, sizeof(frame));
+        for (uint32_t i = 0; i < self->frames; ++i) {
+            frame.sequence = i;
+            frame.timeMs = i;
+            frame.bpm = static_cast<float>(60 + (i & 63));
+            while (!self->queue->push(frame)) {
+                PinnedTask::yield();
+            }
+        }
+    }
+
+    static void consume(void* arg) {
+        Handoff* self = static_cast<Handoff*>(arg);
+        Frame frame;
+        uint64_t checksum = 0;
+        for (uint32_t received = 0; received < self->frames;) {
+            if (self->queue->pop(frame)) {
+                checksum += frame.sequence;
+                received++;
+            } else {
+                PinnedTask::yield();
+            }
+        }
+        self->checksum = checksum;
+    }
+};
+
+/**
+ * Pass frames from a task on core 1 to one on core 0
+ */
+template<typename Queue>
+uint64_t runHandoff(Queue& queue, uint32_t frames) {
+    Handoff<Queue> handoff;
+    handoff.queue = &queue;
+    handoff.frames = frames;
+    handoff.checksum = 0;
+    PinnedTask consumer;
+    PinnedTask producer;
+    consumer.start("present", Handoff<Queue>::consume, &handoff, 0);
+    producer.start("sampling", Handoff<Queue>::produce, &handoff, 1);
+    producer.join();
+    consumer.join();
+    return handoff.checksum;
+}
+
+void idle(void*) {
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--counters] [--frames N] [--repeat N] [--filter SUBSTR]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool useCounters = false;
+    uint32_t frames = 2000000;
+    unsigned repeat = 5;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--counters") == 0) {
+            useCounters = true;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = static_cast<uint32_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (frames == 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    PinnedTask probe;
+    probe.start("probe", idle, NULL, 1);
+    probe.join();
+    std::printf("# %u frames of %lu bytes, queue depth %lu, tasks %s\n", frames,
+                static_cast<unsigned long>(sizeof(Frame)), static_cast<unsigned long>(kQueueDepth),
+                probe.isPinned() ? "pinned" : "unpinned");
+
+    BenchRunner runner(useCounters, repeat, filter);
+    runner.printHeader();
+
+    static SpscQueue<Frame, kQueueDepth> spscQueue;
+    static MutexQueue<Frame, kQueueDepth> mutexQueue;
+    runner.run("handoff/spsc", frames, [&]() {
+        benchKeep(runHandoff(spscQueue, frames));
+    });
+    runner.run("handoff/mutex", frames, [&]() {
+        benchKeep(runHandoff(mutexQueue, frames));
+    });
+    runner.run("same-thread/spsc", frames, [&]() {
+        Frame frame;
+        std::memset(&frame, 0, sizeof(frame));
+        uint64_t checksum = 0;
+        for (uint32_t i = 0; i < frames; ++i) {
+            frame.sequence = i;
+            spscQueue.push(frame);
+            spscQueue.pop(frame);
+            checksum += frame.sequence;
+        }
+        benchKeep(checksum);
+    });
+    return 0;
+}
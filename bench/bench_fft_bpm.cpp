@@ -0,0 +1,114 @@
+// ============================================
+// bench_fft_bpm - Cost of one FftBpmEstimator window
+// ============================================
+// Times the ESP32 (256-point) and Uno (64-point) estimators: the bare
+// FixedFft transform, and a full window (one hop of raw samples through
+// addSample(), then windowing, the transform and the peak search). Figures
+// are per window; with --counters cyc/sample is cycles per window.
+//
+// Usage: bench_fft_bpm [--counters] [--windows N] [--repeat N] [--filter SUBSTR]
+// ============================================
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "bench_harness.h"
+#include "config.h"
+#include "fft_bpm_estimator.h"
+
+namespace {
+
+/**
+ * Raw 100 Hz IR of a 75 BPM pulse with noise
+ */
+std::vector<uint16_t> makePulse(size_t samples) {
+    std::vector<uint16_t> out(samples);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < samples; ++i) {
+        double phase = 2.0 * M_PI * 1.25 * static_cast<double>(i) / 100.0;
+        seed = seed * 1664525u + 1013904223u;
+        double noise = static_cast<double>(seed >> 28) - 8.0;
+        out[i] = static_cast<uint16_t>(50000.0 - 150.0 * (std::sin(phase) + 0.4 * std::sin(2.0 * phase + 0.8)) + noise);
+    }
+    return out;
+}
+
+template<uint8_t LOG2_SIZE>
+void benchVariant(BenchRunner& runner, const char* fftName, const char* windowName, uint8_t decimation,
+                  unsigned long windows, const std::vector<uint16_t>& input) {
+    typedef FftBpmEstimator<LOG2_SIZE> Estimator;
+    const uint16_t hop = static_cast<uint16_t>(FFT_BPM_HOP_MS * FFT_BPM_SAMPLE_RATE_HZ / decimation / 1000);
+    const size_t hopSamples = static_cast<size_t>(hop) * decimation;
+
+    FixedFft<LOG2_SIZE> fft;
+    std::vector<int16_t> re(FixedFft<LOG2_SIZE>::SIZE);
+    std::vector<int16_t> im(FixedFft<LOG2_SIZE>::SIZE);
+    runner.run(fftName, windows, [&]() {
+        for (unsigned long w = 0; w < windows; ++w) {
+            for (uint16_t i = 0; i < FixedFft<LOG2_SIZE>::SIZE; ++i) {
+                re[i] = static_cast<int16_t>(input[w % (input.size() - FixedFft<LOG2_SIZE>::SIZE) + i] - 50000);
+                im[i] = 0;
+            }
+            fft.transform(&re[0], &im[0]);
+            benchKeep(re[1]);
+        }
+    });
+
+    Estimator estimator(FFT_BPM_SAMPLE_RATE_HZ, decimation, hop, BPM_MIN_VALID, BPM_MAX_VALID,
+                        FFT_BPM_MIN_AMPLITUDE, FFT_BPM_MIN_CONFIDENCE_PCT, FFT_BPM_MAX_MISSES);
+    size_t next = 0;
+    while (estimator.getWindows() == 0) {
+        estimator.addSample(input[next++ % input.size()]);
+    }
+    runner.run(windowName, windows, [&]() {
+        for (unsigned long w = 0; w < windows; ++w) {
+            for (size_t i = 0; i < hopSamples; ++i) {
+                estimator.addSample(input[next++ % input.size()]);
+            }
+        }
+        benchKeep(estimator.getBpm());
+    });
+    std::printf("#   %s: %.1f BPM, %lu bytes\n", windowName, estimator.getBpm(),
+                static_cast<unsigned long>(sizeof(estimator)));
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--counters] [--windows N] [--repeat N] [--filter SUBSTR]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool useCounters = false;
+    unsigned long windows = 2000;
+    unsigned repeat = 5;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--counters") == 0) {
+            useCounters = true;
+        } else if (std::strcmp(argv[i], "--windows") == 0 && i + 1 < argc) {
+            windows = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (windows == 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    std::vector<uint16_t> input = makePulse(60000);
+    BenchRunner runner(useCounters, repeat, filter);
+    runner.printHeader();
+    benchVariant<8>(runner, "fft/256", "window/esp32-256", 4, windows, input);
+    benchVariant<6>(runner, "fft/64", "window/uno-64", 10, windows, input);
+    return 0;
+}
@@ -0,0 +1,144 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include "perf_counters.h"
+
+/**
+ * Keep a value alive so the optimizer cannot drop the work producing it
+ */
+template<typename T>
+inline void benchKeep(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    volatile T sink = value;
+    (void)sink;
+#endif
+}
+
+/**
+ * Result of one benchmark case (best of its repetitions)
+ */
+struct BenchResult {
+    double nsPerSample;
+    uint64_t samples;
+    PerfSample counters;
+};
+
+/**
+ * BenchRunner - Times cases and optionally wraps them in hardware counters
+ *
+ * Each case runs `repetitions` times; the fastest run is reported along
+ * with the counters from that run. Counters are opened once per runner and
+ * the table degrades to "n/a" columns when the PMU is unavailable.
+ */
+class BenchRunner {
+public:
+    BenchRunner(bool useCounters, unsigned repetitions, const char* filter)
+        : repetitions_(repetitions ? repetitions : 1)
+        , filter_(filter)
+        , useCounters_(useCounters)
+        , countersOpen_(false)
+    {
+        if (useCounters_) {
+            countersOpen_ = counters_.open();
+        }
+    }
+
+    /**
+     * Print the table header, noting when counters were requested but unavailable
+     */
+    void printHeader() const {
+        if (useCounters_ && !countersOpen_) {
+            std::printf("# Hardware counters unavailable (no PMU access); reporting timings only\n");
+        }
+        std::printf("%-32s %12s", "case", "ns/sample");
+        if (useCounters_) {
+            std::printf(" %8s %14s %14s %16s %12s", "IPC", "br-miss/sample", "$-miss/sample",
+                        "dTLB-miss/sample", "cyc/sample");
+        }
+        std::printf("\n");
+    }
+
+    /**
+     * Run a case
+     * @param name - printed case name, also matched against the filter
+     * @param samples - samples processed by one call of fn, for per-sample figures
+     * @param fn - callable performing the work
+     */
+    template<typename Fn>
+    bool run(const char* name, uint64_t samples, Fn fn) {
+        if (filter_ != NULL && std::strstr(name, filter_) == NULL) {
+            return false;
+        }
+
+        BenchResult best;
+        best.nsPerSample = 0.0;
+        best.samples = samples;
+        for (unsigned r = 0; r < repetitions_; ++r) {
+            if (countersOpen_) {
+                counters_.start();
+            }
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            fn();
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+            PerfSample sample;
+            if (countersOpen_) {
+                sample = counters_.stop();
+            } else {
+                std::memset(&sample, 0, sizeof(sample));
+            }
+
+            double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            double perSample = samples ? ns / static_cast<double>(samples) : ns;
+            if (r == 0 || perSample < best.nsPerSample) {
+                best.nsPerSample = perSample;
+                best.counters = sample;
+            }
+        }
+        print(name, best);
+        return true;
+    }
+
+    bool hasCounters() const { return countersOpen_; }
+
+private:
+    unsigned repetitions_;
+    const char* filter_;
+    bool useCounters_;
+    bool countersOpen_;
+    PerfCounters counters_;
+
+    void print(const char* name, const BenchResult& result) const {
+        std::printf("%-32s %12.2f", name, result.nsPerSample);
+        if (useCounters_) {
+            const PerfSample& c = result.counters;
+            double n = result.samples ? static_cast<double>(result.samples) : 1.0;
+            printRatio(c.valid[PERF_EVENT_INSTRUCTIONS] && c.valid[PERF_EVENT_CYCLES] && c.values[PERF_EVENT_CYCLES],
+                       static_cast<double>(c.values[PERF_EVENT_INSTRUCTIONS]) /
+                           static_cast<double>(c.values[PERF_EVENT_CYCLES] ? c.values[PERF_EVENT_CYCLES] : 1), 8);
+            printRatio(c.valid[PERF_EVENT_BRANCH_MISSES],
+                       static_cast<double>(c.values[PERF_EVENT_BRANCH_MISSES]) / n, 14);
+            printRatio(c.valid[PERF_EVENT_CACHE_MISSES],
+                       static_cast<double>(c.values[PERF_EVENT_CACHE_MISSES]) / n, 14);
+            printRatio(c.valid[PERF_EVENT_DTLB_MISSES],
+                       static_cast<double>(c.values[PERF_EVENT_DTLB_MISSES]) / n, 16);
+            printRatio(c.valid[PERF_EVENT_CYCLES], static_cast<double>(c.values[PERF_EVENT_CYCLES]) / n, 12);
+        }
+        std::printf("\n");
+    }
+
+    static void printRatio(bool valid, double value, int width) {
+        if (valid) {
+            std::printf(" %*.3f", width, value);
+        } else {
+            std::printf(" %*s", width, "n/a");
+        }
+    }
+};
+
+#endif // BENCH_HARNESS_H
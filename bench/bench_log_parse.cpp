@@ -0,0 +1,152 @@
+// ============================================
+// bench_log_parse - Serial log parsing throughput
+// ============================================
+// Parses a synthetic archive of both sketches' log lines with the scalar
+// TraceParser (per-sample callback) and the vectorized LineTokenizer
+// (columns), fed in 64 KiB blocks as TraceReader delivers them, and
+// reports ns/line. A final case adds the batch debounce of each block's
+// columns through the C ABI, for comparison with the parse cost.
+//
+// Usage: bench_log_parse [--counters] [--lines N] [--repeat N] [--filter SUBSTR]
+// ============================================
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "apptech_debounce.h"
+#include "bench_harness.h"
+#include "line_tokenizer.h"
+#include "trace_parser.h"
+
+namespace {
+
+const size_t kBlockSize = 64 * 1024;
+
+uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+std::string generateLog(size_t lines) {
+    std::string log;
+    log.reserve(lines * 40);
+    uint32_t state = 2024;
+    unsigned long timeMs = 0;
+    char line[96];
+    for (size_t i = 0; i < lines; ++i) {
+        if (nextRandom(state) & 1) {
+            std::snprintf(line, sizeof(line), "Raw: %u cm | Stable: YES (%u cm)\r\n", 140 + nextRandom(state) % 60,
+                          150u);
+        } else {
+            timeMs += 100;
+            std::snprintf(line, sizeof(line), "[%lums] RAW - BPM:%u.%02u SpO2:%u%%\r\n", timeMs,
+                          60 + nextRandom(state) % 40, nextRandom(state) % 100, 90 + nextRandom(state) % 10);
+        }
+        log += line;
+    }
+    return log;
+}
+
+class CountingSink : public TraceSampleSink {
+public:
+    CountingSink() : count(0), sum(0.0f) {}
+    virtual void onSample(const TraceSample& sample) {
+        count++;
+        sum += sample.value;
+    }
+    size_t count;
+    float sum;
+};
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--counters] [--lines N] [--repeat N] [--filter SUBSTR]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool useCounters = false;
+    size_t lines = 1000000;
+    unsigned repeat = 5;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--counters") == 0) {
+            useCounters = true;
+        } else if (std::strcmp(argv[i], "--lines") == 0 && i + 1 < argc) {
+            lines = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (lines == 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    const std::string log = generateLog(lines);
+    std::printf("# %lu lines, %.1f bytes/line, scanner %s\n", static_cast<unsigned long>(lines),
+                static_cast<double>(log.size()) / lines, LineTokenizer::getScanBackend());
+
+    BenchRunner runner(useCounters, repeat, filter);
+    runner.printHeader();
+
+    runner.run("parse/trace-parser", lines, [&]() {
+        CountingSink sink;
+        TraceParser parser(&sink, 1);
+        for (size_t offset = 0; offset < log.size(); offset += kBlockSize) {
+            parser.feed(log.data() + offset, std::min(kBlockSize, log.size() - offset));
+        }
+        parser.finish();
+        benchKeep(sink.sum);
+    });
+
+    // Columns are consumed block by block, as a replay would, so they stay in cache
+    LogColumns columns;
+    runner.run("parse/line-tokenizer", lines, [&]() {
+        LineTokenizer tokenizer;
+        size_t samples = 0;
+        for (size_t offset = 0; offset < log.size(); offset += kBlockSize) {
+            columns.clear();
+            tokenizer.feed(log.data() + offset, std::min(kBlockSize, log.size() - offset), columns);
+            samples += columns.size(CHANNEL_HEIGHT) + columns.size(CHANNEL_BPM) + columns.size(CHANNEL_SPO2);
+        }
+        tokenizer.finish(columns);
+        benchKeep(samples);
+    });
+
+    runner.run("replay/line-tokenizer+c-abi", lines, [&]() {
+        apptech_debouncer* debouncers[SAMPLE_CHANNEL_COUNT];
+        for (uint32_t kind = 0; kind < SAMPLE_CHANNEL_COUNT; ++kind) {
+            apptech_debounce_config config;
+            apptech_debounce_config_default(kind, &config);
+            apptech_debouncer_create(&config, &debouncers[kind]);
+        }
+        LineTokenizer tokenizer;
+        size_t transitions = 0;
+        for (size_t offset = 0; offset < log.size(); offset += kBlockSize) {
+            columns.clear();
+            tokenizer.feed(log.data() + offset, std::min(kBlockSize, log.size() - offset), columns);
+            for (uint8_t kind = 0; kind < SAMPLE_CHANNEL_COUNT; ++kind) {
+                size_t count = 0;
+                apptech_debouncer_update(debouncers[kind], columns.values[kind].data(), columns.timesMs[kind].data(),
+                                         columns.size(kind), NULL, 0, &count, NULL);
+                transitions += count;
+            }
+        }
+        for (uint32_t kind = 0; kind < SAMPLE_CHANNEL_COUNT; ++kind) {
+            apptech_debouncer_destroy(debouncers[kind]);
+        }
+        benchKeep(transitions);
+    });
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+// ============================================
+// bench_replication - Cost of hot-standby replication on the update path
+// ============================================
+// Feeds a StationPartition a batch interval's worth of samples per station
+// at the sketches' cadence (one per channel every DEBOUNCE_SAMPLE_INTERVAL_MS),
+// with and without a ReplicationPrimary publishing to a standby process
+// after every interval, and reports ns/sample along with the bytes sent
+// per station. The overhead is taken from the owner thread's CPU time:
+// the sender thread and the standby run beside it, and on a host with
+// fewer than three cores the wall-clock figures include their work too.
+//
+// Usage: bench_replication [--counters] [--stations N] [--intervals N] [--repeat N] [--filter SUBSTR] [--check]
+//   --check  exit 1 if replication costs the update path 5% or more
+// ============================================
+
+#include <csignal>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "bench_harness.h"
+#include "config.h"
+#include "station_replication.h"
+
+namespace {
+
+const double kMaxOverhead = 0.05;
+const unsigned kTicksPerInterval = REPLICATION_BATCH_INTERVAL_MS / DEBOUNCE_SAMPLE_INTERVAL_MS;
+
+TraceReplayer makePrototype() {
+    return TraceReplayer(HeightDebouncer(2, 1000, 100), ReadingDebouncer<float>(3.0f, 1000, 100, 30.0f, 220.0f),
+                         ReadingDebouncer<int>(1, 1000, 100, 70, 100), NULL);
+}
+
+double threadCpuNs() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) * 1e9 + static_cast<double>(now.tv_nsec);
+}
+
+/**
+ * One tick's samples: a reading per channel per station, some noisy
+ */
+void tickSamples(uint32_t stations, unsigned long timeMs, uint32_t& state, std::vector<TraceSample>& out) {
+    out.clear();
+    for (uint32_t station = 0; station < stations; ++station) {
+        state = state * 1664525u + 1013904223u;
+        TraceSample sample;
+        sample.deviceId = station;
+        sample.timeMs = timeMs;
+        sample.channel = CHANNEL_HEIGHT;
+        sample.value = static_cast<float>(150 + station % 40 + (state >> 28));
+        out.push_back(sample);
+        sample.channel = CHANNEL_BPM;
+        sample.value = 60.0f + static_cast<float>(station % 30) + static_cast<float>((state >> 20) & 7) * 0.5f;
+        out.push_back(sample);
+        sample.channel = CHANNEL_SPO2;
+        sample.value = static_cast<float>(95 + ((state >> 16) & 3));
+        out.push_back(sample);
+    }
+}
+
+/**
+ * Child process mirroring into its own partition until killed
+ */
+pid_t startStandby(const std::string& path) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        StationPartition replica(1, makePrototype());
+        ReplicationStandby standby(path);
+        // A clean shutdown is not a failure, so this only returns on error
+        _exit(standby.listen() && standby.runUntilFailover(replica, 60000) ? 0 : 1);
+    }
+    return pid;
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr,
+                 "Usage: %s [--counters] [--stations N] [--intervals N] [--repeat N] [--filter SUBSTR] [--check]\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool useCounters = false;
+    uint32_t stations = 10000;
+    unsigned intervals = 20;
+    unsigned repeat = 5;
+    const char* filter = NULL;
+    bool check = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--counters") == 0) {
+            useCounters = true;
+        } else if (std::strcmp(argv[i], "--stations") == 0 && i + 1 < argc) {
+            stations = static_cast<uint32_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--intervals") == 0 && i + 1 < argc) {
+            intervals = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (stations == 0 || intervals == 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    char pattern[] = "/tmp/bench-replication-XXXXXX";
+    if (mkdtemp(pattern) == NULL) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string directory(pattern);
+    const std::string standbyPath = ReplicationStandby::socketPath(directory, 1);
+    pid_t standby = startStandby(standbyPath);
+    if (standby < 0) {
+        std::perror("fork");
+        return 1;
+    }
+
+    std::printf("# %u stations, %u intervals of %d ms (%u samples per station), %ld online cores\n", stations,
+                intervals, REPLICATION_BATCH_INTERVAL_MS, kTicksPerInterval * SAMPLE_CHANNEL_COUNT,
+                sysconf(_SC_NPROCESSORS_ONLN));
+
+    const std::vector<uint32_t> members(1, 1);
+    std::vector<StationCheckpoint> handoff;
+    StationPartition plain(1, makePrototype());
+    StationPartition replicated(1, makePrototype());
+    plain.setMembers(1, std::vector<uint32_t>(), members, handoff);
+    replicated.setMembers(1, std::vector<uint32_t>(), members, handoff);
+    ReplicationPrimary primary(replicated, standbyPath);
+    primary.start();
+
+    const uint64_t samplesPerRun =
+        static_cast<uint64_t>(stations) * SAMPLE_CHANNEL_COUNT * kTicksPerInterval * intervals;
+    std::vector<TraceSample> samples;
+    samples.reserve(static_cast<size_t>(stations) * SAMPLE_CHANNEL_COUNT);
+
+    // Intervals of updates, each followed by a publish when replicating;
+    // sample generation is in both cases so they differ only in replication.
+    // Keeps the least owner-thread CPU time per case.
+    unsigned long timeMs[2] = { 0, 0 };
+    double bestCpuNs[2] = { 0.0, 0.0 };
+    auto runIntervals = [&](int index, StationPartition& partition, ReplicationPrimary* replication) {
+        double startNs = threadCpuNs();
+        uint32_t state = 7;
+        uint32_t owner = 0;
+        for (unsigned interval = 0; interval < intervals; ++interval) {
+            for (unsigned tick = 0; tick < kTicksPerInterval; ++tick) {
+                timeMs[index] += DEBOUNCE_SAMPLE_INTERVAL_MS;
+                tickSamples(stations, timeMs[index], state, samples);
+                for (size_t i = 0; i < samples.size(); ++i) {
+                    partition.route(samples[i], &owner);
+                }
+            }
+            if (replication != NULL) {
+                replication->publish();
+            }
+        }
+        benchKeep(partition.getSamplesApplied());
+        double cpuNs = threadCpuNs() - startNs;
+        if (bestCpuNs[index] == 0.0 || cpuNs < bestCpuNs[index]) {
+            bestCpuNs[index] = cpuNs;
+        }
+    };
+
+    BenchRunner runner(useCounters, repeat, filter);
+    runner.printHeader();
+    bool ranPlain = runner.run("update/no-replication", samplesPerRun, [&]() { runIntervals(0, plain, NULL); });
+    bool ranReplicated = runner.run("update/replicated", samplesPerRun, [&]() {
+        runIntervals(1, replicated, &primary);
+    });
+
+    // The overhead compares CPU minima; alternate the cases as well so drift
+    // in the machine's load does not land on one of them
+    if (ranPlain && ranReplicated) {
+        for (unsigned r = 0; r < repeat; ++r) {
+            runIntervals(0, plain, NULL);
+            runIntervals(1, replicated, &primary);
+        }
+    }
+
+    primary.stop();
+    ReplicationStats stats = primary.getStats();
+    kill(standby, SIGKILL);
+    waitpid(standby, NULL, 0);
+    unlink(standbyPath.c_str());
+    rmdir(directory.c_str());
+
+    std::printf("# sent %llu batches (%llu dropped), %.1f B/station on the wire vs %.1f raw\n",
+                static_cast<unsigned long long>(stats.batches), static_cast<unsigned long long>(stats.droppedBatches),
+                stats.stations ? static_cast<double>(stats.sentBytes) / static_cast<double>(stats.stations) : 0.0,
+                stats.stations ? static_cast<double>(stats.rawBytes) / static_cast<double>(stats.stations) : 0.0);
+
+    if (!ranPlain || !ranReplicated) {
+        return 0;
+    }
+    double overhead = bestCpuNs[1] / bestCpuNs[0] - 1.0;
+    std::printf("# owner thread: %.2f vs %.2f ns/sample, replication overhead on the update path %.1f%%\n",
+                bestCpuNs[0] / static_cast<double>(samplesPerRun), bestCpuNs[1] / static_cast<double>(samplesPerRun),
+                overhead * 100.0);
+    if (check && overhead >= kMaxOverhead) {
+        std::printf("# FAIL: above %.0f%%\n", kMaxOverhead * 100.0);
+        return 1;
+    }
+    return 0;
+}
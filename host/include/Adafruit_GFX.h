@@ -0,0 +1,53 @@
+#ifndef HOST_ADAFRUIT_GFX_H
+#define HOST_ADAFRUIT_GFX_H
+
+// ============================================
+// Host HAL - Adafruit_GFX
+// ============================================
+// Cursor and text state only: the host model does not rasterize glyphs,
+// since drawing never touches the bus (only the driver's display() does).
+// ============================================
+
+#include "Arduino.h"
+
+class Adafruit_GFX : public Print {
+public:
+    Adafruit_GFX(int16_t width, int16_t height)
+        : width_(width)
+        , height_(height)
+        , cursorX_(0)
+        , cursorY_(0)
+        , textSize_(1)
+        , textColor_(1)
+    {
+    }
+
+    void setCursor(int16_t x, int16_t y) { cursorX_ = x; cursorY_ = y; }
+    void setTextSize(uint8_t size) { textSize_ = size > 0 ? size : 1; }
+    void setTextColor(uint16_t color) { textColor_ = color; }
+    int16_t getCursorX() const { return cursorX_; }
+    int16_t getCursorY() const { return cursorY_; }
+    int16_t width() const { return width_; }
+    int16_t height() const { return height_; }
+
+    virtual size_t write(uint8_t c) {
+        if (c == '\n') {
+            cursorX_ = 0;
+            cursorY_ = static_cast<int16_t>(cursorY_ + 8 * textSize_);
+        } else if (c != '\r') {
+            cursorX_ = static_cast<int16_t>(cursorX_ + 6 * textSize_);
+        }
+        return 1;
+    }
+    using Print::write;
+
+protected:
+    int16_t width_;
+    int16_t height_;
+    int16_t cursorX_;
+    int16_t cursorY_;
+    uint8_t textSize_;
+    uint16_t textColor_;
+};
+
+#endif // HOST_ADAFRUIT_GFX_H
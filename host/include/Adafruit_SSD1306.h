@@ -0,0 +1,44 @@
+#ifndef HOST_ADAFRUIT_SSD1306_H
+#define HOST_ADAFRUIT_SSD1306_H
+
+// ============================================
+// Host HAL - Adafruit_SSD1306
+// ============================================
+// Issues the library's I2C traffic: the init command list in begin(), and
+// in display() the page/column address commands followed by the whole
+// framebuffer in Wire-buffer-sized data transactions. clearDisplay() and
+// drawing only touch the local framebuffer.
+// ============================================
+
+#include <vector>
+#include "Adafruit_GFX.h"
+#include "Wire.h"
+
+#define SSD1306_EXTERNALVCC 0x01
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define BLACK SSD1306_BLACK
+#define WHITE SSD1306_WHITE
+
+class Adafruit_SSD1306 : public Adafruit_GFX {
+public:
+    Adafruit_SSD1306(uint8_t width, uint8_t height, TwoWire* wire, int8_t resetPin);
+
+    bool begin(uint8_t vccState = SSD1306_SWITCHCAPVCC, uint8_t address = 0, bool reset = true,
+               bool periphBegin = true);
+    void clearDisplay();
+    void display();
+    void drawPixel(int16_t x, int16_t y, uint16_t color);
+
+private:
+    TwoWire* wire_;
+    uint8_t address_;
+    uint8_t vccState_;
+    std::vector<uint8_t> buffer_;
+
+    void command1(uint8_t command);
+    void commandList(const uint8_t* commands, size_t count);
+};
+
+#endif // HOST_ADAFRUIT_SSD1306_H
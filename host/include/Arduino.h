@@ -0,0 +1,135 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// ============================================
+// Host HAL - Arduino core
+// ============================================
+// Just enough of the Arduino core to build the instrument sketches on a
+// host: a virtual clock (millis/micros advance only through delay(), bus
+// transfer time and GPIO access, so runs are deterministic), GPIO routed
+// to device models, Print and Serial.
+// ============================================
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "i2c_bus.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+/**
+ * HostPinDevice - A part wired to GPIO pins (bit-banged protocols)
+ */
+class HostPinDevice {
+public:
+    virtual ~HostPinDevice() {}
+    virtual void onPinWrite(uint8_t pin, uint8_t level) = 0;
+    virtual int onPinRead(uint8_t pin) = 0;
+};
+
+/**
+ * Route digitalWrite/digitalRead of a pin to a device (NULL: unconnected,
+ * reads LOW)
+ */
+void hostAttachPin(uint8_t pin, HostPinDevice* device);
+
+/**
+ * Virtual time charged per digitalWrite/digitalRead (0 by default; about
+ * 4 us on an Uno), so bit-banged protocols show up in loop timing
+ */
+void hostSetGpioCostUs(unsigned int us);
+
+/**
+ * HostClock - The virtual time behind millis()/micros()
+ */
+class HostClock : public I2cBusClock {
+public:
+    HostClock() : nowUs_(0) {}
+
+    virtual unsigned long long nowUs() const { return nowUs_; }
+    virtual void advanceUs(unsigned long long us) { nowUs_ += us; }
+    void reset() { nowUs_ = 0; }
+
+private:
+    unsigned long long nowUs_;
+};
+
+HostClock& hostClock();
+
+/**
+ * Print - Arduino's formatting base class
+ */
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* text) { return text != NULL ? write(reinterpret_cast<const uint8_t*>(text), std::strlen(text)) : 0; }
+
+    size_t print(const char* text) { return write(text); }
+    size_t print(char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(unsigned char value, int base = DEC) { return print(static_cast<unsigned long>(value), base); }
+    size_t print(int value, int base = DEC) { return print(static_cast<long>(value), base); }
+    size_t print(unsigned int value, int base = DEC) { return print(static_cast<unsigned long>(value), base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template<typename T>
+    size_t println(T value) { size_t n = print(value); return n + println(); }
+    template<typename T>
+    size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+/**
+ * HardwareSerial - Serial port writing to a host stream (NULL: discard);
+ * bytes the host sends are queued with feed()
+ */
+class HardwareSerial : public Print {
+public:
+    HardwareSerial() : out_(stdout), inputPos_(0) {}
+
+    void begin(unsigned long baud) { (void)baud; }
+    void setOutput(FILE* out) { out_ = out; }
+    virtual size_t write(uint8_t c);
+    using Print::write;
+
+    int available() const { return static_cast<int>(input_.size() - inputPos_); }
+    int read();
+    void feed(const char* text) { input_.append(text); }
+
+private:
+    FILE* out_;
+    std::string input_;
+    size_t inputPos_;
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,55 @@
+#ifndef HOST_LIQUID_CRYSTAL_I2C_H
+#define HOST_LIQUID_CRYSTAL_I2C_H
+
+// ============================================
+// Host HAL - LiquidCrystal_I2C
+// ============================================
+// HD44780 on a PCF8574 backpack, issuing the same expander writes as the
+// LiquidCrystal_I2C library: every command or character is two nibbles,
+// each one write plus an enable pulse (three 1-byte transactions), so
+// clear() and setCursor() cost real bus traffic.
+// ============================================
+
+#include "Wire.h"
+
+class LiquidCrystal_I2C : public Print {
+public:
+    LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows);
+
+    void init();
+    void begin(uint8_t cols, uint8_t rows);
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void display();
+    void noDisplay();
+    void backlight();
+    void noBacklight();
+
+    virtual size_t write(uint8_t value);
+    using Print::write;
+
+    /**
+     * Text currently shown on a row (host-side shadow of the display RAM)
+     */
+    const char* getRow(uint8_t row) const { return row < 4 ? rows_[row] : ""; }
+
+private:
+    uint8_t address_;
+    uint8_t cols_;
+    uint8_t rowCount_;
+    uint8_t backlight_;
+    uint8_t displayControl_;
+    uint8_t col_;
+    uint8_t row_;
+    char rows_[4][41];
+
+    void command(uint8_t value);
+    void send(uint8_t value, uint8_t mode);
+    void write4bits(uint8_t value);
+    void expanderWrite(uint8_t data);
+    void pulseEnable(uint8_t data);
+    void clearShadow();
+};
+
+#endif // HOST_LIQUID_CRYSTAL_I2C_H
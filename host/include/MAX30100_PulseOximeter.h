@@ -0,0 +1,74 @@
+#ifndef HOST_MAX30100_PULSE_OXIMETER_H
+#define HOST_MAX30100_PULSE_OXIMETER_H
+
+// ============================================
+// Host HAL - MAX30100_PulseOximeter
+// ============================================
+// Bus-accurate model of the MAX30100 library: begin() checks the part ID
+// and configures mode, pulse width, sample rate and LED currents with the
+// library's read-modify-write accesses; update() reads the FIFO pointers
+// and bursts out pending samples. The beat detector and SpO2 filters are
+// not modeled: host sensor models (SimulatedMax30100, or a replayed
+// capture of one) encode heart rate and SpO2 directly in the IR and red
+// samples as value * 100.
+// ============================================
+
+#include "Wire.h"
+
+#define MAX30100_I2C_ADDRESS 0x57
+#define MAX30100_REG_FIFO_WRITE_POINTER 0x02
+#define MAX30100_REG_FIFO_OVERFLOW_COUNTER 0x03
+#define MAX30100_REG_FIFO_READ_POINTER 0x04
+#define MAX30100_REG_FIFO_DATA 0x05
+#define MAX30100_REG_MODE_CONFIGURATION 0x06
+#define MAX30100_REG_SPO2_CONFIGURATION 0x07
+#define MAX30100_REG_LED_CONFIGURATION 0x09
+#define MAX30100_REG_PART_ID 0xFF
+#define MAX30100_EXPECTED_PART_ID 0x11
+#define MAX30100_FIFO_DEPTH 0x10
+#define MAX30100_SAMPLE_SCALE 100
+
+typedef enum LEDCurrent {
+    MAX30100_LED_CURR_0MA = 0x00,
+    MAX30100_LED_CURR_4_4MA = 0x01,
+    MAX30100_LED_CURR_7_6MA = 0x02,
+    MAX30100_LED_CURR_11MA = 0x03,
+    MAX30100_LED_CURR_14_2MA = 0x04,
+    MAX30100_LED_CURR_17_4MA = 0x05,
+    MAX30100_LED_CURR_20_8MA = 0x06,
+    MAX30100_LED_CURR_24MA = 0x07,
+    MAX30100_LED_CURR_27_1MA = 0x08,
+    MAX30100_LED_CURR_30_6MA = 0x09,
+    MAX30100_LED_CURR_33_8MA = 0x0A,
+    MAX30100_LED_CURR_37MA = 0x0B,
+    MAX30100_LED_CURR_40_2MA = 0x0C,
+    MAX30100_LED_CURR_43_6MA = 0x0D,
+    MAX30100_LED_CURR_46_8MA = 0x0E,
+    MAX30100_LED_CURR_50MA = 0x0F
+} LEDCurrent;
+
+class PulseOximeter {
+public:
+    PulseOximeter();
+
+    bool begin();
+    void update();
+    float getHeartRate() const { return heartRate_; }
+    uint8_t getSpO2() const { return spo2_; }
+    void setIRLedCurrent(LEDCurrent current);
+    void setOnBeatDetectedCallback(void (*callback)()) { onBeat_ = callback; }
+
+private:
+    float heartRate_;
+    uint8_t spo2_;
+    uint8_t redCurrent_;
+    void (*onBeat_)();
+    unsigned long long nextBeatUs_;
+
+    uint8_t readRegister(uint8_t reg);
+    void writeRegister(uint8_t reg, uint8_t value);
+    size_t burstRead(uint8_t reg, uint8_t* buffer, uint8_t length);
+    void readFifoData();
+};
+
+#endif // HOST_MAX30100_PULSE_OXIMETER_H
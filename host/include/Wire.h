@@ -0,0 +1,57 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+// ============================================
+// Host HAL - Wire
+// ============================================
+// TwoWire on top of the host I2cBus: every transaction reaches the
+// attached device models and, when recording, the bus trace. Buffer size
+// and status codes match the AVR core.
+// ============================================
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+/**
+ * The bus behind the global Wire object (attach devices and recorders here)
+ */
+I2cBus& hostI2cBus();
+
+class TwoWire : public Print {
+public:
+    explicit TwoWire(I2cBus& bus);
+
+    void begin() {}
+    void begin(int sda, int scl) { (void)sda; (void)scl; }
+    void setClock(unsigned long hz) { bus_.setFrequencyHz(hz); }
+
+    void beginTransmission(uint8_t address);
+    void beginTransmission(int address) { beginTransmission(static_cast<uint8_t>(address)); }
+    uint8_t endTransmission(bool sendStop = true);
+
+    virtual size_t write(uint8_t data);
+    virtual size_t write(const uint8_t* data, size_t length);
+    using Print::write;
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+    uint8_t requestFrom(int address, int quantity) {
+        return requestFrom(static_cast<uint8_t>(address), static_cast<uint8_t>(quantity));
+    }
+    int available() const { return static_cast<int>(rxLength_ - rxIndex_); }
+    int read();
+
+private:
+    I2cBus& bus_;
+    uint8_t txAddress_;
+    uint8_t txBuffer_[BUFFER_LENGTH];
+    size_t txLength_;
+    bool transmitting_;
+    uint8_t rxBuffer_[BUFFER_LENGTH];
+    size_t rxLength_;
+    size_t rxIndex_;
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,205 @@
+#ifndef HOST_DEVICES_H
+#define HOST_DEVICES_H
+
+// ============================================
+// Host HAL - Device models
+// ============================================
+// Stand-ins for the parts wired to the instruments' I2C bus, the HC-SR04
+// heads of a multi-head height station and the weight scale's HX711.
+// ============================================
+
+#include <deque>
+#include <random>
+#include <vector>
+#include "Arduino.h"
+#include "i2c_bus.h"
+#include "ultrasonic_scheduler.h"
+
+/**
+ * I2cAckDevice - Acknowledges everything (display controllers, whose
+ * traffic is write-only); reads return 0xFF
+ */
+class I2cAckDevice : public I2cDevice {
+public:
+    virtual bool onWrite(const uint8_t* data, size_t length);
+    virtual size_t onRead(uint8_t* data, size_t length);
+};
+
+/**
+ * SimulatedMax30100 - Register-level MAX30100 model
+ *
+ * Produces FIFO samples at the configured sample rate of the bus clock,
+ * with the FIFO pointers, 16-deep overflow and auto-incrementing register
+ * pointer of the real part. Samples encode the scripted patient: IR =
+ * heart rate * 100, red = SpO2 * 100 (zero with no finger), matching the
+ * host PulseOximeter model.
+ */
+class SimulatedMax30100 : public I2cDevice {
+public:
+    explicit SimulatedMax30100(const I2cBusClock& clock);
+
+    /**
+     * From fromMs on, report this patient (bpm 0 and spo2 0: no finger)
+     */
+    void setPatient(unsigned long fromMs, float bpm, int spo2);
+
+    virtual bool onWrite(const uint8_t* data, size_t length);
+    virtual size_t onRead(uint8_t* data, size_t length);
+
+    unsigned long getSamplesProduced() const { return produced_; }
+
+private:
+    struct Phase {
+        unsigned long fromMs;
+        float bpm;
+        int spo2;
+    };
+
+    const I2cBusClock& clock_;
+    std::vector<Phase> phases_;
+    uint8_t registers_[256];
+    uint8_t pointer_;
+    std::deque<unsigned long long> fifo_;   // sample times
+    uint8_t writePointer_;
+    uint8_t readPointer_;
+    uint8_t sampleByte_;
+    uint8_t current_[4];
+    unsigned long long lastSampleUs_;
+    unsigned long produced_;
+
+    void produceSamples();
+    void writeRegister(uint8_t reg, uint8_t value);
+    uint8_t readRegister(uint8_t reg);
+    void encodeSample(unsigned long long timeUs, uint8_t* out) const;
+    unsigned long samplePeriodUs() const;
+};
+
+/**
+ * SimulatedUltrasonicHeads - HC-SR04 heads sharing one acoustic space
+ *
+ * A trigger raises the head's echo pin after the burst and drops it after
+ * the round trip to the head's target, with Gaussian noise; no target
+ * holds it high for the HC-SR04's 38 ms. A head that hears another one
+ * picks up that head's pulse while its own echo is pending, and the room
+ * keeps ringing for ringDownUs after each pulse: either ends the echo
+ * early, i.e. a too-short reading.
+ */
+class SimulatedUltrasonicHeads : public UltrasonicPort {
+public:
+    /**
+     * @param clock - time base of the triggers and edges
+     * @param heads - number of heads (at most ULTRASONIC_MAX_HEADS)
+     * @param seed - noise stream
+     */
+    SimulatedUltrasonicHeads(const I2cBusClock& clock, uint8_t heads, uint32_t seed);
+
+    /**
+     * Distance seen by a head from now on (0: nothing in range)
+     */
+    void setDistance(uint8_t head, float distanceCm);
+    void setNoise(float sigmaCm) { noise_ = std::normal_distribution<float>(0.0f, sigmaCm); }
+    void setHears(uint8_t head, uint8_t mask);
+    void setRingDownUs(unsigned long ringDownUs) { ringDownUs_ = ringDownUs; }
+
+    virtual void trigger(uint8_t head);
+
+    /**
+     * Deliver the echo edges due by the clock's now, in time order
+     */
+    void deliverEdges(UltrasonicEchoSink& sink);
+
+    /**
+     * Time of the next undelivered edge, or 0 if none is pending
+     */
+    unsigned long long nextEdgeUs() const;
+
+    /**
+     * Echoes cut short into an in-range reading by another head or the
+     * ring-down
+     */
+    unsigned long getCrosstalkHits() const { return crosstalkHits_; }
+
+private:
+    struct Head {
+        float distanceCm;
+        uint8_t hears;
+        unsigned long long pulseUs;     // last burst, 0 before the first
+        unsigned long long riseUs;
+        unsigned long long fallUs;
+        bool risePending;
+        bool fallPending;
+        bool corrupted;
+    };
+
+    const I2cBusClock& clock_;
+    uint8_t heads_;
+    Head state_[ULTRASONIC_MAX_HEADS];
+    unsigned long ringDownUs_;
+    std::mt19937 rng_;
+    std::normal_distribution<float> noise_;
+    unsigned long crosstalkHits_;
+
+    void cutShort(Head& head, unsigned long long atUs);
+};
+
+/**
+ * SimulatedHx711 - Pin-level HX711 with load cells
+ *
+ * A conversion completes every 1/80 s of the clock and pulls DOUT low; 24
+ * PD_SCK pulses shift it out MSB first (DOUT changes on the rising edge),
+ * and the extra pulses end the read. Once reading has started, a conversion
+ * not read before the next one is overwritten and counted as missed; PD_SCK held high for more than
+ * 60 us while reading powers the part down (counted, and the read is lost).
+ * Conversions are offset + load * countsPer100g / 100 g + Gaussian noise.
+ */
+class SimulatedHx711 : public HostPinDevice {
+public:
+    SimulatedHx711(const I2cBusClock& clock, uint8_t doutPin, uint8_t sckPin, uint32_t seed);
+
+    /**
+     * From fromMs on, the platform carries this load
+     */
+    void setLoad(unsigned long fromMs, float grams);
+    void setNoise(float sigmaCounts) { noise_ = std::normal_distribution<float>(0.0f, sigmaCounts); }
+    void setOffset(int32_t counts) { offset_ = counts; }
+    void setCountsPer100g(float counts) { countsPer100g_ = counts; }
+
+    virtual void onPinWrite(uint8_t pin, uint8_t level);
+    virtual int onPinRead(uint8_t pin);
+
+    unsigned long getConversions() const { return conversions_; }
+    unsigned long getReads() const { return reads_; }
+    unsigned long getMissed() const { return missed_; }
+    unsigned long getPowerDowns() const { return powerDowns_; }
+
+private:
+    struct Phase {
+        unsigned long fromMs;
+        float grams;
+    };
+
+    const I2cBusClock& clock_;
+    uint8_t doutPin_;
+    uint8_t sckPin_;
+    std::vector<Phase> phases_;
+    std::mt19937 rng_;
+    std::normal_distribution<float> noise_;
+    int32_t offset_;
+    float countsPer100g_;
+
+    unsigned long long nextConversionUs_;
+    uint32_t data_;             // conversion being shifted out
+    bool dataReady_;            // unread conversion waiting
+    uint8_t pulses_;            // PD_SCK pulses of the current read
+    bool sckHigh_;
+    unsigned long long sckHighUs_;
+    unsigned long conversions_;
+    unsigned long reads_;
+    unsigned long missed_;
+    unsigned long powerDowns_;
+
+    void convert();
+    float loadAt(unsigned long ms) const;
+};
+
+#endif // HOST_DEVICES_H
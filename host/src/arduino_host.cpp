@@ -0,0 +1,126 @@
+#include "Arduino.h"
+
+HardwareSerial Serial;
+
+HostClock& hostClock() {
+    static HostClock clock;
+    return clock;
+}
+
+unsigned long millis() {
+    return static_cast<unsigned long>(hostClock().nowUs() / 1000ULL);
+}
+
+unsigned long micros() {
+    return static_cast<unsigned long>(hostClock().nowUs());
+}
+
+void delay(unsigned long ms) {
+    hostClock().advanceUs(static_cast<unsigned long long>(ms) * 1000ULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+    hostClock().advanceUs(us);
+}
+
+// ============================================
+// GPIO
+// ============================================
+
+namespace {
+
+const int kPinCount = 64;
+HostPinDevice* pinDevices[kPinCount];
+unsigned int gpioCostUs = 0;
+
+} // namespace
+
+void hostAttachPin(uint8_t pin, HostPinDevice* device) {
+    if (pin < kPinCount) {
+        pinDevices[pin] = device;
+    }
+}
+
+void hostSetGpioCostUs(unsigned int us) {
+    gpioCostUs = us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+    hostClock().advanceUs(gpioCostUs);
+    if (pin < kPinCount && pinDevices[pin] != NULL) {
+        pinDevices[pin]->onPinWrite(pin, level);
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    hostClock().advanceUs(gpioCostUs);
+    if (pin < kPinCount && pinDevices[pin] != NULL) {
+        return pinDevices[pin]->onPinRead(pin);
+    }
+    return LOW;
+}
+
+// ============================================
+// Print
+// ============================================
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    for (size_t i = 0; i < size; ++i) {
+        written += write(buffer[i]);
+    }
+    return written;
+}
+
+size_t Print::print(unsigned long value, int base) {
+    char digits[8 * sizeof(unsigned long) + 1];
+    char* p = digits + sizeof(digits) - 1;
+    *p = '\0';
+    if (base < 2) {
+        base = DEC;
+    }
+    do {
+        unsigned long digit = value % static_cast<unsigned long>(base);
+        *--p = static_cast<char>(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        value /= static_cast<unsigned long>(base);
+    } while (value > 0);
+    return write(p);
+}
+
+size_t Print::print(long value, int base) {
+    if (base == DEC && value < 0) {
+        size_t n = print('-');
+        return n + print(static_cast<unsigned long>(-(value + 1)) + 1UL, DEC);
+    }
+    return print(static_cast<unsigned long>(value), base);
+}
+
+size_t Print::print(double value, int digits) {
+    // Same output as the Arduino core's printFloat (which does not use printf)
+    char text[64];
+    std::snprintf(text, sizeof(text), "%.*f", digits, value);
+    return write(text);
+}
+
+// ============================================
+// Serial
+// ============================================
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (out_ != NULL) {
+        std::fputc(c, out_);
+    }
+    return 1;
+}
+
+int HardwareSerial::read() {
+    if (inputPos_ == input_.size()) {
+        return -1;
+    }
+    return static_cast<uint8_t>(input_[inputPos_++]);
+}
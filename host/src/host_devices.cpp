@@ -0,0 +1,373 @@
+#include "host_devices.h"
+#include <cstring>
+#include "MAX30100_PulseOximeter.h"
+#include "config.h"
+
+namespace {
+
+// Power-on SPO2_CONFIGURATION: 50 Hz, 200 us pulses
+const uint8_t kDefaultSpo2Configuration = 0x00;
+
+// HC-SR04 timing
+const unsigned long kBurstDelayUs = 450;        // trigger to burst and echo rising
+const unsigned long kNoEchoUs = 38000;          // echo width without a target
+const unsigned long kDirectPathUs = 300;        // head to head, straight across
+const unsigned long kDefaultRingDownUs = 18000;
+
+// HX711 timing
+const unsigned long kHx711PeriodUs = 1000000UL / HX711_SAMPLE_RATE_SPS;
+const unsigned long kHx711PowerDownUs = 60;
+const uint8_t kHx711DataBits = 24;
+
+} // namespace
+
+// ============================================
+// I2cAckDevice
+// ============================================
+
+bool I2cAckDevice::onWrite(const uint8_t* data, size_t length) {
+    (void)data;
+    (void)length;
+    return true;
+}
+
+size_t I2cAckDevice::onRead(uint8_t* data, size_t length) {
+    std::memset(data, 0xFF, length);
+    return length;
+}
+
+// ============================================
+// SimulatedMax30100
+// ============================================
+
+SimulatedMax30100::SimulatedMax30100(const I2cBusClock& clock)
+    : clock_(clock)
+    , pointer_(0)
+    , writePointer_(0)
+    , readPointer_(0)
+    , sampleByte_(0)
+    , lastSampleUs_(0)
+    , produced_(0)
+{
+    std::memset(registers_, 0, sizeof(registers_));
+    std::memset(current_, 0, sizeof(current_));
+    registers_[MAX30100_REG_SPO2_CONFIGURATION] = kDefaultSpo2Configuration;
+    registers_[MAX30100_REG_PART_ID] = MAX30100_EXPECTED_PART_ID;
+}
+
+void SimulatedMax30100::setPatient(unsigned long fromMs, float bpm, int spo2) {
+    Phase phase = { fromMs, bpm, spo2 };
+    phases_.push_back(phase);
+}
+
+bool SimulatedMax30100::onWrite(const uint8_t* data, size_t length) {
+    if (length == 0) {
+        return true;   // address probe
+    }
+    pointer_ = data[0];
+    sampleByte_ = 0;
+    for (size_t i = 1; i < length; ++i) {
+        writeRegister(pointer_, data[i]);
+        if (pointer_ != MAX30100_REG_FIFO_DATA) {
+            pointer_++;
+        }
+    }
+    return true;
+}
+
+size_t SimulatedMax30100::onRead(uint8_t* data, size_t length) {
+    produceSamples();
+    for (size_t i = 0; i < length; ++i) {
+        if (pointer_ != MAX30100_REG_FIFO_DATA) {
+            data[i] = readRegister(pointer_++);
+            continue;
+        }
+        // FIFO data does not auto-increment; every 4 bytes pop one sample
+        if (sampleByte_ == 0) {
+            unsigned long long timeUs = clock_.nowUs();
+            if (!fifo_.empty()) {
+                timeUs = fifo_.front();
+                fifo_.pop_front();
+                readPointer_ = static_cast<uint8_t>((readPointer_ + 1) & (MAX30100_FIFO_DEPTH - 1));
+            }
+            encodeSample(timeUs, current_);
+        }
+        data[i] = current_[sampleByte_];
+        sampleByte_ = static_cast<uint8_t>((sampleByte_ + 1) & 3);
+    }
+    return length;
+}
+
+void SimulatedMax30100::produceSamples() {
+    unsigned long period = samplePeriodUs();
+    unsigned long long now = clock_.nowUs();
+    while (lastSampleUs_ + period <= now) {
+        lastSampleUs_ += period;
+        if (fifo_.size() == MAX30100_FIFO_DEPTH) {
+            fifo_.pop_front();   // overflow drops the oldest sample
+            readPointer_ = static_cast<uint8_t>((readPointer_ + 1) & (MAX30100_FIFO_DEPTH - 1));
+            registers_[MAX30100_REG_FIFO_OVERFLOW_COUNTER]++;
+        }
+        fifo_.push_back(lastSampleUs_);
+        writePointer_ = static_cast<uint8_t>((writePointer_ + 1) & (MAX30100_FIFO_DEPTH - 1));
+        produced_++;
+    }
+}
+
+void SimulatedMax30100::writeRegister(uint8_t reg, uint8_t value) {
+    switch (reg) {
+    case MAX30100_REG_FIFO_WRITE_POINTER:
+    case MAX30100_REG_FIFO_READ_POINTER:
+        // Resetting either pointer empties the FIFO (the library writes both to 0)
+        produceSamples();
+        fifo_.clear();
+        writePointer_ = 0;
+        readPointer_ = 0;
+        break;
+    case MAX30100_REG_FIFO_DATA:
+        break;
+    default:
+        registers_[reg] = value;
+        break;
+    }
+}
+
+uint8_t SimulatedMax30100::readRegister(uint8_t reg) {
+    switch (reg) {
+    case MAX30100_REG_FIFO_WRITE_POINTER:
+        return writePointer_;
+    case MAX30100_REG_FIFO_READ_POINTER:
+        return readPointer_;
+    default:
+        return registers_[reg];
+    }
+}
+
+void SimulatedMax30100::encodeSample(unsigned long long timeUs, uint8_t* out) const {
+    float bpm = 0.0f;
+    int spo2 = 0;
+    for (size_t i = 0; i < phases_.size(); ++i) {
+        if (static_cast<unsigned long long>(phases_[i].fromMs) * 1000ULL <= timeUs) {
+            bpm = phases_[i].bpm;
+            spo2 = phases_[i].spo2;
+        }
+    }
+    uint16_t ir = static_cast<uint16_t>(bpm * MAX30100_SAMPLE_SCALE + 0.5f);
+    uint16_t red = static_cast<uint16_t>(spo2 * MAX30100_SAMPLE_SCALE);
+    out[0] = static_cast<uint8_t>(ir >> 8);
+    out[1] = static_cast<uint8_t>(ir);
+    out[2] = static_cast<uint8_t>(red >> 8);
+    out[3] = static_cast<uint8_t>(red);
+}
+
+unsigned long SimulatedMax30100::samplePeriodUs() const {
+    static const unsigned long kRatesHz[8] = { 50, 100, 167, 200, 400, 600, 800, 1000 };
+    return 1000000UL / kRatesHz[(registers_[MAX30100_REG_SPO2_CONFIGURATION] >> 2) & 0x07];
+}
+
+// ============================================
+// SimulatedUltrasonicHeads
+// ============================================
+
+SimulatedUltrasonicHeads::SimulatedUltrasonicHeads(const I2cBusClock& clock, uint8_t heads, uint32_t seed)
+    : clock_(clock)
+    , heads_(heads > ULTRASONIC_MAX_HEADS ? ULTRASONIC_MAX_HEADS : heads)
+    , ringDownUs_(kDefaultRingDownUs)
+    , rng_(seed)
+    , noise_(0.0f, 0.5f)
+    , crosstalkHits_(0)
+{
+    std::memset(state_, 0, sizeof(state_));
+    for (uint8_t i = 0; i < ULTRASONIC_MAX_HEADS; ++i) {
+        state_[i].hears = static_cast<uint8_t>(((1 << ULTRASONIC_MAX_HEADS) - 1) & ~(1 << i));
+    }
+}
+
+void SimulatedUltrasonicHeads::setDistance(uint8_t head, float distanceCm) {
+    if (head < heads_) {
+        state_[head].distanceCm = distanceCm;
+    }
+}
+
+void SimulatedUltrasonicHeads::setHears(uint8_t head, uint8_t mask) {
+    if (head < heads_) {
+        state_[head].hears = mask;
+    }
+}
+
+void SimulatedUltrasonicHeads::trigger(uint8_t head) {
+    if (head >= heads_) {
+        return;
+    }
+    Head& fired = state_[head];
+    unsigned long long pulseUs = clock_.nowUs() + kBurstDelayUs;
+    fired.pulseUs = pulseUs;
+    fired.riseUs = pulseUs;
+    fired.corrupted = false;
+    if (fired.distanceCm > 0.0f) {
+        float widthUs = (fired.distanceCm + noise_(rng_)) * ULTRASONIC_ROUNDTRIP_US_PER_CM;
+        fired.fallUs = pulseUs + static_cast<unsigned long long>(widthUs > 1.0f ? widthUs : 1.0f);
+    } else {
+        fired.fallUs = pulseUs + kNoEchoUs;
+    }
+    fired.risePending = true;
+    fired.fallPending = true;
+
+    for (uint8_t i = 0; i < heads_; ++i) {
+        if (i == head) {
+            continue;
+        }
+        Head& other = state_[i];
+        // This head listens into the ring-down of an earlier pulse it hears
+        if (((fired.hears >> i) & 1) && other.pulseUs != 0 && other.pulseUs + ringDownUs_ > pulseUs) {
+            unsigned long long remainingUs = other.pulseUs + ringDownUs_ - pulseUs;
+            std::uniform_int_distribution<unsigned long long> ghost(1, remainingUs);
+            cutShort(fired, pulseUs + ghost(rng_));
+        }
+        // Heads still listening pick up this pulse
+        if (((other.hears >> head) & 1) && other.fallPending) {
+            cutShort(other, (other.riseUs > pulseUs ? other.riseUs : pulseUs) + kDirectPathUs);
+        }
+    }
+}
+
+void SimulatedUltrasonicHeads::cutShort(Head& head, unsigned long long atUs) {
+    if (atUs < head.fallUs) {
+        head.fallUs = atUs;
+        // Only counted when it turns into a plausible (in-range) reading
+        if (!head.corrupted && atUs <= head.riseUs + ULTRASONIC_ECHO_TIMEOUT_US) {
+            head.corrupted = true;
+            crosstalkHits_++;
+        }
+    }
+}
+
+unsigned long long SimulatedUltrasonicHeads::nextEdgeUs() const {
+    unsigned long long next = 0;
+    for (uint8_t i = 0; i < heads_; ++i) {
+        const Head& head = state_[i];
+        unsigned long long edge = head.risePending ? head.riseUs : (head.fallPending ? head.fallUs : 0);
+        if (edge != 0 && (next == 0 || edge < next)) {
+            next = edge;
+        }
+    }
+    return next;
+}
+
+void SimulatedUltrasonicHeads::deliverEdges(UltrasonicEchoSink& sink) {
+    unsigned long long now = clock_.nowUs();
+    for (;;) {
+        unsigned long long next = nextEdgeUs();
+        if (next == 0 || next > now) {
+            return;
+        }
+        for (uint8_t i = 0; i < heads_; ++i) {
+            Head& head = state_[i];
+            if (head.risePending && head.riseUs == next) {
+                head.risePending = false;
+                sink.onEchoEdge(i, true, static_cast<unsigned long>(next));
+            } else if (!head.risePending && head.fallPending && head.fallUs == next) {
+                head.fallPending = false;
+                sink.onEchoEdge(i, false, static_cast<unsigned long>(next));
+            }
+        }
+    }
+}
+
+// ============================================
+// SimulatedHx711
+// ============================================
+
+SimulatedHx711::SimulatedHx711(const I2cBusClock& clock, uint8_t doutPin, uint8_t sckPin, uint32_t seed)
+    : clock_(clock)
+    , doutPin_(doutPin)
+    , sckPin_(sckPin)
+    , rng_(seed)
+    , noise_(0.0f, 0.0f)
+    , offset_(0)
+    , countsPer100g_(HX711_COUNTS_PER_100G)
+    , nextConversionUs_(kHx711PeriodUs)
+    , data_(0)
+    , dataReady_(false)
+    , pulses_(0)
+    , sckHigh_(false)
+    , sckHighUs_(0)
+    , conversions_(0)
+    , reads_(0)
+    , missed_(0)
+    , powerDowns_(0)
+{
+}
+
+void SimulatedHx711::setLoad(unsigned long fromMs, float grams) {
+    Phase phase = { fromMs, grams };
+    phases_.push_back(phase);
+}
+
+float SimulatedHx711::loadAt(unsigned long ms) const {
+    float grams = 0.0f;
+    for (size_t i = 0; i < phases_.size(); ++i) {
+        if (phases_[i].fromMs <= ms) {
+            grams = phases_[i].grams;
+        }
+    }
+    return grams;
+}
+
+void SimulatedHx711::convert() {
+    // Conversions finish on their own schedule; one not read in time is lost
+    while (pulses_ == 0 && clock_.nowUs() >= nextConversionUs_) {
+        if (dataReady_ && reads_ > 0) {
+            missed_++;      // only once the firmware has started reading
+        }
+        float counts = offset_ + loadAt(static_cast<unsigned long>(nextConversionUs_ / 1000ULL)) * countsPer100g_ / 100.0f +
+                       noise_(rng_);
+        int32_t value = static_cast<int32_t>(counts);
+        if (value > 0x7FFFFF) value = 0x7FFFFF;
+        if (value < -0x800000) value = -0x800000;
+        data_ = static_cast<uint32_t>(value) & 0xFFFFFFu;
+        dataReady_ = true;
+        conversions_++;
+        nextConversionUs_ += kHx711PeriodUs;
+    }
+}
+
+void SimulatedHx711::onPinWrite(uint8_t pin, uint8_t level) {
+    if (pin != sckPin_) {
+        return;
+    }
+    unsigned long long now = clock_.nowUs();
+    if (level == HIGH && !sckHigh_) {
+        sckHigh_ = true;
+        sckHighUs_ = now;
+        convert();
+        if (dataReady_ || pulses_ > 0) {
+            pulses_++;
+        }
+    } else if (level == LOW && sckHigh_) {
+        sckHigh_ = false;
+        if (pulses_ > 0 && now - sckHighUs_ > kHx711PowerDownUs) {
+            powerDowns_++;      // the read is lost
+            pulses_ = 0;
+            dataReady_ = false;
+        } else if (pulses_ > kHx711DataBits) {
+            reads_++;           // a gain pulse ends the read
+            pulses_ = 0;
+            dataReady_ = false;
+        }
+    }
+}
+
+int SimulatedHx711::onPinRead(uint8_t pin) {
+    if (pin != doutPin_) {
+        return LOW;
+    }
+    if (pulses_ == 0) {
+        convert();
+        return dataReady_ ? LOW : HIGH;
+    }
+    if (pulses_ > kHx711DataBits) {
+        return HIGH;
+    }
+    return (data_ >> (kHx711DataBits - pulses_)) & 1 ? HIGH : LOW;
+}
@@ -0,0 +1,150 @@
+#include "LiquidCrystal_I2C.h"
+
+namespace {
+
+// HD44780 commands
+const uint8_t LCD_CLEARDISPLAY = 0x01;
+const uint8_t LCD_RETURNHOME = 0x02;
+const uint8_t LCD_ENTRYMODESET = 0x04;
+const uint8_t LCD_DISPLAYCONTROL = 0x08;
+const uint8_t LCD_FUNCTIONSET = 0x20;
+const uint8_t LCD_SETDDRAMADDR = 0x80;
+
+const uint8_t LCD_ENTRYLEFT = 0x02;
+const uint8_t LCD_DISPLAYON = 0x04;
+const uint8_t LCD_2LINE = 0x08;
+
+// PCF8574 pins
+const uint8_t LCD_BACKLIGHT = 0x08;
+const uint8_t En = 0x04;
+const uint8_t Rs = 0x01;
+
+const uint8_t kRowOffsets[4] = { 0x00, 0x40, 0x14, 0x54 };
+
+} // namespace
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t address, uint8_t cols, uint8_t rows)
+    : address_(address)
+    , cols_(cols > 40 ? 40 : cols)
+    , rowCount_(rows > 4 ? 4 : rows)
+    , backlight_(LCD_BACKLIGHT)
+    , displayControl_(0)
+    , col_(0)
+    , row_(0)
+{
+    clearShadow();
+}
+
+void LiquidCrystal_I2C::init() {
+    Wire.begin();
+    begin(cols_, rowCount_);
+}
+
+void LiquidCrystal_I2C::begin(uint8_t cols, uint8_t rows) {
+    (void)cols;
+    uint8_t function = rows > 1 ? LCD_2LINE : 0;
+
+    // Power-on sequence: three tries at 8-bit mode, then switch to 4-bit
+    delay(50);
+    expanderWrite(backlight_);
+    delay(1000);
+    write4bits(0x03 << 4);
+    delayMicroseconds(4500);
+    write4bits(0x03 << 4);
+    delayMicroseconds(4500);
+    write4bits(0x03 << 4);
+    delayMicroseconds(150);
+    write4bits(0x02 << 4);
+
+    command(LCD_FUNCTIONSET | function);
+    displayControl_ = LCD_DISPLAYON;
+    display();
+    clear();
+    command(LCD_ENTRYMODESET | LCD_ENTRYLEFT);
+    home();
+}
+
+void LiquidCrystal_I2C::clear() {
+    command(LCD_CLEARDISPLAY);
+    delayMicroseconds(2000);
+    clearShadow();
+}
+
+void LiquidCrystal_I2C::home() {
+    command(LCD_RETURNHOME);
+    delayMicroseconds(2000);
+    col_ = 0;
+    row_ = 0;
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+    if (row >= rowCount_) {
+        row = rowCount_ - 1;
+    }
+    command(LCD_SETDDRAMADDR | (col + kRowOffsets[row]));
+    col_ = col;
+    row_ = row;
+}
+
+void LiquidCrystal_I2C::display() {
+    displayControl_ |= LCD_DISPLAYON;
+    command(LCD_DISPLAYCONTROL | displayControl_);
+}
+
+void LiquidCrystal_I2C::noDisplay() {
+    displayControl_ &= static_cast<uint8_t>(~LCD_DISPLAYON);
+    command(LCD_DISPLAYCONTROL | displayControl_);
+}
+
+void LiquidCrystal_I2C::backlight() {
+    backlight_ = LCD_BACKLIGHT;
+    expanderWrite(0);
+}
+
+void LiquidCrystal_I2C::noBacklight() {
+    backlight_ = 0;
+    expanderWrite(0);
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t value) {
+    send(value, Rs);
+    if (col_ < cols_) {
+        rows_[row_][col_] = static_cast<char>(value);
+    }
+    col_++;
+    return 1;
+}
+
+void LiquidCrystal_I2C::command(uint8_t value) {
+    send(value, 0);
+}
+
+void LiquidCrystal_I2C::send(uint8_t value, uint8_t mode) {
+    write4bits(static_cast<uint8_t>((value & 0xF0) | mode));
+    write4bits(static_cast<uint8_t>(((value << 4) & 0xF0) | mode));
+}
+
+void LiquidCrystal_I2C::write4bits(uint8_t value) {
+    expanderWrite(value);
+    pulseEnable(value);
+}
+
+void LiquidCrystal_I2C::expanderWrite(uint8_t data) {
+    Wire.beginTransmission(address_);
+    Wire.write(static_cast<uint8_t>(data | backlight_));
+    Wire.endTransmission();
+}
+
+void LiquidCrystal_I2C::pulseEnable(uint8_t data) {
+    expanderWrite(data | En);
+    delayMicroseconds(1);
+    expanderWrite(static_cast<uint8_t>(data & ~En));
+    delayMicroseconds(50);
+}
+
+void LiquidCrystal_I2C::clearShadow() {
+    for (uint8_t row = 0; row < 4; ++row) {
+        std::memset(rows_[row], ' ', cols_);
+        rows_[row][cols_] = '\0';
+    }
+}
@@ -0,0 +1,110 @@
+#include "MAX30100_PulseOximeter.h"
+
+namespace {
+
+// Library defaults: SpO2 mode, 1600 us pulses, 100 Hz, IR 50 mA, red 27.1 mA
+const uint8_t kModeSpo2Hr = 0x03;
+const uint8_t kPulseWidth1600Us = 0x03;
+const uint8_t kSampleRate100Hz = 0x01;
+const uint8_t kSpo2HighResEnable = 0x40;
+
+} // namespace
+
+PulseOximeter::PulseOximeter()
+    : heartRate_(0.0f)
+    , spo2_(0)
+    , redCurrent_(MAX30100_LED_CURR_27_1MA)
+    , onBeat_(NULL)
+    , nextBeatUs_(0)
+{
+}
+
+bool PulseOximeter::begin() {
+    Wire.begin();
+    Wire.setClock(400000);
+    if (readRegister(MAX30100_REG_PART_ID) != MAX30100_EXPECTED_PART_ID) {
+        return false;
+    }
+
+    writeRegister(MAX30100_REG_MODE_CONFIGURATION, kModeSpo2Hr);
+    uint8_t previous = readRegister(MAX30100_REG_SPO2_CONFIGURATION);
+    writeRegister(MAX30100_REG_SPO2_CONFIGURATION, static_cast<uint8_t>((previous & 0xFC) | kPulseWidth1600Us));
+    previous = readRegister(MAX30100_REG_SPO2_CONFIGURATION);
+    writeRegister(MAX30100_REG_SPO2_CONFIGURATION, static_cast<uint8_t>((previous & 0xE3) | (kSampleRate100Hz << 2)));
+    writeRegister(MAX30100_REG_LED_CONFIGURATION, static_cast<uint8_t>(redCurrent_ << 4 | MAX30100_LED_CURR_50MA));
+    previous = readRegister(MAX30100_REG_SPO2_CONFIGURATION);
+    writeRegister(MAX30100_REG_SPO2_CONFIGURATION, static_cast<uint8_t>(previous | kSpo2HighResEnable));
+
+    // Reset the FIFO
+    writeRegister(MAX30100_REG_FIFO_WRITE_POINTER, 0);
+    writeRegister(MAX30100_REG_FIFO_READ_POINTER, 0);
+    writeRegister(MAX30100_REG_FIFO_OVERFLOW_COUNTER, 0);
+    return true;
+}
+
+void PulseOximeter::update() {
+    readFifoData();
+
+    if (heartRate_ > 0.0f && onBeat_ != NULL) {
+        unsigned long long now = hostClock().nowUs();
+        if (nextBeatUs_ == 0 || now >= nextBeatUs_) {
+            if (nextBeatUs_ != 0) {
+                onBeat_();
+            }
+            nextBeatUs_ = now + static_cast<unsigned long long>(60000000.0f / heartRate_);
+        }
+    } else {
+        nextBeatUs_ = 0;
+    }
+}
+
+void PulseOximeter::setIRLedCurrent(LEDCurrent current) {
+    writeRegister(MAX30100_REG_LED_CONFIGURATION, static_cast<uint8_t>(redCurrent_ << 4 | current));
+}
+
+void PulseOximeter::readFifoData() {
+    uint8_t buffer[MAX30100_FIFO_DEPTH * 4];
+    uint8_t toRead = static_cast<uint8_t>((readRegister(MAX30100_REG_FIFO_WRITE_POINTER) -
+                                           readRegister(MAX30100_REG_FIFO_READ_POINTER)) &
+                                          (MAX30100_FIFO_DEPTH - 1));
+    if (toRead == 0) {
+        return;
+    }
+
+    // Like the library on AVR, bursts longer than the Wire buffer are cut short
+    size_t received = burstRead(MAX30100_REG_FIFO_DATA, buffer, static_cast<uint8_t>(4 * toRead));
+    for (size_t i = 0; i + 4 <= received; i += 4) {
+        uint16_t ir = static_cast<uint16_t>(buffer[i] << 8 | buffer[i + 1]);
+        uint16_t red = static_cast<uint16_t>(buffer[i + 2] << 8 | buffer[i + 3]);
+        heartRate_ = static_cast<float>(ir) / MAX30100_SAMPLE_SCALE;
+        spo2_ = static_cast<uint8_t>(red / MAX30100_SAMPLE_SCALE);
+    }
+}
+
+uint8_t PulseOximeter::readRegister(uint8_t reg) {
+    Wire.beginTransmission(MAX30100_I2C_ADDRESS);
+    Wire.write(reg);
+    Wire.endTransmission(false);
+    Wire.requestFrom(MAX30100_I2C_ADDRESS, 1);
+    int value = Wire.read();
+    return value >= 0 ? static_cast<uint8_t>(value) : 0;
+}
+
+void PulseOximeter::writeRegister(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(MAX30100_I2C_ADDRESS);
+    Wire.write(reg);
+    Wire.write(value);
+    Wire.endTransmission();
+}
+
+size_t PulseOximeter::burstRead(uint8_t reg, uint8_t* buffer, uint8_t length) {
+    Wire.beginTransmission(MAX30100_I2C_ADDRESS);
+    Wire.write(reg);
+    Wire.endTransmission(false);
+    Wire.requestFrom(static_cast<uint8_t>(MAX30100_I2C_ADDRESS), length);
+    size_t received = 0;
+    while (Wire.available() && received < length) {
+        buffer[received++] = static_cast<uint8_t>(Wire.read());
+    }
+    return received;
+}
@@ -0,0 +1,104 @@
+#include "Adafruit_SSD1306.h"
+#include <algorithm>
+
+namespace {
+
+// Wire transaction size the library splits transfers at
+const size_t WIRE_MAX = BUFFER_LENGTH;
+
+} // namespace
+
+Adafruit_SSD1306::Adafruit_SSD1306(uint8_t width, uint8_t height, TwoWire* wire, int8_t resetPin)
+    : Adafruit_GFX(width, height)
+    , wire_(wire != NULL ? wire : &Wire)
+    , address_(0x3C)
+    , vccState_(SSD1306_SWITCHCAPVCC)
+{
+    (void)resetPin;
+}
+
+bool Adafruit_SSD1306::begin(uint8_t vccState, uint8_t address, bool reset, bool periphBegin) {
+    (void)reset;
+    buffer_.assign(static_cast<size_t>(width_) * ((height_ + 7) / 8), 0);
+    vccState_ = vccState;
+    address_ = address != 0 ? address : (height_ == 32 ? 0x3C : 0x3D);
+    if (periphBegin) {
+        wire_->begin();
+    }
+
+    static const uint8_t init1[] = { 0xAE, 0xD5, 0x80, 0xA8 };   // display off, clock div, multiplex
+    commandList(init1, sizeof(init1));
+    command1(static_cast<uint8_t>(height_ - 1));
+    static const uint8_t init2[] = { 0xD3, 0x00, 0x40, 0x8D };   // offset, start line, charge pump
+    commandList(init2, sizeof(init2));
+    command1(vccState_ == SSD1306_EXTERNALVCC ? 0x10 : 0x14);
+    static const uint8_t init3[] = { 0x20, 0x00, 0xA1, 0xC8 };   // horizontal addressing, remap, scan
+    commandList(init3, sizeof(init3));
+    command1(0xDA);
+    command1(height_ == 64 ? 0x12 : 0x02);
+    command1(0x81);
+    command1(vccState_ == SSD1306_EXTERNALVCC ? 0x9F : 0xCF);
+    command1(0xD9);
+    command1(vccState_ == SSD1306_EXTERNALVCC ? 0x22 : 0xF1);
+    static const uint8_t init5[] = { 0xDB, 0x40, 0xA4, 0xA6, 0x2E, 0xAF };   // VCOM, resume, on
+    commandList(init5, sizeof(init5));
+    return true;
+}
+
+void Adafruit_SSD1306::clearDisplay() {
+    std::fill(buffer_.begin(), buffer_.end(), 0);
+}
+
+void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (x < 0 || y < 0 || x >= width_ || y >= height_ || buffer_.empty()) {
+        return;
+    }
+    uint8_t& cell = buffer_[static_cast<size_t>(x) + static_cast<size_t>(y / 8) * width_];
+    uint8_t bit = static_cast<uint8_t>(1 << (y & 7));
+    cell = color ? static_cast<uint8_t>(cell | bit) : static_cast<uint8_t>(cell & ~bit);
+}
+
+void Adafruit_SSD1306::display() {
+    static const uint8_t addressing[] = { 0x22, 0x00, 0xFF, 0x21, 0x00 };   // page and column ranges
+    commandList(addressing, sizeof(addressing));
+    command1(static_cast<uint8_t>(width_ - 1));
+
+    wire_->beginTransmission(address_);
+    wire_->write(static_cast<uint8_t>(0x40));
+    size_t bytesOut = 1;
+    for (size_t i = 0; i < buffer_.size(); ++i) {
+        if (bytesOut >= WIRE_MAX) {
+            wire_->endTransmission();
+            wire_->beginTransmission(address_);
+            wire_->write(static_cast<uint8_t>(0x40));
+            bytesOut = 1;
+        }
+        wire_->write(buffer_[i]);
+        bytesOut++;
+    }
+    wire_->endTransmission();
+}
+
+void Adafruit_SSD1306::command1(uint8_t command) {
+    wire_->beginTransmission(address_);
+    wire_->write(static_cast<uint8_t>(0x00));
+    wire_->write(command);
+    wire_->endTransmission();
+}
+
+void Adafruit_SSD1306::commandList(const uint8_t* commands, size_t count) {
+    wire_->beginTransmission(address_);
+    wire_->write(static_cast<uint8_t>(0x00));
+    size_t bytesOut = 1;
+    for (size_t i = 0; i < count; ++i) {
+        if (bytesOut >= WIRE_MAX) {
+            wire_->endTransmission();
+            wire_->beginTransmission(address_);
+            wire_->write(static_cast<uint8_t>(0x00));
+            bytesOut = 1;
+        }
+        wire_->write(commands[i]);
+        bytesOut++;
+    }
+    wire_->endTransmission();
+}
@@ -0,0 +1,66 @@
+#include "Wire.h"
+
+I2cBus& hostI2cBus() {
+    static I2cBus bus;
+    static bool clocked = false;
+    if (!clocked) {
+        bus.setClock(&hostClock());
+        clocked = true;
+    }
+    return bus;
+}
+
+TwoWire Wire(hostI2cBus());
+
+TwoWire::TwoWire(I2cBus& bus)
+    : bus_(bus)
+    , txAddress_(0)
+    , txLength_(0)
+    , transmitting_(false)
+    , rxLength_(0)
+    , rxIndex_(0)
+{
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    txAddress_ = address;
+    txLength_ = 0;
+    transmitting_ = true;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    uint8_t status = bus_.write(txAddress_, txBuffer_, txLength_, sendStop);
+    txLength_ = 0;
+    transmitting_ = false;
+    return status;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (!transmitting_ || txLength_ >= BUFFER_LENGTH) {
+        return 0;   // the AVR core silently drops bytes past the buffer
+    }
+    txBuffer_[txLength_++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t length) {
+    size_t written = 0;
+    for (size_t i = 0; i < length; ++i) {
+        written += write(data[i]);
+    }
+    return written;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop) {
+    (void)sendStop;
+    if (quantity > BUFFER_LENGTH) {
+        quantity = BUFFER_LENGTH;
+    }
+    rxLength_ = bus_.read(address, rxBuffer_, quantity);
+    rxIndex_ = 0;
+    return static_cast<uint8_t>(rxLength_);
+}
+
+int TwoWire::read() {
+    return rxIndex_ < rxLength_ ? rxBuffer_[rxIndex_++] : -1;
+}
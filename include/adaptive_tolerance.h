@@ -0,0 +1,124 @@
+#ifndef ADAPTIVE_TOLERANCE_H
+#define ADAPTIVE_TOLERANCE_H
+
+#include <cmath>
+#include <type_traits>
+
+/**
+ * AdaptiveTolerance - Online sensor noise floor and the tolerance it implies
+ *
+ * Fed consecutive readings from periods known to be stable, it tracks a
+ * robust scale of their differences: an exponentially weighted mean of
+ * |difference|, with each difference clipped at a few times the current
+ * estimate so a patient shifting on the platform does not inflate it.
+ * For Gaussian noise the standard deviation of a difference is
+ * sqrt(pi / 2) times its mean absolute value, and the recommended
+ * tolerance is `sigmas` of those, kept within the approved bounds
+ * (rounded up for integer readings).
+ */
+template<typename T>
+class AdaptiveTolerance {
+public:
+    /**
+     * @param minTolerance - lowest approved tolerance
+     * @param maxTolerance - highest approved tolerance
+     * @param sigmas - tolerance in difference standard deviations
+     * @param warmupSamples - differences needed before the estimate is used
+     * @param weight - EWMA weight once warmed up (about 1 / window)
+     */
+    AdaptiveTolerance(T minTolerance, T maxTolerance, float sigmas, unsigned long warmupSamples = 32,
+                      float weight = 1.0f / 64.0f)
+        : minTolerance_(minTolerance)
+        , maxTolerance_(maxTolerance)
+        , sigmas_(sigmas)
+        , warmupSamples_(warmupSamples > 0 ? warmupSamples : 1)
+        , weight_(weight)
+        , meanAbsDifference_(0.0f)
+        , samples_(0)
+    {
+    }
+
+    /**
+     * Add the difference between two consecutive readings of a stable period
+     */
+    void observe(T previous, T current) {
+        float difference = std::fabs(static_cast<float>(current) - static_cast<float>(previous));
+        if (samples_ >= warmupSamples_) {
+            float clip = kClip * meanAbsDifference_;
+            float floor = static_cast<float>(minTolerance_);
+            if (clip < floor) clip = floor;   // let a zero estimate grow
+            if (difference > clip) difference = clip;
+        }
+        samples_++;
+        // Plain mean while warming up, then an EWMA
+        float weight = 1.0f / static_cast<float>(samples_);
+        if (weight < weight_) weight = weight_;
+        meanAbsDifference_ += weight * (difference - meanAbsDifference_);
+    }
+
+    bool isWarm() const {
+        return samples_ >= warmupSamples_;
+    }
+
+    /**
+     * Estimated standard deviation of consecutive differences
+     */
+    float getDifferenceSigma() const {
+        return meanAbsDifference_ * kMeanAbsToSigma;
+    }
+
+    /**
+     * Estimated standard deviation of a single reading
+     */
+    float getNoiseSigma() const {
+        return getDifferenceSigma() / kSqrt2;
+    }
+
+    /**
+     * Recommended tolerance
+     * @param fallback - returned (clamped to the bounds) until warmed up
+     */
+    T getTolerance(T fallback) const {
+        if (!isWarm()) {
+            return clamp(fallback);
+        }
+        return clamp(fromFloat(sigmas_ * getDifferenceSigma()));
+    }
+
+    unsigned long getSampleCount() const { return samples_; }
+    T getMinTolerance() const { return minTolerance_; }
+    T getMaxTolerance() const { return maxTolerance_; }
+
+    /**
+     * Forget the estimate (e.g. after the sensor was replaced)
+     */
+    void reset() {
+        meanAbsDifference_ = 0.0f;
+        samples_ = 0;
+    }
+
+private:
+    static constexpr float kClip = 4.0f;
+    static constexpr float kMeanAbsToSigma = 1.2533141f;   // sqrt(pi / 2)
+    static constexpr float kSqrt2 = 1.4142136f;
+
+    T minTolerance_;
+    T maxTolerance_;
+    float sigmas_;
+    unsigned long warmupSamples_;
+    float weight_;
+    float meanAbsDifference_;
+    unsigned long samples_;
+
+    T clamp(T tolerance) const {
+        if (tolerance < minTolerance_) return minTolerance_;
+        if (tolerance > maxTolerance_) return maxTolerance_;
+        return tolerance;
+    }
+
+    static T fromFloat(float value) {
+        return std::is_integral<T>::value ? static_cast<T>(std::ceil(value)) : static_cast<T>(value);
+    }
+};
+
+#endif // ADAPTIVE_TOLERANCE_H
@@ -0,0 +1,170 @@
+#ifndef ALERT_RULES_H
+#define ALERT_RULES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "trace_sample.h"
+
+#define ALERT_RULE_MAX_DEPTH 8        // operand stack of a compiled rule
+#define ALERT_RULE_BLOCK_STATIONS 256 // stations evaluated per pass of a rule's program
+
+/**
+ * Instructions of a compiled rule, a postfix program over one station
+ */
+enum AlertOpcode {
+    ALERT_OP_STABLE = 0,     // push: channel is stable
+    ALERT_OP_ACTIVE,         // push: channel has a valid reading (a session is under way)
+    ALERT_OP_STABLE_CMP,     // push: channel is stable and its stable reading compares true
+    ALERT_OP_READING_CMP,    // push: channel is active and its latest reading compares true
+    ALERT_OP_AND,            // pop two, push both
+    ALERT_OP_OR,             // pop two, push either
+    ALERT_OP_NOT             // pop one, push its negation
+};
+
+enum AlertCompare {
+    ALERT_CMP_LT = 0,
+    ALERT_CMP_LE,
+    ALERT_CMP_GT,
+    ALERT_CMP_GE,
+    ALERT_CMP_EQ,
+    ALERT_CMP_NE
+};
+
+struct AlertInstruction {
+    uint8_t op;          // AlertOpcode
+    uint8_t channel;     // SampleChannel, for the push instructions
+    uint8_t compare;     // AlertCompare, for the *_CMP instructions
+    float constant;
+};
+
+/**
+ * A rule compiled by compileAlertRule()
+ */
+struct AlertRuleProgram {
+    std::vector<AlertInstruction> code;
+    unsigned long holdMs;    // the condition must hold this long before the alert is raised
+    unsigned depth;          // operand stack slots the program needs
+
+    AlertRuleProgram();
+};
+
+/**
+ * Compile a rule's text
+ *
+ * A rule is a condition, optionally followed by "for N ms|s|min":
+ *   spo2 stable < 90 for 10 s
+ *   bpm stable > 120 while height session active
+ *   not (height stable or height active) and bpm > 40
+ * Each term names a channel (height, bpm, spo2; any case) and then either
+ * "stable" or "active" ("session active" reads the same), a comparison
+ * with the stable reading ("stable < 90", false while unstable) or a
+ * comparison with the latest valid reading ("< 90", false without one).
+ * Terms combine with not, and (or while), or, and parentheses.
+ *
+ * @param error - if not NULL, set to a message with the offending column
+ * @return false if the text is not a valid rule
+ */
+bool compileAlertRule(const std::string& text, AlertRuleProgram& out, std::string* error = NULL);
+
+/**
+ * A rule starting or ceasing to fire for a station
+ */
+struct AlertEvent {
+    uint32_t stationId;
+    uint32_t rule;           // index from AlertRuleEngine::addRule()
+    unsigned long timeMs;    // when the hold elapsed, or when the condition last could have ended
+    bool raised;
+};
+
+/**
+ * AlertRuleEngine - Compiled alert rules evaluated in batches across stations
+ *
+ * Wired to a TraceReplayer as both its transition sink and its event sink,
+ * the engine keeps the debouncer outputs of every station in columns: per
+ * channel a stable flag, stable reading, active flag and latest reading,
+ * plus each station's clock (its latest sample time) and the time any of
+ * those last changed. Sinking a sample is one hash lookup and a few stores;
+ * nothing is evaluated then.
+ *
+ * evaluate() runs each rule's program over blocks of ALERT_RULE_BLOCK_STATIONS
+ * stations, an instruction at a time over the whole block, so the per-
+ * instruction dispatch is paid once per block and the comparisons are
+ * branch-free loops over contiguous columns. The cost is stations x rules x
+ * program length at a few instructions per station.
+ *
+ * A condition that is true when evaluated is taken to have held since the
+ * station's last change, and its alert is raised once the station's clock
+ * is holdMs past that. Between two calls a condition may therefore start
+ * up to one call's interval later than it did, and a condition that came
+ * and went entirely between them is not seen; call evaluate() at least as
+ * often as the shortest hold matters.
+ */
+class AlertRuleEngine : public StabilityTransitionSink, public DebounceEventSink {
+public:
+    explicit AlertRuleEngine(size_t expectedStations = 0);
+
+    /**
+     * Compile and add a rule, not firing for any station yet
+     * @param error - if not NULL, set when the rule does not compile
+     * @return false if it does not compile
+     */
+    bool addRule(const std::string& name, const std::string& text, std::string* error = NULL);
+
+    virtual void onTransition(const StabilityTransition& transition);
+    virtual void onStableUpdate(const StabilityTransition& transition);
+    virtual void onDebounceEvent(const DebounceEvent& event);
+
+    /**
+     * Evaluate every rule for every station
+     * @param out - alerts raised and cleared since the last call are appended
+     * @return number of events appended
+     */
+    size_t evaluate(std::vector<AlertEvent>& out);
+
+    /**
+     * Whether a rule's condition holds for a station right now, one station
+     * at a time (ignores the hold)
+     */
+    bool test(size_t rule, uint32_t stationId) const;
+
+    /**
+     * Whether a rule was firing for a station as of the last evaluate()
+     */
+    bool isFiring(size_t rule, uint32_t stationId) const;
+
+    size_t getRuleCount() const { return rules_.size(); }
+    const std::string& getRuleName(size_t rule) const { return rules_[rule].name; }
+    const AlertRuleProgram& getProgram(size_t rule) const { return rules_[rule].program; }
+    size_t getFiringCount(size_t rule) const { return rules_[rule].firingCount; }
+    size_t getStationCount() const { return ids_.size(); }
+
+private:
+    struct Rule {
+        std::string name;
+        AlertRuleProgram program;
+        std::vector<unsigned long> since;   // per station: condition true since, ~0 if false
+        std::vector<uint8_t> firing;
+        size_t firingCount;
+    };
+
+    std::unordered_map<uint32_t, uint32_t> slots_;
+    std::vector<uint32_t> ids_;
+    std::vector<unsigned long> clockMs_;
+    std::vector<unsigned long> changedMs_;
+    std::vector<uint8_t> stable_[SAMPLE_CHANNEL_COUNT];
+    std::vector<float> stableValue_[SAMPLE_CHANNEL_COUNT];
+    std::vector<uint8_t> active_[SAMPLE_CHANNEL_COUNT];
+    std::vector<float> reading_[SAMPLE_CHANNEL_COUNT];
+    std::vector<Rule> rules_;
+
+    uint32_t slotFor(uint32_t stationId);
+    void touch(uint32_t slot, unsigned long timeMs, bool changed);
+    void runBlock(const AlertRuleProgram& program, size_t begin, size_t count,
+                  uint8_t stack[][ALERT_RULE_BLOCK_STATIONS]) const;
+    bool testSlot(const AlertRuleProgram& program, uint32_t slot) const;
+};
+
+#endif // ALERT_RULES_H
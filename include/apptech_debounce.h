@@ -0,0 +1,191 @@
+#ifndef APPTECH_DEBOUNCE_H
+#define APPTECH_DEBOUNCE_H
+
+/*
+ * apptech_debounce - C ABI for the instrument debouncers
+ *
+ * Wraps HeightDebouncer and the BPM/SpO2 ReadingDebouncers behind opaque
+ * handles so services in other languages (Go cgo, Python ctypes/cffi,
+ * Java FFM/JNA) run exactly the firmware's debounce logic. Every update
+ * call takes a whole batch over caller-owned arrays and reports stability
+ * transitions into a caller-owned buffer, so a foreign caller pays one
+ * FFI crossing per batch instead of one per sample.
+ *
+ * ABI rules: handles are opaque, structs only ever grow at the end and
+ * carry their size, functions never throw and report errors as negative
+ * status codes, and nothing allocated by the library is freed by the
+ * caller except through the matching destroy function. Handles are not
+ * thread-safe; use one per thread (or lock around it).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+  #if defined(APPTECH_DEBOUNCE_BUILD)
+    #define APPTECH_API __declspec(dllexport)
+  #else
+    #define APPTECH_API __declspec(dllimport)
+  #endif
+#else
+  #define APPTECH_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped on any incompatible change to the declarations below */
+#define APPTECH_DEBOUNCE_ABI_VERSION 1
+
+/* Status codes */
+#define APPTECH_OK 0
+#define APPTECH_ERR_INVALID_ARGUMENT (-1)
+#define APPTECH_ERR_NO_MEMORY (-2)
+#define APPTECH_ERR_BUFFER_FULL (-3)   /* transition buffer full; resume from *consumed */
+
+/* Debouncer kinds (same numbering as the trace sample channels) */
+#define APPTECH_KIND_HEIGHT 0   /* HeightDebouncer, integer cm */
+#define APPTECH_KIND_BPM 1      /* ReadingDebouncer<float>, beats per minute */
+#define APPTECH_KIND_SPO2 2     /* ReadingDebouncer<int>, percent */
+
+/* struct_size of the first (ABI version 1) apptech_debounce_config */
+#define APPTECH_DEBOUNCE_CONFIG_SIZE_V1 48
+
+/* Transition types */
+#define APPTECH_TRANSITION_UNSTABLE 0   /* stability lost; value is the reading that broke it */
+#define APPTECH_TRANSITION_STABLE 1     /* stability reached; value is the stable reading */
+#define APPTECH_TRANSITION_UPDATE 2     /* still stable, stable reading moved within tolerance */
+
+/**
+ * Debouncer parameters
+ *
+ * Fill with apptech_debounce_config_default() and override fields. Integer
+ * kinds truncate tolerance and the valid range; height has no valid range.
+ * Values must be finite and fit the kind's type (int for height and SpO2,
+ * float for BPM). A struct_size from APPTECH_DEBOUNCE_CONFIG_SIZE_V1 up is
+ * accepted: fields the caller's struct lacks take the kind's defaults, and
+ * fields the library does not know are ignored.
+ */
+typedef struct apptech_debounce_config {
+    uint32_t struct_size;              /* sizeof(apptech_debounce_config) */
+    uint32_t kind;                     /* APPTECH_KIND_* */
+    double tolerance;
+    uint64_t stability_duration_ms;
+    uint64_t sample_interval_ms;
+    double min_valid;
+    double max_valid;
+} apptech_debounce_config;
+
+/**
+ * One stability transition produced by a batch
+ */
+typedef struct apptech_transition {
+    uint64_t sample_index;   /* index of the sample in the batch arrays */
+    uint64_t time_ms;
+    double value;
+    uint32_t lane;           /* debouncer within a bank; 0 for a single debouncer */
+    uint32_t type;           /* APPTECH_TRANSITION_* */
+} apptech_transition;
+
+/**
+ * Current state of one debouncer
+ */
+typedef struct apptech_debounce_state {
+    uint32_t stable;            /* non-zero when stable */
+    uint32_t has_reading;       /* non-zero after the first accepted reading */
+    double stable_reading;      /* valid when stable */
+    double last_reading;
+} apptech_debounce_state;
+
+typedef struct apptech_debouncer apptech_debouncer;
+typedef struct apptech_debouncer_bank apptech_debouncer_bank;
+
+/**
+ * ABI version the library was built with (compare against
+ * APPTECH_DEBOUNCE_ABI_VERSION at load time)
+ */
+APPTECH_API uint32_t apptech_debounce_abi_version(void);
+
+/**
+ * Static description of a status code
+ */
+APPTECH_API const char* apptech_debounce_strerror(int status);
+
+/**
+ * Fill config with the instruments' config.h values for a kind
+ * @return APPTECH_ERR_INVALID_ARGUMENT for an unknown kind
+ */
+APPTECH_API int apptech_debounce_config_default(uint32_t kind, apptech_debounce_config* config);
+
+/**
+ * Create a single debouncer
+ */
+APPTECH_API int apptech_debouncer_create(const apptech_debounce_config* config, apptech_debouncer** out);
+APPTECH_API void apptech_debouncer_destroy(apptech_debouncer* debouncer);
+APPTECH_API void apptech_debouncer_reset(apptech_debouncer* debouncer);
+
+/**
+ * Feed a batch of samples in time order
+ *
+ * Transitions go to out (which may be NULL with capacity 0 to drop them).
+ * When out fills up the call stops before the next sample and returns
+ * APPTECH_ERR_BUFFER_FULL; *consumed says how many samples were applied,
+ * so the caller drains out and calls again with the remainder. A value
+ * that is NaN, infinite or outside the kind's type (or an unknown lane)
+ * stops the call the same way with APPTECH_ERR_INVALID_ARGUMENT.
+ *
+ * @param values/times_ms - count readings and their timestamps
+ * @param out_count - transitions written
+ * @param consumed - samples applied (may be NULL)
+ */
+APPTECH_API int apptech_debouncer_update(apptech_debouncer* debouncer, const double* values,
+                                         const uint64_t* times_ms, size_t count, apptech_transition* out,
+                                         size_t out_capacity, size_t* out_count, size_t* consumed);
+
+APPTECH_API int apptech_debouncer_get_state(const apptech_debouncer* debouncer, apptech_debounce_state* state);
+
+/**
+ * Create a bank of lanes independent debouncers with the same config
+ * (one per patient, device or station)
+ */
+APPTECH_API int apptech_bank_create(const apptech_debounce_config* config, size_t lanes,
+                                    apptech_debouncer_bank** out);
+APPTECH_API void apptech_bank_destroy(apptech_debouncer_bank* bank);
+APPTECH_API size_t apptech_bank_lane_count(const apptech_debouncer_bank* bank);
+APPTECH_API int apptech_bank_reset_lane(apptech_debouncer_bank* bank, uint32_t lane);
+
+/**
+ * Feed a batch of samples for any lanes (struct-of-arrays columns)
+ *
+ * Sample i goes to lane lanes[i]; samples of one lane must be in time
+ * order. Buffer-full handling is as for apptech_debouncer_update.
+ */
+APPTECH_API int apptech_bank_update(apptech_debouncer_bank* bank, const uint32_t* lanes, const double* values,
+                                    const uint64_t* times_ms, size_t count, apptech_transition* out,
+                                    size_t out_capacity, size_t* out_count, size_t* consumed);
+
+/**
+ * Feed one reading to every lane at the same time (a polling tick):
+ * values[lane] for lane in [0, lane count). sample_index of a transition
+ * is its lane.
+ */
+APPTECH_API int apptech_bank_update_all(apptech_debouncer_bank* bank, const double* values, uint64_t time_ms,
+                                        apptech_transition* out, size_t out_capacity, size_t* out_count,
+                                        size_t* consumed);
+
+APPTECH_API int apptech_bank_get_state(const apptech_debouncer_bank* bank, uint32_t lane,
+                                       apptech_debounce_state* state);
+
+/**
+ * Copy every lane's stable flag and stable reading into caller arrays of
+ * at least lane count entries (either may be NULL)
+ */
+APPTECH_API int apptech_bank_get_stable(const apptech_debouncer_bank* bank, uint8_t* stable,
+                                        double* stable_readings);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APPTECH_DEBOUNCE_H */
@@ -17,6 +17,31 @@
 // Maximum distance for ultrasonic sensor (in cm)
 #define HEIGHT_MAX_DISTANCE_CM 200
 
+// Burst ranging: fire up to BURST_MAX_PINGS pings BURST_PING_GAP_MS apart and
+// stop once BURST_AGREE_COUNT echoes agree within DEBOUNCE_TOLERANCE_CM. One
+// consensus reading per BURST_INTERVAL_MS, stable after
+// BURST_STABILITY_DURATION_MS (set HEIGHT_BURST_MODE to 1 to enable)
+#define HEIGHT_BURST_MODE 0
+#define BURST_AGREE_COUNT 3
+#define BURST_MAX_PINGS 6
+#define BURST_PING_GAP_MS 30
+#define BURST_INTERVAL_MS 250
+#define BURST_STABILITY_DURATION_MS 1000
+
+// On-device history (HistoryRing): one height sample per
+// HEIGHT_HISTORY_INTERVAL_MS in HEIGHT_HISTORY_BYTES of RAM, about 7 minutes;
+// dumped when the host sends HISTORY_DUMP_REQUEST
+#define HEIGHT_HISTORY_BYTES 512
+#define HEIGHT_HISTORY_INTERVAL_MS 500
+#define HISTORY_DEVICE_ID 0
+
+// Multi-head ranging: microseconds of echo per cm (NewPing's US_ROUNDTRIP_CM),
+// longest echo within HEIGHT_MAX_DISTANCE_CM, and the guard between
+// triggers of heads that hear each other (echo plus ring-down)
+#define ULTRASONIC_ROUNDTRIP_US_PER_CM 57
+#define ULTRASONIC_ECHO_TIMEOUT_US (HEIGHT_MAX_DISTANCE_CM * ULTRASONIC_ROUNDTRIP_US_PER_CM)
+#define ULTRASONIC_GUARD_US 20000
+
 // ============================================
 // Hardware Pin Configuration
 // ============================================
@@ -46,4 +71,89 @@
 // OLED I2C address
 #define OLED_I2C_ADDRESS 0x3C
 
+// ============================================
+// Pulse Oximeter Debounce Configuration
+// ============================================
+// Mirrors the values in pulse_oximeter.ino so host-side replay
+// reproduces the firmware's stability decisions.
+
+#ifdef ARDUINO_AVR_UNO
+  #define BPM_STABILITY_DURATION_MS 2000
+  #define BPM_SAMPLE_INTERVAL_MS 200
+  #define SPO2_STABILITY_DURATION_MS 2000
+  #define SPO2_SAMPLE_INTERVAL_MS 200
+#else
+  #define BPM_STABILITY_DURATION_MS 3000
+  #define BPM_SAMPLE_INTERVAL_MS 100
+  #define SPO2_STABILITY_DURATION_MS 3000
+  #define SPO2_SAMPLE_INTERVAL_MS 100
+#endif
+
+#define BPM_TOLERANCE 5.0f
+#define BPM_MIN_VALID 40.0f
+#define BPM_MAX_VALID 200.0f
+
+#define SPO2_TOLERANCE 2
+#define SPO2_MIN_VALID 50
+#define SPO2_MAX_VALID 100
+
+// FFT heart rate (FftBpmEstimator): raw IR at the MAX30100's 100 Hz is
+// averaged down by FFT_BPM_DECIMATION, and a window of 2^FFT_BPM_LOG2_SIZE
+// decimated samples is analyzed every FFT_BPM_HOP_MS
+#define FFT_BPM_SAMPLE_RATE_HZ 100
+#ifdef ARDUINO_AVR_UNO
+  #define FFT_BPM_LOG2_SIZE 6            // 64 points at 10 Hz: 6.4 s window, about 420 bytes
+  #define FFT_BPM_DECIMATION 10
+#else
+  #define FFT_BPM_LOG2_SIZE 8            // 256 points at 25 Hz: 10.24 s window
+  #define FFT_BPM_DECIMATION 4
+#endif
+#define FFT_BPM_HOP_MS 1000
+#define FFT_BPM_HOP (FFT_BPM_HOP_MS * FFT_BPM_SAMPLE_RATE_HZ / FFT_BPM_DECIMATION / 1000)
+#define FFT_BPM_MIN_AMPLITUDE 20         // IR counts; less is no finger (as the beat detector's threshold)
+#define FFT_BPM_MIN_CONFIDENCE_PCT 25    // peak's share of the 40-200 BPM band power
+#define FFT_BPM_MAX_MISSES 3             // weak windows before the estimate is dropped
+
+// ============================================
+// Weight Scale Configuration
+// ============================================
+
+// HX711 pins (DOUT, PD_SCK) and gain pulses after the 24 data bits
+// (1: channel A, gain 128 - the HX711's 80 SPS mode with RATE tied high)
+#define HX711_DOUT_PIN 6
+#define HX711_SCK_PIN 7
+#define HX711_GAIN_PULSES 1
+#define HX711_SAMPLE_RATE_SPS 80
+
+// Calibration of the load cells: HX711 counts per 100 g
+#define HX711_COUNTS_PER_100G 420
+
+// CIC decimator: order 2, rate 2^3 = 8, so 80 SPS become 10 readings per second
+#define WEIGHT_CIC_ORDER 2
+#define WEIGHT_CIC_LOG2_RATE 3
+
+// Readings averaged for the tare at power-up (empty platform)
+#define WEIGHT_TARE_READINGS 10
+
+// Weight debounce settings (grams)
+#define WEIGHT_TOLERANCE_G 100
+#define WEIGHT_STABILITY_DURATION_MS 2000
+#define WEIGHT_SAMPLE_INTERVAL_MS 50     // below the decimated period; the decimator sets the pace
+#define WEIGHT_MIN_VALID_G 2000          // lighter means nobody on the platform
+#define WEIGHT_MAX_VALID_G 250000
+
+// ============================================
+// Adaptive Tolerance (host replay, optional)
+// ============================================
+// Clinically approved tolerance bounds. In adaptive mode each channel's
+// tolerance follows its measured noise floor but never leaves these.
+
+#define ADAPTIVE_TOLERANCE_SIGMAS 3.0f
+#define ADAPTIVE_TOLERANCE_MIN_CM 1
+#define ADAPTIVE_TOLERANCE_MAX_CM 4
+#define ADAPTIVE_BPM_TOLERANCE_MIN 2.0f
+#define ADAPTIVE_BPM_TOLERANCE_MAX 8.0f
+#define ADAPTIVE_SPO2_TOLERANCE_MIN 1
+#define ADAPTIVE_SPO2_TOLERANCE_MAX 3
+
 #endif // CONFIG_H
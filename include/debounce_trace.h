@@ -0,0 +1,162 @@
+#ifndef DEBOUNCE_TRACE_H
+#define DEBOUNCE_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Debouncer decisions recorded by the tracepoints in update()
+ */
+enum DebounceTraceEvent {
+    DEBOUNCE_TRACE_INTERVAL_SKIP = 0,  // sample arrived before the sample interval
+    DEBOUNCE_TRACE_FIRST_READING,      // first (valid) reading starts the stability timer
+    DEBOUNCE_TRACE_INVALID_RESET,      // out-of-range reading reset the debouncer
+    DEBOUNCE_TRACE_TOLERANCE_RESET,    // reading moved outside tolerance, timer restarted
+    DEBOUNCE_TRACE_STABLE,             // debouncer became stable
+    DEBOUNCE_TRACE_EVENT_COUNT
+};
+
+#define DEBOUNCE_TRACE_MAGIC "DBTRACE1"
+#define DEBOUNCE_TRACE_DEFAULT_CAPACITY 4096
+#define DEBOUNCE_TRACE_SLOT_WRITING 0xFFFFFFFFu
+
+/**
+ * One slot of the trace ring (32 bytes)
+ *
+ * sequence is the low 32 bits of (record index + 1), written last with
+ * release ordering; 0 marks an empty slot and DEBOUNCE_TRACE_SLOT_WRITING
+ * one being overwritten. A writer claims a slot by swapping in the writing
+ * mark, so a writer that laps a slow one drops its record instead of
+ * tearing it. Readers use sequence to reject torn or recycled slots.
+ */
+struct DebounceTraceRecord {
+    std::atomic<uint32_t> sequence;
+    float reading;
+    uint64_t timeMs;
+    uint64_t source;   // address of the debouncer, identifies the instance
+    uint8_t event;
+    uint8_t reserved[7];
+};
+
+/**
+ * Ring header (64 bytes), followed by `capacity` records
+ *
+ * The layout is shared with tools that map the ring file, so a live
+ * process can be traced and toggled without stopping it.
+ */
+struct DebounceTraceRingHeader {
+    char magic[8];
+    uint32_t capacity;               // records, power of two
+    std::atomic<uint32_t> enabled;   // tracepoints fire while non-zero
+    std::atomic<uint64_t> head;      // total records ever written
+    uint64_t reserved[5];
+};
+
+/**
+ * Decoded record returned by debounceTraceSnapshot()
+ */
+struct DebounceTraceEntry {
+    uint64_t index;
+    uint64_t timeMs;
+    uint64_t source;
+    float reading;
+    uint8_t event;
+};
+
+/**
+ * DebounceTraceMapping - A trace ring backed by a shared file mapping
+ *
+ * The traced process creates the file through debounceTraceAttach(); the
+ * decoder opens the same file to read records or flip the enabled flag.
+ * Unavailable on platforms without mmap (open() returns false).
+ */
+class DebounceTraceMapping {
+public:
+    DebounceTraceMapping();
+    ~DebounceTraceMapping();
+
+    /**
+     * Map an existing ring file, or create one
+     * @param path - ring file path
+     * @param capacity - records when creating (rounded up to a power of two);
+     *                   0 to require an existing ring
+     * @return true if a valid ring is mapped
+     */
+    bool open(const char* path, uint32_t capacity);
+
+    void close();
+
+    DebounceTraceRingHeader* header() const { return header_; }
+
+private:
+    DebounceTraceRingHeader* header_;
+    size_t length_;
+
+    // Non-copyable
+    DebounceTraceMapping(const DebounceTraceMapping&);
+    DebounceTraceMapping& operator=(const DebounceTraceMapping&);
+};
+
+/**
+ * Records of a ring (they follow the header)
+ */
+inline DebounceTraceRecord* debounceTraceRecords(DebounceTraceRingHeader* ring) {
+    return reinterpret_cast<DebounceTraceRecord*>(ring + 1);
+}
+
+inline const DebounceTraceRecord* debounceTraceRecords(const DebounceTraceRingHeader* ring) {
+    return reinterpret_cast<const DebounceTraceRecord*>(ring + 1);
+}
+
+/**
+ * Flag checked by the tracepoints; points at the active ring's enabled word
+ */
+extern std::atomic<std::atomic<uint32_t>*> debounceTraceEnabledFlag;
+
+/**
+ * Send tracepoints to a ring file that a decoder can read while the process runs
+ * Attach, detach and enable may be called while other threads update
+ * debouncers; attached files stay mapped until exit, because a tracepoint
+ * racing a detach can still write to the old ring.
+ * @return false if the file cannot be created or mapped
+ */
+bool debounceTraceAttach(const char* path, uint32_t capacity);
+
+/**
+ * Return to the in-process ring (tracing disabled)
+ */
+void debounceTraceDetach();
+
+/**
+ * Turn tracepoints on or off for the active ring
+ */
+void debounceTraceSetEnabled(bool enabled);
+
+/**
+ * Active ring (the in-process one when no file is attached)
+ */
+DebounceTraceRingHeader* debounceTraceActiveRing();
+
+/**
+ * Append a record to the active ring; called by DEBOUNCE_TRACE
+ */
+void debounceTraceRecord(DebounceTraceEvent event, const void* source, float reading, unsigned long timeMs);
+
+/**
+ * Decode the records still held by a ring
+ * @param ring - ring to read (may be written concurrently)
+ * @param fromIndex - first record index wanted; older records are skipped
+ * @param out - decoded records in index order are appended here
+ * @return index to pass as fromIndex on the next call
+ */
+uint64_t debounceTraceSnapshot(const DebounceTraceRingHeader* ring, uint64_t fromIndex,
+                               std::vector<DebounceTraceEntry>& out);
+
+/**
+ * Short event name for timelines
+ */
+const char* debounceTraceEventName(uint8_t event);
+
+#endif // DEBOUNCE_TRACE_H
@@ -0,0 +1,35 @@
+#ifndef DEBOUNCE_TRACEPOINT_H
+#define DEBOUNCE_TRACEPOINT_H
+
+// ============================================
+// Debouncer tracepoints
+// ============================================
+// Built with APPTECH_DEBOUNCE_TRACE (host builds), each tracepoint costs
+// two loads (the flag pointer, then the flag) and a branch predicted
+// not-taken while tracing is disabled. Without it (the firmware builds) tracepoints compile to
+// nothing and no trace code is pulled in.
+
+#ifdef APPTECH_DEBOUNCE_TRACE
+
+#include "debounce_trace.h"
+
+#if defined(__GNUC__)
+#define DEBOUNCE_TRACE_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#else
+#define DEBOUNCE_TRACE_UNLIKELY(condition) (condition)
+#endif
+
+#define DEBOUNCE_TRACE(event, source, reading, timeMs) do { \
+    std::atomic<uint32_t>* debounceTraceFlag_ = debounceTraceEnabledFlag.load(std::memory_order_acquire); \
+    if (DEBOUNCE_TRACE_UNLIKELY(debounceTraceFlag_->load(std::memory_order_relaxed))) { \
+        debounceTraceRecord((event), (source), static_cast<float>(reading), (timeMs)); \
+    } \
+} while (0)
+
+#else
+
+#define DEBOUNCE_TRACE(event, source, reading, timeMs) do { } while (0)
+
+#endif
+
+#endif // DEBOUNCE_TRACEPOINT_H
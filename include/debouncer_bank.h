@@ -0,0 +1,218 @@
+#ifndef DEBOUNCER_BANK_H
+#define DEBOUNCER_BANK_H
+
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <vector>
+#include "numa_memory.h"
+#include "reading_debouncer.h"
+
+/**
+ * Bank configuration
+ */
+struct DebouncerBankOptions {
+    size_t shards;           // 0 = one shard per allowed CPU
+    HugePageMode hugePages;  // preferred backing for shard memory
+    bool pinThreads;         // pin each shard's worker to its CPU
+
+    DebouncerBankOptions()
+        : shards(0)
+        , hugePages(HUGE_PAGES_TRANSPARENT)
+        , pinThreads(true)
+    {
+    }
+};
+
+/**
+ * A contiguous range of channels owned by one worker
+ */
+template<typename T>
+struct DebouncerShard {
+    size_t index;
+    size_t firstChannel;
+    size_t channelCount;
+    int cpu;                           // CPU the worker runs on
+    int node;                          // NUMA node of that CPU
+    NodeRegion region;                 // backing memory
+    ReadingDebouncer<T>* debouncers;   // channelCount debouncers in region
+
+    ReadingDebouncer<T>& at(size_t channel) { return debouncers[channel - firstChannel]; }
+};
+
+/**
+ * ShardedDebouncerBank - Millions of ReadingDebouncer channels split into
+ * per-worker shards
+ *
+ * Channels are divided into contiguous shards, one per worker thread. Each
+ * worker is pinned to a CPU, its shard is mapped for that CPU's NUMA node
+ * (bound with mbind on multi-node machines) and backed by huge pages when
+ * available, and the debouncers are constructed by the worker itself so
+ * first-touch placement agrees with the binding. Callers route updates to
+ * the shard that owns the channel and run work with runOnShards().
+ *
+ * On single-node machines no binding is attempted; shards still get local
+ * first touch, huge pages and pinned workers.
+ */
+template<typename T>
+class ShardedDebouncerBank {
+public:
+    /**
+     * @param channels - total channels
+     * @param prototype - configuration copied into every channel
+     * @param options - shard count, page backing and pinning
+     */
+    ShardedDebouncerBank(size_t channels, const ReadingDebouncer<T>& prototype,
+                         const DebouncerBankOptions& options = DebouncerBankOptions())
+        : channels_(channels)
+        , prototype_(prototype)
+        , options_(options)
+        , topology_(NumaTopology::detect())
+        , largeShardSize_(0)
+        , largeShards_(0)
+        , initialized_(false)
+    {
+    }
+
+    ~ShardedDebouncerBank() {
+        release();
+    }
+
+    /**
+     * Allocate and construct every shard
+     * @return false if shard memory could not be mapped
+     */
+    bool init() {
+        release();
+        size_t cpuCount = topology_.getCpuCount();
+        size_t shardCount = options_.shards ? options_.shards : (cpuCount ? cpuCount : 1);
+        if (shardCount > channels_ && channels_ > 0) {
+            shardCount = channels_;
+        }
+
+        // Flatten CPUs in node order so consecutive shards fill a node first
+        std::vector<int> cpus;
+        std::vector<int> cpuNodes;
+        for (size_t n = 0; n < topology_.nodes.size(); ++n) {
+            for (size_t c = 0; c < topology_.cpus[n].size(); ++c) {
+                cpus.push_back(topology_.cpus[n][c]);
+                cpuNodes.push_back(topology_.nodes[n]);
+            }
+        }
+        bool bindNodes = topology_.getNodeCount() > 1;
+
+        size_t smallShardSize = channels_ / shardCount;
+        largeShards_ = channels_ % shardCount;
+        largeShardSize_ = smallShardSize + 1;
+
+        shards_.resize(shardCount);
+        size_t nextChannel = 0;
+        for (size_t i = 0; i < shardCount; ++i) {
+            DebouncerShard<T>& shard = shards_[i];
+            shard.index = i;
+            shard.firstChannel = nextChannel;
+            shard.channelCount = i < largeShards_ ? largeShardSize_ : smallShardSize;
+            shard.cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+            shard.node = cpuNodes.empty() ? 0 : cpuNodes[i % cpuNodes.size()];
+            shard.debouncers = NULL;
+            nextChannel += shard.channelCount;
+
+            size_t bytes = shard.channelCount * sizeof(ReadingDebouncer<T>);
+            if (bytes == 0) {
+                continue;
+            }
+            if (!allocateNodeRegion(bytes, bindNodes ? shard.node : -1, options_.hugePages, shard.region)) {
+                release();
+                return false;
+            }
+        }
+
+        // Construct in the owning worker so pages are first touched on its node
+        const ReadingDebouncer<T>& prototype = prototype_;
+        runOnShards([&prototype](DebouncerShard<T>& shard) {
+            ReadingDebouncer<T>* debouncers = static_cast<ReadingDebouncer<T>*>(shard.region.data);
+            for (size_t c = 0; c < shard.channelCount; ++c) {
+                new (&debouncers[c]) ReadingDebouncer<T>(prototype);
+            }
+            shard.debouncers = debouncers;
+        });
+        initialized_ = true;
+        return true;
+    }
+
+    /**
+     * Run fn(shard) for every shard on its own (pinned) worker thread and wait
+     */
+    template<typename Fn>
+    void runOnShards(Fn fn) {
+        std::vector<std::thread> workers;
+        workers.reserve(shards_.size());
+        bool pin = options_.pinThreads;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            DebouncerShard<T>* shard = &shards_[i];
+            workers.push_back(std::thread([shard, pin, &fn]() {
+                if (pin && shard->cpu >= 0) {
+                    pinCurrentThread(shard->cpu);
+                }
+                fn(*shard);
+            }));
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i].join();
+        }
+    }
+
+    /**
+     * Shard owning a channel
+     */
+    size_t shardOf(size_t channel) const {
+        size_t largeChannels = largeShards_ * largeShardSize_;
+        if (channel < largeChannels) {
+            return channel / largeShardSize_;
+        }
+        return largeShards_ + (channel - largeChannels) / (largeShardSize_ - 1);
+    }
+
+    /**
+     * Debouncer of a channel (for callers already running on its shard)
+     */
+    ReadingDebouncer<T>& debouncer(size_t channel) {
+        return shards_[shardOf(channel)].at(channel);
+    }
+
+    size_t getChannelCount() const { return channels_; }
+    size_t getShardCount() const { return shards_.size(); }
+    DebouncerShard<T>& getShard(size_t index) { return shards_[index]; }
+    const NumaTopology& getTopology() const { return topology_; }
+    bool isInitialized() const { return initialized_; }
+
+private:
+    size_t channels_;
+    ReadingDebouncer<T> prototype_;
+    DebouncerBankOptions options_;
+    NumaTopology topology_;
+    std::vector<DebouncerShard<T> > shards_;
+    size_t largeShardSize_;  // shards [0, largeShards_) hold one extra channel
+    size_t largeShards_;
+    bool initialized_;
+
+    void release() {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            DebouncerShard<T>& shard = shards_[i];
+            if (shard.debouncers != NULL) {
+                for (size_t c = 0; c < shard.channelCount; ++c) {
+                    shard.debouncers[c].~ReadingDebouncer<T>();
+                }
+            }
+            freeNodeRegion(shard.region);
+        }
+        shards_.clear();
+        initialized_ = false;
+    }
+
+    // Non-copyable
+    ShardedDebouncerBank(const ShardedDebouncerBank&);
+    ShardedDebouncerBank& operator=(const ShardedDebouncerBank&);
+};
+
+#endif // DEBOUNCER_BANK_H
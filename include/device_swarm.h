@@ -0,0 +1,178 @@
+#ifndef DEVICE_SWARM_H
+#define DEVICE_SWARM_H
+
+#if __cplusplus < 202002L
+#error "device_swarm.h requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <vector>
+
+/**
+ * VirtualEventLoop - Shared virtual clock and timer wheel for coroutines
+ *
+ * Time only moves when run() advances it, so a simulated day takes as long
+ * as the work it contains. Timers live in a hashed wheel with one slot per
+ * millisecond, making schedule and expiry O(1) regardless of device count.
+ */
+class VirtualEventLoop {
+public:
+    /**
+     * Awaitable returned by delay(), the coroutine analogue of Arduino delay()
+     */
+    struct DelayAwaiter {
+        VirtualEventLoop* loop;
+        unsigned long wakeMs;
+
+        bool await_ready() const noexcept { return wakeMs <= loop->nowMs_; }
+        void await_suspend(std::coroutine_handle<> handle) { loop->schedule(handle, wakeMs); }
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * Constructor
+     * @param wheelSlots - wheel size in ms; longer delays wrap around
+     */
+    explicit VirtualEventLoop(unsigned wheelSlots = 4096);
+
+    /**
+     * Current virtual time, the analogue of Arduino millis()
+     */
+    unsigned long millis() const { return nowMs_; }
+
+    /**
+     * Suspend the calling coroutine for a number of virtual milliseconds
+     */
+    DelayAwaiter delay(unsigned long ms) { return DelayAwaiter{this, nowMs_ + ms}; }
+
+    /**
+     * Resume a coroutine at an absolute virtual time
+     */
+    void schedule(std::coroutine_handle<> handle, unsigned long wakeMs);
+
+    /**
+     * Advance the clock, resuming coroutines as their timers expire
+     * @param endMs - virtual time to stop at (exclusive)
+     */
+    void run(unsigned long endMs);
+
+    unsigned long getResumeCount() const { return resumeCount_; }
+    size_t getPendingCount() const { return pendingCount_; }
+
+private:
+    struct Timer {
+        unsigned long wakeMs;
+        std::coroutine_handle<> handle;
+    };
+
+    std::vector<std::vector<Timer> > wheel_;
+    std::vector<Timer> expiring_;
+    unsigned long nowMs_;
+    unsigned long resumeCount_;
+    size_t pendingCount_;
+};
+
+/**
+ * DeviceTask - Owning handle for one virtual device coroutine
+ *
+ * The coroutine starts suspended and runs only when the event loop resumes
+ * it. Device coroutines loop forever; destroying the task frees the frame.
+ */
+class DeviceTask {
+public:
+    struct promise_type {
+        DeviceTask get_return_object() {
+            return DeviceTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    DeviceTask() : handle_(nullptr) {}
+    DeviceTask(DeviceTask&& other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+    DeviceTask& operator=(DeviceTask&& other) noexcept;
+    ~DeviceTask();
+
+    std::coroutine_handle<> handle() const { return handle_; }
+
+private:
+    explicit DeviceTask(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+
+    DeviceTask(const DeviceTask&) = delete;
+    DeviceTask& operator=(const DeviceTask&) = delete;
+};
+
+/**
+ * Output protocol of the virtual devices
+ */
+enum SwarmProtocol {
+    SWARM_PROTOCOL_TEXT,    // Serial lines exactly as the sketches print them
+    SWARM_PROTOCOL_BINARY   // SampleFrame records (sample_frame.h)
+};
+
+/**
+ * Receives every chunk of traffic a virtual device writes
+ */
+class SwarmSink {
+public:
+    virtual ~SwarmSink() {}
+    virtual void onData(uint32_t deviceId, unsigned long timeMs, const uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * Swarm configuration; intervals default to the sketches' config values
+ */
+struct SwarmOptions {
+    unsigned heightMeters;
+    unsigned pulseOximeters;
+    SwarmProtocol protocol;
+    unsigned long heightSampleIntervalMs;   // height_meter.ino loop delay
+    unsigned long oximeterReportPeriodMs;   // pulse_oximeter.ino REPORTING_PERIOD_MS
+    uint32_t seed;
+
+    SwarmOptions();
+};
+
+/**
+ * DeviceSwarm - Many simulated instruments sharing one virtual clock
+ *
+ * Each device is a coroutine replaying its sketch's setup()/loop() timing
+ * against synthetic patients, including the real debounce decisions, so
+ * the emitted traffic has the sketch's shape, rate and stability lines.
+ */
+class DeviceSwarm {
+public:
+    DeviceSwarm(const SwarmOptions& options, SwarmSink* sink);
+
+    /**
+     * Run the swarm until the virtual clock reaches durationMs
+     */
+    void run(unsigned long durationMs);
+
+    unsigned long millis() const { return loop_.millis(); }
+    unsigned long getMessagesSent() const { return messagesSent_; }
+    uint64_t getBytesSent() const { return bytesSent_; }
+    unsigned long getResumeCount() const { return loop_.getResumeCount(); }
+    size_t getDeviceCount() const { return tasks_.size(); }
+
+private:
+    SwarmOptions options_;
+    SwarmSink* sink_;
+    VirtualEventLoop loop_;
+    std::vector<DeviceTask> tasks_;
+    unsigned long messagesSent_;
+    uint64_t bytesSent_;
+
+    DeviceTask heightMeter(uint32_t deviceId, uint32_t seed);
+    DeviceTask pulseOximeter(uint32_t deviceId, uint32_t seed);
+    void send(uint32_t deviceId, const void* data, size_t length);
+};
+
+#endif // DEVICE_SWARM_H
@@ -0,0 +1,397 @@
+#ifndef FFT_BPM_ESTIMATOR_H
+#define FFT_BPM_ESTIMATOR_H
+
+#include <math.h>
+#include <stdint.h>
+
+/**
+ * FixedFft - In-place radix-2 FFT on Q15 integers
+ *
+ * Decimation in time after a bit-reversal permutation, with 16-bit data
+ * and twiddles and 32-bit products. Every stage halves its outputs, so the
+ * result is the DFT divided by SIZE and cannot overflow: no output exceeds
+ * the largest input magnitude. Twiddles come from a quarter-wave sine
+ * table of SIZE / 4 + 1 entries built once, which keeps the Uno variant
+ * at 34 bytes.
+ *
+ * @tparam LOG2_SIZE - log2 of the transform length
+ */
+template<uint8_t LOG2_SIZE>
+class FixedFft {
+public:
+    static_assert(LOG2_SIZE >= 3 && LOG2_SIZE <= 10, "LOG2_SIZE must be 3..10");
+    static const uint16_t SIZE = 1u << LOG2_SIZE;
+
+    FixedFft() {
+        const double step = 2.0 * M_PI / SIZE;
+        for (uint16_t i = 0; i <= SIZE / 4; ++i) {
+            quarter_[i] = static_cast<int16_t>(floor(sin(step * i) * 32767.0 + 0.5));
+        }
+    }
+
+    /**
+     * sin(2 pi k / SIZE) in Q15
+     */
+    int16_t sinQ15(uint16_t k) const {
+        const uint16_t quarter = SIZE / 4;
+        k &= SIZE - 1;
+        if (k <= quarter) {
+            return quarter_[k];
+        }
+        if (k <= 2 * quarter) {
+            return quarter_[2 * quarter - k];
+        }
+        if (k <= 3 * quarter) {
+            return static_cast<int16_t>(-quarter_[k - 2 * quarter]);
+        }
+        return static_cast<int16_t>(-quarter_[4 * quarter - k]);
+    }
+
+    /**
+     * cos(2 pi k / SIZE) in Q15
+     */
+    int16_t cosQ15(uint16_t k) const { return sinQ15(static_cast<uint16_t>(k + SIZE / 4)); }
+
+    /**
+     * Forward transform of re + j im, in place, scaled by 1 / SIZE
+     */
+    void transform(int16_t* re, int16_t* im) const {
+        for (uint16_t i = 1, j = 0; i < SIZE; ++i) {
+            uint16_t bit = SIZE >> 1;
+            for (; j & bit; bit >>= 1) {
+                j ^= bit;
+            }
+            j ^= bit;
+            if (i < j) {
+                int16_t t = re[i];
+                re[i] = re[j];
+                re[j] = t;
+                t = im[i];
+                im[i] = im[j];
+                im[j] = t;
+            }
+        }
+
+        for (uint16_t half = 1; half < SIZE; half <<= 1) {
+            const uint16_t stride = SIZE / (2 * half);
+            for (uint16_t k = 0; k < half; ++k) {
+                // W = cos - j sin
+                const int32_t c = cosQ15(static_cast<uint16_t>(k * stride));
+                const int32_t s = sinQ15(static_cast<uint16_t>(k * stride));
+                for (uint16_t i = k; i < SIZE; i += 2 * half) {
+                    const uint16_t j = i + half;
+                    const int32_t tr = (c * re[j] + s * im[j] + 16384) >> 15;
+                    const int32_t ti = (c * im[j] - s * re[j] + 16384) >> 15;
+                    const int32_t ur = re[i];
+                    const int32_t ui = im[i];
+                    re[j] = static_cast<int16_t>((ur - tr) >> 1);
+                    im[j] = static_cast<int16_t>((ui - ti) >> 1);
+                    re[i] = static_cast<int16_t>((ur + tr) >> 1);
+                    im[i] = static_cast<int16_t>((ui + ti) >> 1);
+                }
+            }
+        }
+    }
+
+private:
+    int16_t quarter_[SIZE / 4 + 1];
+};
+
+/**
+ * FftBpmEstimator - Heart rate from the spectral peak of the IR signal
+ *
+ * The time-domain beat detector of the MAX30100 library needs one clean
+ * threshold crossing per beat; while the finger moves, motion edges are
+ * counted as beats or beats are masked, the rate jumps and bpmDebouncer
+ * never settles. This estimator looks at many beats at once instead:
+ * raw IR samples are averaged down by `decimation`, and every `hop`
+ * decimated samples the last SIZE of them (high-passed at 0.5 Hz as they
+ * come in, against sway and finger pressure drift) are Hann-windowed,
+ * block-normalized to 14 bits and run through FixedFft. The heart rate is
+ * the strongest spectral peak between minBpm and maxBpm, scored together
+ * with its second harmonic (which a pulse wave has and most motion lacks),
+ * refined between bins, and preferring a peak near the previous estimate
+ * while it keeps at least half the winning score. Motion that is short or
+ * outside the band then only lowers the peak's share of the band power.
+ *
+ * getBpm() is the last estimate whose peak held at least minConfidencePct
+ * of the band power in a window whose pulse reached minAmplitude. It drops
+ * to 0 after maxMisses windows in a row below that, the way the beat
+ * detector's rate falls to 0 when beats stop, so it can feed
+ * ReadingDebouncer<float> in place of PulseOximeter::getHeartRate().
+ *
+ * Everything up to the final interpolation is integer arithmetic; RAM is
+ * 3 * 2 * SIZE bytes plus the twiddle table.
+ *
+ * @tparam LOG2_SIZE - log2 of the window length in decimated samples
+ */
+template<uint8_t LOG2_SIZE>
+class FftBpmEstimator {
+public:
+    static const uint16_t SIZE = FixedFft<LOG2_SIZE>::SIZE;
+
+    /**
+     * @param sampleRateHz - rate of addSample() calls (the MAX30100 sample rate)
+     * @param decimation - input samples averaged into one analyzed sample
+     * @param hop - decimated samples between two analyzed windows
+     * @param minBpm, maxBpm - band searched for the peak
+     * @param minAmplitude - smallest pulse, in IR counts, taken for a finger
+     * @param minConfidencePct - share of the band power the peak needs
+     * @param maxMisses - windows below minConfidencePct before getBpm() is 0
+     */
+    FftBpmEstimator(uint16_t sampleRateHz, uint8_t decimation, uint16_t hop, float minBpm, float maxBpm,
+                    uint16_t minAmplitude, uint8_t minConfidencePct, uint8_t maxMisses)
+        : decimation_(decimation > 0 ? decimation : 1)
+        , hop_(hop > 0 ? hop : 1)
+        , minAmplitude_(minAmplitude)
+        , minConfidencePct_(minConfidencePct)
+        , maxMisses_(maxMisses)
+        , bpmPerBin_(60.0f * sampleRateHz / decimation_ / SIZE)
+    {
+        // First-order high-pass at 0.5 Hz: sway and pressure drift stay out of the band
+        const float decimatedHz = static_cast<float>(sampleRateHz) / decimation_;
+        highPassAlpha_ = static_cast<int32_t>(expf(-2.0f * static_cast<float>(M_PI) * 0.5f / decimatedHz) * 32768.0f);
+        float lo = ceilf(minBpm / bpmPerBin_);
+        float hi = floorf(maxBpm / bpmPerBin_);
+        loBin_ = lo < 2.0f ? 2 : static_cast<uint16_t>(lo);   // clear of the window's DC lobe
+        hiBin_ = hi > SIZE / 2 - 2 ? SIZE / 2 - 2 : static_cast<uint16_t>(hi);
+        reset();
+    }
+
+    void reset() {
+        head_ = 0;
+        filled_ = 0;
+        sinceWindow_ = 0;
+        sum_ = 0;
+        summed_ = 0;
+        primed_ = false;
+        lastInput_ = 0;
+        highPass_ = 0;
+        misses_ = 0;
+        windows_ = 0;
+        confidence_ = 0;
+        confident_ = false;
+        bpm_ = 0.0f;
+    }
+
+    /**
+     * Add one raw IR sample
+     * @return true when a window was analyzed (getBpm() may have changed)
+     */
+    bool addSample(uint16_t ir) {
+        sum_ += ir;
+        if (++summed_ < decimation_) {
+            return false;
+        }
+        ring_[head_] = highPass(static_cast<uint16_t>(sum_ / decimation_));
+        head_ = static_cast<uint16_t>((head_ + 1) & (SIZE - 1));
+        sum_ = 0;
+        summed_ = 0;
+        if (filled_ < SIZE) {
+            if (++filled_ < SIZE) {
+                return false;
+            }
+        } else if (++sinceWindow_ < hop_) {
+            return false;
+        }
+        sinceWindow_ = 0;
+        analyze();
+        return true;
+    }
+
+    /**
+     * Heart rate, or 0 while there is no confident estimate
+     */
+    float getBpm() const { return bpm_; }
+
+    /**
+     * Whether the last window's peak was confident
+     */
+    bool isConfident() const { return confident_; }
+
+    /**
+     * Share of the band power in the last window's peak, percent
+     */
+    uint8_t getConfidence() const { return confidence_; }
+
+    unsigned long getWindows() const { return windows_; }
+    float getBpmPerBin() const { return bpmPerBin_; }
+
+    /**
+     * Spectrum of the last window (bins 0 to SIZE / 2), DFT / SIZE after normalization
+     */
+    const int16_t* getReal() const { return re_; }
+    const int16_t* getImag() const { return im_; }
+
+private:
+    FixedFft<LOG2_SIZE> fft_;
+    int16_t ring_[SIZE];      // decimated, high-passed samples; head_ is the oldest
+    int16_t re_[SIZE];
+    int16_t im_[SIZE];
+    uint8_t decimation_;
+    uint16_t hop_;
+    uint16_t minAmplitude_;
+    uint8_t minConfidencePct_;
+    uint8_t maxMisses_;
+    float bpmPerBin_;
+    uint16_t loBin_;
+    uint16_t hiBin_;
+    uint16_t head_;
+    uint16_t filled_;
+    uint16_t sinceWindow_;
+    uint32_t sum_;
+    uint8_t summed_;
+    int32_t highPassAlpha_;   // Q15
+    bool primed_;
+    uint16_t lastInput_;
+    int32_t highPass_;        // Q4
+    uint8_t misses_;
+    unsigned long windows_;
+    uint8_t confidence_;
+    bool confident_;
+    float bpm_;
+
+    int16_t highPass(uint16_t input) {
+        if (!primed_) {
+            lastInput_ = input;
+            primed_ = true;
+        }
+        const int32_t step = static_cast<int32_t>(input) - lastInput_;
+        lastInput_ = input;
+        highPass_ = step * 16 + static_cast<int32_t>((static_cast<int64_t>(highPassAlpha_) * highPass_) >> 15);
+        const int32_t output = highPass_ / 16;
+        return static_cast<int16_t>(output > 32767 ? 32767 : output < -32768 ? -32768 : output);
+    }
+
+    int32_t windowed(uint16_t n, int32_t mean) const {
+        // Hann: (1 - cos(2 pi n / SIZE)) / 2 in Q15
+        const int32_t w = (32767 - static_cast<int32_t>(fft_.cosQ15(n))) >> 1;
+        const int32_t x = static_cast<int32_t>(ring_[(head_ + n) & (SIZE - 1)]) - mean;
+        return (x * w) >> 15;
+    }
+
+    uint32_t power(uint16_t k) const {
+        if (k >= SIZE / 2) {
+            return 0;
+        }
+        return static_cast<uint32_t>(static_cast<int32_t>(re_[k]) * re_[k]) +
+               static_cast<uint32_t>(static_cast<int32_t>(im_[k]) * im_[k]);
+    }
+
+    uint32_t score(uint16_t k) const {
+        return power(k) + (power(static_cast<uint16_t>(2 * k)) >> 1);
+    }
+
+    bool isPeak(uint16_t k) const {
+        uint32_t p = power(k);
+        return p >= power(k - 1) && p >= power(k + 1);
+    }
+
+    void analyze() {
+        windows_++;
+        int32_t total = 0;
+        for (uint16_t n = 0; n < SIZE; ++n) {
+            total += ring_[n];
+        }
+        const int32_t mean = total / static_cast<int32_t>(SIZE);
+
+        // Block floating point: the largest windowed sample gets 14 bits
+        int32_t largest = 0;
+        for (uint16_t n = 0; n < SIZE; ++n) {
+            int32_t v = windowed(n, mean);
+            if (v < 0) {
+                v = -v;
+            }
+            if (v > largest) {
+                largest = v;
+            }
+        }
+        int8_t shift = 0;
+        if (largest >= minAmplitude_ && largest > 0) {
+            while ((largest << shift) < 8192) {
+                shift++;
+            }
+            while (shift <= 0 && (largest >> -shift) > 16383) {
+                shift--;
+            }
+        }
+        for (uint16_t n = 0; n < SIZE; ++n) {
+            int32_t v = windowed(n, mean);
+            re_[n] = static_cast<int16_t>(shift >= 0 ? v * (1L << shift) : v >> -shift);
+            im_[n] = 0;
+        }
+        if (largest < minAmplitude_) {   // no finger: ambient light and sensor noise only
+            miss(0);
+            return;
+        }
+        fft_.transform(re_, im_);
+
+        uint16_t best = 0;
+        uint32_t bestScore = 0;
+        uint32_t bandPower = 0;   // in 1/64ths to stay within 32 bits
+        for (uint16_t k = loBin_; k <= hiBin_; ++k) {
+            bandPower += power(k) >> 6;
+            if (isPeak(k) && score(k) > bestScore) {
+                bestScore = score(k);
+                best = k;
+            }
+        }
+        if (best == 0 || bandPower == 0) {
+            miss(0);
+            return;
+        }
+
+        // Keep following the previous rate while its peak is still strong
+        if (bpm_ > 0.0f) {
+            const float previous = bpm_ / bpmPerBin_;
+            uint16_t tracked = 0;
+            uint32_t trackedScore = 0;
+            for (uint16_t k = loBin_; k <= hiBin_; ++k) {
+                float distance = static_cast<float>(k) - previous;
+                if (distance >= -1.5f && distance <= 1.5f && isPeak(k) && score(k) > trackedScore) {
+                    trackedScore = score(k);
+                    tracked = k;
+                }
+            }
+            if (tracked != 0 && trackedScore >= bestScore / 2) {
+                best = tracked;
+            }
+        }
+
+        uint32_t lobe = (power(best - 1) >> 6) + (power(best) >> 6) + (power(best + 1) >> 6);
+        uint32_t share = static_cast<uint32_t>((static_cast<uint64_t>(lobe) * 100) / bandPower);
+        if (share < minConfidencePct_) {
+            miss(static_cast<uint8_t>(share));
+            return;
+        }
+
+        // Gaussian interpolation between the bins around the peak
+        float a = logf(static_cast<float>(power(best - 1)) + 1.0f);
+        float b = logf(static_cast<float>(power(best)) + 1.0f);
+        float c = logf(static_cast<float>(power(best + 1)) + 1.0f);
+        float denominator = a - 2.0f * b + c;
+        float delta = denominator < 0.0f ? 0.5f * (a - c) / denominator : 0.0f;
+        if (delta > 0.5f) {
+            delta = 0.5f;
+        } else if (delta < -0.5f) {
+            delta = -0.5f;
+        }
+        confidence_ = static_cast<uint8_t>(share > 100 ? 100 : share);
+        confident_ = true;
+        misses_ = 0;
+        bpm_ = (static_cast<float>(best) + delta) * bpmPerBin_;
+    }
+
+    void miss(uint8_t share) {
+        confidence_ = share;
+        confident_ = false;
+        if (misses_ < 255) {
+            misses_++;
+        }
+        if (misses_ >= maxMisses_) {
+            bpm_ = 0.0f;
+        }
+    }
+};
+
+#endif // FFT_BPM_ESTIMATOR_H
@@ -11,6 +11,20 @@
  */
 class HeightDebouncer {
 public:
+    /**
+     * Everything update() has learned, so a debouncer can be moved to
+     * another process without restarting its stability timer
+     */
+    struct Checkpoint {
+        int toleranceCm;                // may have been adapted
+        int lastReading;
+        int stableReading;
+        unsigned long stabilityStartTime;
+        unsigned long lastSampleTime;
+        bool isStable;
+        bool hasReading;
+    };
+
     /**
      * Constructor with configurable parameters
      * @param toleranceCm - readings within this range are considered equal
@@ -49,17 +63,42 @@ public:
      */
     int getLastReading() const;
 
+    /**
+     * Check if we have any reading since construction or reset
+     */
+    bool hasValidReading() const;
+
     /**
      * Get how long the current reading has been stable (in ms)
      * @return duration in milliseconds
      */
     unsigned long getStableDuration() const;
 
+    /**
+     * Get the time of the last sample that was not skipped
+     */
+    unsigned long getLastSampleTime() const;
+
     /**
      * Reset the debouncer state
      */
     void reset();
 
+    /**
+     * Capture the state for restore() on a debouncer with the same configuration
+     */
+    Checkpoint getCheckpoint() const;
+
+    /**
+     * Continue from a checkpoint as if its samples had been fed here
+     */
+    void restore(const Checkpoint& checkpoint);
+
+    /**
+     * Change the tolerance (adaptive mode); takes effect on the next sample
+     */
+    void setToleranceCm(int toleranceCm) { toleranceCm_ = toleranceCm; }
+
     // Getters for configuration
     int getToleranceCm() const { return toleranceCm_; }
     unsigned long getStabilityDurationMs() const { return stabilityDurationMs_; }
@@ -0,0 +1,130 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "i2c_trace.h"
+
+// Wire endTransmission() status codes
+#define I2C_STATUS_OK 0
+#define I2C_STATUS_ADDRESS_NACK 2
+#define I2C_STATUS_DATA_NACK 3
+
+/**
+ * Time source the bus charges transfer time to (the host HAL's virtual clock)
+ */
+class I2cBusClock {
+public:
+    virtual ~I2cBusClock() {}
+    virtual unsigned long long nowUs() const = 0;
+    virtual void advanceUs(unsigned long long us) = 0;
+};
+
+/**
+ * A device (or device model) answering at one bus address
+ */
+class I2cDevice {
+public:
+    virtual ~I2cDevice() {}
+
+    /**
+     * Bytes written in one transaction (possibly none: an address probe)
+     * @return false to NACK the data
+     */
+    virtual bool onWrite(const uint8_t* data, size_t length) = 0;
+
+    /**
+     * Fill up to length bytes for a read
+     * @return number of bytes supplied
+     */
+    virtual size_t onRead(uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * I2cBus - Host model of one I2C bus
+ *
+ * Routes transactions to the devices attached at each address, records
+ * them to an optional I2cTrace and charges their transfer time at the
+ * configured bus clock. Unattached addresses NACK like an empty bus.
+ */
+class I2cBus {
+public:
+    I2cBus();
+
+    void attach(uint8_t address, I2cDevice* device);
+    void detach(uint8_t address);
+    void detachAll();
+
+    /**
+     * Record every transaction to trace (NULL stops recording)
+     */
+    void setRecorder(I2cTrace* trace) { recorder_ = trace; }
+    I2cTrace* getRecorder() const { return recorder_; }
+
+    void setClock(I2cBusClock* clock) { clock_ = clock; }
+    void setFrequencyHz(unsigned long hz) { frequencyHz_ = hz > 0 ? hz : 100000; }
+    unsigned long getFrequencyHz() const { return frequencyHz_; }
+
+    /**
+     * One write transaction
+     * @param stop - false for a repeated start (endTransmission(false))
+     * @return Wire status (I2C_STATUS_*)
+     */
+    uint8_t write(uint8_t address, const uint8_t* data, size_t length, bool stop);
+
+    /**
+     * One read transaction
+     * @return bytes received (0 if nothing answers at address)
+     */
+    size_t read(uint8_t address, uint8_t* data, size_t length);
+
+    /**
+     * The firmware entered its next loop() (forwarded to the recorder)
+     */
+    void markLoop();
+
+    unsigned long getTransactionCount() const { return transactions_; }
+
+private:
+    I2cDevice* devices_[128];
+    I2cTrace* recorder_;
+    I2cBusClock* clock_;
+    unsigned long frequencyHz_;
+    unsigned long transactions_;
+
+    unsigned long long begin();
+    void charge(size_t bytes);
+};
+
+/**
+ * I2cReplayDevice - Answers reads at one address from a captured trace
+ *
+ * Responses are returned in the order they were captured, so a firmware
+ * build under test sees exactly the sensor data the recorded run saw.
+ * Writes are accepted. Reads whose length differs from the captured one
+ * are counted as mismatches (the firmware's access pattern changed).
+ */
+class I2cReplayDevice : public I2cDevice {
+public:
+    I2cReplayDevice(const I2cTrace& trace, uint8_t address);
+
+    virtual bool onWrite(const uint8_t* data, size_t length);
+    virtual size_t onRead(uint8_t* data, size_t length);
+
+    size_t getResponseCount() const { return responses_.size(); }
+    size_t getRemaining() const { return responses_.size() - next_; }
+    unsigned long getMismatches() const { return mismatches_; }
+
+    /**
+     * Addresses that acknowledged at least one transaction in a trace
+     */
+    static std::vector<uint8_t> respondingAddresses(const I2cTrace& trace);
+
+private:
+    std::vector<std::vector<uint8_t> > responses_;
+    size_t next_;
+    unsigned long mismatches_;
+};
+
+#endif // I2C_BUS_H
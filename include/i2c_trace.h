@@ -0,0 +1,111 @@
+#ifndef I2C_TRACE_H
+#define I2C_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * Direction of an I2C transaction
+ */
+enum I2cTransactionType {
+    I2C_WRITE = 0,
+    I2C_READ = 1
+};
+
+/**
+ * One bus transaction as the firmware issued it through Wire
+ *
+ * Writes carry the bytes sent and the endTransmission() status (0 = ACK,
+ * 2 = address NACK); reads carry the number of bytes requested and the
+ * bytes the device returned.
+ */
+struct I2cTransaction {
+    unsigned long long timeUs;   // start of the transaction, host clock
+    unsigned long loop;          // 0 during setup(), n during the nth loop()
+    uint8_t address;
+    uint8_t type;                // I2cTransactionType
+    uint8_t status;              // writes: Wire status; reads: 0
+    bool stop;                   // writes: false for a repeated start
+    uint16_t requested;          // reads: bytes asked for
+    std::vector<uint8_t> bytes;
+};
+
+/**
+ * I2cTrace - Ordered record of every transaction of a firmware run
+ *
+ * Saved as text, one transaction per line, so traces from two firmware
+ * versions can also be compared with ordinary diff tools:
+ *
+ *   # apptech-i2c-trace 1
+ *   L 1
+ *   W <timeUs> <addr> <stop> <status> <hex bytes...>
+ *   R <timeUs> <addr> <requested> <hex bytes...>
+ */
+class I2cTrace {
+public:
+    I2cTrace();
+
+    void add(const I2cTransaction& transaction);
+
+    /**
+     * Start the next loop() iteration; later transactions belong to it
+     */
+    void markLoop();
+
+    void clear();
+
+    size_t size() const { return transactions_.size(); }
+    const I2cTransaction& at(size_t index) const { return transactions_[index]; }
+    unsigned long getLoopCount() const { return loops_; }
+
+    /**
+     * @return false on I/O error
+     */
+    bool save(const char* path) const;
+
+    /**
+     * Replace the trace with one read from a file
+     * @return false on I/O error or a malformed line (the trace is left empty)
+     */
+    bool load(const char* path);
+
+private:
+    std::vector<I2cTransaction> transactions_;
+    unsigned long loops_;
+};
+
+/**
+ * Traffic to one address
+ */
+struct I2cAddressStats {
+    unsigned long transactions;
+    unsigned long long bytes;       // payload bytes (excluding the address byte)
+    unsigned long long busBits;     // bits on the wire: start, address, data, ACKs, stop
+};
+
+/**
+ * I2cTraceStats - Bus traffic of a trace, split into setup and loop()
+ */
+struct I2cTraceStats {
+    unsigned long loops;
+    I2cAddressStats setup;
+    I2cAddressStats perLoop;                       // all loop() traffic
+    std::map<uint8_t, I2cAddressStats> byAddress;  // loop() traffic per address
+    unsigned long long maxLoopBytes;               // busiest single loop()
+    unsigned long maxLoopTransactions;
+
+    I2cTraceStats();
+
+    /**
+     * Summarize a trace
+     */
+    void compute(const I2cTrace& trace);
+
+    double getTransactionsPerLoop() const;
+    double getBytesPerLoop() const;
+    double getBusBitsPerLoop() const;
+};
+
+#endif // I2C_TRACE_H
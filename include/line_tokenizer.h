@@ -0,0 +1,100 @@
+#ifndef LINE_TOKENIZER_H
+#define LINE_TOKENIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "trace_sample.h"
+
+/**
+ * LogColumns - Parsed samples as struct-of-arrays, one pair of columns per
+ * channel
+ *
+ * Channel numbers equal the APPTECH_KIND_* debouncer kinds, so
+ * values[k].data() and timesMs[k].data() go straight into
+ * apptech_debouncer_update() for a debouncer of kind k.
+ */
+struct LogColumns {
+    std::vector<uint64_t> timesMs[SAMPLE_CHANNEL_COUNT];
+    std::vector<double> values[SAMPLE_CHANNEL_COUNT];
+
+    size_t size(uint8_t channel) const { return channel < SAMPLE_CHANNEL_COUNT ? values[channel].size() : 0; }
+
+    /**
+     * Empty the columns, keeping their capacity for the next block
+     */
+    void clear();
+};
+
+/**
+ * LineTokenizer - Vectorized parser for the instruments' serial logs
+ *
+ * Parses the same two line formats as TraceParser, to the same values, but
+ * into columns instead of a per-sample callback. Newlines and digits are
+ * found 64 bytes at a time as bitmasks (AVX2 or SSE2 compares where the
+ * build targets them, 8-byte SWAR words otherwise), so each field's length
+ * is a bit count; digit runs are converted 8 digits at a time with SWAR
+ * arithmetic. Lines split across blocks are carried over as in TraceParser.
+ */
+class LineTokenizer {
+public:
+    /**
+     * @param heightIntervalMs - synthesized time step between height lines
+     */
+    explicit LineTokenizer(unsigned long heightIntervalMs);
+
+    /**
+     * Constructor using DEBOUNCE_SAMPLE_INTERVAL_MS as the height time step
+     */
+    LineTokenizer();
+
+    /**
+     * Parse a block of log text, appending its samples to out
+     * @param data - block contents, need not end on a line boundary
+     * @param length - block length in bytes
+     */
+    void feed(const char* data, size_t length, LogColumns& out);
+
+    /**
+     * Parse any trailing line that was not newline-terminated
+     */
+    void finish(LogColumns& out);
+
+    /**
+     * Reset the tokenizer to its initial state
+     */
+    void reset();
+
+    unsigned long getLinesParsed() const { return linesParsed_; }
+    unsigned long getLinesSkipped() const { return linesSkipped_; }
+
+    /**
+     * Line scanner compiled in: "avx2", "sse2" or "swar"
+     */
+    static const char* getScanBackend();
+
+private:
+    unsigned long heightIntervalMs_;
+    unsigned long nextHeightTimeMs_;
+    unsigned long linesParsed_;
+    unsigned long linesSkipped_;
+    std::string carry_;
+
+    // digits: bit i set where begin[i] is a digit, for the first 64 bytes
+    void parseLine(const char* begin, const char* end, const char* limit, uint64_t digits, LogColumns& out);
+};
+
+/**
+ * Bit i set where block[i] == '\n', for the 64 bytes at block
+ */
+uint64_t lineTokenizerNewlineMask(const char* block);
+
+/**
+ * Parse the decimal digit run at p (at most up to end; bytes up to limit
+ * may be read), modulo 2^64 like the scalar loop
+ * @return the first byte after the digits, or NULL if there were none
+ */
+const char* lineTokenizerParseUnsigned(const char* p, const char* end, const char* limit, uint64_t* value);
+
+#endif // LINE_TOKENIZER_H
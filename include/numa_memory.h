@@ -0,0 +1,77 @@
+#ifndef NUMA_MEMORY_H
+#define NUMA_MEMORY_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * How a node-local region is backed
+ */
+enum HugePageMode {
+    HUGE_PAGES_NONE = 0,     // regular 4 KiB pages
+    HUGE_PAGES_TRANSPARENT,  // madvise(MADV_HUGEPAGE), kernel assembles 2 MiB pages
+    HUGE_PAGES_EXPLICIT      // MAP_HUGETLB from the reserved hugetlbfs pool
+};
+
+/**
+ * NUMA nodes and the CPUs this process may run on
+ *
+ * Built from /sys/devices/system/node and the thread's affinity mask.
+ * Machines without that information (or non-Linux hosts) report a single
+ * node 0 holding every allowed CPU.
+ */
+struct NumaTopology {
+    std::vector<int> nodes;                  // node ids with at least one allowed CPU
+    std::vector<std::vector<int> > cpus;     // allowed CPUs per entry of nodes
+
+    static NumaTopology detect();
+
+    size_t getNodeCount() const { return nodes.size(); }
+    size_t getCpuCount() const;
+};
+
+/**
+ * A page-aligned region allocated for one NUMA node
+ */
+struct NodeRegion {
+    void* data;
+    size_t length;           // mapped bytes (rounded up to the page size used)
+    int node;                // node the pages are bound to, or -1 if unbound
+    HugePageMode hugePages;  // backing actually obtained
+
+    NodeRegion() : data(NULL), length(0), node(-1), hugePages(HUGE_PAGES_NONE) {}
+};
+
+/**
+ * Map an anonymous region for a node
+ *
+ * Explicit huge pages fall back to transparent ones when the hugetlb pool
+ * is empty, and transparent ones to regular pages when THP is disabled.
+ * The pages are bound to the node with mbind(); if binding is refused (or
+ * not requested) placement is left to first touch, so callers should touch
+ * the region from a thread running on that node.
+ * @param bytes - region size
+ * @param node - target node id, or -1 for no binding (single-node machines)
+ * @param hugePages - preferred backing
+ * @param region - receives the mapping
+ * @return false if no memory could be mapped
+ */
+bool allocateNodeRegion(size_t bytes, int node, HugePageMode hugePages, NodeRegion& region);
+
+/**
+ * Unmap a region returned by allocateNodeRegion()
+ */
+void freeNodeRegion(NodeRegion& region);
+
+/**
+ * Pin the calling thread to one CPU
+ * @return false if the platform refuses or lacks thread affinity
+ */
+bool pinCurrentThread(int cpu);
+
+/**
+ * Short name of a backing mode for reports
+ */
+const char* hugePageModeName(HugePageMode mode);
+
+#endif // NUMA_MEMORY_H
@@ -0,0 +1,85 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+
+/**
+ * Hardware events collected around benchmark cases
+ */
+enum PerfEvent {
+    PERF_EVENT_CYCLES = 0,
+    PERF_EVENT_INSTRUCTIONS,
+    PERF_EVENT_BRANCH_MISSES,
+    PERF_EVENT_CACHE_MISSES,
+    PERF_EVENT_DTLB_MISSES,
+    PERF_EVENT_COUNT
+};
+
+/**
+ * Counter values for one measured region
+ *
+ * Values are scaled for multiplexing; valid[i] is false when the event
+ * could not be opened or never got scheduled on a PMU.
+ */
+struct PerfSample {
+    uint64_t values[PERF_EVENT_COUNT];
+    bool valid[PERF_EVENT_COUNT];
+};
+
+/**
+ * PerfCounters - Per-thread hardware counters via Linux perf_event_open
+ *
+ * The events are opened as one group led by cycles (user space only), so
+ * the PMU schedules them together and every ratio in a sample covers the
+ * same instructions. An event the PMU cannot add to the group is opened on
+ * its own instead, so a PMU that lacks one event still reports the others.
+ * Threads created and joined between start() and stop() are included in
+ * the counts. On non-Linux builds, inside VMs without a virtual PMU, or
+ * when perf_event_paranoid forbids access, open() returns false and every
+ * sample is marked invalid.
+ */
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    /**
+     * Open the counters for the calling thread
+     * @return true if at least one event is available
+     */
+    bool open();
+
+    /**
+     * Close all counters
+     */
+    void close();
+
+    bool isAvailable(PerfEvent event) const { return fds_[event] >= 0; }
+    bool isAnyAvailable() const;
+
+    /**
+     * Reset and start counting
+     */
+    void start();
+
+    /**
+     * Stop counting and read the values accumulated since start()
+     */
+    PerfSample stop();
+
+    /**
+     * Short name of an event for report headers
+     */
+    static const char* eventName(PerfEvent event);
+
+private:
+    int fds_[PERF_EVENT_COUNT];
+    bool grouped_[PERF_EVENT_COUNT];  // Member of the group led by leader_
+    int leader_;                      // Group leader fd, -1 when no group formed
+
+    // Non-copyable
+    PerfCounters(const PerfCounters&);
+    PerfCounters& operator=(const PerfCounters&);
+};
+
+#endif // PERF_COUNTERS_H
@@ -2,6 +2,7 @@
 #define READING_DEBOUNCER_H
 
 #include <cmath>
+#include "debounce_tracepoint.h"
 
 /**
  * ReadingDebouncer - Generic debouncer for sensor readings
@@ -13,6 +14,21 @@
 template<typename T>
 class ReadingDebouncer {
 public:
+    /**
+     * Everything update() has learned, so a debouncer can be moved to
+     * another process without restarting its stability timer
+     */
+    struct Checkpoint {
+        T tolerance;                    // may have been adapted
+        T lastReading;
+        T stableReading;
+        unsigned long stabilityStartTime;
+        unsigned long lastSampleTime;
+        bool isStable;
+        bool hasReading;
+        bool lastReadingValid;
+    };
+
     /**
      * Constructor with configurable parameters
      * @param tolerance - readings within this range are considered equal
@@ -46,6 +62,7 @@ public:
     void update(T currentReading, unsigned long currentTimeMs) {
         // Check if enough time has passed since last sample
         if (hasReading_ && (currentTimeMs - lastSampleTime_) < sampleIntervalMs_) {
+            DEBOUNCE_TRACE(DEBOUNCE_TRACE_INTERVAL_SKIP, this, currentReading, currentTimeMs);
             return; // Too soon, skip this sample
         }
 
@@ -57,6 +74,7 @@ public:
 
         if (!isValid) {
             // Invalid reading resets stability
+            DEBOUNCE_TRACE(DEBOUNCE_TRACE_INVALID_RESET, this, currentReading, currentTimeMs);
             reset();
             return;
         }
@@ -67,6 +85,7 @@ public:
             stabilityStartTime_ = currentTimeMs;
             hasReading_ = true;
             isStable_ = false;
+            DEBOUNCE_TRACE(DEBOUNCE_TRACE_FIRST_READING, this, currentReading, currentTimeMs);
             return;
         }
 
@@ -76,11 +95,15 @@ public:
             unsigned long stableDuration = currentTimeMs - stabilityStartTime_;
             
             if (stableDuration >= stabilityDurationMs_) {
+                if (!isStable_) {
+                    DEBOUNCE_TRACE(DEBOUNCE_TRACE_STABLE, this, currentReading, currentTimeMs);
+                }
                 isStable_ = true;
                 stableReading_ = currentReading;
             }
         } else {
             // Reading changed significantly, reset stability timer
+            DEBOUNCE_TRACE(DEBOUNCE_TRACE_TOLERANCE_RESET, this, currentReading, currentTimeMs);
             stabilityStartTime_ = currentTimeMs;
             isStable_ = false;
         }
@@ -124,6 +147,13 @@ public:
         return hasReading_;
     }
 
+    /**
+     * Get the time of the last sample that was not skipped
+     */
+    unsigned long getLastSampleTime() const {
+        return lastSampleTime_;
+    }
+
     /**
      * Reset the debouncer state
      */
@@ -137,6 +167,43 @@ public:
         lastReadingValid_ = false;
     }
 
+    /**
+     * Capture the state for restore() on a debouncer with the same configuration
+     */
+    Checkpoint getCheckpoint() const {
+        Checkpoint checkpoint;
+        checkpoint.tolerance = tolerance_;
+        checkpoint.lastReading = lastReading_;
+        checkpoint.stableReading = stableReading_;
+        checkpoint.stabilityStartTime = stabilityStartTime_;
+        checkpoint.lastSampleTime = lastSampleTime_;
+        checkpoint.isStable = isStable_;
+        checkpoint.hasReading = hasReading_;
+        checkpoint.lastReadingValid = lastReadingValid_;
+        return checkpoint;
+    }
+
+    /**
+     * Continue from a checkpoint as if its samples had been fed here
+     */
+    void restore(const Checkpoint& checkpoint) {
+        tolerance_ = checkpoint.tolerance;
+        lastReading_ = checkpoint.lastReading;
+        stableReading_ = checkpoint.stableReading;
+        stabilityStartTime_ = checkpoint.stabilityStartTime;
+        lastSampleTime_ = checkpoint.lastSampleTime;
+        isStable_ = checkpoint.isStable;
+        hasReading_ = checkpoint.hasReading;
+        lastReadingValid_ = checkpoint.lastReadingValid;
+    }
+
+    /**
+     * Change the tolerance (adaptive mode); takes effect on the next sample
+     */
+    void setTolerance(T tolerance) {
+        tolerance_ = tolerance;
+    }
+
     // Getters for configuration
     T getTolerance() const { return tolerance_; }
     unsigned long getStabilityDurationMs() const { return stabilityDurationMs_; }
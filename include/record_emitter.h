@@ -0,0 +1,164 @@
+#ifndef RECORD_EMITTER_H
+#define RECORD_EMITTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "trace_sample.h"
+
+/**
+ * ReadingRecord - One reading with the debouncer's verdict, for export
+ */
+struct ReadingRecord {
+    uint32_t deviceId;
+    unsigned long timeMs;
+    float value;
+    uint8_t channel;
+    bool stable;
+    bool valid;
+};
+
+/**
+ * Field types understood by the emitters
+ */
+enum FieldKind {
+    FIELD_UINT32,
+    FIELD_ULONG,
+    FIELD_FLOAT,
+    FIELD_CHANNEL,   // uint8_t SampleChannel, written as its name
+    FIELD_BOOL
+};
+
+/**
+ * One column of a record schema: name, type and offset within the struct
+ */
+struct FieldSpec {
+    const char* name;
+    FieldKind kind;
+    size_t offset;
+};
+
+/**
+ * Describes how a record struct maps to output columns
+ */
+struct RecordSchema {
+    const FieldSpec* fields;
+    size_t fieldCount;
+};
+
+extern const RecordSchema kReadingRecordSchema;
+extern const RecordSchema kTransitionRecordSchema;
+
+/**
+ * Receives completed output chunks
+ */
+class ChunkSink {
+public:
+    virtual ~ChunkSink() {}
+    virtual void onChunk(const char* data, size_t length) = 0;
+};
+
+/**
+ * RecordEmitter - Formats records into a caller-provided buffer
+ *
+ * Never allocates. Before each record, room for the schema's worst case
+ * (maxRecordSize) is reserved; when it might not fit, the filled part of
+ * the buffer is handed to the chunk sink and writing restarts at the front.
+ * Without a sink, emit() returns false once the buffer is full and the
+ * caller drains it with data()/size()/clear(). A schema whose worst case
+ * exceeds the whole buffer is always refused.
+ */
+class RecordEmitter {
+public:
+    virtual ~RecordEmitter() {}
+
+    /**
+     * Write one record described by a schema
+     * @return false if the record did not fit and there is no sink, or
+     *         the schema's worst case is larger than the buffer
+     */
+    bool emit(const RecordSchema& schema, const void* record);
+
+    /**
+     * Largest number of bytes a record of this schema can occupy
+     */
+    virtual size_t maxRecordSize(const RecordSchema& schema) const = 0;
+
+    bool emitReading(const ReadingRecord& record) { return emit(kReadingRecordSchema, &record); }
+    bool emitTransition(const StabilityTransition& transition) { return emit(kTransitionRecordSchema, &transition); }
+
+    /**
+     * Hand any buffered output to the sink
+     */
+    void flush();
+
+    const char* data() const { return buffer_; }
+    size_t size() const { return length_; }
+    void clear() { length_ = 0; }
+
+protected:
+    RecordEmitter(char* buffer, size_t capacity, ChunkSink* sink);
+
+    char* buffer_;
+    size_t capacity_;
+    size_t length_;
+    ChunkSink* sink_;
+
+    /**
+     * Make room for up to length bytes
+     */
+    bool reserve(size_t length);
+
+    /**
+     * Format a record at buffer_ + length_; space is already reserved
+     */
+    virtual void write(const RecordSchema& schema, const void* record) = 0;
+
+    void writeField(const FieldSpec& field, const void* record, bool quoteStrings);
+    static size_t maxFieldSize(const FieldSpec& field, bool quoteStrings);
+    void append(const char* text, size_t length);
+};
+
+/**
+ * JsonEmitter - Newline-delimited JSON, one object per record
+ */
+class JsonEmitter : public RecordEmitter {
+public:
+    JsonEmitter(char* buffer, size_t capacity, ChunkSink* sink);
+
+    virtual size_t maxRecordSize(const RecordSchema& schema) const;
+
+protected:
+    virtual void write(const RecordSchema& schema, const void* record);
+};
+
+/**
+ * CsvEmitter - Comma-separated values with a header row
+ */
+class CsvEmitter : public RecordEmitter {
+public:
+    CsvEmitter(char* buffer, size_t capacity, ChunkSink* sink);
+
+    /**
+     * Write the column names of a schema
+     */
+    bool emitHeader(const RecordSchema& schema);
+
+    virtual size_t maxRecordSize(const RecordSchema& schema) const;
+
+protected:
+    virtual void write(const RecordSchema& schema, const void* record);
+};
+
+/**
+ * Format an unsigned integer
+ * @return number of characters written (at most 20)
+ */
+size_t formatUnsigned(uint64_t value, char* out);
+
+/**
+ * Format a float as the shortest decimal that reads back to the same value
+ * @return number of characters written (at most 16), 0 for NaN or infinity
+ */
+size_t formatShortestFloat(float value, char* out);
+
+#endif // RECORD_EMITTER_H
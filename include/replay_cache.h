@@ -0,0 +1,317 @@
+#ifndef REPLAY_CACHE_H
+#define REPLAY_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "height_debouncer.h"
+#include "reading_debouncer.h"
+#include "trace_parser.h"
+#include "trace_reader.h"
+#include "trace_replayer.h"
+#include "trace_sample.h"
+
+/**
+ * Replay state at a block boundary: the debouncers and the parser's
+ * synthesized height clock (lines are whole, so nothing else carries over)
+ */
+struct ReplayBoundary {
+    HeightDebouncer::Checkpoint height;
+    ReadingDebouncer<float>::Checkpoint bpm;
+    ReadingDebouncer<int>::Checkpoint spo2;
+    unsigned long nextHeightTimeMs;
+};
+
+/**
+ * A transition or stable update of a cached block, without its device id
+ */
+struct ReplayCacheRecord {
+    unsigned long timeMs;
+    float value;
+    uint8_t channel;
+    bool stable;
+    bool update;   // onStableUpdate() rather than onTransition()
+};
+
+/**
+ * A block is identified by its bytes, the debouncer configuration and the
+ * state it was entered with; equal keys replay to equal results
+ */
+struct ReplayCacheKey {
+    uint64_t content;
+    uint64_t config;
+    uint64_t entry;
+    uint32_t length;
+
+    bool operator==(const ReplayCacheKey& other) const {
+        return content == other.content && config == other.config && entry == other.entry &&
+               length == other.length;
+    }
+};
+
+/**
+ * What replaying one block produced
+ */
+struct ReplayCacheEntry {
+    ReplayBoundary end;
+    std::vector<ReplayCacheRecord> records;   // in replay order
+    uint32_t samples;
+    uint32_t transitions;
+    uint32_t linesParsed;
+    uint32_t linesSkipped;
+    uint32_t lastUsedRun;
+};
+
+/**
+ * What tells an unchanged file from a changed one without reading it
+ */
+struct ReplayFileStamp {
+    uint64_t size;
+    uint64_t inode;
+    int64_t mtimeNs;
+
+    bool operator==(const ReplayFileStamp& other) const {
+        return size == other.size && inode == other.inode && mtimeNs == other.mtimeNs;
+    }
+};
+
+/**
+ * A file's last replay: its stamp then and its blocks in order
+ */
+struct ReplayCacheFile {
+    ReplayFileStamp stamp;
+    std::vector<ReplayCacheKey> blocks;
+    uint32_t lastUsedRun;
+};
+
+/**
+ * Cache and block configuration
+ */
+struct ReplayCacheOptions {
+    size_t minBlockBytes;    // no cut before this many bytes
+    size_t maxBlockBytes;    // always cut once a block reaches this
+    unsigned cutBits;        // cut after a line whose hash has these low bits clear (2^bits lines on average)
+    unsigned maxIdleRuns;    // save() drops entries not used in this many runs
+
+    ReplayCacheOptions()
+        : minBlockBytes(16 * 1024)
+        , maxBlockBytes(1024 * 1024)
+        , cutBits(10)
+        , maxIdleRuns(8)
+    {
+    }
+};
+
+/**
+ * Hash of a debouncer configuration, as used in ReplayCacheKey::config
+ */
+uint64_t replayConfigHash(const HeightDebouncer& height, const ReadingDebouncer<float>& bpm,
+                          const ReadingDebouncer<int>& spo2, unsigned long heightIntervalMs);
+
+/**
+ * Hash of a boundary, as used in ReplayCacheKey::entry
+ */
+uint64_t replayBoundaryHash(const ReplayBoundary& boundary);
+
+/**
+ * Stamp of a regular file; false for anything else or if stat() fails
+ */
+bool replayFileStamp(const std::string& path, ReplayFileStamp& stamp);
+
+/**
+ * ReplayCache - Per-block replay results, kept between runs in one file
+ *
+ * Entries are looked up by ReplayCacheKey. A run that changes nothing is
+ * served entirely from the cache; an edited or appended log recomputes
+ * the blocks it touched, and the blocks after them until the recomputed
+ * state matches a cached boundary again. Files are also remembered by
+ * path and stamp (as make and git do), so an untouched file is served
+ * without being read or hashed. Each load() starts a new run; save()
+ * drops entries and files idle for more than maxIdleRuns runs.
+ */
+class ReplayCache {
+public:
+    explicit ReplayCache(const ReplayCacheOptions& options = ReplayCacheOptions());
+
+    /**
+     * Cached result of a block, or NULL; a hit marks the entry used
+     */
+    const ReplayCacheEntry* find(const ReplayCacheKey& key);
+
+    /**
+     * Store the result of a block replayed in this run
+     */
+    void insert(const ReplayCacheKey& key, const ReplayCacheEntry& entry);
+
+    /**
+     * Blocks of a file last replayed with this configuration, or NULL if
+     * there are none or the file's stamp changed; a hit marks the file used
+     */
+    const ReplayCacheFile* findFile(const std::string& path, uint64_t config, const ReplayFileStamp& stamp);
+
+    /**
+     * Store the blocks of a file read completely in this run
+     */
+    void insertFile(const std::string& path, uint64_t config, const ReplayCacheFile& file);
+
+    /**
+     * Write the cache to a file (through a temporary file and rename)
+     */
+    bool save(const char* path) const;
+
+    /**
+     * Replace the contents with a saved cache; false (and empty) if the
+     * file is missing, truncated or of another format
+     */
+    bool load(const char* path);
+
+    void clear();
+
+    const ReplayCacheOptions& getOptions() const { return options_; }
+    size_t getEntryCount() const { return entries_.size(); }
+    size_t getFileCount() const { return files_.size(); }
+
+    /**
+     * Check whether anything was inserted since the last load() or clear()
+     * (a run that only hit the cache need not be saved)
+     */
+    bool isModified() const { return modified_; }
+    uint64_t getHits() const { return hits_; }
+    uint64_t getMisses() const { return misses_; }
+
+private:
+    struct KeyHash {
+        size_t operator()(const ReplayCacheKey& key) const {
+            return static_cast<size_t>(key.content ^ key.entry ^ (key.config * 31));
+        }
+    };
+
+    ReplayCacheOptions options_;
+    std::unordered_map<ReplayCacheKey, ReplayCacheEntry, KeyHash> entries_;
+    std::map<std::pair<std::string, uint64_t>, ReplayCacheFile> files_;   // by path and config hash
+    uint32_t run_;
+    uint64_t hits_;
+    uint64_t misses_;
+    bool modified_;
+};
+
+/**
+ * CachedTraceFileReplay - TraceFileReplay that reuses cached blocks
+ *
+ * Each file is cut into blocks of whole lines at content-defined points
+ * (a line whose hash has ReplayCacheOptions::cutBits low bits clear), so
+ * the blocks do not depend on the reader's block size and an edit only
+ * moves the cuts next to it. A cached block's transitions are re-emitted
+ * with the file's device id and its end state is carried to the next
+ * block; a block that misses is parsed and replayed from that state.
+ * run() first replays the files whose stamp is unchanged straight from
+ * the cache and reads only the rest.
+ *
+ * Transitions, stable updates and counters match TraceFileReplay. Event
+ * sinks and adaptive tolerance need every sample and are not supported.
+ */
+class CachedTraceFileReplay : public TraceBlockHandler {
+public:
+    /**
+     * Constructor with explicit debouncer configurations
+     * @param cache - block results, read and extended by the replay
+     */
+    CachedTraceFileReplay(const HeightDebouncer& height, const ReadingDebouncer<float>& bpm,
+                          const ReadingDebouncer<int>& spo2, StabilityTransitionSink* sink, ReplayCache* cache);
+
+    /**
+     * Constructor using config.h values
+     */
+    CachedTraceFileReplay(StabilityTransitionSink* sink, ReplayCache* cache);
+
+    virtual ~CachedTraceFileReplay();
+
+    virtual void onBlock(size_t fileIndex, const char* data, size_t length);
+    virtual void onFileEnd(size_t fileIndex);
+
+    /**
+     * Replay files through the reader, skipping unchanged ones
+     * @param paths - files to replay; the device id is the position here
+     * @return true if every file was replayed completely
+     */
+    bool run(AsyncTraceReader& reader, const std::vector<std::string>& paths);
+
+    unsigned long getFilesCompleted() const { return filesCompleted_; }
+    unsigned long getSamplesProcessed() const { return samplesProcessed_; }
+    unsigned long getTransitionCount() const { return transitionCount_; }
+    unsigned long getLinesParsed() const { return linesParsed_; }
+    unsigned long getLinesSkipped() const { return linesSkipped_; }
+    unsigned long getFilesUnchanged() const { return filesUnchanged_; }
+    unsigned long getBlocksReused() const { return blocksReused_; }
+    unsigned long getBlocksReplayed() const { return blocksReplayed_; }
+    uint64_t getBytesReused() const { return bytesReused_; }
+
+private:
+    /**
+     * Records a block's output and passes it on with the device id
+     */
+    class Recorder : public StabilityTransitionSink {
+    public:
+        explicit Recorder(StabilityTransitionSink* sink) : sink_(sink), records_(NULL) {}
+
+        void setRecords(std::vector<ReplayCacheRecord>* records) { records_ = records; }
+        virtual void onTransition(const StabilityTransition& transition);
+        virtual void onStableUpdate(const StabilityTransition& transition);
+
+    private:
+        StabilityTransitionSink* sink_;
+        std::vector<ReplayCacheRecord>* records_;
+
+        void record(const StabilityTransition& transition, bool update);
+    };
+
+    struct Stream {
+        Recorder recorder;
+        TraceReplayer replayer;
+        TraceParser parser;
+        std::string pending;       // bytes not yet in a finished block
+        size_t scanned;            // pending bytes already hashed into the block
+        uint64_t blockHash;
+        ReplayBoundary boundary;   // state entering the next block
+        uint64_t boundaryHash;
+        bool live;                 // replayer and parser already hold boundary
+        std::vector<ReplayCacheKey> blocks;
+
+        Stream(const TraceReplayer& prototype, StabilityTransitionSink* sink, uint32_t deviceId);
+    };
+
+    TraceReplayer prototype_;
+    StabilityTransitionSink* sink_;
+    ReplayCache* cache_;
+    uint64_t configHash_;
+    uint64_t cutMask_;
+    std::vector<Stream*> streams_;
+    std::vector<uint32_t> deviceIds_;                   // by reader file index, within run()
+    std::vector<std::vector<ReplayCacheKey> > chains_;  // blocks of each file read, within run()
+    unsigned long filesCompleted_;
+    unsigned long filesUnchanged_;
+    unsigned long samplesProcessed_;
+    unsigned long transitionCount_;
+    unsigned long linesParsed_;
+    unsigned long linesSkipped_;
+    unsigned long blocksReused_;
+    unsigned long blocksReplayed_;
+    uint64_t bytesReused_;
+
+    Stream* streamFor(size_t fileIndex);
+    uint32_t deviceIdFor(size_t fileIndex) const;
+    bool replayUnchanged(const ReplayCacheFile& file, uint32_t deviceId);
+    void emitCached(const ReplayCacheEntry& entry, uint32_t deviceId, size_t length);
+    void cutBlocks(Stream* stream, uint32_t deviceId);
+    void finishBlock(Stream* stream, uint32_t deviceId, const char* data, size_t length, bool last);
+
+    // Non-copyable
+    CachedTraceFileReplay(const CachedTraceFileReplay&);
+    CachedTraceFileReplay& operator=(const CachedTraceFileReplay&);
+};
+
+#endif // REPLAY_CACHE_H
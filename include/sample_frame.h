@@ -0,0 +1,84 @@
+#ifndef SAMPLE_FRAME_H
+#define SAMPLE_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Binary sample protocol - compact alternative to the text serial logs
+ *
+ * Fixed 13-byte little-endian frame:
+ *   [0]      sync byte 0xA5
+ *   [1]      bits 0-3 channel (SampleChannel), bit 4 stable, bit 5 valid
+ *   [2..3]   value in hundredths (BPM 72.50 -> 7250)
+ *   [4..7]   timestamp, milliseconds since boot
+ *   [8..11]  device id
+ *   [12]     XOR of bytes 0-11
+ *
+ * Header-only and free of the standard library so firmware can emit it.
+ */
+
+#define SAMPLE_FRAME_SIZE 13
+#define SAMPLE_FRAME_SYNC 0xA5
+#define SAMPLE_FRAME_FLAG_STABLE 0x10
+#define SAMPLE_FRAME_FLAG_VALID 0x20
+
+struct SampleFrame {
+    uint32_t deviceId;
+    uint32_t timeMs;
+    uint16_t valueHundredths;
+    uint8_t channel;
+    bool stable;
+    bool valid;
+};
+
+/**
+ * Encode a frame into exactly SAMPLE_FRAME_SIZE bytes
+ */
+inline void encodeSampleFrame(const SampleFrame& frame, uint8_t* out) {
+    out[0] = SAMPLE_FRAME_SYNC;
+    out[1] = static_cast<uint8_t>((frame.channel & 0x0F) |
+                                  (frame.stable ? SAMPLE_FRAME_FLAG_STABLE : 0) |
+                                  (frame.valid ? SAMPLE_FRAME_FLAG_VALID : 0));
+    out[2] = static_cast<uint8_t>(frame.valueHundredths);
+    out[3] = static_cast<uint8_t>(frame.valueHundredths >> 8);
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = static_cast<uint8_t>(frame.timeMs >> (8 * i));
+        out[8 + i] = static_cast<uint8_t>(frame.deviceId >> (8 * i));
+    }
+    uint8_t check = 0;
+    for (int i = 0; i < SAMPLE_FRAME_SIZE - 1; ++i) {
+        check ^= out[i];
+    }
+    out[SAMPLE_FRAME_SIZE - 1] = check;
+}
+
+/**
+ * Decode SAMPLE_FRAME_SIZE bytes
+ * @return false if the sync byte or checksum does not match
+ */
+inline bool decodeSampleFrame(const uint8_t* in, SampleFrame* frame) {
+    if (in[0] != SAMPLE_FRAME_SYNC) {
+        return false;
+    }
+    uint8_t check = 0;
+    for (int i = 0; i < SAMPLE_FRAME_SIZE - 1; ++i) {
+        check ^= in[i];
+    }
+    if (check != in[SAMPLE_FRAME_SIZE - 1]) {
+        return false;
+    }
+    frame->channel = in[1] & 0x0F;
+    frame->stable = (in[1] & SAMPLE_FRAME_FLAG_STABLE) != 0;
+    frame->valid = (in[1] & SAMPLE_FRAME_FLAG_VALID) != 0;
+    frame->valueHundredths = static_cast<uint16_t>(in[2] | (in[3] << 8));
+    frame->timeMs = 0;
+    frame->deviceId = 0;
+    for (int i = 0; i < 4; ++i) {
+        frame->timeMs |= static_cast<uint32_t>(in[4 + i]) << (8 * i);
+        frame->deviceId |= static_cast<uint32_t>(in[8 + i]) << (8 * i);
+    }
+    return true;
+}
+
+#endif // SAMPLE_FRAME_H
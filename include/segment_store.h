@@ -0,0 +1,235 @@
+#ifndef SEGMENT_STORE_H
+#define SEGMENT_STORE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trace_sample.h"
+
+#define SEGMENT_BLOOM_BITS_PER_DEVICE 10   // about 1% false positives with 7 hashes
+#define SEGMENT_BLOOM_HASHES 7
+
+/**
+ * Min/max of a segment's columns, so queries can skip it unread
+ *
+ * Values are kept per channel (height, BPM, SpO2); a channel with no rows
+ * has channelRows 0 and its range is meaningless.
+ */
+struct SegmentZoneMap {
+    uint64_t rows;
+    unsigned long minTimeMs;
+    unsigned long maxTimeMs;
+    uint64_t channelRows[SAMPLE_CHANNEL_COUNT];
+    float minValue[SAMPLE_CHANNEL_COUNT];
+    float maxValue[SAMPLE_CHANNEL_COUNT];
+
+    SegmentZoneMap();
+
+    void add(const TraceSample& sample);
+
+    /**
+     * Could the segment hold rows in [fromMs, toMs]?
+     */
+    bool overlapsTime(unsigned long fromMs, unsigned long toMs) const;
+
+    /**
+     * Could the segment hold a channel reading in [minValue, maxValue]?
+     */
+    bool overlapsValue(uint8_t channel, float low, float high) const;
+};
+
+/**
+ * DeviceBloomFilter - Set of device IDs with no false negatives
+ *
+ * Sized at build time for the segment's distinct devices; a query for a
+ * device that was never added is answered "maybe" about 1% of the time.
+ */
+class DeviceBloomFilter {
+public:
+    DeviceBloomFilter();
+
+    /**
+     * Empty the filter and size it for this many distinct devices
+     */
+    void reset(size_t devices);
+
+    void add(uint32_t deviceId);
+    bool mayContain(uint32_t deviceId) const;
+
+    const std::vector<uint64_t>& getWords() const { return words_; }
+
+    /**
+     * Replace the bits (loading a saved filter)
+     * @return false if words is empty
+     */
+    bool assign(const std::vector<uint64_t>& words);
+
+private:
+    std::vector<uint64_t> words_;
+};
+
+/**
+ * What the catalog knows about one segment without reading its rows
+ */
+struct SegmentInfo {
+    uint64_t id;
+    uint32_t level;              // 0 sealed by ingestion, 1 written by compaction
+    bool persisted;              // false while the rows are still being written
+    SegmentZoneMap zone;
+    DeviceBloomFilter devices;
+};
+
+/**
+ * Tuning of segment sealing and compaction
+ */
+struct SegmentStoreConfig {
+    unsigned long segmentSpanMs;   // ingestion starts a new segment each span (an hour)
+    size_t maxSegmentRows;         // or when the open segment reaches this many rows
+    size_t smallSegmentRows;       // segments below this are compaction input
+    size_t compactedSegmentRows;   // rows a compacted segment is filled to
+    size_t minCompactionInputs;    // fewer small segments than this are left alone
+
+    SegmentStoreConfig();
+};
+
+/**
+ * Which rows a query wants; the default matches every row
+ */
+struct SegmentQuery {
+    uint32_t deviceId;
+    bool allDevices;
+    uint8_t channel;
+    bool allChannels;
+    unsigned long fromMs;
+    unsigned long toMs;
+    float minValue;              // value bounds apply when a channel is given
+    float maxValue;
+
+    SegmentQuery();
+};
+
+/**
+ * How much of the store a query had to read
+ */
+struct SegmentScanStats {
+    size_t segments;             // segments in the catalog when the query ran
+    size_t skippedByTime;        // pruned by the timestamp zone map
+    size_t skippedByValue;       // pruned by the channel's value zone map
+    size_t skippedByDevice;      // pruned by the device Bloom filter
+    size_t scanned;              // segments whose rows were read
+    uint64_t rowsRead;
+};
+
+/**
+ * SegmentStore - Long-term reading storage as immutable sorted segments
+ *
+ * Readings are buffered and sealed into a segment file per time span
+ * (seg-<id>.rseg in the store directory); late readings go into the open
+ * segment. Each segment holds its rows
+ * sorted by (device, time, channel) as columns, behind a header with the
+ * zone map and a Bloom filter of its device IDs; a query checks the
+ * headers, kept in memory, and reads only segments that may match, and of
+ * those only the device's row range.
+ *
+ * Compaction merges small segments into large sorted ones. It snapshots
+ * its inputs under the catalog lock, merges and writes without it, and
+ * takes the lock again only to swap the catalog entries, so ingestion and
+ * queries carry on throughout. Replaced files are deleted once the last
+ * query reading them finishes. A compacted segment records the IDs it
+ * replaces, so inputs left behind by a crash are dropped on open().
+ */
+class SegmentStore {
+public:
+    SegmentStore(const std::string& directory, const SegmentStoreConfig& config);
+    ~SegmentStore();
+
+    /**
+     * Load the catalog from the directory (which must exist), removing
+     * unfinished and superseded files
+     * @return false if the directory or a segment header cannot be read
+     */
+    bool open();
+
+    /**
+     * Add one reading; may seal the open segment
+     * @return false if sealing failed to write its file (the rows stay in
+     *         memory and every later seal retries the write)
+     */
+    bool append(const TraceSample& sample);
+
+    /**
+     * Seal buffered readings into a segment now, and retry segments whose
+     * earlier write failed
+     * @return false on I/O error
+     */
+    bool flush();
+
+    /**
+     * One compaction step: merge the oldest small segments into one
+     * @return number of segments merged (0 when there was nothing to do or
+     *         the output could not be written)
+     */
+    size_t compact();
+
+    /**
+     * Compact in a background thread, checking every intervalMs
+     */
+    void startCompaction(unsigned long intervalMs);
+    void stopCompaction();
+
+    /**
+     * Rows matching the query, appended to out sorted by (device, time,
+     * channel); buffered readings are included
+     * @return number of rows appended
+     */
+    size_t query(const SegmentQuery& query, std::vector<TraceSample>& out, SegmentScanStats* stats = NULL) const;
+
+    /**
+     * Headers of the current segments, oldest first
+     */
+    void getSegments(std::vector<SegmentInfo>& out) const;
+
+    size_t getSegmentCount() const;
+    size_t getBufferedRows() const;
+    unsigned long getCompactionErrors() const;
+    unsigned long getSealErrors() const;
+
+    /**
+     * Sealed segments still held only in memory (being written, or waiting
+     * to retry a failed write)
+     */
+    size_t getUnwrittenSegments() const;
+    const SegmentStoreConfig& getConfig() const { return config_; }
+
+private:
+    struct Segment;
+    typedef std::shared_ptr<Segment> SegmentPtr;
+
+    std::string directory_;
+    SegmentStoreConfig config_;
+
+    mutable std::mutex mutex_;          // catalog, buffer and counters
+    std::vector<SegmentPtr> segments_;  // by id
+    std::vector<TraceSample> buffer_;
+    SegmentZoneMap bufferZone_;
+    unsigned long bufferSpan_;
+    uint64_t nextId_;
+    unsigned long compactionErrors_;
+    unsigned long sealErrors_;
+
+    std::mutex compactionMutex_;        // one compaction at a time
+    std::mutex workerMutex_;
+    std::condition_variable workerWake_;
+    std::thread worker_;
+    bool stopWorker_;
+
+    bool seal(std::unique_lock<std::mutex>& lock);
+    std::string pathFor(uint64_t id) const;
+};
+
+#endif // SEGMENT_STORE_H
@@ -0,0 +1,151 @@
+#ifndef SOCKET_FRAME_H
+#define SOCKET_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define SOCKET_FRAME_MAX_BYTES (16 * 1024 * 1024)
+
+// ============================================
+// Length-prefixed frames over Unix stream sockets
+// ============================================
+// A frame is a native-endian uint32 length of what follows, a type byte,
+// then the fields, so both ends must share a host (and a build). Used by
+// the station partition and replication protocols.
+
+/**
+ * Start a frame; append fields, then finishFrame()
+ */
+std::vector<uint8_t> beginFrame(uint8_t type);
+
+/**
+ * Fill in the length prefix
+ */
+void finishFrame(std::vector<uint8_t>& frame);
+
+/**
+ * Append a field as its raw bytes (copied one by one, so struct padding
+ * never goes on the wire)
+ */
+template<typename T>
+void putValue(std::vector<uint8_t>& out, const T& value) {
+    size_t at = out.size();
+    out.resize(at + sizeof(value));
+    std::memcpy(&out[at], &value, sizeof(value));
+}
+
+/**
+ * @return false if fewer than sizeof(T) bytes remain
+ */
+template<typename T>
+bool getValue(const uint8_t*& p, const uint8_t* end, T& value) {
+    if (static_cast<size_t>(end - p) < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return true;
+}
+
+bool getFlag(const uint8_t*& p, const uint8_t* end, bool& flag);
+
+/**
+ * LEB128 varints; signed values are zigzag encoded so small deltas of
+ * either sign take one byte
+ */
+void putVarint(std::vector<uint8_t>& out, uint64_t value);
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value);
+void putSignedVarint(std::vector<uint8_t>& out, int64_t value);
+bool getSignedVarint(const uint8_t*& p, const uint8_t* end, int64_t& value);
+
+/**
+ * Connect, retrying while the socket does not exist or nobody listens yet
+ * (a process starting or taking over)
+ * @return the socket, or -1 after timeoutMs (0 tries once)
+ */
+int connectFrameSocket(const std::string& path, unsigned long timeoutMs);
+
+/**
+ * Bind and listen, replacing a stale socket file
+ * @return the socket, or -1
+ */
+int listenFrameSocket(const std::string& path);
+
+/**
+ * Send a finished frame, blocking until written
+ */
+bool writeFrame(int fd, const std::vector<uint8_t>& frame);
+
+/**
+ * Make sends and receives on the socket return instead of waiting
+ */
+bool setNonBlocking(int fd);
+
+/**
+ * Receive one frame, blocking at most timeoutMs for each part
+ * @param payload - replaced with the fields after the type byte
+ */
+bool readFrame(int fd, uint8_t& type, std::vector<uint8_t>& payload, unsigned long timeoutMs);
+
+/**
+ * FrameReader - Reassembles frames from a non-blocking poll() loop
+ */
+class FrameReader {
+public:
+    FrameReader();
+
+    /**
+     * Read whatever the socket has (one recv())
+     * @return false at end of stream or on error
+     */
+    bool receive(int fd);
+
+    /**
+     * Take the next complete frame; the payload stays valid until the
+     * following receive()
+     * @return false when no complete frame is buffered (or the stream is
+     *         corrupt, see isCorrupt())
+     */
+    bool next(uint8_t& type, const uint8_t*& payload, size_t& length);
+
+    bool isCorrupt() const { return corrupt_; }
+
+private:
+    std::vector<uint8_t> buffer_;
+    size_t consumed_;
+    bool corrupt_;
+};
+
+/**
+ * FrameWriter - Queues frames for a non-blocking socket in a poll() loop
+ *
+ * Frames are sent as far as the socket buffer allows; the rest waits for
+ * POLLOUT, so two processes sending to each other never both block.
+ */
+class FrameWriter {
+public:
+    FrameWriter();
+
+    /**
+     * Append a finished frame behind those not yet sent
+     */
+    void queue(const std::vector<uint8_t>& frame);
+
+    /**
+     * Send as much of the queue as the socket takes without blocking
+     * @return false on a socket error
+     */
+    bool flush(int fd);
+
+    bool isEmpty() const { return sent_ == buffer_.size(); }
+    size_t getQueuedBytes() const { return buffer_.size() - sent_; }
+
+private:
+    std::vector<uint8_t> buffer_;
+    size_t sent_;
+};
+
+#endif // SOCKET_FRAME_H
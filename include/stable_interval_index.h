@@ -0,0 +1,211 @@
+#ifndef STABLE_INTERVAL_INDEX_H
+#define STABLE_INTERVAL_INDEX_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "trace_sample.h"
+
+// End time of an interval that is still stable
+#define STABLE_INTERVAL_OPEN ULONG_MAX
+
+/**
+ * One period during which a channel's debouncer reported stable
+ *
+ * The interval covers [startMs, endMs): it starts at the stable transition
+ * and ends at the next unstable transition. minValue/maxValue bound the
+ * stable reading over the whole period.
+ */
+struct StableInterval {
+    unsigned long startMs;
+    unsigned long endMs;
+    float minValue;
+    float maxValue;
+};
+
+/**
+ * A stable reading in force from startMs until the next segment starts
+ * or its interval ends
+ */
+struct StableSegment {
+    unsigned long startMs;
+    float value;
+};
+
+/**
+ * Aggregate over the intervals overlapping a time range
+ */
+struct StableIntervalSummary {
+    size_t intervals;         // intervals overlapping the range
+    float minValue;           // lowest stable reading inside the range
+    float maxValue;           // highest stable reading inside the range
+    unsigned long stableMs;   // stable time inside the range
+};
+
+/**
+ * StableIntervalRun - Sorted, disjoint stable intervals of one channel
+ *
+ * Intervals are kept in start order (which, being disjoint, is also end
+ * order), so stabbing and overlap queries are binary searches. Each change
+ * of the stable reading starts a segment; min/max segment trees over the
+ * segments and prefix sums of interval lengths answer value predicates and
+ * stable-time totals for a range in O(log n) without visiting the
+ * intervals in between. Segments are clipped to the range, so an interval
+ * that only partly overlaps it contributes only the readings inside it.
+ */
+class StableIntervalRun {
+public:
+    StableIntervalRun();
+
+    /**
+     * Open a new interval (the channel became stable)
+     */
+    void open(unsigned long startMs, float value);
+
+    /**
+     * Start a segment of the open interval and widen its value range
+     * (the stable reading moved)
+     */
+    void extend(float value, unsigned long timeMs);
+
+    /**
+     * Close the open interval (the channel became unstable)
+     */
+    void close(unsigned long endMs);
+
+    /**
+     * Append a complete interval (loading a saved index); intervals must
+     * arrive in time order and not overlap the previous one. Without its
+     * segments, value queries see its whole min/max range from its start.
+     * @param segments - its readings in time order, the first at startMs
+     * @return false if the interval or its segments are out of order
+     */
+    bool append(const StableInterval& interval, const StableSegment* segments = NULL, size_t segmentCount = 0);
+
+    /**
+     * Interval containing a point in time
+     * @return false if the channel was not stable at timeMs
+     */
+    bool stab(unsigned long timeMs, StableInterval& interval) const;
+
+    /**
+     * Indices [first, last) of the intervals overlapping [fromMs, toMs]
+     */
+    void overlapping(unsigned long fromMs, unsigned long toMs, size_t& first, size_t& last) const;
+
+    /**
+     * Summarize the intervals overlapping [fromMs, toMs]
+     * @return false if no interval overlaps the range
+     */
+    bool summarize(unsigned long fromMs, unsigned long toMs, StableIntervalSummary& summary) const;
+
+    /**
+     * Lowest and highest stable reading in force at any point in [fromMs, toMs]
+     * @return false if the channel was never stable in the range
+     */
+    bool valueRange(unsigned long fromMs, unsigned long toMs, float& minValue, float& maxValue) const;
+
+    size_t size() const { return intervals_.size(); }
+    const StableInterval& at(size_t index) const { return intervals_[index]; }
+    size_t segmentCount() const { return segments_.size(); }
+    const StableSegment& segmentAt(size_t index) const { return segments_[index]; }
+    bool isOpen() const { return !intervals_.empty() && intervals_.back().endMs == STABLE_INTERVAL_OPEN; }
+    unsigned long getLastSeenMs() const { return lastSeenMs_; }
+
+private:
+    std::vector<StableInterval> intervals_;
+    std::vector<StableSegment> segments_;        // every interval's readings, in time order
+    std::vector<unsigned long long> prefixMs_;   // prefixMs_[i] = total length of closed intervals [0, i)
+    std::vector<float> minTree_;                 // segment trees over segment indices
+    std::vector<float> maxTree_;
+    size_t leaves_;
+    unsigned long lastSeenMs_;                   // latest event time, bounds an open interval
+
+    void addSegment(unsigned long startMs, float value);
+    void grow();
+    void updateLeaf(size_t index);
+    void rangeMinMax(size_t first, size_t last, float& minValue, float& maxValue) const;
+    unsigned long effectiveEnd(const StableInterval& interval) const;
+};
+
+/**
+ * StableIntervalIndex - Stable intervals of every (device, channel)
+ *
+ * Built during ingestion or replay: attach it as the transition sink of a
+ * TraceReplayer (stable transitions open intervals, unstable ones close
+ * them, stable-reading updates widen the value range). Historical queries
+ * then run against the index instead of replaying raw samples. The index
+ * can be saved to and loaded from a compact binary file.
+ */
+class StableIntervalIndex : public StabilityTransitionSink {
+public:
+    StableIntervalIndex();
+
+    virtual void onTransition(const StabilityTransition& transition);
+    virtual void onStableUpdate(const StabilityTransition& transition);
+
+    /**
+     * Close intervals still open, at the last time seen on their channel
+     * (end of a replay, when no further samples will arrive)
+     */
+    void finish();
+
+    /**
+     * Run of a channel, or NULL if it never became stable
+     */
+    const StableIntervalRun* find(uint32_t deviceId, uint8_t channel) const;
+
+    /**
+     * Was the channel stable at timeMs? Fills the containing interval.
+     */
+    bool stab(uint32_t deviceId, uint8_t channel, unsigned long timeMs, StableInterval& interval) const;
+
+    /**
+     * Intervals overlapping [fromMs, toMs], appended to out in time order
+     * @return number of intervals appended
+     */
+    size_t overlapping(uint32_t deviceId, uint8_t channel, unsigned long fromMs, unsigned long toMs,
+                       std::vector<StableInterval>& out) const;
+
+    /**
+     * Aggregate over the intervals overlapping [fromMs, toMs]
+     * @return false if the channel was never stable in the range
+     */
+    bool summarize(uint32_t deviceId, uint8_t channel, unsigned long fromMs, unsigned long toMs,
+                   StableIntervalSummary& summary) const;
+
+    /**
+     * Was the channel stable with a reading below (or above) a threshold
+     * at any point in [fromMs, toMs]?
+     */
+    bool wasStableBelow(uint32_t deviceId, uint8_t channel, unsigned long fromMs, unsigned long toMs,
+                        float threshold) const;
+    bool wasStableAbove(uint32_t deviceId, uint8_t channel, unsigned long fromMs, unsigned long toMs,
+                        float threshold) const;
+
+    /**
+     * Write the index to a file (open intervals are saved open)
+     * @return false on I/O error
+     */
+    bool save(const char* path) const;
+
+    /**
+     * Replace the index with one read from a file
+     * @return false on I/O error or a malformed file (the index is left empty)
+     */
+    bool load(const char* path);
+
+    size_t getChannelCount() const { return runs_.size(); }
+    size_t getIntervalCount() const;
+
+private:
+    std::map<uint64_t, StableIntervalRun> runs_;
+
+    static uint64_t makeKey(uint32_t deviceId, uint8_t channel) {
+        return (static_cast<uint64_t>(deviceId) << 8) | channel;
+    }
+};
+
+#endif // STABLE_INTERVAL_INDEX_H
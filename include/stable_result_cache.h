@@ -0,0 +1,158 @@
+#ifndef STABLE_RESULT_CACHE_H
+#define STABLE_RESULT_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "trace_sample.h"
+
+#define STABLE_CACHE_WAYS 8
+#define STABLE_CACHE_LATENCY_BUCKETS 16
+#define STABLE_CACHE_LATENCY_SAMPLE_EVERY 16
+
+/**
+ * Latest stable result of one channel
+ */
+struct StableResult {
+    float value;
+    unsigned long timeMs;
+};
+
+/**
+ * Backing store consulted on cache misses (e.g. the results database)
+ */
+class StableResultLoader {
+public:
+    virtual ~StableResultLoader() {}
+
+    /**
+     * Fetch the latest stable result of a channel
+     * @return false if the store has none
+     */
+    virtual bool load(uint32_t deviceId, uint8_t channel, StableResult& result) = 0;
+};
+
+/**
+ * Point-in-time copy of the cache counters
+ *
+ * Lookup latency is sampled (one lookup in STABLE_CACHE_LATENCY_SAMPLE_EVERY
+ * per thread) into power-of-two buckets; bucket i counts lookups that took
+ * at most 2^(i+5) ns, the last bucket everything slower.
+ */
+struct StableResultCacheMetrics {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t loads;           // misses answered by the loader
+    uint64_t inserts;
+    uint64_t evictions;
+    uint64_t invalidations;   // entries dropped by new sessions
+    uint64_t entries;
+    uint64_t capacity;
+    uint64_t latencyBuckets[STABLE_CACHE_LATENCY_BUCKETS];
+    uint64_t latencySamples;
+    uint64_t latencySumNs;
+
+    double getHitRate() const {
+        uint64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+/**
+ * StableResultCache - Sharded CLOCK cache of the latest stable readings
+ *
+ * Keeps the last stable height/BPM/SpO2 per device so the query API does
+ * not go to storage for every request. Entries are written straight from
+ * debouncer stable transitions (it is a StabilityTransitionSink) and a
+ * device's entries are dropped when a new session starts on it.
+ *
+ * Memory is fixed at construction: shards of 8-way sets, each set evicting
+ * with its own CLOCK hand (hits set the reference bit, new entries start
+ * unreferenced). Writers take the shard lock; readers never lock, reading
+ * each slot under a per-slot sequence counter and retrying if a writer
+ * raced them.
+ */
+class StableResultCache : public StabilityTransitionSink {
+public:
+    /**
+     * @param capacity - maximum entries (rounded up to fill whole sets)
+     * @param shards - number of independently locked shards (power of two)
+     * @param loader - read-through source for misses, may be NULL
+     */
+    StableResultCache(size_t capacity, size_t shards, StableResultLoader* loader);
+    virtual ~StableResultCache();
+
+    /**
+     * Cached result only (no loader)
+     * @return true on a hit
+     */
+    bool get(uint32_t deviceId, uint8_t channel, StableResult& result);
+
+    /**
+     * Cached result, falling back to the loader and caching what it returns
+     * A put() or beginSession() on the entry's set while the loader runs
+     * wins: the loaded result is then returned (or the newer cached one)
+     * but not cached, so an invalidated or older value never comes back.
+     * @return false if neither the cache nor the loader has a result
+     */
+    bool lookup(uint32_t deviceId, uint8_t channel, StableResult& result);
+
+    /**
+     * Store a result unless a newer one is already cached
+     */
+    void put(uint32_t deviceId, uint8_t channel, float value, unsigned long timeMs);
+
+    /**
+     * Drop every channel of a device (a new patient session started on it)
+     */
+    void beginSession(uint32_t deviceId);
+
+    /**
+     * Stable transitions update the cache; unstable ones leave the last
+     * stable result in place
+     */
+    virtual void onTransition(const StabilityTransition& transition);
+
+    /**
+     * A stable reading that moved within tolerance replaces the cached one
+     */
+    virtual void onStableUpdate(const StabilityTransition& transition);
+
+    StableResultCacheMetrics getMetrics() const;
+
+    /**
+     * Append the metrics in Prometheus text exposition format
+     * @param prefix - metric name prefix, e.g. "apptech_stable_cache"
+     */
+    void formatMetrics(const char* prefix, std::string& out) const;
+
+    size_t getCapacity() const { return shardCount_ * setsPerShard_ * STABLE_CACHE_WAYS; }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;   // odd while a writer is updating
+        std::atomic<uint32_t> valueBits;
+        std::atomic<uint64_t> key;        // 0 = empty
+        std::atomic<uint64_t> timeMs;
+        std::atomic<uint8_t> referenced;
+        uint8_t reserved[7];
+    };
+
+    struct Shard;
+
+    Shard* shards_;
+    size_t shardCount_;
+    size_t setsPerShard_;
+    StableResultLoader* loader_;
+
+    Shard& shardFor(uint64_t key, size_t& setIndex) const;
+    bool read(Shard& shard, size_t setIndex, uint64_t key, StableResult& result);
+    void write(Shard& shard, size_t setIndex, uint64_t key, float value, unsigned long timeMs);
+
+    // Non-copyable
+    StableResultCache(const StableResultCache&);
+    StableResultCache& operator=(const StableResultCache&);
+};
+
+#endif // STABLE_RESULT_CACHE_H
@@ -0,0 +1,161 @@
+#ifndef STATION_HEALTH_H
+#define STATION_HEALTH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "trace_sample.h"
+
+/**
+ * Why a station is alerting (the metric furthest over its limit)
+ */
+enum StationHealthReason {
+    STATION_HEALTH_OK = 0,
+    STATION_HEALTH_RESET_RATE,        // readings keep breaking tolerance (worn transducer, jitter)
+    STATION_HEALTH_DROPOUTS,          // out-of-range readings (dirty window, lost echo, 0 cm)
+    STATION_HEALTH_TIME_TO_STABLE     // stabilizing takes longer than the station's own baseline
+};
+
+/**
+ * Limits and time constants of the health model
+ */
+struct StationHealthConfig {
+    unsigned long halfLifeMs;       // decay half-life of the reset and dropout counts
+    float maxResetRate;             // tolerance resets per accepted sample
+    float maxDropoutRatio;          // invalid readings per sample
+    float maxTimeToStableDrift;     // (recent - baseline) / baseline time-to-stable
+    float minSamples;               // decayed samples before rates are trusted
+    unsigned long minStableSessions; // stabilizations before drift is trusted
+    float recentWeight;             // EWMA weight of the recent time-to-stable
+    float baselineWeight;           // EWMA weight of the baseline time-to-stable
+    float maxHeightCm;              // height readings of 0 or above this are dropouts
+    unsigned long staleMs;          // a channel silent this long is forgotten
+
+    StationHealthConfig();
+};
+
+/**
+ * Health of one station (its worst channel)
+ */
+struct StationHealthSnapshot {
+    uint32_t stationId;
+    uint8_t channel;            // SampleChannel the figures below belong to
+    uint8_t reason;             // StationHealthReason, OK while severity < 1
+    float severity;             // worst metric / its limit; >= 1 raises an alert
+    float resetRate;
+    float dropoutRatio;
+    float timeToStableMs;       // recent EWMA
+    float timeToStableDrift;
+    unsigned long lastEventMs;
+};
+
+/**
+ * StationHealthModel - Streaming per-station sensor health scoring
+ *
+ * Fed the debouncer's decision for every sample (TraceReplayer's event
+ * sink), it keeps per channel exponentially decayed counts of samples,
+ * tolerance resets and dropouts, plus fast and slow EWMAs of the time from
+ * first reading to stable. Each station is a fixed-size record, and an
+ * event costs one hash lookup, one exp2() and a constant amount of work.
+ *
+ * The height debouncer has no valid range, so a lost echo (0 cm) or a
+ * reading beyond maxHeightCm reaches it as an ordinary sample; the model
+ * counts those as dropouts, not tolerance resets. A channel that has not
+ * reported for staleMs is forgotten when its station next reports, or by
+ * expire() for stations that went silent altogether.
+ *
+ * Alerting stations sit in severity buckets (quarter-octave steps) on
+ * intrusive lists, so moving a station between buckets is O(1) and a ranked
+ * query walks buckets from the top and sorts only what it returns.
+ */
+class StationHealthModel : public DebounceEventSink {
+public:
+    /**
+     * @param config - limits and time constants
+     * @param expectedStations - stations to reserve room for
+     */
+    explicit StationHealthModel(const StationHealthConfig& config, size_t expectedStations = 0);
+
+    virtual void onDebounceEvent(const DebounceEvent& event);
+
+    /**
+     * @return false if the station has not been seen
+     */
+    bool getHealth(uint32_t stationId, StationHealthSnapshot& out) const;
+
+    /**
+     * Alerting stations, most severe first
+     * @param out - replaced with at most limit snapshots
+     * @return number of snapshots written
+     */
+    size_t getAlerts(std::vector<StationHealthSnapshot>& out, size_t limit) const;
+
+    /**
+     * Forget the channels of alerting stations that have not reported for
+     * staleMs before nowMs (call now and then on a live feed)
+     * @return number of stations that stopped alerting
+     */
+    size_t expire(unsigned long nowMs);
+
+    size_t getStationCount() const { return stations_.size(); }
+    size_t getAlertCount() const { return alertCount_; }
+    const StationHealthConfig& getConfig() const { return config_; }
+
+private:
+    static const int kBucketCount = 32;
+    static const uint32_t kNone = 0xFFFFFFFFu;
+
+    struct ChannelHealth {
+        float samples;              // decayed counts
+        float accepted;
+        float resets;
+        float dropouts;
+        float recentTimeToStableMs;
+        float baselineTimeToStableMs;
+        unsigned long lastMs;
+        unsigned long attemptStartMs;
+        uint32_t stableSessions;
+        bool attempting;
+        bool droppedOut;            // the last sample was a dropout
+    };
+
+    struct Station {
+        uint32_t id;
+        uint32_t prev;              // bucket list links (slot indices)
+        uint32_t next;
+        int8_t bucket;              // -1 when not alerting
+        uint8_t worstChannel;
+        uint8_t reason;
+        float severity;
+        unsigned long lastEventMs;
+        ChannelHealth channels[SAMPLE_CHANNEL_COUNT];
+    };
+
+    StationHealthConfig config_;
+    std::vector<Station> stations_;
+    std::unordered_map<uint32_t, uint32_t> slots_;
+    uint32_t buckets_[kBucketCount];
+    size_t alertCount_;
+
+    uint32_t slotFor(uint32_t stationId);
+    void decay(ChannelHealth& channel, unsigned long timeMs) const;
+    float channelSeverity(const ChannelHealth& channel, uint8_t& reason) const;
+    bool isDropout(uint8_t channel, float value) const;
+    void rescore(uint32_t slot, unsigned long nowMs);
+    void unlink(uint32_t slot);
+    void link(uint32_t slot, int bucket);
+    void fillSnapshot(const Station& station, StationHealthSnapshot& out) const;
+    float resetRate(const ChannelHealth& channel) const;
+    float dropoutRatio(const ChannelHealth& channel) const;
+    float timeToStableDrift(const ChannelHealth& channel) const;
+
+    static int bucketFor(float severity);
+};
+
+/**
+ * Short reason name for reports
+ */
+const char* stationHealthReasonName(uint8_t reason);
+
+#endif // STATION_HEALTH_H
@@ -0,0 +1,377 @@
+#ifndef STATION_PARTITION_H
+#define STATION_PARTITION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "height_debouncer.h"
+#include "reading_debouncer.h"
+#include "socket_frame.h"
+#include "trace_replayer.h"
+#include "trace_sample.h"
+
+#define PARTITION_VIRTUAL_NODES 128        // ring points per aggregator, about +-10% load spread
+#define PARTITION_NO_NODE 0xFFFFFFFFu
+#define PARTITION_CONNECT_TIMEOUT_MS 5000  // a node process may still be starting
+
+class ReplicationPrimary;
+
+/**
+ * ConsistentHashRing - Maps station IDs onto aggregator nodes
+ *
+ * Each node is hashed onto a 32-bit ring at PARTITION_VIRTUAL_NODES points
+ * and a station belongs to the first point at or after its own hash. When
+ * a node joins, it takes stations only from the others' arcs it splits;
+ * when one leaves, only its stations move. The hashes are fixed, so every
+ * process computes the same owners from the same member list.
+ */
+class ConsistentHashRing {
+public:
+    explicit ConsistentHashRing(unsigned virtualNodes = PARTITION_VIRTUAL_NODES);
+
+    /**
+     * Replace the member list (order and duplicates do not matter)
+     */
+    void setMembers(const std::vector<uint32_t>& nodeIds);
+
+    /**
+     * @return the owning node, or PARTITION_NO_NODE when there are no members
+     */
+    uint32_t ownerOf(uint32_t stationId) const;
+
+    bool contains(uint32_t nodeId) const;
+    bool empty() const { return members_.empty(); }
+    const std::vector<uint32_t>& getMembers() const { return members_; }
+
+private:
+    struct Point {
+        uint32_t hash;
+        uint32_t nodeId;
+    };
+
+    unsigned virtualNodes_;
+    std::vector<uint32_t> members_;   // sorted
+    std::vector<Point> points_;       // sorted by hash
+};
+
+/**
+ * Debouncer state of one station, as moved between aggregators
+ */
+struct StationCheckpoint {
+    uint32_t stationId;
+    HeightDebouncer::Checkpoint height;
+    ReadingDebouncer<float>::Checkpoint bpm;
+    ReadingDebouncer<int>::Checkpoint spo2;
+};
+
+/**
+ * What StationPartition::route() did with a sample
+ */
+enum PartitionRoute {
+    PARTITION_APPLIED = 0,   // fed to this node's debouncers
+    PARTITION_QUEUED,        // held until the station's handoff arrives
+    PARTITION_FORWARD        // belongs to another node
+};
+
+/**
+ * StationPartition - One aggregator's share of the station debouncers
+ *
+ * Holds a TraceReplayer per owned station, all copies of one prototype (so
+ * transitions go to the prototype's sink). A membership change is an
+ * epoch: the node gives up the stations the new ring assigns elsewhere, as
+ * checkpoints to hand over, and until every previous member ("source") has
+ * reported its handoff done, samples for stations it owns but does not yet
+ * hold are queued rather than started from scratch. Stability timers
+ * therefore carry on across a rebalance as if nothing had moved.
+ *
+ * No I/O here; PartitionNode moves the checkpoints and samples.
+ */
+class StationPartition {
+public:
+    StationPartition(uint32_t nodeId, const TraceReplayer& prototype);
+
+    /**
+     * Move to a new membership
+     * @param epoch - increases with every change
+     * @param sources - previous members that will hand stations over
+     * @param members - the new members
+     * @param handoff - receives checkpoints of stations no longer owned here,
+     *                  which are removed
+     */
+    void setMembers(uint64_t epoch, const std::vector<uint32_t>& sources, const std::vector<uint32_t>& members,
+                    std::vector<StationCheckpoint>& handoff);
+
+    /**
+     * Take over a station handed off by another node, then apply any samples
+     * queued for it
+     * @param epoch - the sender's epoch; checkpoints from an epoch this node
+     *                has not seen yet are held until setMembers() sorts them
+     * @return false if the station belongs to another node by now (the
+     *         caller passes the checkpoint on)
+     */
+    bool adopt(const StationCheckpoint& checkpoint, uint64_t epoch);
+
+    /**
+     * A source has sent all its checkpoints for an epoch (may come before
+     * this node learns of the epoch)
+     */
+    void sourceDone(uint32_t nodeId, uint64_t epoch);
+
+    /**
+     * Apply, queue or redirect a sample
+     * @param owner - set to the owning node when the result is PARTITION_FORWARD
+     * @return a PartitionRoute
+     */
+    int route(const TraceSample& sample, uint32_t* owner);
+
+    /**
+     * Once settled, route the samples queued during the handoff again
+     * @param forward - receives those that now belong elsewhere
+     * @return number of samples taken off the queue
+     */
+    size_t drainQueued(std::vector<TraceSample>& forward);
+
+    /**
+     * Membership known and every source's handoff received
+     */
+    bool isSettled() const { return epoch_ != 0 && pendingSources_.empty(); }
+
+    /**
+     * @return false if the station is not held here
+     */
+    bool getCheckpoint(uint32_t stationId, StationCheckpoint& out) const;
+
+    /**
+     * Record which stations change, for replication (off by default; costs
+     * one flag test per applied sample)
+     */
+    void setChangeTracking(bool enabled);
+
+    /**
+     * Checkpoints of the stations changed, and IDs of those removed, since
+     * the last call
+     * @param everything - take every station instead (a full snapshot)
+     */
+    void takeChanges(bool everything, std::vector<StationCheckpoint>& changed, std::vector<uint32_t>& removed);
+
+    /**
+     * Mirror another partition from its takeChanges() output (standby);
+     * the replica is settled in the primary's epoch
+     * @param everything - changed is a full snapshot replacing all stations
+     */
+    void applyReplica(uint64_t epoch, const std::vector<uint32_t>& members, bool everything,
+                      const std::vector<StationCheckpoint>& changed, const std::vector<uint32_t>& removed);
+
+    uint32_t getNodeId() const { return nodeId_; }
+    uint64_t getEpoch() const { return epoch_; }
+    const ConsistentHashRing& getRing() const { return ring_; }
+    size_t getStationCount() const { return stations_.size(); }
+    size_t getQueuedCount() const { return queuedCount_; }
+    uint64_t getSamplesApplied() const { return samplesApplied_; }
+    uint64_t getCheckpointsAdopted() const { return checkpointsAdopted_; }
+    uint64_t getCheckpointsHandedOff() const { return checkpointsHandedOff_; }
+
+private:
+    struct Station {
+        bool changed;               // listed in changed_; first, on the debouncers' cache line
+        TraceReplayer replayer;
+
+        explicit Station(const TraceReplayer& prototype) : changed(false), replayer(prototype) {}
+    };
+    typedef std::unordered_map<uint32_t, Station> StationMap;
+
+    uint32_t nodeId_;
+    TraceReplayer prototype_;
+    ConsistentHashRing ring_;
+    uint64_t epoch_;
+    std::set<uint32_t> pendingSources_;
+    std::map<uint64_t, std::set<uint32_t> > earlyDone_;   // reports for epochs not yet seen
+    StationMap stations_;
+    std::unordered_map<uint32_t, std::vector<TraceSample> > queued_;   // by station, in arrival order
+    size_t queuedCount_;
+    bool tracking_;
+    std::vector<StationMap::value_type*> changed_;   // map nodes do not move on rehash
+    std::vector<uint32_t> removed_;
+    uint64_t samplesApplied_;
+    uint64_t checkpointsAdopted_;
+    uint64_t checkpointsHandedOff_;
+
+    StationMap::iterator findOrAddStation(uint32_t stationId);
+    StationMap::iterator eraseStation(StationMap::iterator it);
+
+    void markChanged(StationMap::value_type& station) {
+        if (tracking_ && !station.second.changed) {
+            station.second.changed = true;
+            changed_.push_back(&station);
+        }
+    }
+
+    // Non-copyable (changed_ points into stations_)
+    StationPartition(const StationPartition&);
+    StationPartition& operator=(const StationPartition&);
+};
+
+/**
+ * One node's counters, as reported over its socket
+ */
+struct PartitionNodeStatus {
+    uint64_t epoch;
+    bool settled;
+    uint32_t stations;
+    uint32_t queued;
+    uint64_t samplesApplied;
+    uint64_t samplesForwarded;
+    uint64_t checkpointsAdopted;
+    uint64_t checkpointsHandedOff;
+};
+
+/**
+ * PartitionNode - An aggregator process serving its StationPartition
+ *
+ * Listens on a Unix stream socket, <directory>/node-<id>.sock, and serves
+ * samples, membership changes, handoffs and queries from clients and peer
+ * nodes in one poll() loop. Frames are a native-endian length and type
+ * followed by the fields, so nodes must share a host (and a build).
+ *
+ * On a membership change the node sends each new owner its stations'
+ * checkpoints, then tells every new member it is done; samples for
+ * stations owned elsewhere are forwarded to the owner. Peer sockets are
+ * non-blocking: frames the socket buffer cannot take wait in the peer's
+ * queue and go out on POLLOUT, so nodes handing off to each other keep
+ * reading whatever the handoff's size.
+ */
+class PartitionNode {
+public:
+    PartitionNode(const std::string& directory, uint32_t nodeId, const TraceReplayer& prototype);
+    ~PartitionNode();
+
+    /**
+     * Create the socket, replacing a stale one
+     * @return false if it cannot be bound
+     */
+    bool listen();
+
+    /**
+     * Serve until a shutdown message arrives
+     * @return false if polling fails
+     */
+    bool run();
+
+    /**
+     * Stream the partition's changes to a standby listening at standbyPath
+     * (see ReplicationPrimary); call before run()
+     */
+    void setStandby(const std::string& standbyPath);
+
+    const StationPartition& getPartition() const { return partition_; }
+
+    /**
+     * The partition itself, for a standby to fill before run()
+     */
+    StationPartition& getPartition() { return partition_; }
+
+    uint64_t getSamplesForwarded() const { return samplesForwarded_; }
+    unsigned long getSendErrors() const { return sendErrors_; }
+
+    static std::string socketPath(const std::string& directory, uint32_t nodeId);
+
+private:
+    struct Connection {
+        int fd;
+        FrameReader reader;
+    };
+
+    struct Peer {
+        int fd;
+        FrameWriter writer;
+    };
+    typedef std::map<uint32_t, Peer> PeerMap;
+
+    std::string directory_;
+    StationPartition partition_;
+    std::unique_ptr<ReplicationPrimary> replication_;
+    int listenFd_;
+    std::vector<Connection> connections_;
+    PeerMap peers_;   // outgoing, to other nodes
+    uint64_t samplesForwarded_;
+    unsigned long sendErrors_;
+    bool stopping_;
+
+    bool handleFrame(int fd, uint8_t type, const uint8_t* payload, size_t length);
+    void forward(const TraceSample& sample, uint32_t owner);
+    void sendToPeer(uint32_t nodeId, const std::vector<uint8_t>& frame);
+    void dropPeer(PeerMap::iterator it);
+    void finishSends();
+    void drain();
+
+    // Non-copyable
+    PartitionNode(const PartitionNode&);
+    PartitionNode& operator=(const PartitionNode&);
+};
+
+/**
+ * PartitionClient - Feeds and queries a set of PartitionNodes
+ *
+ * Keeps its own copy of the ring to send each sample straight to its
+ * owner, and announces membership changes (it is the coordinator: the
+ * epoch and the previous member list come from it).
+ */
+class PartitionClient {
+public:
+    explicit PartitionClient(const std::string& directory);
+    ~PartitionClient();
+
+    /**
+     * Announce a new member list to the old and new members; let the
+     * previous change settle (waitSettled()) before announcing the next
+     * @return false if a node could not be reached
+     */
+    bool setMembers(const std::vector<uint32_t>& members);
+
+    /**
+     * Send a sample to the station's owner
+     */
+    bool send(const TraceSample& sample);
+
+    /**
+     * Fetch a station's checkpoint from its owner, waiting out a handoff
+     * @param found - false if no node holds the station
+     * @return false on a socket error or timeout
+     */
+    bool query(uint32_t stationId, StationCheckpoint& out, bool* found);
+
+    bool getStatus(uint32_t nodeId, PartitionNodeStatus& out);
+
+    /**
+     * Wait until every member has received its handoffs
+     */
+    bool waitSettled(unsigned long timeoutMs);
+
+    /**
+     * Stop a node's run() loop
+     */
+    bool shutdown(uint32_t nodeId);
+
+    const ConsistentHashRing& getRing() const { return ring_; }
+
+private:
+    std::string directory_;
+    ConsistentHashRing ring_;
+    uint64_t epoch_;
+    std::map<uint32_t, int> nodes_;
+
+    int connectionTo(uint32_t nodeId);
+    bool request(uint32_t nodeId, const std::vector<uint8_t>& frame, uint8_t replyType, std::vector<uint8_t>& reply);
+    void disconnect(uint32_t nodeId);
+
+    // Non-copyable
+    PartitionClient(const PartitionClient&);
+    PartitionClient& operator=(const PartitionClient&);
+};
+
+#endif // STATION_PARTITION_H
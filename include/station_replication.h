@@ -0,0 +1,196 @@
+#ifndef STATION_REPLICATION_H
+#define STATION_REPLICATION_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "station_partition.h"
+
+#define REPLICATION_BATCH_INTERVAL_MS 1000  // a crash loses at most this much progress
+#define REPLICATION_HEARTBEAT_MS 100        // between batches, while the owner's loop is alive
+#define REPLICATION_FAILOVER_MS 300         // silence before the standby takes over
+#define REPLICATION_MAX_QUEUED_BATCHES 64   // a standby further behind is sent a full snapshot instead
+
+/**
+ * One batch of a partition's changes
+ */
+struct ReplicationBatch {
+    uint64_t sequence;
+    uint64_t epoch;
+    bool full;                           // changed replaces every station
+    bool closing;                        // clean shutdown: the standby must not take over
+    std::vector<uint32_t> members;
+    std::vector<StationCheckpoint> changed;
+    std::vector<uint32_t> removed;
+
+    ReplicationBatch();
+};
+
+/**
+ * ReplicationCodec - Delta compression of replication batches
+ *
+ * Both ends remember the last checkpoint sent for each station. A station
+ * is encoded as the delta from the previous station ID and, per channel, a
+ * byte of changed-field bits followed by only those fields: integers and
+ * timestamps as zigzag varint deltas, floats raw. A typical update (new
+ * sample time, same reading) takes about a dozen bytes instead of a full
+ * checkpoint.
+ */
+class ReplicationCodec {
+public:
+    /**
+     * Forget the shared history (a new connection)
+     */
+    void reset();
+
+    /**
+     * Append the batch's encoding to out
+     */
+    void encode(const ReplicationBatch& batch, std::vector<uint8_t>& out);
+
+    /**
+     * @return false on a malformed payload, after which the history is
+     *         undefined until reset()
+     */
+    bool decode(const uint8_t* data, size_t length, ReplicationBatch& out);
+
+    size_t getStationCount() const { return last_.size(); }
+
+private:
+    std::unordered_map<uint32_t, StationCheckpoint> last_;
+};
+
+/**
+ * What a primary has sent
+ */
+struct ReplicationStats {
+    uint64_t batches;
+    uint64_t droppedBatches;   // while disconnected or too far behind
+    uint64_t stations;         // checkpoints sent
+    uint64_t rawBytes;         // their size as StationCheckpoints
+    uint64_t sentBytes;        // bytes written, frames included
+    unsigned long connects;
+};
+
+/**
+ * ReplicationPrimary - Streams a partition's changes to a hot standby
+ *
+ * The partition's owner calls publish() every REPLICATION_BATCH_INTERVAL_MS
+ * (PartitionNode does so from its poll loop). That takes the checkpoints of
+ * the stations changed since the last batch, which the partition tracks
+ * with a flag per station, and queues them; a sender thread compresses and
+ * writes the batches, so the update path never waits on the standby. After
+ * each (re)connection the standby first gets a full snapshot.
+ *
+ * Copying the changed checkpoints is the owner's whole cost, paid once per
+ * station per batch however many samples it took, which is why batches
+ * are far apart. Failure detection does not wait for them: between
+ * batches the sender heartbeats every REPLICATION_HEARTBEAT_MS, but only
+ * while the owner keeps calling keepAlive(), so a hung loop goes silent.
+ */
+class ReplicationPrimary {
+public:
+    ReplicationPrimary(StationPartition& partition, const std::string& standbyPath);
+    ~ReplicationPrimary();
+
+    /**
+     * Turn on change tracking and start the sender thread
+     */
+    void start();
+
+    /**
+     * Queue the changes since the previous call (owner's thread only)
+     */
+    void publish();
+
+    /**
+     * The owner's loop is still turning (cheap; call every round)
+     */
+    void keepAlive() { alive_ = true; }
+
+    /**
+     * Send the last changes marked closing, so the standby does not take
+     * over, and join the sender
+     */
+    void stop();
+
+    ReplicationStats getStats() const;
+    bool isConnected() const { return connected_; }
+
+private:
+    StationPartition& partition_;
+    std::string standbyPath_;
+    uint64_t sequence_;
+    std::atomic<bool> needFull_;
+    std::atomic<bool> connected_;
+    std::atomic<bool> alive_;   // keepAlive() since the last heartbeat
+
+    mutable std::mutex mutex_;          // queue_, spare_, stopping_, stats_
+    std::condition_variable wake_;
+    std::vector<ReplicationBatch> queue_;
+    std::vector<ReplicationBatch> spare_;   // sent, kept for their capacity
+    bool stopping_;
+    ReplicationStats stats_;
+    std::thread sender_;
+
+    void enqueue(bool closing);
+    void sendLoop();
+
+    // Non-copyable
+    ReplicationPrimary(const ReplicationPrimary&);
+    ReplicationPrimary& operator=(const ReplicationPrimary&);
+};
+
+/**
+ * ReplicationStandby - Mirrors a primary's partition and detects its failure
+ *
+ * Listens for the primary's connection and applies each batch to a replica
+ * partition. The primary has failed when its connection drops without a
+ * closing batch (a crash is seen at once) or it is silent for
+ * REPLICATION_FAILOVER_MS (hung); the caller then serves the replica in its
+ * place, e.g. as a PartitionNode on the primary's socket path.
+ */
+class ReplicationStandby {
+public:
+    explicit ReplicationStandby(const std::string& socketPath);
+    ~ReplicationStandby();
+
+    /**
+     * @return false if the socket cannot be bound
+     */
+    bool listen();
+
+    /**
+     * Apply the primary's batches to replica until it fails; after a clean
+     * shutdown, wait for the next primary
+     * @return false on a socket error
+     */
+    bool runUntilFailover(StationPartition& replica, unsigned long silenceMs = REPLICATION_FAILOVER_MS);
+
+    uint64_t getBatchesApplied() const { return batchesApplied_; }
+    uint64_t getLastSequence() const { return lastSequence_; }
+
+    /**
+     * Where node nodeId's standby listens: <directory>/standby-<id>.sock
+     */
+    static std::string socketPath(const std::string& directory, uint32_t nodeId);
+
+private:
+    std::string socketPath_;
+    int listenFd_;
+    ReplicationCodec codec_;
+    uint64_t batchesApplied_;
+    uint64_t lastSequence_;
+
+    // Non-copyable
+    ReplicationStandby(const ReplicationStandby&);
+    ReplicationStandby& operator=(const ReplicationStandby&);
+};
+
+#endif // STATION_REPLICATION_H
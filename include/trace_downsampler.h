@@ -0,0 +1,163 @@
+#ifndef TRACE_DOWNSAMPLER_H
+#define TRACE_DOWNSAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "line_tokenizer.h"
+#include "trace_replayer.h"
+#include "trace_sample.h"
+
+/**
+ * What a downsampled point is
+ */
+enum DownsamplePointKind {
+    DOWNSAMPLE_POINT_SAMPLE = 0,   // a raw reading picked for the plot
+    DOWNSAMPLE_POINT_STABLE,       // the reading that made the debouncer stable, always kept
+    DOWNSAMPLE_POINT_UNSTABLE      // the reading that broke stability, always kept
+};
+
+struct DownsamplePoint {
+    unsigned long timeMs;
+    float value;        // the raw reading
+    uint8_t kind;       // DownsamplePointKind
+};
+
+/**
+ * Bucket layout of a downsampled series
+ */
+struct DownsampleConfig {
+    unsigned long fromMs;      // start of the first bucket
+    unsigned long bucketMs;    // one point per bucket, e.g. the time a pixel spans
+
+    DownsampleConfig();
+
+    /**
+     * Buckets giving about `points` points between fromMs and toMs
+     */
+    static DownsampleConfig forRange(unsigned long fromMs, unsigned long toMs, size_t points);
+};
+
+/**
+ * LttbDownsampler - Streaming largest-triangle-three-buckets over one series
+ *
+ * Keeps the first and last points and one point per time bucket: the one
+ * spanning the largest triangle with the point kept before it and the mean
+ * of the next bucket. That choice waits for the next bucket, so at most two
+ * buckets of points are held and points come out two buckets behind the
+ * input. Points added with a transition kind are always kept as well, in
+ * time order with the bucket's pick, and the next triangle is anchored on
+ * the last of them.
+ *
+ * Times are expected in order; a point earlier than the open bucket is
+ * counted in that bucket.
+ */
+class LttbDownsampler {
+public:
+    explicit LttbDownsampler(const DownsampleConfig& config);
+
+    /**
+     * Add the next point
+     * @param out - receives the points decided so far
+     */
+    void add(const DownsamplePoint& point, std::vector<DownsamplePoint>& out);
+
+    /**
+     * End the series: decide the buffered buckets and keep the last point
+     */
+    void finish(std::vector<DownsamplePoint>& out);
+
+    /**
+     * Start a new series
+     */
+    void reset();
+
+    unsigned long getPointsIn() const { return pointsIn_; }
+    unsigned long getPointsOut() const { return pointsOut_; }
+
+private:
+    struct Bucket {
+        unsigned long index;
+        std::vector<DownsamplePoint> points;
+        double sumTimeMs;
+        double sumValue;
+
+        Bucket() : index(0), sumTimeMs(0.0), sumValue(0.0) {}
+        void clear();
+        void push(const DownsamplePoint& point);
+    };
+
+    DownsampleConfig config_;
+    bool started_;
+    DownsamplePoint anchor_;   // last point kept
+    Bucket pending_;           // complete, waiting for the next bucket's mean
+    Bucket open_;
+    unsigned long pointsIn_;
+    unsigned long pointsOut_;
+
+    void emit(const DownsamplePoint& point, std::vector<DownsamplePoint>& out);
+    void select(const Bucket& bucket, double nextTimeMs, double nextValue, std::vector<DownsamplePoint>& out);
+};
+
+/**
+ * TraceDownsampler - Plot-ready points of one device's trace
+ *
+ * Runs the samples of one device (a trace file, or the columns a
+ * LineTokenizer produced from it) through that device's debouncers and an
+ * LttbDownsampler per channel, marking the samples that made a channel
+ * stable or unstable so the plot's stable bands start and end exactly
+ * where the debouncer's did. One pass, memory bounded by two buckets per
+ * channel plus the points not yet taken.
+ */
+class TraceDownsampler : public TraceSampleSink, private StabilityTransitionSink {
+public:
+    /**
+     * Constructor with explicit debouncer configurations
+     */
+    TraceDownsampler(const DownsampleConfig& config, const HeightDebouncer& height,
+                     const ReadingDebouncer<float>& bpm, const ReadingDebouncer<int>& spo2);
+
+    /**
+     * Constructor using config.h debouncers
+     */
+    explicit TraceDownsampler(const DownsampleConfig& config);
+
+    virtual void onSample(const TraceSample& sample);
+
+    /**
+     * Add a block of tokenized columns, channel by channel (the channels are
+     * independent, so their relative order does not matter)
+     */
+    void addColumns(const LogColumns& columns);
+
+    /**
+     * End the trace; every point is then in getPoints()
+     */
+    void finish();
+
+    /**
+     * Points decided so far for a channel, in time order
+     */
+    const std::vector<DownsamplePoint>& getPoints(uint8_t channel) const { return points_[channel]; }
+
+    /**
+     * Forget the points handed on so far (streaming to a client)
+     */
+    void clearPoints();
+
+    const LttbDownsampler& getSeries(uint8_t channel) const { return series_[channel]; }
+
+private:
+    TraceReplayer replayer_;
+    LttbDownsampler series_[SAMPLE_CHANNEL_COUNT];
+    std::vector<DownsamplePoint> points_[SAMPLE_CHANNEL_COUNT];
+    uint8_t kind_;   // set by onTransition() while the replayer takes a sample
+
+    virtual void onTransition(const StabilityTransition& transition);
+
+    // Non-copyable (the replayer reports to this object)
+    TraceDownsampler(const TraceDownsampler&);
+    TraceDownsampler& operator=(const TraceDownsampler&);
+};
+
+#endif // TRACE_DOWNSAMPLER_H
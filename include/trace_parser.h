@@ -0,0 +1,114 @@
+#ifndef TRACE_PARSER_H
+#define TRACE_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "sample_frame.h"
+#include "trace_sample.h"
+
+/**
+ * TraceParser - Incremental parser for the instruments' serial logs
+ *
+ * Recognizes the two line formats printed by the sketches:
+ *   height_meter.ino:   "Raw: 123 cm | Stable: YES (123 cm)"
+ *   pulse_oximeter.ino: "[12345ms] RAW - BPM:72.50 SpO2:97%"
+ * All other lines are skipped. Input may be fed in arbitrary blocks; a line
+ * split across two blocks is carried over and parsed once complete.
+ *
+ * Height lines carry no timestamp, so their time is synthesized from the
+ * sketch's loop period starting at 0.
+ */
+class TraceParser {
+public:
+    /**
+     * Constructor
+     * @param sink - receives every parsed sample
+     * @param deviceId - device id stamped on every sample
+     * @param heightIntervalMs - synthesized time step between height lines
+     */
+    TraceParser(TraceSampleSink* sink, uint32_t deviceId, unsigned long heightIntervalMs);
+
+    /**
+     * Constructor using DEBOUNCE_SAMPLE_INTERVAL_MS as the height time step
+     */
+    TraceParser(TraceSampleSink* sink, uint32_t deviceId);
+
+    /**
+     * Parse a block of log text
+     * @param data - block contents, need not end on a line boundary
+     * @param length - block length in bytes
+     */
+    void feed(const char* data, size_t length);
+
+    /**
+     * Parse any trailing line that was not newline-terminated
+     */
+    void finish();
+
+    /**
+     * Reset the parser to its initial state
+     */
+    void reset();
+
+    /**
+     * Synthesized time of the next height line; setting it continues a log
+     * from the line boundary where another parser stopped
+     */
+    unsigned long getNextHeightTimeMs() const { return nextHeightTimeMs_; }
+    void setNextHeightTimeMs(unsigned long timeMs) { nextHeightTimeMs_ = timeMs; }
+
+    unsigned long getLinesParsed() const { return linesParsed_; }
+    unsigned long getLinesSkipped() const { return linesSkipped_; }
+    uint32_t getDeviceId() const { return deviceId_; }
+
+private:
+    TraceSampleSink* sink_;
+    uint32_t deviceId_;
+    unsigned long heightIntervalMs_;
+    unsigned long nextHeightTimeMs_;
+    unsigned long linesParsed_;
+    unsigned long linesSkipped_;
+    std::string carry_;
+
+    void parseLine(const char* begin, const char* end);
+    bool parseHeightLine(const char* p, const char* end);
+    bool parseOximeterLine(const char* p, const char* end);
+    void emit(unsigned long timeMs, float value, uint8_t channel);
+};
+
+/**
+ * FrameTraceParser - Incremental parser for the binary sample protocol
+ *
+ * Counterpart of TraceParser for streams of SampleFrame records. Frames may
+ * straddle block boundaries; on a bad sync byte or checksum the parser
+ * slides forward one byte and resynchronizes.
+ */
+class FrameTraceParser {
+public:
+    explicit FrameTraceParser(TraceSampleSink* sink);
+
+    /**
+     * Parse a block of frame bytes
+     */
+    void feed(const uint8_t* data, size_t length);
+
+    /**
+     * Reset the parser to its initial state
+     */
+    void reset();
+
+    unsigned long getFramesParsed() const { return framesParsed_; }
+    unsigned long getBytesSkipped() const { return bytesSkipped_; }
+
+private:
+    TraceSampleSink* sink_;
+    uint8_t pending_[SAMPLE_FRAME_SIZE];
+    size_t pendingLength_;
+    unsigned long framesParsed_;
+    unsigned long bytesSkipped_;
+
+    void consume(const uint8_t* frameBytes);
+};
+
+#endif // TRACE_PARSER_H
@@ -0,0 +1,105 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Receives file contents block by block, in file order
+ */
+class TraceBlockHandler {
+public:
+    virtual ~TraceBlockHandler() {}
+
+    /**
+     * Called for each block of a file, in increasing offset order
+     * @param fileIndex - index of the file in the list passed to run()
+     * @param data - block contents, valid only for the duration of the call
+     * @param length - block length in bytes
+     */
+    virtual void onBlock(size_t fileIndex, const char* data, size_t length) = 0;
+
+    /**
+     * Called once after the last block of a file (or after a read error)
+     */
+    virtual void onFileEnd(size_t fileIndex) = 0;
+};
+
+/**
+ * Reader configuration
+ */
+struct TraceReaderOptions {
+    size_t blockSize;             // bytes per read
+    unsigned queueDepth;          // reads kept in flight across all files
+    unsigned maxInFlightPerFile;  // reads kept in flight within one file
+    bool useIoUring;              // try io_uring before the pread fallback
+
+    TraceReaderOptions()
+        : blockSize(256 * 1024)
+        , queueDepth(64)
+        , maxInFlightPerFile(4)
+        , useIoUring(true)
+    {
+    }
+};
+
+/**
+ * AsyncTraceReader - Streams many trace files through a block handler
+ *
+ * Keeps up to queueDepth reads in flight over a fixed set of buffers and
+ * delivers each file's blocks in order as they complete. On Linux the reads
+ * go through io_uring with the buffers registered up front. If buffers
+ * cannot be registered, or the kernel's probe lacks IORING_OP_READ_FIXED,
+ * plain IORING_OP_READ is used instead. Where io_uring or both opcodes are
+ * unavailable (older kernels, seccomp, other platforms) the same schedule
+ * is served by synchronous pread().
+ */
+class AsyncTraceReader {
+public:
+    explicit AsyncTraceReader(const TraceReaderOptions& options = TraceReaderOptions());
+    ~AsyncTraceReader();
+
+    /**
+     * Read every file and feed it to the handler
+     * @param paths - files to read
+     * @param handler - receives blocks and end-of-file notifications
+     * @return true if every file was read completely
+     */
+    bool run(const std::vector<std::string>& paths, TraceBlockHandler& handler);
+
+    /**
+     * Check which backend served the last run()
+     */
+    bool isUsingIoUring() const { return usingIoUring_; }
+
+    /**
+     * Check whether io_uring buffers were registered for the last run()
+     */
+    bool hasRegisteredBuffers() const { return registeredBuffers_; }
+
+    uint64_t getBytesRead() const { return bytesRead_; }
+    size_t getFilesFailed() const { return filesFailed_; }
+
+private:
+    class Backend;
+    class SyncBackend;
+    class UringBackend;
+
+    struct FileState;
+    struct Slot;
+
+    TraceReaderOptions options_;
+    char* buffers_;
+    bool usingIoUring_;
+    bool registeredBuffers_;
+    uint64_t bytesRead_;
+    size_t filesFailed_;
+
+    // Non-copyable
+    AsyncTraceReader(const AsyncTraceReader&);
+    AsyncTraceReader& operator=(const AsyncTraceReader&);
+};
+
+#endif // TRACE_READER_H
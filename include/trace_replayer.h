@@ -0,0 +1,161 @@
+#ifndef TRACE_REPLAYER_H
+#define TRACE_REPLAYER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "adaptive_tolerance.h"
+#include "height_debouncer.h"
+#include "reading_debouncer.h"
+#include "trace_parser.h"
+#include "trace_reader.h"
+#include "trace_sample.h"
+
+/**
+ * TraceReplayer - Runs parsed samples through the instruments' debouncers
+ *
+ * Holds one HeightDebouncer and the BPM/SpO2 ReadingDebouncers for a single
+ * device and reports every stability transition (and every change of a
+ * stable reading) to an optional sink. An optional event sink also sees
+ * the debouncer's decision for every sample (skips, resets, dropouts).
+ * In adaptive mode each channel's tolerance follows its own measured
+ * noise floor, within the approved bounds in config.h.
+ */
+class TraceReplayer : public TraceSampleSink {
+public:
+    /**
+     * Constructor with explicit debouncer configurations
+     * @param height - prototype for the height channel
+     * @param bpm - prototype for the BPM channel
+     * @param spo2 - prototype for the SpO2 channel
+     * @param sink - receives stability transitions, may be NULL
+     */
+    TraceReplayer(const HeightDebouncer& height, const ReadingDebouncer<float>& bpm,
+                  const ReadingDebouncer<int>& spo2, StabilityTransitionSink* sink);
+
+    /**
+     * Constructor using config.h values
+     */
+    explicit TraceReplayer(StabilityTransitionSink* sink);
+
+    virtual void onSample(const TraceSample& sample);
+
+    /**
+     * Report a DebounceEvent for every sample (NULL to stop)
+     */
+    void setEventSink(DebounceEventSink* sink) { eventSink_ = sink; }
+
+    /**
+     * Adapt tolerances to the measured noise (off by default). The noise
+     * estimates belong to the device and survive reset().
+     */
+    void setAdaptiveTolerance(bool enabled) { adaptive_ = enabled; }
+    bool isAdaptiveTolerance() const { return adaptive_; }
+
+    /**
+     * Reset all debouncers and counters
+     */
+    void reset();
+
+    /**
+     * Continue the debouncers from checkpoints taken on another replayer
+     * (rebalancing a station between processes); counters are unchanged
+     */
+    void restore(const HeightDebouncer::Checkpoint& height, const ReadingDebouncer<float>::Checkpoint& bpm,
+                 const ReadingDebouncer<int>::Checkpoint& spo2);
+
+    const HeightDebouncer& getHeightDebouncer() const { return height_; }
+    const ReadingDebouncer<float>& getBpmDebouncer() const { return bpm_; }
+    const ReadingDebouncer<int>& getSpo2Debouncer() const { return spo2_; }
+    unsigned long getSamplesProcessed() const { return samplesProcessed_; }
+    unsigned long getTransitionCount() const { return transitionCount_; }
+    const AdaptiveTolerance<int>& getHeightTolerance() const { return heightTolerance_; }
+    const AdaptiveTolerance<float>& getBpmTolerance() const { return bpmTolerance_; }
+    const AdaptiveTolerance<int>& getSpo2Tolerance() const { return spo2Tolerance_; }
+
+private:
+    HeightDebouncer height_;
+    ReadingDebouncer<float> bpm_;
+    ReadingDebouncer<int> spo2_;
+    StabilityTransitionSink* sink_;
+    DebounceEventSink* eventSink_;
+    AdaptiveTolerance<int> heightTolerance_;
+    AdaptiveTolerance<float> bpmTolerance_;
+    AdaptiveTolerance<int> spo2Tolerance_;
+    bool adaptive_;
+    unsigned long samplesProcessed_;
+    unsigned long transitionCount_;
+
+    void report(const TraceSample& sample, bool stable, float value);
+    void reportUpdate(const TraceSample& sample, float value);
+    void reportEvent(const TraceSample& sample, uint8_t type);
+};
+
+/**
+ * TraceFileReplay - Block handler that parses and replays each file
+ *
+ * Every file is treated as the log of one device, whose id is the file's
+ * index. Parser and debouncer state exist only while the file is open.
+ */
+class TraceFileReplay : public TraceBlockHandler {
+public:
+    /**
+     * Constructor with explicit debouncer configurations
+     */
+    TraceFileReplay(const HeightDebouncer& height, const ReadingDebouncer<float>& bpm,
+                    const ReadingDebouncer<int>& spo2, StabilityTransitionSink* sink);
+
+    /**
+     * Constructor using config.h values
+     */
+    explicit TraceFileReplay(StabilityTransitionSink* sink);
+
+    virtual ~TraceFileReplay();
+
+    /**
+     * Report debouncer decisions of every file (set before reading starts)
+     */
+    void setEventSink(DebounceEventSink* sink) { prototype_.setEventSink(sink); }
+
+    /**
+     * Adapt tolerances to each file's measured noise (set before reading starts)
+     */
+    void setAdaptiveTolerance(bool enabled) { prototype_.setAdaptiveTolerance(enabled); }
+
+    virtual void onBlock(size_t fileIndex, const char* data, size_t length);
+    virtual void onFileEnd(size_t fileIndex);
+
+    unsigned long getFilesCompleted() const { return filesCompleted_; }
+    unsigned long getSamplesProcessed() const { return samplesProcessed_; }
+    unsigned long getTransitionCount() const { return transitionCount_; }
+    unsigned long getLinesParsed() const { return linesParsed_; }
+    unsigned long getLinesSkipped() const { return linesSkipped_; }
+
+private:
+    struct Stream {
+        TraceReplayer replayer;
+        TraceParser parser;
+
+        Stream(const TraceReplayer& prototype, uint32_t deviceId)
+            : replayer(prototype)
+            , parser(&replayer, deviceId)
+        {
+        }
+    };
+
+    TraceReplayer prototype_;
+    std::vector<Stream*> streams_;
+    unsigned long filesCompleted_;
+    unsigned long samplesProcessed_;
+    unsigned long transitionCount_;
+    unsigned long linesParsed_;
+    unsigned long linesSkipped_;
+
+    Stream* streamFor(size_t fileIndex);
+
+    // Non-copyable
+    TraceFileReplay(const TraceFileReplay&);
+    TraceFileReplay& operator=(const TraceFileReplay&);
+};
+
+#endif // TRACE_REPLAYER_H
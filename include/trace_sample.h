@@ -0,0 +1,99 @@
+#ifndef TRACE_SAMPLE_H
+#define TRACE_SAMPLE_H
+
+#include <cstdint>
+
+/**
+ * Measurement channels produced by the instruments
+ */
+enum SampleChannel {
+    CHANNEL_HEIGHT = 0,  // HeightDebouncer, cm
+    CHANNEL_BPM = 1,     // ReadingDebouncer<float>, beats per minute
+    CHANNEL_SPO2 = 2     // ReadingDebouncer<int>, percent
+};
+
+#define SAMPLE_CHANNEL_COUNT 3
+
+/**
+ * TraceSample - One raw reading recovered from a serial log or trace file
+ */
+struct TraceSample {
+    uint32_t deviceId;
+    unsigned long timeMs;
+    float value;
+    uint8_t channel;
+};
+
+/**
+ * StabilityTransition - A debouncer entering or leaving the stable state
+ *
+ * value is the stable reading when stable is true, otherwise the reading
+ * that broke stability.
+ */
+struct StabilityTransition {
+    uint32_t deviceId;
+    unsigned long timeMs;
+    float value;
+    uint8_t channel;
+    bool stable;
+};
+
+/**
+ * What a debouncer did with one sample
+ */
+enum DebounceEventType {
+    DEBOUNCE_EVENT_SKIPPED = 0,       // arrived before the sample interval
+    DEBOUNCE_EVENT_ACCEPTED,          // within tolerance, no state change
+    DEBOUNCE_EVENT_FIRST_READING,     // first valid reading started the stability timer
+    DEBOUNCE_EVENT_INVALID_RESET,     // out-of-range reading (sensor dropout) reset the debouncer
+    DEBOUNCE_EVENT_TOLERANCE_RESET,   // reading moved outside tolerance, timer restarted
+    DEBOUNCE_EVENT_STABLE             // debouncer became stable
+};
+
+#define DEBOUNCE_EVENT_TYPE_COUNT 6
+
+/**
+ * DebounceEvent - One debouncer decision, for health monitoring
+ */
+struct DebounceEvent {
+    uint32_t deviceId;
+    unsigned long timeMs;
+    float value;       // the sample
+    uint8_t channel;
+    uint8_t type;      // DebounceEventType
+};
+
+/**
+ * Receives samples as they are parsed
+ */
+class TraceSampleSink {
+public:
+    virtual ~TraceSampleSink() {}
+    virtual void onSample(const TraceSample& sample) = 0;
+};
+
+/**
+ * Receives stability transitions as debouncers change state
+ */
+class StabilityTransitionSink {
+public:
+    virtual ~StabilityTransitionSink() {}
+    virtual void onTransition(const StabilityTransition& transition) = 0;
+
+    /**
+     * Called when a channel stays stable but its stable reading moves
+     * (within tolerance); transition.stable is true. Optional.
+     */
+    virtual void onStableUpdate(const StabilityTransition& transition) { (void)transition; }
+};
+
+/**
+ * Receives a decision for every sample a debouncer is given
+ */
+class DebounceEventSink {
+public:
+    virtual ~DebounceEventSink() {}
+    virtual void onDebounceEvent(const DebounceEvent& event) = 0;
+};
+
+#endif // TRACE_SAMPLE_H
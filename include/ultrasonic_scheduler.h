@@ -0,0 +1,128 @@
+#ifndef ULTRASONIC_SCHEDULER_H
+#define ULTRASONIC_SCHEDULER_H
+
+#include <cstdint>
+
+#define ULTRASONIC_MAX_HEADS 4
+
+/**
+ * Trigger side of the ultrasonic heads (pulses TRIG of one HC-SR04)
+ */
+class UltrasonicPort {
+public:
+    virtual ~UltrasonicPort() {}
+    virtual void trigger(uint8_t head) = 0;
+};
+
+/**
+ * Echo side of the ultrasonic heads (level changes of one ECHO pin)
+ */
+class UltrasonicEchoSink {
+public:
+    virtual ~UltrasonicEchoSink() {}
+    virtual void onEchoEdge(uint8_t head, bool high, unsigned long nowUs) = 0;
+};
+
+/**
+ * Scheduler settings
+ */
+struct UltrasonicSchedulerConfig {
+    uint8_t heads;
+    unsigned long frameUs;          // one fused reading per frame
+    unsigned long guardUs;          // between triggers of heads that hear each other
+    unsigned long echoTimeoutUs;    // longer echoes count as no echo
+    uint8_t hears[ULTRASONIC_MAX_HEADS];   // bit j of hears[i]: head i picks up head j's pulses
+
+    /**
+     * One head, DEBOUNCE_SAMPLE_INTERVAL_MS frames and the config.h guard;
+     * every head hears every other until told otherwise
+     */
+    UltrasonicSchedulerConfig();
+};
+
+/**
+ * The readings of one frame
+ */
+struct UltrasonicFrame {
+    unsigned long timeMs;                       // end of the frame
+    int distanceCm[ULTRASONIC_MAX_HEADS];       // 0 for no echo, like NewPing
+    uint8_t validMask;                          // heads that returned an echo
+    int fusedCm;                                // median of the valid heads, 0 if none
+};
+
+/**
+ * UltrasonicScheduler - Interleaved triggering of several HC-SR04 heads
+ *
+ * Heads that cannot hear each other share a trigger slot; heads that can
+ * get slots guardUs apart, so one head's echo and ring-down are over
+ * before the next one fires. With the default 20 ms guard, four heads fit
+ * into the 100 ms sample interval of a single head.
+ *
+ * Nothing blocks: poll() from loop() fires the slots that are due, and the
+ * echo pin edges (pin-change interrupt, or the host simulator) are passed
+ * to onEchoEdge(). When a frame ends, its per-head distances and their
+ * median are available from takeFrame(), ready for one HeightDebouncer per
+ * head or a single fused one.
+ */
+class UltrasonicScheduler : public UltrasonicEchoSink {
+public:
+    UltrasonicScheduler(UltrasonicPort* port, const UltrasonicSchedulerConfig& config);
+
+    /**
+     * Start the first frame at nowUs
+     */
+    void begin(unsigned long nowUs);
+
+    /**
+     * Fire due triggers and close the frame when its time is up
+     * @return true if a frame was completed
+     */
+    bool poll(unsigned long nowUs);
+
+    /**
+     * Echo pin of a head changed level
+     */
+    virtual void onEchoEdge(uint8_t head, bool high, unsigned long nowUs);
+
+    /**
+     * Take the last completed frame
+     * @return false if none was completed since the last call
+     */
+    bool takeFrame(UltrasonicFrame& out);
+
+    uint8_t getSlotCount() const { return slotCount_; }
+    uint8_t getSlot(uint8_t head) const { return head < config_.heads ? slots_[head] : 0; }
+    unsigned long getFramePeriodUs() const { return framePeriodUs_; }
+    unsigned long getFramesCompleted() const { return framesCompleted_; }
+    const UltrasonicSchedulerConfig& getConfig() const { return config_; }
+
+private:
+    enum HeadState {
+        HEAD_IDLE,
+        HEAD_TRIGGERED,     // waiting for the echo to rise
+        HEAD_ECHO,          // echo high
+        HEAD_DONE
+    };
+
+    UltrasonicPort* port_;
+    UltrasonicSchedulerConfig config_;
+    uint8_t slots_[ULTRASONIC_MAX_HEADS];
+    uint8_t slotCount_;
+    unsigned long framePeriodUs_;
+
+    unsigned long frameStartUs_;
+    uint8_t nextSlot_;
+    uint8_t state_[ULTRASONIC_MAX_HEADS];
+    unsigned long riseUs_[ULTRASONIC_MAX_HEADS];
+    int distanceCm_[ULTRASONIC_MAX_HEADS];
+    bool started_;
+
+    UltrasonicFrame frame_;
+    bool frameReady_;
+    unsigned long framesCompleted_;
+
+    void assignSlots();
+    void closeFrame(unsigned long endUs);
+};
+
+#endif // ULTRASONIC_SCHEDULER_H
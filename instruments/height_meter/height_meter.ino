@@ -8,6 +8,7 @@
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
 #include <NewPing.h>
+#include "include/history_ring.h"
 
 // ============================================
 // CONFIGURATION - Adjust these values as needed
@@ -18,6 +19,19 @@
 #define DEBOUNCE_STABILITY_DURATION_MS 3000  // How long readings must be stable (milliseconds)
 #define DEBOUNCE_SAMPLE_INTERVAL_MS 100      // Time between readings (milliseconds)
 
+// Burst Ranging Settings (set HEIGHT_BURST_MODE to 1 to enable)
+#define HEIGHT_BURST_MODE 0
+#define BURST_AGREE_COUNT 3                  // Agreeing echoes that end a burst
+#define BURST_MAX_PINGS 6                    // Pings before a burst is given up
+#define BURST_PING_GAP_MS 30                 // Time between pings of a burst (milliseconds)
+#define BURST_INTERVAL_MS 250                // Time between bursts (milliseconds)
+#define BURST_STABILITY_DURATION_MS 1000     // How long consensus readings must be stable (milliseconds)
+
+// On-Device History Settings (sent when the host sends HISTORY_DUMP_REQUEST)
+#define HEIGHT_HISTORY_BYTES 512             // RAM for the history, about 7 minutes of samples
+#define HEIGHT_HISTORY_INTERVAL_MS 500       // Time between history samples (milliseconds)
+#define HISTORY_DEVICE_ID 0                  // Identifies this meter in the dumps
+
 // Ultrasonic Sensor Settings
 #define TRIG_PIN 3
 #define ECHO_PIN 2
@@ -126,13 +140,152 @@ private:
     }
 };
 
+// ============================================
+// BurstRanger Class
+// ============================================
+// Ends a burst of pings once BURST_AGREE_COUNT echoes agree and reports
+// their median; lost echoes (0 cm) never vote
+
+class BurstRanger {
+public:
+    static const uint8_t kMaxPings = 16;
+
+    BurstRanger(int toleranceCm, uint8_t agreeCount, uint8_t maxPings)
+        : toleranceCm_(toleranceCm)
+        , agreeCount_(agreeCount > 0 ? agreeCount : 1)
+        , maxPings_(maxPings > kMaxPings ? kMaxPings : (maxPings > 0 ? maxPings : 1))
+        , pingCount_(0)
+        , echoCount_(0)
+        , consensus_(-1)
+        , complete_(false)
+    {
+    }
+
+    BurstRanger()
+        : BurstRanger(DEBOUNCE_TOLERANCE_CM, BURST_AGREE_COUNT, BURST_MAX_PINGS)
+    {
+    }
+
+    void begin() {
+        pingCount_ = 0;
+        echoCount_ = 0;
+        consensus_ = -1;
+        complete_ = false;
+    }
+
+    bool addEcho(int distanceCm) {
+        if (complete_) {
+            return true;
+        }
+        pingCount_++;
+        if (distanceCm <= 0) {
+            // ping_cm() reports a lost echo as 0; it is a miss, not a distance
+            if (pingCount_ >= maxPings_) {
+                complete_ = true;
+            }
+            return complete_;
+        }
+        echoes_[echoCount_++] = distanceCm;
+
+        // Echoes agreeing with the newest one, kept sorted for the median
+        int agreeing[kMaxPings];
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < echoCount_; ++i) {
+            int diff = echoes_[i] - distanceCm;
+            if (diff < 0) diff = -diff;  // Arduino-compatible abs
+            if (diff <= toleranceCm_) {
+                uint8_t j = count++;
+                for (; j > 0 && agreeing[j - 1] > echoes_[i]; --j) {
+                    agreeing[j] = agreeing[j - 1];
+                }
+                agreeing[j] = echoes_[i];
+            }
+        }
+
+        if (count >= agreeCount_) {
+            consensus_ = agreeing[count / 2];
+            complete_ = true;
+        } else if (pingCount_ >= maxPings_) {
+            complete_ = true;
+        }
+        return complete_;
+    }
+
+    bool hasConsensus() const {
+        return consensus_ >= 0;
+    }
+
+    int getConsensus() const {
+        return consensus_;
+    }
+
+    uint8_t getEchoCount() const {
+        return echoCount_;
+    }
+
+private:
+    int toleranceCm_;
+    uint8_t agreeCount_;
+    uint8_t maxPings_;
+    int echoes_[kMaxPings];
+    uint8_t pingCount_;
+    uint8_t echoCount_;
+    int consensus_;
+    bool complete_;
+};
+
 // ============================================
 // Global Objects
 // ============================================
 
 LiquidCrystal_I2C lcd(LCD_I2C_ADDRESS, LCD_COLS, LCD_ROWS);
 NewPing sonar(TRIG_PIN, ECHO_PIN, HEIGHT_MAX_DISTANCE_CM);
+#if HEIGHT_BURST_MODE
+HeightDebouncer debouncer(DEBOUNCE_TOLERANCE_CM, BURST_STABILITY_DURATION_MS, BURST_INTERVAL_MS);
+BurstRanger ranger;
+
+// Ping until the echoes agree; returns -1 if they never did
+int burstPing() {
+    ranger.begin();
+    while (!ranger.addEcho(sonar.ping_cm())) {
+        delay(BURST_PING_GAP_MS);
+    }
+    return ranger.getConsensus();
+}
+#else
 HeightDebouncer debouncer;
+#endif
+
+// ============================================
+// On-Device History
+// ============================================
+
+HistoryRing<HEIGHT_HISTORY_BYTES, 1> history(HEIGHT_HISTORY_INTERVAL_MS);
+unsigned long lastHistoryMs = 0;
+bool historyStable = false;
+
+// Keep one sample per history interval, marking the debouncer's transitions
+void recordHistory(int distance, unsigned long currentTime) {
+    if (debouncer.isStable() != historyStable) {
+        historyStable = debouncer.isStable();
+        history.mark(0, historyStable);
+    }
+    if (history.getSamplesAdded() > 0 && currentTime - lastHistoryMs < HEIGHT_HISTORY_INTERVAL_MS) {
+        return;
+    }
+    lastHistoryMs = currentTime;
+    int16_t value = (int16_t)distance;
+    history.add(currentTime, &value);
+}
+
+// Send the history when the host asks for it
+void serviceDumpRequest() {
+    while (Serial.available() > 0) {
+        if (Serial.read() == HISTORY_DUMP_REQUEST) {
+            history.dump(Serial, HISTORY_DEVICE_ID, millis());
+        }
+    }
+}
 
 // ============================================
 // Setup
@@ -154,11 +307,30 @@ void setup() {
 // ============================================
 
 void loop() {
+    serviceDumpRequest();
+
+#if HEIGHT_BURST_MODE
+    unsigned long burstStart = millis();
+    int distance = burstPing();
+    unsigned long currentTime = millis();
+    if (distance < 0) {
+        if (ranger.getEchoCount() > 0) {
+            return;  // echoes disagreed; try again without disturbing the debouncer
+        }
+        distance = 0;  // every ping was lost: report no object, as a single ping would
+    }
+    if (currentTime - burstStart < BURST_INTERVAL_MS) {
+        delay(BURST_INTERVAL_MS - (currentTime - burstStart));
+        currentTime = millis();
+    }
+#else
     delay(DEBOUNCE_SAMPLE_INTERVAL_MS);
     int distance = sonar.ping_cm();
     unsigned long currentTime = millis();
+#endif
 
     debouncer.update(distance, currentTime);
+    recordHistory(distance, currentTime);
 
     lcd.setCursor(0, 1);
 
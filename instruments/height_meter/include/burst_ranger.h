@@ -0,0 +1,95 @@
+#ifndef BURST_RANGER_H
+#define BURST_RANGER_H
+
+#include <cstdint>
+
+/**
+ * BurstRanger - Consensus of a short burst of ultrasonic pings
+ *
+ * Collects the echoes of one burst and stops it as soon as agreeCount of
+ * them lie within tolerance of the newest echo; the consensus is the
+ * median of those. A stray echo (multipath, a waving arm) is simply
+ * outvoted instead of resetting the debouncer's stability timer, so each
+ * consensus reading can be trusted more than a single ping and the
+ * debouncer can settle on fewer of them.
+ *
+ * Pings without an echo (0 cm) are counted towards maxPings but never
+ * vote, so an empty platform or a lost sensor cannot agree on 0. A burst
+ * that reaches maxPings without agreement has no consensus and should not
+ * be fed to the debouncer.
+ */
+class BurstRanger {
+public:
+    static const uint8_t kMaxPings = 16;
+
+    /**
+     * Constructor with configurable parameters
+     * @param toleranceCm - echoes within this range agree
+     * @param agreeCount - agreeing echoes that end the burst
+     * @param maxPings - pings before the burst is given up (at most kMaxPings)
+     */
+    BurstRanger(int toleranceCm, uint8_t agreeCount, uint8_t maxPings);
+
+    /**
+     * Default constructor using config.h values
+     */
+    BurstRanger();
+
+    /**
+     * Start a new burst
+     */
+    void begin();
+
+    /**
+     * Add the next echo of the burst
+     * @param distanceCm - ping result in cm (0 for no echo, which never votes)
+     * @return true once the burst is complete (consensus or maxPings)
+     */
+    bool addEcho(int distanceCm);
+
+    /**
+     * Check if the burst is over; further echoes are ignored
+     */
+    bool isComplete() const;
+
+    /**
+     * Check if the completed burst reached agreement
+     */
+    bool hasConsensus() const;
+
+    /**
+     * Get the consensus distance
+     * @return the median of the agreeing echoes, or -1 without consensus
+     */
+    int getConsensus() const;
+
+    /**
+     * Get the number of echoes added to the current burst
+     */
+    uint8_t getPingCount() const;
+
+    /**
+     * Get the number of pings of the current burst that returned an echo
+     */
+    uint8_t getEchoCount() const;
+
+    // Getters for configuration
+    int getToleranceCm() const { return toleranceCm_; }
+    uint8_t getAgreeCount() const { return agreeCount_; }
+    uint8_t getMaxPings() const { return maxPings_; }
+
+private:
+    // Configuration
+    int toleranceCm_;
+    uint8_t agreeCount_;
+    uint8_t maxPings_;
+
+    // State
+    int echoes_[kMaxPings];
+    uint8_t pingCount_;
+    uint8_t echoCount_;
+    int consensus_;
+    bool complete_;
+};
+
+#endif // BURST_RANGER_H
@@ -17,6 +17,24 @@
 // Maximum distance for ultrasonic sensor (in cm)
 #define HEIGHT_MAX_DISTANCE_CM 200
 
+// Burst ranging: fire up to BURST_MAX_PINGS pings BURST_PING_GAP_MS apart and
+// stop once BURST_AGREE_COUNT echoes agree within DEBOUNCE_TOLERANCE_CM. One
+// consensus reading per BURST_INTERVAL_MS, stable after
+// BURST_STABILITY_DURATION_MS (set HEIGHT_BURST_MODE to 1 to enable)
+#define HEIGHT_BURST_MODE 0
+#define BURST_AGREE_COUNT 3
+#define BURST_MAX_PINGS 6
+#define BURST_PING_GAP_MS 30
+#define BURST_INTERVAL_MS 250
+#define BURST_STABILITY_DURATION_MS 1000
+
+// On-device history (HistoryRing): one height sample per
+// HEIGHT_HISTORY_INTERVAL_MS in HEIGHT_HISTORY_BYTES of RAM, about 7 minutes;
+// dumped when the host sends HISTORY_DUMP_REQUEST
+#define HEIGHT_HISTORY_BYTES 512
+#define HEIGHT_HISTORY_INTERVAL_MS 500
+#define HISTORY_DEVICE_ID 0
+
 // ============================================
 // Hardware Pin Configuration
 // ============================================
@@ -0,0 +1,458 @@
+#ifndef HISTORY_RING_H
+#define HISTORY_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Compressed on-device history of recent readings
+ *
+ * A fixed RAM budget is split into HISTORY_BLOCK_SIZE-byte blocks used as
+ * a ring; when the ring is full the oldest block is dropped, so the
+ * history always covers the most recent minutes. Every block decodes on
+ * its own:
+ *
+ *   [0..3]   time of the block's first sample (ms since boot, LE)
+ *   [4]      transition markers of the first sample
+ *   [5..]    first sample, int16 LE per channel
+ *   [...]    nibble stream (high nibble first), one record per sample
+ *
+ * Samples sit on a grid of the sample interval, so times are implicit.
+ * Each record is one value token per channel, optionally preceded by
+ * markers:
+ *
+ *   0x0-0xC  delta -6..+6 from the channel's previous value
+ *   0xD      8-bit delta follows (2 nibbles)
+ *   0xE      absolute 16-bit value follows (4 nibbles)
+ *   0xF      marker, type nibble follows:
+ *              2c / 2c+1  channel c became stable / unstable
+ *              0x8        skipped grid slots follow (2 nibbles)
+ *              0xF        end of block (unwritten space reads as 0xFF)
+ *
+ * A steady reading costs one nibble per channel, so 512 bytes hold about
+ * 800 height samples: almost 7 minutes at a 500 ms history interval.
+ *
+ * The host requests the bulk dump by sending HISTORY_DUMP_REQUEST. The
+ * dump is the raw blocks, oldest first, framed:
+ *
+ *   [0]      sync 0x5A
+ *   [1]      channels
+ *   [2]      block size
+ *   [3]      block count n
+ *   [4..7]   device id (LE)
+ *   [8..11]  device time of the dump (ms since boot, LE)
+ *   [12..13] sample interval in ms (LE)
+ *   [14..]   n blocks
+ *   [last]   XOR of all preceding bytes
+ *
+ * Header-only and free of the standard library so firmware can use it.
+ */
+
+#define HISTORY_BLOCK_SIZE 32
+#define HISTORY_MAX_CHANNELS 4
+#define HISTORY_DUMP_SYNC 0x5A
+#define HISTORY_DUMP_HEADER_SIZE 14
+#define HISTORY_DUMP_REQUEST 'H'
+
+#define HISTORY_TOKEN_DELTA8 0xD
+#define HISTORY_TOKEN_ABSOLUTE 0xE
+#define HISTORY_TOKEN_MARKER 0xF
+#define HISTORY_MARKER_SKIP 0x8
+#define HISTORY_MARKER_END 0xF
+
+/**
+ * One decoded sample
+ *
+ * stableMask/unstableMask have bit c set when channel c became stable /
+ * unstable at this sample.
+ */
+struct HistorySample {
+    uint32_t timeMs;
+    int16_t values[HISTORY_MAX_CHANNELS];
+    uint8_t stableMask;
+    uint8_t unstableMask;
+};
+
+/**
+ * HistoryRing - Delta/nibble-packed ring of the last samples
+ * @tparam CAPACITY - RAM budget in bytes (a multiple of HISTORY_BLOCK_SIZE,
+ *                    at most 255 blocks)
+ * @tparam CHANNELS - values per sample (1 for height, 2 for BPM/SpO2)
+ */
+template<uint16_t CAPACITY, uint8_t CHANNELS>
+class HistoryRing {
+public:
+    static const uint8_t kBlockCount = CAPACITY / HISTORY_BLOCK_SIZE;
+    static const uint8_t kHeaderSize = 5 + 2 * CHANNELS;
+    static const uint8_t kBlockNibbles = 2 * (HISTORY_BLOCK_SIZE - kHeaderSize);
+
+    /**
+     * @param sampleIntervalMs - grid the samples are stored on
+     */
+    explicit HistoryRing(uint16_t sampleIntervalMs)
+        : first_(0)
+        , count_(0)
+        , nibble_(0)
+        , encodedTimeMs_(0)
+        , intervalMs_(sampleIntervalMs > 0 ? sampleIntervalMs : 1)
+        , pendingMarkers_(0)
+        , samples_(0)
+    {
+        static_assert(CAPACITY % HISTORY_BLOCK_SIZE == 0 && CAPACITY / HISTORY_BLOCK_SIZE >= 2 &&
+                      CAPACITY / HISTORY_BLOCK_SIZE <= 255, "CAPACITY must be 2..255 blocks");
+        static_assert(CHANNELS >= 1 && CHANNELS <= HISTORY_MAX_CHANNELS, "1..HISTORY_MAX_CHANNELS channels");
+        for (uint8_t c = 0; c < CHANNELS; ++c) {
+            last_[c] = 0;
+        }
+    }
+
+    /**
+     * Record a debouncer transition; stored with the next sample
+     */
+    void mark(uint8_t channel, bool stable) {
+        if (channel < CHANNELS) {
+            pendingMarkers_ |= static_cast<uint8_t>(1 << (2 * channel + (stable ? 0 : 1)));
+        }
+    }
+
+    /**
+     * Append a sample (call about once per sample interval)
+     * @param values - CHANNELS values
+     */
+    void add(uint32_t timeMs, const int16_t* values) {
+        samples_++;
+        if (count_ == 0) {
+            startBlock(timeMs, values);
+            return;
+        }
+
+        // Grid slots since the previous sample (at least one, so time is monotonic)
+        uint32_t slots = (timeMs - encodedTimeMs_ + intervalMs_ / 2) / intervalMs_;
+        if (slots == 0) {
+            slots = 1;
+        }
+        if (slots > 256) {
+            startBlock(timeMs, values);
+            return;
+        }
+
+        uint8_t needed = static_cast<uint8_t>(slots > 1 ? 4 : 0);
+        for (uint8_t c = 0; c < CHANNELS; ++c) {
+            needed = static_cast<uint8_t>(needed + 2 * ((pendingMarkers_ >> (2 * c)) & 1) +
+                                          2 * ((pendingMarkers_ >> (2 * c + 1)) & 1) +
+                                          tokenNibbles(values[c] - last_[c]));
+        }
+        if (nibble_ + needed > kBlockNibbles) {
+            startBlock(timeMs, values);
+            return;
+        }
+
+        if (slots > 1) {
+            putNibble(HISTORY_TOKEN_MARKER);
+            putNibble(HISTORY_MARKER_SKIP);
+            putByte(static_cast<uint8_t>(slots - 2));
+        }
+        for (uint8_t m = 0; m < 2 * CHANNELS; ++m) {
+            if (pendingMarkers_ & (1 << m)) {
+                putNibble(HISTORY_TOKEN_MARKER);
+                putNibble(m);
+            }
+        }
+        pendingMarkers_ = 0;
+        for (uint8_t c = 0; c < CHANNELS; ++c) {
+            putValue(values[c] - last_[c], values[c]);
+            last_[c] = values[c];
+        }
+        encodedTimeMs_ += slots * intervalMs_;
+    }
+
+    /**
+     * Write the bulk dump (see above) through any writer with write(uint8_t),
+     * e.g. Serial
+     */
+    template<typename Writer>
+    void dump(Writer& out, uint32_t deviceId, uint32_t nowMs) const {
+        uint8_t header[HISTORY_DUMP_HEADER_SIZE];
+        header[0] = HISTORY_DUMP_SYNC;
+        header[1] = CHANNELS;
+        header[2] = HISTORY_BLOCK_SIZE;
+        header[3] = count_;
+        for (int i = 0; i < 4; ++i) {
+            header[4 + i] = static_cast<uint8_t>(deviceId >> (8 * i));
+            header[8 + i] = static_cast<uint8_t>(nowMs >> (8 * i));
+        }
+        header[12] = static_cast<uint8_t>(intervalMs_);
+        header[13] = static_cast<uint8_t>(intervalMs_ >> 8);
+
+        uint8_t check = 0;
+        for (int i = 0; i < HISTORY_DUMP_HEADER_SIZE; ++i) {
+            check ^= header[i];
+            out.write(header[i]);
+        }
+        for (uint8_t b = 0; b < count_; ++b) {
+            const uint8_t* block = blocks_[(first_ + b) % kBlockCount];
+            for (int i = 0; i < HISTORY_BLOCK_SIZE; ++i) {
+                check ^= block[i];
+                out.write(block[i]);
+            }
+        }
+        out.write(check);
+    }
+
+    /**
+     * Bytes a dump of the current contents takes
+     */
+    size_t getDumpSize() const {
+        return HISTORY_DUMP_HEADER_SIZE + static_cast<size_t>(count_) * HISTORY_BLOCK_SIZE + 1;
+    }
+
+    uint8_t getBlockCount() const { return count_; }
+    unsigned long getSamplesAdded() const { return samples_; }
+
+    void clear() {
+        first_ = 0;
+        count_ = 0;
+        nibble_ = 0;
+        pendingMarkers_ = 0;
+    }
+
+private:
+    uint8_t blocks_[kBlockCount][HISTORY_BLOCK_SIZE];
+    uint8_t first_;             // oldest block
+    uint8_t count_;             // blocks in use
+    uint8_t nibble_;            // next nibble of the newest block's stream
+    int16_t last_[CHANNELS];
+    uint32_t encodedTimeMs_;    // grid time of the last stored sample
+    uint16_t intervalMs_;
+    uint8_t pendingMarkers_;
+    unsigned long samples_;
+
+    static uint8_t tokenNibbles(int32_t delta) {
+        if (delta >= -6 && delta <= 6) {
+            return 1;
+        }
+        return delta >= -128 && delta <= 127 ? 3 : 5;
+    }
+
+    uint8_t* newest() {
+        return blocks_[(first_ + count_ - 1) % kBlockCount];
+    }
+
+    void startBlock(uint32_t timeMs, const int16_t* values) {
+        if (count_ == kBlockCount) {
+            first_ = static_cast<uint8_t>((first_ + 1) % kBlockCount);   // drop the oldest
+        } else {
+            count_++;
+        }
+        uint8_t* block = newest();
+        for (int i = 0; i < HISTORY_BLOCK_SIZE; ++i) {
+            block[i] = 0xFF;
+        }
+        for (int i = 0; i < 4; ++i) {
+            block[i] = static_cast<uint8_t>(timeMs >> (8 * i));
+        }
+        block[4] = pendingMarkers_;
+        for (uint8_t c = 0; c < CHANNELS; ++c) {
+            block[5 + 2 * c] = static_cast<uint8_t>(values[c]);
+            block[6 + 2 * c] = static_cast<uint8_t>(static_cast<uint16_t>(values[c]) >> 8);
+            last_[c] = values[c];
+        }
+        pendingMarkers_ = 0;
+        nibble_ = 0;
+        encodedTimeMs_ = timeMs;
+    }
+
+    void putNibble(uint8_t value) {
+        uint8_t& byte = newest()[kHeaderSize + nibble_ / 2];
+        byte = (nibble_ & 1) ? static_cast<uint8_t>((byte & 0xF0) | (value & 0x0F))
+                             : static_cast<uint8_t>((byte & 0x0F) | (value << 4));
+        nibble_++;
+    }
+
+    void putByte(uint8_t value) {
+        putNibble(static_cast<uint8_t>(value >> 4));
+        putNibble(static_cast<uint8_t>(value & 0x0F));
+    }
+
+    void putValue(int32_t delta, int16_t value) {
+        if (delta >= -6 && delta <= 6) {
+            putNibble(static_cast<uint8_t>(delta + 6));
+        } else if (delta >= -128 && delta <= 127) {
+            putNibble(HISTORY_TOKEN_DELTA8);
+            putByte(static_cast<uint8_t>(static_cast<int8_t>(delta)));
+        } else {
+            putNibble(HISTORY_TOKEN_ABSOLUTE);
+            putByte(static_cast<uint8_t>(static_cast<uint16_t>(value) >> 8));
+            putByte(static_cast<uint8_t>(value));
+        }
+    }
+};
+
+// ============================================
+// Host-side decoding
+// ============================================
+
+/**
+ * Header of a bulk dump
+ */
+struct HistoryDumpInfo {
+    uint32_t deviceId;
+    uint32_t nowMs;
+    uint16_t sampleIntervalMs;
+    uint8_t channels;
+    uint8_t blockSize;
+    uint8_t blockCount;
+    const uint8_t* blocks;   // blockCount * blockSize bytes, oldest first
+};
+
+/**
+ * Bytes of a complete dump whose header starts at data
+ * @return 0 if the header is not a dump header or is incomplete
+ */
+inline size_t historyDumpSize(const uint8_t* data, size_t length) {
+    if (length < HISTORY_DUMP_HEADER_SIZE || data[0] != HISTORY_DUMP_SYNC || data[1] == 0 ||
+        data[1] > HISTORY_MAX_CHANNELS || data[2] == 0) {
+        return 0;
+    }
+    return HISTORY_DUMP_HEADER_SIZE + static_cast<size_t>(data[2]) * data[3] + 1;
+}
+
+/**
+ * Validate a dump and read its header
+ * @return false if the dump is truncated or its checksum does not match
+ */
+inline bool decodeHistoryDump(const uint8_t* data, size_t length, HistoryDumpInfo* info) {
+    size_t size = historyDumpSize(data, length);
+    if (size == 0 || length < size) {
+        return false;
+    }
+    uint8_t check = 0;
+    for (size_t i = 0; i + 1 < size; ++i) {
+        check ^= data[i];
+    }
+    if (check != data[size - 1]) {
+        return false;
+    }
+    info->channels = data[1];
+    info->blockSize = data[2];
+    info->blockCount = data[3];
+    info->deviceId = 0;
+    info->nowMs = 0;
+    for (int i = 0; i < 4; ++i) {
+        info->deviceId |= static_cast<uint32_t>(data[4 + i]) << (8 * i);
+        info->nowMs |= static_cast<uint32_t>(data[8 + i]) << (8 * i);
+    }
+    info->sampleIntervalMs = static_cast<uint16_t>(data[12] | (data[13] << 8));
+    info->blocks = data + HISTORY_DUMP_HEADER_SIZE;
+    return true;
+}
+
+/**
+ * Decode one block, calling handler.onHistorySample(const HistorySample&)
+ * for each sample in order
+ * @return samples decoded, or -1 if the block is malformed
+ */
+template<typename Handler>
+int decodeHistoryBlock(const uint8_t* block, uint8_t blockSize, uint8_t channels, uint16_t sampleIntervalMs,
+                       Handler& handler) {
+    size_t headerSize = 5 + 2 * static_cast<size_t>(channels);
+    if (channels == 0 || channels > HISTORY_MAX_CHANNELS || blockSize < headerSize) {
+        return -1;
+    }
+
+    HistorySample sample;
+    sample.timeMs = 0;
+    for (int i = 0; i < 4; ++i) {
+        sample.timeMs |= static_cast<uint32_t>(block[i]) << (8 * i);
+    }
+    sample.stableMask = 0;
+    sample.unstableMask = 0;
+    for (uint8_t m = 0; m < 2 * channels; ++m) {
+        if (block[4] & (1 << m)) {
+            if (m & 1) {
+                sample.unstableMask |= static_cast<uint8_t>(1 << (m / 2));
+            } else {
+                sample.stableMask |= static_cast<uint8_t>(1 << (m / 2));
+            }
+        }
+    }
+    for (uint8_t c = 0; c < HISTORY_MAX_CHANNELS; ++c) {
+        sample.values[c] = c < channels ? static_cast<int16_t>(block[5 + 2 * c] | (block[6 + 2 * c] << 8)) : 0;
+    }
+    handler.onHistorySample(sample);
+    int decoded = 1;
+
+    const uint8_t* stream = block + headerSize;
+    size_t nibbles = 2 * (blockSize - headerSize);
+    size_t pos = 0;
+    uint8_t channel = 0;
+    uint32_t slots = 1;
+    sample.stableMask = 0;
+    sample.unstableMask = 0;
+#define HISTORY_NIBBLE(i) ((i) & 1 ? stream[(i) / 2] & 0x0F : stream[(i) / 2] >> 4)
+    while (pos < nibbles) {
+        uint8_t token = HISTORY_NIBBLE(pos);
+        pos++;
+        if (token == HISTORY_TOKEN_MARKER) {
+            if (pos >= nibbles) {
+                break;
+            }
+            uint8_t type = HISTORY_NIBBLE(pos);
+            pos++;
+            if (type == HISTORY_MARKER_END) {
+                break;
+            }
+            if (channel != 0) {
+                return -1;   // markers only between records
+            }
+            if (type == HISTORY_MARKER_SKIP) {
+                if (pos + 2 > nibbles) {
+                    return -1;
+                }
+                slots = 2 + static_cast<uint32_t>((HISTORY_NIBBLE(pos) << 4) | HISTORY_NIBBLE(pos + 1));
+                pos += 2;
+            } else if (type < 2 * channels) {
+                if (type & 1) {
+                    sample.unstableMask |= static_cast<uint8_t>(1 << (type / 2));
+                } else {
+                    sample.stableMask |= static_cast<uint8_t>(1 << (type / 2));
+                }
+            } else {
+                return -1;
+            }
+            continue;
+        }
+
+        if (token <= 0xC) {
+            sample.values[channel] = static_cast<int16_t>(sample.values[channel] + token - 6);
+        } else if (token == HISTORY_TOKEN_DELTA8) {
+            if (pos + 2 > nibbles) {
+                return -1;
+            }
+            int8_t delta = static_cast<int8_t>((HISTORY_NIBBLE(pos) << 4) | HISTORY_NIBBLE(pos + 1));
+            sample.values[channel] = static_cast<int16_t>(sample.values[channel] + delta);
+            pos += 2;
+        } else {
+            if (pos + 4 > nibbles) {
+                return -1;
+            }
+            sample.values[channel] = static_cast<int16_t>((HISTORY_NIBBLE(pos) << 12) | (HISTORY_NIBBLE(pos + 1) << 8) |
+                                                          (HISTORY_NIBBLE(pos + 2) << 4) | HISTORY_NIBBLE(pos + 3));
+            pos += 4;
+        }
+
+        if (++channel == channels) {
+            sample.timeMs += slots * sampleIntervalMs;
+            handler.onHistorySample(sample);
+            decoded++;
+            channel = 0;
+            slots = 1;
+            sample.stableMask = 0;
+            sample.unstableMask = 0;
+        }
+    }
+#undef HISTORY_NIBBLE
+    return channel == 0 ? decoded : -1;
+}
+
+#endif // HISTORY_RING_H
@@ -0,0 +1,82 @@
+#include "burst_ranger.h"
+#include "config.h"
+#include <cstdlib>
+
+BurstRanger::BurstRanger(int toleranceCm, uint8_t agreeCount, uint8_t maxPings)
+    : toleranceCm_(toleranceCm)
+    , agreeCount_(agreeCount > 0 ? agreeCount : 1)
+    , maxPings_(maxPings > kMaxPings ? kMaxPings : (maxPings > 0 ? maxPings : 1))
+    , pingCount_(0)
+    , echoCount_(0)
+    , consensus_(-1)
+    , complete_(false)
+{
+}
+
+BurstRanger::BurstRanger()
+    : BurstRanger(DEBOUNCE_TOLERANCE_CM, BURST_AGREE_COUNT, BURST_MAX_PINGS)
+{
+}
+
+void BurstRanger::begin() {
+    pingCount_ = 0;
+    echoCount_ = 0;
+    consensus_ = -1;
+    complete_ = false;
+}
+
+bool BurstRanger::addEcho(int distanceCm) {
+    if (complete_) {
+        return true;
+    }
+    pingCount_++;
+    if (distanceCm <= 0) {
+        // ping_cm() reports a lost echo as 0; it is a miss, not a distance
+        if (pingCount_ >= maxPings_) {
+            complete_ = true;
+        }
+        return complete_;
+    }
+    echoes_[echoCount_++] = distanceCm;
+
+    // Echoes agreeing with the newest one, kept sorted for the median
+    int agreeing[kMaxPings];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < echoCount_; ++i) {
+        if (std::abs(echoes_[i] - distanceCm) <= toleranceCm_) {
+            uint8_t j = count++;
+            for (; j > 0 && agreeing[j - 1] > echoes_[i]; --j) {
+                agreeing[j] = agreeing[j - 1];
+            }
+            agreeing[j] = echoes_[i];
+        }
+    }
+
+    if (count >= agreeCount_) {
+        consensus_ = agreeing[count / 2];
+        complete_ = true;
+    } else if (pingCount_ >= maxPings_) {
+        complete_ = true;
+    }
+    return complete_;
+}
+
+bool BurstRanger::isComplete() const {
+    return complete_;
+}
+
+bool BurstRanger::hasConsensus() const {
+    return consensus_ >= 0;
+}
+
+int BurstRanger::getConsensus() const {
+    return consensus_;
+}
+
+uint8_t BurstRanger::getPingCount() const {
+    return pingCount_;
+}
+
+uint8_t BurstRanger::getEchoCount() const {
+    return echoCount_;
+}
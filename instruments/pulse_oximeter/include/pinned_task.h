@@ -0,0 +1,213 @@
+#ifndef PINNED_TASK_H
+#define PINNED_TASK_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ESP32
+  #include <freertos/FreeRTOS.h>
+  #include <freertos/task.h>
+#else
+  #include <chrono>
+  #include <thread>
+  #if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+  #endif
+#endif
+
+#define PINNED_TASK_STACK_BYTES 4096
+#define PINNED_TASK_PRIORITY 1
+
+/**
+ * PinnedTask - A task bound to one core, on FreeRTOS or on the host
+ *
+ * On ESP32 start() is xTaskCreatePinnedToCore(). Elsewhere it is a
+ * std::thread whose affinity is set to the core (on Linux; cores past the
+ * host's count wrap around, and elsewhere the thread is left unpinned).
+ * Code written against PinnedTask and SpscQueue therefore runs the same
+ * concurrency on a board and in a host test or benchmark.
+ *
+ * The entry function runs once; tasks that run forever simply never return.
+ * Stack size and priority only apply on FreeRTOS.
+ */
+class PinnedTask {
+public:
+    typedef void (*Entry)(void* arg);
+
+    PinnedTask()
+        : entry_(NULL)
+        , arg_(NULL)
+        , core_(-1)
+        , pinned_(false)
+        , started_(false)
+        , done_(false)
+#ifdef ESP32
+        , handle_(NULL)
+#else
+        , released_(false)
+#endif
+    {
+    }
+
+    ~PinnedTask() { join(); }
+
+    /**
+     * Start entry(arg) on a core
+     * @param name - task name (FreeRTOS task list, debugger)
+     * @param core - core index (ESP32: 0 runs WiFi/BT, 1 runs loop())
+     * @return false if the task could not be created or was already started
+     */
+    bool start(const char* name, Entry entry, void* arg, int core,
+               uint32_t stackBytes = PINNED_TASK_STACK_BYTES, unsigned priority = PINNED_TASK_PRIORITY) {
+        if (started_ || entry == NULL) {
+            return false;
+        }
+        entry_ = entry;
+        arg_ = arg;
+        core_ = core;
+        done_.store(false);
+#ifdef ESP32
+        if (xTaskCreatePinnedToCore(&PinnedTask::run, name, stackBytes, this, priority, &handle_, core) != pdPASS) {
+            return false;
+        }
+        pinned_ = true;
+#else
+        (void)name;
+        (void)stackBytes;
+        (void)priority;
+        released_.store(false);
+        thread_ = std::thread(&PinnedTask::run, this);
+        pinned_ = pinThread(thread_, core);
+        released_.store(true);   // the entry function starts on its core
+#endif
+        started_ = true;
+        return true;
+    }
+
+    /**
+     * Wait for the entry function to return
+     */
+    void join() {
+        if (!started_) {
+            return;
+        }
+#ifdef ESP32
+        while (!done_.load()) {
+            vTaskDelay(1);
+        }
+#else
+        thread_.join();
+#endif
+        started_ = false;
+    }
+
+    bool isRunning() const { return started_ && !done_.load(); }
+
+    /**
+     * Whether the task is bound to its core (always on ESP32)
+     */
+    bool isPinned() const { return pinned_; }
+    int getCore() const { return core_; }
+
+    /**
+     * Block the calling task for at least ms (one tick minimum on FreeRTOS)
+     */
+    static void sleepMs(unsigned long ms) {
+#ifdef ESP32
+        TickType_t ticks = pdMS_TO_TICKS(ms);
+        vTaskDelay(ticks > 0 ? ticks : 1);
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+#endif
+    }
+
+    /**
+     * Let other ready tasks of the same priority run
+     */
+    static void yield() {
+#ifdef ESP32
+        taskYIELD();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /**
+     * Core the calling task runs on, or -1 if unknown
+     */
+    static int currentCore() {
+#ifdef ESP32
+        return static_cast<int>(xPortGetCoreID());
+#elif defined(__linux__)
+        return sched_getcpu();
+#else
+        return -1;
+#endif
+    }
+
+private:
+    Entry entry_;
+    void* arg_;
+    int core_;
+    bool pinned_;
+    bool started_;
+    std::atomic<bool> done_;
+#ifdef ESP32
+    TaskHandle_t handle_;
+#else
+    std::thread thread_;
+    std::atomic<bool> released_;
+#endif
+
+    static void run(void* self) {
+        PinnedTask* task = static_cast<PinnedTask*>(self);
+#ifndef ESP32
+        while (!task->released_.load()) {
+            std::this_thread::yield();
+        }
+#endif
+        task->entry_(task->arg_);
+        task->done_.store(true);
+#ifdef ESP32
+        vTaskDelete(NULL);   // FreeRTOS tasks must not return
+#endif
+    }
+
+#ifndef ESP32
+    static bool pinThread(std::thread& thread, int core) {
+#if defined(__linux__)
+        if (core < 0) {
+            return false;
+        }
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+            return false;
+        }
+        // The core-th CPU this process may use, wrapping on small hosts
+        int target = core % CPU_COUNT(&allowed);
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+            }
+        }
+        return false;
+#else
+        (void)thread;
+        (void)core;
+        return false;
+#endif
+    }
+#endif
+
+    // Non-copyable (the running task points at this object)
+    PinnedTask(const PinnedTask&);
+    PinnedTask& operator=(const PinnedTask&);
+};
+
+#endif // PINNED_TASK_H
@@ -0,0 +1,122 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Head and tail live on separate lines so the two cores do not share one.
+// ESP32 internal SRAM is not cached, so word alignment is enough there.
+#ifndef SPSC_QUEUE_LINE_BYTES
+  #ifdef ESP32
+    #define SPSC_QUEUE_LINE_BYTES 4
+  #else
+    #define SPSC_QUEUE_LINE_BYTES 64
+  #endif
+#endif
+
+/**
+ * SpscQueue - Fixed-size lock-free queue between one producer and one consumer
+ *
+ * A ring of Capacity slots (a power of two) indexed by free-running
+ * counters: the producer owns the tail, the consumer the head, and each
+ * publishes its counter with release order after touching a slot. Neither
+ * side ever blocks or allocates; push() fails when the ring is full and
+ * pop() when it is empty, and the caller decides whether to drop, retry or
+ * sleep. Each side keeps a copy of the other's counter and only reloads it
+ * when the ring looks full (or empty), so a steady stream costs one shared
+ * load per lap rather than one per item.
+ *
+ * Exactly one thread (task) may call push() and exactly one pop().
+ */
+template<typename T, size_t Capacity>
+class SpscQueue {
+public:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    SpscQueue()
+        : head_(0)
+        , tailSeen_(0)
+        , tail_(0)
+        , headSeen_(0)
+        , dropped_(0)
+    {
+    }
+
+    /**
+     * Append an item (producer side)
+     * @return false if the queue is full; the item is not queued
+     */
+    bool push(const T& item) {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headSeen_ == Capacity) {
+            headSeen_ = head_.load(std::memory_order_acquire);
+            if (tail - headSeen_ == Capacity) {
+                return false;
+            }
+        }
+        slots_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Append an item, counting it in getDropped() if the queue is full
+     * (producer side, for producers that must not wait)
+     */
+    bool pushOrDrop(const T& item) {
+        if (push(item)) {
+            return true;
+        }
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /**
+     * Take the oldest item (consumer side)
+     * @return false if the queue is empty; item is not touched
+     */
+    bool pop(T& item) {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head == tailSeen_) {
+            tailSeen_ = tail_.load(std::memory_order_acquire);
+            if (head == tailSeen_) {
+                return false;
+            }
+        }
+        item = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Items queued; exact only when called from either side while the other is idle
+     */
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+    static size_t capacity() { return Capacity; }
+
+    /**
+     * Items pushOrDrop() could not queue
+     */
+    uint32_t getDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    // Consumer side
+    alignas(SPSC_QUEUE_LINE_BYTES) std::atomic<uint32_t> head_;
+    uint32_t tailSeen_;
+    // Producer side
+    alignas(SPSC_QUEUE_LINE_BYTES) std::atomic<uint32_t> tail_;
+    uint32_t headSeen_;
+    std::atomic<uint32_t> dropped_;
+    alignas(SPSC_QUEUE_LINE_BYTES) T slots_[Capacity];
+
+    // Non-copyable (the two sides hold on to it)
+    SpscQueue(const SpscQueue&);
+    SpscQueue& operator=(const SpscQueue&);
+};
+
+#endif // SPSC_QUEUE_H
@@ -3,6 +3,8 @@
 // ============================================
 // MAX30100 sensor with LCD or OLED display
 // Includes debounce logic for stable BPM and SpO2 readings
+// On ESP32, sampling/debouncing and display/telemetry run as two tasks
+// on separate cores, linked by a lock-free queue
 // ============================================
 
 #include <Wire.h>
@@ -18,6 +20,7 @@
 #include <LiquidCrystal_I2C.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include "include/history_ring.h"
 
 // ============================================
 // CONFIGURATION - Adjust these values as needed
@@ -55,6 +58,33 @@ enum DisplayType {
 // Reporting interval
 #define REPORTING_PERIOD_MS 1000
 
+// Dual-core split (ESP32 only): sampling and debouncing on one core,
+// display and Serial telemetry on the other
+#ifndef OXIMETER_DUAL_CORE
+  #ifdef ESP32
+    #define OXIMETER_DUAL_CORE 1
+  #else
+    #define OXIMETER_DUAL_CORE 0
+  #endif
+#endif
+#define SAMPLING_CORE 1               // next to loop(); pox.update() needs frequent calls
+#define PRESENT_CORE 0                // shares the core with WiFi/BT
+#define PRESENT_PERIOD_MS 20          // how often the present task drains the queue
+#define FRAME_QUEUE_DEPTH 8           // reports buffered while the display is busy
+
+// On-device history of the reports (whole BPM, SpO2), sent when the host
+// sends HISTORY_DUMP_REQUEST. Not on the Uno: its ~1.2 KB of Serial strings
+// sit in SRAM and the OLED needs a 1 KB frame buffer, so 2 KB has no room.
+#ifndef OXIMETER_HISTORY
+  #ifdef ARDUINO_AVR_UNO
+    #define OXIMETER_HISTORY 0
+  #else
+    #define OXIMETER_HISTORY 1
+  #endif
+#endif
+#define OXIMETER_HISTORY_BYTES 2048   // 64 blocks, about 25 minutes of reports
+#define HISTORY_DEVICE_ID 0
+
 // BPM Debounce Settings (optimized for Arduino Uno)
 #ifdef ARDUINO_AVR_UNO
   #define BPM_TOLERANCE 5.0f
@@ -188,6 +218,66 @@ private:
     }
 };
 
+#if OXIMETER_DUAL_CORE
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// ============================================
+// SpscQueue / PinnedTask (see include/spsc_queue.h, include/pinned_task.h)
+// ============================================
+
+template<typename T, size_t Capacity>
+class SpscQueue {
+public:
+    SpscQueue() : head_(0), tail_(0), dropped_(0) {}
+
+    bool push(const T& item) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            // Only the producer writes; the consumer reads it from the other core
+            dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        slots_[tail & (Capacity - 1)] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t getDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> head_;
+    std::atomic<uint32_t> tail_;
+    std::atomic<uint32_t> dropped_;   // written by the producer only
+    T slots_[Capacity];
+};
+
+class PinnedTask {
+public:
+    typedef void (*Entry)(void* arg);
+
+    static bool start(const char* name, Entry entry, void* arg, int core) {
+        return xTaskCreatePinnedToCore(entry, name, 4096, arg, 1, NULL, core) == pdPASS;
+    }
+
+    static void sleepMs(unsigned long ms) {
+        TickType_t ticks = pdMS_TO_TICKS(ms);
+        vTaskDelay(ticks > 0 ? ticks : 1);
+    }
+};
+#endif
+
 // ============================================
 // Global Objects
 // ============================================
@@ -215,12 +305,44 @@ ReadingDebouncer<float> bpmDebouncer(BPM_TOLERANCE, BPM_STABILITY_DURATION_MS,
 ReadingDebouncer<int> spo2Debouncer(SPO2_TOLERANCE, SPO2_STABILITY_DURATION_MS,
                                      SPO2_SAMPLE_INTERVAL_MS, SPO2_MIN_VALID, SPO2_MAX_VALID);
 
+// One report: raw readings and the debouncers' state after them
+struct OximeterFrame {
+    unsigned long timeMs;
+    float rawBpm;
+    uint8_t rawSpo2;
+    bool bpmValid;
+    bool spo2Valid;
+    bool bpmStable;
+    bool spo2Stable;
+    float bpmStableReading;
+    int spo2StableReading;
+    uint16_t beats;          // beats detected since the previous frame (dual-core only)
+};
+
+#if OXIMETER_HISTORY
+HistoryRing<OXIMETER_HISTORY_BYTES, 2> history(REPORTING_PERIOD_MS);   // display/telemetry side only
+bool historyBpmStable = false;
+bool historySpo2Stable = false;
+#endif
+
+#if OXIMETER_DUAL_CORE
+SpscQueue<OximeterFrame, FRAME_QUEUE_DEPTH> frameQueue;
+uint16_t beatsSinceFrame = 0;   // sampling task only
+
+void samplingTask(void* arg);
+void presentTask(void* arg);
+#endif
+
 // ============================================
 // Callbacks
 // ============================================
 
 void onBeatDetected() {
+#if OXIMETER_DUAL_CORE
+    beatsSinceFrame++;   // runs inside pox.update() on the sampling core
+#else
     Serial.println("Beat!");
+#endif
 }
 
 // ============================================
@@ -402,103 +524,218 @@ void setup() {
     Serial.println("\n========================================");
     Serial.println("Initialization Complete - Ready to measure");
     Serial.println("========================================\n");
+
+#if OXIMETER_DUAL_CORE
+    // From here on the sensor and debouncers belong to the sampling task.
+    // Both tasks use Wire; the ESP32 core serializes its transactions.
+    if (!PinnedTask::start("sampling", samplingTask, NULL, SAMPLING_CORE) ||
+        !PinnedTask::start("present", presentTask, NULL, PRESENT_CORE)) {
+        Serial.println("ERROR: could not start tasks");
+        for (;;);
+    }
+    Serial.println("Tasks: sampling on core 1, display/telemetry on core 0\n");
+#endif
 }
 
 // ============================================
-// Main Loop
+// Sampling and Presentation
 // ============================================
 
-void loop() {
-    pox.update();
+bool reportDue() {
+    return millis() - tsLastReport > REPORTING_PERIOD_MS;
+}
+
+// Read the sensor and update the debouncers (sampling side)
+void takeReading(OximeterFrame& frame) {
+    frame.timeMs = millis();
+    frame.rawBpm = pox.getHeartRate();
+    frame.rawSpo2 = pox.getSpO2();
+
+    bpmDebouncer.update(frame.rawBpm, frame.timeMs);
+    spo2Debouncer.update((int)frame.rawSpo2, frame.timeMs);
+
+    frame.bpmValid = bpmDebouncer.hasValidReading();
+    frame.spo2Valid = spo2Debouncer.hasValidReading();
+    frame.bpmStable = bpmDebouncer.isStable();
+    frame.spo2Stable = spo2Debouncer.isStable();
+    frame.bpmStableReading = bpmDebouncer.getStableReading();
+    frame.spo2StableReading = spo2Debouncer.getStableReading();
+#if OXIMETER_DUAL_CORE
+    frame.beats = beatsSinceFrame;
+    beatsSinceFrame = 0;
+#else
+    frame.beats = 0;
+#endif
+}
+
+#if OXIMETER_HISTORY
+// Keep the report in the history, marking the debouncers' transitions
+void recordHistory(const OximeterFrame& frame) {
+    if (frame.bpmStable != historyBpmStable) {
+        historyBpmStable = frame.bpmStable;
+        history.mark(0, historyBpmStable);
+    }
+    if (frame.spo2Stable != historySpo2Stable) {
+        historySpo2Stable = frame.spo2Stable;
+        history.mark(1, historySpo2Stable);
+    }
+    int16_t values[2] = { (int16_t)(frame.rawBpm + 0.5f), (int16_t)frame.rawSpo2 };
+    history.add(frame.timeMs, values);
+}
+
+// Send the history when the host asks for it (display/telemetry side)
+void serviceDumpRequest() {
+    while (Serial.available() > 0) {
+        if (Serial.read() == HISTORY_DUMP_REQUEST) {
+            history.dump(Serial, HISTORY_DEVICE_ID, millis());
+        }
+    }
+}
+#else
+void serviceDumpRequest() {}
+#endif
+
+// Log a report and show it (display/telemetry side)
+void presentFrame(const OximeterFrame& frame) {
+#if OXIMETER_HISTORY
+    recordHistory(frame);
+#endif
+
+    for (uint16_t i = 0; i < frame.beats; i++) {
+        Serial.println("Beat!");
+    }
+
+    // Log raw sensor readings
+    Serial.print("[");
+    Serial.print(frame.timeMs);
+    Serial.print("ms] RAW - BPM:");
+    Serial.print(frame.rawBpm);
+    Serial.print(" SpO2:");
+    Serial.print(frame.rawSpo2);
+    Serial.println("%");
     
-    if (millis() - tsLastReport > REPORTING_PERIOD_MS) {
-        unsigned long currentTime = millis();
-        
-        // Get raw readings
-        float rawBpm = pox.getHeartRate();
-        uint8_t rawSpo2 = pox.getSpO2();
-        
-        // Log raw sensor readings
-        Serial.print("[");
-        Serial.print(currentTime);
-        Serial.print("ms] RAW - BPM:");
-        Serial.print(rawBpm);
-        Serial.print(" SpO2:");
-        Serial.print(rawSpo2);
-        Serial.println("%");
-        
-        // Update debouncers
-        bpmDebouncer.update(rawBpm, currentTime);
-        spo2Debouncer.update((int)rawSpo2, currentTime);
+    // Log debouncer status
+    Serial.print("      DEBOUNCE - BPM:");
+    Serial.print(frame.bpmValid ? "valid" : "invalid");
+    Serial.print(" SpO2:");
+    Serial.print(frame.spo2Valid ? "valid" : "invalid");
+    Serial.println();
+    
+    // Update Display if initialized
+    if (displayInitialized) {
+        bool fingerDetected = frame.bpmValid || frame.spo2Valid;
         
-        // Log debouncer status
-        Serial.print("      DEBOUNCE - BPM:");
-        Serial.print(bpmDebouncer.hasValidReading() ? "valid" : "invalid");
-        Serial.print(" SpO2:");
-        Serial.print(spo2Debouncer.hasValidReading() ? "valid" : "invalid");
-        Serial.println();
+        displayClear();
         
-        // Update Display if initialized
-        if (displayInitialized) {
-            bool fingerDetected = bpmDebouncer.hasValidReading() || spo2Debouncer.hasValidReading();
-            
-            displayClear();
-            
-            if (!fingerDetected && rawBpm == 0 && rawSpo2 == 0) {
-                displaySetCursor(0, 0);
-                displayPrint("Place Finger   ");
-                displaySetCursor(0, 1);
-                displayPrint("                ");
-                Serial.println("      DISPLAY: 'Place Finger'");
+        if (!fingerDetected && frame.rawBpm == 0 && frame.rawSpo2 == 0) {
+            displaySetCursor(0, 0);
+            displayPrint("Place Finger   ");
+            displaySetCursor(0, 1);
+            displayPrint("                ");
+            Serial.println("      DISPLAY: 'Place Finger'");
+        } else {
+            displaySetCursor(0, 0);
+            displayPrint("BPM:");
+            if (frame.bpmStable) {
+                displayPrintInt((int)frame.bpmStableReading);
+                displayPrint("* ");
+            } else if (frame.bpmValid) {
+                displayPrintInt((int)frame.rawBpm);
+                displayPrint("? ");
             } else {
-                displaySetCursor(0, 0);
-                displayPrint("BPM:");
-                if (bpmDebouncer.isStable()) {
-                    displayPrintInt((int)bpmDebouncer.getStableReading());
-                    displayPrint("* ");
-                } else if (bpmDebouncer.hasValidReading()) {
-                    displayPrintInt((int)rawBpm);
-                    displayPrint("? ");
-                } else {
-                    displayPrint("-- ");
-                }
-                displayPrint("O2:");
-                if (spo2Debouncer.isStable()) {
-                    displayPrintInt(spo2Debouncer.getStableReading());
-                    displayPrint("*");
-                } else if (spo2Debouncer.hasValidReading()) {
-                    displayPrintInt(rawSpo2);
-                    displayPrint("?");
-                } else {
-                    displayPrint("--");
-                }
-                displaySetCursor(0, 1);
-                if (bpmDebouncer.isStable() && spo2Debouncer.isStable()) {
-                    displayPrint("STABLE          ");
-                    Serial.println("      DISPLAY: Readings STABLE");
-                } else {
-                    displayPrint("Stabilizing...  ");
-                    Serial.println("      DISPLAY: Stabilizing...");
-                }
+                displayPrint("-- ");
+            }
+            displayPrint("O2:");
+            if (frame.spo2Stable) {
+                displayPrintInt(frame.spo2StableReading);
+                displayPrint("*");
+            } else if (frame.spo2Valid) {
+                displayPrintInt(frame.rawSpo2);
+                displayPrint("?");
+            } else {
+                displayPrint("--");
+            }
+            displaySetCursor(0, 1);
+            if (frame.bpmStable && frame.spo2Stable) {
+                displayPrint("STABLE          ");
+                Serial.println("      DISPLAY: Readings STABLE");
+            } else {
+                displayPrint("Stabilizing...  ");
+                Serial.println("      DISPLAY: Stabilizing...");
             }
-            displayUpdate();
-            Serial.println("      Display: Updated");
-        } else {
-            Serial.println("      Display: Skipped (not initialized)");
         }
-        
-        // Serial output with full details
-        Serial.print("      OUTPUT - BPM:");
-        Serial.print(rawBpm);
-        Serial.print("(");
-        Serial.print(bpmDebouncer.isStable() ? "OK" : "...");
-        Serial.print(") O2:");
-        Serial.print(rawSpo2);
-        Serial.print("(");
-        Serial.print(spo2Debouncer.isStable() ? "OK" : "...");
-        Serial.println(")");
-        Serial.println();
-        
+        displayUpdate();
+        Serial.println("      Display: Updated");
+    } else {
+        Serial.println("      Display: Skipped (not initialized)");
+    }
+    
+    // Serial output with full details
+    Serial.print("      OUTPUT - BPM:");
+    Serial.print(frame.rawBpm);
+    Serial.print("(");
+    Serial.print(frame.bpmStable ? "OK" : "...");
+    Serial.print(") O2:");
+    Serial.print(frame.rawSpo2);
+    Serial.print("(");
+    Serial.print(frame.spo2Stable ? "OK" : "...");
+    Serial.println(")");
+    Serial.println();
+}
+
+#if OXIMETER_DUAL_CORE
+// Core SAMPLING_CORE: keep the MAX30100 FIFO drained, debounce each report
+void samplingTask(void* arg) {
+    (void)arg;
+    for (;;) {
+        pox.update();
+        if (reportDue()) {
+            OximeterFrame frame;
+            takeReading(frame);
+            tsLastReport = millis();
+            frameQueue.push(frame);   // a full queue drops the report, never stalls sampling
+        }
+        PinnedTask::sleepMs(1);
+    }
+}
+
+// Core PRESENT_CORE: display and Serial, as slow as they need to be
+void presentTask(void* arg) {
+    (void)arg;
+    uint32_t droppedReported = 0;
+    for (;;) {
+        OximeterFrame frame;
+        while (frameQueue.pop(frame)) {
+            presentFrame(frame);
+        }
+        serviceDumpRequest();
+        if (frameQueue.getDropped() != droppedReported) {
+            droppedReported = frameQueue.getDropped();
+            Serial.print("WARNING: reports dropped: ");
+            Serial.println(droppedReported);
+        }
+        PinnedTask::sleepMs(PRESENT_PERIOD_MS);
+    }
+}
+#endif
+
+// ============================================
+// Main Loop
+// ============================================
+
+void loop() {
+#if OXIMETER_DUAL_CORE
+    // The work runs in samplingTask() and presentTask()
+    PinnedTask::sleepMs(1000);
+#else
+    pox.update();
+    
+    if (reportDue()) {
+        OximeterFrame frame;
+        takeReading(frame);
+        presentFrame(frame);
         tsLastReport = millis();
     }
+    serviceDumpRequest();
+#endif
 }
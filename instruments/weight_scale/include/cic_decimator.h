@@ -0,0 +1,82 @@
+#ifndef CIC_DECIMATOR_H
+#define CIC_DECIMATOR_H
+
+#include <stdint.h>
+
+/**
+ * CicDecimator - Integer cascaded integrator-comb decimator
+ *
+ * ORDER integrators at the input rate, decimation by 2^LOG2_RATE, ORDER
+ * combs at the output rate: an ORDER-fold moving average of 2^LOG2_RATE
+ * samples without a single multiplication or sample buffer, which keeps
+ * it cheap enough for an AVR at the HX711's 80 SPS. The arithmetic is
+ * modulo 2^32 on purpose (intermediate integrator overflow cancels in the
+ * combs); the output is divided by the DC gain 2^(ORDER * LOG2_RATE), so
+ * it is in input units.
+ *
+ * @tparam ORDER - integrator/comb stages (1 is a plain moving average)
+ * @tparam LOG2_RATE - log2 of the decimation factor
+ * @tparam INPUT_BITS - width of the signed input (24 for the HX711)
+ */
+template<uint8_t ORDER, uint8_t LOG2_RATE, uint8_t INPUT_BITS = 24>
+class CicDecimator {
+public:
+    static_assert(ORDER >= 1 && ORDER <= 4, "ORDER must be 1..4");
+    static_assert(INPUT_BITS + ORDER * LOG2_RATE <= 32, "register growth exceeds 32 bits");
+
+    CicDecimator() {
+        reset();
+    }
+
+    /**
+     * Add one input sample
+     * @param out - set to the decimated sample every 2^LOG2_RATE inputs
+     * @return true when out was set
+     */
+    bool push(int32_t sample, int32_t& out) {
+        uint32_t value = static_cast<uint32_t>(sample);
+        for (uint8_t i = 0; i < ORDER; ++i) {
+            integrators_[i] += value;
+            value = integrators_[i];
+        }
+        if (++phase_ < (1u << LOG2_RATE)) {
+            return false;
+        }
+        phase_ = 0;
+
+        for (uint8_t i = 0; i < ORDER; ++i) {
+            uint32_t delayed = combs_[i];
+            combs_[i] = value;
+            value -= delayed;
+        }
+        if (primed_ < ORDER) {
+            primed_++;   // the combs still hold start-up state
+            return false;
+        }
+        // Arithmetic shift of the two's complement result
+        out = static_cast<int32_t>(value) >> (ORDER * LOG2_RATE);
+        return true;
+    }
+
+    /**
+     * Input samples per output sample
+     */
+    static uint16_t getRate() { return static_cast<uint16_t>(1u << LOG2_RATE); }
+
+    void reset() {
+        for (uint8_t i = 0; i < ORDER; ++i) {
+            integrators_[i] = 0;
+            combs_[i] = 0;
+        }
+        phase_ = 0;
+        primed_ = 0;
+    }
+
+private:
+    uint32_t integrators_[ORDER];
+    uint32_t combs_[ORDER];
+    uint16_t phase_;
+    uint8_t primed_;
+};
+
+#endif // CIC_DECIMATOR_H
@@ -0,0 +1,100 @@
+#ifndef HX711_READER_H
+#define HX711_READER_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+/**
+ * Hx711Reader - Non-blocking HX711 load-cell ADC reader
+ *
+ * The common HX711 libraries wait in read() until DOUT goes low, i.e. up
+ * to a full 12.5 ms conversion at 80 SPS. poll() instead returns at once
+ * while no conversion is ready, and otherwise clocks the 24 data bits and
+ * the gain pulses out in about 25 PD_SCK pulses. Each pulse is kept short
+ * with interrupts off: PD_SCK high for more than 60 us powers the HX711
+ * down.
+ */
+class Hx711Reader {
+public:
+    /**
+     * @param doutPin - HX711 DOUT
+     * @param sckPin - HX711 PD_SCK
+     * @param gainPulses - pulses after the data selecting the next
+     *                     conversion (1: A/128, 2: B/32, 3: A/64)
+     */
+    Hx711Reader(uint8_t doutPin, uint8_t sckPin, uint8_t gainPulses = 1)
+        : doutPin_(doutPin)
+        , sckPin_(sckPin)
+        , gainPulses_(gainPulses >= 1 && gainPulses <= 3 ? gainPulses : 1)
+        , readCount_(0)
+    {
+    }
+
+    void begin() {
+        pinMode(sckPin_, OUTPUT);
+        pinMode(doutPin_, INPUT);
+        digitalWrite(sckPin_, LOW);
+    }
+
+    /**
+     * Check if a conversion is waiting (DOUT low)
+     */
+    bool isReady() const {
+        return digitalRead(doutPin_) == LOW;
+    }
+
+    /**
+     * Read the waiting conversion, if any
+     * @param raw - set to the signed 24-bit conversion
+     * @return false without touching raw if none is ready
+     */
+    bool poll(int32_t& raw) {
+        if (!isReady()) {
+            return false;
+        }
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < 24; ++i) {
+            value = (value << 1) | static_cast<uint32_t>(pulse());
+        }
+        for (uint8_t i = 0; i < gainPulses_; ++i) {
+            pulse();
+        }
+        // Sign-extend the 24-bit two's complement value
+        raw = static_cast<int32_t>(value << 8) >> 8;
+        readCount_++;
+        return true;
+    }
+
+    void powerDown() {
+        digitalWrite(sckPin_, LOW);
+        digitalWrite(sckPin_, HIGH);   // held high > 60 us
+    }
+
+    void powerUp() {
+        digitalWrite(sckPin_, LOW);
+    }
+
+    unsigned long getReadCount() const { return readCount_; }
+
+private:
+    uint8_t doutPin_;
+    uint8_t sckPin_;
+    uint8_t gainPulses_;
+    unsigned long readCount_;
+
+    /**
+     * One PD_SCK pulse; DOUT is valid once the clock is high
+     */
+    int pulse() {
+        noInterrupts();
+        digitalWrite(sckPin_, HIGH);
+        delayMicroseconds(1);
+        int bit = digitalRead(doutPin_);
+        digitalWrite(sckPin_, LOW);
+        interrupts();
+        delayMicroseconds(1);
+        return bit == HIGH ? 1 : 0;
+    }
+};
+
+#endif // HX711_READER_H
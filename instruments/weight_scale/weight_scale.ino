@@ -0,0 +1,347 @@
+// ============================================
+// Weight Scale with Debounce - Arduino Nano
+// ============================================
+// Load cells on an HX711 (80 SPS) with I2C LCD display
+// Decimates the raw conversions with an integer CIC filter and debounces
+// the resulting weight. Nothing in loop() blocks: the HX711 is read only
+// when a conversion is waiting, and the LCD is rewritten one character
+// per pass, so no conversion is missed while the display updates.
+// ============================================
+
+#include <Wire.h>
+#include <LiquidCrystal_I2C.h>
+
+// ============================================
+// CONFIGURATION - Adjust these values as needed
+// ============================================
+
+// HX711 Settings
+#define HX711_DOUT_PIN 6
+#define HX711_SCK_PIN 7
+#define HX711_GAIN_PULSES 1                 // channel A, gain 128
+#define HX711_COUNTS_PER_100G 420           // calibration of the load cells
+
+// Decimation: order 2, rate 2^3 = 8 (80 SPS become 10 readings per second)
+#define WEIGHT_CIC_ORDER 2
+#define WEIGHT_CIC_LOG2_RATE 3
+#define WEIGHT_TARE_READINGS 10             // decimated readings averaged at power-up
+
+// Debounce Settings (grams)
+#define WEIGHT_TOLERANCE_G 100              // Readings within this range are considered equal
+#define WEIGHT_STABILITY_DURATION_MS 2000   // How long readings must be stable (milliseconds)
+#define WEIGHT_SAMPLE_INTERVAL_MS 50        // The decimator sets the pace
+#define WEIGHT_MIN_VALID_G 2000             // Lighter means nobody on the platform
+#define WEIGHT_MAX_VALID_G 250000
+
+// I2C LCD Settings
+#define LCD_I2C_ADDRESS 0x27
+#define LCD_COLS 16
+#define LCD_ROWS 2
+
+// ============================================
+// Hx711Reader Class
+// ============================================
+
+class Hx711Reader {
+public:
+    Hx711Reader(uint8_t doutPin, uint8_t sckPin, uint8_t gainPulses)
+        : doutPin_(doutPin)
+        , sckPin_(sckPin)
+        , gainPulses_(gainPulses)
+    {
+    }
+
+    void begin() {
+        pinMode(sckPin_, OUTPUT);
+        pinMode(doutPin_, INPUT);
+        digitalWrite(sckPin_, LOW);
+    }
+
+    // Returns false at once if no conversion is waiting (DOUT high)
+    bool poll(int32_t& raw) {
+        if (digitalRead(doutPin_) != LOW) {
+            return false;
+        }
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < 24; ++i) {
+            value = (value << 1) | static_cast<uint32_t>(pulse());
+        }
+        for (uint8_t i = 0; i < gainPulses_; ++i) {
+            pulse();
+        }
+        raw = static_cast<int32_t>(value << 8) >> 8;  // sign-extend 24 bits
+        return true;
+    }
+
+private:
+    uint8_t doutPin_;
+    uint8_t sckPin_;
+    uint8_t gainPulses_;
+
+    // PD_SCK high for more than 60 us powers the HX711 down
+    int pulse() {
+        noInterrupts();
+        digitalWrite(sckPin_, HIGH);
+        delayMicroseconds(1);
+        int bit = digitalRead(doutPin_);
+        digitalWrite(sckPin_, LOW);
+        interrupts();
+        delayMicroseconds(1);
+        return bit == HIGH ? 1 : 0;
+    }
+};
+
+// ============================================
+// CicDecimator Class
+// ============================================
+
+template<uint8_t ORDER, uint8_t LOG2_RATE>
+class CicDecimator {
+public:
+    CicDecimator() {
+        for (uint8_t i = 0; i < ORDER; ++i) {
+            integrators_[i] = 0;
+            combs_[i] = 0;
+        }
+        phase_ = 0;
+        primed_ = 0;
+    }
+
+    // Returns true every 2^LOG2_RATE inputs, with the average in out
+    bool push(int32_t sample, int32_t& out) {
+        uint32_t value = static_cast<uint32_t>(sample);
+        for (uint8_t i = 0; i < ORDER; ++i) {
+            integrators_[i] += value;   // wraps on purpose; the combs undo it
+            value = integrators_[i];
+        }
+        if (++phase_ < (1u << LOG2_RATE)) {
+            return false;
+        }
+        phase_ = 0;
+
+        for (uint8_t i = 0; i < ORDER; ++i) {
+            uint32_t delayed = combs_[i];
+            combs_[i] = value;
+            value -= delayed;
+        }
+        if (primed_ < ORDER) {
+            primed_++;
+            return false;
+        }
+        out = static_cast<int32_t>(value) >> (ORDER * LOG2_RATE);
+        return true;
+    }
+
+private:
+    uint32_t integrators_[ORDER];
+    uint32_t combs_[ORDER];
+    uint8_t phase_;
+    uint8_t primed_;
+};
+
+// ============================================
+// ReadingDebouncer Template Class
+// ============================================
+
+template<typename T>
+class ReadingDebouncer {
+public:
+    ReadingDebouncer(T tolerance, unsigned long stabilityDurationMs, unsigned long sampleIntervalMs,
+                     T minValid, T maxValid)
+        : tolerance_(tolerance)
+        , stabilityDurationMs_(stabilityDurationMs)
+        , sampleIntervalMs_(sampleIntervalMs)
+        , minValid_(minValid)
+        , maxValid_(maxValid)
+        , lastReading_(T())
+        , stableReading_(T())
+        , stabilityStartTime_(0)
+        , lastSampleTime_(0)
+        , isStable_(false)
+        , hasReading_(false)
+    {
+    }
+
+    void update(T currentReading, unsigned long currentTimeMs) {
+        if (hasReading_ && (currentTimeMs - lastSampleTime_) < sampleIntervalMs_) {
+            return;
+        }
+
+        lastSampleTime_ = currentTimeMs;
+
+        if (currentReading < minValid_ || currentReading > maxValid_) {
+            reset();
+            return;
+        }
+
+        if (!hasReading_) {
+            lastReading_ = currentReading;
+            stabilityStartTime_ = currentTimeMs;
+            hasReading_ = true;
+            isStable_ = false;
+            return;
+        }
+
+        T diff = currentReading - lastReading_;
+        if (diff < T()) diff = -diff;
+        if (diff <= tolerance_) {
+            if (currentTimeMs - stabilityStartTime_ >= stabilityDurationMs_) {
+                isStable_ = true;
+                stableReading_ = currentReading;
+            }
+        } else {
+            stabilityStartTime_ = currentTimeMs;
+            isStable_ = false;
+        }
+
+        lastReading_ = currentReading;
+    }
+
+    bool isStable() const { return isStable_; }
+    T getStableReading() const { return isStable_ ? stableReading_ : T(); }
+
+    void reset() {
+        lastReading_ = T();
+        stableReading_ = T();
+        stabilityStartTime_ = 0;
+        lastSampleTime_ = 0;
+        isStable_ = false;
+        hasReading_ = false;
+    }
+
+private:
+    T tolerance_;
+    unsigned long stabilityDurationMs_;
+    unsigned long sampleIntervalMs_;
+    T minValid_;
+    T maxValid_;
+    T lastReading_;
+    T stableReading_;
+    unsigned long stabilityStartTime_;
+    unsigned long lastSampleTime_;
+    bool isStable_;
+    bool hasReading_;
+};
+
+// ============================================
+// Global Objects
+// ============================================
+
+LiquidCrystal_I2C lcd(LCD_I2C_ADDRESS, LCD_COLS, LCD_ROWS);
+Hx711Reader scale(HX711_DOUT_PIN, HX711_SCK_PIN, HX711_GAIN_PULSES);
+CicDecimator<WEIGHT_CIC_ORDER, WEIGHT_CIC_LOG2_RATE> decimator;
+ReadingDebouncer<long> debouncer(WEIGHT_TOLERANCE_G, WEIGHT_STABILITY_DURATION_MS, WEIGHT_SAMPLE_INTERVAL_MS,
+                                 WEIGHT_MIN_VALID_G, WEIGHT_MAX_VALID_G);
+
+int32_t tareSum = 0;
+uint8_t tareCount = 0;
+int32_t tareOffset = 0;
+
+char lcdLine[LCD_COLS + 1];   // row 1 as it should read
+uint8_t lcdPos = LCD_COLS;    // next character to send; LCD_COLS when up to date
+
+// ============================================
+// Helpers
+// ============================================
+
+// "72.45 kg" without floating point
+void formatKg(char* out, size_t size, long grams) {
+    bool negative = grams < 0;
+    if (negative) grams = -grams;
+    snprintf(out, size, "%s%ld.%02ld kg", negative ? "-" : "", grams / 1000, (grams % 1000) / 10);
+}
+
+// Queue row 1 for display, padded to the full width
+void showLine(const char* text) {
+    uint8_t i = 0;
+    for (; i < LCD_COLS && text[i] != '\0'; ++i) {
+        lcdLine[i] = text[i];
+    }
+    for (; i < LCD_COLS; ++i) {
+        lcdLine[i] = ' ';
+    }
+    lcdLine[LCD_COLS] = '\0';
+    lcdPos = 0;
+}
+
+// One LCD transfer per call: each costs about a millisecond of I2C time
+void refreshDisplay() {
+    if (lcdPos >= LCD_COLS) {
+        return;
+    }
+    if (lcdPos == 0) {
+        lcd.setCursor(0, 1);
+    }
+    lcd.print(lcdLine[lcdPos++]);
+}
+
+void report(long grams) {
+    char text[LCD_COLS + 1];
+    char stable[12];
+    formatKg(text, sizeof(text), grams);
+
+    Serial.print("Raw: ");
+    Serial.print(text);
+    Serial.print(" | Stable: ");
+    if (debouncer.isStable()) {
+        formatKg(stable, sizeof(stable), debouncer.getStableReading());
+        Serial.print("YES (");
+        Serial.print(stable);
+        Serial.println(")");
+    } else {
+        Serial.println("NO");
+    }
+
+    if (grams < WEIGHT_MIN_VALID_G) {
+        showLine("Step on");
+    } else {
+        size_t length = strlen(text);
+        snprintf(text + length, sizeof(text) - length, " %s", debouncer.isStable() ? "OK" : "...");
+        showLine(text);
+    }
+}
+
+// ============================================
+// Setup
+// ============================================
+
+void setup() {
+    Serial.begin(115200);
+
+    lcd.init();
+    lcd.backlight();
+    lcd.clear();
+    lcd.setCursor(0, 0);
+    lcd.print("Weight:");
+
+    scale.begin();
+    showLine("Taring...");
+}
+
+// ============================================
+// Main Loop
+// ============================================
+
+void loop() {
+    refreshDisplay();
+
+    int32_t raw;
+    int32_t filtered;
+    if (!scale.poll(raw) || !decimator.push(raw, filtered)) {
+        return;
+    }
+
+    // The first readings with an empty platform set the zero
+    if (tareCount < WEIGHT_TARE_READINGS) {
+        tareSum += filtered;
+        if (++tareCount == WEIGHT_TARE_READINGS) {
+            tareOffset = tareSum / WEIGHT_TARE_READINGS;
+            showLine("Step on");
+        }
+        return;
+    }
+
+    long grams = static_cast<long>(filtered - tareOffset) * 100L / HX711_COUNTS_PER_100G;
+    debouncer.update(grams, millis());
+    report(grams);
+}
@@ -0,0 +1,643 @@
+#include "alert_rules.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const char* kChannelNames[SAMPLE_CHANNEL_COUNT] = { "height", "bpm", "spo2" };
+
+const unsigned long kNotHolding = ~0UL;   // Rule::since while the condition is false
+
+// ============================================
+// Rule compiler
+// ============================================
+
+enum TokenKind {
+    TOKEN_END = 0,
+    TOKEN_WORD,
+    TOKEN_NUMBER,
+    TOKEN_COMPARE,
+    TOKEN_OPEN,
+    TOKEN_CLOSE,
+    TOKEN_INVALID
+};
+
+struct Token {
+    int kind;
+    std::string word;    // lower-cased
+    double number;
+    uint8_t compare;
+    size_t column;       // 1-based
+};
+
+/**
+ * Recursive descent over the rule grammar, emitting postfix code:
+ *   rule   := or [ "for" NUMBER unit ]
+ *   or     := and { "or" and }
+ *   and    := unary { ("and" | "while") unary }
+ *   unary  := "not" unary | "(" or ")" | CHANNEL term
+ *   term   := "stable" [ COMPARE NUMBER ] | [ "session" ] "active" | COMPARE NUMBER
+ */
+class RuleParser {
+public:
+    RuleParser(const std::string& text, AlertRuleProgram& out)
+        : text_(text)
+        , pos_(0)
+        , out_(out)
+        , depth_(0)
+    {
+        advance();
+    }
+
+    bool parse() {
+        if (!parseOr()) {
+            return false;
+        }
+        if (isWord("for")) {
+            advance();
+            if (!parseHold()) {
+                return false;
+            }
+        }
+        if (token_.kind != TOKEN_END) {
+            return fail("unexpected text");
+        }
+        return true;
+    }
+
+    const std::string& getError() const { return error_; }
+
+private:
+    const std::string& text_;
+    size_t pos_;
+    Token token_;
+    AlertRuleProgram& out_;
+    unsigned depth_;
+    std::string error_;
+
+    void advance() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+            ++pos_;
+        }
+        token_.column = pos_ + 1;
+        token_.word.clear();
+        if (pos_ >= text_.size()) {
+            token_.kind = TOKEN_END;
+            return;
+        }
+        char c = text_[pos_];
+        char next = pos_ + 1 < text_.size() ? text_[pos_ + 1] : '\0';
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            token_.kind = TOKEN_WORD;
+            while (pos_ < text_.size() &&
+                   (std::isalnum(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '_')) {
+                token_.word += static_cast<char>(std::tolower(static_cast<unsigned char>(text_[pos_])));
+                ++pos_;
+            }
+        } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '.' ||
+                   (c == '-' && (std::isdigit(static_cast<unsigned char>(next)) || next == '.'))) {
+            const char* start = text_.c_str() + pos_;
+            char* end = NULL;
+            token_.number = std::strtod(start, &end);
+            if (end == start) {
+                token_.kind = TOKEN_INVALID;
+                return;
+            }
+            token_.kind = TOKEN_NUMBER;
+            pos_ += static_cast<size_t>(end - start);
+        } else if (c == '(' || c == ')') {
+            token_.kind = c == '(' ? TOKEN_OPEN : TOKEN_CLOSE;
+            ++pos_;
+        } else if (c == '<' || c == '>') {
+            token_.kind = TOKEN_COMPARE;
+            bool orEqual = next == '=';
+            token_.compare = static_cast<uint8_t>(c == '<' ? (orEqual ? ALERT_CMP_LE : ALERT_CMP_LT)
+                                                           : (orEqual ? ALERT_CMP_GE : ALERT_CMP_GT));
+            pos_ += orEqual ? 2 : 1;
+        } else if ((c == '=' || c == '!') && next == '=') {
+            token_.kind = TOKEN_COMPARE;
+            token_.compare = static_cast<uint8_t>(c == '=' ? ALERT_CMP_EQ : ALERT_CMP_NE);
+            pos_ += 2;
+        } else {
+            token_.kind = TOKEN_INVALID;
+        }
+    }
+
+    bool isWord(const char* word) const { return token_.kind == TOKEN_WORD && token_.word == word; }
+
+    bool fail(const char* message) {
+        char buffer[96];
+        std::snprintf(buffer, sizeof(buffer), "%s at column %lu", message, static_cast<unsigned long>(token_.column));
+        error_ = buffer;
+        return false;
+    }
+
+    bool emitPush(uint8_t op, uint8_t channel, uint8_t compare, float constant) {
+        if (++depth_ > ALERT_RULE_MAX_DEPTH) {
+            return fail("rule nests too deeply");
+        }
+        if (depth_ > out_.depth) {
+            out_.depth = depth_;
+        }
+        AlertInstruction instruction;
+        instruction.op = op;
+        instruction.channel = channel;
+        instruction.compare = compare;
+        instruction.constant = constant;
+        out_.code.push_back(instruction);
+        return true;
+    }
+
+    void emitOperator(uint8_t op) {
+        if (op != ALERT_OP_NOT) {
+            --depth_;
+        }
+        AlertInstruction instruction;
+        instruction.op = op;
+        instruction.channel = 0;
+        instruction.compare = 0;
+        instruction.constant = 0.0f;
+        out_.code.push_back(instruction);
+    }
+
+    bool parseOr() {
+        if (!parseAnd()) {
+            return false;
+        }
+        while (isWord("or")) {
+            advance();
+            if (!parseAnd()) {
+                return false;
+            }
+            emitOperator(ALERT_OP_OR);
+        }
+        return true;
+    }
+
+    bool parseAnd() {
+        if (!parseUnary()) {
+            return false;
+        }
+        while (isWord("and") || isWord("while")) {
+            advance();
+            if (!parseUnary()) {
+                return false;
+            }
+            emitOperator(ALERT_OP_AND);
+        }
+        return true;
+    }
+
+    bool parseUnary() {
+        if (isWord("not")) {
+            advance();
+            if (!parseUnary()) {
+                return false;
+            }
+            emitOperator(ALERT_OP_NOT);
+            return true;
+        }
+        if (token_.kind == TOKEN_OPEN) {
+            advance();
+            if (!parseOr()) {
+                return false;
+            }
+            if (token_.kind != TOKEN_CLOSE) {
+                return fail("expected )");
+            }
+            advance();
+            return true;
+        }
+        return parseTerm();
+    }
+
+    bool parseTerm() {
+        int channel = -1;
+        for (int c = 0; c < SAMPLE_CHANNEL_COUNT && token_.kind == TOKEN_WORD; ++c) {
+            if (token_.word == kChannelNames[c]) {
+                channel = c;
+            }
+        }
+        if (channel < 0) {
+            return fail("expected height, bpm or spo2");
+        }
+        advance();
+
+        if (isWord("stable")) {
+            advance();
+            if (token_.kind != TOKEN_COMPARE) {
+                return emitPush(ALERT_OP_STABLE, static_cast<uint8_t>(channel), 0, 0.0f);
+            }
+            return parseComparison(ALERT_OP_STABLE_CMP, static_cast<uint8_t>(channel));
+        }
+        if (isWord("session")) {
+            advance();
+            if (!isWord("active")) {
+                return fail("expected active");
+            }
+        }
+        if (isWord("active")) {
+            advance();
+            return emitPush(ALERT_OP_ACTIVE, static_cast<uint8_t>(channel), 0, 0.0f);
+        }
+        if (token_.kind == TOKEN_COMPARE) {
+            return parseComparison(ALERT_OP_READING_CMP, static_cast<uint8_t>(channel));
+        }
+        return fail("expected stable, active or a comparison");
+    }
+
+    bool parseComparison(uint8_t op, uint8_t channel) {
+        uint8_t compare = token_.compare;
+        advance();
+        if (token_.kind != TOKEN_NUMBER) {
+            return fail("expected a number");
+        }
+        float constant = static_cast<float>(token_.number);
+        advance();
+        return emitPush(op, channel, compare, constant);
+    }
+
+    bool parseHold() {
+        if (token_.kind != TOKEN_NUMBER || token_.number < 0.0) {
+            return fail("expected a duration");
+        }
+        double amount = token_.number;
+        advance();
+        double scale = 0.0;
+        if (isWord("ms")) {
+            scale = 1.0;
+        } else if (isWord("s") || isWord("sec")) {
+            scale = 1000.0;
+        } else if (isWord("min")) {
+            scale = 60000.0;
+        } else {
+            return fail("expected ms, s or min");
+        }
+        advance();
+        out_.holdMs = static_cast<unsigned long>(amount * scale + 0.5);
+        return true;
+    }
+};
+
+// ============================================
+// Column kernels
+// ============================================
+
+struct Less {
+    bool operator()(float a, float b) const { return a < b; }
+};
+struct LessEqual {
+    bool operator()(float a, float b) const { return a <= b; }
+};
+struct Greater {
+    bool operator()(float a, float b) const { return a > b; }
+};
+struct GreaterEqual {
+    bool operator()(float a, float b) const { return a >= b; }
+};
+struct Equal {
+    bool operator()(float a, float b) const { return a == b; }
+};
+struct NotEqual {
+    bool operator()(float a, float b) const { return a != b; }
+};
+
+/**
+ * out = flag && value <compare> constant, with no branch per station
+ */
+template <typename Compare>
+void compareColumn(const uint8_t* flags, const float* values, float constant, uint8_t* out, size_t count) {
+    Compare compare;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<uint8_t>(flags[i] & static_cast<uint8_t>(compare(values[i], constant)));
+    }
+}
+
+void compareColumn(uint8_t compare, const uint8_t* flags, const float* values, float constant, uint8_t* out,
+                   size_t count) {
+    switch (compare) {
+    case ALERT_CMP_LT:
+        compareColumn<Less>(flags, values, constant, out, count);
+        break;
+    case ALERT_CMP_LE:
+        compareColumn<LessEqual>(flags, values, constant, out, count);
+        break;
+    case ALERT_CMP_GT:
+        compareColumn<Greater>(flags, values, constant, out, count);
+        break;
+    case ALERT_CMP_GE:
+        compareColumn<GreaterEqual>(flags, values, constant, out, count);
+        break;
+    case ALERT_CMP_EQ:
+        compareColumn<Equal>(flags, values, constant, out, count);
+        break;
+    default:
+        compareColumn<NotEqual>(flags, values, constant, out, count);
+        break;
+    }
+}
+
+bool compareOne(uint8_t compare, float value, float constant) {
+    switch (compare) {
+    case ALERT_CMP_LT:
+        return value < constant;
+    case ALERT_CMP_LE:
+        return value <= constant;
+    case ALERT_CMP_GT:
+        return value > constant;
+    case ALERT_CMP_GE:
+        return value >= constant;
+    case ALERT_CMP_EQ:
+        return value == constant;
+    default:
+        return value != constant;
+    }
+}
+
+} // namespace
+
+// ============================================
+// compileAlertRule
+// ============================================
+
+AlertRuleProgram::AlertRuleProgram()
+    : holdMs(0)
+    , depth(0)
+{
+}
+
+bool compileAlertRule(const std::string& text, AlertRuleProgram& out, std::string* error) {
+    out = AlertRuleProgram();
+    RuleParser parser(text, out);
+    if (!parser.parse()) {
+        if (error != NULL) {
+            *error = parser.getError();
+        }
+        out = AlertRuleProgram();
+        return false;
+    }
+    return true;
+}
+
+// ============================================
+// AlertRuleEngine
+// ============================================
+
+AlertRuleEngine::AlertRuleEngine(size_t expectedStations) {
+    slots_.reserve(expectedStations);
+    ids_.reserve(expectedStations);
+    clockMs_.reserve(expectedStations);
+    changedMs_.reserve(expectedStations);
+    for (int c = 0; c < SAMPLE_CHANNEL_COUNT; ++c) {
+        stable_[c].reserve(expectedStations);
+        stableValue_[c].reserve(expectedStations);
+        active_[c].reserve(expectedStations);
+        reading_[c].reserve(expectedStations);
+    }
+}
+
+bool AlertRuleEngine::addRule(const std::string& name, const std::string& text, std::string* error) {
+    Rule rule;
+    if (!compileAlertRule(text, rule.program, error)) {
+        return false;
+    }
+    rule.name = name;
+    rule.since.assign(ids_.size(), kNotHolding);
+    rule.firing.assign(ids_.size(), 0);
+    rule.firingCount = 0;
+    rules_.push_back(rule);
+    return true;
+}
+
+uint32_t AlertRuleEngine::slotFor(uint32_t stationId) {
+    std::unordered_map<uint32_t, uint32_t>::iterator it = slots_.find(stationId);
+    if (it != slots_.end()) {
+        return it->second;
+    }
+    uint32_t slot = static_cast<uint32_t>(ids_.size());
+    slots_[stationId] = slot;
+    ids_.push_back(stationId);
+    clockMs_.push_back(0);
+    changedMs_.push_back(0);
+    for (int c = 0; c < SAMPLE_CHANNEL_COUNT; ++c) {
+        stable_[c].push_back(0);
+        stableValue_[c].push_back(0.0f);
+        active_[c].push_back(0);
+        reading_[c].push_back(0.0f);
+    }
+    for (size_t r = 0; r < rules_.size(); ++r) {
+        rules_[r].since.push_back(kNotHolding);
+        rules_[r].firing.push_back(0);
+    }
+    return slot;
+}
+
+void AlertRuleEngine::touch(uint32_t slot, unsigned long timeMs, bool changed) {
+    if (timeMs > clockMs_[slot]) {
+        clockMs_[slot] = timeMs;
+    }
+    if (changed) {
+        changedMs_[slot] = clockMs_[slot];   // never ahead of the clock a hold is measured on
+    }
+}
+
+void AlertRuleEngine::onTransition(const StabilityTransition& transition) {
+    if (transition.channel >= SAMPLE_CHANNEL_COUNT) {
+        return;
+    }
+    uint32_t slot = slotFor(transition.deviceId);
+    stable_[transition.channel][slot] = transition.stable ? 1 : 0;
+    if (transition.stable) {
+        stableValue_[transition.channel][slot] = transition.value;
+    }
+    touch(slot, transition.timeMs, true);
+}
+
+void AlertRuleEngine::onStableUpdate(const StabilityTransition& transition) {
+    if (transition.channel >= SAMPLE_CHANNEL_COUNT) {
+        return;
+    }
+    uint32_t slot = slotFor(transition.deviceId);
+    stableValue_[transition.channel][slot] = transition.value;
+    touch(slot, transition.timeMs, true);
+}
+
+void AlertRuleEngine::onDebounceEvent(const DebounceEvent& event) {
+    if (event.channel >= SAMPLE_CHANNEL_COUNT) {
+        return;
+    }
+    uint32_t slot = slotFor(event.deviceId);
+    uint8_t& active = active_[event.channel][slot];
+    float& reading = reading_[event.channel][slot];
+    bool changed = false;
+    if (event.type == DEBOUNCE_EVENT_INVALID_RESET) {
+        changed = active != 0;
+        active = 0;
+    } else if (event.type != DEBOUNCE_EVENT_SKIPPED) {
+        changed = active == 0 || reading != event.value;
+        active = 1;
+        reading = event.value;
+    }
+    touch(slot, event.timeMs, changed);
+}
+
+void AlertRuleEngine::runBlock(const AlertRuleProgram& program, size_t begin, size_t count,
+                               uint8_t stack[][ALERT_RULE_BLOCK_STATIONS]) const {
+    size_t top = 0;   // slots in use
+    for (size_t pc = 0; pc < program.code.size(); ++pc) {
+        const AlertInstruction& instruction = program.code[pc];
+        uint8_t* out = stack[top];
+        switch (instruction.op) {
+        case ALERT_OP_STABLE:
+            std::memcpy(out, &stable_[instruction.channel][begin], count);
+            ++top;
+            break;
+        case ALERT_OP_ACTIVE:
+            std::memcpy(out, &active_[instruction.channel][begin], count);
+            ++top;
+            break;
+        case ALERT_OP_STABLE_CMP:
+            compareColumn(instruction.compare, &stable_[instruction.channel][begin],
+                          &stableValue_[instruction.channel][begin], instruction.constant, out, count);
+            ++top;
+            break;
+        case ALERT_OP_READING_CMP:
+            compareColumn(instruction.compare, &active_[instruction.channel][begin],
+                          &reading_[instruction.channel][begin], instruction.constant, out, count);
+            ++top;
+            break;
+        case ALERT_OP_AND: {
+            uint8_t* left = stack[top - 2];
+            const uint8_t* right = stack[top - 1];
+            for (size_t i = 0; i < count; ++i) {
+                left[i] &= right[i];
+            }
+            --top;
+            break;
+        }
+        case ALERT_OP_OR: {
+            uint8_t* left = stack[top - 2];
+            const uint8_t* right = stack[top - 1];
+            for (size_t i = 0; i < count; ++i) {
+                left[i] |= right[i];
+            }
+            --top;
+            break;
+        }
+        case ALERT_OP_NOT: {
+            uint8_t* operand = stack[top - 1];
+            for (size_t i = 0; i < count; ++i) {
+                operand[i] ^= 1;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+size_t AlertRuleEngine::evaluate(std::vector<AlertEvent>& out) {
+    size_t before = out.size();
+    uint8_t stack[ALERT_RULE_MAX_DEPTH][ALERT_RULE_BLOCK_STATIONS];
+    const size_t stations = ids_.size();
+
+    for (size_t r = 0; r < rules_.size(); ++r) {
+        Rule& rule = rules_[r];
+        const unsigned long holdMs = rule.program.holdMs;
+        for (size_t begin = 0; begin < stations; begin += ALERT_RULE_BLOCK_STATIONS) {
+            size_t count = stations - begin < ALERT_RULE_BLOCK_STATIONS ? stations - begin : ALERT_RULE_BLOCK_STATIONS;
+            runBlock(rule.program, begin, count, stack);
+
+            const uint8_t* holds = stack[0];
+            for (size_t i = 0; i < count; ++i) {
+                size_t slot = begin + i;
+                unsigned long& since = rule.since[slot];
+                if (holds[i]) {
+                    if (since == kNotHolding) {
+                        since = changedMs_[slot];
+                    }
+                    if (!rule.firing[slot] && clockMs_[slot] - since >= holdMs) {
+                        rule.firing[slot] = 1;
+                        rule.firingCount++;
+                        AlertEvent event;
+                        event.stationId = ids_[slot];
+                        event.rule = static_cast<uint32_t>(r);
+                        event.timeMs = since + holdMs;
+                        event.raised = true;
+                        out.push_back(event);
+                    }
+                } else if (since != kNotHolding) {
+                    since = kNotHolding;
+                    if (rule.firing[slot]) {
+                        rule.firing[slot] = 0;
+                        rule.firingCount--;
+                        AlertEvent event;
+                        event.stationId = ids_[slot];
+                        event.rule = static_cast<uint32_t>(r);
+                        event.timeMs = changedMs_[slot];
+                        event.raised = false;
+                        out.push_back(event);
+                    }
+                }
+            }
+        }
+    }
+    return out.size() - before;
+}
+
+bool AlertRuleEngine::testSlot(const AlertRuleProgram& program, uint32_t slot) const {
+    bool stack[ALERT_RULE_MAX_DEPTH];
+    size_t top = 0;
+    for (size_t pc = 0; pc < program.code.size(); ++pc) {
+        const AlertInstruction& instruction = program.code[pc];
+        switch (instruction.op) {
+        case ALERT_OP_STABLE:
+            stack[top++] = stable_[instruction.channel][slot] != 0;
+            break;
+        case ALERT_OP_ACTIVE:
+            stack[top++] = active_[instruction.channel][slot] != 0;
+            break;
+        case ALERT_OP_STABLE_CMP:
+            stack[top++] = stable_[instruction.channel][slot] != 0 &&
+                           compareOne(instruction.compare, stableValue_[instruction.channel][slot], instruction.constant);
+            break;
+        case ALERT_OP_READING_CMP:
+            stack[top++] = active_[instruction.channel][slot] != 0 &&
+                           compareOne(instruction.compare, reading_[instruction.channel][slot], instruction.constant);
+            break;
+        case ALERT_OP_AND:
+            --top;
+            stack[top - 1] = stack[top - 1] && stack[top];
+            break;
+        case ALERT_OP_OR:
+            --top;
+            stack[top - 1] = stack[top - 1] || stack[top];
+            break;
+        case ALERT_OP_NOT:
+            stack[top - 1] = !stack[top - 1];
+            break;
+        default:
+            break;
+        }
+    }
+    return top > 0 && stack[0];
+}
+
+bool AlertRuleEngine::test(size_t rule, uint32_t stationId) const {
+    std::unordered_map<uint32_t, uint32_t>::const_iterator it = slots_.find(stationId);
+    if (rule >= rules_.size() || it == slots_.end()) {
+        return false;
+    }
+    return testSlot(rules_[rule].program, it->second);
+}
+
+bool AlertRuleEngine::isFiring(size_t rule, uint32_t stationId) const {
+    std::unordered_map<uint32_t, uint32_t>::const_iterator it = slots_.find(stationId);
+    if (rule >= rules_.size() || it == slots_.end()) {
+        return false;
+    }
+    return rules_[rule].firing[it->second] != 0;
+}
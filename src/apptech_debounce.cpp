@@ -0,0 +1,453 @@
+#include "apptech_debounce.h"
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <vector>
+#include "config.h"
+#include "height_debouncer.h"
+#include "reading_debouncer.h"
+
+struct apptech_debouncer_bank {
+    uint32_t kind;
+    size_t laneCount;
+    std::vector<HeightDebouncer> height;
+    std::vector<ReadingDebouncer<float> > bpm;
+    std::vector<ReadingDebouncer<int> > spo2;
+};
+
+struct apptech_debouncer {
+    apptech_debouncer_bank bank;   // a bank of one lane
+};
+
+namespace {
+
+// ============================================
+// Per-kind adapters
+// ============================================
+
+void feed(HeightDebouncer& debouncer, double value, uint64_t timeMs) {
+    debouncer.update(static_cast<int>(value), static_cast<unsigned long>(timeMs));
+}
+
+void feed(ReadingDebouncer<float>& debouncer, double value, uint64_t timeMs) {
+    debouncer.update(static_cast<float>(value), static_cast<unsigned long>(timeMs));
+}
+
+void feed(ReadingDebouncer<int>& debouncer, double value, uint64_t timeMs) {
+    debouncer.update(static_cast<int>(value), static_cast<unsigned long>(timeMs));
+}
+
+// Doubles from a foreign caller are checked before any cast, since casting
+// NaN, infinity or an out-of-range value to int or float is undefined
+bool fitsInt(double value) {
+    return std::isfinite(value) && value > static_cast<double>(INT_MIN) - 1.0 &&
+           value < static_cast<double>(INT_MAX) + 1.0;
+}
+
+bool fitsFloat(double value) {
+    return std::isfinite(value) && std::fabs(value) <= static_cast<double>(FLT_MAX);
+}
+
+bool accepts(const HeightDebouncer&, double value) {
+    return fitsInt(value);
+}
+
+bool accepts(const ReadingDebouncer<float>&, double value) {
+    return fitsFloat(value);
+}
+
+bool accepts(const ReadingDebouncer<int>&, double value) {
+    return fitsInt(value);
+}
+
+template<typename Debouncer>
+void readState(const Debouncer& debouncer, apptech_debounce_state& state) {
+    state.stable = debouncer.isStable() ? 1 : 0;
+    state.has_reading = debouncer.hasValidReading() ? 1 : 0;
+    state.stable_reading = static_cast<double>(debouncer.getStableReading());
+    state.last_reading = static_cast<double>(debouncer.getLastReading());
+}
+
+// ============================================
+// Batch loop
+// ============================================
+
+/**
+ * Samples from parallel lane/value/time columns (lanes may be NULL: all lane 0)
+ */
+struct ColumnSamples {
+    const uint32_t* lanes;
+    const double* values;
+    const uint64_t* times;
+
+    uint32_t lane(size_t i) const { return lanes != NULL ? lanes[i] : 0; }
+    double value(size_t i) const { return values[i]; }
+    uint64_t time(size_t i) const { return times[i]; }
+};
+
+/**
+ * One value per lane, all at the same time
+ */
+struct TickSamples {
+    const double* values;
+    uint64_t timeMs;
+
+    uint32_t lane(size_t i) const { return static_cast<uint32_t>(i); }
+    double value(size_t i) const { return values[i]; }
+    uint64_t time(size_t) const { return timeMs; }
+};
+
+/**
+ * Apply samples in order, writing transitions to out. Each sample yields
+ * at most one transition, so a free slot is checked before each sample
+ * and the batch stops cleanly when the buffer is full.
+ */
+template<typename Debouncer, typename Samples>
+int runBatch(std::vector<Debouncer>& lanes, const Samples& samples, size_t count, apptech_transition* out,
+             size_t outCapacity, size_t* outCount, size_t* consumed) {
+    size_t written = 0;
+    size_t i = 0;
+    int status = APPTECH_OK;
+    for (; i < count; ++i) {
+        uint32_t lane = samples.lane(i);
+        if (lane >= lanes.size()) {
+            status = APPTECH_ERR_INVALID_ARGUMENT;
+            break;
+        }
+        if (out != NULL && written == outCapacity) {
+            status = APPTECH_ERR_BUFFER_FULL;
+            break;
+        }
+
+        Debouncer& debouncer = lanes[lane];
+        double value = samples.value(i);
+        if (!accepts(debouncer, value)) {
+            status = APPTECH_ERR_INVALID_ARGUMENT;
+            break;
+        }
+        bool wasStable = debouncer.isStable();
+        double previous = static_cast<double>(debouncer.getStableReading());
+        feed(debouncer, value, samples.time(i));
+
+        uint32_t type;
+        if (debouncer.isStable() != wasStable) {
+            type = debouncer.isStable() ? APPTECH_TRANSITION_STABLE : APPTECH_TRANSITION_UNSTABLE;
+        } else if (wasStable && static_cast<double>(debouncer.getStableReading()) != previous) {
+            type = APPTECH_TRANSITION_UPDATE;
+        } else {
+            continue;
+        }
+        if (out != NULL) {
+            apptech_transition& transition = out[written++];
+            transition.sample_index = i;
+            transition.time_ms = samples.time(i);
+            transition.value = type == APPTECH_TRANSITION_UNSTABLE
+                                   ? value : static_cast<double>(debouncer.getStableReading());
+            transition.lane = lane;
+            transition.type = type;
+        }
+    }
+    *outCount = written;
+    if (consumed != NULL) {
+        *consumed = i;
+    }
+    return status;
+}
+
+template<typename Samples>
+int dispatchBatch(apptech_debouncer_bank& bank, const Samples& samples, size_t count, apptech_transition* out,
+                  size_t outCapacity, size_t* outCount, size_t* consumed) {
+    switch (bank.kind) {
+    case APPTECH_KIND_HEIGHT:
+        return runBatch(bank.height, samples, count, out, outCapacity, outCount, consumed);
+    case APPTECH_KIND_BPM:
+        return runBatch(bank.bpm, samples, count, out, outCapacity, outCount, consumed);
+    default:
+        return runBatch(bank.spo2, samples, count, out, outCapacity, outCount, consumed);
+    }
+}
+
+bool validBatchArguments(size_t count, const void* values, const void* times, const apptech_transition* out,
+                         size_t outCapacity, const size_t* outCount) {
+    return outCount != NULL && (count == 0 || (values != NULL && times != NULL)) &&
+           (out != NULL || outCapacity == 0);
+}
+
+// ============================================
+// Construction
+// ============================================
+
+static_assert(sizeof(apptech_debounce_config) >= APPTECH_DEBOUNCE_CONFIG_SIZE_V1,
+              "apptech_debounce_config may only grow");
+
+/**
+ * Copy a caller's config of any version into the library's layout
+ * @return false if the struct is older than version 1 or the kind is unknown
+ */
+bool readConfig(const apptech_debounce_config* config, apptech_debounce_config& full) {
+    if (config == NULL || config->struct_size < APPTECH_DEBOUNCE_CONFIG_SIZE_V1 ||
+        apptech_debounce_config_default(config->kind, &full) != APPTECH_OK) {
+        return false;
+    }
+    size_t supplied = config->struct_size < sizeof(full) ? config->struct_size : sizeof(full);
+    std::memcpy(&full, config, supplied);
+    full.struct_size = sizeof(full);
+    return true;
+}
+
+bool validConfig(const apptech_debounce_config& config) {
+    switch (config.kind) {
+    case APPTECH_KIND_HEIGHT:
+        return fitsInt(config.tolerance) && config.tolerance >= 0.0;
+    case APPTECH_KIND_BPM:
+        return fitsFloat(config.tolerance) && config.tolerance >= 0.0 && fitsFloat(config.min_valid) &&
+               fitsFloat(config.max_valid) && config.min_valid <= config.max_valid;
+    default:
+        return fitsInt(config.tolerance) && config.tolerance >= 0.0 && fitsInt(config.min_valid) &&
+               fitsInt(config.max_valid) && config.min_valid <= config.max_valid;
+    }
+}
+
+/**
+ * Size the bank's lane vector for its kind
+ * @return false if the lanes could not be allocated
+ */
+bool initBank(apptech_debouncer_bank& bank, const apptech_debounce_config& config, size_t lanes) {
+    unsigned long stabilityMs = static_cast<unsigned long>(config.stability_duration_ms);
+    unsigned long intervalMs = static_cast<unsigned long>(config.sample_interval_ms);
+    bank.kind = config.kind;
+    bank.laneCount = lanes;
+    try {
+        switch (config.kind) {
+        case APPTECH_KIND_HEIGHT:
+            bank.height.assign(lanes, HeightDebouncer(static_cast<int>(config.tolerance), stabilityMs, intervalMs));
+            break;
+        case APPTECH_KIND_BPM:
+            bank.bpm.assign(lanes, ReadingDebouncer<float>(static_cast<float>(config.tolerance), stabilityMs,
+                                                           intervalMs, static_cast<float>(config.min_valid),
+                                                           static_cast<float>(config.max_valid)));
+            break;
+        default:
+            bank.spo2.assign(lanes, ReadingDebouncer<int>(static_cast<int>(config.tolerance), stabilityMs,
+                                                          intervalMs, static_cast<int>(config.min_valid),
+                                                          static_cast<int>(config.max_valid)));
+            break;
+        }
+    } catch (const std::bad_alloc&) {
+        return false;   // exceptions must not cross the C boundary
+    }
+    return true;
+}
+
+void resetLane(apptech_debouncer_bank& bank, size_t lane) {
+    switch (bank.kind) {
+    case APPTECH_KIND_HEIGHT:
+        bank.height[lane].reset();
+        break;
+    case APPTECH_KIND_BPM:
+        bank.bpm[lane].reset();
+        break;
+    default:
+        bank.spo2[lane].reset();
+        break;
+    }
+}
+
+void laneState(const apptech_debouncer_bank& bank, size_t lane, apptech_debounce_state& state) {
+    switch (bank.kind) {
+    case APPTECH_KIND_HEIGHT:
+        readState(bank.height[lane], state);
+        break;
+    case APPTECH_KIND_BPM:
+        readState(bank.bpm[lane], state);
+        break;
+    default:
+        readState(bank.spo2[lane], state);
+        break;
+    }
+}
+
+} // namespace
+
+// ============================================
+// Library
+// ============================================
+
+uint32_t apptech_debounce_abi_version(void) {
+    return APPTECH_DEBOUNCE_ABI_VERSION;
+}
+
+const char* apptech_debounce_strerror(int status) {
+    switch (status) {
+    case APPTECH_OK:
+        return "ok";
+    case APPTECH_ERR_INVALID_ARGUMENT:
+        return "invalid argument";
+    case APPTECH_ERR_NO_MEMORY:
+        return "out of memory";
+    case APPTECH_ERR_BUFFER_FULL:
+        return "transition buffer full";
+    default:
+        return "unknown status";
+    }
+}
+
+int apptech_debounce_config_default(uint32_t kind, apptech_debounce_config* config) {
+    if (config == NULL) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    config->struct_size = sizeof(apptech_debounce_config);
+    config->kind = kind;
+    switch (kind) {
+    case APPTECH_KIND_HEIGHT:
+        config->tolerance = DEBOUNCE_TOLERANCE_CM;
+        config->stability_duration_ms = DEBOUNCE_STABILITY_DURATION_MS;
+        config->sample_interval_ms = DEBOUNCE_SAMPLE_INTERVAL_MS;
+        config->min_valid = 0.0;
+        config->max_valid = 0.0;
+        return APPTECH_OK;
+    case APPTECH_KIND_BPM:
+        config->tolerance = BPM_TOLERANCE;
+        config->stability_duration_ms = BPM_STABILITY_DURATION_MS;
+        config->sample_interval_ms = BPM_SAMPLE_INTERVAL_MS;
+        config->min_valid = BPM_MIN_VALID;
+        config->max_valid = BPM_MAX_VALID;
+        return APPTECH_OK;
+    case APPTECH_KIND_SPO2:
+        config->tolerance = SPO2_TOLERANCE;
+        config->stability_duration_ms = SPO2_STABILITY_DURATION_MS;
+        config->sample_interval_ms = SPO2_SAMPLE_INTERVAL_MS;
+        config->min_valid = SPO2_MIN_VALID;
+        config->max_valid = SPO2_MAX_VALID;
+        return APPTECH_OK;
+    default:
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+}
+
+// ============================================
+// Single debouncer
+// ============================================
+
+int apptech_debouncer_create(const apptech_debounce_config* config, apptech_debouncer** out) {
+    apptech_debounce_config full;
+    if (out == NULL || !readConfig(config, full) || !validConfig(full)) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    apptech_debouncer* debouncer = new (std::nothrow) apptech_debouncer;
+    if (debouncer == NULL || !initBank(debouncer->bank, full, 1)) {
+        delete debouncer;
+        return APPTECH_ERR_NO_MEMORY;
+    }
+    *out = debouncer;
+    return APPTECH_OK;
+}
+
+void apptech_debouncer_destroy(apptech_debouncer* debouncer) {
+    delete debouncer;
+}
+
+void apptech_debouncer_reset(apptech_debouncer* debouncer) {
+    if (debouncer != NULL) {
+        resetLane(debouncer->bank, 0);
+    }
+}
+
+int apptech_debouncer_update(apptech_debouncer* debouncer, const double* values, const uint64_t* times_ms,
+                             size_t count, apptech_transition* out, size_t out_capacity, size_t* out_count,
+                             size_t* consumed) {
+    if (debouncer == NULL || !validBatchArguments(count, values, times_ms, out, out_capacity, out_count)) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    ColumnSamples samples = { NULL, values, times_ms };
+    return dispatchBatch(debouncer->bank, samples, count, out, out_capacity, out_count, consumed);
+}
+
+int apptech_debouncer_get_state(const apptech_debouncer* debouncer, apptech_debounce_state* state) {
+    if (debouncer == NULL || state == NULL) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    laneState(debouncer->bank, 0, *state);
+    return APPTECH_OK;
+}
+
+// ============================================
+// Banks
+// ============================================
+
+int apptech_bank_create(const apptech_debounce_config* config, size_t lanes, apptech_debouncer_bank** out) {
+    apptech_debounce_config full;
+    if (out == NULL || lanes == 0 || lanes > UINT32_MAX || !readConfig(config, full) || !validConfig(full)) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    apptech_debouncer_bank* bank = new (std::nothrow) apptech_debouncer_bank;
+    if (bank == NULL || !initBank(*bank, full, lanes)) {
+        delete bank;
+        return APPTECH_ERR_NO_MEMORY;
+    }
+    *out = bank;
+    return APPTECH_OK;
+}
+
+void apptech_bank_destroy(apptech_debouncer_bank* bank) {
+    delete bank;
+}
+
+size_t apptech_bank_lane_count(const apptech_debouncer_bank* bank) {
+    return bank != NULL ? bank->laneCount : 0;
+}
+
+int apptech_bank_reset_lane(apptech_debouncer_bank* bank, uint32_t lane) {
+    if (bank == NULL || lane >= bank->laneCount) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    resetLane(*bank, lane);
+    return APPTECH_OK;
+}
+
+int apptech_bank_update(apptech_debouncer_bank* bank, const uint32_t* lanes, const double* values,
+                        const uint64_t* times_ms, size_t count, apptech_transition* out, size_t out_capacity,
+                        size_t* out_count, size_t* consumed) {
+    if (bank == NULL || (count > 0 && lanes == NULL) ||
+        !validBatchArguments(count, values, times_ms, out, out_capacity, out_count)) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    ColumnSamples samples = { lanes, values, times_ms };
+    return dispatchBatch(*bank, samples, count, out, out_capacity, out_count, consumed);
+}
+
+int apptech_bank_update_all(apptech_debouncer_bank* bank, const double* values, uint64_t time_ms,
+                            apptech_transition* out, size_t out_capacity, size_t* out_count, size_t* consumed) {
+    if (bank == NULL || !validBatchArguments(bank->laneCount, values, &time_ms, out, out_capacity, out_count)) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    TickSamples samples = { values, time_ms };
+    return dispatchBatch(*bank, samples, bank->laneCount, out, out_capacity, out_count, consumed);
+}
+
+int apptech_bank_get_state(const apptech_debouncer_bank* bank, uint32_t lane, apptech_debounce_state* state) {
+    if (bank == NULL || state == NULL || lane >= bank->laneCount) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    laneState(*bank, lane, *state);
+    return APPTECH_OK;
+}
+
+int apptech_bank_get_stable(const apptech_debouncer_bank* bank, uint8_t* stable, double* stable_readings) {
+    if (bank == NULL) {
+        return APPTECH_ERR_INVALID_ARGUMENT;
+    }
+    apptech_debounce_state state;
+    for (size_t lane = 0; lane < bank->laneCount; ++lane) {
+        laneState(*bank, lane, state);
+        if (stable != NULL) {
+            stable[lane] = static_cast<uint8_t>(state.stable);
+        }
+        if (stable_readings != NULL) {
+            stable_readings[lane] = state.stable_reading;
+        }
+    }
+    return APPTECH_OK;
+}
@@ -0,0 +1,288 @@
+#include "debounce_trace.h"
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DEBOUNCE_TRACE_HAVE_MMAP 1
+#endif
+
+namespace {
+
+const char* const kEventNames[DEBOUNCE_TRACE_EVENT_COUNT] = {
+    "interval-skip", "first-reading", "invalid-reset", "tolerance-reset", "stable"
+};
+
+// Checked by tracepoints before any ring exists; constant-initialized so
+// debouncers updated during static initialization see tracing disabled
+std::atomic<uint32_t> disabledFlag(0);
+
+// In-process ring, set up on first use
+alignas(64) unsigned char localStorage[sizeof(DebounceTraceRingHeader) +
+                                       DEBOUNCE_TRACE_DEFAULT_CAPACITY * sizeof(DebounceTraceRecord)];
+
+// Read by recorders on any thread; written under controlMutex
+std::atomic<DebounceTraceRingHeader*> activeRing(NULL);
+
+// Serializes attach, detach and enable. Attached mappings are never
+// unmapped: a tracepoint that loaded the old flag or ring just before a
+// detach may still write to it, so they stay mapped until exit.
+std::mutex controlMutex;
+std::vector<DebounceTraceMapping*> attachedMappings;
+
+uint32_t roundUpToPowerOfTwo(uint32_t value) {
+    uint32_t result = 1;
+    while (result < value && result < 0x80000000u) {
+        result <<= 1;
+    }
+    return result;
+}
+
+size_t ringBytes(uint32_t capacity) {
+    return sizeof(DebounceTraceRingHeader) + static_cast<size_t>(capacity) * sizeof(DebounceTraceRecord);
+}
+
+// Initialize a zeroed ring in place
+DebounceTraceRingHeader* initRing(void* memory, uint32_t capacity) {
+    DebounceTraceRingHeader* ring = new (memory) DebounceTraceRingHeader;
+    std::memcpy(ring->magic, DEBOUNCE_TRACE_MAGIC, sizeof(ring->magic));
+    ring->capacity = capacity;
+    ring->enabled.store(0, std::memory_order_relaxed);
+    ring->head.store(0, std::memory_order_relaxed);
+    std::memset(ring->reserved, 0, sizeof(ring->reserved));
+    DebounceTraceRecord* records = debounceTraceRecords(ring);
+    for (uint32_t i = 0; i < capacity; ++i) {
+        new (&records[i]) DebounceTraceRecord;
+        records[i].sequence.store(0, std::memory_order_relaxed);
+    }
+    return ring;
+}
+
+bool isValidRing(const DebounceTraceRingHeader* ring, size_t length) {
+    if (length < sizeof(DebounceTraceRingHeader) ||
+        std::memcmp(ring->magic, DEBOUNCE_TRACE_MAGIC, sizeof(ring->magic)) != 0) {
+        return false;
+    }
+    uint32_t capacity = ring->capacity;
+    return capacity != 0 && (capacity & (capacity - 1)) == 0 && ringBytes(capacity) <= length;
+}
+
+DebounceTraceRingHeader* localRing() {
+    static DebounceTraceRingHeader* ring = initRing(localStorage, DEBOUNCE_TRACE_DEFAULT_CAPACITY);
+    return ring;
+}
+
+// Caller holds controlMutex
+DebounceTraceRingHeader* ensureActiveRing() {
+    DebounceTraceRingHeader* ring = activeRing.load(std::memory_order_acquire);
+    if (ring == NULL) {
+        ring = localRing();
+        activeRing.store(ring, std::memory_order_release);
+    }
+    return ring;
+}
+
+} // namespace
+
+std::atomic<std::atomic<uint32_t>*> debounceTraceEnabledFlag(&disabledFlag);
+
+// ============================================
+// DebounceTraceMapping
+// ============================================
+
+DebounceTraceMapping::DebounceTraceMapping()
+    : header_(NULL)
+    , length_(0)
+{
+}
+
+DebounceTraceMapping::~DebounceTraceMapping() {
+    close();
+}
+
+bool DebounceTraceMapping::open(const char* path, uint32_t capacity) {
+    close();
+#ifdef DEBOUNCE_TRACE_HAVE_MMAP
+    int fd = ::open(path, capacity != 0 ? (O_RDWR | O_CREAT) : O_RDWR, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // Create (or replace an unusable file) when the caller gave a capacity
+    bool create = false;
+    size_t length = static_cast<size_t>(info.st_size);
+    if (capacity != 0) {
+        capacity = roundUpToPowerOfTwo(capacity);
+        if (length != ringBytes(capacity)) {
+            length = ringBytes(capacity);
+            if (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(length)) != 0) {
+                ::close(fd);
+                return false;
+            }
+            create = true;
+        }
+    }
+    if (length < sizeof(DebounceTraceRingHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    DebounceTraceRingHeader* ring = static_cast<DebounceTraceRingHeader*>(memory);
+    if (create || (capacity != 0 && !isValidRing(ring, length))) {
+        // Freshly truncated files are zero-filled
+        ring = initRing(memory, capacity);
+    } else if (!isValidRing(ring, length)) {
+        munmap(memory, length);
+        return false;
+    }
+
+    header_ = ring;
+    length_ = length;
+    return true;
+#else
+    (void)path;
+    (void)capacity;
+    return false;
+#endif
+}
+
+void DebounceTraceMapping::close() {
+#ifdef DEBOUNCE_TRACE_HAVE_MMAP
+    if (header_ != NULL) {
+        munmap(header_, length_);
+    }
+#endif
+    header_ = NULL;
+    length_ = 0;
+}
+
+// ============================================
+// Active ring
+// ============================================
+
+namespace {
+
+// Caller holds controlMutex
+void detachLocked() {
+    debounceTraceEnabledFlag.store(&disabledFlag, std::memory_order_release);
+    activeRing.store(NULL, std::memory_order_release);
+    localRing()->enabled.store(0, std::memory_order_relaxed);
+}
+
+} // namespace
+
+bool debounceTraceAttach(const char* path, uint32_t capacity) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    detachLocked();
+    DebounceTraceMapping* mapping = new DebounceTraceMapping;
+    if (!mapping->open(path, capacity ? capacity : DEBOUNCE_TRACE_DEFAULT_CAPACITY)) {
+        delete mapping;
+        return false;
+    }
+    attachedMappings.push_back(mapping);
+    DebounceTraceRingHeader* ring = mapping->header();
+    activeRing.store(ring, std::memory_order_release);
+    // The file's enabled word is honoured, so a decoder can arm tracing first
+    debounceTraceEnabledFlag.store(&ring->enabled, std::memory_order_release);
+    return true;
+}
+
+void debounceTraceDetach() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    detachLocked();
+}
+
+void debounceTraceSetEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    DebounceTraceRingHeader* ring = ensureActiveRing();
+    ring->enabled.store(enabled ? 1 : 0, std::memory_order_relaxed);
+    debounceTraceEnabledFlag.store(&ring->enabled, std::memory_order_release);
+}
+
+DebounceTraceRingHeader* debounceTraceActiveRing() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    return ensureActiveRing();
+}
+
+void debounceTraceRecord(DebounceTraceEvent event, const void* source, float reading, unsigned long timeMs) {
+    DebounceTraceRingHeader* ring = activeRing.load(std::memory_order_acquire);
+    if (ring == NULL) {
+        return;
+    }
+
+    uint64_t index = ring->head.fetch_add(1, std::memory_order_relaxed);
+    DebounceTraceRecord& record = debounceTraceRecords(ring)[index & (ring->capacity - 1)];
+
+    uint32_t sequence = static_cast<uint32_t>(index + 1);
+    if (sequence == DEBOUNCE_TRACE_SLOT_WRITING) {
+        return;   // the one index whose sequence would read as the writing mark
+    }
+
+    // Claim the slot and invalidate it while its fields are rewritten
+    uint32_t seen = record.sequence.load(std::memory_order_relaxed);
+    if (seen == DEBOUNCE_TRACE_SLOT_WRITING ||
+        !record.sequence.compare_exchange_strong(seen, DEBOUNCE_TRACE_SLOT_WRITING, std::memory_order_acquire,
+                                                 std::memory_order_relaxed)) {
+        return;   // another writer holds the slot; the ring is lossy anyway
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    record.reading = reading;
+    record.timeMs = timeMs;
+    record.source = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(source));
+    record.event = static_cast<uint8_t>(event);
+    record.sequence.store(sequence, std::memory_order_release);
+}
+
+uint64_t debounceTraceSnapshot(const DebounceTraceRingHeader* ring, uint64_t fromIndex,
+                               std::vector<DebounceTraceEntry>& out) {
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t capacity = ring->capacity;
+    uint64_t first = head > capacity ? head - capacity : 0;
+    if (fromIndex > first) {
+        first = fromIndex;
+    }
+
+    const DebounceTraceRecord* records = debounceTraceRecords(ring);
+    for (uint64_t index = first; index < head; ++index) {
+        const DebounceTraceRecord& record = records[index & (capacity - 1)];
+        uint32_t expected = static_cast<uint32_t>(index + 1);
+        if (record.sequence.load(std::memory_order_acquire) != expected) {
+            continue;  // still being written, or already recycled
+        }
+
+        DebounceTraceEntry entry;
+        entry.index = index;
+        entry.reading = record.reading;
+        entry.timeMs = record.timeMs;
+        entry.source = record.source;
+        entry.event = record.event;
+
+        // Re-check that no writer recycled the slot while it was copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (record.sequence.load(std::memory_order_relaxed) != expected) {
+            continue;
+        }
+        out.push_back(entry);
+    }
+    return head;
+}
+
+const char* debounceTraceEventName(uint8_t event) {
+    return event < DEBOUNCE_TRACE_EVENT_COUNT ? kEventNames[event] : "unknown";
+}
@@ -0,0 +1,327 @@
+#include "device_swarm.h"
+#include "config.h"
+#include "height_debouncer.h"
+#include "reading_debouncer.h"
+#include "sample_frame.h"
+#include "trace_sample.h"
+#include <cstdio>
+
+namespace {
+
+// Per-device xorshift32; cheap enough to live in every coroutine frame
+struct DeviceRandom {
+    uint32_t state;
+
+    explicit DeviceRandom(uint32_t seed) : state(seed ? seed : 0x9E3779B9u) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Uniform integer in [low, high]
+    int range(int low, int high) {
+        return low + static_cast<int>(next() % static_cast<uint32_t>(high - low + 1));
+    }
+
+    bool chance(unsigned percent) {
+        return next() % 100 < percent;
+    }
+};
+
+// Speed of sound: HC-SR04 echo takes about 58 us per cm of distance
+const unsigned long kEchoMicrosPerCm = 58;
+
+uint16_t toHundredths(float value) {
+    if (value <= 0.0f) {
+        return 0;
+    }
+    float scaled = value * 100.0f + 0.5f;
+    return scaled >= 65535.0f ? 65535 : static_cast<uint16_t>(scaled);
+}
+
+} // namespace
+
+// ============================================
+// VirtualEventLoop
+// ============================================
+
+VirtualEventLoop::VirtualEventLoop(unsigned wheelSlots)
+    : wheel_(wheelSlots ? wheelSlots : 1)
+    , nowMs_(0)
+    , resumeCount_(0)
+    , pendingCount_(0)
+{
+}
+
+void VirtualEventLoop::schedule(std::coroutine_handle<> handle, unsigned long wakeMs) {
+    if (wakeMs < nowMs_) {
+        wakeMs = nowMs_;
+    }
+    wheel_[wakeMs % wheel_.size()].push_back(Timer{wakeMs, handle});
+    pendingCount_++;
+}
+
+void VirtualEventLoop::run(unsigned long endMs) {
+    std::vector<Timer> deferred;
+    while (nowMs_ < endMs) {
+        std::vector<Timer>& slot = wheel_[nowMs_ % wheel_.size()];
+        // Resumed coroutines may schedule into this same slot, so drain it
+        // until only timers for later revolutions remain
+        while (!slot.empty()) {
+            expiring_.swap(slot);
+            for (size_t i = 0; i < expiring_.size(); ++i) {
+                if (expiring_[i].wakeMs > nowMs_) {
+                    deferred.push_back(expiring_[i]);
+                    continue;
+                }
+                pendingCount_--;
+                resumeCount_++;
+                expiring_[i].handle.resume();
+            }
+            expiring_.clear();
+        }
+        if (!deferred.empty()) {
+            slot.swap(deferred);
+        }
+        ++nowMs_;
+    }
+}
+
+// ============================================
+// DeviceTask
+// ============================================
+
+DeviceTask& DeviceTask::operator=(DeviceTask&& other) noexcept {
+    if (this != &other) {
+        if (handle_) {
+            handle_.destroy();
+        }
+        handle_ = other.handle_;
+        other.handle_ = nullptr;
+    }
+    return *this;
+}
+
+DeviceTask::~DeviceTask() {
+    if (handle_) {
+        handle_.destroy();
+    }
+}
+
+// ============================================
+// DeviceSwarm
+// ============================================
+
+SwarmOptions::SwarmOptions()
+    : heightMeters(0)
+    , pulseOximeters(0)
+    , protocol(SWARM_PROTOCOL_TEXT)
+    , heightSampleIntervalMs(DEBOUNCE_SAMPLE_INTERVAL_MS)
+    , oximeterReportPeriodMs(REPORTING_PERIOD_MS)
+    , seed(1)
+{
+}
+
+DeviceSwarm::DeviceSwarm(const SwarmOptions& options, SwarmSink* sink)
+    : options_(options)
+    , sink_(sink)
+    , messagesSent_(0)
+    , bytesSent_(0)
+{
+    DeviceRandom random(options_.seed);
+    uint32_t deviceId = 0;
+    tasks_.reserve(options_.heightMeters + options_.pulseOximeters);
+
+    // Devices boot at random offsets so their loops are not phase-locked
+    for (unsigned i = 0; i < options_.heightMeters; ++i, ++deviceId) {
+        tasks_.push_back(heightMeter(deviceId, random.next()));
+        loop_.schedule(tasks_.back().handle(), random.next() % (options_.heightSampleIntervalMs + 1));
+    }
+    for (unsigned i = 0; i < options_.pulseOximeters; ++i, ++deviceId) {
+        tasks_.push_back(pulseOximeter(deviceId, random.next()));
+        loop_.schedule(tasks_.back().handle(), random.next() % (options_.oximeterReportPeriodMs + 1));
+    }
+}
+
+void DeviceSwarm::run(unsigned long durationMs) {
+    loop_.run(durationMs);
+}
+
+void DeviceSwarm::send(uint32_t deviceId, const void* data, size_t length) {
+    messagesSent_++;
+    bytesSent_ += length;
+    if (sink_ != nullptr) {
+        sink_->onData(deviceId, loop_.millis(), static_cast<const uint8_t*>(data), length);
+    }
+}
+
+DeviceTask DeviceSwarm::heightMeter(uint32_t deviceId, uint32_t seed) {
+    DeviceRandom random(seed);
+    HeightDebouncer debouncer(DEBOUNCE_TOLERANCE_CM, DEBOUNCE_STABILITY_DURATION_MS,
+                              options_.heightSampleIntervalMs);
+    unsigned long echoMicros = 0;
+
+    // Synthetic patient: empty stand, then a patient who settles and leaves
+    bool occupied = false;
+    int headDistance = 0;
+    unsigned long phaseEndMs = loop_.millis() + static_cast<unsigned long>(random.range(3000, 10000));
+
+    for (;;) {
+        // delay(DEBOUNCE_SAMPLE_INTERVAL_MS)
+        co_await loop_.delay(options_.heightSampleIntervalMs);
+
+        if (loop_.millis() >= phaseEndMs) {
+            occupied = !occupied;
+            headDistance = random.range(30, 90);
+            phaseEndMs = loop_.millis() + static_cast<unsigned long>(
+                occupied ? random.range(5000, 15000) : random.range(3000, 10000));
+        }
+
+        // sonar.ping_cm(): blocks for the echo, or the timeout when nothing is there
+        int distance = 0;
+        if (occupied) {
+            distance = headDistance + random.range(-1, 1);
+            if (random.chance(3)) {
+                distance += random.range(-10, 10);  // Spurious echo
+            }
+            echoMicros += static_cast<unsigned long>(distance) * kEchoMicrosPerCm;
+        } else {
+            echoMicros += HEIGHT_MAX_DISTANCE_CM * kEchoMicrosPerCm;
+        }
+        if (echoMicros >= 1000) {
+            co_await loop_.delay(echoMicros / 1000);
+            echoMicros %= 1000;
+        }
+
+        debouncer.update(distance, loop_.millis());
+
+        if (options_.protocol == SWARM_PROTOCOL_BINARY) {
+            uint8_t frameBytes[SAMPLE_FRAME_SIZE];
+            SampleFrame frame;
+            frame.deviceId = deviceId;
+            frame.timeMs = static_cast<uint32_t>(loop_.millis());
+            frame.valueHundredths = static_cast<uint16_t>(distance * 100);
+            frame.channel = CHANNEL_HEIGHT;
+            frame.stable = debouncer.isStable();
+            frame.valid = distance != 0;
+            encodeSampleFrame(frame, frameBytes);
+            send(deviceId, frameBytes, sizeof(frameBytes));
+        } else {
+            char line[64];
+            int length;
+            if (debouncer.isStable()) {
+                length = std::snprintf(line, sizeof(line), "Raw: %d cm | Stable: YES (%d cm)\r\n",
+                                       distance, debouncer.getStableReading());
+            } else {
+                length = std::snprintf(line, sizeof(line), "Raw: %d cm | Stable: NO\r\n", distance);
+            }
+            send(deviceId, line, static_cast<size_t>(length));
+        }
+    }
+}
+
+DeviceTask DeviceSwarm::pulseOximeter(uint32_t deviceId, uint32_t seed) {
+    DeviceRandom random(seed);
+    ReadingDebouncer<float> bpmDebouncer(BPM_TOLERANCE, BPM_STABILITY_DURATION_MS,
+                                         BPM_SAMPLE_INTERVAL_MS, BPM_MIN_VALID, BPM_MAX_VALID);
+    ReadingDebouncer<int> spo2Debouncer(SPO2_TOLERANCE, SPO2_STABILITY_DURATION_MS,
+                                        SPO2_SAMPLE_INTERVAL_MS, SPO2_MIN_VALID, SPO2_MAX_VALID);
+
+    // setup(): delay(1000) before the banner, delay(2000) on the splash screen
+    co_await loop_.delay(3000);
+
+    // Synthetic patient: no finger, then a finger that takes a few reports to lock on
+    bool fingerPresent = false;
+    int warmupReports = 0;
+    int baseBpm = 0;
+    int baseSpo2 = 0;
+    unsigned long phaseEndMs = loop_.millis() + static_cast<unsigned long>(random.range(5000, 20000));
+
+    for (;;) {
+        // loop() spins on pox.update() until millis() - tsLastReport > REPORTING_PERIOD_MS
+        co_await loop_.delay(options_.oximeterReportPeriodMs + 1);
+        unsigned long currentTime = loop_.millis();
+
+        if (currentTime >= phaseEndMs) {
+            fingerPresent = !fingerPresent;
+            warmupReports = random.range(2, 4);
+            baseBpm = random.range(60, 110);
+            baseSpo2 = random.range(94, 99);
+            phaseEndMs = currentTime + static_cast<unsigned long>(
+                fingerPresent ? random.range(15000, 40000) : random.range(5000, 20000));
+        }
+
+        float rawBpm = 0.0f;
+        int rawSpo2 = 0;
+        if (fingerPresent) {
+            if (warmupReports > 0) {
+                warmupReports--;
+            } else {
+                rawBpm = static_cast<float>(baseBpm) + static_cast<float>(random.range(-400, 400)) / 100.0f;
+                if (random.chance(5)) {
+                    rawBpm += static_cast<float>(random.range(-20, 20));  // Motion artifact
+                }
+                rawSpo2 = baseSpo2 + random.range(-1, 1);
+                if (rawSpo2 > 100) rawSpo2 = 100;
+            }
+        }
+
+        bpmDebouncer.update(rawBpm, currentTime);
+        spo2Debouncer.update(rawSpo2, currentTime);
+
+        if (options_.protocol == SWARM_PROTOCOL_BINARY) {
+            uint8_t frameBytes[2 * SAMPLE_FRAME_SIZE];
+            SampleFrame frame;
+            frame.deviceId = deviceId;
+            frame.timeMs = static_cast<uint32_t>(currentTime);
+            frame.valueHundredths = toHundredths(rawBpm);
+            frame.channel = CHANNEL_BPM;
+            frame.stable = bpmDebouncer.isStable();
+            frame.valid = bpmDebouncer.isLastReadingValid();
+            encodeSampleFrame(frame, frameBytes);
+            frame.valueHundredths = static_cast<uint16_t>(rawSpo2 * 100);
+            frame.channel = CHANNEL_SPO2;
+            frame.stable = spo2Debouncer.isStable();
+            frame.valid = spo2Debouncer.isLastReadingValid();
+            encodeSampleFrame(frame, frameBytes + SAMPLE_FRAME_SIZE);
+            send(deviceId, frameBytes, sizeof(frameBytes));
+            continue;
+        }
+
+        // The sketch's full report, including the beat callbacks since the last one
+        char report[512];
+        int length = 0;
+        int beats = rawBpm > 0.0f
+            ? static_cast<int>(rawBpm * static_cast<float>(options_.oximeterReportPeriodMs) / 60000.0f)
+            : 0;
+        if (beats > 16) {
+            beats = 16;  // The UART buffer would have dropped the rest
+        }
+        for (int i = 0; i < beats; ++i) {
+            length += std::snprintf(report + length, sizeof(report) - length, "Beat!\r\n");
+        }
+        length += std::snprintf(report + length, sizeof(report) - length,
+                                "[%lums] RAW - BPM:%.2f SpO2:%d%%\r\n"
+                                "      DEBOUNCE - BPM:%s SpO2:%s\r\n",
+                                currentTime, rawBpm, rawSpo2,
+                                bpmDebouncer.hasValidReading() ? "valid" : "invalid",
+                                spo2Debouncer.hasValidReading() ? "valid" : "invalid");
+        bool fingerDetected = bpmDebouncer.hasValidReading() || spo2Debouncer.hasValidReading();
+        const char* displayState = "Readings STABLE";
+        if (!fingerDetected && rawBpm == 0.0f && rawSpo2 == 0) {
+            displayState = "'Place Finger'";
+        } else if (!bpmDebouncer.isStable() || !spo2Debouncer.isStable()) {
+            displayState = "Stabilizing...";
+        }
+        length += std::snprintf(report + length, sizeof(report) - length,
+                                "      DISPLAY: %s\r\n"
+                                "      Display: Updated\r\n"
+                                "      OUTPUT - BPM:%.2f(%s) O2:%d(%s)\r\n\r\n",
+                                displayState, rawBpm, bpmDebouncer.isStable() ? "OK" : "...",
+                                rawSpo2, spo2Debouncer.isStable() ? "OK" : "...");
+        send(deviceId, report, static_cast<size_t>(length));
+    }
+}
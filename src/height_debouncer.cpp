@@ -1,5 +1,6 @@
 #include "height_debouncer.h"
 #include "config.h"
+#include "debounce_tracepoint.h"
 #include <cstdlib>
 
 HeightDebouncer::HeightDebouncer(int toleranceCm, unsigned long stabilityDurationMs, unsigned long sampleIntervalMs)
@@ -23,6 +24,7 @@ HeightDebouncer::HeightDebouncer()
 void HeightDebouncer::update(int currentReading, unsigned long currentTimeMs) {
     // Check if enough time has passed since last sample
     if (hasReading_ && (currentTimeMs - lastSampleTime_) < sampleIntervalMs_) {
+        DEBOUNCE_TRACE(DEBOUNCE_TRACE_INTERVAL_SKIP, this, currentReading, currentTimeMs);
         return; // Too soon, skip this sample
     }
 
@@ -34,6 +36,7 @@ void HeightDebouncer::update(int currentReading, unsigned long currentTimeMs) {
         stabilityStartTime_ = currentTimeMs;
         hasReading_ = true;
         isStable_ = false;
+        DEBOUNCE_TRACE(DEBOUNCE_TRACE_FIRST_READING, this, currentReading, currentTimeMs);
         return;
     }
 
@@ -43,11 +46,15 @@ void HeightDebouncer::update(int currentReading, unsigned long currentTimeMs) {
         unsigned long stableDuration = currentTimeMs - stabilityStartTime_;
         
         if (stableDuration >= stabilityDurationMs_) {
+            if (!isStable_) {
+                DEBOUNCE_TRACE(DEBOUNCE_TRACE_STABLE, this, currentReading, currentTimeMs);
+            }
             isStable_ = true;
             stableReading_ = currentReading;
         }
     } else {
         // Reading changed significantly, reset stability timer
+        DEBOUNCE_TRACE(DEBOUNCE_TRACE_TOLERANCE_RESET, this, currentReading, currentTimeMs);
         stabilityStartTime_ = currentTimeMs;
         isStable_ = false;
     }
@@ -67,6 +74,10 @@ int HeightDebouncer::getLastReading() const {
     return lastReading_;
 }
 
+bool HeightDebouncer::hasValidReading() const {
+    return hasReading_;
+}
+
 unsigned long HeightDebouncer::getStableDuration() const {
     if (!hasReading_) {
         return 0;
@@ -76,6 +87,10 @@ unsigned long HeightDebouncer::getStableDuration() const {
     return isStable_ ? stabilityDurationMs_ : 0;
 }
 
+unsigned long HeightDebouncer::getLastSampleTime() const {
+    return lastSampleTime_;
+}
+
 void HeightDebouncer::reset() {
     lastReading_ = -1;
     stableReading_ = -1;
@@ -85,6 +100,28 @@ void HeightDebouncer::reset() {
     hasReading_ = false;
 }
 
+HeightDebouncer::Checkpoint HeightDebouncer::getCheckpoint() const {
+    Checkpoint checkpoint;
+    checkpoint.toleranceCm = toleranceCm_;
+    checkpoint.lastReading = lastReading_;
+    checkpoint.stableReading = stableReading_;
+    checkpoint.stabilityStartTime = stabilityStartTime_;
+    checkpoint.lastSampleTime = lastSampleTime_;
+    checkpoint.isStable = isStable_;
+    checkpoint.hasReading = hasReading_;
+    return checkpoint;
+}
+
+void HeightDebouncer::restore(const Checkpoint& checkpoint) {
+    toleranceCm_ = checkpoint.toleranceCm;
+    lastReading_ = checkpoint.lastReading;
+    stableReading_ = checkpoint.stableReading;
+    stabilityStartTime_ = checkpoint.stabilityStartTime;
+    lastSampleTime_ = checkpoint.lastSampleTime;
+    isStable_ = checkpoint.isStable;
+    hasReading_ = checkpoint.hasReading;
+}
+
 bool HeightDebouncer::isWithinTolerance(int reading1, int reading2) const {
     return std::abs(reading1 - reading2) <= toleranceCm_;
 }
@@ -3,10 +3,54 @@
 #include <NewPing.h>
 #include "config.h"
 #include "height_debouncer.h"
+#include "burst_ranger.h"
+#include "history_ring.h"
 
 LiquidCrystal_I2C lcd(LCD_I2C_ADDRESS, LCD_COLS, LCD_ROWS);
 NewPing sonar(TRIG_PIN, ECHO_PIN, HEIGHT_MAX_DISTANCE_CM);
+#if HEIGHT_BURST_MODE
+HeightDebouncer debouncer(DEBOUNCE_TOLERANCE_CM, BURST_STABILITY_DURATION_MS, BURST_INTERVAL_MS);
+BurstRanger ranger;
+
+// Ping until the echoes agree; returns -1 if they never did
+int burstPing() {
+  ranger.begin();
+  while (!ranger.addEcho(sonar.ping_cm())) {
+    delay(BURST_PING_GAP_MS);
+  }
+  return ranger.getConsensus();
+}
+#else
 HeightDebouncer debouncer;
+#endif
+
+// On-device history, dumped on the host's request
+HistoryRing<HEIGHT_HISTORY_BYTES, 1> history(HEIGHT_HISTORY_INTERVAL_MS);
+unsigned long lastHistoryMs = 0;
+bool historyStable = false;
+
+// Keep one sample per history interval, marking the debouncer's transitions
+void recordHistory(int distance, unsigned long currentTime) {
+  if (debouncer.isStable() != historyStable) {
+    historyStable = debouncer.isStable();
+    history.mark(0, historyStable);
+  }
+  if (history.getSamplesAdded() > 0 && currentTime - lastHistoryMs < HEIGHT_HISTORY_INTERVAL_MS) {
+    return;
+  }
+  lastHistoryMs = currentTime;
+  int16_t value = (int16_t)distance;
+  history.add(currentTime, &value);
+}
+
+// Send the history when the host asks for it
+void serviceDumpRequest() {
+  while (Serial.available() > 0) {
+    if (Serial.read() == HISTORY_DUMP_REQUEST) {
+      history.dump(Serial, HISTORY_DEVICE_ID, millis());
+    }
+  }
+}
 
 void setup() {
   Serial.begin(115200);
@@ -18,11 +62,30 @@ void setup() {
 }
 
 void loop() {
+  serviceDumpRequest();
+
+#if HEIGHT_BURST_MODE
+  unsigned long burstStart = millis();
+  int distance = burstPing();
+  unsigned long currentTime = millis();
+  if (distance < 0) {
+    if (ranger.getEchoCount() > 0) {
+      return;  // echoes disagreed; try again without disturbing the debouncer
+    }
+    distance = 0;  // every ping was lost: report no object, as a single ping would
+  }
+  if (currentTime - burstStart < BURST_INTERVAL_MS) {
+    delay(BURST_INTERVAL_MS - (currentTime - burstStart));
+    currentTime = millis();
+  }
+#else
   delay(DEBOUNCE_SAMPLE_INTERVAL_MS);
   int distance = sonar.ping_cm();
   unsigned long currentTime = millis();
+#endif
 
   debouncer.update(distance, currentTime);
+  recordHistory(distance, currentTime);
 
   lcd.setCursor(0, 1);
 
@@ -0,0 +1,153 @@
+#include "i2c_bus.h"
+#include <algorithm>
+#include <cstring>
+
+// ============================================
+// I2cBus
+// ============================================
+
+I2cBus::I2cBus()
+    : recorder_(NULL)
+    , clock_(NULL)
+    , frequencyHz_(100000)
+    , transactions_(0)
+{
+    std::memset(devices_, 0, sizeof(devices_));
+}
+
+void I2cBus::attach(uint8_t address, I2cDevice* device) {
+    devices_[address & 0x7F] = device;
+}
+
+void I2cBus::detach(uint8_t address) {
+    devices_[address & 0x7F] = NULL;
+}
+
+void I2cBus::detachAll() {
+    std::memset(devices_, 0, sizeof(devices_));
+}
+
+uint8_t I2cBus::write(uint8_t address, const uint8_t* data, size_t length, bool stop) {
+    unsigned long long startUs = begin();
+    I2cDevice* device = devices_[address & 0x7F];
+    uint8_t status = I2C_STATUS_OK;
+    if (device == NULL) {
+        status = I2C_STATUS_ADDRESS_NACK;
+    } else if (!device->onWrite(data, length)) {
+        status = I2C_STATUS_DATA_NACK;
+    }
+    // A NACKed address ends the transaction after the address byte
+    charge(status == I2C_STATUS_ADDRESS_NACK ? 0 : length);
+
+    if (recorder_ != NULL) {
+        I2cTransaction transaction;
+        transaction.timeUs = startUs;
+        transaction.loop = 0;
+        transaction.address = address;
+        transaction.type = I2C_WRITE;
+        transaction.status = status;
+        transaction.stop = stop;
+        transaction.requested = 0;
+        transaction.bytes.assign(data, data + length);
+        recorder_->add(transaction);
+    }
+    return status;
+}
+
+size_t I2cBus::read(uint8_t address, uint8_t* data, size_t length) {
+    unsigned long long startUs = begin();
+    I2cDevice* device = devices_[address & 0x7F];
+    size_t received = device != NULL ? std::min(device->onRead(data, length), length) : 0;
+    charge(received);
+
+    if (recorder_ != NULL) {
+        I2cTransaction transaction;
+        transaction.timeUs = startUs;
+        transaction.loop = 0;
+        transaction.address = address;
+        transaction.type = I2C_READ;
+        transaction.status = I2C_STATUS_OK;
+        transaction.stop = true;
+        transaction.requested = static_cast<uint16_t>(length);
+        transaction.bytes.assign(data, data + received);
+        recorder_->add(transaction);
+    }
+    return received;
+}
+
+void I2cBus::markLoop() {
+    if (recorder_ != NULL) {
+        recorder_->markLoop();
+    }
+}
+
+unsigned long long I2cBus::begin() {
+    transactions_++;
+    return clock_ != NULL ? clock_->nowUs() : 0;
+}
+
+void I2cBus::charge(size_t bytes) {
+    if (clock_ == NULL) {
+        return;
+    }
+    // Start, address + ACK, 9 bits per data byte, stop
+    unsigned long long bits = 1 + 9 + 9ULL * bytes + 1;
+    clock_->advanceUs((bits * 1000000ULL + frequencyHz_ - 1) / frequencyHz_);
+}
+
+// ============================================
+// I2cReplayDevice
+// ============================================
+
+I2cReplayDevice::I2cReplayDevice(const I2cTrace& trace, uint8_t address)
+    : next_(0)
+    , mismatches_(0)
+{
+    for (size_t i = 0; i < trace.size(); ++i) {
+        const I2cTransaction& transaction = trace.at(i);
+        if (transaction.address == address && transaction.type == I2C_READ) {
+            responses_.push_back(transaction.bytes);
+        }
+    }
+}
+
+bool I2cReplayDevice::onWrite(const uint8_t* data, size_t length) {
+    (void)data;
+    (void)length;
+    return true;
+}
+
+size_t I2cReplayDevice::onRead(uint8_t* data, size_t length) {
+    if (next_ == responses_.size()) {
+        mismatches_++;
+        std::memset(data, 0xFF, length);   // released bus reads high
+        return length;
+    }
+    const std::vector<uint8_t>& response = responses_[next_++];
+    if (response.size() != length) {
+        mismatches_++;
+    }
+    size_t copied = std::min(response.size(), length);
+    if (copied > 0) {
+        std::memcpy(data, &response[0], copied);
+    }
+    std::memset(data + copied, 0xFF, length - copied);
+    return length;
+}
+
+std::vector<uint8_t> I2cReplayDevice::respondingAddresses(const I2cTrace& trace) {
+    bool seen[128] = { false };
+    for (size_t i = 0; i < trace.size(); ++i) {
+        const I2cTransaction& transaction = trace.at(i);
+        if (transaction.type == I2C_READ ? !transaction.bytes.empty() : transaction.status != I2C_STATUS_ADDRESS_NACK) {
+            seen[transaction.address & 0x7F] = true;
+        }
+    }
+    std::vector<uint8_t> addresses;
+    for (uint8_t address = 0; address < 128; ++address) {
+        if (seen[address]) {
+            addresses.push_back(address);
+        }
+    }
+    return addresses;
+}
@@ -0,0 +1,206 @@
+#include "i2c_trace.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const char kTraceHeader[] = "# apptech-i2c-trace 1";
+
+// Start, address byte + ACK, 9 bits per data byte, stop
+unsigned long long busBits(const I2cTransaction& transaction) {
+    return 1 + 9 + 9ULL * transaction.bytes.size() + 1;
+}
+
+void addTo(I2cAddressStats& stats, const I2cTransaction& transaction) {
+    stats.transactions++;
+    stats.bytes += transaction.bytes.size();
+    stats.busBits += busBits(transaction);
+}
+
+bool parseBytes(char* p, std::vector<uint8_t>& bytes) {
+    char* end = NULL;
+    for (;;) {
+        while (*p == ' ') {
+            ++p;
+        }
+        if (*p == '\0' || *p == '\n' || *p == '\r') {
+            return true;
+        }
+        unsigned long value = std::strtoul(p, &end, 16);
+        if (end == p || value > 0xFF) {
+            return false;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+        p = end;
+    }
+}
+
+} // namespace
+
+// ============================================
+// I2cTrace
+// ============================================
+
+I2cTrace::I2cTrace()
+    : loops_(0)
+{
+}
+
+void I2cTrace::add(const I2cTransaction& transaction) {
+    transactions_.push_back(transaction);
+    transactions_.back().loop = loops_;
+}
+
+void I2cTrace::markLoop() {
+    loops_++;
+}
+
+void I2cTrace::clear() {
+    transactions_.clear();
+    loops_ = 0;
+}
+
+bool I2cTrace::save(const char* path) const {
+    FILE* file = std::fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool ok = std::fprintf(file, "%s\n", kTraceHeader) > 0;
+    unsigned long loop = 0;
+    for (size_t i = 0; ok && i < transactions_.size(); ++i) {
+        const I2cTransaction& transaction = transactions_[i];
+        while (loop < transaction.loop) {
+            std::fprintf(file, "L %lu\n", ++loop);
+        }
+        if (transaction.type == I2C_WRITE) {
+            std::fprintf(file, "W %llu 0x%02x %d %u", transaction.timeUs, transaction.address,
+                         transaction.stop ? 1 : 0, transaction.status);
+        } else {
+            std::fprintf(file, "R %llu 0x%02x %u", transaction.timeUs, transaction.address, transaction.requested);
+        }
+        for (size_t b = 0; b < transaction.bytes.size(); ++b) {
+            std::fprintf(file, " %02x", transaction.bytes[b]);
+        }
+        ok = std::fputc('\n', file) != EOF;
+    }
+    while (ok && loop < loops_) {
+        ok = std::fprintf(file, "L %lu\n", ++loop) > 0;
+    }
+
+    return std::fclose(file) == 0 && ok;
+}
+
+bool I2cTrace::load(const char* path) {
+    clear();
+    FILE* file = std::fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    char line[1024];
+    bool ok = std::fgets(line, sizeof(line), file) != NULL &&
+              std::strncmp(line, kTraceHeader, sizeof(kTraceHeader) - 1) == 0;
+    while (ok && std::fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == 'L') {
+            markLoop();
+            continue;
+        }
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        I2cTransaction transaction;
+        transaction.loop = 0;
+        transaction.status = 0;
+        transaction.stop = true;
+        transaction.requested = 0;
+        unsigned address = 0;
+        int consumed = 0;
+        if (line[0] == 'W') {
+            int stop = 1;
+            unsigned status = 0;
+            ok = std::sscanf(line, "W %llu %x %d %u%n", &transaction.timeUs, &address, &stop, &status,
+                             &consumed) == 4;
+            transaction.type = I2C_WRITE;
+            transaction.stop = stop != 0;
+            transaction.status = static_cast<uint8_t>(status);
+        } else if (line[0] == 'R') {
+            unsigned requested = 0;
+            ok = std::sscanf(line, "R %llu %x %u%n", &transaction.timeUs, &address, &requested, &consumed) == 3;
+            transaction.type = I2C_READ;
+            transaction.requested = static_cast<uint16_t>(requested);
+        } else {
+            ok = false;
+        }
+        ok = ok && address <= 0x7F && parseBytes(line + consumed, transaction.bytes);
+        if (ok) {
+            transaction.address = static_cast<uint8_t>(address);
+            add(transaction);
+        }
+    }
+
+    std::fclose(file);
+    if (!ok) {
+        clear();
+    }
+    return ok;
+}
+
+// ============================================
+// I2cTraceStats
+// ============================================
+
+I2cTraceStats::I2cTraceStats()
+    : loops(0)
+    , maxLoopBytes(0)
+    , maxLoopTransactions(0)
+{
+    std::memset(&setup, 0, sizeof(setup));
+    std::memset(&perLoop, 0, sizeof(perLoop));
+}
+
+void I2cTraceStats::compute(const I2cTrace& trace) {
+    *this = I2cTraceStats();
+    loops = trace.getLoopCount();
+
+    unsigned long currentLoop = 0;
+    unsigned long long loopBytes = 0;
+    unsigned long loopTransactions = 0;
+    for (size_t i = 0; i < trace.size(); ++i) {
+        const I2cTransaction& transaction = trace.at(i);
+        if (transaction.loop == 0) {
+            addTo(setup, transaction);
+            continue;
+        }
+        if (transaction.loop != currentLoop) {
+            currentLoop = transaction.loop;
+            loopBytes = 0;
+            loopTransactions = 0;
+        }
+        addTo(perLoop, transaction);
+        addTo(byAddress[transaction.address], transaction);   // value-initialized on first use
+
+        loopBytes += transaction.bytes.size();
+        loopTransactions++;
+        if (loopBytes > maxLoopBytes) {
+            maxLoopBytes = loopBytes;
+        }
+        if (loopTransactions > maxLoopTransactions) {
+            maxLoopTransactions = loopTransactions;
+        }
+    }
+}
+
+double I2cTraceStats::getTransactionsPerLoop() const {
+    return loops > 0 ? static_cast<double>(perLoop.transactions) / static_cast<double>(loops) : 0.0;
+}
+
+double I2cTraceStats::getBytesPerLoop() const {
+    return loops > 0 ? static_cast<double>(perLoop.bytes) / static_cast<double>(loops) : 0.0;
+}
+
+double I2cTraceStats::getBusBitsPerLoop() const {
+    return loops > 0 ? static_cast<double>(perLoop.busBits) / static_cast<double>(loops) : 0.0;
+}
@@ -0,0 +1,458 @@
+#include "line_tokenizer.h"
+#include "config.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+const bool kLittleEndian = false;
+#else
+const bool kLittleEndian = true;
+#endif
+
+const uint64_t kOnes = 0x0101010101010101ULL;
+const uint64_t kHighBits = 0x8080808080808080ULL;
+const uint64_t kLowBits = 0x7F7F7F7F7F7F7F7FULL;
+
+const uint64_t kPow10[9] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+                             100000000ULL };
+
+inline uint64_t load64(const char* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+inline unsigned countTrailingZeros(uint64_t x) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+    unsigned n = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+// 0x80 in every zero byte of word, exactly (no false positives from borrows)
+inline uint64_t zeroBytes(uint64_t word) {
+    return ~(((word & kLowBits) + kLowBits) | word | kLowBits);
+}
+
+// One bit per byte (bit i for byte i) from a 0x80-per-byte mask
+inline uint64_t packHighBits(uint64_t mask) {
+    return ((mask >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+// Digit flags (0x80 per byte) of word, exact for every byte
+inline uint64_t digitBytes(uint64_t word) {
+    uint64_t low = word & kLowBits;
+    return (low + 0x5050505050505050ULL) & ~(low + 0x4646464646464646ULL) & ~word & kHighBits;
+}
+
+// Value of the n (1..8) digits in the low bytes of word, first digit lowest
+inline uint64_t convertDigits(uint64_t word, unsigned n) {
+    word <<= 8 * (8 - n);   // drop the bytes after the digits; leading zeros are harmless
+    word = ((word & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+    word = ((word & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+    return ((word & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+}
+
+// Bit i set where block[i] is an ASCII digit, for the 64 bytes at block
+uint64_t digitMask(const char* block) {
+#if defined(__AVX2__)
+    const __m256i belowZero = _mm256_set1_epi8('0' - 1);
+    const __m256i aboveNine = _mm256_set1_epi8('9' + 1);
+    uint64_t mask = 0;
+    for (int i = 0; i < 2; ++i) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+        __m256i digits = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, belowZero), _mm256_cmpgt_epi8(aboveNine, chunk));
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(digits))) << (32 * i);
+    }
+    return mask;
+#elif defined(__SSE2__)
+    // Signed compares: bytes of 0x80 and up are negative, so never digits
+    const __m128i belowZero = _mm_set1_epi8('0' - 1);
+    const __m128i aboveNine = _mm_set1_epi8('9' + 1);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chunk, belowZero), _mm_cmplt_epi8(chunk, aboveNine));
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(digits))) << (16 * i);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 8; ++i) {
+        uint64_t bits = 0;
+        if (kLittleEndian) {
+            bits = packHighBits(digitBytes(load64(block + 8 * i)));
+        } else {
+            for (int j = 0; j < 8; ++j) {
+                bits |= static_cast<uint64_t>(block[8 * i + j] >= '0' && block[8 * i + j] <= '9') << j;
+            }
+        }
+        mask |= bits << (8 * i);
+    }
+    return mask;
+#endif
+}
+
+// Digit mask of the 64 bytes at begin, padding with zeros past limit
+uint64_t digitMaskAt(const char* begin, const char* limit) {
+    size_t readable = static_cast<size_t>(limit - begin);
+    if (readable >= 64) {
+        return digitMask(begin);
+    }
+    char padded[64];
+    std::memset(padded, 0, sizeof(padded));
+    std::memcpy(padded, begin, readable);
+    return digitMask(padded);
+}
+
+/**
+ * Digit positions of one line, found for its first 64 bytes at once, so a
+ * field's length is a shift and a bit count instead of a byte-by-byte walk
+ */
+class LineDigits {
+public:
+    // mask: digit mask of the 64 bytes at begin
+    LineDigits(const char* begin, const char* end, const char* limit, uint64_t mask)
+        : begin_(begin)
+        , end_(end)
+        , limit_(limit)
+        , mask_(mask)
+    {
+        clipToEnd();
+    }
+
+    const char* end() const { return end_; }
+    const char* limit() const { return limit_; }
+
+    // Number of digits starting at p, never past end
+    size_t runAt(const char* p) const {
+        size_t offset = static_cast<size_t>(p - begin_);
+        const char* q = p;
+        if (offset < 64) {
+            uint64_t rest = ~(mask_ >> offset);
+            size_t run = rest != 0 ? countTrailingZeros(rest) : 64;
+            if (offset + run < 64) {
+                return run;
+            }
+            q = p + run;   // the run reaches past the mask
+        }
+        while (q < end_ && *q >= '0' && *q <= '9') {
+            ++q;
+        }
+        return static_cast<size_t>(q - p);
+    }
+
+private:
+    const char* begin_;
+    const char* end_;
+    const char* limit_;
+    uint64_t mask_;
+
+    void clipToEnd() {
+        size_t length = static_cast<size_t>(end_ - begin_);
+        if (length < 64) {
+            mask_ &= (1ULL << length) - 1;
+        }
+    }
+};
+
+// Value of the count digits at p, modulo 2^64 like the scalar loop
+inline uint64_t convertRun(const char* p, size_t count, const char* limit) {
+    uint64_t result = 0;
+    while (count > 0 && kLittleEndian && limit - p >= 8) {
+        unsigned n = count < 8 ? static_cast<unsigned>(count) : 8;
+        result = result * kPow10[n] + convertDigits(load64(p), n);
+        p += n;
+        count -= n;
+    }
+    // Scalar tail near the end of the buffer
+    for (; count > 0; --count, ++p) {
+        result = result * 10 + static_cast<uint64_t>(*p - '0');
+    }
+    return result;
+}
+
+inline const char* parseDigits(const char* p, const LineDigits& line, uint64_t* value) {
+    size_t count = line.runAt(p);
+    if (count == 0) {
+        return NULL;
+    }
+    *value = convertRun(p, count, line.limit());
+    return p + count;
+}
+
+bool startsWith(const char* p, const char* end, const char* prefix, size_t prefixLength) {
+    return static_cast<size_t>(end - p) >= prefixLength && std::memcmp(p, prefix, prefixLength) == 0;
+}
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && *p == ' ') {
+        ++p;
+    }
+    return p;
+}
+
+// Decimal as printed by Serial.print(float); same float result as TraceParser
+const char* parseDecimal(const char* p, const LineDigits& line, float* value) {
+    bool negative = false;
+    if (p < line.end() && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    uint64_t whole = 0;
+    p = parseDigits(p, line, &whole);
+    if (p == NULL) {
+        return NULL;
+    }
+    float result = static_cast<float>(static_cast<unsigned long>(whole));
+    if (p < line.end() && *p == '.') {
+        ++p;
+        size_t count = line.runAt(p);
+        if (count > 0) {
+            // Only the first six fraction digits count
+            size_t used = count > 6 ? 6 : count;
+            uint64_t fraction = convertRun(p, used, line.limit());
+            result += static_cast<float>(static_cast<unsigned long>(fraction)) /
+                      static_cast<float>(static_cast<unsigned long>(kPow10[used]));
+            p += count;
+        }
+    }
+    *value = negative ? -result : result;
+    return p;
+}
+
+// "Raw: 123 cm | Stable: ..."
+bool parseHeightLine(const char* p, const LineDigits& line, uint64_t* distance) {
+    static const char kPrefix[] = "Raw: ";
+    if (!startsWith(p, line.end(), kPrefix, sizeof(kPrefix) - 1)) {
+        return false;
+    }
+    return parseDigits(p + sizeof(kPrefix) - 1, line, distance) != NULL;
+}
+
+// "[12345ms] RAW - BPM:72.50 SpO2:97%"
+bool parseOximeterLine(const char* p, const LineDigits& line, uint64_t* timeMs, float* bpm, uint64_t* spo2) {
+    static const char kRaw[] = "ms] RAW - BPM:";
+    static const char kSpo2[] = " SpO2:";
+
+    p = parseDigits(p + 1, line, timeMs);
+    if (p == NULL || !startsWith(p, line.end(), kRaw, sizeof(kRaw) - 1)) {
+        return false;
+    }
+    p = parseDecimal(p + sizeof(kRaw) - 1, line, bpm);
+    if (p == NULL || !startsWith(p, line.end(), kSpo2, sizeof(kSpo2) - 1)) {
+        return false;
+    }
+    return parseDigits(p + sizeof(kSpo2) - 1, line, spo2) != NULL;
+}
+
+void append(LogColumns& out, uint8_t channel, unsigned long timeMs, float value) {
+    out.timesMs[channel].push_back(timeMs);
+    out.values[channel].push_back(value);
+}
+
+} // namespace
+
+// ============================================
+// Scanning primitives
+// ============================================
+
+uint64_t lineTokenizerNewlineMask(const char* block) {
+#if defined(__AVX2__)
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    uint64_t lowMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline)));
+    uint64_t highMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)));
+    return lowMask | (highMask << 32);
+#elif defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        uint64_t bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        mask |= bits << (16 * i);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 8; ++i) {
+        uint64_t bits = 0;
+        if (kLittleEndian) {
+            bits = packHighBits(zeroBytes(load64(block + 8 * i) ^ (kOnes * '\n')));
+        } else {
+            for (int j = 0; j < 8; ++j) {
+                bits |= static_cast<uint64_t>(block[8 * i + j] == '\n') << j;
+            }
+        }
+        mask |= bits << (8 * i);
+    }
+    return mask;
+#endif
+}
+
+const char* lineTokenizerParseUnsigned(const char* p, const char* end, const char* limit, uint64_t* value) {
+    LineDigits line(p, end, limit, digitMaskAt(p, limit));
+    return parseDigits(p, line, value);
+}
+
+// ============================================
+// LogColumns
+// ============================================
+
+void LogColumns::clear() {
+    for (int channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        timesMs[channel].clear();
+        values[channel].clear();
+    }
+}
+
+// ============================================
+// LineTokenizer
+// ============================================
+
+LineTokenizer::LineTokenizer(unsigned long heightIntervalMs)
+    : heightIntervalMs_(heightIntervalMs)
+    , nextHeightTimeMs_(0)
+    , linesParsed_(0)
+    , linesSkipped_(0)
+{
+}
+
+LineTokenizer::LineTokenizer()
+    : LineTokenizer(DEBOUNCE_SAMPLE_INTERVAL_MS)
+{
+}
+
+const char* LineTokenizer::getScanBackend() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "swar";
+#endif
+}
+
+void LineTokenizer::feed(const char* data, size_t length, LogColumns& out) {
+    const char* p = data;
+    const char* end = data + length;
+
+    // Complete a line carried over from the previous block
+    if (!carry_.empty()) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', length));
+        if (newline == NULL) {
+            carry_.append(p, length);
+            return;
+        }
+        carry_.append(p, newline - p);
+        const char* carryEnd = carry_.data() + carry_.size();
+        parseLine(carry_.data(), carryEnd, carryEnd, digitMaskAt(carry_.data(), carryEnd), out);
+        carry_.clear();
+        p = newline + 1;
+    }
+
+    // Whole 64-byte blocks straight from the input, the tail from a padded
+    // copy. Newlines and digits are both found per block; a line's digit
+    // mask is spliced from its block and the one before.
+    const char* lineStart = p;
+    char tail[64];
+    uint64_t previousDigits = 0;
+    for (const char* block = p; block < end; block += 64) {
+        uint64_t newlines;
+        uint64_t digits;
+        if (end - block >= 64) {
+            newlines = lineTokenizerNewlineMask(block);
+            digits = digitMask(block);
+        } else {
+            std::memset(tail, 0, sizeof(tail));
+            std::memcpy(tail, block, end - block);
+            newlines = lineTokenizerNewlineMask(tail);
+            digits = digitMask(tail);
+        }
+        while (newlines != 0) {
+            const char* newline = block + countTrailingZeros(newlines);
+            if (lineStart >= block) {
+                parseLine(lineStart, newline, end, digits >> (lineStart - block), out);
+            } else if (lineStart > block - 64) {
+                unsigned shift = static_cast<unsigned>(lineStart - (block - 64));
+                uint64_t mask = (previousDigits >> shift) | (digits << (64 - shift));
+                parseLine(lineStart, newline, end, mask, out);
+            } else {
+                parseLine(lineStart, newline, end, digitMaskAt(lineStart, end), out);   // longer than a block
+            }
+            lineStart = newline + 1;
+            newlines &= newlines - 1;
+        }
+        previousDigits = digits;
+    }
+    if (lineStart < end) {
+        carry_.assign(lineStart, end - lineStart);
+    }
+}
+
+void LineTokenizer::finish(LogColumns& out) {
+    if (!carry_.empty()) {
+        const char* carryEnd = carry_.data() + carry_.size();
+        parseLine(carry_.data(), carryEnd, carryEnd, digitMaskAt(carry_.data(), carryEnd), out);
+        carry_.clear();
+    }
+}
+
+void LineTokenizer::reset() {
+    nextHeightTimeMs_ = 0;
+    linesParsed_ = 0;
+    linesSkipped_ = 0;
+    carry_.clear();
+}
+
+void LineTokenizer::parseLine(const char* begin, const char* end, const char* limit, uint64_t digits,
+                              LogColumns& out) {
+    if (end > begin && end[-1] == '\r') {
+        --end;
+    }
+    const char* p = skipSpaces(begin, end);
+    if (p == end) {
+        return; // Blank separator lines are not counted
+    }
+    LineDigits line(begin, end, limit, digits);
+
+    bool parsed = false;
+    if (*p == 'R') {
+        uint64_t distance = 0;
+        parsed = parseHeightLine(p, line, &distance);
+        if (parsed) {
+            append(out, CHANNEL_HEIGHT, nextHeightTimeMs_, static_cast<float>(static_cast<unsigned long>(distance)));
+            nextHeightTimeMs_ += heightIntervalMs_;
+        }
+    } else if (*p == '[') {
+        uint64_t timeMs = 0;
+        float bpm = 0.0f;
+        uint64_t spo2 = 0;
+        parsed = parseOximeterLine(p, line, &timeMs, &bpm, &spo2);
+        if (parsed) {
+            append(out, CHANNEL_BPM, static_cast<unsigned long>(timeMs), bpm);
+            append(out, CHANNEL_SPO2, static_cast<unsigned long>(timeMs),
+                   static_cast<float>(static_cast<unsigned long>(spo2)));
+        }
+    }
+
+    if (parsed) {
+        linesParsed_++;
+    } else {
+        linesSkipped_++;
+    }
+}
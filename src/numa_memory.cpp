@@ -0,0 +1,263 @@
+#include "numa_memory.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__has_include)
+#if __has_include(<linux/mempolicy.h>)
+#include <linux/mempolicy.h>
+#define NUMA_MEMORY_HAVE_MBIND 1
+#endif
+#endif
+#endif
+
+namespace {
+
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+#ifdef __linux__
+// Parse a sysfs CPU list such as "0-3,8-11"
+std::vector<int> parseCpuList(const char* text) {
+    std::vector<int> cpus;
+    const char* p = text;
+    while (*p != '\0' && *p != '\n') {
+        char* end = NULL;
+        long first = std::strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = std::strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if (*p == ',') {
+            ++p;
+        }
+    }
+    return cpus;
+}
+
+bool readNodeCpus(int node, std::vector<int>& cpus) {
+    char path[96];
+    std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE* file = std::fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    char line[4096];
+    bool ok = std::fgets(line, sizeof(line), file) != NULL;
+    std::fclose(file);
+    if (ok) {
+        cpus = parseCpuList(line);
+    }
+    return ok;
+}
+
+// Map `bytes` aligned to `alignment` by trimming an oversized mapping
+void* mapAligned(size_t bytes, size_t alignment, int extraFlags) {
+    size_t padded = bytes + alignment;
+    void* raw = mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = roundUp(start, alignment);
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    uintptr_t tail = aligned + bytes;
+    uintptr_t end = start + padded;
+    if (end > tail) {
+        munmap(reinterpret_cast<void*>(tail), end - tail);
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+#endif
+
+} // namespace
+
+// ============================================
+// NumaTopology
+// ============================================
+
+size_t NumaTopology::getCpuCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        count += cpus[i].size();
+    }
+    return count;
+}
+
+NumaTopology NumaTopology::detect() {
+    NumaTopology topology;
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool haveAffinity = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    DIR* dir = opendir("/sys/devices/system/node");
+    if (dir != NULL) {
+        std::vector<int> nodeIds;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            int node;
+            char trailing;
+            if (std::sscanf(entry->d_name, "node%d%c", &node, &trailing) == 1) {
+                nodeIds.push_back(node);
+            }
+        }
+        closedir(dir);
+
+        // Keep node order stable regardless of readdir order
+        std::sort(nodeIds.begin(), nodeIds.end());
+
+        for (size_t i = 0; i < nodeIds.size(); ++i) {
+            std::vector<int> nodeCpus;
+            if (!readNodeCpus(nodeIds[i], nodeCpus)) {
+                continue;
+            }
+            std::vector<int> usable;
+            for (size_t c = 0; c < nodeCpus.size(); ++c) {
+                if (!haveAffinity || (nodeCpus[c] < CPU_SETSIZE && CPU_ISSET(nodeCpus[c], &allowed))) {
+                    usable.push_back(nodeCpus[c]);
+                }
+            }
+            if (!usable.empty()) {
+                topology.nodes.push_back(nodeIds[i]);
+                topology.cpus.push_back(usable);
+            }
+        }
+    }
+
+    if (topology.nodes.empty()) {
+        // No sysfs node information: one node with every allowed CPU
+        std::vector<int> usable;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (haveAffinity ? CPU_ISSET(cpu, &allowed) : cpu == 0) {
+                usable.push_back(cpu);
+            }
+        }
+        topology.nodes.push_back(0);
+        topology.cpus.push_back(usable);
+    }
+#else
+    topology.nodes.push_back(0);
+    topology.cpus.push_back(std::vector<int>(1, 0));
+#endif
+    return topology;
+}
+
+// ============================================
+// Node regions
+// ============================================
+
+bool allocateNodeRegion(size_t bytes, int node, HugePageMode hugePages, NodeRegion& region) {
+    region = NodeRegion();
+    if (bytes == 0) {
+        return false;
+    }
+#ifdef __linux__
+    size_t length = roundUp(bytes, kHugePageSize);
+    void* data = NULL;
+    HugePageMode obtained = HUGE_PAGES_NONE;
+
+#ifdef MAP_HUGETLB
+    if (hugePages == HUGE_PAGES_EXPLICIT) {
+        // hugetlb mappings are already 2 MiB aligned
+        data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        } else {
+            obtained = HUGE_PAGES_EXPLICIT;
+        }
+    }
+#endif
+
+    if (data == NULL) {
+        // Align to 2 MiB so THP can back the whole region
+        data = mapAligned(length, kHugePageSize, 0);
+        if (data == NULL) {
+            return false;
+        }
+#ifdef MADV_HUGEPAGE
+        if (hugePages != HUGE_PAGES_NONE && madvise(data, length, MADV_HUGEPAGE) == 0) {
+            obtained = HUGE_PAGES_TRANSPARENT;
+        }
+#endif
+    }
+
+    int boundNode = -1;
+#ifdef NUMA_MEMORY_HAVE_MBIND
+    if (node >= 0 && node < static_cast<int>(sizeof(unsigned long) * 8)) {
+        // Refused in some containers; first touch still places the pages
+        unsigned long mask = 1UL << node;
+        if (syscall(SYS_mbind, data, length, MPOL_BIND, &mask, sizeof(mask) * 8, 0) == 0) {
+            boundNode = node;
+        }
+    }
+#endif
+
+    region.data = data;
+    region.length = length;
+    region.node = boundNode;
+    region.hugePages = obtained;
+    return true;
+#else
+    (void)node;
+    (void)hugePages;
+    region.data = std::calloc(1, bytes);
+    region.length = bytes;
+    return region.data != NULL;
+#endif
+}
+
+void freeNodeRegion(NodeRegion& region) {
+    if (region.data != NULL) {
+#ifdef __linux__
+        munmap(region.data, region.length);
+#else
+        std::free(region.data);
+#endif
+    }
+    region = NodeRegion();
+}
+
+bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+const char* hugePageModeName(HugePageMode mode) {
+    switch (mode) {
+        case HUGE_PAGES_TRANSPARENT: return "thp";
+        case HUGE_PAGES_EXPLICIT: return "hugetlb";
+        default: return "4k";
+    }
+}
@@ -0,0 +1,197 @@
+#include "perf_counters.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char* const kEventNames[PERF_EVENT_COUNT] = {
+    "cycles", "instructions", "branch-misses", "cache-misses", "dTLB-load-misses"
+};
+
+#ifdef __linux__
+const uint32_t kEventTypes[PERF_EVENT_COUNT] = {
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE
+};
+
+const uint64_t kEventConfigs[PERF_EVENT_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+};
+
+int openEvent(uint32_t type, uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = type;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;         // Include worker threads spawned while counting
+    attr.exclude_kernel = 1;  // Allowed at perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    if (groupFd < 0) {
+        // A standalone event may still become the leader of a group
+        attr.read_format |= PERF_FORMAT_GROUP;
+    }
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+/**
+ * Scale a raw count up when the PMU multiplexed it with other events
+ * @return false if the counter never ran
+ */
+bool scaleCount(uint64_t value, uint64_t enabled, uint64_t running, uint64_t& out) {
+    if (running == 0) {
+        return false;
+    }
+    double scale = static_cast<double>(enabled) / static_cast<double>(running);
+    out = static_cast<uint64_t>(static_cast<double>(value) * scale);
+    return true;
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters() : leader_(-1) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        fds_[i] = -1;
+        grouped_[i] = false;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+bool PerfCounters::open() {
+    close();
+#ifdef __linux__
+    // The first event that opens leads the group. An event the PMU cannot
+    // schedule alongside the group (or lacks entirely) is retried on its own.
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (leader_ >= 0) {
+            fds_[i] = openEvent(kEventTypes[i], kEventConfigs[i], leader_);
+            if (fds_[i] >= 0) {
+                grouped_[i] = true;
+                continue;
+            }
+            fds_[i] = openEvent(kEventTypes[i], kEventConfigs[i], -1);
+        } else {
+            fds_[i] = openEvent(kEventTypes[i], kEventConfigs[i], -1);
+            if (fds_[i] >= 0) {
+                leader_ = fds_[i];
+                grouped_[i] = true;
+            }
+        }
+    }
+#endif
+    return isAnyAvailable();
+}
+
+void PerfCounters::close() {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+#ifdef __linux__
+        if (fds_[i] >= 0) {
+            ::close(fds_[i]);
+        }
+#endif
+        fds_[i] = -1;
+        grouped_[i] = false;
+    }
+    leader_ = -1;
+}
+
+bool PerfCounters::isAnyAvailable() const {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (fds_[i] >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (fds_[i] >= 0 && !grouped_[i]) {
+            ioctl(fds_[i], PERF_EVENT_IOC_RESET, 0);
+        }
+    }
+    if (leader_ >= 0) {
+        ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (fds_[i] >= 0 && !grouped_[i]) {
+            ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample sample;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        sample.values[i] = 0;
+        sample.valid[i] = false;
+    }
+#ifdef __linux__
+    if (leader_ >= 0) {
+        ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (fds_[i] >= 0 && !grouped_[i]) {
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    // One read for the whole group: nr, time enabled, time running, then
+    // one value per member in the order they joined
+    uint64_t group[3 + PERF_EVENT_COUNT];
+    ssize_t got = leader_ >= 0 ? read(leader_, group, sizeof(group)) : -1;
+    if (got >= static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+        uint64_t nr = group[0];
+        size_t slot = 0;
+        for (int i = 0; i < PERF_EVENT_COUNT && slot < nr; ++i) {
+            if (!grouped_[i]) {
+                continue;
+            }
+            if (got >= static_cast<ssize_t>((4 + slot) * sizeof(uint64_t))) {
+                sample.valid[i] = scaleCount(group[3 + slot], group[1], group[2], sample.values[i]);
+            }
+            ++slot;
+        }
+    }
+
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (fds_[i] < 0 || grouped_[i]) {
+            continue;
+        }
+        // A standalone event is read in group format too: nr (1), time
+        // enabled, time running, value
+        uint64_t data[4];
+        if (read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+            continue;
+        }
+        sample.valid[i] = scaleCount(data[3], data[1], data[2], sample.values[i]);
+    }
+#endif
+    return sample;
+}
+
+const char* PerfCounters::eventName(PerfEvent event) {
+    return kEventNames[event];
+}
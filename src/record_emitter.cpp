@@ -0,0 +1,290 @@
+#include "record_emitter.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+#if !defined(__cpp_lib_to_chars)
+#include <cstdio>
+#include <cstdlib>
+#endif
+
+// ============================================
+// Schemas
+// ============================================
+
+namespace {
+
+const FieldSpec kReadingFields[] = {
+    { "device_id", FIELD_UINT32, offsetof(ReadingRecord, deviceId) },
+    { "time_ms", FIELD_ULONG, offsetof(ReadingRecord, timeMs) },
+    { "channel", FIELD_CHANNEL, offsetof(ReadingRecord, channel) },
+    { "value", FIELD_FLOAT, offsetof(ReadingRecord, value) },
+    { "stable", FIELD_BOOL, offsetof(ReadingRecord, stable) },
+    { "valid", FIELD_BOOL, offsetof(ReadingRecord, valid) },
+};
+
+const FieldSpec kTransitionFields[] = {
+    { "device_id", FIELD_UINT32, offsetof(StabilityTransition, deviceId) },
+    { "time_ms", FIELD_ULONG, offsetof(StabilityTransition, timeMs) },
+    { "channel", FIELD_CHANNEL, offsetof(StabilityTransition, channel) },
+    { "stable", FIELD_BOOL, offsetof(StabilityTransition, stable) },
+    { "value", FIELD_FLOAT, offsetof(StabilityTransition, value) },
+};
+
+const char* const kChannelNames[SAMPLE_CHANNEL_COUNT] = { "height", "bpm", "spo2" };
+
+const char kDigitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+template<typename T>
+T fieldValue(const void* record, const FieldSpec& field) {
+    T value;
+    std::memcpy(&value, static_cast<const char*>(record) + field.offset, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+const RecordSchema kReadingRecordSchema = {
+    kReadingFields, sizeof(kReadingFields) / sizeof(kReadingFields[0])
+};
+
+const RecordSchema kTransitionRecordSchema = {
+    kTransitionFields, sizeof(kTransitionFields) / sizeof(kTransitionFields[0])
+};
+
+// ============================================
+// Number formatting
+// ============================================
+
+size_t formatUnsigned(uint64_t value, char* out) {
+    // Two digits per division, written backwards into a scratch buffer
+    char scratch[20];
+    char* p = scratch + sizeof(scratch);
+    while (value >= 100) {
+        unsigned pair = static_cast<unsigned>(value % 100) * 2;
+        value /= 100;
+        *--p = kDigitPairs[pair + 1];
+        *--p = kDigitPairs[pair];
+    }
+    if (value >= 10) {
+        unsigned pair = static_cast<unsigned>(value) * 2;
+        *--p = kDigitPairs[pair + 1];
+        *--p = kDigitPairs[pair];
+    } else {
+        *--p = static_cast<char>('0' + value);
+    }
+    size_t length = static_cast<size_t>(scratch + sizeof(scratch) - p);
+    std::memcpy(out, p, length);
+    return length;
+}
+
+size_t formatShortestFloat(float value, char* out) {
+    if (std::isnan(value) || std::isinf(value)) {
+        return 0;
+    }
+#if defined(__cpp_lib_to_chars)
+    std::to_chars_result result = std::to_chars(out, out + 16, value);
+    return static_cast<size_t>(result.ptr - out);
+#else
+    // Portable fallback: the first precision that round-trips is the shortest
+    char scratch[32];
+    int length = 0;
+    for (int precision = 1; precision <= 9; ++precision) {
+        length = std::snprintf(scratch, sizeof(scratch), "%.*g", precision, static_cast<double>(value));
+        if (std::strtof(scratch, NULL) == value) {
+            break;
+        }
+    }
+    std::memcpy(out, scratch, static_cast<size_t>(length));
+    return static_cast<size_t>(length);
+#endif
+}
+
+// ============================================
+// RecordEmitter
+// ============================================
+
+RecordEmitter::RecordEmitter(char* buffer, size_t capacity, ChunkSink* sink)
+    : buffer_(buffer)
+    , capacity_(capacity)
+    , length_(0)
+    , sink_(sink)
+{
+}
+
+bool RecordEmitter::emit(const RecordSchema& schema, const void* record) {
+    if (!reserve(maxRecordSize(schema))) {
+        return false;
+    }
+    write(schema, record);
+    return true;
+}
+
+void RecordEmitter::flush() {
+    if (sink_ != NULL && length_ > 0) {
+        sink_->onChunk(buffer_, length_);
+        length_ = 0;
+    }
+}
+
+bool RecordEmitter::reserve(size_t length) {
+    if (capacity_ - length_ >= length) {
+        return true;
+    }
+    flush();
+    return capacity_ - length_ >= length;
+}
+
+void RecordEmitter::append(const char* text, size_t length) {
+    std::memcpy(buffer_ + length_, text, length);
+    length_ += length;
+}
+
+size_t RecordEmitter::maxFieldSize(const FieldSpec& field, bool quoteStrings) {
+    switch (field.kind) {
+    case FIELD_UINT32:
+        return 10;
+    case FIELD_ULONG:
+        return 20;
+    case FIELD_FLOAT:
+        return 16;  // also covers JSON's null
+    case FIELD_CHANNEL:
+        return quoteStrings ? 9 : 7;  // "unknown" is the longest name
+    case FIELD_BOOL:
+        return quoteStrings ? 5 : 1;
+    }
+    return 0;
+}
+
+void RecordEmitter::writeField(const FieldSpec& field, const void* record, bool quoteStrings) {
+    char* out = buffer_ + length_;
+    switch (field.kind) {
+    case FIELD_UINT32:
+        length_ += formatUnsigned(fieldValue<uint32_t>(record, field), out);
+        break;
+    case FIELD_ULONG:
+        length_ += formatUnsigned(fieldValue<unsigned long>(record, field), out);
+        break;
+    case FIELD_FLOAT: {
+        size_t length = formatShortestFloat(fieldValue<float>(record, field), out);
+        if (length == 0 && quoteStrings) {
+            append("null", 4);  // JSON has no NaN; CSV leaves the cell empty
+        }
+        length_ += length;
+        break;
+    }
+    case FIELD_CHANNEL: {
+        uint8_t channel = fieldValue<uint8_t>(record, field);
+        const char* name = channel < SAMPLE_CHANNEL_COUNT ? kChannelNames[channel] : "unknown";
+        if (quoteStrings) {
+            append("\"", 1);
+        }
+        append(name, std::strlen(name));
+        if (quoteStrings) {
+            append("\"", 1);
+        }
+        break;
+    }
+    case FIELD_BOOL: {
+        bool value = fieldValue<bool>(record, field);
+        if (quoteStrings) {
+            append(value ? "true" : "false", value ? 4 : 5);
+        } else {
+            append(value ? "1" : "0", 1);
+        }
+        break;
+    }
+    }
+}
+
+// ============================================
+// JsonEmitter
+// ============================================
+
+JsonEmitter::JsonEmitter(char* buffer, size_t capacity, ChunkSink* sink)
+    : RecordEmitter(buffer, capacity, sink)
+{
+}
+
+size_t JsonEmitter::maxRecordSize(const RecordSchema& schema) const {
+    // {"name":value,...}\n
+    size_t size = 3;
+    for (size_t i = 0; i < schema.fieldCount; ++i) {
+        size += std::strlen(schema.fields[i].name) + 4 + maxFieldSize(schema.fields[i], true);
+    }
+    return size;
+}
+
+void JsonEmitter::write(const RecordSchema& schema, const void* record) {
+    append("{", 1);
+    for (size_t i = 0; i < schema.fieldCount; ++i) {
+        const FieldSpec& field = schema.fields[i];
+        if (i > 0) {
+            append(",", 1);
+        }
+        append("\"", 1);
+        append(field.name, std::strlen(field.name));
+        append("\":", 2);
+        writeField(field, record, true);
+    }
+    append("}\n", 2);
+}
+
+// ============================================
+// CsvEmitter
+// ============================================
+
+CsvEmitter::CsvEmitter(char* buffer, size_t capacity, ChunkSink* sink)
+    : RecordEmitter(buffer, capacity, sink)
+{
+}
+
+bool CsvEmitter::emitHeader(const RecordSchema& schema) {
+    size_t size = schema.fieldCount + 1;
+    for (size_t i = 0; i < schema.fieldCount; ++i) {
+        size += std::strlen(schema.fields[i].name);
+    }
+    if (!reserve(size)) {
+        return false;
+    }
+    for (size_t i = 0; i < schema.fieldCount; ++i) {
+        if (i > 0) {
+            append(",", 1);
+        }
+        append(schema.fields[i].name, std::strlen(schema.fields[i].name));
+    }
+    append("\n", 1);
+    return true;
+}
+
+size_t CsvEmitter::maxRecordSize(const RecordSchema& schema) const {
+    // value,...\n
+    size_t size = schema.fieldCount + 1;
+    for (size_t i = 0; i < schema.fieldCount; ++i) {
+        size += maxFieldSize(schema.fields[i], false);
+    }
+    return size;
+}
+
+void CsvEmitter::write(const RecordSchema& schema, const void* record) {
+    for (size_t i = 0; i < schema.fieldCount; ++i) {
+        if (i > 0) {
+            append(",", 1);
+        }
+        writeField(schema.fields[i], record, false);
+    }
+    append("\n", 1);
+}
@@ -0,0 +1,729 @@
+#include "replay_cache.h"
+#include "config.h"
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+namespace {
+
+const char kCacheMagic[8] = { 'R', 'P', 'L', 'C', '0', '0', '0', '1' };
+const char kTempSuffix[] = ".tmp";
+const uint64_t kHashSeed = 0x243F6A8885A308D3ULL;
+const uint64_t kHashMultiplier = 0x9E3779B97F4A7C15ULL;
+
+// splitmix64 finalizer
+uint64_t mixHash(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+uint64_t combine(uint64_t hash, uint64_t value) {
+    return mixHash(hash ^ (value + kHashMultiplier));
+}
+
+uint64_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * Hash of a line, eight bytes per step
+ */
+uint64_t hashBytes(const char* data, size_t length) {
+    uint64_t hash = kHashSeed ^ (static_cast<uint64_t>(length) * kHashMultiplier);
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * kHashMultiplier;
+        hash = (hash << 31) | (hash >> 33);
+    }
+    if (i < length) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + i, length - i);
+        hash = (hash ^ word) * kHashMultiplier;
+    }
+    return mixHash(hash);
+}
+
+/**
+ * A ReplayCacheRecord as saved; records are written as one array per entry
+ */
+struct SavedRecord {
+    uint64_t timeMs;
+    float value;
+    uint8_t channel;
+    uint8_t flags;   // 1 stable, 2 stable update
+    uint8_t reserved[2];
+};
+
+/**
+ * A ReplayCacheKey as saved; a file's blocks are written as one array
+ */
+struct SavedKey {
+    uint64_t content;
+    uint64_t config;
+    uint64_t entry;
+    uint32_t length;
+    uint32_t reserved;
+};
+
+const uint32_t kMaxSavedPathLength = 64 * 1024;
+
+template<typename T>
+bool writeValue(FILE* file, const T& value) {
+    return std::fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+template<typename T>
+bool readValue(FILE* file, T& value) {
+    return std::fread(&value, sizeof(value), 1, file) == 1;
+}
+
+bool writeBoundary(FILE* file, const ReplayBoundary& boundary) {
+    const HeightDebouncer::Checkpoint& height = boundary.height;
+    const ReadingDebouncer<float>::Checkpoint& bpm = boundary.bpm;
+    const ReadingDebouncer<int>::Checkpoint& spo2 = boundary.spo2;
+    return writeValue(file, static_cast<int32_t>(height.toleranceCm)) &&
+           writeValue(file, static_cast<int32_t>(height.lastReading)) &&
+           writeValue(file, static_cast<int32_t>(height.stableReading)) &&
+           writeValue(file, static_cast<uint64_t>(height.stabilityStartTime)) &&
+           writeValue(file, static_cast<uint64_t>(height.lastSampleTime)) &&
+           writeValue(file, static_cast<uint8_t>(height.isStable)) &&
+           writeValue(file, static_cast<uint8_t>(height.hasReading)) &&
+           writeValue(file, bpm.tolerance) && writeValue(file, bpm.lastReading) &&
+           writeValue(file, bpm.stableReading) &&
+           writeValue(file, static_cast<uint64_t>(bpm.stabilityStartTime)) &&
+           writeValue(file, static_cast<uint64_t>(bpm.lastSampleTime)) &&
+           writeValue(file, static_cast<uint8_t>(bpm.isStable)) &&
+           writeValue(file, static_cast<uint8_t>(bpm.hasReading)) &&
+           writeValue(file, static_cast<uint8_t>(bpm.lastReadingValid)) &&
+           writeValue(file, static_cast<int32_t>(spo2.tolerance)) &&
+           writeValue(file, static_cast<int32_t>(spo2.lastReading)) &&
+           writeValue(file, static_cast<int32_t>(spo2.stableReading)) &&
+           writeValue(file, static_cast<uint64_t>(spo2.stabilityStartTime)) &&
+           writeValue(file, static_cast<uint64_t>(spo2.lastSampleTime)) &&
+           writeValue(file, static_cast<uint8_t>(spo2.isStable)) &&
+           writeValue(file, static_cast<uint8_t>(spo2.hasReading)) &&
+           writeValue(file, static_cast<uint8_t>(spo2.lastReadingValid)) &&
+           writeValue(file, static_cast<uint64_t>(boundary.nextHeightTimeMs));
+}
+
+template<typename Stored, typename T>
+bool readAs(FILE* file, T& value) {
+    Stored stored;
+    if (!readValue(file, stored)) {
+        return false;
+    }
+    value = static_cast<T>(stored);
+    return true;
+}
+
+bool readFlag(FILE* file, bool& value) {
+    uint8_t stored;
+    if (!readValue(file, stored)) {
+        return false;
+    }
+    value = stored != 0;
+    return true;
+}
+
+bool readBoundary(FILE* file, ReplayBoundary& boundary) {
+    HeightDebouncer::Checkpoint& height = boundary.height;
+    ReadingDebouncer<float>::Checkpoint& bpm = boundary.bpm;
+    ReadingDebouncer<int>::Checkpoint& spo2 = boundary.spo2;
+    return readAs<int32_t>(file, height.toleranceCm) && readAs<int32_t>(file, height.lastReading) &&
+           readAs<int32_t>(file, height.stableReading) && readAs<uint64_t>(file, height.stabilityStartTime) &&
+           readAs<uint64_t>(file, height.lastSampleTime) && readFlag(file, height.isStable) &&
+           readFlag(file, height.hasReading) &&
+           readValue(file, bpm.tolerance) && readValue(file, bpm.lastReading) && readValue(file, bpm.stableReading) &&
+           readAs<uint64_t>(file, bpm.stabilityStartTime) && readAs<uint64_t>(file, bpm.lastSampleTime) &&
+           readFlag(file, bpm.isStable) && readFlag(file, bpm.hasReading) && readFlag(file, bpm.lastReadingValid) &&
+           readAs<int32_t>(file, spo2.tolerance) && readAs<int32_t>(file, spo2.lastReading) &&
+           readAs<int32_t>(file, spo2.stableReading) && readAs<uint64_t>(file, spo2.stabilityStartTime) &&
+           readAs<uint64_t>(file, spo2.lastSampleTime) && readFlag(file, spo2.isStable) &&
+           readFlag(file, spo2.hasReading) && readFlag(file, spo2.lastReadingValid) &&
+           readAs<uint64_t>(file, boundary.nextHeightTimeMs);
+}
+
+ReplayBoundary boundaryOf(const TraceReplayer& replayer, const TraceParser& parser) {
+    ReplayBoundary boundary;
+    boundary.height = replayer.getHeightDebouncer().getCheckpoint();
+    boundary.bpm = replayer.getBpmDebouncer().getCheckpoint();
+    boundary.spo2 = replayer.getSpo2Debouncer().getCheckpoint();
+    boundary.nextHeightTimeMs = parser.getNextHeightTimeMs();
+    return boundary;
+}
+
+} // namespace
+
+uint64_t replayConfigHash(const HeightDebouncer& height, const ReadingDebouncer<float>& bpm,
+                          const ReadingDebouncer<int>& spo2, unsigned long heightIntervalMs) {
+    uint64_t hash = kHashSeed;
+    hash = combine(hash, static_cast<uint64_t>(height.getToleranceCm()));
+    hash = combine(hash, height.getStabilityDurationMs());
+    hash = combine(hash, height.getSampleIntervalMs());
+    hash = combine(hash, heightIntervalMs);
+    hash = combine(hash, floatBits(bpm.getTolerance()));
+    hash = combine(hash, bpm.getStabilityDurationMs());
+    hash = combine(hash, bpm.getSampleIntervalMs());
+    hash = combine(hash, floatBits(bpm.getMinValid()));
+    hash = combine(hash, floatBits(bpm.getMaxValid()));
+    hash = combine(hash, static_cast<uint64_t>(spo2.getTolerance()));
+    hash = combine(hash, spo2.getStabilityDurationMs());
+    hash = combine(hash, spo2.getSampleIntervalMs());
+    hash = combine(hash, static_cast<uint64_t>(spo2.getMinValid()));
+    hash = combine(hash, static_cast<uint64_t>(spo2.getMaxValid()));
+    return hash;
+}
+
+uint64_t replayBoundaryHash(const ReplayBoundary& boundary) {
+    const HeightDebouncer::Checkpoint& height = boundary.height;
+    const ReadingDebouncer<float>::Checkpoint& bpm = boundary.bpm;
+    const ReadingDebouncer<int>::Checkpoint& spo2 = boundary.spo2;
+    uint64_t hash = kHashSeed;
+    hash = combine(hash, static_cast<uint64_t>(height.toleranceCm));
+    hash = combine(hash, static_cast<uint64_t>(height.lastReading));
+    hash = combine(hash, static_cast<uint64_t>(height.stableReading));
+    hash = combine(hash, height.stabilityStartTime);
+    hash = combine(hash, height.lastSampleTime);
+    hash = combine(hash, (height.isStable ? 1u : 0u) | (height.hasReading ? 2u : 0u));
+    hash = combine(hash, floatBits(bpm.tolerance));
+    hash = combine(hash, floatBits(bpm.lastReading));
+    hash = combine(hash, floatBits(bpm.stableReading));
+    hash = combine(hash, bpm.stabilityStartTime);
+    hash = combine(hash, bpm.lastSampleTime);
+    hash = combine(hash, (bpm.isStable ? 1u : 0u) | (bpm.hasReading ? 2u : 0u) | (bpm.lastReadingValid ? 4u : 0u));
+    hash = combine(hash, static_cast<uint64_t>(spo2.tolerance));
+    hash = combine(hash, static_cast<uint64_t>(spo2.lastReading));
+    hash = combine(hash, static_cast<uint64_t>(spo2.stableReading));
+    hash = combine(hash, spo2.stabilityStartTime);
+    hash = combine(hash, spo2.lastSampleTime);
+    hash = combine(hash, (spo2.isStable ? 1u : 0u) | (spo2.hasReading ? 2u : 0u) | (spo2.lastReadingValid ? 4u : 0u));
+    hash = combine(hash, boundary.nextHeightTimeMs);
+    return hash;
+}
+
+bool replayFileStamp(const std::string& path, ReplayFileStamp& stamp) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    stamp.inode = static_cast<uint64_t>(info.st_ino);
+#if defined(__linux__)
+    stamp.mtimeNs = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+#else
+    stamp.mtimeNs = static_cast<int64_t>(info.st_mtime) * 1000000000LL;
+#endif
+    return true;
+}
+
+// ============================================
+// ReplayCache
+// ============================================
+
+ReplayCache::ReplayCache(const ReplayCacheOptions& options)
+    : options_(options)
+    , run_(0)
+    , hits_(0)
+    , misses_(0)
+    , modified_(false)
+{
+}
+
+const ReplayCacheEntry* ReplayCache::find(const ReplayCacheKey& key) {
+    std::unordered_map<ReplayCacheKey, ReplayCacheEntry, KeyHash>::iterator it = entries_.find(key);
+    if (it == entries_.end()) {
+        misses_++;
+        return NULL;
+    }
+    hits_++;
+    it->second.lastUsedRun = run_;
+    return &it->second;
+}
+
+void ReplayCache::insert(const ReplayCacheKey& key, const ReplayCacheEntry& entry) {
+    ReplayCacheEntry& stored = entries_[key];
+    stored = entry;
+    stored.lastUsedRun = run_;
+    modified_ = true;
+}
+
+const ReplayCacheFile* ReplayCache::findFile(const std::string& path, uint64_t config,
+                                             const ReplayFileStamp& stamp) {
+    std::map<std::pair<std::string, uint64_t>, ReplayCacheFile>::iterator it =
+        files_.find(std::make_pair(path, config));
+    if (it == files_.end() || !(it->second.stamp == stamp)) {
+        return NULL;
+    }
+    it->second.lastUsedRun = run_;
+    return &it->second;
+}
+
+void ReplayCache::insertFile(const std::string& path, uint64_t config, const ReplayCacheFile& file) {
+    ReplayCacheFile& stored = files_[std::make_pair(path, config)];
+    stored = file;
+    stored.lastUsedRun = run_;
+    modified_ = true;
+}
+
+bool ReplayCache::save(const char* path) const {
+    std::string temp = std::string(path) + kTempSuffix;
+    FILE* file = std::fopen(temp.c_str(), "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    uint64_t kept = 0;
+    std::unordered_map<ReplayCacheKey, ReplayCacheEntry, KeyHash>::const_iterator it;
+    for (it = entries_.begin(); it != entries_.end(); ++it) {
+        if (run_ - it->second.lastUsedRun <= options_.maxIdleRuns) {
+            kept++;
+        }
+    }
+    std::vector<SavedRecord> saved;
+    bool ok = std::fwrite(kCacheMagic, sizeof(kCacheMagic), 1, file) == 1 && writeValue(file, run_) &&
+              writeValue(file, kept);
+    for (it = entries_.begin(); ok && it != entries_.end(); ++it) {
+        const ReplayCacheKey& key = it->first;
+        const ReplayCacheEntry& entry = it->second;
+        if (run_ - entry.lastUsedRun > options_.maxIdleRuns) {
+            continue;
+        }
+        ok = writeValue(file, key.content) && writeValue(file, key.config) && writeValue(file, key.entry) &&
+             writeValue(file, key.length) && writeValue(file, entry.lastUsedRun) &&
+             writeValue(file, entry.samples) && writeValue(file, entry.transitions) &&
+             writeValue(file, entry.linesParsed) && writeValue(file, entry.linesSkipped) &&
+             writeBoundary(file, entry.end) && writeValue(file, static_cast<uint32_t>(entry.records.size()));
+        saved.resize(entry.records.size());
+        for (size_t i = 0; i < entry.records.size(); ++i) {
+            const ReplayCacheRecord& record = entry.records[i];
+            saved[i].timeMs = record.timeMs;
+            saved[i].value = record.value;
+            saved[i].channel = record.channel;
+            saved[i].flags = static_cast<uint8_t>((record.stable ? 1 : 0) | (record.update ? 2 : 0));
+            saved[i].reserved[0] = 0;
+            saved[i].reserved[1] = 0;
+        }
+        ok = ok && (saved.empty() || std::fwrite(&saved[0], sizeof(SavedRecord), saved.size(), file) == saved.size());
+    }
+
+    uint64_t keptFiles = 0;
+    std::map<std::pair<std::string, uint64_t>, ReplayCacheFile>::const_iterator fileIt;
+    for (fileIt = files_.begin(); fileIt != files_.end(); ++fileIt) {
+        if (run_ - fileIt->second.lastUsedRun <= options_.maxIdleRuns) {
+            keptFiles++;
+        }
+    }
+    ok = ok && writeValue(file, keptFiles);
+    std::vector<SavedKey> keys;
+    for (fileIt = files_.begin(); ok && fileIt != files_.end(); ++fileIt) {
+        const std::string& filePath = fileIt->first.first;
+        const ReplayCacheFile& cached = fileIt->second;
+        if (run_ - cached.lastUsedRun > options_.maxIdleRuns) {
+            continue;
+        }
+        ok = writeValue(file, static_cast<uint32_t>(filePath.size())) &&
+             std::fwrite(filePath.data(), 1, filePath.size(), file) == filePath.size() &&
+             writeValue(file, fileIt->first.second) && writeValue(file, cached.stamp.size) &&
+             writeValue(file, cached.stamp.inode) && writeValue(file, cached.stamp.mtimeNs) &&
+             writeValue(file, cached.lastUsedRun) && writeValue(file, static_cast<uint32_t>(cached.blocks.size()));
+        keys.resize(cached.blocks.size());
+        for (size_t i = 0; i < cached.blocks.size(); ++i) {
+            keys[i].content = cached.blocks[i].content;
+            keys[i].config = cached.blocks[i].config;
+            keys[i].entry = cached.blocks[i].entry;
+            keys[i].length = cached.blocks[i].length;
+            keys[i].reserved = 0;
+        }
+        ok = ok && (keys.empty() || std::fwrite(&keys[0], sizeof(SavedKey), keys.size(), file) == keys.size());
+    }
+
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(temp.c_str(), path) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ReplayCache::load(const char* path) {
+    clear();
+    FILE* file = std::fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    char magic[sizeof(kCacheMagic)];
+    uint32_t savedRun = 0;
+    uint64_t count = 0;
+    bool ok = std::fread(magic, sizeof(magic), 1, file) == 1 &&
+              std::memcmp(magic, kCacheMagic, sizeof(magic)) == 0 && readValue(file, savedRun) &&
+              readValue(file, count);
+    std::vector<SavedRecord> saved;
+    for (uint64_t e = 0; ok && e < count; ++e) {
+        ReplayCacheKey key;
+        uint32_t records = 0;
+        ok = readValue(file, key.content) && readValue(file, key.config) && readValue(file, key.entry) &&
+             readValue(file, key.length);
+        if (!ok) {
+            break;
+        }
+        ReplayCacheEntry& entry = entries_[key];
+        ok = readValue(file, entry.lastUsedRun) && readValue(file, entry.samples) &&
+             readValue(file, entry.transitions) && readValue(file, entry.linesParsed) &&
+             readValue(file, entry.linesSkipped) && readBoundary(file, entry.end) && readValue(file, records);
+        // A line yields at most two samples, so a sane count is below the block's length
+        ok = ok && records <= key.length;
+        if (ok) {
+            saved.resize(records);
+            ok = records == 0 || std::fread(&saved[0], sizeof(SavedRecord), records, file) == records;
+        }
+        entry.records.resize(ok ? records : 0);
+        for (uint32_t i = 0; ok && i < records; ++i) {
+            ReplayCacheRecord& record = entry.records[i];
+            record.timeMs = static_cast<unsigned long>(saved[i].timeMs);
+            record.value = saved[i].value;
+            record.channel = saved[i].channel;
+            record.stable = (saved[i].flags & 1) != 0;
+            record.update = (saved[i].flags & 2) != 0;
+        }
+    }
+
+    uint64_t fileCount = 0;
+    ok = ok && readValue(file, fileCount);
+    std::vector<SavedKey> keys;
+    for (uint64_t f = 0; ok && f < fileCount; ++f) {
+        uint32_t pathLength = 0;
+        ok = readValue(file, pathLength) && pathLength <= kMaxSavedPathLength;
+        if (!ok) {
+            break;
+        }
+        std::string filePath(pathLength, '\0');
+        uint64_t config = 0;
+        uint32_t blocks = 0;
+        ReplayCacheFile cached;
+        ok = (pathLength == 0 || std::fread(&filePath[0], 1, pathLength, file) == pathLength) &&
+             readValue(file, config) && readValue(file, cached.stamp.size) && readValue(file, cached.stamp.inode) &&
+             readValue(file, cached.stamp.mtimeNs) && readValue(file, cached.lastUsedRun) &&
+             readValue(file, blocks);
+        // Every block holds at least one byte of the file
+        ok = ok && blocks <= cached.stamp.size;
+        if (ok) {
+            keys.resize(blocks);
+            ok = blocks == 0 || std::fread(&keys[0], sizeof(SavedKey), blocks, file) == blocks;
+        }
+        if (!ok) {
+            break;
+        }
+        cached.blocks.resize(blocks);
+        for (uint32_t i = 0; i < blocks; ++i) {
+            cached.blocks[i].content = keys[i].content;
+            cached.blocks[i].config = keys[i].config;
+            cached.blocks[i].entry = keys[i].entry;
+            cached.blocks[i].length = keys[i].length;
+        }
+        ReplayCacheFile& stored = files_[std::make_pair(filePath, config)];
+        stored.stamp = cached.stamp;
+        stored.lastUsedRun = cached.lastUsedRun;
+        stored.blocks.swap(cached.blocks);
+    }
+
+    std::fclose(file);
+    if (!ok) {
+        clear();
+        return false;
+    }
+    run_ = savedRun + 1;
+    return true;
+}
+
+void ReplayCache::clear() {
+    entries_.clear();
+    files_.clear();
+    run_ = 0;
+    hits_ = 0;
+    misses_ = 0;
+    modified_ = false;
+}
+
+// ============================================
+// CachedTraceFileReplay
+// ============================================
+
+void CachedTraceFileReplay::Recorder::onTransition(const StabilityTransition& transition) {
+    record(transition, false);
+    if (sink_ != NULL) {
+        sink_->onTransition(transition);
+    }
+}
+
+void CachedTraceFileReplay::Recorder::onStableUpdate(const StabilityTransition& transition) {
+    record(transition, true);
+    if (sink_ != NULL) {
+        sink_->onStableUpdate(transition);
+    }
+}
+
+void CachedTraceFileReplay::Recorder::record(const StabilityTransition& transition, bool update) {
+    if (records_ == NULL) {
+        return;
+    }
+    ReplayCacheRecord record;
+    record.timeMs = transition.timeMs;
+    record.value = transition.value;
+    record.channel = transition.channel;
+    record.stable = transition.stable;
+    record.update = update;
+    records_->push_back(record);
+}
+
+CachedTraceFileReplay::Stream::Stream(const TraceReplayer& prototype, StabilityTransitionSink* sink,
+                                      uint32_t deviceId)
+    : recorder(sink)
+    , replayer(prototype.getHeightDebouncer(), prototype.getBpmDebouncer(), prototype.getSpo2Debouncer(), &recorder)
+    , parser(&replayer, deviceId)
+    , scanned(0)
+    , blockHash(kHashSeed)
+    , boundary(boundaryOf(replayer, parser))
+    , boundaryHash(replayBoundaryHash(boundary))
+    , live(true)
+{
+}
+
+CachedTraceFileReplay::CachedTraceFileReplay(const HeightDebouncer& height, const ReadingDebouncer<float>& bpm,
+                                             const ReadingDebouncer<int>& spo2, StabilityTransitionSink* sink,
+                                             ReplayCache* cache)
+    : prototype_(height, bpm, spo2, NULL)
+    , sink_(sink)
+    , cache_(cache)
+    , configHash_(replayConfigHash(height, bpm, spo2, DEBOUNCE_SAMPLE_INTERVAL_MS))
+    , cutMask_((1ULL << cache->getOptions().cutBits) - 1)
+    , filesCompleted_(0)
+    , filesUnchanged_(0)
+    , samplesProcessed_(0)
+    , transitionCount_(0)
+    , linesParsed_(0)
+    , linesSkipped_(0)
+    , blocksReused_(0)
+    , blocksReplayed_(0)
+    , bytesReused_(0)
+{
+}
+
+CachedTraceFileReplay::CachedTraceFileReplay(StabilityTransitionSink* sink, ReplayCache* cache)
+    : CachedTraceFileReplay(HeightDebouncer(),
+                            ReadingDebouncer<float>(BPM_TOLERANCE, BPM_STABILITY_DURATION_MS, BPM_SAMPLE_INTERVAL_MS,
+                                                    BPM_MIN_VALID, BPM_MAX_VALID),
+                            ReadingDebouncer<int>(SPO2_TOLERANCE, SPO2_STABILITY_DURATION_MS,
+                                                  SPO2_SAMPLE_INTERVAL_MS, SPO2_MIN_VALID, SPO2_MAX_VALID),
+                            sink, cache)
+{
+}
+
+CachedTraceFileReplay::~CachedTraceFileReplay() {
+    for (size_t i = 0; i < streams_.size(); ++i) {
+        delete streams_[i];
+    }
+}
+
+void CachedTraceFileReplay::onBlock(size_t fileIndex, const char* data, size_t length) {
+    Stream* stream = streamFor(fileIndex);
+    stream->pending.append(data, length);
+    cutBlocks(stream, deviceIdFor(fileIndex));
+}
+
+void CachedTraceFileReplay::onFileEnd(size_t fileIndex) {
+    Stream* stream = streamFor(fileIndex);
+    uint32_t deviceId = deviceIdFor(fileIndex);
+    if (!stream->pending.empty()) {
+        // The last block: its lines so far, and a line without a newline
+        size_t tail = stream->pending.size() - stream->scanned;
+        if (tail > 0) {
+            stream->blockHash = combine(stream->blockHash, hashBytes(stream->pending.data() + stream->scanned, tail));
+        }
+        finishBlock(stream, deviceId, stream->pending.data(), stream->pending.size(), true);
+    }
+    if (fileIndex < chains_.size()) {
+        chains_[fileIndex].swap(stream->blocks);
+    }
+    filesCompleted_++;
+    delete stream;
+    streams_[fileIndex] = NULL;
+}
+
+void CachedTraceFileReplay::cutBlocks(Stream* stream, uint32_t deviceId) {
+    const ReplayCacheOptions& options = cache_->getOptions();
+    size_t pos = stream->scanned;
+    size_t blockStart = 0;
+    for (;;) {
+        const char* base = stream->pending.data();
+        const char* newline = static_cast<const char*>(std::memchr(base + pos, '\n', stream->pending.size() - pos));
+        if (newline == NULL) {
+            break;
+        }
+        size_t lineEnd = static_cast<size_t>(newline - base) + 1;
+        uint64_t lineHash = hashBytes(base + pos, lineEnd - pos);
+        stream->blockHash = combine(stream->blockHash, lineHash);
+        pos = lineEnd;
+        size_t blockLength = pos - blockStart;
+        if ((blockLength >= options.minBlockBytes && (lineHash & cutMask_) == 0) ||
+            blockLength >= options.maxBlockBytes) {
+            finishBlock(stream, deviceId, base + blockStart, blockLength, false);
+            blockStart = pos;
+        }
+    }
+    stream->pending.erase(0, blockStart);
+    stream->scanned = pos - blockStart;
+}
+
+void CachedTraceFileReplay::finishBlock(Stream* stream, uint32_t deviceId, const char* data, size_t length,
+                                        bool last) {
+    ReplayCacheKey key;
+    key.content = stream->blockHash;
+    key.config = configHash_;
+    key.entry = stream->boundaryHash;
+    key.length = static_cast<uint32_t>(length);
+    stream->blockHash = kHashSeed;
+    stream->blocks.push_back(key);
+
+    const ReplayCacheEntry* cached = cache_->find(key);
+    if (cached != NULL) {
+        emitCached(*cached, deviceId, length);
+        stream->boundary = cached->end;
+        stream->boundaryHash = replayBoundaryHash(stream->boundary);
+        stream->live = false;
+        return;
+    }
+
+    if (!stream->live) {
+        stream->replayer.restore(stream->boundary.height, stream->boundary.bpm, stream->boundary.spo2);
+        stream->parser.setNextHeightTimeMs(stream->boundary.nextHeightTimeMs);
+        stream->live = true;
+    }
+    unsigned long samples = stream->replayer.getSamplesProcessed();
+    unsigned long transitions = stream->replayer.getTransitionCount();
+    unsigned long linesParsed = stream->parser.getLinesParsed();
+    unsigned long linesSkipped = stream->parser.getLinesSkipped();
+
+    ReplayCacheEntry entry;
+    stream->recorder.setRecords(&entry.records);
+    stream->parser.feed(data, length);
+    if (last) {
+        stream->parser.finish();
+    }
+    stream->recorder.setRecords(NULL);
+
+    entry.end = boundaryOf(stream->replayer, stream->parser);
+    entry.samples = static_cast<uint32_t>(stream->replayer.getSamplesProcessed() - samples);
+    entry.transitions = static_cast<uint32_t>(stream->replayer.getTransitionCount() - transitions);
+    entry.linesParsed = static_cast<uint32_t>(stream->parser.getLinesParsed() - linesParsed);
+    entry.linesSkipped = static_cast<uint32_t>(stream->parser.getLinesSkipped() - linesSkipped);
+    entry.lastUsedRun = 0;
+    cache_->insert(key, entry);
+
+    samplesProcessed_ += entry.samples;
+    transitionCount_ += entry.transitions;
+    linesParsed_ += entry.linesParsed;
+    linesSkipped_ += entry.linesSkipped;
+    blocksReplayed_++;
+    stream->boundary = entry.end;
+    stream->boundaryHash = replayBoundaryHash(stream->boundary);
+}
+
+void CachedTraceFileReplay::emitCached(const ReplayCacheEntry& entry, uint32_t deviceId, size_t length) {
+    for (size_t i = 0; sink_ != NULL && i < entry.records.size(); ++i) {
+        const ReplayCacheRecord& record = entry.records[i];
+        StabilityTransition transition;
+        transition.deviceId = deviceId;
+        transition.timeMs = record.timeMs;
+        transition.value = record.value;
+        transition.channel = record.channel;
+        transition.stable = record.stable;
+        if (record.update) {
+            sink_->onStableUpdate(transition);
+        } else {
+            sink_->onTransition(transition);
+        }
+    }
+    samplesProcessed_ += entry.samples;
+    transitionCount_ += entry.transitions;
+    linesParsed_ += entry.linesParsed;
+    linesSkipped_ += entry.linesSkipped;
+    blocksReused_++;
+    bytesReused_ += length;
+}
+
+bool CachedTraceFileReplay::replayUnchanged(const ReplayCacheFile& file, uint32_t deviceId) {
+    // Only replay a file whose blocks are all still cached; otherwise read it
+    std::vector<const ReplayCacheEntry*> entries(file.blocks.size());
+    for (size_t i = 0; i < file.blocks.size(); ++i) {
+        entries[i] = cache_->find(file.blocks[i]);
+        if (entries[i] == NULL) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+        emitCached(*entries[i], deviceId, file.blocks[i].length);
+    }
+    return true;
+}
+
+bool CachedTraceFileReplay::run(AsyncTraceReader& reader, const std::vector<std::string>& paths) {
+    std::vector<std::string> changed;
+    std::vector<ReplayFileStamp> stamps;
+    std::vector<bool> stamped;
+    deviceIds_.clear();
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ReplayFileStamp stamp;
+        bool hasStamp = replayFileStamp(paths[i], stamp);
+        if (hasStamp) {
+            const ReplayCacheFile* file = cache_->findFile(paths[i], configHash_, stamp);
+            if (file != NULL && replayUnchanged(*file, static_cast<uint32_t>(i))) {
+                filesUnchanged_++;
+                filesCompleted_++;
+                continue;
+            }
+        }
+        changed.push_back(paths[i]);
+        stamps.push_back(stamp);
+        stamped.push_back(hasStamp);
+        deviceIds_.push_back(static_cast<uint32_t>(i));
+    }
+
+    chains_.assign(changed.size(), std::vector<ReplayCacheKey>());
+    bool ok = reader.run(changed, *this);
+    // A stamp taken before the read is only trusted if the whole run read cleanly
+    for (size_t i = 0; ok && i < changed.size(); ++i) {
+        if (stamped[i]) {
+            ReplayCacheFile file;
+            file.stamp = stamps[i];
+            file.blocks.swap(chains_[i]);
+            file.lastUsedRun = 0;
+            cache_->insertFile(changed[i], configHash_, file);
+        }
+    }
+    deviceIds_.clear();
+    chains_.clear();
+    return ok;
+}
+
+CachedTraceFileReplay::Stream* CachedTraceFileReplay::streamFor(size_t fileIndex) {
+    if (fileIndex >= streams_.size()) {
+        streams_.resize(fileIndex + 1, NULL);
+    }
+    if (streams_[fileIndex] == NULL) {
+        streams_[fileIndex] = new Stream(prototype_, sink_, deviceIdFor(fileIndex));
+    }
+    return streams_[fileIndex];
+}
+
+uint32_t CachedTraceFileReplay::deviceIdFor(size_t fileIndex) const {
+    return fileIndex < deviceIds_.size() ? deviceIds_[fileIndex] : static_cast<uint32_t>(fileIndex);
+}
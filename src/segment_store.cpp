@@ -0,0 +1,810 @@
+#include "segment_store.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <limits>
+#include <set>
+
+namespace {
+
+const char kSegmentMagic[8] = { 'R', 'S', 'E', 'G', '0', '0', '0', '1' };
+const char kSegmentPrefix[] = "seg-";
+const char kSegmentSuffix[] = ".rseg";
+const char kTempSuffix[] = ".tmp";
+const size_t kSegmentIdDigits = 16;
+
+template<typename T>
+bool writeValue(FILE* file, const T& value) {
+    return std::fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+template<typename T>
+bool readValue(FILE* file, T& value) {
+    return std::fread(&value, sizeof(value), 1, file) == 1;
+}
+
+template<typename T>
+bool writeColumn(FILE* file, const std::vector<T>& column) {
+    return column.empty() || std::fwrite(column.data(), sizeof(T), column.size(), file) == column.size();
+}
+
+bool rowBefore(const TraceSample& a, const TraceSample& b) {
+    if (a.deviceId != b.deviceId) {
+        return a.deviceId < b.deviceId;
+    }
+    if (a.timeMs != b.timeMs) {
+        return a.timeMs < b.timeMs;
+    }
+    return a.channel < b.channel;
+}
+
+bool endsWith(const char* name, const char* suffix) {
+    size_t length = std::strlen(name);
+    size_t suffixLength = std::strlen(suffix);
+    return length >= suffixLength && std::strcmp(name + length - suffixLength, suffix) == 0;
+}
+
+// "seg-<16 hex digits>.rseg"
+bool parseSegmentName(const char* name, uint64_t& id) {
+    size_t prefixLength = sizeof(kSegmentPrefix) - 1;
+    if (std::strlen(name) != prefixLength + kSegmentIdDigits + sizeof(kSegmentSuffix) - 1 ||
+        std::strncmp(name, kSegmentPrefix, prefixLength) != 0 || !endsWith(name, kSegmentSuffix)) {
+        return false;
+    }
+    char digits[kSegmentIdDigits + 1];
+    std::memcpy(digits, name + prefixLength, kSegmentIdDigits);
+    digits[kSegmentIdDigits] = '\0';
+    char* end = NULL;
+    id = std::strtoull(digits, &end, 16);
+    return *end == '\0';
+}
+
+uint64_t mixDeviceId(uint32_t deviceId) {
+    uint64_t x = deviceId + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+bool matches(const SegmentQuery& query, const TraceSample& row) {
+    if (!query.allDevices && row.deviceId != query.deviceId) {
+        return false;
+    }
+    if (row.timeMs < query.fromMs || row.timeMs > query.toMs) {
+        return false;
+    }
+    return query.allChannels ||
+           (row.channel == query.channel && row.value >= query.minValue && row.value <= query.maxValue);
+}
+
+} // namespace
+
+// ============================================
+// SegmentZoneMap
+// ============================================
+
+SegmentZoneMap::SegmentZoneMap()
+    : rows(0)
+    , minTimeMs(ULONG_MAX)
+    , maxTimeMs(0)
+{
+    for (int channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        channelRows[channel] = 0;
+        minValue[channel] = std::numeric_limits<float>::infinity();
+        maxValue[channel] = -std::numeric_limits<float>::infinity();
+    }
+}
+
+void SegmentZoneMap::add(const TraceSample& sample) {
+    rows++;
+    minTimeMs = std::min(minTimeMs, sample.timeMs);
+    maxTimeMs = std::max(maxTimeMs, sample.timeMs);
+    if (sample.channel < SAMPLE_CHANNEL_COUNT) {
+        channelRows[sample.channel]++;
+        minValue[sample.channel] = std::min(minValue[sample.channel], sample.value);
+        maxValue[sample.channel] = std::max(maxValue[sample.channel], sample.value);
+    }
+}
+
+bool SegmentZoneMap::overlapsTime(unsigned long fromMs, unsigned long toMs) const {
+    return rows > 0 && minTimeMs <= toMs && maxTimeMs >= fromMs;
+}
+
+bool SegmentZoneMap::overlapsValue(uint8_t channel, float low, float high) const {
+    return channel < SAMPLE_CHANNEL_COUNT && channelRows[channel] > 0 && minValue[channel] <= high &&
+           maxValue[channel] >= low;
+}
+
+// ============================================
+// DeviceBloomFilter
+// ============================================
+
+DeviceBloomFilter::DeviceBloomFilter() {
+}
+
+void DeviceBloomFilter::reset(size_t devices) {
+    size_t bits = std::max<size_t>(devices * SEGMENT_BLOOM_BITS_PER_DEVICE, 64);
+    words_.assign((bits + 63) / 64, 0);
+}
+
+void DeviceBloomFilter::add(uint32_t deviceId) {
+    if (words_.empty()) {
+        reset(1);
+    }
+    // Double hashing: probe i is h1 + i * h2
+    uint64_t hash = mixDeviceId(deviceId);
+    uint64_t bits = words_.size() * 64;
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1u;
+    for (uint32_t i = 0; i < SEGMENT_BLOOM_HASHES; ++i) {
+        uint64_t bit = (h1 + static_cast<uint64_t>(i) * h2) % bits;
+        words_[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+bool DeviceBloomFilter::mayContain(uint32_t deviceId) const {
+    if (words_.empty()) {
+        return false;
+    }
+    uint64_t hash = mixDeviceId(deviceId);
+    uint64_t bits = words_.size() * 64;
+    uint32_t h1 = static_cast<uint32_t>(hash);
+    uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1u;
+    for (uint32_t i = 0; i < SEGMENT_BLOOM_HASHES; ++i) {
+        uint64_t bit = (h1 + static_cast<uint64_t>(i) * h2) % bits;
+        if ((words_[bit / 64] & (1ULL << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DeviceBloomFilter::assign(const std::vector<uint64_t>& words) {
+    if (words.empty()) {
+        return false;
+    }
+    words_ = words;
+    return true;
+}
+
+// ============================================
+// Configuration
+// ============================================
+
+SegmentStoreConfig::SegmentStoreConfig()
+    : segmentSpanMs(60UL * 60UL * 1000UL)
+    , maxSegmentRows(64 * 1024)
+    , smallSegmentRows(16 * 1024)
+    , compactedSegmentRows(1024 * 1024)
+    , minCompactionInputs(4)
+{
+}
+
+SegmentQuery::SegmentQuery()
+    : deviceId(0)
+    , allDevices(true)
+    , channel(0)
+    , allChannels(true)
+    , fromMs(0)
+    , toMs(ULONG_MAX)
+    , minValue(-std::numeric_limits<float>::infinity())
+    , maxValue(std::numeric_limits<float>::infinity())
+{
+}
+
+// ============================================
+// Segment files
+// ============================================
+//
+// magic "RSEG0001"
+// u64 rows, u32 level
+// zone map: u64 minTimeMs, u64 maxTimeMs, per channel u64 rows, f32 min, f32 max
+// Bloom filter: u64 words, words x u64
+// replaced segment IDs: u64 count, count x u64
+// columns, rows sorted by (device, time, channel):
+//   rows x u32 deviceId, rows x u64 timeMs, rows x f32 value, rows x u8 channel
+
+/**
+ * A catalog entry: either still in memory (sealed, file being written) or
+ * a file. Immutable once in the catalog; a query holding a reference can
+ * keep reading it after compaction replaced it, and the file goes when the
+ * last reference does.
+ */
+struct SegmentStore::Segment {
+    SegmentInfo info;
+    std::string path;                 // empty while in memory
+    long columnsOffset;
+    std::vector<TraceSample> rows;    // only while in memory (unsorted)
+    std::vector<uint64_t> replaces;
+    std::atomic<bool> obsolete;
+    bool writing;                     // a seal is writing the file (catalog lock)
+
+    Segment() : columnsOffset(0), obsolete(false), writing(false) {}
+
+    ~Segment() {
+        if (obsolete.load() && !path.empty()) {
+            std::remove(path.c_str());
+        }
+    }
+
+    /**
+     * Rows [first, last) of a file segment
+     */
+    bool readRows(FILE* file, uint64_t first, uint64_t last, std::vector<TraceSample>& out) const;
+
+    /**
+     * First row whose device is not below deviceId (rows are device-sorted)
+     */
+    bool lowerBound(FILE* file, uint32_t deviceId, uint64_t& index) const;
+};
+
+namespace {
+
+bool readHeader(FILE* file, SegmentInfo& info, std::vector<uint64_t>& replaces) {
+    char magic[sizeof(kSegmentMagic)];
+    uint64_t rows = 0;
+    uint64_t minTimeMs = 0;
+    uint64_t maxTimeMs = 0;
+    bool ok = std::fread(magic, sizeof(magic), 1, file) == 1 &&
+              std::memcmp(magic, kSegmentMagic, sizeof(magic)) == 0 && readValue(file, rows) &&
+              readValue(file, info.level) && readValue(file, minTimeMs) && readValue(file, maxTimeMs);
+    info.zone.rows = rows;
+    info.zone.minTimeMs = static_cast<unsigned long>(minTimeMs);
+    info.zone.maxTimeMs = static_cast<unsigned long>(maxTimeMs);
+    for (int channel = 0; ok && channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        ok = readValue(file, info.zone.channelRows[channel]) && readValue(file, info.zone.minValue[channel]) &&
+             readValue(file, info.zone.maxValue[channel]);
+    }
+
+    uint64_t wordCount = 0;
+    ok = ok && readValue(file, wordCount) && wordCount > 0 && wordCount <= rows * SEGMENT_BLOOM_BITS_PER_DEVICE + 1;
+    std::vector<uint64_t> words(ok ? static_cast<size_t>(wordCount) : 0);
+    ok = ok && std::fread(words.data(), sizeof(uint64_t), words.size(), file) == words.size() &&
+         info.devices.assign(words);
+
+    uint64_t replacedCount = 0;
+    ok = ok && readValue(file, replacedCount) && replacedCount <= rows;
+    replaces.assign(ok ? static_cast<size_t>(replacedCount) : 0, 0);
+    ok = ok && (replaces.empty() ||
+                std::fread(replaces.data(), sizeof(uint64_t), replaces.size(), file) == replaces.size());
+    return ok;
+}
+
+// Write sorted rows as a segment: to a temporary name, then renamed into
+// place so a crash never leaves a partial segment under a real name
+bool writeSegment(const std::string& path, uint32_t level, const std::vector<TraceSample>& rows,
+                  const std::vector<uint64_t>& replaces, SegmentInfo& info, long& columnsOffset) {
+    info.level = level;
+    info.zone = SegmentZoneMap();
+    size_t devices = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        info.zone.add(rows[i]);
+        if (i == 0 || rows[i].deviceId != rows[i - 1].deviceId) {
+            devices++;
+        }
+    }
+    info.devices.reset(devices);
+    std::vector<uint32_t> deviceIds(rows.size());
+    std::vector<uint64_t> timesMs(rows.size());
+    std::vector<float> values(rows.size());
+    std::vector<uint8_t> channels(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        info.devices.add(rows[i].deviceId);
+        deviceIds[i] = rows[i].deviceId;
+        timesMs[i] = rows[i].timeMs;
+        values[i] = rows[i].value;
+        channels[i] = rows[i].channel;
+    }
+
+    std::string temp = path + kTempSuffix;
+    FILE* file = std::fopen(temp.c_str(), "wb");
+    if (file == NULL) {
+        return false;
+    }
+    const std::vector<uint64_t>& words = info.devices.getWords();
+    bool ok = std::fwrite(kSegmentMagic, sizeof(kSegmentMagic), 1, file) == 1 &&
+              writeValue(file, static_cast<uint64_t>(rows.size())) && writeValue(file, level) &&
+              writeValue(file, static_cast<uint64_t>(info.zone.minTimeMs)) &&
+              writeValue(file, static_cast<uint64_t>(info.zone.maxTimeMs));
+    for (int channel = 0; ok && channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        ok = writeValue(file, info.zone.channelRows[channel]) && writeValue(file, info.zone.minValue[channel]) &&
+             writeValue(file, info.zone.maxValue[channel]);
+    }
+    ok = ok && writeValue(file, static_cast<uint64_t>(words.size())) && writeColumn(file, words) &&
+         writeValue(file, static_cast<uint64_t>(replaces.size())) && writeColumn(file, replaces);
+    columnsOffset = ok ? std::ftell(file) : 0;
+    ok = ok && columnsOffset > 0 && writeColumn(file, deviceIds) && writeColumn(file, timesMs) &&
+         writeColumn(file, values) && writeColumn(file, channels);
+
+    ok = std::fclose(file) == 0 && ok && std::rename(temp.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        std::remove(temp.c_str());
+    }
+    return ok;
+}
+
+} // namespace
+
+bool SegmentStore::Segment::readRows(FILE* file, uint64_t first, uint64_t last, std::vector<TraceSample>& out) const {
+    uint64_t rows = info.zone.rows;
+    size_t count = static_cast<size_t>(last - first);
+    std::vector<uint32_t> deviceIds(count);
+    std::vector<uint64_t> timesMs(count);
+    std::vector<float> values(count);
+    std::vector<uint8_t> channels(count);
+    long base = columnsOffset;
+    bool ok = std::fseek(file, base + static_cast<long>(first * sizeof(uint32_t)), SEEK_SET) == 0 &&
+              std::fread(deviceIds.data(), sizeof(uint32_t), count, file) == count;
+    base += static_cast<long>(rows * sizeof(uint32_t));
+    ok = ok && std::fseek(file, base + static_cast<long>(first * sizeof(uint64_t)), SEEK_SET) == 0 &&
+         std::fread(timesMs.data(), sizeof(uint64_t), count, file) == count;
+    base += static_cast<long>(rows * sizeof(uint64_t));
+    ok = ok && std::fseek(file, base + static_cast<long>(first * sizeof(float)), SEEK_SET) == 0 &&
+         std::fread(values.data(), sizeof(float), count, file) == count;
+    base += static_cast<long>(rows * sizeof(float));
+    ok = ok && std::fseek(file, base + static_cast<long>(first), SEEK_SET) == 0 &&
+         std::fread(channels.data(), 1, count, file) == count;
+    if (!ok) {
+        return false;
+    }
+
+    out.reserve(out.size() + count);
+    for (size_t i = 0; i < count; ++i) {
+        TraceSample row;
+        row.deviceId = deviceIds[i];
+        row.timeMs = static_cast<unsigned long>(timesMs[i]);
+        row.value = values[i];
+        row.channel = channels[i];
+        out.push_back(row);
+    }
+    return true;
+}
+
+bool SegmentStore::Segment::lowerBound(FILE* file, uint32_t deviceId, uint64_t& index) const {
+    // Binary search reading single entries of the device column
+    uint64_t low = 0;
+    uint64_t high = info.zone.rows;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        uint32_t value = 0;
+        if (std::fseek(file, columnsOffset + static_cast<long>(middle * sizeof(uint32_t)), SEEK_SET) != 0 ||
+            !readValue(file, value)) {
+            return false;
+        }
+        if (value < deviceId) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    index = low;
+    return true;
+}
+
+// ============================================
+// SegmentStore
+// ============================================
+
+SegmentStore::SegmentStore(const std::string& directory, const SegmentStoreConfig& config)
+    : directory_(directory)
+    , config_(config)
+    , bufferSpan_(0)
+    , nextId_(1)
+    , compactionErrors_(0)
+    , sealErrors_(0)
+    , stopWorker_(false)
+{
+    if (config_.segmentSpanMs == 0) {
+        config_.segmentSpanMs = 1;
+    }
+    if (config_.maxSegmentRows == 0) {
+        config_.maxSegmentRows = 1;
+    }
+    if (config_.minCompactionInputs < 2) {
+        config_.minCompactionInputs = 2;
+    }
+}
+
+SegmentStore::~SegmentStore() {
+    stopCompaction();
+    flush();
+}
+
+std::string SegmentStore::pathFor(uint64_t id) const {
+    char name[sizeof(kSegmentPrefix) + kSegmentIdDigits + sizeof(kSegmentSuffix)];
+    std::snprintf(name, sizeof(name), "%s%016llx%s", kSegmentPrefix, static_cast<unsigned long long>(id),
+                  kSegmentSuffix);
+    return directory_ + "/" + name;
+}
+
+bool SegmentStore::open() {
+    std::lock_guard<std::mutex> guard(compactionMutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_.clear();
+    nextId_ = 1;
+
+    DIR* dir = opendir(directory_.c_str());
+    if (dir == NULL) {
+        return false;
+    }
+    std::vector<std::string> names;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        names.push_back(entry->d_name);
+    }
+    closedir(dir);
+
+    bool ok = true;
+    std::set<uint64_t> replaced;
+    for (size_t i = 0; i < names.size(); ++i) {
+        std::string path = directory_ + "/" + names[i];
+        uint64_t id = 0;
+        if (endsWith(names[i].c_str(), kTempSuffix)) {
+            std::remove(path.c_str());   // a write that never finished
+            continue;
+        }
+        if (!parseSegmentName(names[i].c_str(), id)) {
+            continue;
+        }
+
+        SegmentPtr segment(new Segment());
+        segment->path = path;
+        segment->info.id = id;
+        segment->info.persisted = true;
+        FILE* file = std::fopen(path.c_str(), "rb");
+        bool read = file != NULL && readHeader(file, segment->info, segment->replaces);
+        if (read) {
+            segment->columnsOffset = std::ftell(file);
+        }
+        if (file != NULL) {
+            std::fclose(file);
+        }
+        if (!read) {
+            ok = false;
+            continue;
+        }
+        replaced.insert(segment->replaces.begin(), segment->replaces.end());
+        segments_.push_back(segment);
+        nextId_ = std::max(nextId_, id + 1);
+    }
+
+    // Compaction inputs whose output was written before a crash
+    std::vector<SegmentPtr> kept;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        if (replaced.count(segments_[i]->info.id) != 0) {
+            segments_[i]->obsolete.store(true);
+        } else {
+            kept.push_back(segments_[i]);
+        }
+    }
+    segments_.swap(kept);
+    std::sort(segments_.begin(), segments_.end(), [](const SegmentPtr& a, const SegmentPtr& b) {
+        return a->info.id < b->info.id;
+    });
+    return ok;
+}
+
+bool SegmentStore::append(const TraceSample& sample) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    unsigned long span = sample.timeMs / config_.segmentSpanMs;
+    bool ok = true;
+    // Late readings join the open segment; its zone map still bounds them
+    if (!buffer_.empty() && span > bufferSpan_) {
+        ok = seal(lock);
+    }
+    if (buffer_.empty() || span > bufferSpan_) {
+        bufferSpan_ = span;
+    }
+    buffer_.push_back(sample);
+    bufferZone_.add(sample);
+    if (buffer_.size() >= config_.maxSegmentRows) {
+        ok = seal(lock) && ok;
+    }
+    return ok;
+}
+
+bool SegmentStore::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return seal(lock);
+}
+
+bool SegmentStore::seal(std::unique_lock<std::mutex>& lock) {
+    if (!buffer_.empty()) {
+        // Publish the rows in memory at once, so queries never miss them...
+        SegmentPtr pending(new Segment());
+        pending->info.id = nextId_++;
+        pending->info.level = 0;
+        pending->info.persisted = false;
+        pending->info.zone = bufferZone_;
+        pending->rows.swap(buffer_);
+        bufferZone_ = SegmentZoneMap();
+        segments_.push_back(pending);
+    }
+
+    // ...and write them, along with any whose earlier write failed
+    std::vector<SegmentPtr> unwritten;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        if (!segments_[i]->info.persisted && !segments_[i]->writing) {
+            segments_[i]->writing = true;
+            unwritten.push_back(segments_[i]);
+        }
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < unwritten.size(); ++i) {
+        const SegmentPtr& pending = unwritten[i];
+
+        // Sort and write without holding up ingestion
+        lock.unlock();
+        std::vector<TraceSample> rows(pending->rows);
+        std::sort(rows.begin(), rows.end(), rowBefore);
+        SegmentPtr written(new Segment());
+        written->info.id = pending->info.id;
+        written->info.persisted = true;
+        written->path = pathFor(written->info.id);
+        bool wrote = writeSegment(written->path, 0, rows, written->replaces, written->info, written->columnsOffset);
+        lock.lock();
+
+        pending->writing = false;
+        if (!wrote) {
+            sealErrors_++;
+            ok = false;     // the rows stay queryable in memory until a later seal writes them
+            continue;
+        }
+        std::vector<SegmentPtr>::iterator it = std::find(segments_.begin(), segments_.end(), pending);
+        if (it != segments_.end()) {
+            *it = written;
+        }
+    }
+    return ok;
+}
+
+size_t SegmentStore::compact() {
+    std::lock_guard<std::mutex> guard(compactionMutex_);
+
+    // Oldest small segments, up to one compacted segment's worth of rows
+    std::vector<SegmentPtr> inputs;
+    uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t rows = 0;
+        for (size_t i = 0; i < segments_.size() && rows < config_.compactedSegmentRows; ++i) {
+            const SegmentPtr& segment = segments_[i];
+            if (segment->info.persisted && segment->info.zone.rows < config_.smallSegmentRows) {
+                inputs.push_back(segment);
+                rows += segment->info.zone.rows;
+            }
+        }
+        if (inputs.size() < config_.minCompactionInputs) {
+            return 0;
+        }
+        id = nextId_++;
+    }
+
+    // Each input is sorted; k-way merge them
+    std::vector<std::vector<TraceSample> > runs(inputs.size());
+    bool ok = true;
+    for (size_t i = 0; ok && i < inputs.size(); ++i) {
+        FILE* file = std::fopen(inputs[i]->path.c_str(), "rb");
+        ok = file != NULL && inputs[i]->readRows(file, 0, inputs[i]->info.zone.rows, runs[i]);
+        if (file != NULL) {
+            std::fclose(file);
+        }
+    }
+
+    SegmentPtr output(new Segment());
+    if (ok) {
+        size_t total = 0;
+        for (size_t i = 0; i < runs.size(); ++i) {
+            total += runs[i].size();
+        }
+        std::vector<TraceSample> merged;
+        merged.reserve(total);
+        std::vector<size_t> positions(runs.size(), 0);
+        std::vector<size_t> heap;
+        auto after = [&](size_t a, size_t b) {
+            return rowBefore(runs[b][positions[b]], runs[a][positions[a]]);
+        };
+        for (size_t i = 0; i < runs.size(); ++i) {
+            if (!runs[i].empty()) {
+                heap.push_back(i);
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), after);
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), after);
+            size_t run = heap.back();
+            merged.push_back(runs[run][positions[run]++]);
+            if (positions[run] < runs[run].size()) {
+                std::push_heap(heap.begin(), heap.end(), after);
+            } else {
+                heap.pop_back();
+            }
+        }
+
+        output->info.id = id;
+        output->info.persisted = true;
+        output->path = pathFor(id);
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            output->replaces.push_back(inputs[i]->info.id);
+        }
+        ok = writeSegment(output->path, 1, merged, output->replaces, output->info, output->columnsOffset);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok) {
+        compactionErrors_++;
+        return 0;
+    }
+    // Only compaction removes persisted segments, so every input is still here
+    std::vector<SegmentPtr> kept;
+    kept.reserve(segments_.size() - inputs.size() + 1);
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        if (std::find(inputs.begin(), inputs.end(), segments_[i]) == inputs.end()) {
+            kept.push_back(segments_[i]);
+        }
+    }
+    // The output's ID is newer than any segment sealed since the inputs
+    kept.push_back(output);
+    std::sort(kept.begin(), kept.end(), [](const SegmentPtr& a, const SegmentPtr& b) {
+        return a->info.id < b->info.id;
+    });
+    segments_.swap(kept);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        inputs[i]->obsolete.store(true);
+    }
+    return inputs.size();
+}
+
+void SegmentStore::startCompaction(unsigned long intervalMs) {
+    std::lock_guard<std::mutex> lock(workerMutex_);
+    if (worker_.joinable()) {
+        return;
+    }
+    stopWorker_ = false;
+    worker_ = std::thread([this, intervalMs]() {
+        std::unique_lock<std::mutex> lock(workerMutex_);
+        while (!stopWorker_) {
+            size_t merged;
+            do {
+                lock.unlock();
+                merged = compact();
+                lock.lock();
+            } while (merged > 0 && !stopWorker_);
+            workerWake_.wait_for(lock, std::chrono::milliseconds(intervalMs), [this]() { return stopWorker_; });
+        }
+    });
+}
+
+void SegmentStore::stopCompaction() {
+    std::thread worker;
+    {
+        std::lock_guard<std::mutex> lock(workerMutex_);
+        stopWorker_ = true;
+        worker.swap(worker_);
+    }
+    workerWake_.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+size_t SegmentStore::query(const SegmentQuery& query, std::vector<TraceSample>& out, SegmentScanStats* stats) const {
+    SegmentScanStats scan;
+    std::memset(&scan, 0, sizeof(scan));
+    size_t start = out.size();
+
+    std::vector<SegmentPtr> segments;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        segments = segments_;
+        for (size_t i = 0; i < buffer_.size(); ++i) {
+            if (matches(query, buffer_[i])) {
+                out.push_back(buffer_[i]);
+            }
+        }
+    }
+    scan.segments = segments.size();
+
+    std::vector<TraceSample> rows;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const Segment& segment = *segments[i];
+        if (!segment.info.zone.overlapsTime(query.fromMs, query.toMs)) {
+            scan.skippedByTime++;
+            continue;
+        }
+        if (!query.allChannels && !segment.info.zone.overlapsValue(query.channel, query.minValue, query.maxValue)) {
+            scan.skippedByValue++;
+            continue;
+        }
+        if (!query.allDevices && segment.info.persisted && !segment.info.devices.mayContain(query.deviceId)) {
+            scan.skippedByDevice++;
+            continue;
+        }
+        scan.scanned++;
+
+        if (!segment.info.persisted) {
+            scan.rowsRead += segment.rows.size();
+            for (size_t r = 0; r < segment.rows.size(); ++r) {
+                if (matches(query, segment.rows[r])) {
+                    out.push_back(segment.rows[r]);
+                }
+            }
+            continue;
+        }
+
+        FILE* file = std::fopen(segment.path.c_str(), "rb");
+        if (file == NULL) {
+            continue;
+        }
+        uint64_t first = 0;
+        uint64_t last = segment.info.zone.rows;
+        bool ok = true;
+        if (!query.allDevices) {
+            ok = segment.lowerBound(file, query.deviceId, first) &&
+                 (query.deviceId == UINT32_MAX || segment.lowerBound(file, query.deviceId + 1, last));
+        }
+        rows.clear();
+        ok = ok && (first >= last || segment.readRows(file, first, last, rows));
+        std::fclose(file);
+        if (!ok) {
+            continue;
+        }
+        scan.rowsRead += rows.size();
+        for (size_t r = 0; r < rows.size(); ++r) {
+            if (matches(query, rows[r])) {
+                out.push_back(rows[r]);
+            }
+        }
+    }
+
+    std::sort(out.begin() + start, out.end(), rowBefore);
+    if (stats != NULL) {
+        *stats = scan;
+    }
+    return out.size() - start;
+}
+
+void SegmentStore::getSegments(std::vector<SegmentInfo>& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out.clear();
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        out.push_back(segments_[i]->info);
+    }
+}
+
+size_t SegmentStore::getSegmentCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.size();
+}
+
+size_t SegmentStore::getBufferedRows() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return buffer_.size();
+}
+
+unsigned long SegmentStore::getCompactionErrors() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return compactionErrors_;
+}
+
+unsigned long SegmentStore::getSealErrors() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sealErrors_;
+}
+
+size_t SegmentStore::getUnwrittenSegments() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        if (!segments_[i]->info.persisted) {
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,266 @@
+#include "socket_frame.h"
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const size_t kFrameHeader = sizeof(uint32_t) + 1;
+const size_t kReceiveChunk = 64 * 1024;
+
+bool fillAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool writeAll(int fd, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::send(fd, data, length, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool readAll(int fd, uint8_t* data, size_t length, unsigned long timeoutMs) {
+    while (length > 0) {
+        pollfd entry = { fd, POLLIN, 0 };
+        int ready = ::poll(&entry, 1, static_cast<int>(timeoutMs));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return false;
+        }
+        ssize_t received = ::recv(fd, data, length, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        length -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<uint8_t> beginFrame(uint8_t type) {
+    std::vector<uint8_t> frame(sizeof(uint32_t), 0);
+    frame.push_back(type);
+    return frame;
+}
+
+void finishFrame(std::vector<uint8_t>& frame) {
+    uint32_t length = static_cast<uint32_t>(frame.size() - sizeof(uint32_t));
+    std::memcpy(&frame[0], &length, sizeof(length));
+}
+
+bool getFlag(const uint8_t*& p, const uint8_t* end, bool& flag) {
+    uint8_t byte = 0;
+    if (!getValue(p, end, byte)) {
+        return false;
+    }
+    flag = byte != 0;
+    return true;
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void putSignedVarint(std::vector<uint8_t>& out, int64_t value) {
+    putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+bool getSignedVarint(const uint8_t*& p, const uint8_t* end, int64_t& value) {
+    uint64_t zigzag = 0;
+    if (!getVarint(p, end, zigzag)) {
+        return false;
+    }
+    value = static_cast<int64_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+    return true;
+}
+
+int connectFrameSocket(const std::string& path, unsigned long timeoutMs) {
+    sockaddr_un address;
+    if (!fillAddress(path, address)) {
+        return -1;
+    }
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+            return fd;
+        }
+        int error = errno;
+        ::close(fd);
+        if ((error != ENOENT && error != ECONNREFUSED && error != EINTR) ||
+            std::chrono::steady_clock::now() >= deadline) {
+            return -1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+int listenFrameSocket(const std::string& path) {
+    sockaddr_un address;
+    if (!fillAddress(path, address)) {
+        return -1;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 64) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool writeFrame(int fd, const std::vector<uint8_t>& frame) {
+    return writeAll(fd, frame.data(), frame.size());
+}
+
+bool setNonBlocking(int fd) {
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool readFrame(int fd, uint8_t& type, std::vector<uint8_t>& payload, unsigned long timeoutMs) {
+    uint32_t length = 0;
+    if (!readAll(fd, reinterpret_cast<uint8_t*>(&length), sizeof(length), timeoutMs) || length == 0 ||
+        length > SOCKET_FRAME_MAX_BYTES) {
+        return false;
+    }
+    payload.resize(length);
+    if (!readAll(fd, payload.data(), length, timeoutMs)) {
+        return false;
+    }
+    type = payload[0];
+    payload.erase(payload.begin());
+    return true;
+}
+
+// ============================================
+// FrameReader
+// ============================================
+
+FrameReader::FrameReader()
+    : consumed_(0)
+    , corrupt_(false)
+{
+}
+
+bool FrameReader::receive(int fd) {
+    buffer_.erase(buffer_.begin(), buffer_.begin() + consumed_);
+    consumed_ = 0;
+    size_t used = buffer_.size();
+    buffer_.resize(used + kReceiveChunk);
+    ssize_t received;
+    do {
+        received = ::recv(fd, &buffer_[used], kReceiveChunk, 0);
+    } while (received < 0 && errno == EINTR);
+    buffer_.resize(used + (received > 0 ? static_cast<size_t>(received) : 0));
+    return received > 0;
+}
+
+bool FrameReader::next(uint8_t& type, const uint8_t*& payload, size_t& length) {
+    if (corrupt_ || buffer_.size() - consumed_ < kFrameHeader) {
+        return false;
+    }
+    uint32_t frameLength = 0;
+    std::memcpy(&frameLength, &buffer_[consumed_], sizeof(frameLength));
+    if (frameLength == 0 || frameLength > SOCKET_FRAME_MAX_BYTES) {
+        corrupt_ = true;
+        return false;
+    }
+    if (buffer_.size() - consumed_ < sizeof(frameLength) + frameLength) {
+        return false;
+    }
+    const uint8_t* frame = &buffer_[consumed_ + sizeof(frameLength)];
+    type = frame[0];
+    payload = frame + 1;
+    length = frameLength - 1;
+    consumed_ += sizeof(frameLength) + frameLength;
+    return true;
+}
+
+// ============================================
+// FrameWriter
+// ============================================
+
+FrameWriter::FrameWriter()
+    : sent_(0)
+{
+}
+
+void FrameWriter::queue(const std::vector<uint8_t>& frame) {
+    buffer_.insert(buffer_.end(), frame.begin(), frame.end());
+}
+
+bool FrameWriter::flush(int fd) {
+    while (sent_ < buffer_.size()) {
+        ssize_t written = ::send(fd, &buffer_[sent_], buffer_.size() - sent_, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        sent_ += static_cast<size_t>(written);
+    }
+
+    // Drop what was sent once it outweighs what is left
+    if (sent_ == buffer_.size()) {
+        buffer_.clear();
+        sent_ = 0;
+    } else if (sent_ >= buffer_.size() - sent_) {
+        buffer_.erase(buffer_.begin(), buffer_.begin() + sent_);
+        sent_ = 0;
+    }
+    return true;
+}
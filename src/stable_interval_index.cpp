@@ -0,0 +1,443 @@
+#include "stable_interval_index.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char kIndexMagic[8] = { 'S', 'I', 'D', 'X', '0', '0', '0', '2' };
+const uint64_t kSavedOpen = 0xFFFFFFFFFFFFFFFFULL;
+
+bool endsAfter(const StableInterval& interval, unsigned long timeMs) {
+    return interval.endMs > timeMs;
+}
+
+bool startsAfter(unsigned long timeMs, const StableInterval& interval) {
+    return timeMs < interval.startMs;
+}
+
+bool segmentStartsAfter(unsigned long timeMs, const StableSegment& segment) {
+    return timeMs < segment.startMs;
+}
+
+bool segmentStartsBefore(const StableSegment& segment, unsigned long timeMs) {
+    return segment.startMs < timeMs;
+}
+
+template<typename T>
+bool writeValue(FILE* file, const T& value) {
+    return std::fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+template<typename T>
+bool readValue(FILE* file, T& value) {
+    return std::fread(&value, sizeof(value), 1, file) == 1;
+}
+
+} // namespace
+
+// ============================================
+// StableIntervalRun
+// ============================================
+
+StableIntervalRun::StableIntervalRun()
+    : prefixMs_(1, 0)
+    , leaves_(0)
+    , lastSeenMs_(0)
+{
+}
+
+void StableIntervalRun::open(unsigned long startMs, float value) {
+    if (isOpen()) {
+        close(startMs);
+    }
+    if (!intervals_.empty() && startMs < intervals_.back().endMs) {
+        return;  // out of order; runs only grow forward in time
+    }
+
+    StableInterval interval;
+    interval.startMs = startMs;
+    interval.endMs = STABLE_INTERVAL_OPEN;
+    interval.minValue = value;
+    interval.maxValue = value;
+    intervals_.push_back(interval);
+    lastSeenMs_ = std::max(lastSeenMs_, startMs);
+    addSegment(startMs, value);
+}
+
+void StableIntervalRun::extend(float value, unsigned long timeMs) {
+    if (!isOpen()) {
+        return;
+    }
+    StableInterval& interval = intervals_.back();
+    interval.minValue = std::min(interval.minValue, value);
+    interval.maxValue = std::max(interval.maxValue, value);
+    lastSeenMs_ = std::max(lastSeenMs_, timeMs);
+    if (value != segments_.back().value) {
+        addSegment(std::max(timeMs, segments_.back().startMs), value);
+    }
+}
+
+void StableIntervalRun::close(unsigned long endMs) {
+    if (!isOpen()) {
+        return;
+    }
+    StableInterval& interval = intervals_.back();
+    interval.endMs = std::max(endMs, interval.startMs);
+    prefixMs_.push_back(prefixMs_.back() + (interval.endMs - interval.startMs));
+    lastSeenMs_ = std::max(lastSeenMs_, interval.endMs);
+
+    // Readings that start at the end were never in force
+    while (!segments_.empty() && segments_.back().startMs >= interval.endMs) {
+        segments_.pop_back();
+        updateLeaf(segments_.size());
+    }
+}
+
+bool StableIntervalRun::append(const StableInterval& interval, const StableSegment* segments,
+                               size_t segmentCount) {
+    if (isOpen() || (!intervals_.empty() && interval.startMs < intervals_.back().endMs) ||
+        interval.endMs < interval.startMs) {
+        return false;
+    }
+    for (size_t i = 0; i < segmentCount; ++i) {
+        unsigned long previousMs = i > 0 ? segments[i - 1].startMs : interval.startMs;
+        if (segments[i].startMs < previousMs || segments[i].startMs >= interval.endMs ||
+            (i == 0 && segments[i].startMs != interval.startMs)) {
+            return false;
+        }
+    }
+    intervals_.push_back(interval);
+    if (interval.endMs != STABLE_INTERVAL_OPEN) {
+        prefixMs_.push_back(prefixMs_.back() + (interval.endMs - interval.startMs));
+        lastSeenMs_ = std::max(lastSeenMs_, interval.endMs);
+    } else {
+        lastSeenMs_ = std::max(lastSeenMs_, interval.startMs);
+    }
+    if (segmentCount > 0) {
+        for (size_t i = 0; i < segmentCount; ++i) {
+            addSegment(segments[i].startMs, segments[i].value);
+        }
+    } else if (interval.endMs > interval.startMs) {
+        addSegment(interval.startMs, interval.minValue);
+        if (interval.maxValue != interval.minValue) {
+            addSegment(interval.startMs, interval.maxValue);
+        }
+    }
+    return true;
+}
+
+bool StableIntervalRun::stab(unsigned long timeMs, StableInterval& interval) const {
+    // Last interval starting at or before timeMs
+    std::vector<StableInterval>::const_iterator it =
+        std::upper_bound(intervals_.begin(), intervals_.end(), timeMs, startsAfter);
+    if (it == intervals_.begin()) {
+        return false;
+    }
+    --it;
+    if (it->endMs <= timeMs) {
+        return false;
+    }
+    interval = *it;
+    return true;
+}
+
+void StableIntervalRun::overlapping(unsigned long fromMs, unsigned long toMs, size_t& first, size_t& last) const {
+    // Disjoint intervals are sorted by both start and end
+    first = static_cast<size_t>(std::lower_bound(intervals_.begin(), intervals_.end(), fromMs,
+                                                 [](const StableInterval& interval, unsigned long timeMs) {
+                                                     return !endsAfter(interval, timeMs);
+                                                 }) - intervals_.begin());
+    last = static_cast<size_t>(std::upper_bound(intervals_.begin(), intervals_.end(), toMs, startsAfter) -
+                               intervals_.begin());
+    if (last < first) {
+        last = first;
+    }
+}
+
+bool StableIntervalRun::summarize(unsigned long fromMs, unsigned long toMs, StableIntervalSummary& summary) const {
+    size_t first;
+    size_t last;
+    overlapping(fromMs, toMs, first, last);
+    if (first == last) {
+        return false;
+    }
+
+    summary.intervals = last - first;
+    valueRange(fromMs, toMs, summary.minValue, summary.maxValue);
+
+    // Whole lengths from the prefix sums, then trim the two ends to the range
+    size_t closedCount = prefixMs_.size() - 1;
+    size_t closedLast = std::min(last, closedCount);
+    long long total = closedLast > first
+                          ? static_cast<long long>(prefixMs_[closedLast] - prefixMs_[first]) : 0;
+    if (last > closedCount) {
+        const StableInterval& open = intervals_.back();
+        total += static_cast<long long>(effectiveEnd(open) - open.startMs);
+    }
+    const StableInterval& head = intervals_[first];
+    if (head.startMs < fromMs) {
+        total -= static_cast<long long>(std::min(fromMs, effectiveEnd(head)) - head.startMs);
+    }
+    const StableInterval& tail = intervals_[last - 1];
+    unsigned long tailEnd = effectiveEnd(tail);
+    if (tailEnd > toMs) {
+        total -= static_cast<long long>(tailEnd - std::max(toMs, tail.startMs));
+    }
+    summary.stableMs = total > 0 ? static_cast<unsigned long>(total) : 0;
+    return true;
+}
+
+bool StableIntervalRun::valueRange(unsigned long fromMs, unsigned long toMs, float& minValue,
+                                   float& maxValue) const {
+    // Segments starting inside the range, plus the one in force at fromMs
+    // if the channel was stable then (with the segments sharing its start)
+    std::vector<StableSegment>::const_iterator lo =
+        std::upper_bound(segments_.begin(), segments_.end(), fromMs, segmentStartsAfter);
+    StableInterval containing;
+    if (lo != segments_.begin() && stab(fromMs, containing)) {
+        lo = std::lower_bound(segments_.begin(), lo, (lo - 1)->startMs, segmentStartsBefore);
+    }
+    std::vector<StableSegment>::const_iterator hi =
+        std::upper_bound(lo, segments_.end(), toMs, segmentStartsAfter);
+    rangeMinMax(static_cast<size_t>(lo - segments_.begin()), static_cast<size_t>(hi - segments_.begin()),
+                minValue, maxValue);
+    return lo < hi;
+}
+
+unsigned long StableIntervalRun::effectiveEnd(const StableInterval& interval) const {
+    if (interval.endMs != STABLE_INTERVAL_OPEN) {
+        return interval.endMs;
+    }
+    return std::max(lastSeenMs_, interval.startMs);
+}
+
+void StableIntervalRun::addSegment(unsigned long startMs, float value) {
+    StableSegment segment;
+    segment.startMs = startMs;
+    segment.value = value;
+    segments_.push_back(segment);
+    grow();
+    updateLeaf(segments_.size() - 1);
+}
+
+void StableIntervalRun::grow() {
+    if (segments_.size() <= leaves_) {
+        return;
+    }
+    size_t leaves = leaves_ ? leaves_ : 16;
+    while (leaves < segments_.size()) {
+        leaves *= 2;
+    }
+    leaves_ = leaves;
+    minTree_.assign(2 * leaves_, std::numeric_limits<float>::infinity());
+    maxTree_.assign(2 * leaves_, -std::numeric_limits<float>::infinity());
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        minTree_[leaves_ + i] = segments_[i].value;
+        maxTree_[leaves_ + i] = segments_[i].value;
+    }
+    for (size_t node = leaves_ - 1; node > 0; --node) {
+        minTree_[node] = std::min(minTree_[2 * node], minTree_[2 * node + 1]);
+        maxTree_[node] = std::max(maxTree_[2 * node], maxTree_[2 * node + 1]);
+    }
+}
+
+void StableIntervalRun::updateLeaf(size_t index) {
+    size_t node = leaves_ + index;
+    bool used = index < segments_.size();
+    minTree_[node] = used ? segments_[index].value : std::numeric_limits<float>::infinity();
+    maxTree_[node] = used ? segments_[index].value : -std::numeric_limits<float>::infinity();
+    for (node /= 2; node > 0; node /= 2) {
+        minTree_[node] = std::min(minTree_[2 * node], minTree_[2 * node + 1]);
+        maxTree_[node] = std::max(maxTree_[2 * node], maxTree_[2 * node + 1]);
+    }
+}
+
+void StableIntervalRun::rangeMinMax(size_t first, size_t last, float& minValue, float& maxValue) const {
+    minValue = std::numeric_limits<float>::infinity();
+    maxValue = -std::numeric_limits<float>::infinity();
+    for (size_t lo = first + leaves_, hi = last + leaves_; lo < hi; lo /= 2, hi /= 2) {
+        if (lo & 1) {
+            minValue = std::min(minValue, minTree_[lo]);
+            maxValue = std::max(maxValue, maxTree_[lo]);
+            ++lo;
+        }
+        if (hi & 1) {
+            --hi;
+            minValue = std::min(minValue, minTree_[hi]);
+            maxValue = std::max(maxValue, maxTree_[hi]);
+        }
+    }
+}
+
+// ============================================
+// StableIntervalIndex
+// ============================================
+
+StableIntervalIndex::StableIntervalIndex() {
+}
+
+void StableIntervalIndex::onTransition(const StabilityTransition& transition) {
+    StableIntervalRun& run = runs_[makeKey(transition.deviceId, transition.channel)];
+    if (transition.stable) {
+        run.open(transition.timeMs, transition.value);
+    } else {
+        run.close(transition.timeMs);
+    }
+}
+
+void StableIntervalIndex::onStableUpdate(const StabilityTransition& transition) {
+    std::map<uint64_t, StableIntervalRun>::iterator it = runs_.find(makeKey(transition.deviceId, transition.channel));
+    if (it != runs_.end()) {
+        it->second.extend(transition.value, transition.timeMs);
+    }
+}
+
+void StableIntervalIndex::finish() {
+    for (std::map<uint64_t, StableIntervalRun>::iterator it = runs_.begin(); it != runs_.end(); ++it) {
+        if (it->second.isOpen()) {
+            it->second.close(it->second.getLastSeenMs());
+        }
+    }
+}
+
+const StableIntervalRun* StableIntervalIndex::find(uint32_t deviceId, uint8_t channel) const {
+    std::map<uint64_t, StableIntervalRun>::const_iterator it = runs_.find(makeKey(deviceId, channel));
+    return it != runs_.end() ? &it->second : NULL;
+}
+
+bool StableIntervalIndex::stab(uint32_t deviceId, uint8_t channel, unsigned long timeMs,
+                               StableInterval& interval) const {
+    const StableIntervalRun* run = find(deviceId, channel);
+    return run != NULL && run->stab(timeMs, interval);
+}
+
+size_t StableIntervalIndex::overlapping(uint32_t deviceId, uint8_t channel, unsigned long fromMs,
+                                        unsigned long toMs, std::vector<StableInterval>& out) const {
+    const StableIntervalRun* run = find(deviceId, channel);
+    if (run == NULL) {
+        return 0;
+    }
+    size_t first;
+    size_t last;
+    run->overlapping(fromMs, toMs, first, last);
+    for (size_t i = first; i < last; ++i) {
+        out.push_back(run->at(i));
+    }
+    return last - first;
+}
+
+bool StableIntervalIndex::summarize(uint32_t deviceId, uint8_t channel, unsigned long fromMs, unsigned long toMs,
+                                    StableIntervalSummary& summary) const {
+    const StableIntervalRun* run = find(deviceId, channel);
+    return run != NULL && run->summarize(fromMs, toMs, summary);
+}
+
+bool StableIntervalIndex::wasStableBelow(uint32_t deviceId, uint8_t channel, unsigned long fromMs,
+                                         unsigned long toMs, float threshold) const {
+    const StableIntervalRun* run = find(deviceId, channel);
+    float minValue;
+    float maxValue;
+    return run != NULL && run->valueRange(fromMs, toMs, minValue, maxValue) && minValue < threshold;
+}
+
+bool StableIntervalIndex::wasStableAbove(uint32_t deviceId, uint8_t channel, unsigned long fromMs,
+                                         unsigned long toMs, float threshold) const {
+    const StableIntervalRun* run = find(deviceId, channel);
+    float minValue;
+    float maxValue;
+    return run != NULL && run->valueRange(fromMs, toMs, minValue, maxValue) && maxValue > threshold;
+}
+
+size_t StableIntervalIndex::getIntervalCount() const {
+    size_t count = 0;
+    for (std::map<uint64_t, StableIntervalRun>::const_iterator it = runs_.begin(); it != runs_.end(); ++it) {
+        count += it->second.size();
+    }
+    return count;
+}
+
+bool StableIntervalIndex::save(const char* path) const {
+    FILE* file = std::fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool ok = std::fwrite(kIndexMagic, sizeof(kIndexMagic), 1, file) == 1 &&
+              writeValue(file, static_cast<uint64_t>(runs_.size()));
+    for (std::map<uint64_t, StableIntervalRun>::const_iterator it = runs_.begin(); ok && it != runs_.end(); ++it) {
+        const StableIntervalRun& run = it->second;
+        ok = writeValue(file, it->first) &&
+             writeValue(file, static_cast<uint64_t>(run.getLastSeenMs())) &&
+             writeValue(file, static_cast<uint64_t>(run.size()));
+        size_t segment = 0;
+        for (size_t i = 0; ok && i < run.size(); ++i) {
+            const StableInterval& interval = run.at(i);
+            uint64_t endMs = interval.endMs == STABLE_INTERVAL_OPEN ? kSavedOpen : interval.endMs;
+            size_t segmentEnd = segment;
+            while (segmentEnd < run.segmentCount() && run.segmentAt(segmentEnd).startMs < interval.endMs) {
+                ++segmentEnd;
+            }
+            ok = writeValue(file, static_cast<uint64_t>(interval.startMs)) && writeValue(file, endMs) &&
+                 writeValue(file, interval.minValue) && writeValue(file, interval.maxValue) &&
+                 writeValue(file, static_cast<uint64_t>(segmentEnd - segment));
+            for (; ok && segment < segmentEnd; ++segment) {
+                const StableSegment& stored = run.segmentAt(segment);
+                ok = writeValue(file, static_cast<uint64_t>(stored.startMs)) && writeValue(file, stored.value);
+            }
+        }
+    }
+
+    return std::fclose(file) == 0 && ok;
+}
+
+bool StableIntervalIndex::load(const char* path) {
+    runs_.clear();
+    FILE* file = std::fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    char magic[sizeof(kIndexMagic)];
+    uint64_t runCount = 0;
+    bool ok = std::fread(magic, sizeof(magic), 1, file) == 1 &&
+              std::memcmp(magic, kIndexMagic, sizeof(magic)) == 0 && readValue(file, runCount);
+    for (uint64_t r = 0; ok && r < runCount; ++r) {
+        uint64_t key = 0;
+        uint64_t lastSeenMs = 0;
+        uint64_t count = 0;
+        ok = readValue(file, key) && readValue(file, lastSeenMs) && readValue(file, count);
+        StableIntervalRun& run = runs_[key];
+        std::vector<StableSegment> segments;
+        for (uint64_t i = 0; ok && i < count; ++i) {
+            uint64_t startMs = 0;
+            uint64_t endMs = 0;
+            uint64_t segmentCount = 0;
+            StableInterval interval;
+            ok = readValue(file, startMs) && readValue(file, endMs) && readValue(file, interval.minValue) &&
+                 readValue(file, interval.maxValue) && readValue(file, segmentCount);
+            interval.startMs = static_cast<unsigned long>(startMs);
+            interval.endMs = endMs == kSavedOpen ? STABLE_INTERVAL_OPEN : static_cast<unsigned long>(endMs);
+            segments.clear();
+            for (uint64_t k = 0; ok && k < segmentCount; ++k) {
+                uint64_t segmentMs = 0;
+                StableSegment segment;
+                ok = readValue(file, segmentMs) && readValue(file, segment.value);
+                segment.startMs = static_cast<unsigned long>(segmentMs);
+                segments.push_back(segment);
+            }
+            ok = ok && run.append(interval, segments.empty() ? NULL : &segments[0], segments.size());
+        }
+        if (ok && run.isOpen()) {
+            // Restore how far the open interval is known to extend
+            run.extend(run.segmentAt(run.segmentCount() - 1).value, static_cast<unsigned long>(lastSeenMs));
+        }
+    }
+
+    std::fclose(file);
+    if (!ok) {
+        runs_.clear();
+    }
+    return ok;
+}
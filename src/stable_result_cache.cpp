@@ -0,0 +1,379 @@
+#include "stable_result_cache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+uint64_t makeKey(uint32_t deviceId, uint8_t channel) {
+    // +1 keeps 0 free to mark empty slots
+    return ((static_cast<uint64_t>(deviceId) << 8) | channel) + 1;
+}
+
+// splitmix64 finalizer
+uint64_t mixKey(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    key ^= key >> 31;
+    return key;
+}
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+size_t latencyBucket(uint64_t nanoseconds) {
+    size_t bucket = 0;
+    uint64_t bound = 32;
+    while (nanoseconds > bound && bucket + 1 < STABLE_CACHE_LATENCY_BUCKETS) {
+        bound <<= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+} // namespace
+
+struct StableResultCache::Shard {
+    std::mutex mutex;            // serializes writers; readers never take it
+    Slot* slots;                 // setsPerShard_ * STABLE_CACHE_WAYS
+    uint8_t* hands;              // CLOCK hand per set
+    std::atomic<uint32_t>* epochs;   // per set, bumped under the lock by every write and invalidation
+    size_t entries;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> loads;
+    std::atomic<uint64_t> inserts;
+    std::atomic<uint64_t> evictions;
+    std::atomic<uint64_t> invalidations;
+    std::atomic<uint64_t> latency[STABLE_CACHE_LATENCY_BUCKETS];
+    std::atomic<uint64_t> latencySamples;
+    std::atomic<uint64_t> latencySumNs;
+
+    char padding[64];            // keep neighbouring shards' counters apart
+};
+
+StableResultCache::StableResultCache(size_t capacity, size_t shards, StableResultLoader* loader)
+    : shards_(NULL)
+    , shardCount_(roundUpToPowerOfTwo(shards ? shards : 1))
+    , setsPerShard_(0)
+    , loader_(loader)
+{
+    size_t sets = (capacity + STABLE_CACHE_WAYS - 1) / STABLE_CACHE_WAYS;
+    setsPerShard_ = roundUpToPowerOfTwo((sets + shardCount_ - 1) / shardCount_);
+
+    shards_ = new Shard[shardCount_];
+    for (size_t s = 0; s < shardCount_; ++s) {
+        Shard& shard = shards_[s];
+        size_t slotCount = setsPerShard_ * STABLE_CACHE_WAYS;
+        shard.slots = new Slot[slotCount];
+        for (size_t i = 0; i < slotCount; ++i) {
+            shard.slots[i].sequence.store(0, std::memory_order_relaxed);
+            shard.slots[i].valueBits.store(0, std::memory_order_relaxed);
+            shard.slots[i].key.store(0, std::memory_order_relaxed);
+            shard.slots[i].timeMs.store(0, std::memory_order_relaxed);
+            shard.slots[i].referenced.store(0, std::memory_order_relaxed);
+        }
+        shard.hands = new uint8_t[setsPerShard_];
+        std::memset(shard.hands, 0, setsPerShard_);
+        shard.epochs = new std::atomic<uint32_t>[setsPerShard_];
+        for (size_t i = 0; i < setsPerShard_; ++i) {
+            shard.epochs[i].store(0, std::memory_order_relaxed);
+        }
+        shard.entries = 0;
+
+        shard.hits.store(0, std::memory_order_relaxed);
+        shard.misses.store(0, std::memory_order_relaxed);
+        shard.loads.store(0, std::memory_order_relaxed);
+        shard.inserts.store(0, std::memory_order_relaxed);
+        shard.evictions.store(0, std::memory_order_relaxed);
+        shard.invalidations.store(0, std::memory_order_relaxed);
+        for (size_t b = 0; b < STABLE_CACHE_LATENCY_BUCKETS; ++b) {
+            shard.latency[b].store(0, std::memory_order_relaxed);
+        }
+        shard.latencySamples.store(0, std::memory_order_relaxed);
+        shard.latencySumNs.store(0, std::memory_order_relaxed);
+    }
+}
+
+StableResultCache::~StableResultCache() {
+    for (size_t s = 0; s < shardCount_; ++s) {
+        delete[] shards_[s].slots;
+        delete[] shards_[s].hands;
+        delete[] shards_[s].epochs;
+    }
+    delete[] shards_;
+}
+
+StableResultCache::Shard& StableResultCache::shardFor(uint64_t key, size_t& setIndex) const {
+    uint64_t hash = mixKey(key);
+    setIndex = static_cast<size_t>(hash >> 20) & (setsPerShard_ - 1);
+    return shards_[hash & (shardCount_ - 1)];
+}
+
+bool StableResultCache::read(Shard& shard, size_t setIndex, uint64_t key, StableResult& result) {
+    Slot* set = &shard.slots[setIndex * STABLE_CACHE_WAYS];
+    for (size_t way = 0; way < STABLE_CACHE_WAYS; ++way) {
+        Slot& slot = set[way];
+        for (;;) {
+            uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();  // writer mid-update (possibly preempted)
+                continue;
+            }
+            if (slot.key.load(std::memory_order_relaxed) != key) {
+                break;
+            }
+            uint32_t valueBits = slot.valueBits.load(std::memory_order_relaxed);
+            uint64_t timeMs = slot.timeMs.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != before) {
+                continue;  // raced a writer, read the slot again
+            }
+
+            // Only write the reference bit when it changes, to keep hot sets shared-clean
+            if (slot.referenced.load(std::memory_order_relaxed) == 0) {
+                slot.referenced.store(1, std::memory_order_relaxed);
+            }
+            result.value = bitsFloat(valueBits);
+            result.timeMs = static_cast<unsigned long>(timeMs);
+            return true;
+        }
+    }
+    return false;
+}
+
+void StableResultCache::write(Shard& shard, size_t setIndex, uint64_t key, float value, unsigned long timeMs) {
+    // Caller holds shard.mutex
+    Slot* set = &shard.slots[setIndex * STABLE_CACHE_WAYS];
+    Slot* target = NULL;
+    Slot* empty = NULL;
+    for (size_t way = 0; way < STABLE_CACHE_WAYS; ++way) {
+        uint64_t slotKey = set[way].key.load(std::memory_order_relaxed);
+        if (slotKey == key) {
+            target = &set[way];
+            break;
+        }
+        if (slotKey == 0 && empty == NULL) {
+            empty = &set[way];
+        }
+    }
+
+    bool fresh = false;
+    if (target != NULL) {
+        if (target->timeMs.load(std::memory_order_relaxed) > timeMs) {
+            return;  // a newer transition already landed
+        }
+    } else if (empty != NULL) {
+        target = empty;
+        fresh = true;
+        shard.entries++;
+    } else {
+        // CLOCK: give referenced entries a second chance. Readers may set bits
+        // again behind the hand, so stop after two sweeps.
+        uint8_t& hand = shard.hands[setIndex];
+        for (size_t step = 0; step < 2 * STABLE_CACHE_WAYS; ++step) {
+            if (set[hand].referenced.load(std::memory_order_relaxed) == 0) {
+                break;
+            }
+            set[hand].referenced.store(0, std::memory_order_relaxed);
+            hand = static_cast<uint8_t>((hand + 1) % STABLE_CACHE_WAYS);
+        }
+        target = &set[hand];
+        hand = static_cast<uint8_t>((hand + 1) % STABLE_CACHE_WAYS);
+        fresh = true;
+        shard.evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    shard.epochs[setIndex].store(shard.epochs[setIndex].load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_release);
+    uint32_t sequence = target->sequence.load(std::memory_order_relaxed);
+    target->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    target->key.store(key, std::memory_order_relaxed);
+    target->valueBits.store(floatBits(value), std::memory_order_relaxed);
+    target->timeMs.store(timeMs, std::memory_order_relaxed);
+    if (fresh) {
+        target->referenced.store(0, std::memory_order_relaxed);
+        shard.inserts.fetch_add(1, std::memory_order_relaxed);
+    }
+    target->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool StableResultCache::get(uint32_t deviceId, uint8_t channel, StableResult& result) {
+    uint64_t key = makeKey(deviceId, channel);
+    size_t setIndex;
+    Shard& shard = shardFor(key, setIndex);
+    bool hit = read(shard, setIndex, key, result);
+    (hit ? shard.hits : shard.misses).fetch_add(1, std::memory_order_relaxed);
+    return hit;
+}
+
+bool StableResultCache::lookup(uint32_t deviceId, uint8_t channel, StableResult& result) {
+    static thread_local uint32_t lookupCount = 0;
+    bool timed = (++lookupCount % STABLE_CACHE_LATENCY_SAMPLE_EVERY) == 0;
+    std::chrono::steady_clock::time_point start;
+    if (timed) {
+        start = std::chrono::steady_clock::now();
+    }
+
+    uint64_t key = makeKey(deviceId, channel);
+    size_t setIndex;
+    Shard& shard = shardFor(key, setIndex);
+    uint32_t epoch = shard.epochs[setIndex].load(std::memory_order_acquire);
+    bool found = read(shard, setIndex, key, result);
+    (found ? shard.hits : shard.misses).fetch_add(1, std::memory_order_relaxed);
+    if (!found && loader_ != NULL && loader_->load(deviceId, channel, result)) {
+        shard.loads.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.epochs[setIndex].load(std::memory_order_relaxed) == epoch) {
+            write(shard, setIndex, key, result.value, result.timeMs);
+        } else {
+            // A put() or beginSession() landed while the loader ran. Its state
+            // is newer than the loaded result, which is returned but not cached.
+            StableResult current;
+            if (read(shard, setIndex, key, current)) {
+                result = current;
+            }
+        }
+        found = true;
+    }
+
+    if (timed) {
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        shard.latency[latencyBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+        shard.latencySamples.fetch_add(1, std::memory_order_relaxed);
+        shard.latencySumNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+    return found;
+}
+
+void StableResultCache::put(uint32_t deviceId, uint8_t channel, float value, unsigned long timeMs) {
+    uint64_t key = makeKey(deviceId, channel);
+    size_t setIndex;
+    Shard& shard = shardFor(key, setIndex);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    write(shard, setIndex, key, value, timeMs);
+}
+
+void StableResultCache::beginSession(uint32_t deviceId) {
+    for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        uint64_t key = makeKey(deviceId, channel);
+        size_t setIndex;
+        Shard& shard = shardFor(key, setIndex);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        // Even with nothing cached, a lookup already loading the old session's value must not cache it
+        shard.epochs[setIndex].store(shard.epochs[setIndex].load(std::memory_order_relaxed) + 1,
+                                     std::memory_order_release);
+        Slot* set = &shard.slots[setIndex * STABLE_CACHE_WAYS];
+        for (size_t way = 0; way < STABLE_CACHE_WAYS; ++way) {
+            Slot& slot = set[way];
+            if (slot.key.load(std::memory_order_relaxed) != key) {
+                continue;
+            }
+            uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.key.store(0, std::memory_order_relaxed);
+            slot.referenced.store(0, std::memory_order_relaxed);
+            slot.sequence.store(sequence + 2, std::memory_order_release);
+            shard.entries--;
+            shard.invalidations.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+}
+
+void StableResultCache::onTransition(const StabilityTransition& transition) {
+    if (transition.stable) {
+        put(transition.deviceId, transition.channel, transition.value, transition.timeMs);
+    }
+}
+
+void StableResultCache::onStableUpdate(const StabilityTransition& transition) {
+    put(transition.deviceId, transition.channel, transition.value, transition.timeMs);
+}
+
+StableResultCacheMetrics StableResultCache::getMetrics() const {
+    StableResultCacheMetrics metrics;
+    std::memset(&metrics, 0, sizeof(metrics));
+    metrics.capacity = getCapacity();
+    for (size_t s = 0; s < shardCount_; ++s) {
+        Shard& shard = shards_[s];
+        metrics.hits += shard.hits.load(std::memory_order_relaxed);
+        metrics.misses += shard.misses.load(std::memory_order_relaxed);
+        metrics.loads += shard.loads.load(std::memory_order_relaxed);
+        metrics.inserts += shard.inserts.load(std::memory_order_relaxed);
+        metrics.evictions += shard.evictions.load(std::memory_order_relaxed);
+        metrics.invalidations += shard.invalidations.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < STABLE_CACHE_LATENCY_BUCKETS; ++b) {
+            metrics.latencyBuckets[b] += shard.latency[b].load(std::memory_order_relaxed);
+        }
+        metrics.latencySamples += shard.latencySamples.load(std::memory_order_relaxed);
+        metrics.latencySumNs += shard.latencySumNs.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            metrics.entries += shard.entries;
+        }
+    }
+    return metrics;
+}
+
+void StableResultCache::formatMetrics(const char* prefix, std::string& out) const {
+    StableResultCacheMetrics metrics = getMetrics();
+    char line[256];
+
+    const char* counterNames[] = { "hits", "misses", "loads", "inserts", "evictions", "invalidations" };
+    const uint64_t counterValues[] = { metrics.hits, metrics.misses, metrics.loads, metrics.inserts,
+                                       metrics.evictions, metrics.invalidations };
+    for (size_t i = 0; i < sizeof(counterValues) / sizeof(counterValues[0]); ++i) {
+        std::snprintf(line, sizeof(line), "# TYPE %s_%s_total counter\n%s_%s_total %llu\n", prefix,
+                      counterNames[i], prefix, counterNames[i], static_cast<unsigned long long>(counterValues[i]));
+        out += line;
+    }
+
+    std::snprintf(line, sizeof(line), "# TYPE %s_entries gauge\n%s_entries %llu\n# TYPE %s_capacity gauge\n"
+                                      "%s_capacity %llu\n# TYPE %s_hit_ratio gauge\n%s_hit_ratio %.6f\n",
+                  prefix, prefix, static_cast<unsigned long long>(metrics.entries), prefix, prefix,
+                  static_cast<unsigned long long>(metrics.capacity), prefix, prefix, metrics.getHitRate());
+    out += line;
+
+    std::snprintf(line, sizeof(line), "# TYPE %s_lookup_seconds histogram\n", prefix);
+    out += line;
+    uint64_t cumulative = 0;
+    for (size_t b = 0; b + 1 < STABLE_CACHE_LATENCY_BUCKETS; ++b) {
+        cumulative += metrics.latencyBuckets[b];
+        double bound = static_cast<double>(32ULL << b) * 1e-9;
+        std::snprintf(line, sizeof(line), "%s_lookup_seconds_bucket{le=\"%g\"} %llu\n", prefix, bound,
+                      static_cast<unsigned long long>(cumulative));
+        out += line;
+    }
+    std::snprintf(line, sizeof(line), "%s_lookup_seconds_bucket{le=\"+Inf\"} %llu\n%s_lookup_seconds_sum %.9f\n"
+                                      "%s_lookup_seconds_count %llu\n",
+                  prefix, static_cast<unsigned long long>(metrics.latencySamples), prefix,
+                  static_cast<double>(metrics.latencySumNs) * 1e-9, prefix,
+                  static_cast<unsigned long long>(metrics.latencySamples));
+    out += line;
+}
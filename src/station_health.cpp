@@ -0,0 +1,324 @@
+#include "station_health.h"
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const char* kReasonNames[] = { "ok", "reset-rate", "dropouts", "time-to-stable" };
+
+// Quarter-octave severity buckets: bucket b holds 2^(b/4) <= severity < 2^((b+1)/4)
+const float kBucketsPerOctave = 4.0f;
+
+bool moreSevere(const StationHealthSnapshot& a, const StationHealthSnapshot& b) {
+    if (a.severity != b.severity) {
+        return a.severity > b.severity;
+    }
+    return a.stationId < b.stationId;
+}
+
+} // namespace
+
+// ============================================
+// StationHealthConfig
+// ============================================
+
+StationHealthConfig::StationHealthConfig()
+    : halfLifeMs(30UL * 60UL * 1000UL)
+    , maxResetRate(0.2f)
+    , maxDropoutRatio(0.1f)
+    , maxTimeToStableDrift(0.5f)
+    , minSamples(20.0f)
+    , minStableSessions(5)
+    , recentWeight(0.25f)
+    , baselineWeight(0.02f)
+    , maxHeightCm(HEIGHT_MAX_DISTANCE_CM)
+    , staleMs(2UL * 60UL * 60UL * 1000UL)
+{
+}
+
+// ============================================
+// StationHealthModel
+// ============================================
+
+StationHealthModel::StationHealthModel(const StationHealthConfig& config, size_t expectedStations)
+    : config_(config)
+    , alertCount_(0)
+{
+    if (config_.halfLifeMs == 0) {
+        config_.halfLifeMs = 1;
+    }
+    stations_.reserve(expectedStations);
+    slots_.reserve(expectedStations);
+    for (int b = 0; b < kBucketCount; ++b) {
+        buckets_[b] = kNone;
+    }
+}
+
+void StationHealthModel::onDebounceEvent(const DebounceEvent& event) {
+    if (event.channel >= SAMPLE_CHANNEL_COUNT) {
+        return;
+    }
+    uint32_t slot = slotFor(event.deviceId);
+    Station& station = stations_[slot];
+    station.lastEventMs = event.timeMs;
+    if (event.type == DEBOUNCE_EVENT_SKIPPED) {
+        return;   // the debouncer never looked at it
+    }
+
+    ChannelHealth& channel = station.channels[event.channel];
+    if (channel.samples > 0.0f && event.timeMs > channel.lastMs && event.timeMs - channel.lastMs >= config_.staleMs) {
+        std::memset(&channel, 0, sizeof(channel));   // back after going silent; the old figures no longer apply
+    }
+    decay(channel, event.timeMs);
+    channel.samples += 1.0f;
+
+    uint8_t type = event.type;
+    if (isDropout(event.channel, event.value)) {
+        type = DEBOUNCE_EVENT_INVALID_RESET;
+    } else if (type == DEBOUNCE_EVENT_TOLERANCE_RESET && channel.droppedOut) {
+        type = DEBOUNCE_EVENT_FIRST_READING;   // back from a dropout the debouncer took as a reading
+    }
+    channel.droppedOut = type == DEBOUNCE_EVENT_INVALID_RESET;
+
+    switch (type) {
+    case DEBOUNCE_EVENT_INVALID_RESET:
+        channel.dropouts += 1.0f;
+        channel.attempting = false;   // the patient left or the sensor lost them
+        break;
+    case DEBOUNCE_EVENT_FIRST_READING:
+        channel.accepted += 1.0f;
+        channel.attempting = true;
+        channel.attemptStartMs = event.timeMs;
+        break;
+    case DEBOUNCE_EVENT_TOLERANCE_RESET:
+        channel.accepted += 1.0f;
+        channel.resets += 1.0f;
+        if (!channel.attempting) {
+            channel.attempting = true;   // a stable reading broke; time the next one
+            channel.attemptStartMs = event.timeMs;
+        }
+        break;
+    case DEBOUNCE_EVENT_STABLE:
+        channel.accepted += 1.0f;
+        if (channel.attempting) {
+            float timeToStable = static_cast<float>(event.timeMs - channel.attemptStartMs);
+            if (channel.stableSessions == 0) {
+                channel.recentTimeToStableMs = timeToStable;
+                channel.baselineTimeToStableMs = timeToStable;
+            } else {
+                channel.recentTimeToStableMs += config_.recentWeight * (timeToStable - channel.recentTimeToStableMs);
+                channel.baselineTimeToStableMs +=
+                    config_.baselineWeight * (timeToStable - channel.baselineTimeToStableMs);
+            }
+            channel.stableSessions++;
+            channel.attempting = false;
+        }
+        break;
+    default:
+        channel.accepted += 1.0f;
+        break;
+    }
+
+    rescore(slot, event.timeMs);
+}
+
+bool StationHealthModel::getHealth(uint32_t stationId, StationHealthSnapshot& out) const {
+    std::unordered_map<uint32_t, uint32_t>::const_iterator it = slots_.find(stationId);
+    if (it == slots_.end()) {
+        return false;
+    }
+    fillSnapshot(stations_[it->second], out);
+    return true;
+}
+
+size_t StationHealthModel::getAlerts(std::vector<StationHealthSnapshot>& out, size_t limit) const {
+    out.clear();
+    if (limit == 0) {
+        return 0;
+    }
+    // Whole buckets from the top until there are enough; only those are sorted
+    for (int b = kBucketCount - 1; b >= 0 && out.size() < limit; --b) {
+        for (uint32_t slot = buckets_[b]; slot != kNone; slot = stations_[slot].next) {
+            StationHealthSnapshot snapshot;
+            fillSnapshot(stations_[slot], snapshot);
+            out.push_back(snapshot);
+        }
+    }
+    std::sort(out.begin(), out.end(), moreSevere);
+    if (out.size() > limit) {
+        out.resize(limit);
+    }
+    return out.size();
+}
+
+size_t StationHealthModel::expire(unsigned long nowMs) {
+    std::vector<uint32_t> alerting;
+    alerting.reserve(alertCount_);
+    for (int b = 0; b < kBucketCount; ++b) {
+        for (uint32_t slot = buckets_[b]; slot != kNone; slot = stations_[slot].next) {
+            alerting.push_back(slot);
+        }
+    }
+    size_t before = alertCount_;
+    for (size_t i = 0; i < alerting.size(); ++i) {
+        rescore(alerting[i], nowMs);
+    }
+    return before - alertCount_;
+}
+
+uint32_t StationHealthModel::slotFor(uint32_t stationId) {
+    std::pair<std::unordered_map<uint32_t, uint32_t>::iterator, bool> inserted =
+        slots_.insert(std::make_pair(stationId, static_cast<uint32_t>(stations_.size())));
+    if (inserted.second) {
+        Station station;
+        std::memset(&station, 0, sizeof(station));
+        station.id = stationId;
+        station.prev = kNone;
+        station.next = kNone;
+        station.bucket = -1;
+        stations_.push_back(station);
+    }
+    return inserted.first->second;
+}
+
+void StationHealthModel::decay(ChannelHealth& channel, unsigned long timeMs) const {
+    if (channel.samples > 0.0f && timeMs > channel.lastMs) {
+        float factor = std::exp2(-static_cast<float>(timeMs - channel.lastMs) / static_cast<float>(config_.halfLifeMs));
+        channel.samples *= factor;
+        channel.accepted *= factor;
+        channel.resets *= factor;
+        channel.dropouts *= factor;
+    }
+    channel.lastMs = timeMs;
+}
+
+bool StationHealthModel::isDropout(uint8_t channel, float value) const {
+    return channel == CHANNEL_HEIGHT && !(value > 0.0f && value <= config_.maxHeightCm);
+}
+
+float StationHealthModel::resetRate(const ChannelHealth& channel) const {
+    return channel.accepted >= config_.minSamples ? channel.resets / channel.accepted : 0.0f;
+}
+
+float StationHealthModel::dropoutRatio(const ChannelHealth& channel) const {
+    return channel.samples >= config_.minSamples ? channel.dropouts / channel.samples : 0.0f;
+}
+
+float StationHealthModel::timeToStableDrift(const ChannelHealth& channel) const {
+    if (channel.stableSessions < config_.minStableSessions || channel.baselineTimeToStableMs <= 0.0f) {
+        return 0.0f;
+    }
+    return (channel.recentTimeToStableMs - channel.baselineTimeToStableMs) / channel.baselineTimeToStableMs;
+}
+
+float StationHealthModel::channelSeverity(const ChannelHealth& channel, uint8_t& reason) const {
+    float severity = 0.0f;
+    reason = STATION_HEALTH_OK;
+
+    float resets = config_.maxResetRate > 0.0f ? resetRate(channel) / config_.maxResetRate : 0.0f;
+    if (resets > severity) {
+        severity = resets;
+        reason = STATION_HEALTH_RESET_RATE;
+    }
+    float dropouts = config_.maxDropoutRatio > 0.0f ? dropoutRatio(channel) / config_.maxDropoutRatio : 0.0f;
+    if (dropouts > severity) {
+        severity = dropouts;
+        reason = STATION_HEALTH_DROPOUTS;
+    }
+    float drift = config_.maxTimeToStableDrift > 0.0f ? timeToStableDrift(channel) / config_.maxTimeToStableDrift
+                                                      : 0.0f;
+    if (drift > severity) {
+        severity = drift;
+        reason = STATION_HEALTH_TIME_TO_STABLE;
+    }
+    return severity;
+}
+
+void StationHealthModel::rescore(uint32_t slot, unsigned long nowMs) {
+    Station& station = stations_[slot];
+    station.severity = 0.0f;
+    station.reason = STATION_HEALTH_OK;
+    for (uint8_t c = 0; c < SAMPLE_CHANNEL_COUNT; ++c) {
+        ChannelHealth& channel = station.channels[c];
+        if (channel.samples > 0.0f && nowMs > channel.lastMs && nowMs - channel.lastMs >= config_.staleMs) {
+            std::memset(&channel, 0, sizeof(channel));   // stopped reporting; start over if it returns
+        }
+        uint8_t reason = STATION_HEALTH_OK;
+        float severity = channelSeverity(channel, reason);
+        if (severity > station.severity) {
+            station.severity = severity;
+            station.reason = reason;
+            station.worstChannel = c;
+        }
+    }
+
+    int bucket = bucketFor(station.severity);
+    if (bucket < 0) {
+        station.reason = STATION_HEALTH_OK;   // worst metric still within its limit
+    }
+    if (bucket != station.bucket) {
+        unlink(slot);
+        link(slot, bucket);
+    }
+}
+
+void StationHealthModel::unlink(uint32_t slot) {
+    Station& station = stations_[slot];
+    if (station.bucket < 0) {
+        return;
+    }
+    if (station.prev != kNone) {
+        stations_[station.prev].next = station.next;
+    } else {
+        buckets_[station.bucket] = station.next;
+    }
+    if (station.next != kNone) {
+        stations_[station.next].prev = station.prev;
+    }
+    station.prev = kNone;
+    station.next = kNone;
+    station.bucket = -1;
+    alertCount_--;
+}
+
+void StationHealthModel::link(uint32_t slot, int bucket) {
+    if (bucket < 0) {
+        return;
+    }
+    Station& station = stations_[slot];
+    station.bucket = static_cast<int8_t>(bucket);
+    station.prev = kNone;
+    station.next = buckets_[bucket];
+    if (station.next != kNone) {
+        stations_[station.next].prev = slot;
+    }
+    buckets_[bucket] = slot;
+    alertCount_++;
+}
+
+void StationHealthModel::fillSnapshot(const Station& station, StationHealthSnapshot& out) const {
+    const ChannelHealth& channel = station.channels[station.worstChannel];
+    out.stationId = station.id;
+    out.channel = station.worstChannel;
+    out.reason = station.reason;
+    out.severity = station.severity;
+    out.resetRate = resetRate(channel);
+    out.dropoutRatio = dropoutRatio(channel);
+    out.timeToStableMs = channel.recentTimeToStableMs;
+    out.timeToStableDrift = timeToStableDrift(channel);
+    out.lastEventMs = station.lastEventMs;
+}
+
+int StationHealthModel::bucketFor(float severity) {
+    if (!(severity >= 1.0f)) {
+        return -1;
+    }
+    int bucket = static_cast<int>(std::log2(severity) * kBucketsPerOctave);
+    return bucket < kBucketCount ? bucket : kBucketCount - 1;
+}
+
+const char* stationHealthReasonName(uint8_t reason) {
+    return reason <= STATION_HEALTH_TIME_TO_STABLE ? kReasonNames[reason] : "unknown";
+}
@@ -0,0 +1,941 @@
+#include "station_partition.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include "socket_frame.h"
+#include "station_replication.h"
+
+namespace {
+
+// Frame types (socket_frame.h)
+enum PartitionMessage {
+    MSG_SAMPLE = 1,          // TraceSample
+    MSG_MEMBERS,             // epoch, sources, members
+    MSG_CHECKPOINTS,         // sender's epoch, StationCheckpoints
+    MSG_HANDOFF_DONE,        // epoch, sender
+    MSG_QUERY,               // station -> MSG_STATE
+    MSG_STATE,               // QueryStatus, owner, StationCheckpoint when held
+    MSG_STATUS,              // -> MSG_STATUS_REPLY
+    MSG_STATUS_REPLY,        // PartitionNodeStatus
+    MSG_SHUTDOWN
+};
+
+enum QueryStatus {
+    QUERY_HELD = 0,
+    QUERY_NOT_OWNER,
+    QUERY_PENDING,           // owned here, handoff not received yet
+    QUERY_UNKNOWN            // owned here, no samples seen
+};
+
+const size_t kCheckpointsPerFrame = 256;
+const size_t kPrefetchAhead = 8;   // stations, in StationPartition::takeChanges()
+
+uint32_t mix32(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<uint32_t>((x ^ (x >> 31)) >> 32);
+}
+
+uint32_t stationHash(uint32_t stationId) {
+    return mix32(stationId + 0x9E3779B97F4A7C15ULL);
+}
+
+uint32_t pointHash(uint32_t nodeId, unsigned replica) {
+    return mix32((static_cast<uint64_t>(nodeId) << 32 | replica) + 0x632BE59BD9B4E019ULL);
+}
+
+void putIds(std::vector<uint8_t>& out, const std::vector<uint32_t>& ids) {
+    putValue(out, static_cast<uint32_t>(ids.size()));
+    for (size_t i = 0; i < ids.size(); ++i) {
+        putValue(out, ids[i]);
+    }
+}
+
+bool getIds(const uint8_t*& p, const uint8_t* end, std::vector<uint32_t>& ids) {
+    uint32_t count = 0;
+    if (!getValue(p, end, count) || count > static_cast<size_t>(end - p) / sizeof(uint32_t)) {
+        return false;
+    }
+    ids.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        getValue(p, end, ids[i]);
+    }
+    return true;
+}
+
+void putSample(std::vector<uint8_t>& out, const TraceSample& sample) {
+    putValue(out, sample.deviceId);
+    putValue(out, static_cast<uint64_t>(sample.timeMs));
+    putValue(out, sample.value);
+    putValue(out, sample.channel);
+}
+
+bool getSample(const uint8_t*& p, const uint8_t* end, TraceSample& sample) {
+    uint64_t timeMs = 0;
+    if (!getValue(p, end, sample.deviceId) || !getValue(p, end, timeMs) || !getValue(p, end, sample.value) ||
+        !getValue(p, end, sample.channel)) {
+        return false;
+    }
+    sample.timeMs = static_cast<unsigned long>(timeMs);
+    return true;
+}
+
+// Height, BPM and SpO2 checkpoints share their layout apart from the
+// reading type and BPM/SpO2's lastReadingValid
+template<typename T, typename Checkpoint>
+void putTimers(std::vector<uint8_t>& out, T tolerance, T lastReading, T stableReading, const Checkpoint& checkpoint) {
+    putValue(out, tolerance);
+    putValue(out, lastReading);
+    putValue(out, stableReading);
+    putValue(out, static_cast<uint64_t>(checkpoint.stabilityStartTime));
+    putValue(out, static_cast<uint64_t>(checkpoint.lastSampleTime));
+    putValue(out, static_cast<uint8_t>(checkpoint.isStable));
+    putValue(out, static_cast<uint8_t>(checkpoint.hasReading));
+}
+
+template<typename T, typename Checkpoint>
+bool getTimers(const uint8_t*& p, const uint8_t* end, T& tolerance, T& lastReading, T& stableReading,
+               Checkpoint& checkpoint) {
+    uint64_t stabilityStartTime = 0;
+    uint64_t lastSampleTime = 0;
+    if (!getValue(p, end, tolerance) || !getValue(p, end, lastReading) || !getValue(p, end, stableReading) ||
+        !getValue(p, end, stabilityStartTime) || !getValue(p, end, lastSampleTime) ||
+        !getFlag(p, end, checkpoint.isStable) || !getFlag(p, end, checkpoint.hasReading)) {
+        return false;
+    }
+    checkpoint.stabilityStartTime = static_cast<unsigned long>(stabilityStartTime);
+    checkpoint.lastSampleTime = static_cast<unsigned long>(lastSampleTime);
+    return true;
+}
+
+void putCheckpoint(std::vector<uint8_t>& out, const StationCheckpoint& checkpoint) {
+    putValue(out, checkpoint.stationId);
+    const HeightDebouncer::Checkpoint& height = checkpoint.height;
+    putTimers(out, height.toleranceCm, height.lastReading, height.stableReading, height);
+    const ReadingDebouncer<float>::Checkpoint& bpm = checkpoint.bpm;
+    putTimers(out, bpm.tolerance, bpm.lastReading, bpm.stableReading, bpm);
+    putValue(out, static_cast<uint8_t>(bpm.lastReadingValid));
+    const ReadingDebouncer<int>::Checkpoint& spo2 = checkpoint.spo2;
+    putTimers(out, spo2.tolerance, spo2.lastReading, spo2.stableReading, spo2);
+    putValue(out, static_cast<uint8_t>(spo2.lastReadingValid));
+}
+
+bool getCheckpoint(const uint8_t*& p, const uint8_t* end, StationCheckpoint& checkpoint) {
+    HeightDebouncer::Checkpoint& height = checkpoint.height;
+    ReadingDebouncer<float>::Checkpoint& bpm = checkpoint.bpm;
+    ReadingDebouncer<int>::Checkpoint& spo2 = checkpoint.spo2;
+    return getValue(p, end, checkpoint.stationId) &&
+           getTimers(p, end, height.toleranceCm, height.lastReading, height.stableReading, height) &&
+           getTimers(p, end, bpm.tolerance, bpm.lastReading, bpm.stableReading, bpm) &&
+           getFlag(p, end, bpm.lastReadingValid) &&
+           getTimers(p, end, spo2.tolerance, spo2.lastReading, spo2.stableReading, spo2) &&
+           getFlag(p, end, spo2.lastReadingValid);
+}
+
+StationCheckpoint checkpointOf(uint32_t stationId, const TraceReplayer& replayer) {
+    StationCheckpoint checkpoint;
+    checkpoint.stationId = stationId;
+    checkpoint.height = replayer.getHeightDebouncer().getCheckpoint();
+    checkpoint.bpm = replayer.getBpmDebouncer().getCheckpoint();
+    checkpoint.spo2 = replayer.getSpo2Debouncer().getCheckpoint();
+    return checkpoint;
+}
+
+} // namespace
+
+// ============================================
+// ConsistentHashRing
+// ============================================
+
+ConsistentHashRing::ConsistentHashRing(unsigned virtualNodes)
+    : virtualNodes_(virtualNodes > 0 ? virtualNodes : 1)
+{
+}
+
+void ConsistentHashRing::setMembers(const std::vector<uint32_t>& nodeIds) {
+    members_ = nodeIds;
+    std::sort(members_.begin(), members_.end());
+    members_.erase(std::unique(members_.begin(), members_.end()), members_.end());
+
+    points_.clear();
+    points_.reserve(members_.size() * virtualNodes_);
+    for (size_t i = 0; i < members_.size(); ++i) {
+        for (unsigned replica = 0; replica < virtualNodes_; ++replica) {
+            Point point;
+            point.hash = pointHash(members_[i], replica);
+            point.nodeId = members_[i];
+            points_.push_back(point);
+        }
+    }
+    // Ties (vanishingly rare) go to the lower node ID on every process alike
+    std::sort(points_.begin(), points_.end(), [](const Point& a, const Point& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.nodeId < b.nodeId;
+    });
+}
+
+uint32_t ConsistentHashRing::ownerOf(uint32_t stationId) const {
+    if (points_.empty()) {
+        return PARTITION_NO_NODE;
+    }
+    uint32_t hash = stationHash(stationId);
+    std::vector<Point>::const_iterator it = std::lower_bound(
+        points_.begin(), points_.end(), hash, [](const Point& point, uint32_t value) { return point.hash < value; });
+    return it == points_.end() ? points_.front().nodeId : it->nodeId;
+}
+
+bool ConsistentHashRing::contains(uint32_t nodeId) const {
+    return std::binary_search(members_.begin(), members_.end(), nodeId);
+}
+
+// ============================================
+// StationPartition
+// ============================================
+
+StationPartition::StationPartition(uint32_t nodeId, const TraceReplayer& prototype)
+    : nodeId_(nodeId)
+    , prototype_(prototype)
+    , epoch_(0)
+    , queuedCount_(0)
+    , tracking_(false)
+    , samplesApplied_(0)
+    , checkpointsAdopted_(0)
+    , checkpointsHandedOff_(0)
+{
+    prototype_.reset();
+}
+
+void StationPartition::setMembers(uint64_t epoch, const std::vector<uint32_t>& sources,
+                                  const std::vector<uint32_t>& members, std::vector<StationCheckpoint>& handoff) {
+    epoch_ = epoch;
+    ring_.setMembers(members);
+
+    for (StationMap::iterator it = stations_.begin(); it != stations_.end();) {
+        if (ring_.ownerOf(it->first) != nodeId_) {
+            handoff.push_back(checkpointOf(it->first, it->second.replayer));
+            checkpointsHandedOff_++;
+            it = eraseStation(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // A node leaving the ring has nothing to wait for
+    pendingSources_.clear();
+    if (ring_.contains(nodeId_)) {
+        for (size_t i = 0; i < sources.size(); ++i) {
+            if (sources[i] != nodeId_) {
+                pendingSources_.insert(sources[i]);
+            }
+        }
+    }
+    std::map<uint64_t, std::set<uint32_t> >::iterator early = earlyDone_.find(epoch);
+    if (early != earlyDone_.end()) {
+        for (std::set<uint32_t>::const_iterator it = early->second.begin(); it != early->second.end(); ++it) {
+            pendingSources_.erase(*it);
+        }
+    }
+    earlyDone_.erase(earlyDone_.begin(), earlyDone_.upper_bound(epoch));
+}
+
+bool StationPartition::adopt(const StationCheckpoint& checkpoint, uint64_t epoch) {
+    if (epoch <= epoch_ && ring_.ownerOf(checkpoint.stationId) != nodeId_) {
+        return false;
+    }
+    StationMap::iterator it = findOrAddStation(checkpoint.stationId);
+    it->second.replayer.restore(checkpoint.height, checkpoint.bpm, checkpoint.spo2);
+    markChanged(*it);
+    checkpointsAdopted_++;
+
+    // Samples that overtook the handoff go in behind the restored state
+    std::unordered_map<uint32_t, std::vector<TraceSample> >::iterator queued = queued_.find(checkpoint.stationId);
+    if (queued != queued_.end()) {
+        for (size_t i = 0; i < queued->second.size(); ++i) {
+            it->second.replayer.onSample(queued->second[i]);
+            samplesApplied_++;
+        }
+        queuedCount_ -= queued->second.size();
+        queued_.erase(queued);
+    }
+    return true;
+}
+
+void StationPartition::sourceDone(uint32_t nodeId, uint64_t epoch) {
+    if (epoch == epoch_) {
+        pendingSources_.erase(nodeId);
+    } else if (epoch > epoch_) {
+        earlyDone_[epoch].insert(nodeId);
+    }
+}
+
+int StationPartition::route(const TraceSample& sample, uint32_t* owner) {
+    uint32_t stationId = sample.deviceId;
+    uint32_t ownerId = ring_.ownerOf(stationId);
+    if (ownerId != nodeId_ && ownerId != PARTITION_NO_NODE) {
+        *owner = ownerId;
+        return PARTITION_FORWARD;
+    }
+
+    StationMap::iterator it = stations_.find(stationId);
+    if (it == stations_.end()) {
+        if (!isSettled() || ownerId == PARTITION_NO_NODE) {
+            queued_[stationId].push_back(sample);
+            queuedCount_++;
+            return PARTITION_QUEUED;
+        }
+        it = findOrAddStation(stationId);
+    }
+    it->second.replayer.onSample(sample);
+    markChanged(*it);
+    samplesApplied_++;
+    return PARTITION_APPLIED;
+}
+
+size_t StationPartition::drainQueued(std::vector<TraceSample>& forward) {
+    if (!isSettled() || queued_.empty()) {
+        return 0;
+    }
+    std::unordered_map<uint32_t, std::vector<TraceSample> > queued;
+    queued.swap(queued_);
+    size_t drained = queuedCount_;
+    queuedCount_ = 0;
+
+    // Settled, so nothing is queued again; stations with no handoff start fresh
+    for (std::unordered_map<uint32_t, std::vector<TraceSample> >::const_iterator it = queued.begin();
+         it != queued.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); ++i) {
+            uint32_t owner = PARTITION_NO_NODE;
+            if (route(it->second[i], &owner) == PARTITION_FORWARD) {
+                forward.push_back(it->second[i]);
+            }
+        }
+    }
+    return drained;
+}
+
+bool StationPartition::getCheckpoint(uint32_t stationId, StationCheckpoint& out) const {
+    StationMap::const_iterator it = stations_.find(stationId);
+    if (it == stations_.end()) {
+        return false;
+    }
+    out = checkpointOf(stationId, it->second.replayer);
+    return true;
+}
+
+void StationPartition::setChangeTracking(bool enabled) {
+    tracking_ = enabled;
+    for (size_t i = 0; i < changed_.size(); ++i) {
+        changed_[i]->second.changed = false;
+    }
+    changed_.clear();
+    removed_.clear();
+}
+
+void StationPartition::takeChanges(bool everything, std::vector<StationCheckpoint>& changed,
+                                   std::vector<uint32_t>& removed) {
+    if (everything) {
+        changed.reserve(changed.size() + stations_.size());
+        for (StationMap::const_iterator it = stations_.begin(); it != stations_.end(); ++it) {
+            changed.push_back(checkpointOf(it->first, it->second.replayer));
+        }
+        for (size_t i = 0; i < changed_.size(); ++i) {
+            changed_[i]->second.changed = false;
+        }
+    } else {
+        // One pass over the changed stations, which are scattered over the
+        // heap: fetch a few ahead so the copies overlap their cache misses
+        changed.reserve(changed.size() + changed_.size());
+        for (size_t i = 0; i < changed_.size(); ++i) {
+#if defined(__GNUC__)
+            if (i + kPrefetchAhead < changed_.size()) {
+                __builtin_prefetch(changed_[i + kPrefetchAhead], 1);
+            }
+#endif
+            StationMap::value_type& station = *changed_[i];
+            station.second.changed = false;
+            changed.push_back(checkpointOf(station.first, station.second.replayer));
+        }
+        removed.insert(removed.end(), removed_.begin(), removed_.end());
+    }
+    changed_.clear();
+    removed_.clear();
+}
+
+void StationPartition::applyReplica(uint64_t epoch, const std::vector<uint32_t>& members, bool everything,
+                                    const std::vector<StationCheckpoint>& changed,
+                                    const std::vector<uint32_t>& removed) {
+    if (epoch != epoch_ || members != ring_.getMembers()) {
+        epoch_ = epoch;
+        ring_.setMembers(members);
+    }
+    pendingSources_.clear();
+    if (everything) {
+        stations_.clear();
+        changed_.clear();
+        removed_.clear();
+    }
+    // A station handed off and back within one batch is in both lists
+    for (size_t i = 0; i < removed.size(); ++i) {
+        StationMap::iterator it = stations_.find(removed[i]);
+        if (it != stations_.end()) {
+            eraseStation(it);
+        }
+    }
+    for (size_t i = 0; i < changed.size(); ++i) {
+        const StationCheckpoint& checkpoint = changed[i];
+        findOrAddStation(checkpoint.stationId)->second.replayer.restore(checkpoint.height, checkpoint.bpm,
+                                                                        checkpoint.spo2);
+    }
+}
+
+StationPartition::StationMap::iterator StationPartition::findOrAddStation(uint32_t stationId) {
+    StationMap::iterator it = stations_.find(stationId);
+    if (it == stations_.end()) {
+        it = stations_.emplace(stationId, Station(prototype_)).first;
+    }
+    return it;
+}
+
+StationPartition::StationMap::iterator StationPartition::eraseStation(StationMap::iterator it) {
+    if (tracking_) {
+        if (it->second.changed) {
+            changed_.erase(std::find(changed_.begin(), changed_.end(), &*it));
+        }
+        removed_.push_back(it->first);
+    }
+    return stations_.erase(it);
+}
+
+// ============================================
+// PartitionNode
+// ============================================
+
+PartitionNode::PartitionNode(const std::string& directory, uint32_t nodeId, const TraceReplayer& prototype)
+    : directory_(directory)
+    , partition_(nodeId, prototype)
+    , listenFd_(-1)
+    , samplesForwarded_(0)
+    , sendErrors_(0)
+    , stopping_(false)
+{
+}
+
+PartitionNode::~PartitionNode() {
+    replication_.reset();
+    for (size_t i = 0; i < connections_.size(); ++i) {
+        ::close(connections_[i].fd);
+    }
+    for (PeerMap::const_iterator it = peers_.begin(); it != peers_.end(); ++it) {
+        ::close(it->second.fd);
+    }
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        ::unlink(socketPath(directory_, partition_.getNodeId()).c_str());
+    }
+}
+
+std::string PartitionNode::socketPath(const std::string& directory, uint32_t nodeId) {
+    return directory + "/node-" + std::to_string(nodeId) + ".sock";
+}
+
+bool PartitionNode::listen() {
+    if (listenFd_ >= 0) {
+        return false;
+    }
+    listenFd_ = listenFrameSocket(socketPath(directory_, partition_.getNodeId()));
+    return listenFd_ >= 0;
+}
+
+void PartitionNode::setStandby(const std::string& standbyPath) {
+    replication_.reset(new ReplicationPrimary(partition_, standbyPath));
+    replication_->start();
+}
+
+bool PartitionNode::run() {
+    if (listenFd_ < 0) {
+        return false;
+    }
+    std::vector<pollfd> entries;
+    std::vector<uint32_t> waiting;   // peers polled for POLLOUT, after the connections
+    std::chrono::steady_clock::time_point nextPublish = std::chrono::steady_clock::now();
+    stopping_ = false;
+
+    while (!stopping_) {
+        entries.clear();
+        pollfd listener = { listenFd_, POLLIN, 0 };
+        entries.push_back(listener);
+        for (size_t i = 0; i < connections_.size(); ++i) {
+            pollfd entry = { connections_[i].fd, POLLIN, 0 };
+            entries.push_back(entry);
+        }
+        waiting.clear();
+        for (PeerMap::const_iterator it = peers_.begin(); it != peers_.end(); ++it) {
+            if (!it->second.writer.isEmpty()) {
+                pollfd entry = { it->second.fd, POLLOUT, 0 };
+                entries.push_back(entry);
+                waiting.push_back(it->first);
+            }
+        }
+        int timeoutMs = replication_ ? REPLICATION_HEARTBEAT_MS : -1;
+        if (::poll(entries.data(), entries.size(), timeoutMs) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        // Connections accepted now are polled from the next round
+        size_t polled = connections_.size();
+        if (entries[0].revents & POLLIN) {
+            int fd = ::accept4(listenFd_, NULL, NULL, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                Connection connection;
+                connection.fd = fd;
+                connections_.push_back(connection);
+            }
+        }
+
+        for (size_t i = 0; i < polled && !stopping_; ++i) {
+            if (entries[i + 1].revents == 0) {
+                continue;
+            }
+            Connection& connection = connections_[i];
+            bool open = connection.reader.receive(connection.fd);
+            uint8_t type = 0;
+            const uint8_t* payload = NULL;
+            size_t length = 0;
+            while (open && !stopping_ && connection.reader.next(type, payload, length)) {
+                open = handleFrame(connection.fd, type, payload, length);
+            }
+            if (!open || connection.reader.isCorrupt()) {
+                ::close(connection.fd);
+                connection.fd = -1;
+            }
+        }
+
+        connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                          [](const Connection& connection) { return connection.fd < 0; }),
+                           connections_.end());
+
+        // Handling the connections may have dropped or reconnected a peer
+        for (size_t i = 0; i < waiting.size(); ++i) {
+            const pollfd& entry = entries[1 + polled + i];
+            PeerMap::iterator it = peers_.find(waiting[i]);
+            if (entry.revents == 0 || it == peers_.end() || it->second.fd != entry.fd) {
+                continue;
+            }
+            if (!it->second.writer.flush(it->second.fd)) {
+                dropPeer(it);
+            }
+        }
+
+        // Batches go out on a timer, so a busy node checks the clock once
+        // per poll round rather than per sample
+        if (replication_) {
+            replication_->keepAlive();
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now >= nextPublish) {
+                replication_->publish();
+                nextPublish = now + std::chrono::milliseconds(REPLICATION_BATCH_INTERVAL_MS);
+            }
+        }
+    }
+    finishSends();
+    if (replication_) {
+        replication_->stop();
+    }
+    return true;
+}
+
+bool PartitionNode::handleFrame(int fd, uint8_t type, const uint8_t* payload, size_t length) {
+    const uint8_t* p = payload;
+    const uint8_t* end = payload + length;
+    uint32_t self = partition_.getNodeId();
+
+    switch (type) {
+    case MSG_SAMPLE: {
+        TraceSample sample;
+        uint32_t owner = PARTITION_NO_NODE;
+        if (!getSample(p, end, sample)) {
+            return false;
+        }
+        if (partition_.route(sample, &owner) == PARTITION_FORWARD) {
+            forward(sample, owner);
+        }
+        return true;
+    }
+    case MSG_MEMBERS: {
+        uint64_t epoch = 0;
+        std::vector<uint32_t> sources;
+        std::vector<uint32_t> members;
+        if (!getValue(p, end, epoch) || !getIds(p, end, sources) || !getIds(p, end, members)) {
+            return false;
+        }
+        if (epoch <= partition_.getEpoch()) {
+            return true;   // repeated announcement
+        }
+        std::vector<StationCheckpoint> handoff;
+        partition_.setMembers(epoch, sources, members, handoff);
+
+        // Checkpoints to each new owner, then "done" to every member, in
+        // that order on each peer connection
+        std::map<uint32_t, std::vector<uint8_t> > frames;
+        std::map<uint32_t, size_t> counts;
+        for (size_t i = 0; i < handoff.size(); ++i) {
+            uint32_t owner = partition_.getRing().ownerOf(handoff[i].stationId);
+            std::vector<uint8_t>& frame = frames[owner];
+            if (frame.empty()) {
+                frame = beginFrame(MSG_CHECKPOINTS);
+                putValue(frame, epoch);
+            }
+            putCheckpoint(frame, handoff[i]);
+            if (++counts[owner] % kCheckpointsPerFrame == 0) {
+                finishFrame(frame);
+                sendToPeer(owner, frame);
+                frame.clear();
+            }
+        }
+        for (std::map<uint32_t, std::vector<uint8_t> >::iterator it = frames.begin(); it != frames.end(); ++it) {
+            if (!it->second.empty()) {
+                finishFrame(it->second);
+                sendToPeer(it->first, it->second);
+            }
+        }
+        std::vector<uint8_t> done = beginFrame(MSG_HANDOFF_DONE);
+        putValue(done, epoch);
+        putValue(done, self);
+        finishFrame(done);
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (members[i] != self) {
+                sendToPeer(members[i], done);
+            }
+        }
+        drain();
+        return true;
+    }
+    case MSG_CHECKPOINTS: {
+        uint64_t epoch = 0;
+        if (!getValue(p, end, epoch)) {
+            return false;
+        }
+        while (p < end) {
+            StationCheckpoint checkpoint;
+            if (!getCheckpoint(p, end, checkpoint)) {
+                return false;
+            }
+            if (!partition_.adopt(checkpoint, epoch)) {
+                // Moved on again since it was sent: pass it to the owner now
+                std::vector<uint8_t> frame = beginFrame(MSG_CHECKPOINTS);
+                putValue(frame, partition_.getEpoch());
+                putCheckpoint(frame, checkpoint);
+                finishFrame(frame);
+                sendToPeer(partition_.getRing().ownerOf(checkpoint.stationId), frame);
+            }
+        }
+        return true;
+    }
+    case MSG_HANDOFF_DONE: {
+        uint64_t epoch = 0;
+        uint32_t source = 0;
+        if (!getValue(p, end, epoch) || !getValue(p, end, source)) {
+            return false;
+        }
+        partition_.sourceDone(source, epoch);
+        drain();
+        return true;
+    }
+    case MSG_QUERY: {
+        uint32_t stationId = 0;
+        if (!getValue(p, end, stationId)) {
+            return false;
+        }
+        uint32_t owner = partition_.getRing().ownerOf(stationId);
+        StationCheckpoint checkpoint;
+        bool held = partition_.getCheckpoint(stationId, checkpoint);
+        uint8_t status = QUERY_HELD;
+        if (!held) {
+            if (!partition_.isSettled()) {
+                status = QUERY_PENDING;
+            } else {
+                status = owner == self ? QUERY_UNKNOWN : QUERY_NOT_OWNER;
+            }
+        }
+        std::vector<uint8_t> reply = beginFrame(MSG_STATE);
+        putValue(reply, status);
+        putValue(reply, owner);
+        if (held) {
+            putCheckpoint(reply, checkpoint);
+        }
+        finishFrame(reply);
+        return writeFrame(fd, reply);
+    }
+    case MSG_STATUS: {
+        std::vector<uint8_t> reply = beginFrame(MSG_STATUS_REPLY);
+        putValue(reply, partition_.getEpoch());
+        putValue(reply, static_cast<uint8_t>(partition_.isSettled()));
+        putValue(reply, static_cast<uint32_t>(partition_.getStationCount()));
+        putValue(reply, static_cast<uint32_t>(partition_.getQueuedCount()));
+        putValue(reply, partition_.getSamplesApplied());
+        putValue(reply, samplesForwarded_);
+        putValue(reply, partition_.getCheckpointsAdopted());
+        putValue(reply, partition_.getCheckpointsHandedOff());
+        finishFrame(reply);
+        return writeFrame(fd, reply);
+    }
+    case MSG_SHUTDOWN:
+        stopping_ = true;
+        return true;
+    default:
+        return false;
+    }
+}
+
+void PartitionNode::forward(const TraceSample& sample, uint32_t owner) {
+    std::vector<uint8_t> frame = beginFrame(MSG_SAMPLE);
+    putSample(frame, sample);
+    finishFrame(frame);
+    sendToPeer(owner, frame);
+    samplesForwarded_++;
+}
+
+void PartitionNode::sendToPeer(uint32_t nodeId, const std::vector<uint8_t>& frame) {
+    PeerMap::iterator it = peers_.find(nodeId);
+    if (it == peers_.end()) {
+        int fd = connectFrameSocket(socketPath(directory_, nodeId), PARTITION_CONNECT_TIMEOUT_MS);
+        if (fd < 0 || !setNonBlocking(fd)) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            sendErrors_++;
+            return;
+        }
+        Peer peer;
+        peer.fd = fd;
+        it = peers_.insert(std::make_pair(nodeId, peer)).first;
+    }
+
+    // Behind a backlog the frame waits for POLLOUT; otherwise try it now
+    FrameWriter& writer = it->second.writer;
+    bool idle = writer.isEmpty();
+    writer.queue(frame);
+    if (idle && !writer.flush(it->second.fd)) {
+        dropPeer(it);
+    }
+}
+
+void PartitionNode::dropPeer(PeerMap::iterator it) {
+    sendErrors_++;
+    ::close(it->second.fd);
+    peers_.erase(it);
+}
+
+void PartitionNode::finishSends() {
+    // Shutting down: give each peer a while to take what is still queued
+    for (PeerMap::iterator it = peers_.begin(); it != peers_.end();) {
+        PeerMap::iterator peer = it++;
+        while (!peer->second.writer.isEmpty()) {
+            pollfd entry = { peer->second.fd, POLLOUT, 0 };
+            int ready = ::poll(&entry, 1, PARTITION_CONNECT_TIMEOUT_MS);
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ready <= 0 || !peer->second.writer.flush(peer->second.fd)) {
+                dropPeer(peer);
+                break;
+            }
+        }
+    }
+}
+
+void PartitionNode::drain() {
+    std::vector<TraceSample> forwarded;
+    partition_.drainQueued(forwarded);
+    for (size_t i = 0; i < forwarded.size(); ++i) {
+        forward(forwarded[i], partition_.getRing().ownerOf(forwarded[i].deviceId));
+    }
+}
+
+// ============================================
+// PartitionClient
+// ============================================
+
+PartitionClient::PartitionClient(const std::string& directory)
+    : directory_(directory)
+    , epoch_(0)
+{
+}
+
+PartitionClient::~PartitionClient() {
+    for (std::map<uint32_t, int>::const_iterator it = nodes_.begin(); it != nodes_.end(); ++it) {
+        ::close(it->second);
+    }
+}
+
+int PartitionClient::connectionTo(uint32_t nodeId) {
+    std::map<uint32_t, int>::const_iterator it = nodes_.find(nodeId);
+    if (it != nodes_.end()) {
+        return it->second;
+    }
+    int fd = connectFrameSocket(PartitionNode::socketPath(directory_, nodeId), PARTITION_CONNECT_TIMEOUT_MS);
+    if (fd >= 0) {
+        nodes_[nodeId] = fd;
+    }
+    return fd;
+}
+
+void PartitionClient::disconnect(uint32_t nodeId) {
+    std::map<uint32_t, int>::iterator it = nodes_.find(nodeId);
+    if (it != nodes_.end()) {
+        ::close(it->second);
+        nodes_.erase(it);
+    }
+}
+
+bool PartitionClient::request(uint32_t nodeId, const std::vector<uint8_t>& frame, uint8_t replyType,
+                              std::vector<uint8_t>& reply) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        int fd = connectionTo(nodeId);
+        uint8_t type = 0;
+        if (fd >= 0 && writeFrame(fd, frame) && readFrame(fd, type, reply, PARTITION_CONNECT_TIMEOUT_MS) &&
+            type == replyType) {
+            return true;
+        }
+        disconnect(nodeId);
+    }
+    return false;
+}
+
+bool PartitionClient::setMembers(const std::vector<uint32_t>& members) {
+    std::vector<uint32_t> sources = ring_.getMembers();
+    epoch_++;
+    std::vector<uint8_t> frame = beginFrame(MSG_MEMBERS);
+    putValue(frame, epoch_);
+    putIds(frame, sources);
+    putIds(frame, members);
+    finishFrame(frame);
+
+    std::vector<uint32_t> recipients = sources;
+    recipients.insert(recipients.end(), members.begin(), members.end());
+    std::sort(recipients.begin(), recipients.end());
+    recipients.erase(std::unique(recipients.begin(), recipients.end()), recipients.end());
+
+    bool ok = true;
+    for (size_t i = 0; i < recipients.size(); ++i) {
+        int fd = connectionTo(recipients[i]);
+        if (fd < 0 || !writeFrame(fd, frame)) {
+            disconnect(recipients[i]);
+            ok = false;
+        }
+    }
+    ring_.setMembers(members);
+    return ok;
+}
+
+bool PartitionClient::send(const TraceSample& sample) {
+    uint32_t owner = ring_.ownerOf(sample.deviceId);
+    if (owner == PARTITION_NO_NODE) {
+        return false;
+    }
+    std::vector<uint8_t> frame = beginFrame(MSG_SAMPLE);
+    putSample(frame, sample);
+    finishFrame(frame);
+    // A node that crashed leaves a dead connection, and a standby taking
+    // over listens on the same path, so reconnect once
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        int fd = connectionTo(owner);
+        if (fd >= 0 && writeFrame(fd, frame)) {
+            return true;
+        }
+        disconnect(owner);
+    }
+    return false;
+}
+
+bool PartitionClient::query(uint32_t stationId, StationCheckpoint& out, bool* found) {
+    std::vector<uint8_t> frame = beginFrame(MSG_QUERY);
+    putValue(frame, stationId);
+    finishFrame(frame);
+
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(PARTITION_CONNECT_TIMEOUT_MS);
+    for (;;) {
+        uint32_t owner = ring_.ownerOf(stationId);
+        std::vector<uint8_t> reply;
+        if (owner == PARTITION_NO_NODE || !request(owner, frame, MSG_STATE, reply)) {
+            return false;
+        }
+        const uint8_t* p = reply.data();
+        const uint8_t* end = p + reply.size();
+        uint8_t status = 0;
+        uint32_t replyOwner = 0;
+        if (!getValue(p, end, status) || !getValue(p, end, replyOwner)) {
+            return false;
+        }
+        switch (status) {
+        case QUERY_HELD:
+            *found = true;
+            return getCheckpoint(p, end, out);
+        case QUERY_UNKNOWN:
+            *found = false;
+            return true;
+        case QUERY_PENDING:
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            break;
+        default:
+            return false;   // the node disagrees about the ring
+        }
+    }
+}
+
+bool PartitionClient::getStatus(uint32_t nodeId, PartitionNodeStatus& out) {
+    std::vector<uint8_t> frame = beginFrame(MSG_STATUS);
+    finishFrame(frame);
+    std::vector<uint8_t> reply;
+    if (!request(nodeId, frame, MSG_STATUS_REPLY, reply)) {
+        return false;
+    }
+    const uint8_t* p = reply.data();
+    const uint8_t* end = p + reply.size();
+    return getValue(p, end, out.epoch) && getFlag(p, end, out.settled) && getValue(p, end, out.stations) &&
+           getValue(p, end, out.queued) && getValue(p, end, out.samplesApplied) &&
+           getValue(p, end, out.samplesForwarded) && getValue(p, end, out.checkpointsAdopted) &&
+           getValue(p, end, out.checkpointsHandedOff);
+}
+
+bool PartitionClient::waitSettled(unsigned long timeoutMs) {
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        bool settled = true;
+        const std::vector<uint32_t>& members = ring_.getMembers();
+        for (size_t i = 0; i < members.size() && settled; ++i) {
+            PartitionNodeStatus status;
+            if (!getStatus(members[i], status)) {
+                return false;
+            }
+            settled = status.epoch == epoch_ && status.settled && status.queued == 0;
+        }
+        if (settled) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+bool PartitionClient::shutdown(uint32_t nodeId) {
+    std::vector<uint8_t> frame = beginFrame(MSG_SHUTDOWN);
+    finishFrame(frame);
+    int fd = connectionTo(nodeId);
+    bool ok = fd >= 0 && writeFrame(fd, frame);
+    disconnect(nodeId);
+    return ok;
+}
@@ -0,0 +1,604 @@
+#include "station_replication.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "socket_frame.h"
+
+namespace {
+
+const size_t kSpareBatches = 2;
+
+const uint8_t MSG_REPLICATION_BATCH = 1;
+const uint8_t MSG_REPLICATION_HEARTBEAT = 2;   // no fields
+
+const uint8_t BATCH_FULL = 0x01;
+const uint8_t BATCH_CLOSING = 0x02;
+
+// Changed-field bits of a channel
+const uint8_t FIELD_TOLERANCE = 0x01;
+const uint8_t FIELD_LAST_READING = 0x02;
+const uint8_t FIELD_STABLE_READING = 0x04;
+const uint8_t FIELD_STABILITY_START = 0x08;
+const uint8_t FIELD_LAST_SAMPLE = 0x10;
+const uint8_t FIELD_FLAGS = 0x20;
+
+const uint8_t FLAG_STABLE = 0x01;
+const uint8_t FLAG_HAS_READING = 0x02;
+const uint8_t FLAG_LAST_READING_VALID = 0x04;
+
+/**
+ * A debouncer checkpoint in the one shape the codec handles
+ */
+template<typename T>
+struct Channel {
+    T tolerance;
+    T lastReading;
+    T stableReading;
+    unsigned long stabilityStartTime;
+    unsigned long lastSampleTime;
+    uint8_t flags;
+};
+
+Channel<int> channelOf(const HeightDebouncer::Checkpoint& checkpoint) {
+    Channel<int> channel;
+    channel.tolerance = checkpoint.toleranceCm;
+    channel.lastReading = checkpoint.lastReading;
+    channel.stableReading = checkpoint.stableReading;
+    channel.stabilityStartTime = checkpoint.stabilityStartTime;
+    channel.lastSampleTime = checkpoint.lastSampleTime;
+    channel.flags = (checkpoint.isStable ? FLAG_STABLE : 0) | (checkpoint.hasReading ? FLAG_HAS_READING : 0);
+    return channel;
+}
+
+template<typename T>
+Channel<T> channelOf(const typename ReadingDebouncer<T>::Checkpoint& checkpoint) {
+    Channel<T> channel;
+    channel.tolerance = checkpoint.tolerance;
+    channel.lastReading = checkpoint.lastReading;
+    channel.stableReading = checkpoint.stableReading;
+    channel.stabilityStartTime = checkpoint.stabilityStartTime;
+    channel.lastSampleTime = checkpoint.lastSampleTime;
+    channel.flags = (checkpoint.isStable ? FLAG_STABLE : 0) | (checkpoint.hasReading ? FLAG_HAS_READING : 0) |
+                    (checkpoint.lastReadingValid ? FLAG_LAST_READING_VALID : 0);
+    return channel;
+}
+
+void restoreChannel(const Channel<int>& channel, HeightDebouncer::Checkpoint& checkpoint) {
+    checkpoint.toleranceCm = channel.tolerance;
+    checkpoint.lastReading = channel.lastReading;
+    checkpoint.stableReading = channel.stableReading;
+    checkpoint.stabilityStartTime = channel.stabilityStartTime;
+    checkpoint.lastSampleTime = channel.lastSampleTime;
+    checkpoint.isStable = (channel.flags & FLAG_STABLE) != 0;
+    checkpoint.hasReading = (channel.flags & FLAG_HAS_READING) != 0;
+}
+
+template<typename T>
+void restoreChannel(const Channel<T>& channel, typename ReadingDebouncer<T>::Checkpoint& checkpoint) {
+    checkpoint.tolerance = channel.tolerance;
+    checkpoint.lastReading = channel.lastReading;
+    checkpoint.stableReading = channel.stableReading;
+    checkpoint.stabilityStartTime = channel.stabilityStartTime;
+    checkpoint.lastSampleTime = channel.lastSampleTime;
+    checkpoint.isStable = (channel.flags & FLAG_STABLE) != 0;
+    checkpoint.hasReading = (channel.flags & FLAG_HAS_READING) != 0;
+    checkpoint.lastReadingValid = (channel.flags & FLAG_LAST_READING_VALID) != 0;
+}
+
+// Fields: integers and times as deltas from the previous value, floats
+// raw (compared bitwise, so a NaN is not resent every time)
+
+bool differs(int value, int base) { return value != base; }
+bool differs(unsigned long value, unsigned long base) { return value != base; }
+bool differs(float value, float base) { return std::memcmp(&value, &base, sizeof(value)) != 0; }
+
+void putField(std::vector<uint8_t>& out, int value, int base) {
+    putSignedVarint(out, static_cast<int64_t>(value) - static_cast<int64_t>(base));
+}
+
+void putField(std::vector<uint8_t>& out, unsigned long value, unsigned long base) {
+    // Modulo 2^64, so any pair of values survives the round trip
+    putSignedVarint(out, static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(base)));
+}
+
+void putField(std::vector<uint8_t>& out, float value, float) {
+    putValue(out, value);
+}
+
+bool getField(const uint8_t*& p, const uint8_t* end, int& value, int base) {
+    int64_t delta = 0;
+    if (!getSignedVarint(p, end, delta)) {
+        return false;
+    }
+    value = static_cast<int>(static_cast<int64_t>(base) + delta);
+    return true;
+}
+
+bool getField(const uint8_t*& p, const uint8_t* end, unsigned long& value, unsigned long base) {
+    int64_t delta = 0;
+    if (!getSignedVarint(p, end, delta)) {
+        return false;
+    }
+    value = static_cast<unsigned long>(static_cast<uint64_t>(base) + static_cast<uint64_t>(delta));
+    return true;
+}
+
+bool getField(const uint8_t*& p, const uint8_t* end, float& value, float) {
+    return getValue(p, end, value);
+}
+
+template<typename T>
+void encodeChannel(std::vector<uint8_t>& out, const Channel<T>& value, const Channel<T>& base) {
+    uint8_t mask = (differs(value.tolerance, base.tolerance) ? FIELD_TOLERANCE : 0) |
+                   (differs(value.lastReading, base.lastReading) ? FIELD_LAST_READING : 0) |
+                   (differs(value.stableReading, base.stableReading) ? FIELD_STABLE_READING : 0) |
+                   (differs(value.stabilityStartTime, base.stabilityStartTime) ? FIELD_STABILITY_START : 0) |
+                   (differs(value.lastSampleTime, base.lastSampleTime) ? FIELD_LAST_SAMPLE : 0) |
+                   (value.flags != base.flags ? FIELD_FLAGS : 0);
+    out.push_back(mask);
+    if (mask & FIELD_TOLERANCE) {
+        putField(out, value.tolerance, base.tolerance);
+    }
+    if (mask & FIELD_LAST_READING) {
+        putField(out, value.lastReading, base.lastReading);
+    }
+    if (mask & FIELD_STABLE_READING) {
+        putField(out, value.stableReading, base.stableReading);
+    }
+    if (mask & FIELD_STABILITY_START) {
+        putField(out, value.stabilityStartTime, base.stabilityStartTime);
+    }
+    if (mask & FIELD_LAST_SAMPLE) {
+        putField(out, value.lastSampleTime, base.lastSampleTime);
+    }
+    if (mask & FIELD_FLAGS) {
+        out.push_back(value.flags);
+    }
+}
+
+template<typename T>
+bool decodeChannel(const uint8_t*& p, const uint8_t* end, const Channel<T>& base, Channel<T>& value) {
+    uint8_t mask = 0;
+    if (!getValue(p, end, mask)) {
+        return false;
+    }
+    value = base;
+    return (!(mask & FIELD_TOLERANCE) || getField(p, end, value.tolerance, base.tolerance)) &&
+           (!(mask & FIELD_LAST_READING) || getField(p, end, value.lastReading, base.lastReading)) &&
+           (!(mask & FIELD_STABLE_READING) || getField(p, end, value.stableReading, base.stableReading)) &&
+           (!(mask & FIELD_STABILITY_START) || getField(p, end, value.stabilityStartTime, base.stabilityStartTime)) &&
+           (!(mask & FIELD_LAST_SAMPLE) || getField(p, end, value.lastSampleTime, base.lastSampleTime)) &&
+           (!(mask & FIELD_FLAGS) || getValue(p, end, value.flags));
+}
+
+void encodeStation(std::vector<uint8_t>& out, const StationCheckpoint& value, const StationCheckpoint& base) {
+    encodeChannel(out, channelOf(value.height), channelOf(base.height));
+    encodeChannel(out, channelOf<float>(value.bpm), channelOf<float>(base.bpm));
+    encodeChannel(out, channelOf<int>(value.spo2), channelOf<int>(base.spo2));
+}
+
+bool decodeStation(const uint8_t*& p, const uint8_t* end, const StationCheckpoint& base, StationCheckpoint& value) {
+    Channel<int> height;
+    Channel<float> bpm;
+    Channel<int> spo2;
+    if (!decodeChannel(p, end, channelOf(base.height), height) ||
+        !decodeChannel(p, end, channelOf<float>(base.bpm), bpm) ||
+        !decodeChannel(p, end, channelOf<int>(base.spo2), spo2)) {
+        return false;
+    }
+    restoreChannel(height, value.height);
+    restoreChannel<float>(bpm, value.bpm);
+    restoreChannel<int>(spo2, value.spo2);
+    return true;
+}
+
+bool stationIdLess(const StationCheckpoint* a, const StationCheckpoint* b) {
+    return a->stationId < b->stationId;
+}
+
+/**
+ * Sorted IDs as varint gaps
+ */
+void putIdList(std::vector<uint8_t>& out, std::vector<uint32_t> ids) {
+    std::sort(ids.begin(), ids.end());
+    putVarint(out, ids.size());
+    uint32_t previous = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        putVarint(out, ids[i] - previous);
+        previous = ids[i];
+    }
+}
+
+bool getIdList(const uint8_t*& p, const uint8_t* end, std::vector<uint32_t>& ids) {
+    uint64_t count = 0;
+    if (!getVarint(p, end, count) || count > static_cast<uint64_t>(end - p)) {
+        return false;
+    }
+    ids.resize(static_cast<size_t>(count));
+    uint64_t previous = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        uint64_t gap = 0;
+        if (!getVarint(p, end, gap) || previous + gap > 0xFFFFFFFFu) {
+            return false;
+        }
+        previous += gap;
+        ids[i] = static_cast<uint32_t>(previous);
+    }
+    return true;
+}
+
+} // namespace
+
+ReplicationBatch::ReplicationBatch()
+    : sequence(0)
+    , epoch(0)
+    , full(false)
+    , closing(false)
+{
+}
+
+// ============================================
+// ReplicationCodec
+// ============================================
+// Payload: sequence, flag byte, epoch, member IDs, removed IDs, then the
+// changed stations as (ID gap, height, bpm, spo2). Removals come first,
+// the order StationPartition::applyReplica() applies them in, and both
+// ends update their history in that same order.
+
+void ReplicationCodec::reset() {
+    last_.clear();
+}
+
+void ReplicationCodec::encode(const ReplicationBatch& batch, std::vector<uint8_t>& out) {
+    if (batch.full) {
+        last_.clear();
+    }
+    putVarint(out, batch.sequence);
+    out.push_back((batch.full ? BATCH_FULL : 0) | (batch.closing ? BATCH_CLOSING : 0));
+    putVarint(out, batch.epoch);
+    putIdList(out, batch.members);
+    putIdList(out, batch.removed);
+    for (size_t i = 0; i < batch.removed.size(); ++i) {
+        last_.erase(batch.removed[i]);
+    }
+
+    std::vector<const StationCheckpoint*> sorted(batch.changed.size());
+    for (size_t i = 0; i < batch.changed.size(); ++i) {
+        sorted[i] = &batch.changed[i];
+    }
+    std::sort(sorted.begin(), sorted.end(), stationIdLess);
+
+    const StationCheckpoint none = StationCheckpoint();
+    putVarint(out, sorted.size());
+    uint32_t previous = 0;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const StationCheckpoint& checkpoint = *sorted[i];
+        putVarint(out, checkpoint.stationId - previous);
+        previous = checkpoint.stationId;
+        std::unordered_map<uint32_t, StationCheckpoint>::iterator it = last_.find(checkpoint.stationId);
+        if (it == last_.end()) {
+            encodeStation(out, checkpoint, none);
+            last_.emplace(checkpoint.stationId, checkpoint);
+        } else {
+            encodeStation(out, checkpoint, it->second);
+            it->second = checkpoint;
+        }
+    }
+}
+
+bool ReplicationCodec::decode(const uint8_t* data, size_t length, ReplicationBatch& out) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + length;
+    uint8_t flags = 0;
+    if (!getVarint(p, end, out.sequence) || !getValue(p, end, flags) || !getVarint(p, end, out.epoch) ||
+        !getIdList(p, end, out.members) || !getIdList(p, end, out.removed)) {
+        return false;
+    }
+    out.full = (flags & BATCH_FULL) != 0;
+    out.closing = (flags & BATCH_CLOSING) != 0;
+    if (out.full) {
+        last_.clear();
+    }
+    for (size_t i = 0; i < out.removed.size(); ++i) {
+        last_.erase(out.removed[i]);
+    }
+
+    uint64_t count = 0;
+    if (!getVarint(p, end, count) || count > static_cast<uint64_t>(end - p)) {
+        return false;
+    }
+    const StationCheckpoint none = StationCheckpoint();
+    out.changed.resize(static_cast<size_t>(count));
+    uint64_t previous = 0;
+    for (size_t i = 0; i < out.changed.size(); ++i) {
+        uint64_t gap = 0;
+        if (!getVarint(p, end, gap) || previous + gap > 0xFFFFFFFFu) {
+            return false;
+        }
+        previous += gap;
+        StationCheckpoint& checkpoint = out.changed[i];
+        checkpoint.stationId = static_cast<uint32_t>(previous);
+        std::unordered_map<uint32_t, StationCheckpoint>::iterator it = last_.find(checkpoint.stationId);
+        if (!decodeStation(p, end, it == last_.end() ? none : it->second, checkpoint)) {
+            return false;
+        }
+        last_[checkpoint.stationId] = checkpoint;
+    }
+    return p == end;
+}
+
+// ============================================
+// ReplicationPrimary
+// ============================================
+
+ReplicationPrimary::ReplicationPrimary(StationPartition& partition, const std::string& standbyPath)
+    : partition_(partition)
+    , standbyPath_(standbyPath)
+    , sequence_(0)
+    , needFull_(true)
+    , connected_(false)
+    , alive_(true)
+    , stopping_(false)
+    , stats_()
+{
+}
+
+ReplicationPrimary::~ReplicationPrimary() {
+    stop();
+}
+
+void ReplicationPrimary::start() {
+    if (sender_.joinable()) {
+        return;
+    }
+    partition_.setChangeTracking(true);
+    needFull_ = true;
+    stopping_ = false;
+    sender_ = std::thread(&ReplicationPrimary::sendLoop, this);
+}
+
+void ReplicationPrimary::publish() {
+    alive_ = true;
+    enqueue(false);
+}
+
+void ReplicationPrimary::stop() {
+    if (!sender_.joinable()) {
+        return;
+    }
+    enqueue(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    sender_.join();
+    partition_.setChangeTracking(false);
+}
+
+ReplicationStats ReplicationPrimary::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ReplicationPrimary::enqueue(bool closing) {
+    bool full = needFull_.exchange(false);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= REPLICATION_MAX_QUEUED_BATCHES) {
+            // The standby is not keeping up: replace the backlog with a snapshot
+            stats_.droppedBatches += queue_.size();
+            queue_.clear();
+            full = true;
+        }
+    }
+
+    // Reuse a sent batch's buffers; fresh ones would fault in new pages
+    // on the owner's thread every time
+    ReplicationBatch batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!spare_.empty()) {
+            batch = std::move(spare_.back());
+            spare_.pop_back();
+        }
+    }
+    batch.members.clear();
+    batch.changed.clear();
+    batch.removed.clear();
+    batch.sequence = ++sequence_;
+    batch.epoch = partition_.getEpoch();
+    batch.full = full;
+    batch.closing = closing;
+    batch.members = partition_.getRing().getMembers();
+    partition_.takeChanges(full, batch.changed, batch.removed);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(batch));
+    }
+    wake_.notify_one();
+}
+
+void ReplicationPrimary::sendLoop() {
+    const std::chrono::milliseconds heartbeat(REPLICATION_HEARTBEAT_MS);
+    ReplicationCodec codec;
+    std::vector<ReplicationBatch> batches;
+    std::vector<uint8_t> frame;
+    int fd = -1;
+    bool synced = false;   // the standby has had a full batch on this connection
+    bool stopping = false;
+    std::chrono::steady_clock::time_point lastWrite = std::chrono::steady_clock::now();
+    while (!stopping) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            std::chrono::steady_clock::time_point due = lastWrite + heartbeat;
+            while (!stopping_ && queue_.empty() &&
+                   wake_.wait_until(lock, due) == std::cv_status::no_timeout) {
+            }
+            batches.swap(queue_);
+            stopping = stopping_;
+        }
+
+        if (fd < 0) {
+            fd = connectFrameSocket(standbyPath_, 0);
+            if (fd >= 0) {
+                codec.reset();
+                synced = false;
+                needFull_ = true;
+                connected_ = true;
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats_.connects++;
+            }
+        }
+
+        for (size_t i = 0; i < batches.size(); ++i) {
+            ReplicationBatch& batch = batches[i];
+            if (fd >= 0 && !synced && !batch.full && batch.closing) {
+                // Nothing to mirror yet, but the standby must still learn
+                // that this shutdown is deliberate
+                batch.changed.clear();
+                batch.removed.clear();
+            } else if (fd < 0 || (!synced && !batch.full)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats_.droppedBatches++;
+                continue;
+            }
+
+            frame = beginFrame(MSG_REPLICATION_BATCH);
+            codec.encode(batch, frame);
+            finishFrame(frame);
+            if (!writeFrame(fd, frame)) {
+                ::close(fd);
+                fd = -1;
+                connected_ = false;
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats_.droppedBatches++;
+                continue;
+            }
+            synced = synced || batch.full;
+            lastWrite = std::chrono::steady_clock::now();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.batches++;
+            stats_.stations += batch.changed.size();
+            stats_.rawBytes += batch.changed.size() * sizeof(StationCheckpoint);
+            stats_.sentBytes += frame.size();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (!batches.empty() && spare_.size() < kSpareBatches) {
+                spare_.push_back(std::move(batches.back()));
+                batches.pop_back();
+            }
+        }
+        batches.clear();
+
+        // A heartbeat vouches for the owner, so skip it if the owner has
+        // not been heard from since the last one
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= lastWrite + heartbeat) {
+            lastWrite = now;
+            if (fd >= 0 && alive_.exchange(false)) {
+                frame = beginFrame(MSG_REPLICATION_HEARTBEAT);
+                finishFrame(frame);
+                if (!writeFrame(fd, frame)) {
+                    ::close(fd);
+                    fd = -1;
+                    connected_ = false;
+                }
+            }
+        }
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    connected_ = false;
+}
+
+// ============================================
+// ReplicationStandby
+// ============================================
+
+ReplicationStandby::ReplicationStandby(const std::string& socketPath)
+    : socketPath_(socketPath)
+    , listenFd_(-1)
+    , batchesApplied_(0)
+    , lastSequence_(0)
+{
+}
+
+ReplicationStandby::~ReplicationStandby() {
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+        ::unlink(socketPath_.c_str());
+    }
+}
+
+std::string ReplicationStandby::socketPath(const std::string& directory, uint32_t nodeId) {
+    return directory + "/standby-" + std::to_string(nodeId) + ".sock";
+}
+
+bool ReplicationStandby::listen() {
+    listenFd_ = listenFrameSocket(socketPath_);
+    return listenFd_ >= 0;
+}
+
+bool ReplicationStandby::runUntilFailover(StationPartition& replica, unsigned long silenceMs) {
+    if (listenFd_ < 0) {
+        return false;
+    }
+    ReplicationBatch batch;
+    for (;;) {
+        // No primary yet, or the last one shut down cleanly: wait for one
+        int fd;
+        do {
+            fd = ::accept4(listenFd_, NULL, NULL, SOCK_CLOEXEC);
+        } while (fd < 0 && errno == EINTR);
+        if (fd < 0) {
+            return false;
+        }
+
+        codec_.reset();
+        FrameReader reader;
+        bool closing = false;
+        bool corrupt = false;
+        while (!corrupt) {
+            pollfd entry = { fd, POLLIN, 0 };
+            int ready = ::poll(&entry, 1, static_cast<int>(silenceMs));
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ready <= 0 || !reader.receive(fd)) {
+                break;   // silent or gone
+            }
+            uint8_t type = 0;
+            const uint8_t* payload = NULL;
+            size_t length = 0;
+            while (reader.next(type, payload, length)) {
+                if (type == MSG_REPLICATION_HEARTBEAT) {
+                    continue;
+                }
+                if (type != MSG_REPLICATION_BATCH || !codec_.decode(payload, length, batch)) {
+                    corrupt = true;
+                    break;
+                }
+                replica.applyReplica(batch.epoch, batch.members, batch.full, batch.changed, batch.removed);
+                batchesApplied_++;
+                lastSequence_ = batch.sequence;
+                closing = batch.closing;
+            }
+            corrupt = corrupt || reader.isCorrupt();
+        }
+        ::close(fd);
+
+        // A garbled stream is dropped rather than taken as a failure; the
+        // primary reconnects and resends everything
+        if (!closing && !corrupt) {
+            return true;
+        }
+    }
+}
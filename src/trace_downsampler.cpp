@@ -0,0 +1,222 @@
+#include "trace_downsampler.h"
+#include <cmath>
+
+// ============================================
+// DownsampleConfig
+// ============================================
+
+DownsampleConfig::DownsampleConfig()
+    : fromMs(0)
+    , bucketMs(1000)
+{
+}
+
+DownsampleConfig DownsampleConfig::forRange(unsigned long fromMs, unsigned long toMs, size_t points) {
+    DownsampleConfig config;
+    config.fromMs = fromMs;
+    // The first and last points come on top of one per bucket
+    size_t buckets = points > 3 ? points - 2 : 1;
+    unsigned long span = toMs > fromMs ? toMs - fromMs : 0;
+    config.bucketMs = (span + buckets - 1) / buckets;
+    if (config.bucketMs == 0) {
+        config.bucketMs = 1;
+    }
+    return config;
+}
+
+// ============================================
+// LttbDownsampler
+// ============================================
+
+void LttbDownsampler::Bucket::clear() {
+    points.clear();
+    sumTimeMs = 0.0;
+    sumValue = 0.0;
+}
+
+void LttbDownsampler::Bucket::push(const DownsamplePoint& point) {
+    points.push_back(point);
+    sumTimeMs += static_cast<double>(point.timeMs);
+    sumValue += point.value;
+}
+
+LttbDownsampler::LttbDownsampler(const DownsampleConfig& config)
+    : config_(config)
+    , started_(false)
+    , pointsIn_(0)
+    , pointsOut_(0)
+{
+    if (config_.bucketMs == 0) {
+        config_.bucketMs = 1;
+    }
+    anchor_.timeMs = 0;
+    anchor_.value = 0.0f;
+    anchor_.kind = DOWNSAMPLE_POINT_SAMPLE;
+}
+
+void LttbDownsampler::reset() {
+    started_ = false;
+    pending_.clear();
+    open_.clear();
+    pointsIn_ = 0;
+    pointsOut_ = 0;
+}
+
+void LttbDownsampler::emit(const DownsamplePoint& point, std::vector<DownsamplePoint>& out) {
+    out.push_back(point);
+    anchor_ = point;
+    pointsOut_++;
+}
+
+void LttbDownsampler::add(const DownsamplePoint& point, std::vector<DownsamplePoint>& out) {
+    pointsIn_++;
+    if (!started_) {
+        started_ = true;
+        emit(point, out);
+        return;
+    }
+
+    unsigned long index = point.timeMs > config_.fromMs ? (point.timeMs - config_.fromMs) / config_.bucketMs : 0;
+    if (!open_.points.empty() && index > open_.index) {
+        // The open bucket is complete: its mean decides the pending one
+        if (!pending_.points.empty()) {
+            double count = static_cast<double>(open_.points.size());
+            select(pending_, open_.sumTimeMs / count, open_.sumValue / count, out);
+        }
+        pending_.points.swap(open_.points);
+        pending_.index = open_.index;
+        pending_.sumTimeMs = open_.sumTimeMs;
+        pending_.sumValue = open_.sumValue;
+        open_.clear();
+    }
+    if (open_.points.empty()) {
+        open_.index = index;
+    }
+    open_.push(point);
+}
+
+void LttbDownsampler::finish(std::vector<DownsamplePoint>& out) {
+    if (!started_) {
+        return;
+    }
+    if (open_.points.empty() && pending_.points.empty()) {
+        started_ = false;   // the only point was the first
+        return;
+    }
+    // The last point is kept as is; the buckets before it are decided
+    // against it, as in batch LTTB
+    DownsamplePoint last = open_.points.back();
+    open_.points.pop_back();
+    open_.sumTimeMs -= static_cast<double>(last.timeMs);
+    open_.sumValue -= last.value;
+
+    double lastTimeMs = static_cast<double>(last.timeMs);
+    if (!pending_.points.empty()) {
+        if (open_.points.empty()) {
+            select(pending_, lastTimeMs, last.value, out);
+        } else {
+            double count = static_cast<double>(open_.points.size());
+            select(pending_, open_.sumTimeMs / count, open_.sumValue / count, out);
+        }
+    }
+    if (!open_.points.empty()) {
+        select(open_, lastTimeMs, last.value, out);
+    }
+    emit(last, out);
+    pending_.clear();
+    open_.clear();
+    started_ = false;
+}
+
+void LttbDownsampler::select(const Bucket& bucket, double nextTimeMs, double nextValue,
+                             std::vector<DownsamplePoint>& out) {
+    // Twice the triangle's area, relative to the anchor to keep precision
+    // on epoch-sized timestamps
+    const double anchorTimeMs = static_cast<double>(anchor_.timeMs);
+    const double anchorValue = anchor_.value;
+    const double dt = nextTimeMs - anchorTimeMs;
+    const double dv = nextValue - anchorValue;
+    size_t best = bucket.points.size();
+    double bestArea = -1.0;
+    for (size_t i = 0; i < bucket.points.size(); ++i) {
+        const DownsamplePoint& point = bucket.points[i];
+        if (point.kind != DOWNSAMPLE_POINT_SAMPLE) {
+            continue;
+        }
+        double area = std::fabs(dt * (point.value - anchorValue) -
+                                (static_cast<double>(point.timeMs) - anchorTimeMs) * dv);
+        if (area > bestArea) {
+            bestArea = area;
+            best = i;
+        }
+    }
+    for (size_t i = 0; i < bucket.points.size(); ++i) {
+        if (i == best || bucket.points[i].kind != DOWNSAMPLE_POINT_SAMPLE) {
+            emit(bucket.points[i], out);
+        }
+    }
+}
+
+// ============================================
+// TraceDownsampler
+// ============================================
+
+TraceDownsampler::TraceDownsampler(const DownsampleConfig& config, const HeightDebouncer& height,
+                                   const ReadingDebouncer<float>& bpm, const ReadingDebouncer<int>& spo2)
+    : replayer_(height, bpm, spo2, this)
+    , series_{ LttbDownsampler(config), LttbDownsampler(config), LttbDownsampler(config) }
+    , kind_(DOWNSAMPLE_POINT_SAMPLE)
+{
+}
+
+TraceDownsampler::TraceDownsampler(const DownsampleConfig& config)
+    : replayer_(this)
+    , series_{ LttbDownsampler(config), LttbDownsampler(config), LttbDownsampler(config) }
+    , kind_(DOWNSAMPLE_POINT_SAMPLE)
+{
+}
+
+void TraceDownsampler::onTransition(const StabilityTransition& transition) {
+    kind_ = static_cast<uint8_t>(transition.stable ? DOWNSAMPLE_POINT_STABLE : DOWNSAMPLE_POINT_UNSTABLE);
+}
+
+void TraceDownsampler::onSample(const TraceSample& sample) {
+    if (sample.channel >= SAMPLE_CHANNEL_COUNT) {
+        return;
+    }
+    kind_ = DOWNSAMPLE_POINT_SAMPLE;
+    replayer_.onSample(sample);
+
+    DownsamplePoint point;
+    point.timeMs = sample.timeMs;
+    point.value = sample.value;
+    point.kind = kind_;
+    series_[sample.channel].add(point, points_[sample.channel]);
+}
+
+void TraceDownsampler::addColumns(const LogColumns& columns) {
+    TraceSample sample;
+    sample.deviceId = 0;
+    for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        const std::vector<uint64_t>& times = columns.timesMs[channel];
+        const std::vector<double>& values = columns.values[channel];
+        sample.channel = channel;
+        for (size_t i = 0; i < values.size(); ++i) {
+            sample.timeMs = static_cast<unsigned long>(times[i]);
+            sample.value = static_cast<float>(values[i]);
+            onSample(sample);
+        }
+    }
+}
+
+void TraceDownsampler::finish() {
+    for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        series_[channel].finish(points_[channel]);
+    }
+}
+
+void TraceDownsampler::clearPoints() {
+    for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        points_[channel].clear();
+    }
+}
@@ -0,0 +1,285 @@
+#include "trace_parser.h"
+#include "config.h"
+#include <cstring>
+
+namespace {
+
+bool startsWith(const char* p, const char* end, const char* prefix, size_t prefixLength) {
+    return static_cast<size_t>(end - p) >= prefixLength && std::memcmp(p, prefix, prefixLength) == 0;
+}
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && *p == ' ') {
+        ++p;
+    }
+    return p;
+}
+
+// Parse an unsigned decimal integer, returns NULL if no digits were found
+const char* parseUnsigned(const char* p, const char* end, unsigned long* value) {
+    const char* start = p;
+    unsigned long result = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        result = result * 10 + static_cast<unsigned long>(*p - '0');
+        ++p;
+    }
+    if (p == start) {
+        return NULL;
+    }
+    *value = result;
+    return p;
+}
+
+// Parse a decimal as printed by Serial.print(float), e.g. "72.50"
+const char* parseDecimal(const char* p, const char* end, float* value) {
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    unsigned long whole = 0;
+    p = parseUnsigned(p, end, &whole);
+    if (p == NULL) {
+        return NULL;
+    }
+    float result = static_cast<float>(whole);
+    if (p < end && *p == '.') {
+        ++p;
+        unsigned long fraction = 0;
+        unsigned long divisor = 1;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (divisor < 1000000UL) {
+                fraction = fraction * 10 + static_cast<unsigned long>(*p - '0');
+                divisor *= 10;
+            }
+            ++p;
+        }
+        result += static_cast<float>(fraction) / static_cast<float>(divisor);
+    }
+    *value = negative ? -result : result;
+    return p;
+}
+
+} // namespace
+
+TraceParser::TraceParser(TraceSampleSink* sink, uint32_t deviceId, unsigned long heightIntervalMs)
+    : sink_(sink)
+    , deviceId_(deviceId)
+    , heightIntervalMs_(heightIntervalMs)
+    , nextHeightTimeMs_(0)
+    , linesParsed_(0)
+    , linesSkipped_(0)
+{
+}
+
+TraceParser::TraceParser(TraceSampleSink* sink, uint32_t deviceId)
+    : TraceParser(sink, deviceId, DEBOUNCE_SAMPLE_INTERVAL_MS)
+{
+}
+
+void TraceParser::feed(const char* data, size_t length) {
+    const char* p = data;
+    const char* end = data + length;
+
+    // Complete a line carried over from the previous block
+    if (!carry_.empty()) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', length));
+        if (newline == NULL) {
+            carry_.append(p, length);
+            return;
+        }
+        carry_.append(p, newline - p);
+        parseLine(carry_.data(), carry_.data() + carry_.size());
+        carry_.clear();
+        p = newline + 1;
+    }
+
+    while (p < end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (newline == NULL) {
+            carry_.assign(p, end - p);
+            return;
+        }
+        parseLine(p, newline);
+        p = newline + 1;
+    }
+}
+
+void TraceParser::finish() {
+    if (!carry_.empty()) {
+        parseLine(carry_.data(), carry_.data() + carry_.size());
+        carry_.clear();
+    }
+}
+
+void TraceParser::reset() {
+    nextHeightTimeMs_ = 0;
+    linesParsed_ = 0;
+    linesSkipped_ = 0;
+    carry_.clear();
+}
+
+void TraceParser::parseLine(const char* begin, const char* end) {
+    if (end > begin && end[-1] == '\r') {
+        --end;
+    }
+    const char* p = skipSpaces(begin, end);
+    if (p == end) {
+        return; // Blank separator lines are not counted
+    }
+
+    bool parsed = false;
+    if (*p == 'R') {
+        parsed = parseHeightLine(p, end);
+    } else if (*p == '[') {
+        parsed = parseOximeterLine(p, end);
+    }
+
+    if (parsed) {
+        linesParsed_++;
+    } else {
+        linesSkipped_++;
+    }
+}
+
+bool TraceParser::parseHeightLine(const char* p, const char* end) {
+    // "Raw: 123 cm | Stable: ..."
+    static const char kPrefix[] = "Raw: ";
+    if (!startsWith(p, end, kPrefix, sizeof(kPrefix) - 1)) {
+        return false;
+    }
+    p += sizeof(kPrefix) - 1;
+
+    unsigned long distance = 0;
+    if (parseUnsigned(p, end, &distance) == NULL) {
+        return false;
+    }
+
+    emit(nextHeightTimeMs_, static_cast<float>(distance), CHANNEL_HEIGHT);
+    nextHeightTimeMs_ += heightIntervalMs_;
+    return true;
+}
+
+bool TraceParser::parseOximeterLine(const char* p, const char* end) {
+    // "[12345ms] RAW - BPM:72.50 SpO2:97%"
+    static const char kRaw[] = "ms] RAW - BPM:";
+    static const char kSpo2[] = " SpO2:";
+
+    unsigned long timeMs = 0;
+    p = parseUnsigned(p + 1, end, &timeMs);
+    if (p == NULL || !startsWith(p, end, kRaw, sizeof(kRaw) - 1)) {
+        return false;
+    }
+    p += sizeof(kRaw) - 1;
+
+    float bpm = 0.0f;
+    p = parseDecimal(p, end, &bpm);
+    if (p == NULL || !startsWith(p, end, kSpo2, sizeof(kSpo2) - 1)) {
+        return false;
+    }
+    p += sizeof(kSpo2) - 1;
+
+    unsigned long spo2 = 0;
+    if (parseUnsigned(p, end, &spo2) == NULL) {
+        return false;
+    }
+
+    emit(timeMs, bpm, CHANNEL_BPM);
+    emit(timeMs, static_cast<float>(spo2), CHANNEL_SPO2);
+    return true;
+}
+
+void TraceParser::emit(unsigned long timeMs, float value, uint8_t channel) {
+    if (sink_ == NULL) {
+        return;
+    }
+    TraceSample sample;
+    sample.deviceId = deviceId_;
+    sample.timeMs = timeMs;
+    sample.value = value;
+    sample.channel = channel;
+    sink_->onSample(sample);
+}
+
+// ============================================
+// FrameTraceParser
+// ============================================
+
+FrameTraceParser::FrameTraceParser(TraceSampleSink* sink)
+    : sink_(sink)
+    , pendingLength_(0)
+    , framesParsed_(0)
+    , bytesSkipped_(0)
+{
+}
+
+void FrameTraceParser::feed(const uint8_t* data, size_t length) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + length;
+
+    // Bytes carried over from the previous block are handled one at a time
+    while (pendingLength_ > 0 && p < end) {
+        pending_[pendingLength_++] = *p++;
+        if (pendingLength_ < SAMPLE_FRAME_SIZE) {
+            continue;
+        }
+        SampleFrame frame;
+        if (decodeSampleFrame(pending_, &frame)) {
+            consume(pending_);
+            pendingLength_ = 0;
+        } else {
+            // Resynchronize on the next sync byte within the carried bytes
+            size_t next = 1;
+            while (next < pendingLength_ && pending_[next] != SAMPLE_FRAME_SYNC) {
+                ++next;
+            }
+            bytesSkipped_ += next;
+            std::memmove(pending_, pending_ + next, pendingLength_ - next);
+            pendingLength_ -= next;
+        }
+    }
+
+    while (p < end) {
+        if (*p != SAMPLE_FRAME_SYNC) {
+            const uint8_t* sync = static_cast<const uint8_t*>(std::memchr(p, SAMPLE_FRAME_SYNC, end - p));
+            const uint8_t* stop = sync == NULL ? end : sync;
+            bytesSkipped_ += static_cast<unsigned long>(stop - p);
+            p = stop;
+            continue;
+        }
+        if (static_cast<size_t>(end - p) < SAMPLE_FRAME_SIZE) {
+            std::memcpy(pending_, p, end - p);
+            pendingLength_ = static_cast<size_t>(end - p);
+            return;
+        }
+        SampleFrame frame;
+        if (decodeSampleFrame(p, &frame)) {
+            consume(p);
+            p += SAMPLE_FRAME_SIZE;
+        } else {
+            bytesSkipped_++;
+            ++p;
+        }
+    }
+}
+
+void FrameTraceParser::reset() {
+    pendingLength_ = 0;
+    framesParsed_ = 0;
+    bytesSkipped_ = 0;
+}
+
+void FrameTraceParser::consume(const uint8_t* frameBytes) {
+    SampleFrame frame;
+    decodeSampleFrame(frameBytes, &frame);
+    framesParsed_++;
+    if (sink_ == NULL) {
+        return;
+    }
+    TraceSample sample;
+    sample.deviceId = frame.deviceId;
+    sample.timeMs = frame.timeMs;
+    sample.value = static_cast<float>(frame.valueHundredths) / 100.0f;
+    sample.channel = frame.channel;
+    sink_->onSample(sample);
+}
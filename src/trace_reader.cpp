@@ -0,0 +1,555 @@
+#include "trace_reader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define TRACE_READER_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+// ============================================
+// Backends
+// ============================================
+
+/**
+ * Issues reads into slot buffers and reports their completions
+ */
+class AsyncTraceReader::Backend {
+public:
+    virtual ~Backend() {}
+
+    /**
+     * Queue a read; it may not start until the next complete() call
+     */
+    virtual void submit(unsigned slot, int fd, char* buffer, size_t length, uint64_t offset) = 0;
+
+    /**
+     * Wait for one queued read to finish
+     * @param slot - receives the slot passed to submit()
+     * @param result - bytes read, or -errno
+     * @return false if the backend failed and no more completions will arrive
+     */
+    virtual bool complete(unsigned* slot, long* result) = 0;
+};
+
+/**
+ * Portable fallback: serves the queue in order with pread()
+ */
+class AsyncTraceReader::SyncBackend : public AsyncTraceReader::Backend {
+public:
+    virtual void submit(unsigned slot, int fd, char* buffer, size_t length, uint64_t offset) {
+        Request request;
+        request.slot = slot;
+        request.fd = fd;
+        request.buffer = buffer;
+        request.length = length;
+        request.offset = offset;
+        queue_.push_back(request);
+    }
+
+    virtual bool complete(unsigned* slot, long* result) {
+        if (queue_.empty()) {
+            return false;
+        }
+        Request request = queue_.front();
+        queue_.pop_front();
+
+        ssize_t n;
+        do {
+            n = ::pread(request.fd, request.buffer, request.length, static_cast<off_t>(request.offset));
+        } while (n < 0 && errno == EINTR);
+
+        *slot = request.slot;
+        *result = n < 0 ? -static_cast<long>(errno) : static_cast<long>(n);
+        return true;
+    }
+
+private:
+    struct Request {
+        unsigned slot;
+        int fd;
+        char* buffer;
+        size_t length;
+        uint64_t offset;
+    };
+
+    std::deque<Request> queue_;
+};
+
+#ifdef TRACE_READER_HAVE_IO_URING
+
+/**
+ * io_uring backend driven through the raw syscalls (no liburing dependency)
+ */
+class AsyncTraceReader::UringBackend : public AsyncTraceReader::Backend {
+public:
+    UringBackend()
+        : ringFd_(-1)
+        , sqRing_(NULL)
+        , cqRing_(NULL)
+        , sqes_(NULL)
+        , sqRingSize_(0)
+        , cqRingSize_(0)
+        , sqesSize_(0)
+        , sqHead_(NULL)
+        , sqTail_(NULL)
+        , sqMask_(0)
+        , sqArray_(NULL)
+        , cqHead_(NULL)
+        , cqTail_(NULL)
+        , cqMask_(0)
+        , cqes_(NULL)
+        , localTail_(0)
+        , pending_(0)
+        , registered_(false)
+        , opcode_(IORING_OP_READ)
+    {
+    }
+
+    virtual ~UringBackend() {
+        if (sqes_ != NULL) {
+            munmap(sqes_, sqesSize_);
+        }
+        if (cqRing_ != NULL && cqRing_ != sqRing_) {
+            munmap(cqRing_, cqRingSize_);
+        }
+        if (sqRing_ != NULL) {
+            munmap(sqRing_, sqRingSize_);
+        }
+        if (ringFd_ >= 0) {
+            ::close(ringFd_);
+        }
+    }
+
+    /**
+     * Create the ring, register the slot buffers and pick a read opcode
+     * @return false if io_uring or every usable read opcode is unavailable
+     */
+    bool init(unsigned entries, char* buffers, size_t blockSize, unsigned slotCount) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return false;
+        }
+        ringFd_ = fd;
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap) {
+            sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        }
+
+        sqRing_ = mapRing(sqRingSize_, IORING_OFF_SQ_RING);
+        if (sqRing_ == NULL) {
+            return false;
+        }
+        cqRing_ = singleMmap ? sqRing_ : mapRing(cqRingSize_, IORING_OFF_CQ_RING);
+        if (cqRing_ == NULL) {
+            return false;
+        }
+        sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(mapRing(sqesSize_, IORING_OFF_SQES));
+        if (sqes_ == NULL) {
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sqRing_);
+        sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        char* cq = static_cast<char*>(cqRing_);
+        cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        localTail_ = *sqTail_;
+
+        // Registration pins the buffers; if the memlock limit refuses,
+        // plain IORING_OP_READ into the same buffers still works
+        std::vector<iovec> iovecs(slotCount);
+        for (unsigned i = 0; i < slotCount; ++i) {
+            iovecs[i].iov_base = buffers + static_cast<size_t>(i) * blockSize;
+            iovecs[i].iov_len = blockSize;
+        }
+        registered_ = syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_BUFFERS,
+                              iovecs.data(), slotCount) == 0;
+
+        // A ring can exist without the opcodes we need: IORING_OP_READ
+        // arrived in 5.6, along with the probe itself, and READ_FIXED is
+        // useless without registered buffers
+        bool canRead = false;
+        bool canReadFixed = false;
+        if (!probe(canRead, canReadFixed)) {
+            canReadFixed = true;   // pre-5.6 kernel: READ_FIXED (5.1) but no plain READ
+        }
+        if (registered_ && canReadFixed) {
+            opcode_ = IORING_OP_READ_FIXED;
+        } else if (canRead) {
+            registered_ = false;
+            opcode_ = IORING_OP_READ;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool isRegistered() const { return registered_; }
+
+    virtual void submit(unsigned slot, int fd, char* buffer, size_t length, uint64_t offset) {
+        unsigned index = localTail_ & sqMask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode_;
+        sqe->fd = fd;
+        sqe->off = offset;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = static_cast<unsigned>(length);
+        if (registered_) {
+            sqe->buf_index = static_cast<uint16_t>(slot);
+        }
+        sqe->user_data = slot;
+        sqArray_[index] = index;
+        localTail_++;
+        pending_++;
+    }
+
+    virtual bool complete(unsigned* slot, long* result) {
+        for (;;) {
+            unsigned head = *cqHead_;
+            bool cqEmpty = head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+
+            // Hand new reads to the kernel before consuming, so the queue
+            // stays full while the caller parses the completed block
+            if (pending_ > 0 || cqEmpty) {
+                __atomic_store_n(sqTail_, localTail_, __ATOMIC_RELEASE);
+                unsigned minComplete = cqEmpty ? 1 : 0;
+                long submitted = syscall(__NR_io_uring_enter, ringFd_, pending_, minComplete,
+                                         minComplete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+                if (submitted < 0) {
+                    if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                        continue;
+                    }
+                    return false;
+                }
+                pending_ -= static_cast<unsigned>(submitted);
+                if (cqEmpty) {
+                    continue;
+                }
+            }
+
+            io_uring_cqe* cqe = &cqes_[head & cqMask_];
+            *slot = static_cast<unsigned>(cqe->user_data);
+            *result = cqe->res;
+            __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+    }
+
+private:
+    int ringFd_;
+    void* sqRing_;
+    void* cqRing_;
+    io_uring_sqe* sqes_;
+    size_t sqRingSize_;
+    size_t cqRingSize_;
+    size_t sqesSize_;
+
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned* sqArray_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+
+    unsigned localTail_;
+    unsigned pending_;
+    bool registered_;
+    uint8_t opcode_;
+
+    /**
+     * Ask the kernel which read opcodes the ring supports
+     * @return false if the kernel cannot be probed
+     */
+    bool probe(bool& canRead, bool& canReadFixed) const {
+        const unsigned opCount = 256;
+        std::vector<char> storage(sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* ops = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_PROBE, ops, opCount) != 0) {
+            return false;
+        }
+        canRead = supports(*ops, IORING_OP_READ);
+        canReadFixed = supports(*ops, IORING_OP_READ_FIXED);
+        return true;
+    }
+
+    static bool supports(const io_uring_probe& ops, unsigned opcode) {
+        return opcode <= ops.last_op && opcode < ops.ops_len &&
+               (ops.ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    void* mapRing(size_t size, off_t offset) {
+        void* ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, offset);
+        return ring == MAP_FAILED ? NULL : ring;
+    }
+};
+
+#endif // TRACE_READER_HAVE_IO_URING
+
+// ============================================
+// Scheduler
+// ============================================
+
+struct AsyncTraceReader::FileState {
+    int fd;
+    uint64_t endOffset;      // file size, or where a read error truncated it
+    uint64_t submitOffset;   // next offset to request
+    uint64_t deliverOffset;  // next offset the handler expects
+    unsigned inFlight;
+    bool failed;
+    std::vector<unsigned> slots;
+};
+
+struct AsyncTraceReader::Slot {
+    size_t file;
+    uint64_t offset;
+    size_t length;
+    size_t filled;
+    bool ready;
+};
+
+AsyncTraceReader::AsyncTraceReader(const TraceReaderOptions& options)
+    : options_(options)
+    , buffers_(NULL)
+    , usingIoUring_(false)
+    , registeredBuffers_(false)
+    , bytesRead_(0)
+    , filesFailed_(0)
+{
+    if (options_.queueDepth == 0) {
+        options_.queueDepth = 1;
+    }
+    if (options_.maxInFlightPerFile == 0) {
+        options_.maxInFlightPerFile = 1;
+    }
+    if (options_.blockSize < 4096) {
+        options_.blockSize = 4096;
+    }
+    // Page-aligned so the buffers are also usable for O_DIRECT callers
+    void* memory = NULL;
+    if (posix_memalign(&memory, 4096, options_.blockSize * options_.queueDepth) == 0) {
+        buffers_ = static_cast<char*>(memory);
+    }
+}
+
+AsyncTraceReader::~AsyncTraceReader() {
+    std::free(buffers_);
+}
+
+bool AsyncTraceReader::run(const std::vector<std::string>& paths, TraceBlockHandler& handler) {
+    bytesRead_ = 0;
+    filesFailed_ = 0;
+    usingIoUring_ = false;
+    registeredBuffers_ = false;
+
+    if (buffers_ == NULL) {
+        for (size_t i = 0; i < paths.size(); ++i) {
+            handler.onFileEnd(i);
+        }
+        filesFailed_ = paths.size();
+        return paths.empty();
+    }
+
+    const unsigned depth = options_.queueDepth;
+    Backend* backend = NULL;
+#ifdef TRACE_READER_HAVE_IO_URING
+    if (options_.useIoUring) {
+        UringBackend* uring = new UringBackend();
+        if (uring->init(depth, buffers_, options_.blockSize, depth)) {
+            backend = uring;
+            usingIoUring_ = true;
+            registeredBuffers_ = uring->isRegistered();
+        } else {
+            delete uring;
+        }
+    }
+#endif
+    if (backend == NULL) {
+        backend = new SyncBackend();
+    }
+
+    std::vector<FileState> files(paths.size());
+    std::vector<Slot> slots(depth);
+    std::vector<unsigned> freeSlots;
+    for (unsigned i = depth; i > 0; --i) {
+        freeSlots.push_back(i - 1);
+    }
+    std::vector<size_t> active;
+    size_t nextFile = 0;
+    unsigned inFlight = 0;
+
+    for (;;) {
+        // Keep the queue full: top up open files first, then open new ones
+        bool progress = true;
+        while (!freeSlots.empty() && progress) {
+            progress = false;
+            for (size_t i = 0; i < active.size() && !freeSlots.empty(); ++i) {
+                FileState& file = files[active[i]];
+                if (file.failed || file.inFlight >= options_.maxInFlightPerFile ||
+                    file.submitOffset >= file.endOffset) {
+                    continue;
+                }
+                unsigned slotIndex = freeSlots.back();
+                freeSlots.pop_back();
+                Slot& slot = slots[slotIndex];
+                slot.file = active[i];
+                slot.offset = file.submitOffset;
+                slot.length = static_cast<size_t>(
+                    std::min<uint64_t>(options_.blockSize, file.endOffset - file.submitOffset));
+                slot.filled = 0;
+                slot.ready = false;
+                backend->submit(slotIndex, file.fd, buffers_ + slotIndex * options_.blockSize,
+                                slot.length, slot.offset);
+                file.submitOffset += slot.length;
+                file.inFlight++;
+                file.slots.push_back(slotIndex);
+                inFlight++;
+                progress = true;
+            }
+
+            if (!progress && nextFile < paths.size() && active.size() < depth) {
+                size_t index = nextFile++;
+                FileState& file = files[index];
+                file.fd = ::open(paths[index].c_str(), O_RDONLY | O_CLOEXEC);
+                file.endOffset = 0;
+                file.submitOffset = 0;
+                file.deliverOffset = 0;
+                file.inFlight = 0;
+                file.failed = file.fd < 0;
+
+                struct stat info;
+                if (!file.failed && ::fstat(file.fd, &info) == 0) {
+                    file.endOffset = static_cast<uint64_t>(info.st_size);
+                } else {
+                    file.failed = true;
+                }
+
+                if (file.failed || file.endOffset == 0) {
+                    if (file.fd >= 0) {
+                        ::close(file.fd);
+                    }
+                    if (file.failed) {
+                        filesFailed_++;
+                    }
+                    handler.onFileEnd(index);
+                } else {
+                    active.push_back(index);
+                }
+                progress = true;
+            }
+        }
+
+        if (inFlight == 0) {
+            if (nextFile >= paths.size()) {
+                break;
+            }
+            continue;
+        }
+
+        unsigned slotIndex = 0;
+        long result = 0;
+        if (!backend->complete(&slotIndex, &result)) {
+            break;
+        }
+
+        Slot& slot = slots[slotIndex];
+        FileState& file = files[slot.file];
+        if (result > 0) {
+            slot.filled += static_cast<size_t>(result);
+            bytesRead_ += static_cast<uint64_t>(result);
+            if (slot.filled < slot.length && !file.failed) {
+                // Short read: fetch the rest into the same slot
+                backend->submit(slotIndex, file.fd, buffers_ + slotIndex * options_.blockSize + slot.filled,
+                                slot.length - slot.filled, slot.offset + slot.filled);
+                continue;
+            }
+        } else if (result == -EINTR || result == -EAGAIN) {
+            backend->submit(slotIndex, file.fd, buffers_ + slotIndex * options_.blockSize + slot.filled,
+                            slot.length - slot.filled, slot.offset + slot.filled);
+            continue;
+        }
+
+        if (slot.filled < slot.length) {
+            // Error or unexpected EOF: keep what precedes it, drop the rest
+            file.failed = true;
+            file.endOffset = std::min(file.endOffset, slot.offset + slot.filled);
+        }
+        slot.ready = true;
+
+        // Deliver this file's blocks that are now in order
+        bool delivered = true;
+        while (delivered) {
+            delivered = false;
+            for (size_t i = 0; i < file.slots.size(); ++i) {
+                Slot& candidate = slots[file.slots[i]];
+                if (!candidate.ready) {
+                    continue;
+                }
+                bool inOrder = candidate.offset == file.deliverOffset && candidate.offset < file.endOffset;
+                if (!inOrder && candidate.offset < file.endOffset) {
+                    continue;
+                }
+                if (inOrder) {
+                    handler.onBlock(slot.file, buffers_ + file.slots[i] * options_.blockSize, candidate.filled);
+                    file.deliverOffset += candidate.filled;
+                }
+                freeSlots.push_back(file.slots[i]);
+                file.slots.erase(file.slots.begin() + i);
+                file.inFlight--;
+                inFlight--;
+                delivered = true;
+                break;
+            }
+        }
+
+        if (file.inFlight == 0 && (file.failed || file.deliverOffset >= file.endOffset)) {
+            ::close(file.fd);
+            if (file.failed) {
+                filesFailed_++;
+            }
+            handler.onFileEnd(slot.file);
+            active.erase(std::find(active.begin(), active.end(), slot.file));
+        }
+    }
+
+    // Backend failure: report whatever is still open as failed
+    for (size_t i = 0; i < active.size(); ++i) {
+        ::close(files[active[i]].fd);
+        filesFailed_++;
+        handler.onFileEnd(active[i]);
+    }
+    for (size_t i = nextFile; i < paths.size(); ++i) {
+        filesFailed_++;
+        handler.onFileEnd(i);
+    }
+
+    delete backend;
+    return filesFailed_ == 0;
+}
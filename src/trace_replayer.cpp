@@ -0,0 +1,272 @@
+#include "trace_replayer.h"
+#include "config.h"
+
+namespace {
+
+/**
+ * What update() did with a sample, from the debouncer state before and after
+ */
+template<typename Debouncer, typename T>
+uint8_t classifyUpdate(const Debouncer& debouncer, T tolerance, bool hadReading, bool wasStable,
+                       unsigned long previousSampleMs, T previousReading, T reading, unsigned long timeMs) {
+    if (hadReading && (timeMs - previousSampleMs) < debouncer.getSampleIntervalMs()) {
+        return DEBOUNCE_EVENT_SKIPPED;
+    }
+    if (!debouncer.hasValidReading()) {
+        return DEBOUNCE_EVENT_INVALID_RESET;
+    }
+    if (!hadReading) {
+        return DEBOUNCE_EVENT_FIRST_READING;
+    }
+    if (!wasStable && debouncer.isStable()) {
+        return DEBOUNCE_EVENT_STABLE;
+    }
+    T diff = reading - previousReading;
+    if (diff < T()) diff = -diff;
+    return diff > tolerance ? DEBOUNCE_EVENT_TOLERANCE_RESET : DEBOUNCE_EVENT_ACCEPTED;
+}
+
+/**
+ * Feed the noise estimator with a processed sample's step from the previous
+ * reading, if the two belong to a stable period: consecutive valid readings
+ * no further apart than the largest approved tolerance
+ */
+template<typename T>
+bool observeNoise(AdaptiveTolerance<T>& tuner, uint8_t type, T previousReading, T reading) {
+    if (type != DEBOUNCE_EVENT_ACCEPTED && type != DEBOUNCE_EVENT_STABLE && type != DEBOUNCE_EVENT_TOLERANCE_RESET) {
+        return false;
+    }
+    T diff = reading - previousReading;
+    if (diff < T()) diff = -diff;
+    if (diff > tuner.getMaxTolerance()) {
+        return false;   // settling, or a new patient
+    }
+    tuner.observe(previousReading, reading);
+    return tuner.isWarm();
+}
+
+} // namespace
+
+// ============================================
+// TraceReplayer
+// ============================================
+
+TraceReplayer::TraceReplayer(const HeightDebouncer& height, const ReadingDebouncer<float>& bpm,
+                             const ReadingDebouncer<int>& spo2, StabilityTransitionSink* sink)
+    : height_(height)
+    , bpm_(bpm)
+    , spo2_(spo2)
+    , sink_(sink)
+    , eventSink_(NULL)
+    , heightTolerance_(ADAPTIVE_TOLERANCE_MIN_CM, ADAPTIVE_TOLERANCE_MAX_CM, ADAPTIVE_TOLERANCE_SIGMAS)
+    , bpmTolerance_(ADAPTIVE_BPM_TOLERANCE_MIN, ADAPTIVE_BPM_TOLERANCE_MAX, ADAPTIVE_TOLERANCE_SIGMAS)
+    , spo2Tolerance_(ADAPTIVE_SPO2_TOLERANCE_MIN, ADAPTIVE_SPO2_TOLERANCE_MAX, ADAPTIVE_TOLERANCE_SIGMAS)
+    , adaptive_(false)
+    , samplesProcessed_(0)
+    , transitionCount_(0)
+{
+}
+
+TraceReplayer::TraceReplayer(StabilityTransitionSink* sink)
+    : TraceReplayer(HeightDebouncer(),
+                    ReadingDebouncer<float>(BPM_TOLERANCE, BPM_STABILITY_DURATION_MS, BPM_SAMPLE_INTERVAL_MS,
+                                            BPM_MIN_VALID, BPM_MAX_VALID),
+                    ReadingDebouncer<int>(SPO2_TOLERANCE, SPO2_STABILITY_DURATION_MS, SPO2_SAMPLE_INTERVAL_MS,
+                                          SPO2_MIN_VALID, SPO2_MAX_VALID),
+                    sink)
+{
+}
+
+void TraceReplayer::onSample(const TraceSample& sample) {
+    samplesProcessed_++;
+
+    switch (sample.channel) {
+    case CHANNEL_HEIGHT: {
+        bool wasStable = height_.isStable();
+        int previous = height_.getStableReading();
+        bool hadReading = height_.hasValidReading();
+        unsigned long previousSampleMs = height_.getLastSampleTime();
+        int previousReading = height_.getLastReading();
+        height_.update(static_cast<int>(sample.value), sample.timeMs);
+        if (eventSink_ != NULL || adaptive_) {
+            uint8_t type = classifyUpdate(height_, height_.getToleranceCm(), hadReading, wasStable, previousSampleMs,
+                                          previousReading, static_cast<int>(sample.value), sample.timeMs);
+            if (eventSink_ != NULL) {
+                reportEvent(sample, type);
+            }
+            if (adaptive_ && observeNoise(heightTolerance_, type, previousReading, static_cast<int>(sample.value))) {
+                height_.setToleranceCm(heightTolerance_.getTolerance(height_.getToleranceCm()));
+            }
+        }
+        if (height_.isStable() != wasStable) {
+            report(sample, height_.isStable(),
+                   height_.isStable() ? static_cast<float>(height_.getStableReading()) : sample.value);
+        } else if (wasStable && height_.getStableReading() != previous) {
+            reportUpdate(sample, static_cast<float>(height_.getStableReading()));
+        }
+        break;
+    }
+    case CHANNEL_BPM: {
+        bool wasStable = bpm_.isStable();
+        float previous = bpm_.getStableReading();
+        bool hadReading = bpm_.hasValidReading();
+        unsigned long previousSampleMs = bpm_.getLastSampleTime();
+        float previousReading = bpm_.getLastReading();
+        bpm_.update(sample.value, sample.timeMs);
+        if (eventSink_ != NULL || adaptive_) {
+            uint8_t type = classifyUpdate(bpm_, bpm_.getTolerance(), hadReading, wasStable, previousSampleMs,
+                                          previousReading, sample.value, sample.timeMs);
+            if (eventSink_ != NULL) {
+                reportEvent(sample, type);
+            }
+            if (adaptive_ && observeNoise(bpmTolerance_, type, previousReading, sample.value)) {
+                bpm_.setTolerance(bpmTolerance_.getTolerance(bpm_.getTolerance()));
+            }
+        }
+        if (bpm_.isStable() != wasStable) {
+            report(sample, bpm_.isStable(), bpm_.isStable() ? bpm_.getStableReading() : sample.value);
+        } else if (wasStable && bpm_.getStableReading() != previous) {
+            reportUpdate(sample, bpm_.getStableReading());
+        }
+        break;
+    }
+    case CHANNEL_SPO2: {
+        bool wasStable = spo2_.isStable();
+        int previous = spo2_.getStableReading();
+        bool hadReading = spo2_.hasValidReading();
+        unsigned long previousSampleMs = spo2_.getLastSampleTime();
+        int previousReading = spo2_.getLastReading();
+        spo2_.update(static_cast<int>(sample.value), sample.timeMs);
+        if (eventSink_ != NULL || adaptive_) {
+            uint8_t type = classifyUpdate(spo2_, spo2_.getTolerance(), hadReading, wasStable, previousSampleMs,
+                                          previousReading, static_cast<int>(sample.value), sample.timeMs);
+            if (eventSink_ != NULL) {
+                reportEvent(sample, type);
+            }
+            if (adaptive_ && observeNoise(spo2Tolerance_, type, previousReading, static_cast<int>(sample.value))) {
+                spo2_.setTolerance(spo2Tolerance_.getTolerance(spo2_.getTolerance()));
+            }
+        }
+        if (spo2_.isStable() != wasStable) {
+            report(sample, spo2_.isStable(),
+                   spo2_.isStable() ? static_cast<float>(spo2_.getStableReading()) : sample.value);
+        } else if (wasStable && spo2_.getStableReading() != previous) {
+            reportUpdate(sample, static_cast<float>(spo2_.getStableReading()));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void TraceReplayer::reset() {
+    height_.reset();
+    bpm_.reset();
+    spo2_.reset();
+    samplesProcessed_ = 0;
+    transitionCount_ = 0;
+}
+
+void TraceReplayer::restore(const HeightDebouncer::Checkpoint& height, const ReadingDebouncer<float>::Checkpoint& bpm,
+                            const ReadingDebouncer<int>::Checkpoint& spo2) {
+    height_.restore(height);
+    bpm_.restore(bpm);
+    spo2_.restore(spo2);
+}
+
+void TraceReplayer::report(const TraceSample& sample, bool stable, float value) {
+    transitionCount_++;
+    if (sink_ == NULL) {
+        return;
+    }
+    StabilityTransition transition;
+    transition.deviceId = sample.deviceId;
+    transition.timeMs = sample.timeMs;
+    transition.value = value;
+    transition.channel = sample.channel;
+    transition.stable = stable;
+    sink_->onTransition(transition);
+}
+
+void TraceReplayer::reportUpdate(const TraceSample& sample, float value) {
+    if (sink_ == NULL) {
+        return;
+    }
+    StabilityTransition update;
+    update.deviceId = sample.deviceId;
+    update.timeMs = sample.timeMs;
+    update.value = value;
+    update.channel = sample.channel;
+    update.stable = true;
+    sink_->onStableUpdate(update);
+}
+
+void TraceReplayer::reportEvent(const TraceSample& sample, uint8_t type) {
+    DebounceEvent event;
+    event.deviceId = sample.deviceId;
+    event.timeMs = sample.timeMs;
+    event.value = sample.value;
+    event.channel = sample.channel;
+    event.type = type;
+    eventSink_->onDebounceEvent(event);
+}
+
+// ============================================
+// TraceFileReplay
+// ============================================
+
+TraceFileReplay::TraceFileReplay(const HeightDebouncer& height, const ReadingDebouncer<float>& bpm,
+                                 const ReadingDebouncer<int>& spo2, StabilityTransitionSink* sink)
+    : prototype_(height, bpm, spo2, sink)
+    , filesCompleted_(0)
+    , samplesProcessed_(0)
+    , transitionCount_(0)
+    , linesParsed_(0)
+    , linesSkipped_(0)
+{
+}
+
+TraceFileReplay::TraceFileReplay(StabilityTransitionSink* sink)
+    : prototype_(sink)
+    , filesCompleted_(0)
+    , samplesProcessed_(0)
+    , transitionCount_(0)
+    , linesParsed_(0)
+    , linesSkipped_(0)
+{
+}
+
+TraceFileReplay::~TraceFileReplay() {
+    for (size_t i = 0; i < streams_.size(); ++i) {
+        delete streams_[i];
+    }
+}
+
+void TraceFileReplay::onBlock(size_t fileIndex, const char* data, size_t length) {
+    streamFor(fileIndex)->parser.feed(data, length);
+}
+
+void TraceFileReplay::onFileEnd(size_t fileIndex) {
+    Stream* stream = streamFor(fileIndex);
+    stream->parser.finish();
+
+    filesCompleted_++;
+    samplesProcessed_ += stream->replayer.getSamplesProcessed();
+    transitionCount_ += stream->replayer.getTransitionCount();
+    linesParsed_ += stream->parser.getLinesParsed();
+    linesSkipped_ += stream->parser.getLinesSkipped();
+
+    delete stream;
+    streams_[fileIndex] = NULL;
+}
+
+TraceFileReplay::Stream* TraceFileReplay::streamFor(size_t fileIndex) {
+    if (fileIndex >= streams_.size()) {
+        streams_.resize(fileIndex + 1, NULL);
+    }
+    if (streams_[fileIndex] == NULL) {
+        streams_[fileIndex] = new Stream(prototype_, static_cast<uint32_t>(fileIndex));
+    }
+    return streams_[fileIndex];
+}
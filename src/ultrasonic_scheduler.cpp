@@ -0,0 +1,167 @@
+#include "ultrasonic_scheduler.h"
+#include "config.h"
+
+// ============================================
+// UltrasonicSchedulerConfig
+// ============================================
+
+UltrasonicSchedulerConfig::UltrasonicSchedulerConfig()
+    : heads(1)
+    , frameUs(DEBOUNCE_SAMPLE_INTERVAL_MS * 1000UL)
+    , guardUs(ULTRASONIC_GUARD_US)
+    , echoTimeoutUs(ULTRASONIC_ECHO_TIMEOUT_US)
+{
+    for (int i = 0; i < ULTRASONIC_MAX_HEADS; ++i) {
+        hears[i] = static_cast<uint8_t>(((1 << ULTRASONIC_MAX_HEADS) - 1) & ~(1 << i));
+    }
+}
+
+// ============================================
+// UltrasonicScheduler
+// ============================================
+
+UltrasonicScheduler::UltrasonicScheduler(UltrasonicPort* port, const UltrasonicSchedulerConfig& config)
+    : port_(port)
+    , config_(config)
+    , slotCount_(0)
+    , framePeriodUs_(0)
+    , frameStartUs_(0)
+    , nextSlot_(0)
+    , started_(false)
+    , frameReady_(false)
+    , framesCompleted_(0)
+{
+    if (config_.heads == 0) {
+        config_.heads = 1;
+    } else if (config_.heads > ULTRASONIC_MAX_HEADS) {
+        config_.heads = ULTRASONIC_MAX_HEADS;
+    }
+    for (int i = 0; i < ULTRASONIC_MAX_HEADS; ++i) {
+        state_[i] = HEAD_IDLE;
+        riseUs_[i] = 0;
+        distanceCm_[i] = 0;
+    }
+    assignSlots();
+    framePeriodUs_ = config_.frameUs;
+    if (framePeriodUs_ < slotCount_ * config_.guardUs) {
+        framePeriodUs_ = slotCount_ * config_.guardUs;   // the heads cannot fire any faster
+    }
+}
+
+void UltrasonicScheduler::assignSlots() {
+    // Greedy colouring: each head takes the first slot with nobody it can hear or be heard by
+    slotCount_ = 0;
+    for (uint8_t head = 0; head < config_.heads; ++head) {
+        uint8_t slot = 0;
+        for (; slot < slotCount_; ++slot) {
+            bool clash = false;
+            for (uint8_t other = 0; other < head && !clash; ++other) {
+                clash = slots_[other] == slot &&
+                        (((config_.hears[head] >> other) & 1) || ((config_.hears[other] >> head) & 1));
+            }
+            if (!clash) {
+                break;
+            }
+        }
+        slots_[head] = slot;
+        if (slot == slotCount_) {
+            slotCount_++;
+        }
+    }
+}
+
+void UltrasonicScheduler::begin(unsigned long nowUs) {
+    frameStartUs_ = nowUs;
+    nextSlot_ = 0;
+    started_ = true;
+    for (uint8_t head = 0; head < config_.heads; ++head) {
+        state_[head] = HEAD_IDLE;
+    }
+}
+
+bool UltrasonicScheduler::poll(unsigned long nowUs) {
+    if (!started_) {
+        begin(nowUs);
+    }
+
+    bool completed = false;
+    if (nowUs - frameStartUs_ >= framePeriodUs_) {
+        closeFrame(frameStartUs_ + framePeriodUs_);
+        completed = true;
+        frameStartUs_ += framePeriodUs_;
+        if (nowUs - frameStartUs_ >= framePeriodUs_) {
+            frameStartUs_ = nowUs;   // loop() stalled; restart rather than fire a backlog
+        }
+        nextSlot_ = 0;
+    }
+
+    while (nextSlot_ < slotCount_ && nowUs - frameStartUs_ >= nextSlot_ * config_.guardUs) {
+        for (uint8_t head = 0; head < config_.heads; ++head) {
+            if (slots_[head] == nextSlot_) {
+                state_[head] = HEAD_TRIGGERED;
+                distanceCm_[head] = 0;
+                port_->trigger(head);
+            }
+        }
+        nextSlot_++;
+    }
+    return completed;
+}
+
+void UltrasonicScheduler::onEchoEdge(uint8_t head, bool high, unsigned long nowUs) {
+    if (head >= config_.heads) {
+        return;
+    }
+    if (high && state_[head] == HEAD_TRIGGERED) {
+        state_[head] = HEAD_ECHO;
+        riseUs_[head] = nowUs;
+    } else if (!high && state_[head] == HEAD_ECHO) {
+        unsigned long widthUs = nowUs - riseUs_[head];
+        // Rounded like NewPing's ping_cm(); over the timeout means no echo
+        distanceCm_[head] = widthUs <= config_.echoTimeoutUs
+            ? static_cast<int>((widthUs + ULTRASONIC_ROUNDTRIP_US_PER_CM / 2) / ULTRASONIC_ROUNDTRIP_US_PER_CM)
+            : 0;
+        state_[head] = HEAD_DONE;
+    }
+}
+
+bool UltrasonicScheduler::takeFrame(UltrasonicFrame& out) {
+    if (!frameReady_) {
+        return false;
+    }
+    out = frame_;
+    frameReady_ = false;
+    return true;
+}
+
+void UltrasonicScheduler::closeFrame(unsigned long endUs) {
+    int valid[ULTRASONIC_MAX_HEADS];
+    uint8_t count = 0;
+    frame_.timeMs = endUs / 1000UL;
+    frame_.validMask = 0;
+    for (uint8_t head = 0; head < ULTRASONIC_MAX_HEADS; ++head) {
+        bool echoed = head < config_.heads && state_[head] == HEAD_DONE && distanceCm_[head] > 0;
+        frame_.distanceCm[head] = echoed ? distanceCm_[head] : 0;
+        if (!echoed) {
+            continue;
+        }
+        frame_.validMask |= static_cast<uint8_t>(1 << head);
+        uint8_t j = count++;
+        for (; j > 0 && valid[j - 1] > distanceCm_[head]; --j) {
+            valid[j] = valid[j - 1];
+        }
+        valid[j] = distanceCm_[head];
+    }
+    if (count == 0) {
+        frame_.fusedCm = 0;
+    } else if (count & 1) {
+        frame_.fusedCm = valid[count / 2];
+    } else {
+        frame_.fusedCm = (valid[count / 2 - 1] + valid[count / 2] + 1) / 2;
+    }
+    for (uint8_t head = 0; head < config_.heads; ++head) {
+        state_[head] = HEAD_IDLE;
+    }
+    frameReady_ = true;
+    framesCompleted_++;
+}
@@ -0,0 +1,34 @@
+/*
+ * Built as C to keep apptech_debounce.h usable from plain C (and so from
+ * cgo, cffi and friends). Called from test_apptech_debounce.cpp.
+ */
+
+#include "apptech_debounce.h"
+
+int apptech_debounce_c_check(void) {
+    apptech_debounce_config config;
+    apptech_debouncer* debouncer = NULL;
+    apptech_transition transitions[4];
+    double values[40];
+    uint64_t times[40];
+    size_t written = 0;
+    size_t consumed = 0;
+    size_t i;
+    int status;
+
+    if (apptech_debounce_config_default(APPTECH_KIND_HEIGHT, &config) != APPTECH_OK ||
+        apptech_debouncer_create(&config, &debouncer) != APPTECH_OK) {
+        return 1;
+    }
+    for (i = 0; i < 40; ++i) {
+        values[i] = 120.0;
+        times[i] = (uint64_t)i * 100;
+    }
+    status = apptech_debouncer_update(debouncer, values, times, 40, transitions, 4, &written, &consumed);
+    apptech_debouncer_destroy(debouncer);
+    if (status != APPTECH_OK || consumed != 40 || written != 1 ||
+        transitions[0].type != APPTECH_TRANSITION_STABLE || transitions[0].value != 120.0) {
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "adaptive_tolerance.h"
+#include "config.h"
+#include "trace_replayer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+class StableCounter : public StabilityTransitionSink {
+public:
+    StableCounter() : stable(0) {}
+
+    virtual void onTransition(const StabilityTransition& transition) {
+        stable += transition.stable ? 1 : 0;
+    }
+
+    int stable;
+};
+
+/**
+ * A patient standing still for durationMs on a station with the given noise
+ */
+void standStill(TraceReplayer& replayer, std::mt19937& rng, float noiseCm, float heightCm, unsigned long fromMs,
+                unsigned long durationMs) {
+    std::normal_distribution<float> noise(0.0f, noiseCm);
+    TraceSample sample;
+    sample.deviceId = 1;
+    sample.channel = CHANNEL_HEIGHT;
+    for (unsigned long t = fromMs; t < fromMs + durationMs; t += DEBOUNCE_SAMPLE_INTERVAL_MS) {
+        sample.timeMs = t;
+        sample.value = std::round(heightCm + noise(rng));
+        replayer.onSample(sample);
+    }
+}
+
+// ============================================
+// AdaptiveTolerance
+// ============================================
+
+TEST(test_estimates_gaussian_noise) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 1.5f);
+    AdaptiveTolerance<float> tuner(0.5f, 20.0f, 3.0f, 32, 1.0f / 256.0f);
+    ASSERT_FALSE(tuner.isWarm());
+    ASSERT_TRUE(tuner.getTolerance(5.0f) == 5.0f);
+
+    float previous = noise(rng);
+    for (int i = 0; i < 20000; ++i) {
+        float current = noise(rng);
+        tuner.observe(previous, current);
+        previous = current;
+    }
+    ASSERT_TRUE(tuner.isWarm());
+    ASSERT_TRUE(std::fabs(tuner.getNoiseSigma() - 1.5f) < 0.15f);
+    // 3 sigma of the differences: 3 * 1.5 * sqrt(2)
+    ASSERT_TRUE(std::fabs(tuner.getTolerance(5.0f) - 6.36f) < 0.7f);
+}
+
+TEST(test_tolerance_stays_within_bounds) {
+    AdaptiveTolerance<int> quiet(1, 4, 3.0f, 4);
+    for (int i = 0; i < 100; ++i) {
+        quiet.observe(120, 120);
+    }
+    ASSERT_EQ(1, quiet.getTolerance(2));
+
+    AdaptiveTolerance<int> noisy(1, 4, 3.0f, 4);
+    for (int i = 0; i < 100; ++i) {
+        noisy.observe(120, i % 2 == 0 ? 126 : 114);
+    }
+    ASSERT_EQ(4, noisy.getTolerance(2));
+
+    // Before warming up the configured tolerance is used, clamped
+    AdaptiveTolerance<int> cold(1, 4, 3.0f, 4);
+    ASSERT_EQ(4, cold.getTolerance(9));
+    cold.reset();
+    ASSERT_EQ(0ul, cold.getSampleCount());
+}
+
+TEST(test_integer_tolerance_rounds_up) {
+    AdaptiveTolerance<int> tuner(1, 10, 3.0f, 4);
+    for (int i = 0; i < 200; ++i) {
+        tuner.observe(100, i % 2 == 0 ? 101 : 100);   // mean |difference| 0.5
+    }
+    // 3 * 0.5 * sqrt(pi / 2) = 1.88 -> 2
+    ASSERT_EQ(2, tuner.getTolerance(5));
+}
+
+TEST(test_outliers_are_clipped) {
+    std::mt19937 rng(3);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    AdaptiveTolerance<float> tuner(0.5f, 50.0f, 3.0f);
+    float previous = 0.0f;
+    for (int i = 0; i < 5000; ++i) {
+        float current = i % 50 == 0 ? 1000.0f : noise(rng);   // occasional glitch
+        tuner.observe(previous, current);
+        previous = current;
+    }
+    ASSERT_TRUE(tuner.getNoiseSigma() < 1.6f);
+}
+
+// ============================================
+// Replay in adaptive mode
+// ============================================
+
+TEST(test_noisy_station_stabilizes_with_adaptive_tolerance) {
+    std::mt19937 fixedRng(11);
+    std::mt19937 adaptiveRng(11);
+    StableCounter fixedStable;
+    StableCounter adaptiveStable;
+    TraceReplayer fixed(&fixedStable);
+    TraceReplayer adaptive(&adaptiveStable);
+    adaptive.setAdaptiveTolerance(true);
+    ASSERT_TRUE(adaptive.isAdaptiveTolerance());
+
+    standStill(fixed, fixedRng, 1.8f, 170.0f, 0, 60000);
+    standStill(adaptive, adaptiveRng, 1.8f, 170.0f, 0, 60000);
+
+    ASSERT_EQ(0, fixedStable.stable);
+    ASSERT_TRUE(adaptiveStable.stable > 0);
+    ASSERT_EQ(DEBOUNCE_TOLERANCE_CM, fixed.getHeightDebouncer().getToleranceCm());
+    ASSERT_EQ(ADAPTIVE_TOLERANCE_MAX_CM, adaptive.getHeightDebouncer().getToleranceCm());
+    ASSERT_TRUE(adaptive.getHeightTolerance().isWarm());
+
+    // The estimate survives a reset of the debouncers
+    adaptive.reset();
+    ASSERT_TRUE(adaptive.getHeightTolerance().isWarm());
+}
+
+TEST(test_quiet_station_tightens_tolerance) {
+    std::mt19937 rng(5);
+    TraceReplayer replayer(NULL);
+    replayer.setAdaptiveTolerance(true);
+    standStill(replayer, rng, 0.2f, 150.0f, 0, 20000);
+    ASSERT_EQ(ADAPTIVE_TOLERANCE_MIN_CM, replayer.getHeightDebouncer().getToleranceCm());
+    ASSERT_TRUE(replayer.getHeightDebouncer().isStable());
+    ASSERT_TRUE(replayer.getHeightTolerance().getNoiseSigma() < 0.5f);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Adaptive Tolerance Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_estimates_gaussian_noise);
+    RUN_TEST(test_tolerance_stays_within_bounds);
+    RUN_TEST(test_integer_tolerance_rounds_up);
+    RUN_TEST(test_outliers_are_clipped);
+    RUN_TEST(test_noisy_station_stabilizes_with_adaptive_tolerance);
+    RUN_TEST(test_quiet_station_tightens_tolerance);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,314 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "alert_rules.h"
+#include "trace_replayer.h"
+
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+void transition(AlertRuleEngine& engine, uint32_t stationId, uint8_t channel, bool stable, float value,
+                unsigned long timeMs) {
+    StabilityTransition t;
+    t.deviceId = stationId;
+    t.timeMs = timeMs;
+    t.value = value;
+    t.channel = channel;
+    t.stable = stable;
+    engine.onTransition(t);
+}
+
+void reading(AlertRuleEngine& engine, uint32_t stationId, uint8_t channel, uint8_t type, float value,
+             unsigned long timeMs) {
+    DebounceEvent event;
+    event.deviceId = stationId;
+    event.timeMs = timeMs;
+    event.value = value;
+    event.channel = channel;
+    event.type = type;
+    engine.onDebounceEvent(event);
+}
+
+TraceReplayer makeReplayer(AlertRuleEngine* engine) {
+    TraceReplayer replayer(HeightDebouncer(2, 1000, 100), ReadingDebouncer<float>(3.0f, 1000, 100, 40.0f, 200.0f),
+                           ReadingDebouncer<int>(1, 1000, 100, 50, 100), engine);
+    replayer.setEventSink(engine);
+    return replayer;
+}
+
+// ============================================
+// Compiler
+// ============================================
+
+TEST(test_compiles_rules_to_postfix_code) {
+    AlertRuleProgram program;
+    ASSERT_TRUE(compileAlertRule("SpO2 stable < 90 for 10 s", program));
+    ASSERT_EQ(1u, program.code.size());
+    ASSERT_EQ(ALERT_OP_STABLE_CMP, program.code[0].op);
+    ASSERT_EQ(CHANNEL_SPO2, program.code[0].channel);
+    ASSERT_EQ(ALERT_CMP_LT, program.code[0].compare);
+    ASSERT_TRUE(program.code[0].constant == 90.0f);
+    ASSERT_EQ(10000ul, program.holdMs);
+    ASSERT_EQ(1u, program.depth);
+
+    ASSERT_TRUE(compileAlertRule("BPM stable > 120 while height session active", program));
+    ASSERT_EQ(3u, program.code.size());
+    ASSERT_EQ(ALERT_OP_STABLE_CMP, program.code[0].op);
+    ASSERT_EQ(ALERT_OP_ACTIVE, program.code[1].op);
+    ASSERT_EQ(CHANNEL_HEIGHT, program.code[1].channel);
+    ASSERT_EQ(ALERT_OP_AND, program.code[2].op);
+    ASSERT_EQ(0ul, program.holdMs);
+    ASSERT_EQ(2u, program.depth);
+
+    // and binds tighter than or; not applies to the parenthesized group
+    ASSERT_TRUE(compileAlertRule("not (height stable or height active) and bpm >= -1.5 for 2 min", program));
+    ASSERT_EQ(6u, program.code.size());
+    ASSERT_EQ(ALERT_OP_STABLE, program.code[0].op);
+    ASSERT_EQ(ALERT_OP_ACTIVE, program.code[1].op);
+    ASSERT_EQ(ALERT_OP_OR, program.code[2].op);
+    ASSERT_EQ(ALERT_OP_NOT, program.code[3].op);
+    ASSERT_EQ(ALERT_OP_READING_CMP, program.code[4].op);
+    ASSERT_EQ(ALERT_CMP_GE, program.code[4].compare);
+    ASSERT_TRUE(program.code[4].constant == -1.5f);
+    ASSERT_EQ(ALERT_OP_AND, program.code[5].op);
+    ASSERT_EQ(120000ul, program.holdMs);
+}
+
+TEST(test_rejects_malformed_rules) {
+    AlertRuleProgram program;
+    std::string error;
+    ASSERT_FALSE(compileAlertRule("pulse > 120", program, &error));
+    ASSERT_TRUE(error == "expected height, bpm or spo2 at column 1");
+    ASSERT_FALSE(compileAlertRule("spo2 stable <", program, &error));
+    ASSERT_TRUE(error == "expected a number at column 14");
+    ASSERT_FALSE(compileAlertRule("(bpm stable", program, &error));
+    ASSERT_TRUE(error == "expected ) at column 12");
+    ASSERT_FALSE(compileAlertRule("bpm stable for 10 h", program, &error));
+    ASSERT_TRUE(error == "expected ms, s or min at column 19");
+    ASSERT_FALSE(compileAlertRule("bpm stable bpm active", program, &error));
+    ASSERT_TRUE(error == "unexpected text at column 12");
+    ASSERT_FALSE(compileAlertRule("", program, &error));
+    ASSERT_TRUE(program.code.empty());
+
+    // Right-nested terms keep one operand per level on the stack
+    std::string deep = "bpm stable";
+    for (int i = 0; i < ALERT_RULE_MAX_DEPTH; ++i) {
+        deep = "bpm active and (" + deep + ")";
+    }
+    ASSERT_FALSE(compileAlertRule(deep, program, &error));
+    ASSERT_TRUE(error.find("rule nests too deeply") == 0);
+}
+
+// ============================================
+// Evaluation
+// ============================================
+
+TEST(test_hold_raises_after_duration_and_clears) {
+    AlertRuleEngine engine;
+    ASSERT_TRUE(engine.addRule("low-spo2", "spo2 stable < 90 for 10 s"));
+    std::vector<AlertEvent> events;
+
+    reading(engine, 3, CHANNEL_SPO2, DEBOUNCE_EVENT_FIRST_READING, 88.0f, 0);
+    transition(engine, 3, CHANNEL_SPO2, true, 88.0f, 2000);
+    unsigned long t = 2000;
+    for (; t <= 11000; t += 100) {
+        reading(engine, 3, CHANNEL_SPO2, DEBOUNCE_EVENT_ACCEPTED, 88.0f, t);
+        ASSERT_EQ(0u, engine.evaluate(events));
+    }
+    reading(engine, 3, CHANNEL_SPO2, DEBOUNCE_EVENT_ACCEPTED, 88.0f, 12500);
+    ASSERT_EQ(1u, engine.evaluate(events));
+    ASSERT_EQ(3u, events[0].stationId);
+    ASSERT_EQ(0u, events[0].rule);
+    ASSERT_EQ(12000ul, events[0].timeMs);   // 10 s after it became stable
+    ASSERT_TRUE(events[0].raised);
+    ASSERT_TRUE(engine.isFiring(0, 3));
+    ASSERT_EQ(1u, engine.getFiringCount(0));
+
+    // Still low: no repeat
+    reading(engine, 3, CHANNEL_SPO2, DEBOUNCE_EVENT_ACCEPTED, 88.0f, 13000);
+    ASSERT_EQ(0u, engine.evaluate(events));
+
+    transition(engine, 3, CHANNEL_SPO2, true, 95.0f, 14000);
+    ASSERT_EQ(1u, engine.evaluate(events));
+    ASSERT_FALSE(events[1].raised);
+    ASSERT_EQ(14000ul, events[1].timeMs);
+    ASSERT_FALSE(engine.isFiring(0, 3));
+    ASSERT_EQ(0u, engine.getFiringCount(0));
+
+    // A dip shorter than the hold never fires
+    transition(engine, 3, CHANNEL_SPO2, true, 85.0f, 20000);
+    reading(engine, 3, CHANNEL_SPO2, DEBOUNCE_EVENT_ACCEPTED, 85.0f, 25000);
+    ASSERT_EQ(0u, engine.evaluate(events));
+    transition(engine, 3, CHANNEL_SPO2, false, 99.0f, 26000);
+    reading(engine, 3, CHANNEL_SPO2, DEBOUNCE_EVENT_ACCEPTED, 99.0f, 40000);
+    ASSERT_EQ(0u, engine.evaluate(events));
+    ASSERT_EQ(2u, events.size());
+}
+
+TEST(test_rules_over_replayed_debouncers) {
+    AlertRuleEngine engine;
+    ASSERT_TRUE(engine.addRule("tachycardia", "bpm stable > 120 while height session active"));
+    ASSERT_TRUE(engine.addRule("no-session", "not height active"));
+    TraceReplayer replayer = makeReplayer(&engine);
+    std::vector<AlertEvent> events;
+
+    TraceSample sample;
+    sample.deviceId = 11;
+    for (unsigned long t = 0; t <= 3000; t += 100) {
+        sample.timeMs = t;
+        sample.channel = CHANNEL_BPM;
+        sample.value = 130.0f;
+        replayer.onSample(sample);
+    }
+    // BPM is stable and high, but nobody is on the height station yet
+    ASSERT_TRUE(replayer.getBpmDebouncer().isStable());
+    engine.evaluate(events);
+    ASSERT_FALSE(engine.isFiring(0, 11));
+    ASSERT_TRUE(engine.isFiring(1, 11));
+
+    sample.timeMs = 3100;
+    sample.channel = CHANNEL_HEIGHT;
+    sample.value = 172.0f;
+    replayer.onSample(sample);
+    events.clear();
+    ASSERT_EQ(2u, engine.evaluate(events));
+    ASSERT_TRUE(engine.isFiring(0, 11));
+    ASSERT_FALSE(engine.isFiring(1, 11));
+
+    // A dropout ends the BPM session and the alert with it
+    sample.timeMs = 3200;
+    sample.channel = CHANNEL_BPM;
+    sample.value = 0.0f;
+    replayer.onSample(sample);
+    ASSERT_FALSE(engine.test(0, 11));
+    events.clear();
+    ASSERT_EQ(1u, engine.evaluate(events));
+    ASSERT_FALSE(events[0].raised);
+    ASSERT_EQ(3200ul, events[0].timeMs);
+}
+
+TEST(test_batches_match_per_station_interpretation) {
+    AlertRuleEngine engine;
+    const char* rules[] = {
+        "spo2 stable < 92",
+        "bpm stable > 120 and height active",
+        "bpm < 50 or bpm > 150",
+        "not (spo2 stable or spo2 active)",
+        "height stable >= 180 and not bpm stable",
+        "spo2 != 97 and (height stable == 170 or bpm stable <= 60)",
+    };
+    const size_t ruleCount = sizeof(rules) / sizeof(rules[0]);
+    // Half the rules before any station is seen, half after
+    for (size_t r = 0; r < ruleCount / 2; ++r) {
+        ASSERT_TRUE(engine.addRule(rules[r], rules[r]));
+    }
+
+    const uint32_t stations = 3 * ALERT_RULE_BLOCK_STATIONS + 17;
+    uint32_t state = 12345;
+    for (int round = 0; round < 4; ++round) {
+        if (round == 1) {
+            for (size_t r = ruleCount / 2; r < ruleCount; ++r) {
+                ASSERT_TRUE(engine.addRule(rules[r], rules[r]));
+            }
+        }
+        for (uint32_t i = 0; i < stations * 4; ++i) {
+            state = state * 1664525u + 1013904223u;
+            uint32_t stationId = (state >> 8) % stations * 7;
+            uint8_t channel = static_cast<uint8_t>((state >> 4) % SAMPLE_CHANNEL_COUNT);
+            float value = static_cast<float>(40 + (state >> 20) % 150);
+            unsigned long timeMs = 1000UL * round + i;
+            switch ((state >> 2) & 3) {
+            case 0:
+                transition(engine, stationId, channel, (state & 1) != 0, value, timeMs);
+                break;
+            case 1:
+                reading(engine, stationId, channel, DEBOUNCE_EVENT_INVALID_RESET, value, timeMs);
+                break;
+            default:
+                reading(engine, stationId, channel, DEBOUNCE_EVENT_ACCEPTED, value, timeMs);
+                break;
+            }
+        }
+
+        std::vector<AlertEvent> events;
+        engine.evaluate(events);
+        ASSERT_EQ(round == 0 ? ruleCount / 2 : ruleCount, engine.getRuleCount());
+        size_t mismatches = 0;
+        for (size_t r = 0; r < engine.getRuleCount(); ++r) {
+            size_t firing = 0;
+            for (uint32_t s = 0; s < stations; ++s) {
+                bool expected = engine.test(r, s * 7);
+                mismatches += engine.isFiring(r, s * 7) != expected ? 1 : 0;
+                firing += expected ? 1 : 0;
+            }
+            ASSERT_EQ(firing, engine.getFiringCount(r));
+        }
+        ASSERT_EQ(0u, mismatches);
+    }
+    ASSERT_TRUE(engine.getStationCount() > 2 * ALERT_RULE_BLOCK_STATIONS);
+    ASSERT_FALSE(engine.test(0, 1));   // never seen
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Alert Rule Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_compiles_rules_to_postfix_code);
+    RUN_TEST(test_rejects_malformed_rules);
+    RUN_TEST(test_hold_raises_after_duration_and_clears);
+    RUN_TEST(test_rules_over_replayed_debouncers);
+    RUN_TEST(test_batches_match_per_station_interpretation);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,390 @@
+#include <iostream>
+#include <cmath>
+#include <cassert>
+#include <vector>
+#include <stdexcept>
+#include <string>
+#include "apptech_debounce.h"
+#include "height_debouncer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+// Compiled as C in test/apptech_debounce_c_check.c
+extern "C" int apptech_debounce_c_check(void);
+
+struct Batch {
+    std::vector<double> values;
+    std::vector<uint64_t> times;
+
+    void add(double value, uint64_t timeMs) {
+        values.push_back(value);
+        times.push_back(timeMs);
+    }
+};
+
+// 150 cm for 4 s (stable at 3 s), 151 cm, then a jump to 180 cm, every 100 ms
+Batch heightSession() {
+    Batch batch;
+    uint64_t t = 0;
+    for (; t < 4000; t += 100) batch.add(150.0, t);
+    batch.add(151.0, t);
+    t += 100;
+    for (; t < 6000; t += 100) batch.add(180.0, t);
+    return batch;
+}
+
+apptech_debouncer* createDebouncer(uint32_t kind) {
+    apptech_debounce_config config;
+    apptech_debounce_config_default(kind, &config);
+    apptech_debouncer* debouncer = NULL;
+    if (apptech_debouncer_create(&config, &debouncer) != APPTECH_OK) {
+        throw std::runtime_error("apptech_debouncer_create failed");
+    }
+    return debouncer;
+}
+
+// ============================================
+// C ABI Tests
+// ============================================
+
+TEST(test_version_and_defaults) {
+    ASSERT_EQ(static_cast<uint32_t>(APPTECH_DEBOUNCE_ABI_VERSION), apptech_debounce_abi_version());
+    ASSERT_TRUE(std::string(apptech_debounce_strerror(APPTECH_ERR_BUFFER_FULL)) == "transition buffer full");
+
+    apptech_debounce_config config;
+    ASSERT_EQ(APPTECH_OK, apptech_debounce_config_default(APPTECH_KIND_BPM, &config));
+    ASSERT_EQ(sizeof(apptech_debounce_config), static_cast<size_t>(config.struct_size));
+    ASSERT_TRUE(config.tolerance == 5.0);
+    ASSERT_TRUE(config.min_valid == 40.0);
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debounce_config_default(7, &config));
+}
+
+TEST(test_invalid_arguments) {
+    apptech_debounce_config config;
+    apptech_debounce_config_default(APPTECH_KIND_HEIGHT, &config);
+    apptech_debouncer* debouncer = NULL;
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_create(NULL, &debouncer));
+    config.struct_size = 8;
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_create(&config, &debouncer));
+    config.struct_size = sizeof(config);
+    config.kind = 9;
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_create(&config, &debouncer));
+    ASSERT_TRUE(debouncer == NULL);
+
+    debouncer = createDebouncer(APPTECH_KIND_HEIGHT);
+    double value = 150.0;
+    uint64_t time = 0;
+    size_t written = 0;
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_update(debouncer, &value, &time, 1, NULL, 4,
+                                                                     &written, NULL));
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_update(debouncer, NULL, &time, 1, NULL, 0,
+                                                                     &written, NULL));
+    ASSERT_EQ(APPTECH_OK, apptech_debouncer_update(debouncer, &value, &time, 0, NULL, 0, &written, NULL));
+    apptech_debouncer_destroy(debouncer);
+    apptech_debouncer_destroy(NULL);
+}
+
+TEST(test_config_sizes_and_ranges) {
+    apptech_debounce_config config;
+    apptech_debounce_config_default(APPTECH_KIND_SPO2, &config);
+    apptech_debouncer* debouncer = NULL;
+
+    // A v1 caller and a newer caller with fields this library does not know
+    config.struct_size = APPTECH_DEBOUNCE_CONFIG_SIZE_V1;
+    ASSERT_EQ(APPTECH_OK, apptech_debouncer_create(&config, &debouncer));
+    apptech_debouncer_destroy(debouncer);
+    config.struct_size = sizeof(config) + 16;
+    ASSERT_EQ(APPTECH_OK, apptech_debouncer_create(&config, &debouncer));
+    apptech_debouncer_destroy(debouncer);
+    config.struct_size = APPTECH_DEBOUNCE_CONFIG_SIZE_V1 - 8;
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_create(&config, &debouncer));
+    config.struct_size = sizeof(config);
+
+    const double bad[] = { NAN, INFINITY, -INFINITY, 3e9, -3e9 };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        apptech_debounce_config broken = config;
+        broken.tolerance = bad[i];
+        ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_create(&broken, &debouncer));
+        broken = config;
+        broken.max_valid = bad[i];
+        ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_create(&broken, &debouncer));
+    }
+    apptech_debounce_config_default(APPTECH_KIND_BPM, &config);
+    config.min_valid = -1e300;
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_create(&config, &debouncer));
+}
+
+TEST(test_unrepresentable_samples_rejected) {
+    const uint32_t kinds[] = { APPTECH_KIND_HEIGHT, APPTECH_KIND_BPM, APPTECH_KIND_SPO2 };
+    for (size_t k = 0; k < 3; ++k) {
+        apptech_debouncer* debouncer = createDebouncer(kinds[k]);
+        const double bad = kinds[k] == APPTECH_KIND_BPM ? 1e300 : 3e9;
+        double values[] = { 97.0, 97.0, NAN, 97.0 };
+        uint64_t times[] = { 0, 1000, 2000, 3000 };
+        size_t written = 0;
+        size_t consumed = 0;
+        ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_update(debouncer, values, times, 4, NULL, 0,
+                                                                         &written, &consumed));
+        ASSERT_EQ(2u, consumed);
+        values[2] = INFINITY;
+        ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_update(debouncer, &values[2], &times[2], 2,
+                                                                         NULL, 0, &written, &consumed));
+        ASSERT_EQ(0u, consumed);
+        values[2] = bad;
+        ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_update(debouncer, &values[2], &times[2], 2,
+                                                                         NULL, 0, &written, &consumed));
+        values[2] = -bad;
+        ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_debouncer_update(debouncer, &values[2], &times[2], 2,
+                                                                         NULL, 0, &written, &consumed));
+
+        // The rejected samples did not reach the debouncer
+        apptech_debounce_state state;
+        apptech_debouncer_get_state(debouncer, &state);
+        ASSERT_TRUE(state.last_reading == 97.0);
+        apptech_debouncer_destroy(debouncer);
+    }
+
+    apptech_debounce_config config;
+    apptech_debounce_config_default(APPTECH_KIND_HEIGHT, &config);
+    apptech_debouncer_bank* bank = NULL;
+    ASSERT_EQ(APPTECH_OK, apptech_bank_create(&config, 2, &bank));
+    double tick[] = { 150.0, NAN };
+    size_t written = 0;
+    size_t consumed = 0;
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_bank_update_all(bank, tick, 0, NULL, 0, &written, &consumed));
+    ASSERT_EQ(1u, consumed);
+    apptech_bank_destroy(bank);
+}
+
+TEST(test_batch_matches_cpp_debouncer) {
+    Batch batch = heightSession();
+    apptech_debouncer* debouncer = createDebouncer(APPTECH_KIND_HEIGHT);
+    std::vector<apptech_transition> transitions(batch.values.size());
+    size_t written = 0;
+    size_t consumed = 0;
+    ASSERT_EQ(APPTECH_OK, apptech_debouncer_update(debouncer, &batch.values[0], &batch.times[0], batch.values.size(),
+                                                   &transitions[0], transitions.size(), &written, &consumed));
+    ASSERT_EQ(batch.values.size(), consumed);
+
+    // Same decisions as stepping HeightDebouncer directly
+    HeightDebouncer reference;
+    std::vector<size_t> changes;
+    for (size_t i = 0; i < batch.values.size(); ++i) {
+        bool wasStable = reference.isStable();
+        int previous = reference.getStableReading();
+        reference.update(static_cast<int>(batch.values[i]), static_cast<unsigned long>(batch.times[i]));
+        if (reference.isStable() != wasStable || (wasStable && reference.getStableReading() != previous)) {
+            changes.push_back(i);
+        }
+    }
+    ASSERT_EQ(3u, written);
+    ASSERT_EQ(changes.size(), written);
+    for (size_t i = 0; i < written; ++i) {
+        ASSERT_EQ(changes[i], static_cast<size_t>(transitions[i].sample_index));
+    }
+    ASSERT_EQ(static_cast<uint32_t>(APPTECH_TRANSITION_STABLE), transitions[0].type);
+    ASSERT_EQ(3000u, transitions[0].time_ms);
+    ASSERT_TRUE(transitions[0].value == 150.0);
+    ASSERT_EQ(static_cast<uint32_t>(APPTECH_TRANSITION_UPDATE), transitions[1].type);
+    ASSERT_TRUE(transitions[1].value == 151.0);
+    ASSERT_EQ(static_cast<uint32_t>(APPTECH_TRANSITION_UNSTABLE), transitions[2].type);
+    ASSERT_TRUE(transitions[2].value == 180.0);
+
+    apptech_debounce_state state;
+    ASSERT_EQ(APPTECH_OK, apptech_debouncer_get_state(debouncer, &state));
+    ASSERT_EQ(0u, state.stable);
+    ASSERT_TRUE(state.last_reading == 180.0);
+    apptech_debouncer_reset(debouncer);
+    apptech_debouncer_get_state(debouncer, &state);
+    ASSERT_EQ(0u, state.has_reading);
+    apptech_debouncer_destroy(debouncer);
+}
+
+TEST(test_full_buffer_resumes) {
+    Batch batch = heightSession();
+    apptech_debouncer* debouncer = createDebouncer(APPTECH_KIND_HEIGHT);
+
+    // One-slot buffer: drain after each transition and continue
+    std::vector<apptech_transition> collected;
+    size_t offset = 0;
+    int calls = 0;
+    while (offset < batch.values.size()) {
+        apptech_transition slot;
+        size_t written = 0;
+        size_t consumed = 0;
+        int status = apptech_debouncer_update(debouncer, &batch.values[offset], &batch.times[offset],
+                                              batch.values.size() - offset, &slot, 1, &written, &consumed);
+        ASSERT_TRUE(status == APPTECH_OK || status == APPTECH_ERR_BUFFER_FULL);
+        if (written > 0) {
+            slot.sample_index += offset;
+            collected.push_back(slot);
+        }
+        offset += consumed;
+        calls++;
+    }
+    ASSERT_EQ(3u, collected.size());
+    ASSERT_EQ(4, calls);
+    ASSERT_EQ(30u, collected[0].sample_index);
+    ASSERT_EQ(static_cast<uint32_t>(APPTECH_TRANSITION_UNSTABLE), collected[2].type);
+    apptech_debouncer_destroy(debouncer);
+}
+
+TEST(test_reading_debouncer_invalid_reading) {
+    apptech_debouncer* debouncer = createDebouncer(APPTECH_KIND_BPM);
+    Batch batch;
+    for (uint64_t t = 0; t <= 3000; t += 100) batch.add(72.5, t);
+    batch.add(0.0, 3100);   // finger removed
+    apptech_transition transitions[4];
+    size_t written = 0;
+    ASSERT_EQ(APPTECH_OK, apptech_debouncer_update(debouncer, &batch.values[0], &batch.times[0], batch.values.size(),
+                                                   transitions, 4, &written, NULL));
+    ASSERT_EQ(2u, written);
+    ASSERT_TRUE(transitions[0].value == 72.5);
+    ASSERT_EQ(static_cast<uint32_t>(APPTECH_TRANSITION_UNSTABLE), transitions[1].type);
+    ASSERT_TRUE(transitions[1].value == 0.0);
+    apptech_debouncer_destroy(debouncer);
+}
+
+TEST(test_bank_column_batches) {
+    apptech_debounce_config config;
+    apptech_debounce_config_default(APPTECH_KIND_SPO2, &config);
+    apptech_debouncer_bank* bank = NULL;
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_bank_create(&config, 0, &bank));
+    ASSERT_EQ(APPTECH_OK, apptech_bank_create(&config, 64, &bank));
+    ASSERT_EQ(64u, apptech_bank_lane_count(bank));
+
+    // Interleaved samples: lane k reads 90 + k % 10, every 100 ms
+    std::vector<uint32_t> lanes;
+    Batch batch;
+    for (uint64_t t = 0; t <= 3000; t += 100) {
+        for (uint32_t lane = 0; lane < 64; ++lane) {
+            lanes.push_back(lane);
+            batch.add(90.0 + lane % 10, t);
+        }
+    }
+    std::vector<apptech_transition> transitions(128);
+    size_t written = 0;
+    size_t consumed = 0;
+    ASSERT_EQ(APPTECH_OK, apptech_bank_update(bank, &lanes[0], &batch.values[0], &batch.times[0], lanes.size(),
+                                              &transitions[0], transitions.size(), &written, &consumed));
+    ASSERT_EQ(64u, written);
+    ASSERT_EQ(17u, transitions[17].lane);
+    ASSERT_TRUE(transitions[17].value == 97.0);
+
+    std::vector<uint8_t> stable(64);
+    std::vector<double> readings(64);
+    ASSERT_EQ(APPTECH_OK, apptech_bank_get_stable(bank, &stable[0], &readings[0]));
+    ASSERT_EQ(1u, stable[63]);
+    ASSERT_TRUE(readings[63] == 93.0);
+
+    // A bad lane stops the batch at that sample
+    uint32_t badLanes[2] = { 3, 64 };
+    double values[2] = { 95.0, 95.0 };
+    uint64_t times[2] = { 3100, 3100 };
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT,
+              apptech_bank_update(bank, badLanes, values, times, 2, &transitions[0], transitions.size(), &written,
+                                  &consumed));
+    ASSERT_EQ(1u, consumed);
+
+    ASSERT_EQ(APPTECH_OK, apptech_bank_reset_lane(bank, 63));
+    apptech_debounce_state state;
+    ASSERT_EQ(APPTECH_OK, apptech_bank_get_state(bank, 63, &state));
+    ASSERT_EQ(0u, state.stable);
+    ASSERT_EQ(APPTECH_ERR_INVALID_ARGUMENT, apptech_bank_get_state(bank, 64, &state));
+    apptech_bank_destroy(bank);
+}
+
+TEST(test_bank_tick_updates) {
+    apptech_debounce_config config;
+    apptech_debounce_config_default(APPTECH_KIND_HEIGHT, &config);
+    apptech_debouncer_bank* bank = NULL;
+    ASSERT_EQ(APPTECH_OK, apptech_bank_create(&config, 8, &bank));
+
+    std::vector<double> values(8);
+    std::vector<apptech_transition> transitions(8);
+    size_t written = 0;
+    size_t total = 0;
+    for (uint64_t t = 0; t <= 3000; t += 100) {
+        for (size_t lane = 0; lane < 8; ++lane) {
+            values[lane] = lane < 4 ? 150.0 : 150.0 + static_cast<double>(t % 300);   // lanes 4..7 never settle
+        }
+        ASSERT_EQ(APPTECH_OK, apptech_bank_update_all(bank, &values[0], t, &transitions[0], transitions.size(),
+                                                      &written, NULL));
+        total += written;
+    }
+    ASSERT_EQ(4u, total);
+    ASSERT_EQ(3u, transitions[3].sample_index);
+    ASSERT_EQ(3u, transitions[3].lane);
+    apptech_bank_destroy(bank);
+}
+
+TEST(test_header_compiles_as_c) {
+    ASSERT_EQ(0, apptech_debounce_c_check());
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "C ABI Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_version_and_defaults);
+    RUN_TEST(test_invalid_arguments);
+    RUN_TEST(test_config_sizes_and_ranges);
+    RUN_TEST(test_unrepresentable_samples_rejected);
+    RUN_TEST(test_batch_matches_cpp_debouncer);
+    RUN_TEST(test_full_buffer_resumes);
+    RUN_TEST(test_reading_debouncer_invalid_reading);
+    RUN_TEST(test_bank_column_batches);
+    RUN_TEST(test_bank_tick_updates);
+    RUN_TEST(test_header_compiles_as_c);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
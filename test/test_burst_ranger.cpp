@@ -0,0 +1,191 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include "burst_ranger.h"
+#include "config.h"
+#include "height_debouncer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Consensus Tests
+// ============================================
+
+TEST(test_stops_early_when_echoes_agree) {
+    BurstRanger ranger(2, 3, 6);
+    ranger.begin();
+    ASSERT_FALSE(ranger.addEcho(150));
+    ASSERT_FALSE(ranger.addEcho(151));
+    ASSERT_TRUE(ranger.addEcho(149));
+    ASSERT_TRUE(ranger.isComplete());
+    ASSERT_TRUE(ranger.hasConsensus());
+    ASSERT_EQ(150, ranger.getConsensus());
+    ASSERT_EQ(3, ranger.getPingCount());
+}
+
+TEST(test_stray_echo_is_outvoted) {
+    BurstRanger ranger(2, 3, 6);
+    ranger.begin();
+    ranger.addEcho(150);
+    ranger.addEcho(37);     // multipath
+    ranger.addEcho(152);
+    ASSERT_TRUE(ranger.addEcho(151));
+    ASSERT_EQ(151, ranger.getConsensus());
+    ASSERT_EQ(4, ranger.getPingCount());
+}
+
+TEST(test_no_consensus_after_max_pings) {
+    BurstRanger ranger(2, 3, 4);
+    ranger.begin();
+    ASSERT_FALSE(ranger.addEcho(100));
+    ASSERT_FALSE(ranger.addEcho(120));
+    ASSERT_FALSE(ranger.addEcho(140));
+    ASSERT_TRUE(ranger.addEcho(101));
+    ASSERT_FALSE(ranger.hasConsensus());
+    ASSERT_EQ(-1, ranger.getConsensus());
+
+    // Further echoes belong to no burst until begin()
+    ASSERT_TRUE(ranger.addEcho(100));
+    ASSERT_EQ(4, ranger.getPingCount());
+    ranger.begin();
+    ASSERT_FALSE(ranger.isComplete());
+    ASSERT_EQ(0, ranger.getPingCount());
+}
+
+TEST(test_lost_echoes_never_form_consensus) {
+    BurstRanger ranger;
+    ranger.begin();
+    int pings = 0;
+    while (!ranger.addEcho(0)) {
+        pings++;
+    }
+    ASSERT_EQ(BURST_MAX_PINGS - 1, pings);
+    ASSERT_FALSE(ranger.hasConsensus());
+    ASSERT_EQ(-1, ranger.getConsensus());
+    ASSERT_EQ(0, ranger.getEchoCount());
+}
+
+TEST(test_lost_echoes_do_not_vote) {
+    BurstRanger ranger(2, 3, 6);
+    ranger.begin();
+    ASSERT_FALSE(ranger.addEcho(150));
+    ASSERT_FALSE(ranger.addEcho(0));
+    ASSERT_FALSE(ranger.addEcho(0));
+    ASSERT_FALSE(ranger.addEcho(151));
+    ASSERT_TRUE(ranger.addEcho(149));
+    ASSERT_EQ(150, ranger.getConsensus());
+    ASSERT_EQ(5, ranger.getPingCount());
+    ASSERT_EQ(3, ranger.getEchoCount());
+}
+
+TEST(test_max_pings_is_capped) {
+    BurstRanger ranger(2, 20, 40);
+    ASSERT_EQ(BurstRanger::kMaxPings, ranger.getMaxPings());
+    ranger.begin();
+    int pings = 0;
+    while (!ranger.addEcho(pings * 10)) {
+        pings++;
+    }
+    ASSERT_EQ(BurstRanger::kMaxPings, ranger.getPingCount());
+}
+
+// ============================================
+// Debouncer Integration Tests
+// ============================================
+
+TEST(test_burst_mode_settles_despite_stray_echoes) {
+    // Echoes around 150 cm with a stray echo every tenth ping
+    int echoes[] = { 150, 151, 149, 150, 80, 151, 150, 149, 151, 150 };
+    int echoCount = sizeof(echoes) / sizeof(echoes[0]);
+
+    HeightDebouncer single;
+    unsigned long singleStableMs = 0;
+    for (unsigned long t = 0, i = 0; t <= 10000 && singleStableMs == 0; t += DEBOUNCE_SAMPLE_INTERVAL_MS, ++i) {
+        single.update(echoes[i % echoCount], t);
+        if (single.isStable()) {
+            singleStableMs = t;
+        }
+    }
+
+    HeightDebouncer burst(DEBOUNCE_TOLERANCE_CM, BURST_STABILITY_DURATION_MS, BURST_INTERVAL_MS);
+    BurstRanger ranger;
+    unsigned long burstStableMs = 0;
+    unsigned long ping = 0;
+    for (unsigned long t = BURST_INTERVAL_MS; t <= 10000 && burstStableMs == 0; t += BURST_INTERVAL_MS) {
+        ranger.begin();
+        while (!ranger.addEcho(echoes[ping++ % echoCount])) {
+        }
+        ASSERT_TRUE(ranger.hasConsensus());
+        burst.update(ranger.getConsensus(), t);
+        if (burst.isStable()) {
+            burstStableMs = t;
+        }
+    }
+
+    // One stray per second keeps resetting the 3 s single-ping window
+    ASSERT_EQ(0u, singleStableMs);
+    ASSERT_TRUE(burstStableMs > 0);
+    ASSERT_TRUE(burstStableMs <= BURST_INTERVAL_MS + BURST_STABILITY_DURATION_MS);
+    ASSERT_EQ(150, burst.getStableReading());
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Burst Ranger Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_stops_early_when_echoes_agree);
+    RUN_TEST(test_stray_echo_is_outvoted);
+    RUN_TEST(test_no_consensus_after_max_pings);
+    RUN_TEST(test_lost_echoes_never_form_consensus);
+    RUN_TEST(test_lost_echoes_do_not_vote);
+    RUN_TEST(test_max_pings_is_capped);
+    RUN_TEST(test_burst_mode_settles_despite_stray_echoes);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,254 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "debounce_trace.h"
+#include "height_debouncer.h"
+#include "reading_debouncer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+std::string tempRingPath() {
+    char path[] = "/tmp/debounce_trace_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+        close(fd);
+    }
+    return path;
+}
+
+std::vector<DebounceTraceEntry> snapshotActive() {
+    std::vector<DebounceTraceEntry> entries;
+    debounceTraceSnapshot(debounceTraceActiveRing(), 0, entries);
+    return entries;
+}
+
+uint64_t activeHead() {
+    return debounceTraceActiveRing()->head.load();
+}
+
+// ============================================
+// Tracepoint Tests
+// ============================================
+
+TEST(test_disabled_tracepoints_record_nothing) {
+    debounceTraceDetach();
+    uint64_t before = activeHead();
+
+    HeightDebouncer debouncer(2, 3000, 100);
+    for (unsigned long t = 0; t < 5000; t += 50) {
+        debouncer.update(150, t);
+    }
+    ASSERT_TRUE(debouncer.isStable());
+    ASSERT_EQ(before, activeHead());
+}
+
+TEST(test_height_decisions_are_traced) {
+    debounceTraceDetach();
+    std::string path = tempRingPath();
+    ASSERT_TRUE(debounceTraceAttach(path.c_str(), 64));
+    debounceTraceSetEnabled(true);
+
+    HeightDebouncer debouncer(2, 3000, 100);
+    debouncer.update(150, 0);      // first reading
+    debouncer.update(150, 50);     // too soon
+    debouncer.update(170, 100);    // outside tolerance
+    debouncer.update(171, 3100);   // stable
+    debouncer.update(170, 3200);   // still stable, no event
+
+    std::vector<DebounceTraceEntry> entries = snapshotActive();
+    ASSERT_EQ(4u, entries.size());
+    ASSERT_EQ(DEBOUNCE_TRACE_FIRST_READING, entries[0].event);
+    ASSERT_EQ(DEBOUNCE_TRACE_INTERVAL_SKIP, entries[1].event);
+    ASSERT_EQ(DEBOUNCE_TRACE_TOLERANCE_RESET, entries[2].event);
+    ASSERT_EQ(DEBOUNCE_TRACE_STABLE, entries[3].event);
+    ASSERT_EQ(3100u, entries[3].timeMs);
+    ASSERT_TRUE(entries[3].reading == 171.0f);
+    ASSERT_TRUE(entries[0].source == reinterpret_cast<uintptr_t>(&debouncer));
+
+    debounceTraceDetach();
+    std::remove(path.c_str());
+}
+
+TEST(test_invalid_reset_is_traced) {
+    debounceTraceDetach();
+    debounceTraceSetEnabled(true);
+    uint64_t before = activeHead();
+
+    ReadingDebouncer<float> debouncer(5.0f, 3000, 100, 40.0f, 200.0f);
+    debouncer.update(72.0f, 0);
+    debouncer.update(0.0f, 100);
+
+    std::vector<DebounceTraceEntry> entries;
+    debounceTraceSnapshot(debounceTraceActiveRing(), before, entries);
+    ASSERT_EQ(2u, entries.size());
+    ASSERT_EQ(DEBOUNCE_TRACE_FIRST_READING, entries[0].event);
+    ASSERT_EQ(DEBOUNCE_TRACE_INVALID_RESET, entries[1].event);
+    ASSERT_TRUE(entries[1].reading == 0.0f);
+
+    debounceTraceDetach();
+}
+
+TEST(test_ring_keeps_most_recent_records) {
+    debounceTraceDetach();
+    std::string path = tempRingPath();
+    ASSERT_TRUE(debounceTraceAttach(path.c_str(), 8));
+    debounceTraceSetEnabled(true);
+
+    // Every update after the first is an interval skip
+    HeightDebouncer debouncer(2, 3000, 100000);
+    for (unsigned long t = 0; t < 20; ++t) {
+        debouncer.update(150, t);
+    }
+
+    std::vector<DebounceTraceEntry> entries = snapshotActive();
+    ASSERT_EQ(8u, entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        ASSERT_EQ(12 + i, entries[i].index);
+        ASSERT_EQ(12 + i, entries[i].timeMs);
+    }
+
+    debounceTraceDetach();
+    std::remove(path.c_str());
+}
+
+TEST(test_decoder_mapping_controls_live_ring) {
+    debounceTraceDetach();
+    std::string path = tempRingPath();
+    ASSERT_TRUE(debounceTraceAttach(path.c_str(), 64));
+
+    // A second mapping of the file stands in for the decoder process
+    DebounceTraceMapping decoder;
+    ASSERT_TRUE(decoder.open(path.c_str(), 0));
+    ASSERT_EQ(64u, decoder.header()->capacity);
+
+    HeightDebouncer debouncer(2, 3000, 100);
+    debouncer.update(150, 0);
+    ASSERT_EQ(0u, decoder.header()->head.load());
+
+    decoder.header()->enabled.store(1);
+    debouncer.update(190, 100);
+
+    std::vector<DebounceTraceEntry> entries;
+    debounceTraceSnapshot(decoder.header(), 0, entries);
+    ASSERT_EQ(1u, entries.size());
+    ASSERT_EQ(DEBOUNCE_TRACE_TOLERANCE_RESET, entries[0].event);
+
+    decoder.close();
+    debounceTraceDetach();
+    std::remove(path.c_str());
+}
+
+TEST(test_decoder_rejects_non_ring_files) {
+    std::string path = tempRingPath();
+    FILE* file = std::fopen(path.c_str(), "w");
+    std::fputs("Raw: 150 cm | Stable: NO\n", file);
+    std::fclose(file);
+
+    DebounceTraceMapping mapping;
+    ASSERT_FALSE(mapping.open(path.c_str(), 0));
+    ASSERT_FALSE(mapping.open("/nonexistent/ring", 0));
+    std::remove(path.c_str());
+}
+
+TEST(test_attach_and_detach_while_updating) {
+    debounceTraceDetach();
+    std::string path = tempRingPath();
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 2; ++w) {
+        workers.push_back(std::thread([&stop]() {
+            HeightDebouncer debouncer(2, 3000, 0);
+            for (unsigned long t = 0; !stop.load(); t += 10) {
+                debouncer.update(static_cast<int>(150 + (t / 10) % 7), t);
+            }
+        }));
+    }
+
+    // Tracepoints keep running on the workers across every switch
+    bool attached = true;
+    for (int i = 0; i < 50 && attached; ++i) {
+        attached = debounceTraceAttach(path.c_str(), 64);
+        debounceTraceSetEnabled(true);
+        usleep(200);
+        debounceTraceDetach();
+        debounceTraceSetEnabled(i % 2 == 0);
+        usleep(200);
+    }
+    stop.store(true);
+    for (size_t w = 0; w < workers.size(); ++w) {
+        workers[w].join();
+    }
+    debounceTraceDetach();
+    std::remove(path.c_str());
+    ASSERT_TRUE(attached);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Debounce Trace Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_disabled_tracepoints_record_nothing);
+    RUN_TEST(test_height_decisions_are_traced);
+    RUN_TEST(test_invalid_reset_is_traced);
+    RUN_TEST(test_ring_keeps_most_recent_records);
+    RUN_TEST(test_decoder_mapping_controls_live_ring);
+    RUN_TEST(test_decoder_rejects_non_ring_files);
+    RUN_TEST(test_attach_and_detach_while_updating);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
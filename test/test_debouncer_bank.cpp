@@ -0,0 +1,190 @@
+#include <iostream>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "debouncer_bank.h"
+#include "numa_memory.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+ReadingDebouncer<float> bpmPrototype() {
+    return ReadingDebouncer<float>(5.0f, 3000, 100, 40.0f, 200.0f);
+}
+
+// ============================================
+// Topology and Memory Tests
+// ============================================
+
+TEST(test_topology_has_a_node_with_cpus) {
+    NumaTopology topology = NumaTopology::detect();
+    ASSERT_TRUE(topology.getNodeCount() >= 1);
+    ASSERT_EQ(topology.nodes.size(), topology.cpus.size());
+    ASSERT_TRUE(topology.getCpuCount() >= 1);
+    for (size_t i = 0; i < topology.cpus.size(); ++i) {
+        ASSERT_FALSE(topology.cpus[i].empty());
+    }
+}
+
+TEST(test_region_is_aligned_and_zeroed) {
+    NodeRegion region;
+    ASSERT_TRUE(allocateNodeRegion(3 * 1000 * 1000, -1, HUGE_PAGES_TRANSPARENT, region));
+    ASSERT_TRUE(region.data != NULL);
+    ASSERT_TRUE(region.length >= 3 * 1000 * 1000);
+    ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(region.data) % 4096);
+
+    unsigned char* bytes = static_cast<unsigned char*>(region.data);
+    ASSERT_EQ(0, bytes[0]);
+    ASSERT_EQ(0, bytes[region.length - 1]);
+    bytes[region.length - 1] = 0xFF;
+
+    freeNodeRegion(region);
+    ASSERT_TRUE(region.data == NULL);
+}
+
+TEST(test_explicit_huge_pages_fall_back) {
+    // Without a reserved hugetlb pool this must still succeed with THP or 4k pages
+    NodeRegion region;
+    ASSERT_TRUE(allocateNodeRegion(4 * 1024 * 1024, -1, HUGE_PAGES_EXPLICIT, region));
+    static_cast<char*>(region.data)[0] = 1;
+    std::cout << "(" << hugePageModeName(region.hugePages) << ") ";
+    freeNodeRegion(region);
+
+    ASSERT_TRUE(allocateNodeRegion(4096, -1, HUGE_PAGES_NONE, region));
+    ASSERT_EQ(HUGE_PAGES_NONE, region.hugePages);
+    freeNodeRegion(region);
+}
+
+// ============================================
+// Bank Tests
+// ============================================
+
+TEST(test_shards_partition_channels) {
+    DebouncerBankOptions options;
+    options.shards = 3;
+    ShardedDebouncerBank<float> bank(1000, bpmPrototype(), options);
+    ASSERT_TRUE(bank.init());
+    ASSERT_EQ(3u, bank.getShardCount());
+
+    size_t next = 0;
+    for (size_t i = 0; i < bank.getShardCount(); ++i) {
+        DebouncerShard<float>& shard = bank.getShard(i);
+        ASSERT_EQ(next, shard.firstChannel);
+        ASSERT_TRUE(shard.channelCount == 333 || shard.channelCount == 334);
+        next += shard.channelCount;
+    }
+    ASSERT_EQ(1000u, next);
+
+    for (size_t channel = 0; channel < 1000; ++channel) {
+        DebouncerShard<float>& shard = bank.getShard(bank.shardOf(channel));
+        ASSERT_TRUE(channel >= shard.firstChannel);
+        ASSERT_TRUE(channel < shard.firstChannel + shard.channelCount);
+    }
+}
+
+TEST(test_channels_copy_prototype) {
+    DebouncerBankOptions options;
+    options.shards = 2;
+    ShardedDebouncerBank<float> bank(10, bpmPrototype(), options);
+    ASSERT_TRUE(bank.init());
+    for (size_t channel = 0; channel < 10; ++channel) {
+        ReadingDebouncer<float>& debouncer = bank.debouncer(channel);
+        ASSERT_TRUE(debouncer.getTolerance() == 5.0f);
+        ASSERT_EQ(3000u, debouncer.getStabilityDurationMs());
+        ASSERT_FALSE(debouncer.hasValidReading());
+    }
+}
+
+TEST(test_workers_update_their_own_shards) {
+    DebouncerBankOptions options;
+    options.shards = 4;
+    options.hugePages = HUGE_PAGES_NONE;
+    ShardedDebouncerBank<float> bank(4001, bpmPrototype(), options);
+    ASSERT_TRUE(bank.init());
+
+    // Each channel gets a distinct steady value for long enough to stabilize
+    bank.runOnShards([](DebouncerShard<float>& shard) {
+        for (unsigned long t = 0; t <= 3000; t += 100) {
+            for (size_t c = 0; c < shard.channelCount; ++c) {
+                size_t channel = shard.firstChannel + c;
+                shard.at(channel).update(50.0f + static_cast<float>(channel % 100), t);
+            }
+        }
+    });
+
+    for (size_t channel = 0; channel < 4001; ++channel) {
+        ReadingDebouncer<float>& debouncer = bank.debouncer(channel);
+        ASSERT_TRUE(debouncer.isStable());
+        ASSERT_TRUE(debouncer.getStableReading() == 50.0f + static_cast<float>(channel % 100));
+    }
+}
+
+TEST(test_more_shards_than_channels) {
+    DebouncerBankOptions options;
+    options.shards = 8;
+    ShardedDebouncerBank<int> bank(3, ReadingDebouncer<int>(2, 3000, 100, 50, 100), options);
+    ASSERT_TRUE(bank.init());
+    ASSERT_EQ(3u, bank.getShardCount());
+    ASSERT_EQ(2u, bank.shardOf(2));
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Debouncer Bank Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_topology_has_a_node_with_cpus);
+    RUN_TEST(test_region_is_aligned_and_zeroed);
+    RUN_TEST(test_explicit_huge_pages_fall_back);
+    RUN_TEST(test_shards_partition_channels);
+    RUN_TEST(test_channels_copy_prototype);
+    RUN_TEST(test_workers_update_their_own_shards);
+    RUN_TEST(test_more_shards_than_channels);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,242 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "device_swarm.h"
+#include "sample_frame.h"
+#include "trace_parser.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+DeviceTask recordWakeups(VirtualEventLoop& loop, unsigned long period, std::vector<unsigned long>& wakeups) {
+    for (;;) {
+        co_await loop.delay(period);
+        wakeups.push_back(loop.millis());
+    }
+}
+
+class StreamCollector : public SwarmSink {
+public:
+    std::vector<std::string> streams;
+
+    void onData(uint32_t deviceId, unsigned long, const uint8_t* data, size_t length) override {
+        if (deviceId >= streams.size()) {
+            streams.resize(deviceId + 1);
+        }
+        streams[deviceId].append(reinterpret_cast<const char*>(data), length);
+    }
+};
+
+class SampleCollector : public TraceSampleSink {
+public:
+    std::vector<TraceSample> samples;
+    void onSample(const TraceSample& sample) override { samples.push_back(sample); }
+};
+
+// ============================================
+// Event Loop Tests
+// ============================================
+
+TEST(test_delay_resumes_at_virtual_time) {
+    VirtualEventLoop loop(64);
+    std::vector<unsigned long> wakeups;
+    DeviceTask task = recordWakeups(loop, 100, wakeups);
+    loop.schedule(task.handle(), 5);
+    loop.run(406);
+
+    // Period longer than the wheel must still fire exactly on time
+    ASSERT_EQ(4u, wakeups.size());
+    ASSERT_EQ(105ul, wakeups[0]);
+    ASSERT_EQ(405ul, wakeups[3]);
+    ASSERT_EQ(406ul, loop.millis());
+    ASSERT_EQ(1u, loop.getPendingCount());
+}
+
+TEST(test_many_coroutines_share_one_clock) {
+    VirtualEventLoop loop;
+    std::vector<unsigned long> fast;
+    std::vector<unsigned long> slow;
+    DeviceTask a = recordWakeups(loop, 10, fast);
+    DeviceTask b = recordWakeups(loop, 1000, slow);
+    loop.schedule(a.handle(), 0);
+    loop.schedule(b.handle(), 0);
+    loop.run(2001);
+
+    ASSERT_EQ(200u, fast.size());
+    ASSERT_EQ(2u, slow.size());
+    ASSERT_EQ(2000ul, slow[1]);
+}
+
+// ============================================
+// Swarm Tests
+// ============================================
+
+TEST(test_height_meter_text_matches_sketch) {
+    SwarmOptions options;
+    options.heightMeters = 1;
+    StreamCollector collector;
+    DeviceSwarm swarm(options, &collector);
+    swarm.run(60000);
+
+    // Every line is one the trace parser recognizes, at roughly the loop period
+    SampleCollector samples;
+    TraceParser parser(&samples, 0);
+    parser.feed(collector.streams[0].data(), collector.streams[0].size());
+    ASSERT_EQ(0ul, parser.getLinesSkipped());
+    ASSERT_EQ(swarm.getMessagesSent(), parser.getLinesParsed());
+    ASSERT_TRUE(parser.getLinesParsed() > 450 && parser.getLinesParsed() < 600);
+    ASSERT_TRUE(collector.streams[0].find("Stable: YES") != std::string::npos);
+}
+
+TEST(test_pulse_oximeter_text_matches_sketch) {
+    SwarmOptions options;
+    options.pulseOximeters = 1;
+    StreamCollector collector;
+    DeviceSwarm swarm(options, &collector);
+    swarm.run(120000);
+
+    SampleCollector samples;
+    TraceParser parser(&samples, 0);
+    parser.feed(collector.streams[0].data(), collector.streams[0].size());
+
+    // One report per REPORTING_PERIOD_MS after the 3 s setup
+    ASSERT_TRUE(parser.getLinesParsed() >= 110 && parser.getLinesParsed() <= 117);
+    ASSERT_EQ(2 * parser.getLinesParsed(), samples.samples.size());
+    ASSERT_TRUE(samples.samples[0].timeMs >= 4000);
+    ASSERT_TRUE(collector.streams[0].find("      DEBOUNCE - BPM:") != std::string::npos);
+}
+
+TEST(test_binary_protocol_round_trip) {
+    SwarmOptions options;
+    options.heightMeters = 3;
+    options.pulseOximeters = 3;
+    options.protocol = SWARM_PROTOCOL_BINARY;
+    StreamCollector collector;
+    DeviceSwarm swarm(options, &collector);
+    swarm.run(10000);
+
+    for (size_t device = 0; device < collector.streams.size(); ++device) {
+        const std::string& stream = collector.streams[device];
+        ASSERT_EQ(0u, stream.size() % SAMPLE_FRAME_SIZE);
+
+        SampleCollector samples;
+        FrameTraceParser parser(&samples);
+        parser.feed(reinterpret_cast<const uint8_t*>(stream.data()), stream.size());
+        ASSERT_EQ(0ul, parser.getBytesSkipped());
+        ASSERT_EQ(stream.size() / SAMPLE_FRAME_SIZE, samples.samples.size());
+        for (size_t i = 0; i < samples.samples.size(); ++i) {
+            ASSERT_EQ(device, samples.samples[i].deviceId);
+            ASSERT_TRUE(samples.samples[i].channel == (device < 3 ? CHANNEL_HEIGHT
+                        : (i % 2 == 0 ? CHANNEL_BPM : CHANNEL_SPO2)));
+        }
+    }
+}
+
+TEST(test_frame_parser_resynchronizes) {
+    SampleFrame frame;
+    frame.deviceId = 42;
+    frame.timeMs = 123456;
+    frame.valueHundredths = 7250;
+    frame.channel = CHANNEL_BPM;
+    frame.stable = true;
+    frame.valid = true;
+
+    std::vector<uint8_t> stream;
+    uint8_t bytes[SAMPLE_FRAME_SIZE];
+    encodeSampleFrame(frame, bytes);
+    stream.push_back('x');
+    stream.push_back(SAMPLE_FRAME_SYNC);   // False sync
+    stream.insert(stream.end(), bytes, bytes + SAMPLE_FRAME_SIZE);
+    stream.insert(stream.end(), bytes, bytes + SAMPLE_FRAME_SIZE);
+
+    // Byte-by-byte feeding exercises the carry-over path
+    SampleCollector samples;
+    FrameTraceParser parser(&samples);
+    for (size_t i = 0; i < stream.size(); ++i) {
+        parser.feed(&stream[i], 1);
+    }
+
+    ASSERT_EQ(2u, samples.samples.size());
+    ASSERT_EQ(42u, samples.samples[1].deviceId);
+    ASSERT_EQ(123456ul, samples.samples[1].timeMs);
+    ASSERT_TRUE(samples.samples[1].value == 72.5f);
+    ASSERT_EQ(2ul, parser.getBytesSkipped());
+}
+
+TEST(test_large_swarm_runs_on_one_thread) {
+    SwarmOptions options;
+    options.heightMeters = 5000;
+    options.pulseOximeters = 5000;
+    DeviceSwarm swarm(options, nullptr);
+    swarm.run(5000);
+
+    ASSERT_EQ(10000u, swarm.getDeviceCount());
+    // ~45 height reports per device plus ~1-2 oximeter reports after setup
+    ASSERT_TRUE(swarm.getMessagesSent() > 5000ul * 40);
+    ASSERT_TRUE(swarm.getMessagesSent() < 5000ul * 55);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Device Swarm Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_delay_resumes_at_virtual_time);
+    RUN_TEST(test_many_coroutines_share_one_clock);
+    RUN_TEST(test_height_meter_text_matches_sketch);
+    RUN_TEST(test_pulse_oximeter_text_matches_sketch);
+    RUN_TEST(test_binary_protocol_round_trip);
+    RUN_TEST(test_frame_parser_resynchronizes);
+    RUN_TEST(test_large_swarm_runs_on_one_thread);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,283 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "pinned_task.h"
+#include "spsc_queue.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+
+// ============================================
+// Helpers
+// ============================================
+
+/**
+ * A report as the oximeter's sampling task queues it
+ */
+struct Frame {
+    uint32_t sequence;
+    unsigned long timeMs;
+    float bpm;
+    uint8_t spo2;
+};
+
+/**
+ * Both ends of a queue run by two pinned tasks
+ */
+template<typename Queue>
+struct Pipeline {
+    Queue queue;
+    uint32_t count;          // items the producer offers
+    bool dropWhenFull;       // pushOrDrop() instead of retrying
+    uint32_t received;
+    uint32_t outOfOrder;
+    std::atomic<bool> producerDone;
+    int producerCore;
+    int consumerCore;
+
+    Pipeline(uint32_t count, bool dropWhenFull)
+        : count(count)
+        , dropWhenFull(dropWhenFull)
+        , received(0)
+        , outOfOrder(0)
+        , producerDone(false)
+        , producerCore(-2)
+        , consumerCore(-2)
+    {
+    }
+
+    static void produce(void* arg) {
+        Pipeline* self = static_cast<Pipeline*>(arg);
+        self->producerCore = PinnedTask::currentCore();
+        for (uint32_t i = 0; i < self->count; ++i) {
+            Frame frame;
+            frame.sequence = i;
+            frame.timeMs = 1000ul * i;
+            frame.bpm = 60.0f + static_cast<float>(i % 40);
+            frame.spo2 = static_cast<uint8_t>(90 + i % 10);
+            if (self->dropWhenFull) {
+                self->queue.pushOrDrop(frame);
+                if (i % 64 == 0) {
+                    PinnedTask::yield();
+                }
+            } else {
+                while (!self->queue.push(frame)) {
+                    PinnedTask::yield();
+                }
+            }
+        }
+        self->producerDone.store(true);
+    }
+
+    static void consume(void* arg) {
+        Pipeline* self = static_cast<Pipeline*>(arg);
+        self->consumerCore = PinnedTask::currentCore();
+        Frame frame;
+        uint32_t next = 0;
+        for (;;) {
+            if (self->queue.pop(frame)) {
+                // Sequences only move forward; dropped ones leave gaps
+                bool intact = frame.timeMs == 1000ul * frame.sequence &&
+                              frame.spo2 == static_cast<uint8_t>(90 + frame.sequence % 10);
+                if (frame.sequence < next || !intact || (!self->dropWhenFull && frame.sequence != next)) {
+                    self->outOfOrder++;
+                }
+                next = frame.sequence + 1;
+                self->received++;
+            } else if (self->producerDone.load()) {
+                if (self->queue.empty()) {
+                    return;
+                }
+            } else {
+                PinnedTask::yield();
+            }
+        }
+    }
+};
+
+// ============================================
+// SpscQueue Tests
+// ============================================
+
+TEST(test_queue_is_fifo_and_bounded) {
+    SpscQueue<int, 4> queue;
+    int value = -1;
+    ASSERT_TRUE(queue.empty());
+    ASSERT_FALSE(queue.pop(value));
+    ASSERT_EQ(-1, value);
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(queue.push(i));
+    }
+    ASSERT_EQ(4u, queue.size());
+    ASSERT_FALSE(queue.push(99));
+    ASSERT_FALSE(queue.pushOrDrop(99));
+    ASSERT_EQ(1u, queue.getDropped());
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(queue.pop(value));
+        ASSERT_EQ(i, value);
+    }
+    ASSERT_FALSE(queue.pop(value));
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(test_queue_wraps_around) {
+    SpscQueue<uint32_t, 8> queue;
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    uint32_t value = 0;
+    // Uneven push/pop runs walk the counters many times around the ring
+    for (int round = 0; round < 1000; ++round) {
+        for (int i = 0; i < 1 + round % 7; ++i) {
+            if (queue.push(pushed)) {
+                pushed++;
+            }
+        }
+        for (int i = 0; i < 1 + round % 5; ++i) {
+            if (queue.pop(value)) {
+                ASSERT_EQ(popped, value);
+                popped++;
+            }
+        }
+        ASSERT_TRUE(queue.size() <= queue.capacity());
+    }
+    while (queue.pop(value)) {
+        ASSERT_EQ(popped, value);
+        popped++;
+    }
+    ASSERT_EQ(pushed, popped);
+    ASSERT_TRUE(pushed > 1000u);
+}
+
+// ============================================
+// PinnedTask Tests
+// ============================================
+
+void storeCore(void* arg) {
+    *static_cast<int*>(arg) = PinnedTask::currentCore();
+}
+
+TEST(test_task_runs_on_its_core) {
+    PinnedTask first;
+    PinnedTask second;
+    int firstCore = -2;
+    int secondCore = -2;
+    ASSERT_TRUE(first.start("first", storeCore, &firstCore, 0));
+    ASSERT_TRUE(second.start("second", storeCore, &secondCore, 1));
+    ASSERT_FALSE(first.start("again", storeCore, &firstCore, 0));
+    first.join();
+    second.join();
+    ASSERT_FALSE(first.isRunning());
+    ASSERT_EQ(0, first.getCore());
+    ASSERT_EQ(1, second.getCore());
+
+    // On a host with one CPU both wrap onto it
+    cpu_set_t allowed;
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+    ASSERT_TRUE(first.isPinned());
+    ASSERT_TRUE(second.isPinned());
+    ASSERT_TRUE(firstCore >= 0 && CPU_ISSET(firstCore, &allowed));
+    ASSERT_TRUE(secondCore >= 0 && CPU_ISSET(secondCore, &allowed));
+    if (CPU_COUNT(&allowed) > 1) {
+        ASSERT_TRUE(firstCore != secondCore);
+    }
+}
+
+// ============================================
+// Producer/Consumer Tests
+// ============================================
+
+TEST(test_tasks_pass_every_frame_in_order) {
+    typedef Pipeline<SpscQueue<Frame, 16> > FramePipeline;
+    FramePipeline pipeline(200000, false);
+    PinnedTask consumer;
+    PinnedTask producer;
+    ASSERT_TRUE(consumer.start("present", FramePipeline::consume, &pipeline, 0));
+    ASSERT_TRUE(producer.start("sampling", FramePipeline::produce, &pipeline, 1));
+    producer.join();
+    consumer.join();
+
+    ASSERT_EQ(200000u, pipeline.received);
+    ASSERT_EQ(0u, pipeline.outOfOrder);
+    ASSERT_EQ(0u, pipeline.queue.getDropped());
+    ASSERT_TRUE(pipeline.queue.empty());
+    ASSERT_TRUE(pipeline.producerCore >= 0);
+    ASSERT_TRUE(pipeline.consumerCore >= 0);
+}
+
+TEST(test_full_queue_drops_instead_of_blocking) {
+    typedef Pipeline<SpscQueue<Frame, 8> > FramePipeline;
+    FramePipeline pipeline(100000, true);
+    PinnedTask consumer;
+    PinnedTask producer;
+    ASSERT_TRUE(consumer.start("present", FramePipeline::consume, &pipeline, 0));
+    ASSERT_TRUE(producer.start("sampling", FramePipeline::produce, &pipeline, 1));
+    producer.join();
+    consumer.join();
+
+    // Every frame is either shown or counted as dropped, never torn or reordered
+    ASSERT_EQ(100000u, pipeline.received + pipeline.queue.getDropped());
+    ASSERT_EQ(0u, pipeline.outOfOrder);
+    ASSERT_TRUE(pipeline.received >= 8u);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Dual-Core Task Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_queue_is_fifo_and_bounded);
+    RUN_TEST(test_queue_wraps_around);
+    RUN_TEST(test_task_runs_on_its_core);
+    RUN_TEST(test_tasks_pass_every_frame_in_order);
+    RUN_TEST(test_full_queue_drops_instead_of_blocking);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,378 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include "config.h"
+#include "fft_bpm_estimator.h"
+#include "reading_debouncer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+
+// ============================================
+// Helpers
+// ============================================
+
+typedef FftBpmEstimator<8> Esp32Estimator;
+typedef FftBpmEstimator<6> UnoEstimator;
+
+Esp32Estimator makeEsp32Estimator() {
+    return Esp32Estimator(100, 4, 25, BPM_MIN_VALID, BPM_MAX_VALID, FFT_BPM_MIN_AMPLITUDE,
+                          FFT_BPM_MIN_CONFIDENCE_PCT, FFT_BPM_MAX_MISSES);
+}
+
+UnoEstimator makeUnoEstimator() {
+    return UnoEstimator(100, 10, 10, BPM_MIN_VALID, BPM_MAX_VALID, FFT_BPM_MIN_AMPLITUDE,
+                        FFT_BPM_MIN_CONFIDENCE_PCT, FFT_BPM_MAX_MISSES);
+}
+
+/**
+ * Raw MAX30100 IR at 100 Hz: absorption rises with each pulse, so IR dips;
+ * the pulse wave has a second harmonic (dicrotic notch). Motion adds a
+ * sway below the band, finger pressure steps that relax over a second,
+ * and short jerks, at random times.
+ */
+class PulseSignal {
+public:
+    PulseSignal(float bpm, float amplitude)
+        : bpm_(bpm)
+        , amplitude_(amplitude)
+        , phase_(0.0)
+        , motion_(0.0f)
+        , pressure_(0.0)
+        , jerk_(0.0)
+        , jerkLeft_(0)
+        , seed_(12345)
+    {
+    }
+
+    void setMotion(float amplitude) { motion_ = amplitude; }
+
+    uint16_t next(unsigned long sample) {
+        phase_ += 2.0 * M_PI * bpm_ / 60.0 / 100.0;
+        double pulse = std::sin(phase_) + 0.4 * std::sin(2.0 * phase_ + 0.8);
+        double motion = 0.0;
+        if (motion_ > 0.0f) {
+            if (random(150) == 0) {
+                pressure_ += motion_ * (random(2001) / 1000.0 - 1.0);
+            }
+            pressure_ *= 0.99;
+            if (jerkLeft_ == 0 && random(300) == 0) {
+                jerk_ = motion_ * (random(2001) / 1000.0 - 1.0);
+                jerkLeft_ = 20;
+            }
+            if (jerkLeft_ > 0) {
+                motion += jerk_ * std::sin(M_PI * jerkLeft_ / 20.0);
+                jerkLeft_--;
+            }
+            motion += pressure_ + 0.6 * motion_ * std::sin(2.0 * M_PI * 0.3 * sample / 100.0);
+        }
+        double noise = static_cast<double>(random(21)) - 10.0;
+        return static_cast<uint16_t>(50000.0 - amplitude_ * pulse + motion + noise);
+    }
+
+private:
+    float bpm_;
+    float amplitude_;
+    double phase_;
+    float motion_;
+    double pressure_;
+    double jerk_;
+    int jerkLeft_;
+    uint32_t seed_;
+
+    uint32_t random(uint32_t range) {
+        seed_ = seed_ * 1103515245u + 12345u;
+        return (seed_ >> 8) % range;
+    }
+};
+
+/**
+ * Float DFT of a real block, divided by its length like FixedFft
+ */
+void referenceDft(const int16_t* input, size_t n, size_t k, double& re, double& im) {
+    re = 0.0;
+    im = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double angle = 2.0 * M_PI * static_cast<double>(k * i) / static_cast<double>(n);
+        re += input[i] * std::cos(angle);
+        im -= input[i] * std::sin(angle);
+    }
+    re /= static_cast<double>(n);
+    im /= static_cast<double>(n);
+}
+
+// ============================================
+// FixedFft Tests
+// ============================================
+
+TEST(test_fft_tone_lands_in_its_bin) {
+    FixedFft<6> fft;
+    int16_t re[64];
+    int16_t im[64];
+    for (int i = 0; i < 64; ++i) {
+        re[i] = static_cast<int16_t>(std::lround(16000.0 * std::cos(2.0 * M_PI * 5.0 * i / 64.0)));
+        im[i] = 0;
+    }
+    fft.transform(re, im);
+
+    // A cosine of amplitude A puts A / 2 in its bin and its mirror
+    ASSERT_TRUE(std::abs(re[5] - 8000) <= 8);
+    ASSERT_TRUE(std::abs(re[59] - 8000) <= 8);
+    for (int k = 0; k < 64; ++k) {
+        if (k != 5 && k != 59) {
+            ASSERT_TRUE(std::abs(re[k]) <= 8);
+            ASSERT_TRUE(std::abs(im[k]) <= 8);
+        }
+    }
+}
+
+TEST(test_fft_matches_float_dft) {
+    FixedFft<8> fft;
+    int16_t input[256];
+    int16_t re[256];
+    int16_t im[256];
+    uint32_t seed = 7;
+    for (int i = 0; i < 256; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        input[i] = static_cast<int16_t>(static_cast<int32_t>(seed >> 17) - 16384);
+        re[i] = input[i];
+        im[i] = 0;
+    }
+    fft.transform(re, im);
+
+    // One rounding per stage at most, on outputs of up to 14 bits
+    for (size_t k = 0; k < 256; ++k) {
+        double expectedRe;
+        double expectedIm;
+        referenceDft(input, 256, k, expectedRe, expectedIm);
+        ASSERT_TRUE(std::fabs(re[k] - expectedRe) <= 8.0);
+        ASSERT_TRUE(std::fabs(im[k] - expectedIm) <= 8.0);
+    }
+}
+
+// ============================================
+// FftBpmEstimator Tests
+// ============================================
+
+TEST(test_estimator_finds_resting_rate) {
+    Esp32Estimator estimator = makeEsp32Estimator();
+    PulseSignal signal(72.0f, 150.0f);
+    unsigned long sample = 0;
+    for (; sample < 256 * 4 - 1; ++sample) {
+        ASSERT_FALSE(estimator.addSample(signal.next(sample)));
+    }
+    // The first window needs 10.24 s of samples
+    ASSERT_TRUE(estimator.addSample(signal.next(sample++)));
+    ASSERT_TRUE(estimator.isConfident());
+    ASSERT_TRUE(std::fabs(estimator.getBpm() - 72.0f) < 1.5f);
+
+    // Then one window per FFT_BPM_HOP_MS
+    unsigned long windows = estimator.getWindows();
+    for (int i = 0; i < 100; ++i) {
+        estimator.addSample(signal.next(sample++));
+    }
+    ASSERT_EQ(windows + 1, estimator.getWindows());
+    ASSERT_TRUE(std::fabs(estimator.getBpm() - 72.0f) < 1.5f);
+}
+
+TEST(test_estimator_resolves_between_bins) {
+    // ESP32 bins are 5.86 BPM apart; interpolation gets well inside that
+    const float rates[] = { 45.0f, 61.0f, 88.5f, 117.0f, 150.0f, 185.0f };
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r) {
+        Esp32Estimator estimator = makeEsp32Estimator();
+        PulseSignal signal(rates[r], 150.0f);
+        for (unsigned long sample = 0; sample < 1200; ++sample) {
+            for (int i = 0; i < 10; ++i) {
+                estimator.addSample(signal.next(sample * 10 + i));
+            }
+        }
+        ASSERT_TRUE(estimator.isConfident());
+        ASSERT_TRUE(std::fabs(estimator.getBpm() - rates[r]) < 2.0f);
+    }
+}
+
+TEST(test_reduced_window_for_uno) {
+    UnoEstimator estimator = makeUnoEstimator();
+    ASSERT_TRUE(sizeof(estimator) < 512);   // host sizes; smaller with AVR's 16-bit int
+    ASSERT_TRUE(std::fabs(estimator.getBpmPerBin() - 9.375f) < 0.01f);
+
+    PulseSignal signal(96.0f, 150.0f);
+    unsigned long sample = 0;
+    for (; sample < 640; ++sample) {
+        estimator.addSample(signal.next(sample));
+    }
+    // A 6.4 s window, analyzed every second from then on
+    ASSERT_EQ(1ul, estimator.getWindows());
+    for (; sample < 3000; ++sample) {
+        estimator.addSample(signal.next(sample));
+    }
+    ASSERT_TRUE(estimator.isConfident());
+    ASSERT_TRUE(std::fabs(estimator.getBpm() - 96.0f) < 3.0f);
+}
+
+TEST(test_estimator_holds_rate_through_motion) {
+    Esp32Estimator estimator = makeEsp32Estimator();
+    PulseSignal signal(80.0f, 150.0f);
+    signal.setMotion(600.0f);   // four times the pulse
+    unsigned long confident = 0;
+    unsigned long windows = 0;
+    for (unsigned long sample = 0; sample < 6000; ++sample) {
+        if (estimator.addSample(signal.next(sample))) {
+            windows++;
+            if (estimator.isConfident()) {
+                confident++;
+                ASSERT_TRUE(std::fabs(estimator.getBpm() - 80.0f) < 3.0f);
+            }
+        }
+    }
+    ASSERT_TRUE(windows >= 19u);
+    ASSERT_TRUE(confident * 2 >= windows);
+    ASSERT_TRUE(std::fabs(estimator.getBpm() - 80.0f) < 3.0f);
+}
+
+TEST(test_no_finger_drops_estimate) {
+    Esp32Estimator estimator = makeEsp32Estimator();
+    PulseSignal signal(66.0f, 150.0f);
+    unsigned long sample = 0;
+    for (; sample < 5000; ++sample) {
+        estimator.addSample(signal.next(sample));
+    }
+    ASSERT_TRUE(estimator.getBpm() > 0.0f);
+
+    // Finger off: ambient light only, flat apart from sensor noise
+    uint32_t seed = 3;
+    unsigned long windows = estimator.getWindows();
+    // The drop stays in the window for 10.24 s, then the misses run out
+    while (estimator.getWindows() < windows + 20) {
+        seed = seed * 1664525u + 1013904223u;
+        estimator.addSample(static_cast<uint16_t>(1200 + (seed >> 28)));
+    }
+    ASSERT_FALSE(estimator.isConfident());
+    ASSERT_TRUE(estimator.getBpm() == 0.0f);
+}
+
+TEST(test_estimate_dropped_after_max_misses) {
+    Esp32Estimator estimator = makeEsp32Estimator();
+    PulseSignal signal(66.0f, 150.0f);
+    unsigned long sample = 0;
+    for (; sample < 5000; ++sample) {
+        estimator.addSample(signal.next(sample));
+    }
+    ASSERT_TRUE(estimator.isConfident());
+
+    // Count the weak windows in a row once the finger is off
+    uint32_t seed = 3;
+    unsigned long windows = estimator.getWindows();
+    unsigned misses = 0;
+    while (estimator.getBpm() > 0.0f && estimator.getWindows() < windows + 30) {
+        seed = seed * 1664525u + 1013904223u;
+        unsigned long before = estimator.getWindows();
+        estimator.addSample(static_cast<uint16_t>(1200 + (seed >> 28)));
+        if (estimator.getWindows() != before) {
+            misses = estimator.isConfident() ? 0 : misses + 1;
+        }
+    }
+    ASSERT_TRUE(estimator.getBpm() == 0.0f);
+    ASSERT_EQ(static_cast<unsigned>(FFT_BPM_MAX_MISSES), misses);
+}
+
+TEST(test_weak_pulse_is_scaled_up) {
+    // A pulse far below 14 bits still fills the FFT's range
+    Esp32Estimator estimator = makeEsp32Estimator();
+    PulseSignal signal(72.0f, 40.0f);
+    for (unsigned long sample = 0; sample < 3000; ++sample) {
+        estimator.addSample(signal.next(sample));
+    }
+    ASSERT_TRUE(estimator.isConfident());
+    ASSERT_TRUE(std::fabs(estimator.getBpm() - 72.0f) < 2.0f);
+}
+
+TEST(test_estimate_settles_debouncer) {
+    // The sketch hands the rate to bpmDebouncer once per REPORTING_PERIOD_MS
+    Esp32Estimator estimator = makeEsp32Estimator();
+    ReadingDebouncer<float> debouncer(BPM_TOLERANCE, BPM_STABILITY_DURATION_MS, BPM_SAMPLE_INTERVAL_MS,
+                                      BPM_MIN_VALID, BPM_MAX_VALID);
+    PulseSignal signal(104.0f, 150.0f);
+    signal.setMotion(600.0f);
+    unsigned long stableMs = 0;
+    for (unsigned long sample = 0; sample < 3000 && stableMs == 0; ++sample) {
+        estimator.addSample(signal.next(sample));
+        unsigned long nowMs = sample * 10;
+        if (nowMs % 1000 == 0) {
+            debouncer.update(estimator.getBpm(), nowMs);
+            if (debouncer.isStable()) {
+                stableMs = nowMs;
+            }
+        }
+    }
+    // First window at 10.24 s, then BPM_STABILITY_DURATION_MS of agreement
+    ASSERT_TRUE(stableMs >= 11000u + BPM_STABILITY_DURATION_MS);
+    ASSERT_TRUE(stableMs <= 11000u + BPM_STABILITY_DURATION_MS + 2000u);
+    ASSERT_TRUE(std::fabs(debouncer.getStableReading() - 104.0f) < BPM_TOLERANCE);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "FFT BPM Estimator Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_fft_tone_lands_in_its_bin);
+    RUN_TEST(test_fft_matches_float_dft);
+    RUN_TEST(test_estimator_finds_resting_rate);
+    RUN_TEST(test_estimator_resolves_between_bins);
+    RUN_TEST(test_reduced_window_for_uno);
+    RUN_TEST(test_estimator_holds_rate_through_motion);
+    RUN_TEST(test_no_finger_drops_estimate);
+    RUN_TEST(test_estimate_dropped_after_max_misses);
+    RUN_TEST(test_weak_pulse_is_scaled_up);
+    RUN_TEST(test_estimate_settles_debouncer);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -259,6 +259,23 @@ TEST(test_large_values) {
     ASSERT_EQ(199, debouncer.getStableReading());
 }
 
+TEST(test_restore_continues_stability_timer) {
+    HeightDebouncer debouncer(2, 500, 100);
+    debouncer.setToleranceCm(3);
+    debouncer.update(150, 0);
+    debouncer.update(153, 300);
+
+    // Checkpoint carries the adapted tolerance and the timer start
+    HeightDebouncer moved(2, 500, 100);
+    moved.restore(debouncer.getCheckpoint());
+    ASSERT_EQ(3, moved.getToleranceCm());
+    ASSERT_FALSE(moved.isStable());
+
+    moved.update(151, 500);
+    ASSERT_TRUE(moved.isStable());
+    ASSERT_EQ(151, moved.getStableReading());
+}
+
 // ============================================
 // Main Test Runner
 // ============================================
@@ -283,6 +300,7 @@ int main() {
     RUN_TEST(test_edge_case_just_outside_tolerance);
     RUN_TEST(test_continuous_update_after_stable);
     RUN_TEST(test_large_values);
+    RUN_TEST(test_restore_continues_stability_timer);
     
     std::cout << "========================================" << std::endl;
     std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
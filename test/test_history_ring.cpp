@@ -0,0 +1,239 @@
+#include <iostream>
+#include <cassert>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "history_ring.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+struct ByteWriter {
+    std::vector<uint8_t> bytes;
+    void write(uint8_t b) { bytes.push_back(b); }
+};
+
+struct Collector {
+    std::vector<HistorySample> samples;
+    void onHistorySample(const HistorySample& sample) { samples.push_back(sample); }
+};
+
+template<uint16_t CAPACITY, uint8_t CHANNELS>
+bool decodeAll(const HistoryRing<CAPACITY, CHANNELS>& ring, Collector& out, HistoryDumpInfo& info) {
+    ByteWriter writer;
+    ring.dump(writer, 42, 123456);
+    if (writer.bytes.size() != ring.getDumpSize() ||
+        !decodeHistoryDump(writer.bytes.data(), writer.bytes.size(), &info)) {
+        return false;
+    }
+    for (uint8_t b = 0; b < info.blockCount; ++b) {
+        if (decodeHistoryBlock(info.blocks + b * info.blockSize, info.blockSize, info.channels,
+                               info.sampleIntervalMs, out) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================
+// Encoding Tests
+// ============================================
+
+TEST(test_round_trip_all_token_sizes) {
+    HistoryRing<512, 2> ring(500);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> small(-6, 6);
+    std::uniform_int_distribution<int> medium(-120, 120);
+    std::uniform_int_distribution<int> large(-20000, 20000);
+    std::vector<int16_t> expected;
+    int16_t values[2] = { 72, 97 };
+    for (int i = 0; i < 60; ++i) {
+        values[0] = static_cast<int16_t>(i % 10 == 5 ? large(rng) : values[0] + small(rng));
+        values[1] = static_cast<int16_t>(i % 3 == 0 ? values[1] + medium(rng) : values[1]);
+        ring.add(1000 + 500 * i, values);
+        expected.push_back(values[0]);
+        expected.push_back(values[1]);
+    }
+
+    Collector out;
+    HistoryDumpInfo info;
+    ASSERT_TRUE(decodeAll(ring, out, info));
+    ASSERT_EQ(42u, info.deviceId);
+    ASSERT_EQ(123456u, info.nowMs);
+    ASSERT_EQ(500, info.sampleIntervalMs);
+    ASSERT_EQ(60u, out.samples.size());
+    for (size_t i = 0; i < out.samples.size(); ++i) {
+        ASSERT_EQ(1000u + 500u * i, out.samples[i].timeMs);
+        ASSERT_EQ(expected[2 * i], out.samples[i].values[0]);
+        ASSERT_EQ(expected[2 * i + 1], out.samples[i].values[1]);
+    }
+}
+
+TEST(test_steady_readings_fit_the_budget) {
+    // A height station standing still: 512 bytes cover more than 6 minutes at 500 ms
+    HistoryRing<512, 1> ring(500);
+    int16_t height = 172;
+    for (int i = 0; i < 780; ++i) {
+        height = static_cast<int16_t>(172 + (i % 4 == 0 ? 1 : 0));
+        ring.add(500 * i, &height);
+    }
+    ASSERT_TRUE(sizeof(ring) <= 512 + 32);
+
+    Collector out;
+    HistoryDumpInfo info;
+    ASSERT_TRUE(decodeAll(ring, out, info));
+    ASSERT_EQ(780u, out.samples.size());
+    ASSERT_EQ(0u, out.samples[0].timeMs);
+}
+
+TEST(test_eviction_keeps_newest_samples) {
+    HistoryRing<64, 1> ring(100);
+    for (int i = 0; i < 1000; ++i) {
+        int16_t value = static_cast<int16_t>(i);   // every step is +1
+        ring.add(100 * i, &value);
+    }
+    ASSERT_EQ(2, ring.getBlockCount());
+    ASSERT_EQ(1000u, ring.getSamplesAdded());
+
+    Collector out;
+    HistoryDumpInfo info;
+    ASSERT_TRUE(decodeAll(ring, out, info));
+    ASSERT_TRUE(out.samples.size() > 50);
+    ASSERT_EQ(999, out.samples.back().values[0]);
+    ASSERT_EQ(99900u, out.samples.back().timeMs);
+    for (size_t i = 1; i < out.samples.size(); ++i) {
+        ASSERT_EQ(out.samples[i - 1].values[0] + 1, out.samples[i].values[0]);
+        ASSERT_EQ(out.samples[i - 1].timeMs + 100, out.samples[i].timeMs);
+    }
+}
+
+TEST(test_gaps_and_jitter_keep_time) {
+    HistoryRing<256, 1> ring(500);
+    int16_t value = 150;
+    ring.add(1000, &value);
+    ring.add(1510, &value);      // jitter snaps to the grid
+    ring.add(2020, &value);
+    ring.add(12000, &value);     // 20 slots skipped while the sensor was busy
+    ring.add(500000, &value);    // long outage starts a new block
+
+    Collector out;
+    HistoryDumpInfo info;
+    ASSERT_TRUE(decodeAll(ring, out, info));
+    ASSERT_EQ(5u, out.samples.size());
+    ASSERT_EQ(1000u, out.samples[0].timeMs);
+    ASSERT_EQ(1500u, out.samples[1].timeMs);
+    ASSERT_EQ(2000u, out.samples[2].timeMs);
+    ASSERT_EQ(12000u, out.samples[3].timeMs);
+    ASSERT_EQ(500000u, out.samples[4].timeMs);
+    ASSERT_EQ(2, info.blockCount);
+}
+
+TEST(test_transition_markers) {
+    HistoryRing<256, 2> ring(1000);
+    int16_t values[2] = { 70, 98 };
+    ring.mark(0, true);
+    ring.add(0, values);           // block header carries the marker
+    ring.add(1000, values);
+    ring.mark(1, true);
+    ring.mark(0, false);
+    ring.add(2000, values);
+
+    Collector out;
+    HistoryDumpInfo info;
+    ASSERT_TRUE(decodeAll(ring, out, info));
+    ASSERT_EQ(3u, out.samples.size());
+    ASSERT_EQ(1, out.samples[0].stableMask);
+    ASSERT_EQ(0, out.samples[0].unstableMask);
+    ASSERT_EQ(0, out.samples[1].stableMask | out.samples[1].unstableMask);
+    ASSERT_EQ(2, out.samples[2].stableMask);
+    ASSERT_EQ(1, out.samples[2].unstableMask);
+}
+
+// ============================================
+// Dump Tests
+// ============================================
+
+TEST(test_dump_rejects_corruption) {
+    HistoryRing<128, 1> ring(500);
+    int16_t value = 120;
+    for (int i = 0; i < 40; ++i) {
+        ring.add(500 * i, &value);
+    }
+    ByteWriter writer;
+    ring.dump(writer, 7, 20000);
+    HistoryDumpInfo info;
+    ASSERT_TRUE(decodeHistoryDump(writer.bytes.data(), writer.bytes.size(), &info));
+    ASSERT_FALSE(decodeHistoryDump(writer.bytes.data(), writer.bytes.size() - 1, &info));
+
+    writer.bytes[HISTORY_DUMP_HEADER_SIZE + 3] ^= 0x10;
+    ASSERT_FALSE(decodeHistoryDump(writer.bytes.data(), writer.bytes.size(), &info));
+
+    HistoryRing<128, 1> empty(500);
+    ByteWriter emptyWriter;
+    empty.dump(emptyWriter, 7, 0);
+    ASSERT_TRUE(decodeHistoryDump(emptyWriter.bytes.data(), emptyWriter.bytes.size(), &info));
+    ASSERT_EQ(0, info.blockCount);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "History Ring Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_round_trip_all_token_sizes);
+    RUN_TEST(test_steady_readings_fit_the_budget);
+    RUN_TEST(test_eviction_keeps_newest_samples);
+    RUN_TEST(test_gaps_and_jitter_keep_time);
+    RUN_TEST(test_transition_markers);
+    RUN_TEST(test_dump_rejects_corruption);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,370 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "Wire.h"
+#include "LiquidCrystal_I2C.h"
+#include "Adafruit_SSD1306.h"
+#include "MAX30100_PulseOximeter.h"
+#include "host_devices.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+/**
+ * Fresh host bus and clock, recording to trace
+ */
+void resetHost(I2cTrace& trace) {
+    hostClock().reset();
+    hostI2cBus().detachAll();
+    hostI2cBus().setFrequencyHz(100000);
+    hostI2cBus().setRecorder(&trace);
+    trace.clear();
+}
+
+void writeBytes(I2cBus& bus, uint8_t address, uint8_t first, uint8_t second) {
+    uint8_t data[2] = { first, second };
+    bus.write(address, data, sizeof(data), true);
+}
+
+/**
+ * Run a PulseOximeter for durationMs, sampling the bus every 10 ms
+ */
+void runOximeter(PulseOximeter& pox, unsigned long durationMs) {
+    while (millis() < durationMs) {
+        hostI2cBus().markLoop();
+        pox.update();
+        delay(10);
+    }
+}
+
+// ============================================
+// Bus and trace
+// ============================================
+
+TEST(test_bus_records_and_nacks) {
+    I2cBus bus;
+    I2cTrace trace;
+    I2cAckDevice device;
+    bus.attach(0x27, &device);
+    bus.setRecorder(&trace);
+
+    writeBytes(bus, 0x27, 0x01, 0x02);
+    bus.markLoop();
+    ASSERT_EQ(I2C_STATUS_ADDRESS_NACK, bus.write(0x28, NULL, 0, true));
+    uint8_t buffer[4];
+    ASSERT_EQ(4u, bus.read(0x27, buffer, sizeof(buffer)));
+    ASSERT_EQ(0u, bus.read(0x28, buffer, sizeof(buffer)));
+
+    ASSERT_EQ(4u, trace.size());
+    ASSERT_EQ(1ul, trace.getLoopCount());
+    ASSERT_EQ(0ul, trace.at(0).loop);
+    ASSERT_EQ(2u, trace.at(0).bytes.size());
+    ASSERT_EQ(I2C_STATUS_OK, trace.at(0).status);
+    ASSERT_EQ(1ul, trace.at(1).loop);
+    ASSERT_EQ(I2C_STATUS_ADDRESS_NACK, trace.at(1).status);
+    ASSERT_EQ(I2C_READ, trace.at(2).type);
+    ASSERT_EQ(4, trace.at(2).requested);
+    ASSERT_TRUE(trace.at(3).bytes.empty());
+    ASSERT_EQ(4ul, bus.getTransactionCount());
+}
+
+TEST(test_bus_charges_transfer_time) {
+    I2cBus bus;
+    HostClock clock;
+    I2cAckDevice device;
+    bus.attach(0x3C, &device);
+    bus.setClock(&clock);
+
+    // Start + address + 2 data bytes + stop = 29 bits: 290 us at 100 kHz
+    writeBytes(bus, 0x3C, 0x00, 0xAF);
+    ASSERT_EQ(290ull, clock.nowUs());
+
+    // A NACKed address costs only the address byte
+    bus.setFrequencyHz(400000);
+    bus.write(0x10, NULL, 0, true);
+    ASSERT_EQ(290ull + 28, clock.nowUs());
+}
+
+TEST(test_trace_save_and_load) {
+    I2cBus bus;
+    I2cTrace trace;
+    I2cAckDevice device;
+    bus.attach(0x57, &device);
+    bus.setRecorder(&trace);
+
+    uint8_t reg = 0x05;
+    bus.write(0x57, &reg, 1, false);
+    uint8_t buffer[8];
+    bus.read(0x57, buffer, sizeof(buffer));
+    bus.markLoop();
+    bus.markLoop();
+    bus.write(0x20, NULL, 0, true);
+    bus.markLoop();
+
+    const char* path = "test_i2c_trace.tmp";
+    ASSERT_TRUE(trace.save(path));
+    I2cTrace loaded;
+    ASSERT_TRUE(loaded.load(path));
+    std::remove(path);
+
+    ASSERT_EQ(trace.size(), loaded.size());
+    ASSERT_EQ(3ul, loaded.getLoopCount());
+    for (size_t i = 0; i < trace.size(); ++i) {
+        ASSERT_EQ(trace.at(i).loop, loaded.at(i).loop);
+        ASSERT_EQ(trace.at(i).address, loaded.at(i).address);
+        ASSERT_EQ(trace.at(i).type, loaded.at(i).type);
+        ASSERT_EQ(trace.at(i).status, loaded.at(i).status);
+        ASSERT_EQ(trace.at(i).stop, loaded.at(i).stop);
+        ASSERT_EQ(trace.at(i).requested, loaded.at(i).requested);
+        ASSERT_TRUE(trace.at(i).bytes == loaded.at(i).bytes);
+    }
+    ASSERT_FALSE(trace.at(0).stop);
+
+    ASSERT_FALSE(loaded.load("does_not_exist.trace"));
+    ASSERT_EQ(0u, loaded.size());
+}
+
+TEST(test_stats_per_loop) {
+    I2cBus bus;
+    I2cTrace trace;
+    I2cAckDevice device;
+    bus.attach(0x27, &device);
+    bus.attach(0x57, &device);
+    bus.setRecorder(&trace);
+
+    writeBytes(bus, 0x57, 0x06, 0x03);   // setup
+    for (int loop = 0; loop < 4; ++loop) {
+        bus.markLoop();
+        writeBytes(bus, 0x27, 0x08, 0x0C);
+        if (loop == 3) {
+            writeBytes(bus, 0x57, 0x02, 0x00);
+        }
+    }
+
+    I2cTraceStats stats;
+    stats.compute(trace);
+    ASSERT_EQ(4ul, stats.loops);
+    ASSERT_EQ(1ul, stats.setup.transactions);
+    ASSERT_EQ(2ull, stats.setup.bytes);
+    ASSERT_EQ(5ul, stats.perLoop.transactions);
+    ASSERT_EQ(10ull, stats.perLoop.bytes);
+    ASSERT_EQ(2u, stats.byAddress.size());
+    ASSERT_EQ(4ul, stats.byAddress[0x27].transactions);
+    ASSERT_EQ(1ul, stats.byAddress[0x57].transactions);
+    ASSERT_EQ(4ull, stats.maxLoopBytes);
+    ASSERT_EQ(2ul, stats.maxLoopTransactions);
+    ASSERT_TRUE(stats.getTransactionsPerLoop() == 1.25);
+    ASSERT_TRUE(stats.getBytesPerLoop() == 2.5);
+    ASSERT_TRUE(stats.getBusBitsPerLoop() == 5 * 29 / 4.0);
+}
+
+TEST(test_replay_device_order_and_mismatches) {
+    I2cTrace trace;
+    I2cTransaction transaction;
+    transaction.timeUs = 0;
+    transaction.loop = 0;
+    transaction.address = 0x57;
+    transaction.type = I2C_READ;
+    transaction.status = I2C_STATUS_OK;
+    transaction.stop = true;
+    transaction.requested = 2;
+    transaction.bytes.push_back(0x11);
+    transaction.bytes.push_back(0x22);
+    trace.add(transaction);
+    transaction.bytes[0] = 0x33;
+    trace.add(transaction);
+    transaction.address = 0x27;
+    transaction.type = I2C_WRITE;
+    trace.add(transaction);
+
+    I2cReplayDevice replay(trace, 0x57);
+    ASSERT_EQ(2u, replay.getResponseCount());
+    std::vector<uint8_t> addresses = I2cReplayDevice::respondingAddresses(trace);
+    ASSERT_EQ(2u, addresses.size());
+    ASSERT_EQ(0x27, addresses[0]);
+    ASSERT_EQ(0x57, addresses[1]);
+
+    uint8_t buffer[3];
+    ASSERT_EQ(2u, replay.onRead(buffer, 2));
+    ASSERT_EQ(0x11, buffer[0]);
+    ASSERT_EQ(0ul, replay.getMismatches());
+
+    // Longer read than captured: padded with 0xFF and counted
+    ASSERT_EQ(3u, replay.onRead(buffer, 3));
+    ASSERT_EQ(0x33, buffer[0]);
+    ASSERT_EQ(0xFF, buffer[2]);
+    ASSERT_EQ(1ul, replay.getMismatches());
+
+    // Past the end of the capture
+    ASSERT_EQ(0u, replay.getRemaining());
+    replay.onRead(buffer, 1);
+    ASSERT_EQ(2ul, replay.getMismatches());
+}
+
+// ============================================
+// Host HAL libraries
+// ============================================
+
+TEST(test_lcd_write_traffic) {
+    I2cTrace trace;
+    resetHost(trace);
+    I2cAckDevice device;
+    hostI2cBus().attach(0x27, &device);
+
+    LiquidCrystal_I2C lcd(0x27, 16, 2);
+    lcd.init();
+    trace.clear();
+
+    // Every command or character is 2 nibbles x 3 expander writes
+    lcd.setCursor(0, 1);
+    ASSERT_EQ(6u, trace.size());
+    lcd.print("HR");
+    ASSERT_EQ(18u, trace.size());
+    for (size_t i = 0; i < trace.size(); ++i) {
+        ASSERT_EQ(1u, trace.at(i).bytes.size());
+    }
+    ASSERT_TRUE(std::string(lcd.getRow(1)).substr(0, 2) == "HR");
+}
+
+TEST(test_oled_display_traffic) {
+    I2cTrace trace;
+    resetHost(trace);
+    I2cAckDevice device;
+    hostI2cBus().attach(0x3C, &device);
+
+    Adafruit_SSD1306 oled(128, 64, &Wire, -1);
+    ASSERT_TRUE(oled.begin(SSD1306_SWITCHCAPVCC, 0x3C));
+    trace.clear();
+
+    // Two command transactions, then 1024 bytes of buffer at 31 per transaction
+    oled.display();
+    ASSERT_EQ(2u + 34u, trace.size());
+    I2cTraceStats stats;
+    stats.compute(trace);
+    ASSERT_EQ(6u + 2u + 1024u + 34u, stats.setup.bytes);
+}
+
+TEST(test_pulse_oximeter_reads_simulated_sensor) {
+    I2cTrace trace;
+    resetHost(trace);
+    SimulatedMax30100 sensor(hostClock());
+    sensor.setPatient(0, 72.0f, 97);
+    hostI2cBus().attach(MAX30100_I2C_ADDRESS, &sensor);
+
+    PulseOximeter pox;
+    ASSERT_TRUE(pox.begin());
+    runOximeter(pox, 2000);
+    ASSERT_TRUE(pox.getHeartRate() == 72.0f);
+    ASSERT_EQ(97, pox.getSpO2());
+    ASSERT_TRUE(sensor.getSamplesProduced() > 150);
+
+    // Without the sensor begin() fails on the part ID
+    hostI2cBus().detachAll();
+    PulseOximeter missing;
+    ASSERT_FALSE(missing.begin());
+}
+
+TEST(test_record_then_replay_reproduces_readings) {
+    I2cTrace recorded;
+    resetHost(recorded);
+    SimulatedMax30100 sensor(hostClock());
+    sensor.setPatient(0, 0.0f, 0);
+    sensor.setPatient(500, 64.5f, 95);
+    sensor.setPatient(1500, 88.0f, 99);
+    hostI2cBus().attach(MAX30100_I2C_ADDRESS, &sensor);
+
+    std::vector<float> live;
+    PulseOximeter pox;
+    ASSERT_TRUE(pox.begin());
+    while (millis() < 2500) {
+        pox.update();
+        live.push_back(pox.getHeartRate());
+        delay(10);
+    }
+
+    I2cTrace replayed;
+    resetHost(replayed);
+    I2cReplayDevice replay(recorded, MAX30100_I2C_ADDRESS);
+    hostI2cBus().attach(MAX30100_I2C_ADDRESS, &replay);
+
+    PulseOximeter again;
+    ASSERT_TRUE(again.begin());
+    for (size_t i = 0; i < live.size(); ++i) {
+        again.update();
+        ASSERT_TRUE(again.getHeartRate() == live[i]);
+        delay(10);
+    }
+    ASSERT_EQ(0ul, replay.getMismatches());
+    ASSERT_EQ(0u, replay.getRemaining());
+    ASSERT_EQ(recorded.size(), replayed.size());
+    hostI2cBus().setRecorder(NULL);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "I2C Trace Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_bus_records_and_nacks);
+    RUN_TEST(test_bus_charges_transfer_time);
+    RUN_TEST(test_trace_save_and_load);
+    RUN_TEST(test_stats_per_loop);
+    RUN_TEST(test_replay_device_order_and_mismatches);
+    RUN_TEST(test_lcd_write_traffic);
+    RUN_TEST(test_oled_display_traffic);
+    RUN_TEST(test_pulse_oximeter_reads_simulated_sensor);
+    RUN_TEST(test_record_then_replay_reproduces_readings);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,315 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "apptech_debounce.h"
+#include "line_tokenizer.h"
+#include "trace_parser.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+
+// ============================================
+// Helpers
+// ============================================
+
+class CollectingSink : public TraceSampleSink {
+public:
+    std::vector<TraceSample> samples;
+    virtual void onSample(const TraceSample& sample) { samples.push_back(sample); }
+};
+
+uint32_t nextRandom(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+/**
+ * Both sketches' output interleaved with blank, CRLF, junk and malformed
+ * lines and numbers of every width
+ */
+std::string makeLog(size_t lines, uint32_t seed) {
+    std::string log;
+    uint32_t state = seed;
+    char line[128];
+    unsigned long timeMs = 0;
+    for (size_t i = 0; i < lines; ++i) {
+        uint32_t kind = nextRandom(state) % 10;
+        timeMs += nextRandom(state) % 2000;
+        if (kind < 4) {
+            std::snprintf(line, sizeof(line), "Raw: %u cm | Stable: NO\n", nextRandom(state) % 1000);
+        } else if (kind < 8) {
+            unsigned digits = nextRandom(state) % 9;
+            std::snprintf(line, sizeof(line), "[%lums] RAW - BPM:%u.%0*u SpO2:%u%%%s\n", timeMs,
+                          nextRandom(state) % 250, static_cast<int>(digits), digits == 0 ? 0 : nextRandom(state) % 100000000u,
+                          nextRandom(state) % 101, kind == 7 ? "\r" : "");
+            if (digits == 0) {
+                // "72." with no fraction digits, and the bare "72" form
+                std::string text(line);
+                size_t dot = text.find('.');
+                text.erase(dot + 1, 1);
+                if (nextRandom(state) & 1) {
+                    text.erase(dot, 1);
+                }
+                std::snprintf(line, sizeof(line), "%s", text.c_str());
+            }
+        } else if (kind == 8) {
+            std::snprintf(line, sizeof(line), "%s\n", (nextRandom(state) & 1) ? "" : "   ");
+        } else {
+            static const char* kJunk[] = { "MAX30100 init OK\n", "Raw: cm\n", "[12ms] RAW - BPM:x SpO2:1%\n",
+                                           "[99ms] RAW - BPM:70.5 SpO2:\n", "Stable: YES (150 cm)\n",
+                                           "  Raw: 12345678901234567 cm\n", "[123456789012ms] RAW - BPM:-3.25 SpO2:0%\n" };
+            std::snprintf(line, sizeof(line), "%s", kJunk[nextRandom(state) % 7]);
+        }
+        log += line;
+    }
+    return log;
+}
+
+/**
+ * Samples of one channel as TraceParser would deliver them
+ */
+void expectSameAsTraceParser(const std::string& log, const std::vector<size_t>& blockSizes) {
+    CollectingSink sink;
+    TraceParser parser(&sink, 1);
+    parser.feed(log.data(), log.size());
+    parser.finish();
+
+    LineTokenizer tokenizer;
+    LogColumns columns;
+    size_t offset = 0;
+    size_t block = 0;
+    while (offset < log.size()) {
+        size_t length = blockSizes.empty() ? log.size() : blockSizes[block++ % blockSizes.size()];
+        if (length > log.size() - offset) {
+            length = log.size() - offset;
+        }
+        // Each block from its own exact-size buffer, so reads past it would be caught by sanitizers
+        std::vector<char> copy(log.begin() + offset, log.begin() + offset + length);
+        tokenizer.feed(copy.data(), copy.size(), columns);
+        offset += length;
+    }
+    tokenizer.finish(columns);
+
+    ASSERT_EQ(parser.getLinesParsed(), tokenizer.getLinesParsed());
+    ASSERT_EQ(parser.getLinesSkipped(), tokenizer.getLinesSkipped());
+    size_t next[SAMPLE_CHANNEL_COUNT] = { 0, 0, 0 };
+    for (size_t i = 0; i < sink.samples.size(); ++i) {
+        const TraceSample& sample = sink.samples[i];
+        size_t& index = next[sample.channel];
+        ASSERT_TRUE(index < columns.size(sample.channel));
+        ASSERT_EQ(static_cast<uint64_t>(sample.timeMs), columns.timesMs[sample.channel][index]);
+        ASSERT_TRUE(static_cast<double>(sample.value) == columns.values[sample.channel][index]);
+        index++;
+    }
+    for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        ASSERT_EQ(next[channel], columns.size(channel));
+    }
+}
+
+// ============================================
+// Scanning primitives
+// ============================================
+
+TEST(test_newline_mask_matches_scalar_scan) {
+    uint32_t state = 5;
+    char block[64];
+    for (int round = 0; round < 1000; ++round) {
+        uint64_t expected = 0;
+        for (int i = 0; i < 64; ++i) {
+            uint32_t r = nextRandom(state) % 8;
+            block[i] = r == 0 ? '\n' : static_cast<char>(r == 1 ? 0x8A : nextRandom(state) & 0xFF);
+            if (block[i] == '\n') {
+                expected |= 1ULL << i;
+            }
+        }
+        ASSERT_TRUE(lineTokenizerNewlineMask(block) == expected);
+    }
+}
+
+TEST(test_parse_unsigned_widths_and_boundaries) {
+    char buffer[32];
+    uint64_t value = 0;
+    for (int digits = 1; digits <= 19; ++digits) {
+        std::string number(digits, '0');
+        uint64_t expected = 0;
+        for (int i = 0; i < digits; ++i) {
+            number[i] = static_cast<char>('1' + (i * 7) % 9);
+            expected = expected * 10 + static_cast<uint64_t>(number[i] - '0');
+        }
+        // Terminated by a delimiter, by the line end and by the buffer end
+        std::snprintf(buffer, sizeof(buffer), "%s cm", number.c_str());
+        const char* end = buffer + std::strlen(buffer);
+        const char* after = lineTokenizerParseUnsigned(buffer, end, end, &value);
+        ASSERT_TRUE(after == buffer + digits);
+        ASSERT_TRUE(value == expected);
+
+        after = lineTokenizerParseUnsigned(buffer, buffer + digits, end, &value);
+        ASSERT_TRUE(after == buffer + digits);
+        ASSERT_TRUE(value == expected);
+
+        std::vector<char> exact(number.begin(), number.end());
+        after = lineTokenizerParseUnsigned(exact.data(), exact.data() + exact.size(), exact.data() + exact.size(),
+                                           &value);
+        ASSERT_TRUE(after == exact.data() + exact.size());
+        ASSERT_TRUE(value == expected);
+    }
+
+    // Bytes just outside '0'..'9' and non-ASCII bytes end the run
+    const char kNotDigits[] = { '/', ':', '\xB0', '\xFA', '\xFF', 'a', ' ', '\0' };
+    for (size_t i = 0; i < sizeof(kNotDigits); ++i) {
+        std::snprintf(buffer, sizeof(buffer), "12%c4567890123", kNotDigits[i]);
+        buffer[2] = kNotDigits[i];
+        const char* after = lineTokenizerParseUnsigned(buffer, buffer + 13, buffer + 13, &value);
+        ASSERT_TRUE(after == buffer + 2);
+        ASSERT_TRUE(value == 12);
+    }
+    ASSERT_TRUE(lineTokenizerParseUnsigned(buffer + 2, buffer + 13, buffer + 13, &value) == NULL);
+}
+
+// ============================================
+// LineTokenizer
+// ============================================
+
+TEST(test_parses_both_formats_into_columns) {
+    const std::string log = "Raw: 150 cm | Stable: NO\n"
+                            "[1200ms] RAW - BPM:72.50 SpO2:97%\n"
+                            "Raw: 151 cm | Stable: YES (151 cm)\n"
+                            "[1300ms] RAW - BPM:0.00 SpO2:0%\n";
+    LineTokenizer tokenizer(100);
+    LogColumns columns;
+    tokenizer.feed(log.data(), log.size(), columns);
+
+    ASSERT_EQ(4ul, tokenizer.getLinesParsed());
+    ASSERT_EQ(2u, columns.size(CHANNEL_HEIGHT));
+    ASSERT_TRUE(columns.values[CHANNEL_HEIGHT][1] == 151.0);
+    ASSERT_TRUE(columns.timesMs[CHANNEL_HEIGHT][1] == 100);
+    ASSERT_EQ(2u, columns.size(CHANNEL_BPM));
+    ASSERT_TRUE(columns.values[CHANNEL_BPM][0] == 72.5);
+    ASSERT_TRUE(columns.timesMs[CHANNEL_BPM][0] == 1200);
+    ASSERT_EQ(2u, columns.size(CHANNEL_SPO2));
+    ASSERT_TRUE(columns.values[CHANNEL_SPO2][0] == 97.0);
+    ASSERT_TRUE(columns.timesMs[CHANNEL_SPO2][1] == 1300);
+
+    columns.clear();
+    ASSERT_EQ(0u, columns.size(CHANNEL_BPM));
+}
+
+TEST(test_matches_trace_parser_on_mixed_logs) {
+    for (uint32_t seed = 1; seed <= 20; ++seed) {
+        expectSameAsTraceParser(makeLog(500, seed), std::vector<size_t>());
+    }
+}
+
+TEST(test_matches_trace_parser_across_block_splits) {
+    const std::string log = makeLog(300, 42);
+    for (size_t size = 1; size <= 130; ++size) {
+        expectSameAsTraceParser(log, std::vector<size_t>(1, size));
+    }
+    static const size_t kUneven[] = { 7, 64, 1, 65, 63, 200, 3 };
+    expectSameAsTraceParser(log, std::vector<size_t>(kUneven, kUneven + 7));
+}
+
+TEST(test_unterminated_last_line_needs_finish) {
+    const std::string log = "Raw: 150 cm\n[5ms] RAW - BPM:60.25 SpO2:99%";
+    LineTokenizer tokenizer;
+    LogColumns columns;
+    tokenizer.feed(log.data(), log.size(), columns);
+    ASSERT_EQ(0u, columns.size(CHANNEL_BPM));
+    tokenizer.finish(columns);
+    ASSERT_EQ(1u, columns.size(CHANNEL_BPM));
+    ASSERT_TRUE(columns.values[CHANNEL_BPM][0] == 60.25);
+
+    tokenizer.reset();
+    ASSERT_EQ(0ul, tokenizer.getLinesParsed());
+}
+
+TEST(test_columns_feed_the_batch_api) {
+    std::string log;
+    char line[64];
+    for (int i = 0; i < 50; ++i) {
+        std::snprintf(line, sizeof(line), "Raw: %d cm | Stable: NO\n", i < 10 ? 120 + i * 5 : 172);
+        log += line;
+    }
+    LineTokenizer tokenizer;
+    LogColumns columns;
+    tokenizer.feed(log.data(), log.size(), columns);
+
+    apptech_debounce_config config;
+    ASSERT_EQ(APPTECH_OK, apptech_debounce_config_default(APPTECH_KIND_HEIGHT, &config));
+    apptech_debouncer* debouncer = NULL;
+    ASSERT_EQ(APPTECH_OK, apptech_debouncer_create(&config, &debouncer));
+    apptech_transition transitions[8];
+    size_t count = 0;
+    int status = apptech_debouncer_update(debouncer, columns.values[CHANNEL_HEIGHT].data(),
+                                          columns.timesMs[CHANNEL_HEIGHT].data(), columns.size(CHANNEL_HEIGHT),
+                                          transitions, 8, &count, NULL);
+    apptech_debouncer_destroy(debouncer);
+    ASSERT_EQ(APPTECH_OK, status);
+    ASSERT_EQ(1u, count);
+    ASSERT_EQ(APPTECH_TRANSITION_STABLE, static_cast<int>(transitions[0].type));
+    ASSERT_TRUE(transitions[0].value == 172.0);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Line Tokenizer Unit Tests (" << LineTokenizer::getScanBackend() << ")" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_newline_mask_matches_scalar_scan);
+    RUN_TEST(test_parse_unsigned_widths_and_boundaries);
+    RUN_TEST(test_parses_both_formats_into_columns);
+    RUN_TEST(test_matches_trace_parser_on_mixed_logs);
+    RUN_TEST(test_matches_trace_parser_across_block_splits);
+    RUN_TEST(test_unterminated_last_line_needs_finish);
+    RUN_TEST(test_columns_feed_the_batch_api);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "perf_counters.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+// Counters depend on the host PMU, so these tests check consistency
+// rather than requiring the events to exist.
+
+volatile unsigned long spinSink = 0;
+
+void spin(unsigned long iterations) {
+    for (unsigned long i = 0; i < iterations; ++i) {
+        spinSink = spinSink + i;
+    }
+}
+
+TEST(test_unopened_counters_are_invalid) {
+    PerfCounters counters;
+    ASSERT_FALSE(counters.isAnyAvailable());
+    counters.start();
+    PerfSample sample = counters.stop();
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        ASSERT_FALSE(sample.valid[i]);
+        ASSERT_TRUE(sample.values[i] == 0);
+    }
+}
+
+TEST(test_open_reports_availability) {
+    PerfCounters counters;
+    bool opened = counters.open();
+    ASSERT_TRUE(opened == counters.isAnyAvailable());
+    if (!opened) {
+        std::cout << "(counters unavailable) ";
+    }
+
+    // Only opened events may report valid values
+    counters.start();
+    spin(1000);
+    PerfSample sample = counters.stop();
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (!counters.isAvailable(static_cast<PerfEvent>(i))) {
+            ASSERT_FALSE(sample.valid[i]);
+        }
+    }
+
+    counters.close();
+    ASSERT_FALSE(counters.isAnyAvailable());
+}
+
+TEST(test_instructions_scale_with_work) {
+    PerfCounters counters;
+    if (!counters.open() || !counters.isAvailable(PERF_EVENT_INSTRUCTIONS)) {
+        std::cout << "(skipped: no instruction counter) ";
+        return;
+    }
+
+    const unsigned long iterations = 1000000;
+    counters.start();
+    spin(iterations);
+    PerfSample sample = counters.stop();
+    if (!sample.valid[PERF_EVENT_INSTRUCTIONS]) {
+        std::cout << "(skipped: counter never scheduled) ";
+        return;
+    }
+    // Each iteration retires at least a load, add, store and branch
+    ASSERT_TRUE(sample.values[PERF_EVENT_INSTRUCTIONS] > iterations);
+}
+
+TEST(test_event_names) {
+    ASSERT_TRUE(std::string(PerfCounters::eventName(PERF_EVENT_CYCLES)) == "cycles");
+    ASSERT_TRUE(std::string(PerfCounters::eventName(PERF_EVENT_INSTRUCTIONS)) == "instructions");
+    ASSERT_TRUE(std::string(PerfCounters::eventName(PERF_EVENT_BRANCH_MISSES)) == "branch-misses");
+    ASSERT_TRUE(std::string(PerfCounters::eventName(PERF_EVENT_CACHE_MISSES)) == "cache-misses");
+    ASSERT_TRUE(std::string(PerfCounters::eventName(PERF_EVENT_DTLB_MISSES)) == "dTLB-load-misses");
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Perf Counters Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_unopened_counters_are_invalid);
+    RUN_TEST(test_open_reports_availability);
+    RUN_TEST(test_instructions_scale_with_work);
+    RUN_TEST(test_event_names);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -305,6 +305,24 @@ TEST(test_just_outside_tolerance) {
     ASSERT_FALSE(debouncer.isStable());
 }
 
+TEST(test_restore_continues_stability_timer) {
+    ReadingDebouncer<int> debouncer(2, 500, 100, 70, 100);
+    debouncer.update(95, 0);
+    debouncer.update(96, 200);
+
+    // Halfway to stable when moved; the copy must not start over
+    ReadingDebouncer<int> moved(2, 500, 100, 70, 100);
+    moved.restore(debouncer.getCheckpoint());
+    ASSERT_TRUE(moved.hasValidReading());
+    ASSERT_EQ(96, moved.getLastReading());
+    ASSERT_EQ(200UL, moved.getLastSampleTime());
+
+    moved.update(96, 250);      // inside the sample interval, skipped
+    moved.update(95, 500);
+    ASSERT_TRUE(moved.isStable());
+    ASSERT_EQ(95, moved.getStableReading());
+}
+
 // ============================================
 // Main Test Runner
 // ============================================
@@ -338,6 +356,7 @@ int main() {
     RUN_TEST(test_continuous_update_maintains_stability);
     RUN_TEST(test_edge_tolerance_boundary);
     RUN_TEST(test_just_outside_tolerance);
+    RUN_TEST(test_restore_continues_stability_timer);
     
     std::cout << "\n========================================" << std::endl;
     std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include "record_emitter.h"
+
+// Counts heap allocations so tests can prove the emit path never allocates
+static unsigned long allocationCount = 0;
+
+void* operator new(std::size_t size) {
+    allocationCount++;
+    void* memory = std::malloc(size ? size : 1);
+    if (memory == NULL) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+#define ASSERT_STR_EQ(expected, actual) do { \
+    if (std::string(expected) != std::string(actual)) { \
+        throw std::runtime_error("Assertion failed: \"" + std::string(expected) + "\" == \"" + \
+            std::string(actual) + "\""); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+class StringSink : public ChunkSink {
+public:
+    std::string output;
+    unsigned long chunks;
+
+    StringSink() : chunks(0) {}
+
+    virtual void onChunk(const char* data, size_t length) {
+        output.append(data, length);
+        chunks++;
+    }
+};
+
+ReadingRecord makeReading(uint32_t deviceId, unsigned long timeMs, float value, uint8_t channel, bool stable) {
+    ReadingRecord record;
+    record.deviceId = deviceId;
+    record.timeMs = timeMs;
+    record.value = value;
+    record.channel = channel;
+    record.stable = stable;
+    record.valid = true;
+    return record;
+}
+
+std::string formatFloat(float value) {
+    char out[16];
+    size_t length = formatShortestFloat(value, out);
+    return std::string(out, length);
+}
+
+// ============================================
+// Number Formatting Tests
+// ============================================
+
+TEST(test_format_unsigned) {
+    char out[20];
+    ASSERT_STR_EQ("0", std::string(out, formatUnsigned(0, out)));
+    ASSERT_STR_EQ("7", std::string(out, formatUnsigned(7, out)));
+    ASSERT_STR_EQ("42", std::string(out, formatUnsigned(42, out)));
+    ASSERT_STR_EQ("100", std::string(out, formatUnsigned(100, out)));
+    ASSERT_STR_EQ("4294967295", std::string(out, formatUnsigned(4294967295ULL, out)));
+    ASSERT_STR_EQ("18446744073709551615", std::string(out, formatUnsigned(18446744073709551615ULL, out)));
+}
+
+TEST(test_format_float_is_shortest) {
+    ASSERT_STR_EQ("72.5", formatFloat(72.5f));
+    ASSERT_STR_EQ("150", formatFloat(150.0f));
+    ASSERT_STR_EQ("0.1", formatFloat(0.1f));
+    ASSERT_STR_EQ("98.25", formatFloat(98.25f));
+    ASSERT_STR_EQ("", formatFloat(std::numeric_limits<float>::quiet_NaN()));
+}
+
+TEST(test_format_float_round_trips) {
+    uint32_t state = 12345;
+    for (int i = 0; i < 100000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        float value = static_cast<float>(state % 2000000) / 100.0f;
+        std::string text = formatFloat(value);
+        ASSERT_TRUE(std::strtof(text.c_str(), NULL) == value);
+    }
+}
+
+// ============================================
+// Emitter Tests
+// ============================================
+
+TEST(test_json_reading_record) {
+    char buffer[1024];
+    JsonEmitter emitter(buffer, sizeof(buffer), NULL);
+    ASSERT_TRUE(emitter.emitReading(makeReading(3, 12345, 72.5f, CHANNEL_BPM, true)));
+    ASSERT_STR_EQ("{\"device_id\":3,\"time_ms\":12345,\"channel\":\"bpm\",\"value\":72.5,\"stable\":true,\"valid\":true}\n",
+                  std::string(emitter.data(), emitter.size()));
+}
+
+TEST(test_json_transition_record) {
+    char buffer[1024];
+    JsonEmitter emitter(buffer, sizeof(buffer), NULL);
+    StabilityTransition transition;
+    transition.deviceId = 9;
+    transition.timeMs = 3000;
+    transition.value = 151.0f;
+    transition.channel = CHANNEL_HEIGHT;
+    transition.stable = false;
+    ASSERT_TRUE(emitter.emitTransition(transition));
+    ASSERT_STR_EQ("{\"device_id\":9,\"time_ms\":3000,\"channel\":\"height\",\"stable\":false,\"value\":151}\n",
+                  std::string(emitter.data(), emitter.size()));
+}
+
+TEST(test_csv_header_and_rows) {
+    char buffer[1024];
+    CsvEmitter emitter(buffer, sizeof(buffer), NULL);
+    ASSERT_TRUE(emitter.emitHeader(kReadingRecordSchema));
+    ASSERT_TRUE(emitter.emitReading(makeReading(1, 200, 97.0f, CHANNEL_SPO2, false)));
+    ASSERT_STR_EQ("device_id,time_ms,channel,value,stable,valid\n1,200,spo2,97,0,1\n",
+                  std::string(emitter.data(), emitter.size()));
+}
+
+TEST(test_full_buffer_without_sink) {
+    char buffer[200];
+    JsonEmitter emitter(buffer, sizeof(buffer), NULL);
+    ASSERT_TRUE(emitter.maxRecordSize(kReadingRecordSchema) <= sizeof(buffer));
+    ASSERT_TRUE(emitter.emitReading(makeReading(1, 1, 1.0f, CHANNEL_BPM, false)));
+    ASSERT_FALSE(emitter.emitReading(makeReading(1, 2, 1.0f, CHANNEL_BPM, false)));
+
+    // Draining the buffer makes room again
+    emitter.clear();
+    ASSERT_TRUE(emitter.emitReading(makeReading(1, 2, 1.0f, CHANNEL_BPM, false)));
+}
+
+TEST(test_oversized_schema_is_refused) {
+    // 40 columns of up to 20 digits each cannot fit a 512-byte buffer
+    static const char* const names[] = {
+        "c00", "c01", "c02", "c03", "c04", "c05", "c06", "c07", "c08", "c09",
+        "c10", "c11", "c12", "c13", "c14", "c15", "c16", "c17", "c18", "c19",
+        "c20", "c21", "c22", "c23", "c24", "c25", "c26", "c27", "c28", "c29",
+        "c30", "c31", "c32", "c33", "c34", "c35", "c36", "c37", "c38", "c39",
+    };
+    const size_t fieldCount = sizeof(names) / sizeof(names[0]);
+    FieldSpec fields[fieldCount];
+    unsigned long record[fieldCount];
+    for (size_t i = 0; i < fieldCount; ++i) {
+        fields[i].name = names[i];
+        fields[i].kind = FIELD_ULONG;
+        fields[i].offset = i * sizeof(unsigned long);
+        record[i] = static_cast<unsigned long>(-1);
+    }
+    RecordSchema wide = { fields, fieldCount };
+
+    // Guard bytes after the buffer catch any write past its end
+    char storage[512 + 64];
+    std::memset(storage, '#', sizeof(storage));
+    StringSink sink;
+    JsonEmitter json(storage, 512, &sink);
+    ASSERT_TRUE(json.maxRecordSize(wide) > 512);
+    ASSERT_TRUE(json.emitReading(makeReading(1, 1, 1.0f, CHANNEL_BPM, false)));
+    ASSERT_FALSE(json.emit(wide, record));
+    CsvEmitter csv(storage, 512, NULL);
+    ASSERT_FALSE(csv.emit(wide, record));
+    for (size_t i = 512; i < sizeof(storage); ++i) {
+        ASSERT_TRUE(storage[i] == '#');
+    }
+
+    // Records that do fit still go through after the refusal
+    ASSERT_TRUE(json.emitReading(makeReading(1, 2, 1.0f, CHANNEL_BPM, false)));
+    json.flush();
+    ASSERT_EQ(2u, static_cast<unsigned>(std::count(sink.output.begin(), sink.output.end(), '\n')));
+}
+
+TEST(test_chunked_output_matches_single_buffer) {
+    static char large[1 << 20];
+    JsonEmitter whole(large, sizeof(large), NULL);
+
+    char small[2048];
+    StringSink sink;
+    JsonEmitter chunked(small, sizeof(small), &sink);
+
+    for (unsigned i = 0; i < 1000; ++i) {
+        ReadingRecord record = makeReading(i % 7, i * 100, 60.0f + static_cast<float>(i % 40) * 0.25f,
+                                           CHANNEL_BPM, i % 3 == 0);
+        ASSERT_TRUE(whole.emitReading(record));
+        ASSERT_TRUE(chunked.emitReading(record));
+    }
+    chunked.flush();
+
+    ASSERT_TRUE(sink.chunks > 10);
+    ASSERT_TRUE(sink.output == std::string(whole.data(), whole.size()));
+}
+
+TEST(test_emit_does_not_allocate) {
+    char buffer[4096];
+    StringSink sink;
+    sink.output.reserve(1 << 20);
+    CsvEmitter emitter(buffer, sizeof(buffer), &sink);
+
+    unsigned long before = allocationCount;
+    for (unsigned i = 0; i < 10000; ++i) {
+        emitter.emitReading(makeReading(i, i * 100, static_cast<float>(i % 200) + 0.5f, CHANNEL_HEIGHT, true));
+    }
+    unsigned long after = allocationCount;
+    emitter.flush();
+
+    ASSERT_EQ(before, after);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Record Emitter Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_format_unsigned);
+    RUN_TEST(test_format_float_is_shortest);
+    RUN_TEST(test_format_float_round_trips);
+    RUN_TEST(test_json_reading_record);
+    RUN_TEST(test_json_transition_record);
+    RUN_TEST(test_csv_header_and_rows);
+    RUN_TEST(test_full_buffer_without_sink);
+    RUN_TEST(test_oversized_schema_is_refused);
+    RUN_TEST(test_chunked_output_matches_single_buffer);
+    RUN_TEST(test_emit_does_not_allocate);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,470 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "config.h"
+#include "replay_cache.h"
+#include "trace_reader.h"
+#include "trace_replayer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+
+
+// ============================================
+// Helpers
+// ============================================
+
+/**
+ * Transitions and stable updates in the order they were reported
+ */
+class OutputCollector : public StabilityTransitionSink {
+public:
+    std::vector<StabilityTransition> records;
+    std::vector<bool> updates;
+
+    virtual void onTransition(const StabilityTransition& transition) {
+        records.push_back(transition);
+        updates.push_back(false);
+    }
+    virtual void onStableUpdate(const StabilityTransition& transition) {
+        records.push_back(transition);
+        updates.push_back(true);
+    }
+};
+
+struct ReplayOutput {
+    OutputCollector sink;
+    unsigned long samples;
+    unsigned long transitions;
+    unsigned long linesParsed;
+    unsigned long linesSkipped;
+    unsigned long blocksReused;
+    unsigned long blocksReplayed;
+    unsigned long filesUnchanged;
+};
+
+/**
+ * Small blocks (about 16 lines) so a few hundred lines span many of them
+ */
+ReplayCacheOptions smallBlocks() {
+    ReplayCacheOptions options;
+    options.minBlockBytes = 256;
+    options.maxBlockBytes = 8192;
+    options.cutBits = 4;
+    return options;
+}
+
+ReadingDebouncer<float> bpmDebouncer(float tolerance) {
+    return ReadingDebouncer<float>(tolerance, BPM_STABILITY_DURATION_MS, BPM_SAMPLE_INTERVAL_MS, BPM_MIN_VALID,
+                                   BPM_MAX_VALID);
+}
+
+ReadingDebouncer<int> spo2Debouncer() {
+    return ReadingDebouncer<int>(SPO2_TOLERANCE, SPO2_STABILITY_DURATION_MS, SPO2_SAMPLE_INTERVAL_MS,
+                                 SPO2_MIN_VALID, SPO2_MAX_VALID);
+}
+
+/**
+ * Oximeter log: a patient every 40 reports, the finger lifted between
+ * patients, and the sketch's other output lines in between
+ */
+std::string oximeterLog(int reports) {
+    std::string log;
+    uint32_t seed = 7;
+    for (int i = 0; i < reports; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        int patient = i / 40;
+        bool fingerOff = i % 40 >= 36;
+        float bpm = fingerOff ? 0.0f : 62.0f + 7.0f * (patient % 5) + static_cast<float>((seed >> 16) % 5) * 0.5f;
+        int spo2 = fingerOff ? 0 : 95 + static_cast<int>((seed >> 20) % 3);
+        char line[96];
+        std::snprintf(line, sizeof(line), "[%dms] RAW - BPM:%.2f SpO2:%d%%\n", 1000 * i, bpm, spo2);
+        log += line;
+        log += "      DEBOUNCE - BPM:valid SpO2:valid\n";
+        if (i % 3 == 0) {
+            log += "Beat!\n";
+        }
+    }
+    return log;
+}
+
+/**
+ * Height log: a patient every 60 pings, an empty platform between them
+ */
+std::string heightLog(int pings) {
+    std::string log;
+    for (int i = 0; i < pings; ++i) {
+        int distance = i % 60 >= 50 ? 0 : 140 + 9 * ((i / 60) % 6) + (i % 3);
+        log += "Raw: " + std::to_string(distance) + " cm | Stable: NO\n";
+    }
+    return log;
+}
+
+void feedFiles(TraceBlockHandler& handler, const std::vector<std::string>& logs, size_t chunk) {
+    // Interleave the files block by block, as the reader does
+    for (size_t offset = 0;; offset += chunk) {
+        bool any = false;
+        for (size_t f = 0; f < logs.size(); ++f) {
+            if (offset < logs[f].size()) {
+                size_t length = std::min(chunk, logs[f].size() - offset);
+                handler.onBlock(f, logs[f].data() + offset, length);
+                any = true;
+            }
+        }
+        if (!any) {
+            break;
+        }
+    }
+    for (size_t f = 0; f < logs.size(); ++f) {
+        handler.onFileEnd(f);
+    }
+}
+
+void replayPlain(const std::vector<std::string>& logs, const ReadingDebouncer<float>& bpm, ReplayOutput& out) {
+    TraceFileReplay replay(HeightDebouncer(), bpm, spo2Debouncer(), &out.sink);
+    feedFiles(replay, logs, 4096);
+    out.samples = replay.getSamplesProcessed();
+    out.transitions = replay.getTransitionCount();
+    out.linesParsed = replay.getLinesParsed();
+    out.linesSkipped = replay.getLinesSkipped();
+    out.blocksReused = 0;
+    out.blocksReplayed = 0;
+    out.filesUnchanged = 0;
+}
+
+void replayCached(const std::vector<std::string>& logs, const ReadingDebouncer<float>& bpm, ReplayCache& cache,
+                  size_t chunk, ReplayOutput& out) {
+    CachedTraceFileReplay replay(HeightDebouncer(), bpm, spo2Debouncer(), &out.sink, &cache);
+    feedFiles(replay, logs, chunk);
+    out.samples = replay.getSamplesProcessed();
+    out.transitions = replay.getTransitionCount();
+    out.linesParsed = replay.getLinesParsed();
+    out.linesSkipped = replay.getLinesSkipped();
+    out.blocksReused = replay.getBlocksReused();
+    out.blocksReplayed = replay.getBlocksReplayed();
+    out.filesUnchanged = 0;
+}
+
+void replayPaths(const std::vector<std::string>& paths, ReplayCache& cache, AsyncTraceReader& reader,
+                 ReplayOutput& out) {
+    CachedTraceFileReplay replay(HeightDebouncer(), bpmDebouncer(BPM_TOLERANCE), spo2Debouncer(), &out.sink, &cache);
+    ASSERT_TRUE(replay.run(reader, paths));
+    out.samples = replay.getSamplesProcessed();
+    out.transitions = replay.getTransitionCount();
+    out.linesParsed = replay.getLinesParsed();
+    out.linesSkipped = replay.getLinesSkipped();
+    out.blocksReused = replay.getBlocksReused();
+    out.blocksReplayed = replay.getBlocksReplayed();
+    out.filesUnchanged = replay.getFilesUnchanged();
+}
+
+bool writeFile(const std::string& path, const std::string& contents) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = std::fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+/**
+ * Records equal in order, per device; counters equal
+ */
+bool sameOutput(const ReplayOutput& a, const ReplayOutput& b) {
+    if (a.samples != b.samples || a.transitions != b.transitions || a.linesParsed != b.linesParsed ||
+        a.linesSkipped != b.linesSkipped || a.sink.records.size() != b.sink.records.size()) {
+        return false;
+    }
+    for (uint32_t device = 0; device < 2; ++device) {
+        std::vector<size_t> left;
+        std::vector<size_t> right;
+        for (size_t i = 0; i < a.sink.records.size(); ++i) {
+            if (a.sink.records[i].deviceId == device) left.push_back(i);
+            if (b.sink.records[i].deviceId == device) right.push_back(i);
+        }
+        if (left.size() != right.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < left.size(); ++i) {
+            const StabilityTransition& x = a.sink.records[left[i]];
+            const StabilityTransition& y = b.sink.records[right[i]];
+            if (x.timeMs != y.timeMs || x.value != y.value || x.channel != y.channel || x.stable != y.stable ||
+                a.sink.updates[left[i]] != b.sink.updates[right[i]]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> corpus() {
+    std::vector<std::string> logs;
+    logs.push_back(heightLog(600));
+    logs.push_back(oximeterLog(400));
+    return logs;
+}
+
+// ============================================
+// Replay Tests
+// ============================================
+
+TEST(test_cold_cache_matches_plain_replay) {
+    std::vector<std::string> logs = corpus();
+    ReplayOutput plain;
+    replayPlain(logs, bpmDebouncer(BPM_TOLERANCE), plain);
+    ReplayCache cache(smallBlocks());
+    ReplayOutput cached;
+    replayCached(logs, bpmDebouncer(BPM_TOLERANCE), cache, 4096, cached);
+
+    ASSERT_TRUE(plain.transitions > 20);
+    ASSERT_TRUE(sameOutput(plain, cached));
+    ASSERT_EQ(0ul, cached.blocksReused);
+    ASSERT_TRUE(cached.blocksReplayed > 40);
+    ASSERT_EQ(static_cast<size_t>(cached.blocksReplayed), cache.getEntryCount());
+}
+
+TEST(test_rerun_reuses_every_block) {
+    std::vector<std::string> logs = corpus();
+    ReplayCache cache(smallBlocks());
+    ReplayOutput first;
+    replayCached(logs, bpmDebouncer(BPM_TOLERANCE), cache, 4096, first);
+
+    // Blocks are cut on content, so the reader's block size does not matter
+    ReplayOutput second;
+    replayCached(logs, bpmDebouncer(BPM_TOLERANCE), cache, 7, second);
+    ASSERT_TRUE(sameOutput(first, second));
+    ASSERT_EQ(0ul, second.blocksReplayed);
+    ASSERT_EQ(first.blocksReplayed, second.blocksReused);
+}
+
+TEST(test_edit_recomputes_nearby_blocks) {
+    std::vector<std::string> logs = corpus();
+    ReplayCache cache(smallBlocks());
+    ReplayOutput first;
+    replayCached(logs, bpmDebouncer(BPM_TOLERANCE), cache, 4096, first);
+
+    // A wrong ping mid-patient and a corrected BPM report
+    std::vector<std::string> edited = logs;
+    size_t ping = edited[0].find("Raw: ", edited[0].size() / 2);
+    edited[0].replace(ping, 8, "Raw: 199");
+    size_t report = edited[1].find("BPM:", edited[1].size() / 2);
+    edited[1].replace(report + 4, 2, "99");
+
+    ReplayOutput plain;
+    replayPlain(edited, bpmDebouncer(BPM_TOLERANCE), plain);
+    ReplayOutput second;
+    replayCached(edited, bpmDebouncer(BPM_TOLERANCE), cache, 4096, second);
+    ASSERT_TRUE(sameOutput(plain, second));
+    ASSERT_FALSE(sameOutput(first, second));
+    // Each edit reaches until the next patient at most
+    ASSERT_TRUE(second.blocksReplayed >= 2);
+    ASSERT_TRUE(second.blocksReplayed <= 12);
+    ASSERT_TRUE(second.blocksReused > second.blocksReplayed * 3);
+}
+
+TEST(test_appended_log_reuses_prefix) {
+    std::vector<std::string> logs = corpus();
+    ReplayCache cache(smallBlocks());
+    ReplayOutput first;
+    replayCached(logs, bpmDebouncer(BPM_TOLERANCE), cache, 4096, first);
+
+    std::vector<std::string> grown;
+    grown.push_back(heightLog(700));
+    grown.push_back(oximeterLog(480));
+    ReplayOutput plain;
+    replayPlain(grown, bpmDebouncer(BPM_TOLERANCE), plain);
+    ReplayOutput second;
+    replayCached(grown, bpmDebouncer(BPM_TOLERANCE), cache, 4096, second);
+    ASSERT_TRUE(sameOutput(plain, second));
+    ASSERT_TRUE(second.blocksReused >= first.blocksReplayed - 2);
+}
+
+TEST(test_config_change_misses) {
+    std::vector<std::string> logs = corpus();
+    ReplayCache cache(smallBlocks());
+    ReplayOutput first;
+    replayCached(logs, bpmDebouncer(BPM_TOLERANCE), cache, 4096, first);
+
+    ReplayOutput plain;
+    replayPlain(logs, bpmDebouncer(1.0f), plain);
+    ReplayOutput second;
+    replayCached(logs, bpmDebouncer(1.0f), cache, 4096, second);
+    ASSERT_TRUE(sameOutput(plain, second));
+    ASSERT_EQ(0ul, second.blocksReused);
+
+    // Both configurations stay cached
+    ReplayOutput third;
+    replayCached(logs, bpmDebouncer(BPM_TOLERANCE), cache, 4096, third);
+    ASSERT_TRUE(sameOutput(first, third));
+    ASSERT_EQ(0ul, third.blocksReplayed);
+}
+
+// ============================================
+// Persistence Tests
+// ============================================
+
+TEST(test_save_and_load_round_trip) {
+    std::vector<std::string> logs = corpus();
+    std::string path = "/tmp/replay_cache_test_" + std::to_string(getpid()) + ".rplc";
+    ReplayOutput first;
+    {
+        ReplayCache cache(smallBlocks());
+        replayCached(logs, bpmDebouncer(BPM_TOLERANCE), cache, 4096, first);
+        ASSERT_TRUE(cache.save(path.c_str()));
+    }
+
+    ReplayCache loaded(smallBlocks());
+    ASSERT_TRUE(loaded.load(path.c_str()));
+    ASSERT_EQ(static_cast<size_t>(first.blocksReplayed), loaded.getEntryCount());
+    ReplayOutput second;
+    replayCached(logs, bpmDebouncer(BPM_TOLERANCE), loaded, 4096, second);
+    ASSERT_TRUE(sameOutput(first, second));
+    ASSERT_EQ(0ul, second.blocksReplayed);
+
+    // A truncated file is rejected and leaves the cache empty
+    ASSERT_EQ(0, truncate(path.c_str(), 100));
+    ASSERT_FALSE(loaded.load(path.c_str()));
+    ASSERT_EQ(static_cast<size_t>(0), loaded.getEntryCount());
+    unlink(path.c_str());
+    ASSERT_FALSE(loaded.load(path.c_str()));
+}
+
+TEST(test_idle_entries_dropped) {
+    ReplayCacheOptions options = smallBlocks();
+    options.maxIdleRuns = 0;
+    std::string path = "/tmp/replay_cache_idle_" + std::to_string(getpid()) + ".rplc";
+    std::vector<std::string> heightOnly(1, heightLog(600));
+    std::vector<std::string> oximeterOnly(1, oximeterLog(400));
+
+    ReplayCache cache(options);
+    ReplayOutput first;
+    replayCached(heightOnly, bpmDebouncer(BPM_TOLERANCE), cache, 4096, first);
+    ASSERT_TRUE(cache.save(path.c_str()));
+
+    // The next run only uses the oximeter log; the height blocks age out
+    ASSERT_TRUE(cache.load(path.c_str()));
+    ReplayOutput second;
+    replayCached(oximeterOnly, bpmDebouncer(BPM_TOLERANCE), cache, 4096, second);
+    ASSERT_TRUE(cache.save(path.c_str()));
+    ASSERT_TRUE(cache.load(path.c_str()));
+    unlink(path.c_str());
+    ASSERT_EQ(static_cast<size_t>(second.blocksReplayed), cache.getEntryCount());
+}
+
+TEST(test_unchanged_files_skip_reading) {
+    std::vector<std::string> logs = corpus();
+    std::string base = "/tmp/replay_cache_files_" + std::to_string(getpid());
+    std::string cachePath = base + ".rplc";
+    std::vector<std::string> paths;
+    paths.push_back(base + "_height.log");
+    paths.push_back(base + "_oximeter.log");
+    for (size_t i = 0; i < paths.size(); ++i) {
+        ASSERT_TRUE(writeFile(paths[i], logs[i]));
+    }
+    TraceReaderOptions readerOptions;
+    readerOptions.useIoUring = false;
+    AsyncTraceReader reader(readerOptions);
+
+    ReplayOutput first;
+    {
+        ReplayCache cache(smallBlocks());
+        replayPaths(paths, cache, reader, first);
+        ASSERT_EQ(0ul, first.filesUnchanged);
+        ASSERT_EQ(static_cast<size_t>(2), cache.getFileCount());
+        ASSERT_TRUE(cache.save(cachePath.c_str()));
+    }
+
+    // Nothing changed: no file is read
+    ReplayCache cache(smallBlocks());
+    ASSERT_TRUE(cache.load(cachePath.c_str()));
+    ReplayOutput second;
+    replayPaths(paths, cache, reader, second);
+    ASSERT_TRUE(sameOutput(first, second));
+    ASSERT_EQ(2ul, second.filesUnchanged);
+    ASSERT_EQ(0ul, second.blocksReplayed);
+    ASSERT_TRUE(reader.getBytesRead() == 0);
+    ASSERT_FALSE(cache.isModified());
+
+    // A rewritten log is read again; the other one is still skipped
+    std::vector<std::string> edited = logs;
+    edited[1] += oximeterLog(420).substr(logs[1].size());
+    ASSERT_TRUE(writeFile(paths[1], edited[1]));
+    ReplayOutput plain;
+    replayPlain(edited, bpmDebouncer(BPM_TOLERANCE), plain);
+    ReplayOutput third;
+    replayPaths(paths, cache, reader, third);
+    ASSERT_TRUE(sameOutput(plain, third));
+    ASSERT_EQ(1ul, third.filesUnchanged);
+    ASSERT_TRUE(reader.getBytesRead() == edited[1].size());
+    ASSERT_TRUE(cache.isModified());
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        unlink(paths[i].c_str());
+    }
+    unlink(cachePath.c_str());
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Replay Cache Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_cold_cache_matches_plain_replay);
+    RUN_TEST(test_rerun_reuses_every_block);
+    RUN_TEST(test_edit_recomputes_nearby_blocks);
+    RUN_TEST(test_appended_log_reuses_prefix);
+    RUN_TEST(test_config_change_misses);
+    RUN_TEST(test_save_and_load_round_trip);
+    RUN_TEST(test_idle_entries_dropped);
+    RUN_TEST(test_unchanged_files_skip_reading);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
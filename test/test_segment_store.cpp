@@ -0,0 +1,523 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "segment_store.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+
+// ============================================
+// Helpers
+// ============================================
+
+const unsigned long kHourMs = 60UL * 60UL * 1000UL;
+
+std::string tempStoreDir() {
+    char path[] = "/tmp/segment_store_XXXXXX";
+    return mkdtemp(path) != NULL ? path : "";
+}
+
+std::vector<std::string> listFiles(const std::string& directory) {
+    std::vector<std::string> names;
+    DIR* dir = opendir(directory.c_str());
+    if (dir != NULL) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') {
+                names.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+    }
+    return names;
+}
+
+void removeStoreDir(const std::string& directory) {
+    std::vector<std::string> names = listFiles(directory);
+    for (size_t i = 0; i < names.size(); ++i) {
+        std::remove((directory + "/" + names[i]).c_str());
+    }
+    rmdir(directory.c_str());
+}
+
+TraceSample makeSample(uint32_t deviceId, unsigned long timeMs, uint8_t channel, float value) {
+    TraceSample sample;
+    sample.deviceId = deviceId;
+    sample.timeMs = timeMs;
+    sample.channel = channel;
+    sample.value = value;
+    return sample;
+}
+
+// Every device reports height, BPM and SpO2 once a minute for some hours
+void ingestHours(SegmentStore& store, uint32_t devices, unsigned long hours) {
+    for (unsigned long minute = 0; minute < hours * 60; ++minute) {
+        unsigned long timeMs = minute * 60000UL;
+        for (uint32_t device = 1; device <= devices; ++device) {
+            store.append(makeSample(device, timeMs, CHANNEL_HEIGHT, 150.0f + device));
+            store.append(makeSample(device, timeMs, CHANNEL_BPM, 60.0f + (minute % 30)));
+            store.append(makeSample(device, timeMs, CHANNEL_SPO2, device == 7 && minute == 125 ? 85.0f : 97.0f));
+        }
+    }
+}
+
+bool sameRows(const std::vector<TraceSample>& a, const std::vector<TraceSample>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].deviceId != b[i].deviceId || a[i].timeMs != b[i].timeMs || a[i].channel != b[i].channel ||
+            a[i].value != b[i].value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================
+// Zone maps and device filters
+// ============================================
+
+TEST(test_zone_map_bounds_time_and_values) {
+    SegmentZoneMap zone;
+    ASSERT_FALSE(zone.overlapsTime(0, 1000));
+
+    zone.add(makeSample(1, 5000, CHANNEL_BPM, 72.0f));
+    zone.add(makeSample(2, 9000, CHANNEL_BPM, 80.0f));
+    zone.add(makeSample(2, 7000, CHANNEL_SPO2, 95.0f));
+    ASSERT_EQ(3u, zone.rows);
+    ASSERT_TRUE(zone.overlapsTime(9000, 20000));
+    ASSERT_TRUE(zone.overlapsTime(0, 5000));
+    ASSERT_FALSE(zone.overlapsTime(9001, 20000));
+    ASSERT_TRUE(zone.overlapsValue(CHANNEL_BPM, 0.0f, 72.0f));
+    ASSERT_FALSE(zone.overlapsValue(CHANNEL_BPM, 81.0f, 200.0f));
+    ASSERT_FALSE(zone.overlapsValue(CHANNEL_SPO2, 0.0f, 90.0f));
+    ASSERT_FALSE(zone.overlapsValue(CHANNEL_HEIGHT, 0.0f, 1000.0f));   // no height rows
+}
+
+TEST(test_device_filter_has_no_false_negatives) {
+    DeviceBloomFilter filter;
+    filter.reset(1000);
+    for (uint32_t device = 0; device < 1000; ++device) {
+        filter.add(device * 7919u);
+    }
+    for (uint32_t device = 0; device < 1000; ++device) {
+        ASSERT_TRUE(filter.mayContain(device * 7919u));
+    }
+
+    int falsePositives = 0;
+    for (uint32_t device = 0; device < 10000; ++device) {
+        if (filter.mayContain(device * 7919u + 1)) {
+            falsePositives++;
+        }
+    }
+    ASSERT_TRUE(falsePositives < 300);   // about 1% expected
+
+    DeviceBloomFilter empty;
+    ASSERT_FALSE(empty.mayContain(1));
+}
+
+// ============================================
+// Sealing and queries
+// ============================================
+
+TEST(test_segments_are_sealed_per_span) {
+    std::string dir = tempStoreDir();
+    {
+        SegmentStore store(dir, SegmentStoreConfig());
+        ASSERT_TRUE(store.open());
+        ingestHours(store, 4, 3);
+
+        // The first two hours are sealed, the third is still buffered
+        ASSERT_EQ(2u, store.getSegmentCount());
+        ASSERT_EQ(static_cast<size_t>(4 * 3 * 60), store.getBufferedRows());
+        ASSERT_EQ(2u, listFiles(dir).size());
+
+        SegmentQuery all;
+        std::vector<TraceSample> rows;
+        ASSERT_EQ(static_cast<size_t>(4 * 3 * 3 * 60), store.query(all, rows));
+        for (size_t i = 1; i < rows.size(); ++i) {
+            ASSERT_TRUE(rows[i - 1].deviceId < rows[i].deviceId ||
+                        (rows[i - 1].deviceId == rows[i].deviceId && rows[i - 1].timeMs <= rows[i].timeMs));
+        }
+
+        ASSERT_TRUE(store.flush());
+        ASSERT_EQ(3u, store.getSegmentCount());
+        ASSERT_EQ(0u, store.getBufferedRows());
+    }
+    removeStoreDir(dir);
+}
+
+TEST(test_queries_skip_segments_by_zone_map_and_device_filter) {
+    std::string dir = tempStoreDir();
+    {
+        SegmentStoreConfig config;
+        config.segmentSpanMs = kHourMs / 4;
+        SegmentStore store(dir, config);
+        ASSERT_TRUE(store.open());
+        ingestHours(store, 8, 4);
+        // A station that was only online in the last quarter hour
+        for (unsigned long minute = 225; minute < 240; ++minute) {
+            store.append(makeSample(99, minute * 60000UL, CHANNEL_BPM, 70.0f));
+        }
+        ASSERT_TRUE(store.flush());
+        ASSERT_EQ(16u, store.getSegmentCount());
+
+        // One device over one hour: only that hour's four segments are read
+        SegmentQuery hour;
+        hour.allDevices = false;
+        hour.deviceId = 3;
+        hour.fromMs = kHourMs;
+        hour.toMs = 2 * kHourMs - 1;
+        std::vector<TraceSample> rows;
+        SegmentScanStats stats;
+        ASSERT_EQ(static_cast<size_t>(60 * 3), store.query(hour, rows, &stats));
+        ASSERT_EQ(16u, stats.segments);
+        ASSERT_EQ(12u, stats.skippedByTime);
+        ASSERT_EQ(4u, stats.scanned);
+        ASSERT_EQ(static_cast<uint64_t>(15 * 3 * 4), stats.rowsRead);   // just the device's rows
+        for (size_t i = 0; i < rows.size(); ++i) {
+            ASSERT_EQ(3u, rows[i].deviceId);
+        }
+
+        // The late station: the device filters rule out most segments
+        SegmentQuery late;
+        late.allDevices = false;
+        late.deviceId = 99;
+        rows.clear();
+        ASSERT_EQ(15u, store.query(late, rows, &stats));
+        ASSERT_TRUE(stats.skippedByDevice >= 13);
+        ASSERT_TRUE(stats.scanned <= 3);
+
+        // Low SpO2 anywhere: the value ranges leave the one segment with it
+        SegmentQuery low;
+        low.allChannels = false;
+        low.channel = CHANNEL_SPO2;
+        low.maxValue = 90.0f;
+        rows.clear();
+        ASSERT_EQ(1u, store.query(low, rows, &stats));
+        ASSERT_EQ(7u, rows[0].deviceId);
+        ASSERT_EQ(125UL * 60000UL, rows[0].timeMs);
+        ASSERT_EQ(15u, stats.skippedByValue);
+        ASSERT_EQ(1u, stats.scanned);
+    }
+    removeStoreDir(dir);
+}
+
+TEST(test_failed_seal_is_retried) {
+    std::string dir = tempStoreDir();
+    {
+        SegmentStoreConfig config;
+        config.segmentSpanMs = kHourMs;
+        SegmentStore store(dir, config);
+        ASSERT_TRUE(store.open());
+
+        // The directory vanishes, so the first hour cannot be written
+        ASSERT_EQ(0, rmdir(dir.c_str()));
+        ingestHours(store, 2, 2);
+        ASSERT_EQ(1UL, store.getSealErrors());
+        ASSERT_EQ(1u, store.getUnwrittenSegments());
+        std::vector<TraceSample> before;
+        ASSERT_EQ(static_cast<size_t>(2 * 2 * 60 * 3), store.query(SegmentQuery(), before));
+
+        // The next seal writes it along with the new segment
+        ASSERT_FALSE(store.flush());
+        ASSERT_EQ(0, mkdir(dir.c_str(), 0700));
+        ASSERT_TRUE(store.flush());
+        ASSERT_EQ(0u, store.getUnwrittenSegments());
+        ASSERT_EQ(2u, listFiles(dir).size());
+
+        std::vector<TraceSample> after;
+        store.query(SegmentQuery(), after);
+        ASSERT_TRUE(sameRows(before, after));
+    }
+    removeStoreDir(dir);
+}
+
+// ============================================
+// Compaction
+// ============================================
+
+TEST(test_compaction_merges_small_segments) {
+    std::string dir = tempStoreDir();
+    {
+        SegmentStoreConfig config;
+        config.segmentSpanMs = kHourMs / 4;
+        config.smallSegmentRows = 1000;
+        config.compactedSegmentRows = 3000;
+        SegmentStore store(dir, config);
+        ASSERT_TRUE(store.open());
+        ingestHours(store, 4, 4);   // 16 segments of 180 rows
+        ASSERT_TRUE(store.flush());
+
+        SegmentQuery all;
+        std::vector<TraceSample> before;
+        store.query(all, before);
+
+        // Each step merges the oldest small segments until 3000 rows
+        ASSERT_EQ(16u, store.compact());
+        ASSERT_EQ(0u, store.compact());   // the output is not small
+        ASSERT_EQ(1u, store.getSegmentCount());
+
+        std::vector<SegmentInfo> segments;
+        store.getSegments(segments);
+        ASSERT_EQ(1u, segments[0].level);
+        ASSERT_EQ(static_cast<uint64_t>(16 * 180), segments[0].zone.rows);
+        ASSERT_EQ(0UL, segments[0].zone.minTimeMs);
+        ASSERT_EQ(239UL * 60000UL, segments[0].zone.maxTimeMs);
+        for (uint32_t device = 1; device <= 4; ++device) {
+            ASSERT_TRUE(segments[0].devices.mayContain(device));
+        }
+        ASSERT_EQ(1u, listFiles(dir).size());   // the inputs are gone
+
+        std::vector<TraceSample> after;
+        store.query(all, after);
+        ASSERT_TRUE(sameRows(before, after));
+    }
+    removeStoreDir(dir);
+}
+
+TEST(test_compaction_fills_outputs_to_the_target) {
+    std::string dir = tempStoreDir();
+    {
+        SegmentStoreConfig config;
+        config.segmentSpanMs = kHourMs / 4;
+        config.smallSegmentRows = 500;
+        config.compactedSegmentRows = 720;
+        SegmentStore store(dir, config);
+        ASSERT_TRUE(store.open());
+        ingestHours(store, 4, 4);
+        ASSERT_TRUE(store.flush());
+
+        ASSERT_EQ(4u, store.compact());
+        ASSERT_EQ(4u, store.compact());
+        ASSERT_EQ(4u, store.compact());
+        ASSERT_EQ(4u, store.compact());
+        ASSERT_EQ(0u, store.compact());
+        ASSERT_EQ(4u, store.getSegmentCount());
+
+        // Outputs keep time order in the catalog
+        std::vector<SegmentInfo> segments;
+        store.getSegments(segments);
+        for (size_t i = 0; i < segments.size(); ++i) {
+            ASSERT_EQ(i * kHourMs, segments[i].zone.minTimeMs);
+        }
+    }
+    removeStoreDir(dir);
+}
+
+TEST(test_compaction_keeps_the_catalog_in_id_order) {
+    std::string dir = tempStoreDir();
+    SegmentStoreConfig config;
+    config.segmentSpanMs = kHourMs / 4;
+    config.smallSegmentRows = 200;
+    std::vector<uint64_t> ids;
+    {
+        SegmentStore store(dir, config);
+        ASSERT_TRUE(store.open());
+        ingestHours(store, 4, 1);   // 4 small segments of 180 rows
+        for (unsigned long i = 0; i < 250; ++i) {
+            store.append(makeSample(1, 2 * kHourMs + i, CHANNEL_BPM, 70.0f));   // one large one
+        }
+        ASSERT_TRUE(store.flush());
+
+        // The output's ID is newer than the large segment it skipped
+        ASSERT_EQ(4u, store.compact());
+        std::vector<SegmentInfo> segments;
+        store.getSegments(segments);
+        ASSERT_EQ(2u, segments.size());
+        ASSERT_EQ(0u, segments[0].level);
+        ASSERT_EQ(1u, segments[1].level);
+        ASSERT_TRUE(segments[0].id < segments[1].id);
+        for (size_t i = 0; i < segments.size(); ++i) {
+            ids.push_back(segments[i].id);
+        }
+    }
+
+    // A reopened store lists them the same way
+    SegmentStore reopened(dir, config);
+    ASSERT_TRUE(reopened.open());
+    std::vector<SegmentInfo> segments;
+    reopened.getSegments(segments);
+    ASSERT_EQ(ids.size(), segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        ASSERT_EQ(ids[i], segments[i].id);
+    }
+    removeStoreDir(dir);
+}
+
+// ============================================
+// Persistence
+// ============================================
+
+TEST(test_reopen_drops_superseded_and_unfinished_files) {
+    std::string dir = tempStoreDir();
+    SegmentStoreConfig config;
+    config.segmentSpanMs = kHourMs / 4;
+    config.smallSegmentRows = 1000;
+    std::vector<TraceSample> before;
+    std::string survivor;
+    {
+        SegmentStore store(dir, config);
+        ASSERT_TRUE(store.open());
+        ingestHours(store, 4, 1);
+        ASSERT_TRUE(store.flush());
+        store.query(SegmentQuery(), before);
+
+        // Keep a copy of one input as if the process died before deleting it
+        std::vector<std::string> names = listFiles(dir);
+        survivor = dir + "/" + names[0];
+        std::string copy = survivor + ".keep";
+        ASSERT_EQ(0, link(survivor.c_str(), copy.c_str()));
+        ASSERT_EQ(4u, store.compact());
+        ASSERT_EQ(0, std::rename(copy.c_str(), survivor.c_str()));
+    }
+    FILE* partial = std::fopen((dir + "/seg-00000000000000ff.rseg.tmp").c_str(), "wb");
+    ASSERT_TRUE(partial != NULL);
+    std::fclose(partial);
+    ASSERT_EQ(3u, listFiles(dir).size());
+
+    SegmentStore reopened(dir, config);
+    ASSERT_TRUE(reopened.open());
+    ASSERT_EQ(1u, reopened.getSegmentCount());
+    ASSERT_EQ(1u, listFiles(dir).size());
+
+    std::vector<TraceSample> after;
+    reopened.query(SegmentQuery(), after);
+    ASSERT_TRUE(sameRows(before, after));
+
+    // New segments continue the ID sequence
+    reopened.append(makeSample(1, 10 * kHourMs, CHANNEL_BPM, 70.0f));
+    ASSERT_TRUE(reopened.flush());
+    std::vector<SegmentInfo> segments;
+    reopened.getSegments(segments);
+    ASSERT_EQ(2u, segments.size());
+    ASSERT_TRUE(segments[1].id > segments[0].id);
+    removeStoreDir(dir);
+}
+
+// ============================================
+// Concurrency
+// ============================================
+
+TEST(test_background_compaction_does_not_block_ingestion) {
+    std::string dir = tempStoreDir();
+    {
+        SegmentStoreConfig config;
+        config.segmentSpanMs = 60000;   // a segment per minute
+        config.smallSegmentRows = 2000;
+        config.compactedSegmentRows = 20000;
+        SegmentStore store(dir, config);
+        ASSERT_TRUE(store.open());
+        store.startCompaction(1);
+
+        const uint32_t kWriters = 4;
+        const unsigned long kMinutes = 120;
+        std::vector<std::thread> writers;
+        for (uint32_t w = 0; w < kWriters; ++w) {
+            writers.push_back(std::thread([&store, w]() {
+                for (unsigned long second = 0; second < kMinutes * 60; ++second) {
+                    store.append(makeSample(100 + w, second * 1000UL, CHANNEL_HEIGHT, 170.0f));
+                }
+            }));
+        }
+        // Queries run against the changing catalog too
+        size_t seen = 0;
+        for (int i = 0; i < 20; ++i) {
+            std::vector<TraceSample> rows;
+            SegmentQuery one;
+            one.allDevices = false;
+            one.deviceId = 101;
+            seen = std::max(seen, store.query(one, rows));
+        }
+        for (size_t w = 0; w < writers.size(); ++w) {
+            writers[w].join();
+        }
+        store.stopCompaction();
+        ASSERT_TRUE(store.flush());
+        while (store.compact() > 0) {
+        }
+
+        ASSERT_EQ(0UL, store.getCompactionErrors());
+        ASSERT_TRUE(store.getSegmentCount() < kMinutes / 4);
+        std::vector<TraceSample> rows;
+        ASSERT_EQ(static_cast<size_t>(kWriters * kMinutes * 60), store.query(SegmentQuery(), rows));
+        for (size_t i = 1; i < rows.size(); ++i) {
+            ASSERT_FALSE(rows[i - 1].deviceId == rows[i].deviceId && rows[i - 1].timeMs == rows[i].timeMs);
+        }
+        ASSERT_TRUE(seen <= kMinutes * 60);
+        ASSERT_EQ(store.getSegmentCount(), listFiles(dir).size());
+    }
+    removeStoreDir(dir);
+}
+
+// ============================================
+// Main
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Segment Store Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_zone_map_bounds_time_and_values);
+    RUN_TEST(test_device_filter_has_no_false_negatives);
+    RUN_TEST(test_segments_are_sealed_per_span);
+    RUN_TEST(test_queries_skip_segments_by_zone_map_and_device_filter);
+    RUN_TEST(test_failed_seal_is_retried);
+    RUN_TEST(test_compaction_merges_small_segments);
+    RUN_TEST(test_compaction_fills_outputs_to_the_target);
+    RUN_TEST(test_compaction_keeps_the_catalog_in_id_order);
+    RUN_TEST(test_reopen_drops_superseded_and_unfinished_files);
+    RUN_TEST(test_background_compaction_does_not_block_ingestion);
+
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,311 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "stable_interval_index.h"
+#include "trace_replayer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+StabilityTransition makeTransition(uint32_t deviceId, uint8_t channel, float value, unsigned long timeMs,
+                                   bool stable) {
+    StabilityTransition transition;
+    transition.deviceId = deviceId;
+    transition.channel = channel;
+    transition.value = value;
+    transition.timeMs = timeMs;
+    transition.stable = stable;
+    return transition;
+}
+
+void feedHeight(TraceReplayer& replayer, uint32_t deviceId, float value, unsigned long fromMs, unsigned long toMs) {
+    for (unsigned long t = fromMs; t < toMs; t += 100) {
+        TraceSample sample;
+        sample.deviceId = deviceId;
+        sample.channel = CHANNEL_HEIGHT;
+        sample.value = value;
+        sample.timeMs = t;
+        replayer.onSample(sample);
+    }
+}
+
+// Stable [1000k, 1000k + 500) with value 100 + k for k = 0..count-1
+void buildRegularRun(StableIntervalIndex& index, uint32_t deviceId, unsigned long count) {
+    for (unsigned long k = 0; k < count; ++k) {
+        index.onTransition(makeTransition(deviceId, CHANNEL_BPM, 100.0f + k, 1000 * k, true));
+        index.onTransition(makeTransition(deviceId, CHANNEL_BPM, 0.0f, 1000 * k + 500, false));
+    }
+}
+
+// ============================================
+// Index Tests
+// ============================================
+
+TEST(test_replay_builds_intervals) {
+    StableIntervalIndex index;
+    TraceReplayer replayer(&index);
+    feedHeight(replayer, 3, 150.0f, 0, 3100);      // stable at 3000
+    feedHeight(replayer, 3, 151.0f, 3100, 3200);   // stable reading moves within tolerance
+    feedHeight(replayer, 3, 170.0f, 3200, 3300);   // unstable at 3200
+
+    const StableIntervalRun* run = index.find(3, CHANNEL_HEIGHT);
+    ASSERT_TRUE(run != NULL);
+    ASSERT_EQ(1u, run->size());
+    ASSERT_EQ(3000ul, run->at(0).startMs);
+    ASSERT_EQ(3200ul, run->at(0).endMs);
+    ASSERT_TRUE(run->at(0).minValue == 150.0f);
+    ASSERT_TRUE(run->at(0).maxValue == 151.0f);
+    ASSERT_TRUE(index.find(3, CHANNEL_BPM) == NULL);
+}
+
+TEST(test_stabbing_queries) {
+    StableIntervalIndex index;
+    buildRegularRun(index, 1, 100);
+
+    StableInterval interval;
+    ASSERT_TRUE(index.stab(1, CHANNEL_BPM, 42000, interval));
+    ASSERT_EQ(42000ul, interval.startMs);
+    ASSERT_TRUE(interval.minValue == 142.0f);
+    ASSERT_TRUE(index.stab(1, CHANNEL_BPM, 42499, interval));
+    ASSERT_FALSE(index.stab(1, CHANNEL_BPM, 42500, interval));   // end is exclusive
+    ASSERT_FALSE(index.stab(1, CHANNEL_BPM, 42999, interval));
+    ASSERT_FALSE(index.stab(1, CHANNEL_BPM, 200000, interval));
+    ASSERT_FALSE(index.stab(2, CHANNEL_BPM, 42000, interval));
+}
+
+TEST(test_range_queries_and_summaries) {
+    StableIntervalIndex index;
+    buildRegularRun(index, 1, 100);
+
+    std::vector<StableInterval> out;
+    ASSERT_EQ(3u, index.overlapping(1, CHANNEL_BPM, 10250, 12100, out));
+    ASSERT_EQ(10000ul, out[0].startMs);
+    ASSERT_EQ(12000ul, out[2].startMs);
+    ASSERT_EQ(0u, index.overlapping(1, CHANNEL_BPM, 10500, 10999, out));
+
+    // Clipped at both ends: 250 + 500 + 100 ms of stable time
+    StableIntervalSummary summary;
+    ASSERT_TRUE(index.summarize(1, CHANNEL_BPM, 10250, 12100, summary));
+    ASSERT_EQ(3u, summary.intervals);
+    ASSERT_TRUE(summary.minValue == 110.0f);
+    ASSERT_TRUE(summary.maxValue == 112.0f);
+    ASSERT_EQ(850ul, summary.stableMs);
+
+    // Range inside a single interval
+    ASSERT_TRUE(index.summarize(1, CHANNEL_BPM, 20100, 20300, summary));
+    ASSERT_EQ(1u, summary.intervals);
+    ASSERT_EQ(200ul, summary.stableMs);
+
+    ASSERT_TRUE(index.wasStableBelow(1, CHANNEL_BPM, 10000, 20000, 111.0f));
+    ASSERT_FALSE(index.wasStableBelow(1, CHANNEL_BPM, 11000, 20000, 111.0f));
+    ASSERT_TRUE(index.wasStableAbove(1, CHANNEL_BPM, 0, 99000, 198.5f));
+    ASSERT_FALSE(index.wasStableAbove(1, CHANNEL_BPM, 0, 50000, 198.5f));
+}
+
+TEST(test_partial_overlap_sees_only_readings_in_range) {
+    // Stable at 100 from 1000, the reading drifts to 60 at 5000, unstable at 8000
+    StableIntervalIndex index;
+    index.onTransition(makeTransition(4, CHANNEL_BPM, 100.0f, 1000, true));
+    index.onStableUpdate(makeTransition(4, CHANNEL_BPM, 60.0f, 5000, true));
+    index.onTransition(makeTransition(4, CHANNEL_BPM, 0.0f, 8000, false));
+
+    ASSERT_FALSE(index.wasStableBelow(4, CHANNEL_BPM, 0, 4999, 70.0f));
+    ASSERT_TRUE(index.wasStableAbove(4, CHANNEL_BPM, 0, 4999, 90.0f));
+    ASSERT_TRUE(index.wasStableBelow(4, CHANNEL_BPM, 4000, 5000, 70.0f));
+    ASSERT_TRUE(index.wasStableBelow(4, CHANNEL_BPM, 6000, 7000, 70.0f));   // drifted before the range
+    ASSERT_FALSE(index.wasStableAbove(4, CHANNEL_BPM, 6000, 9000, 90.0f));
+    ASSERT_FALSE(index.wasStableBelow(4, CHANNEL_BPM, 8000, 9000, 70.0f));   // end is exclusive
+
+    StableIntervalSummary summary;
+    ASSERT_TRUE(index.summarize(4, CHANNEL_BPM, 2000, 3000, summary));
+    ASSERT_TRUE(summary.minValue == 100.0f);
+    ASSERT_TRUE(summary.maxValue == 100.0f);
+    ASSERT_TRUE(index.find(4, CHANNEL_BPM)->at(0).minValue == 60.0f);
+
+    // The readings survive a save and load
+    const char* path = "test_stable_interval_partial.sidx";
+    ASSERT_TRUE(index.save(path));
+    StableIntervalIndex loaded;
+    ASSERT_TRUE(loaded.load(path));
+    std::remove(path);
+    ASSERT_FALSE(loaded.wasStableBelow(4, CHANNEL_BPM, 0, 4999, 70.0f));
+    ASSERT_TRUE(loaded.wasStableBelow(4, CHANNEL_BPM, 6000, 7000, 70.0f));
+}
+
+TEST(test_open_interval_and_finish) {
+    StableIntervalIndex index;
+    index.onTransition(makeTransition(5, CHANNEL_SPO2, 97.0f, 1000, true));
+    index.onStableUpdate(makeTransition(5, CHANNEL_SPO2, 96.0f, 1500, true));
+    index.onStableUpdate(makeTransition(5, CHANNEL_SPO2, 97.0f, 2000, true));
+
+    // Still stable: the interval is open and counts up to the last update
+    StableInterval interval;
+    ASSERT_TRUE(index.stab(5, CHANNEL_SPO2, 100000, interval));
+    ASSERT_EQ(static_cast<unsigned long>(STABLE_INTERVAL_OPEN), interval.endMs);
+    StableIntervalSummary summary;
+    ASSERT_TRUE(index.summarize(5, CHANNEL_SPO2, 0, 10000, summary));
+    ASSERT_EQ(1000ul, summary.stableMs);
+    ASSERT_TRUE(summary.minValue == 96.0f);
+
+    index.finish();
+    ASSERT_FALSE(index.find(5, CHANNEL_SPO2)->isOpen());
+    ASSERT_FALSE(index.stab(5, CHANNEL_SPO2, 2000, interval));
+    ASSERT_TRUE(index.stab(5, CHANNEL_SPO2, 1999, interval));
+}
+
+TEST(test_out_of_order_intervals_ignored) {
+    StableIntervalIndex index;
+    index.onTransition(makeTransition(1, CHANNEL_HEIGHT, 150.0f, 5000, true));
+    index.onTransition(makeTransition(1, CHANNEL_HEIGHT, 0.0f, 6000, false));
+    index.onTransition(makeTransition(1, CHANNEL_HEIGHT, 140.0f, 5500, true));
+    index.onTransition(makeTransition(1, CHANNEL_HEIGHT, 0.0f, 7000, false));
+    ASSERT_EQ(1u, index.getIntervalCount());
+
+    StableIntervalRun run;
+    StableInterval bad = { 200, 100, 1.0f, 1.0f };
+    ASSERT_FALSE(run.append(bad));
+}
+
+TEST(test_save_and_load) {
+    StableIntervalIndex index;
+    buildRegularRun(index, 1, 50);
+    buildRegularRun(index, 9, 10);
+    index.onTransition(makeTransition(9, CHANNEL_HEIGHT, 160.0f, 4000, true));
+    index.onStableUpdate(makeTransition(9, CHANNEL_HEIGHT, 161.0f, 4700, true));
+
+    const char* path = "test_stable_interval_index.sidx";
+    ASSERT_TRUE(index.save(path));
+
+    StableIntervalIndex loaded;
+    ASSERT_TRUE(loaded.load(path));
+    ASSERT_EQ(3u, loaded.getChannelCount());
+    ASSERT_EQ(61u, loaded.getIntervalCount());
+
+    StableIntervalSummary before;
+    StableIntervalSummary after;
+    ASSERT_TRUE(index.summarize(1, CHANNEL_BPM, 3300, 40100, before));
+    ASSERT_TRUE(loaded.summarize(1, CHANNEL_BPM, 3300, 40100, after));
+    ASSERT_EQ(before.stableMs, after.stableMs);
+    ASSERT_TRUE(before.maxValue == after.maxValue);
+
+    ASSERT_TRUE(loaded.find(9, CHANNEL_HEIGHT)->isOpen());
+    ASSERT_TRUE(loaded.summarize(9, CHANNEL_HEIGHT, 0, 10000, after));
+    ASSERT_EQ(700ul, after.stableMs);
+    ASSERT_TRUE(after.maxValue == 161.0f);
+
+    // A truncated file is rejected and leaves the index empty
+    FILE* file = std::fopen(path, "wb");
+    std::fwrite("SIDX0002", 1, 8, file);
+    std::fclose(file);
+    ASSERT_FALSE(loaded.load(path));
+    ASSERT_EQ(0u, loaded.getChannelCount());
+    std::remove(path);
+
+    ASSERT_FALSE(loaded.load("does_not_exist.sidx"));
+}
+
+TEST(test_large_run_matches_scan) {
+    StableIntervalIndex index;
+    const unsigned long count = 20000;
+    for (unsigned long k = 0; k < count; ++k) {
+        float value = static_cast<float>((k * 7919) % 1000);
+        index.onTransition(makeTransition(2, CHANNEL_HEIGHT, value, 1000 * k, true));
+        index.onTransition(makeTransition(2, CHANNEL_HEIGHT, 0.0f, 1000 * k + 300 + k % 200, false));
+    }
+
+    const StableIntervalRun* run = index.find(2, CHANNEL_HEIGHT);
+    for (unsigned long q = 0; q < 50; ++q) {
+        unsigned long from = (q * 393241) % (1000 * count);
+        unsigned long to = from + 1 + (q * 77777) % 3000000;
+
+        // Brute-force scan over the raw intervals
+        size_t intervals = 0;
+        float minValue = 1e9f;
+        unsigned long stableMs = 0;
+        for (size_t i = 0; i < run->size(); ++i) {
+            const StableInterval& interval = run->at(i);
+            if (interval.endMs <= from || interval.startMs > to) {
+                continue;
+            }
+            intervals++;
+            minValue = std::min(minValue, interval.minValue);
+            stableMs += std::min(interval.endMs, to) - std::max(interval.startMs, from);
+        }
+
+        StableIntervalSummary summary;
+        ASSERT_EQ(intervals > 0, index.summarize(2, CHANNEL_HEIGHT, from, to, summary));
+        if (intervals > 0) {
+            ASSERT_EQ(intervals, summary.intervals);
+            ASSERT_TRUE(minValue == summary.minValue);
+            ASSERT_EQ(stableMs, summary.stableMs);
+        }
+    }
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Stable Interval Index Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_replay_builds_intervals);
+    RUN_TEST(test_stabbing_queries);
+    RUN_TEST(test_range_queries_and_summaries);
+    RUN_TEST(test_partial_overlap_sees_only_readings_in_range);
+    RUN_TEST(test_open_interval_and_finish);
+    RUN_TEST(test_out_of_order_intervals_ignored);
+    RUN_TEST(test_save_and_load);
+    RUN_TEST(test_large_run_matches_scan);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,301 @@
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "stable_result_cache.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+class CountingLoader : public StableResultLoader {
+public:
+    unsigned long calls;
+
+    CountingLoader() : calls(0) {}
+
+    virtual bool load(uint32_t deviceId, uint8_t channel, StableResult& result) {
+        calls++;
+        if (deviceId >= 1000) {
+            return false;  // unknown patient
+        }
+        result.value = static_cast<float>(deviceId) + static_cast<float>(channel) / 10.0f;
+        result.timeMs = 500;
+        return true;
+    }
+};
+
+/**
+ * Loader that changes the cache while it "reads storage", as a concurrent
+ * stable transition or session start would
+ */
+class RacingLoader : public StableResultLoader {
+public:
+    enum Race { PUT, BEGIN_SESSION };
+
+    RacingLoader(Race race) : cache(NULL), race_(race) {}
+
+    StableResultCache* cache;
+
+    virtual bool load(uint32_t deviceId, uint8_t channel, StableResult& result) {
+        if (race_ == PUT) {
+            cache->put(deviceId, channel, 75.0f, 9000);
+        } else {
+            cache->beginSession(deviceId);
+        }
+        result.value = 60.0f;   // the previous session's value in storage
+        result.timeMs = 500;
+        return true;
+    }
+
+private:
+    Race race_;
+};
+
+StabilityTransition makeTransition(uint32_t deviceId, uint8_t channel, float value, unsigned long timeMs,
+                                   bool stable) {
+    StabilityTransition transition;
+    transition.deviceId = deviceId;
+    transition.channel = channel;
+    transition.value = value;
+    transition.timeMs = timeMs;
+    transition.stable = stable;
+    return transition;
+}
+
+// ============================================
+// Cache Tests
+// ============================================
+
+TEST(test_stable_transitions_populate_cache) {
+    StableResultCache cache(1024, 4, NULL);
+    StableResult result;
+    ASSERT_FALSE(cache.get(7, CHANNEL_BPM, result));
+
+    cache.onTransition(makeTransition(7, CHANNEL_BPM, 72.5f, 3000, true));
+    ASSERT_TRUE(cache.get(7, CHANNEL_BPM, result));
+    ASSERT_TRUE(result.value == 72.5f);
+    ASSERT_EQ(3000u, result.timeMs);
+
+    // Other channels of the same device are separate entries
+    ASSERT_FALSE(cache.get(7, CHANNEL_SPO2, result));
+}
+
+TEST(test_unstable_and_older_transitions_keep_result) {
+    StableResultCache cache(1024, 4, NULL);
+    cache.onTransition(makeTransition(1, CHANNEL_HEIGHT, 150.0f, 5000, true));
+    cache.onTransition(makeTransition(1, CHANNEL_HEIGHT, 120.0f, 6000, false));
+    cache.onTransition(makeTransition(1, CHANNEL_HEIGHT, 149.0f, 4000, true));
+
+    StableResult result;
+    ASSERT_TRUE(cache.get(1, CHANNEL_HEIGHT, result));
+    ASSERT_TRUE(result.value == 150.0f);
+    ASSERT_EQ(5000u, result.timeMs);
+}
+
+TEST(test_new_session_invalidates_device) {
+    StableResultCache cache(1024, 4, NULL);
+    cache.put(3, CHANNEL_HEIGHT, 160.0f, 100);
+    cache.put(3, CHANNEL_BPM, 80.0f, 100);
+    cache.put(4, CHANNEL_BPM, 90.0f, 100);
+
+    cache.beginSession(3);
+    StableResult result;
+    ASSERT_FALSE(cache.get(3, CHANNEL_HEIGHT, result));
+    ASSERT_FALSE(cache.get(3, CHANNEL_BPM, result));
+    ASSERT_TRUE(cache.get(4, CHANNEL_BPM, result));
+
+    StableResultCacheMetrics metrics = cache.getMetrics();
+    ASSERT_EQ(2u, metrics.invalidations);
+    ASSERT_EQ(1u, metrics.entries);
+}
+
+TEST(test_read_through_loads_once) {
+    CountingLoader loader;
+    StableResultCache cache(1024, 4, &loader);
+    StableResult result;
+
+    ASSERT_TRUE(cache.lookup(42, CHANNEL_SPO2, result));
+    ASSERT_TRUE(result.value == 42.2f);
+    ASSERT_TRUE(cache.lookup(42, CHANNEL_SPO2, result));
+    ASSERT_EQ(1u, loader.calls);
+
+    ASSERT_FALSE(cache.lookup(5000, CHANNEL_SPO2, result));
+    ASSERT_FALSE(cache.lookup(5000, CHANNEL_SPO2, result));
+    ASSERT_EQ(3u, loader.calls);
+
+    StableResultCacheMetrics metrics = cache.getMetrics();
+    ASSERT_EQ(1u, metrics.hits);
+    ASSERT_EQ(3u, metrics.misses);
+    ASSERT_EQ(1u, metrics.loads);
+}
+
+TEST(test_load_does_not_overwrite_newer_put) {
+    RacingLoader loader(RacingLoader::PUT);
+    StableResultCache cache(1024, 4, &loader);
+    loader.cache = &cache;
+
+    StableResult result;
+    ASSERT_TRUE(cache.lookup(8, CHANNEL_BPM, result));
+    ASSERT_TRUE(result.value == 75.0f);
+    ASSERT_TRUE(cache.get(8, CHANNEL_BPM, result));
+    ASSERT_TRUE(result.value == 75.0f);
+    ASSERT_EQ(9000u, result.timeMs);
+}
+
+TEST(test_load_racing_new_session_is_not_cached) {
+    RacingLoader loader(RacingLoader::BEGIN_SESSION);
+    StableResultCache cache(1024, 4, &loader);
+    loader.cache = &cache;
+
+    // The lookup overlapped the session start, so it may answer from before it
+    StableResult result;
+    ASSERT_TRUE(cache.lookup(9, CHANNEL_SPO2, result));
+    ASSERT_TRUE(result.value == 60.0f);
+    ASSERT_FALSE(cache.get(9, CHANNEL_SPO2, result));
+}
+
+TEST(test_memory_is_bounded) {
+    StableResultCache cache(256, 2, NULL);
+    size_t capacity = cache.getCapacity();
+    ASSERT_TRUE(capacity >= 256);
+    ASSERT_TRUE(capacity < 512);
+
+    for (uint32_t device = 0; device < 10000; ++device) {
+        cache.put(device, CHANNEL_HEIGHT, 150.0f, device);
+    }
+    StableResultCacheMetrics metrics = cache.getMetrics();
+    ASSERT_TRUE(metrics.entries <= capacity);
+    ASSERT_EQ(10000u, metrics.inserts);
+    ASSERT_EQ(10000u - metrics.entries, metrics.evictions);
+}
+
+TEST(test_clock_keeps_referenced_entries) {
+    // A single 8-way set: every key competes for the same slots
+    StableResultCache cache(STABLE_CACHE_WAYS, 1, NULL);
+    ASSERT_EQ(static_cast<size_t>(STABLE_CACHE_WAYS), cache.getCapacity());
+
+    StableResult result;
+    cache.put(0, CHANNEL_BPM, 70.0f, 1);
+    for (uint32_t device = 1; device < 200; ++device) {
+        ASSERT_TRUE(cache.get(0, CHANNEL_BPM, result));
+        cache.put(device, CHANNEL_BPM, 60.0f, 1);
+    }
+    ASSERT_TRUE(cache.get(0, CHANNEL_BPM, result));
+    ASSERT_TRUE(result.value == 70.0f);
+}
+
+TEST(test_concurrent_readers_see_consistent_entries) {
+    StableResultCache cache(64, 1, NULL);
+    std::atomic<bool> done(false);
+    std::atomic<unsigned long> torn(0);
+
+    // Value is always timeMs / 10, so a torn read shows up as a mismatch
+    std::thread writer([&cache, &done]() {
+        for (unsigned long t = 10; t <= 200000; t += 10) {
+            cache.put(1, CHANNEL_HEIGHT, static_cast<float>(t / 10), t);
+            cache.put(static_cast<uint32_t>(2 + t % 500), CHANNEL_HEIGHT, 0.0f, 0);
+        }
+        done.store(true);
+    });
+    std::thread reader([&cache, &done, &torn]() {
+        StableResult result;
+        while (!done.load()) {
+            if (cache.get(1, CHANNEL_HEIGHT, result) &&
+                result.value != static_cast<float>(result.timeMs / 10)) {
+                torn++;
+            }
+        }
+    });
+    writer.join();
+    reader.join();
+    ASSERT_EQ(0u, torn.load());
+}
+
+TEST(test_metrics_export) {
+    CountingLoader loader;
+    StableResultCache cache(128, 2, &loader);
+    StableResult result;
+    for (int i = 0; i < 100; ++i) {
+        cache.lookup(static_cast<uint32_t>(i % 10), CHANNEL_BPM, result);
+    }
+
+    StableResultCacheMetrics metrics = cache.getMetrics();
+    ASSERT_EQ(90u, metrics.hits);
+    ASSERT_TRUE(metrics.getHitRate() > 0.89 && metrics.getHitRate() < 0.91);
+    ASSERT_TRUE(metrics.latencySamples >= 100 / STABLE_CACHE_LATENCY_SAMPLE_EVERY);
+
+    std::string text;
+    cache.formatMetrics("apptech_stable_cache", text);
+    ASSERT_TRUE(text.find("apptech_stable_cache_hits_total 90\n") != std::string::npos);
+    ASSERT_TRUE(text.find("apptech_stable_cache_misses_total 10\n") != std::string::npos);
+    ASSERT_TRUE(text.find("apptech_stable_cache_hit_ratio 0.900000\n") != std::string::npos);
+    ASSERT_TRUE(text.find("apptech_stable_cache_lookup_seconds_bucket{le=\"+Inf\"}") != std::string::npos);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Stable Result Cache Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_stable_transitions_populate_cache);
+    RUN_TEST(test_unstable_and_older_transitions_keep_result);
+    RUN_TEST(test_new_session_invalidates_device);
+    RUN_TEST(test_read_through_loads_once);
+    RUN_TEST(test_load_does_not_overwrite_newer_put);
+    RUN_TEST(test_load_racing_new_session_is_not_cached);
+    RUN_TEST(test_memory_is_bounded);
+    RUN_TEST(test_clock_keeps_referenced_entries);
+    RUN_TEST(test_concurrent_readers_see_consistent_entries);
+    RUN_TEST(test_metrics_export);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,341 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "station_health.h"
+#include "trace_replayer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+class EventRecorder : public DebounceEventSink {
+public:
+    virtual void onDebounceEvent(const DebounceEvent& event) { events.push_back(event); }
+
+    std::vector<DebounceEvent> events;
+};
+
+void feed(StationHealthModel& model, uint32_t stationId, uint8_t channel, uint8_t type, unsigned long timeMs,
+          float value = 150.0f) {
+    DebounceEvent event;
+    event.deviceId = stationId;
+    event.timeMs = timeMs;
+    event.value = value;
+    event.channel = channel;
+    event.type = type;
+    model.onDebounceEvent(event);
+}
+
+/**
+ * One measurement session: first reading, accepted samples every 100 ms
+ * until stable after timeToStableMs, then a patient-left dropout
+ * @return time after the session
+ */
+unsigned long session(StationHealthModel& model, uint32_t stationId, unsigned long startMs,
+                      unsigned long timeToStableMs) {
+    feed(model, stationId, CHANNEL_HEIGHT, DEBOUNCE_EVENT_FIRST_READING, startMs);
+    unsigned long t = startMs + 100;
+    for (; t < startMs + timeToStableMs; t += 100) {
+        feed(model, stationId, CHANNEL_HEIGHT, DEBOUNCE_EVENT_ACCEPTED, t);
+    }
+    feed(model, stationId, CHANNEL_HEIGHT, DEBOUNCE_EVENT_STABLE, startMs + timeToStableMs);
+    for (int i = 0; i < 20; ++i) {
+        feed(model, stationId, CHANNEL_HEIGHT, DEBOUNCE_EVENT_ACCEPTED, startMs + timeToStableMs + 100 * (i + 1));
+    }
+    feed(model, stationId, CHANNEL_HEIGHT, DEBOUNCE_EVENT_INVALID_RESET, startMs + timeToStableMs + 2200);
+    return startMs + timeToStableMs + 10000;
+}
+
+// ============================================
+// Event classification
+// ============================================
+
+TEST(test_replayer_classifies_updates) {
+    EventRecorder recorder;
+    TraceReplayer replayer(NULL);
+    replayer.setEventSink(&recorder);
+
+    TraceSample sample;
+    sample.deviceId = 7;
+    sample.channel = CHANNEL_BPM;
+    const float values[] = { 72.0f, 73.0f, 73.0f, 90.0f, 30.0f, 80.0f };
+    const unsigned long times[] = { 0, 10, 200, 400, 600, 800 };
+    for (int i = 0; i < 6; ++i) {
+        sample.value = values[i];
+        sample.timeMs = times[i];
+        replayer.onSample(sample);
+    }
+    for (unsigned long t = 1000; t <= 4000; t += 200) {
+        sample.value = 80.0f;
+        sample.timeMs = t;
+        replayer.onSample(sample);
+    }
+
+    ASSERT_TRUE(recorder.events.size() == 6 + 16);
+    ASSERT_EQ(DEBOUNCE_EVENT_FIRST_READING, recorder.events[0].type);
+    ASSERT_EQ(DEBOUNCE_EVENT_SKIPPED, recorder.events[1].type);
+    ASSERT_EQ(DEBOUNCE_EVENT_ACCEPTED, recorder.events[2].type);
+    ASSERT_EQ(DEBOUNCE_EVENT_TOLERANCE_RESET, recorder.events[3].type);
+    ASSERT_EQ(DEBOUNCE_EVENT_INVALID_RESET, recorder.events[4].type);
+    ASSERT_EQ(DEBOUNCE_EVENT_FIRST_READING, recorder.events[5].type);
+    int stable = 0;
+    for (size_t i = 6; i < recorder.events.size(); ++i) {
+        stable += recorder.events[i].type == DEBOUNCE_EVENT_STABLE ? 1 : 0;
+    }
+    ASSERT_EQ(1, stable);
+    ASSERT_TRUE(replayer.getBpmDebouncer().isStable());
+    ASSERT_EQ(7u, recorder.events[0].deviceId);
+}
+
+// ============================================
+// Health model
+// ============================================
+
+TEST(test_healthy_station_does_not_alert) {
+    StationHealthModel model((StationHealthConfig()));
+    unsigned long t = 0;
+    for (int i = 0; i < 20; ++i) {
+        t = session(model, 1, t, 3000);
+    }
+    StationHealthSnapshot health;
+    ASSERT_TRUE(model.getHealth(1, health));
+    ASSERT_EQ(STATION_HEALTH_OK, health.reason);
+    ASSERT_TRUE(health.severity < 1.0f);
+    ASSERT_TRUE(health.timeToStableMs == 3000.0f);
+    ASSERT_TRUE(health.timeToStableDrift == 0.0f);
+    ASSERT_EQ(0u, model.getAlertCount());
+    ASSERT_FALSE(model.getHealth(2, health));
+}
+
+TEST(test_dropouts_raise_alert) {
+    StationHealthModel model((StationHealthConfig()));
+    for (unsigned long t = 0; t < 60000; t += 100) {
+        feed(model, 5, CHANNEL_SPO2, (t / 100) % 4 == 0 ? DEBOUNCE_EVENT_INVALID_RESET : DEBOUNCE_EVENT_ACCEPTED, t);
+    }
+    StationHealthSnapshot health;
+    ASSERT_TRUE(model.getHealth(5, health));
+    ASSERT_EQ(STATION_HEALTH_DROPOUTS, health.reason);
+    ASSERT_EQ(CHANNEL_SPO2, health.channel);
+    ASSERT_TRUE(health.dropoutRatio > 0.24f && health.dropoutRatio < 0.26f);
+    ASSERT_TRUE(health.severity > 2.0f);
+    ASSERT_EQ(1u, model.getAlertCount());
+    ASSERT_TRUE(std::string(stationHealthReasonName(health.reason)) == "dropouts");
+}
+
+TEST(test_reset_rate_raises_alert_and_decays) {
+    StationHealthConfig config;
+    config.halfLifeMs = 10000;
+    StationHealthModel model(config);
+    unsigned long t = 0;
+    for (; t < 30000; t += 100) {
+        feed(model, 9, CHANNEL_HEIGHT, (t / 100) % 2 == 0 ? DEBOUNCE_EVENT_TOLERANCE_RESET : DEBOUNCE_EVENT_ACCEPTED, t);
+    }
+    StationHealthSnapshot health;
+    ASSERT_TRUE(model.getHealth(9, health));
+    ASSERT_EQ(STATION_HEALTH_RESET_RATE, health.reason);
+    ASSERT_TRUE(health.resetRate > 0.45f && health.resetRate < 0.55f);
+    ASSERT_EQ(1u, model.getAlertCount());
+
+    // The transducer is replaced: the old resets decay away
+    for (; t < 120000; t += 100) {
+        feed(model, 9, CHANNEL_HEIGHT, DEBOUNCE_EVENT_ACCEPTED, t);
+    }
+    ASSERT_TRUE(model.getHealth(9, health));
+    ASSERT_EQ(STATION_HEALTH_OK, health.reason);
+    ASSERT_TRUE(health.resetRate < 0.01f);
+    ASSERT_EQ(0u, model.getAlertCount());
+}
+
+TEST(test_time_to_stable_drift_raises_alert) {
+    StationHealthModel model((StationHealthConfig()));
+    unsigned long t = 0;
+    for (int i = 0; i < 20; ++i) {
+        t = session(model, 3, t, 3000);
+    }
+    for (int i = 0; i < 8; ++i) {
+        t = session(model, 3, t, 9000);   // the window is getting dirty
+    }
+    StationHealthSnapshot health;
+    ASSERT_TRUE(model.getHealth(3, health));
+    ASSERT_EQ(STATION_HEALTH_TIME_TO_STABLE, health.reason);
+    ASSERT_TRUE(health.timeToStableMs > 7000.0f);
+    ASSERT_TRUE(health.timeToStableDrift > 0.5f);
+    ASSERT_EQ(1u, model.getAlertCount());
+}
+
+TEST(test_warmup_suppresses_early_alerts) {
+    StationHealthModel model((StationHealthConfig()));
+    for (unsigned long t = 0; t < 1000; t += 100) {
+        feed(model, 4, CHANNEL_BPM, DEBOUNCE_EVENT_INVALID_RESET, t);
+    }
+    StationHealthSnapshot health;
+    ASSERT_TRUE(model.getHealth(4, health));
+    ASSERT_TRUE(health.dropoutRatio == 0.0f);
+    ASSERT_EQ(0u, model.getAlertCount());
+
+    // Skipped samples are not counted
+    for (unsigned long t = 1000; t < 5000; t += 10) {
+        feed(model, 4, CHANNEL_BPM, DEBOUNCE_EVENT_SKIPPED, t);
+    }
+    ASSERT_EQ(0u, model.getAlertCount());
+    ASSERT_TRUE(model.getHealth(4, health));
+    ASSERT_EQ(4990ul, health.lastEventMs);
+}
+
+TEST(test_height_out_of_range_counts_as_dropout) {
+    StationHealthModel model((StationHealthConfig()));
+
+    // Every fourth ping is lost (0 cm) or beyond the range; the height
+    // debouncer takes them as readings and reports tolerance resets
+    unsigned long t = 0;
+    for (; t < 60000; t += 100) {
+        unsigned long n = t / 100;
+        if (n % 4 == 0) {
+            feed(model, 6, CHANNEL_HEIGHT, DEBOUNCE_EVENT_TOLERANCE_RESET, t, n % 8 == 0 ? 0.0f : 450.0f);
+        } else {
+            feed(model, 6, CHANNEL_HEIGHT, n % 4 == 1 ? DEBOUNCE_EVENT_TOLERANCE_RESET : DEBOUNCE_EVENT_ACCEPTED, t);
+        }
+    }
+    StationHealthSnapshot health;
+    ASSERT_TRUE(model.getHealth(6, health));
+    ASSERT_EQ(STATION_HEALTH_DROPOUTS, health.reason);
+    ASSERT_TRUE(health.dropoutRatio > 0.24f && health.dropoutRatio < 0.26f);
+    ASSERT_TRUE(health.resetRate == 0.0f);   // coming back from a dropout is not a reset
+
+    // A valid reading outside the model's range is a dropout too
+    StationHealthConfig config;
+    config.maxHeightCm = 100.0f;
+    StationHealthModel shortRange(config);
+    for (unsigned long u = 0; u < 5000; u += 100) {
+        feed(shortRange, 1, CHANNEL_HEIGHT, DEBOUNCE_EVENT_ACCEPTED, u, 150.0f);
+    }
+    ASSERT_TRUE(shortRange.getHealth(1, health));
+    ASSERT_TRUE(health.dropoutRatio == 1.0f);
+}
+
+TEST(test_silent_channels_expire) {
+    StationHealthConfig config;
+    config.staleMs = 60000;
+    StationHealthModel model(config);
+    for (unsigned long t = 0; t < 10000; t += 100) {
+        feed(model, 2, CHANNEL_SPO2, (t / 100) % 2 == 0 ? DEBOUNCE_EVENT_INVALID_RESET : DEBOUNCE_EVENT_ACCEPTED, t);
+        feed(model, 3, CHANNEL_SPO2, (t / 100) % 2 == 0 ? DEBOUNCE_EVENT_INVALID_RESET : DEBOUNCE_EVENT_ACCEPTED, t);
+    }
+    ASSERT_EQ(2u, model.getAlertCount());
+
+    // Station 2's oximeter is unplugged while its height channel keeps reporting
+    for (unsigned long t = 10000; t < 80000; t += 100) {
+        feed(model, 2, CHANNEL_HEIGHT, DEBOUNCE_EVENT_ACCEPTED, t);
+    }
+    StationHealthSnapshot health;
+    ASSERT_TRUE(model.getHealth(2, health));
+    ASSERT_EQ(STATION_HEALTH_OK, health.reason);
+    ASSERT_EQ(1u, model.getAlertCount());
+
+    // Station 3 went silent altogether: only expire() can drop it
+    ASSERT_EQ(0u, model.expire(60000));
+    ASSERT_EQ(1u, model.expire(80000));
+    ASSERT_EQ(0u, model.getAlertCount());
+    ASSERT_TRUE(model.getHealth(3, health));
+    ASSERT_TRUE(health.dropoutRatio == 0.0f);
+}
+
+TEST(test_ranked_alerts_across_fleet) {
+    const uint32_t stations = 100000;
+    StationHealthModel model(StationHealthConfig(), stations);
+
+    // Every 1000th station drops a growing share of its readings
+    for (unsigned long t = 0; t < 3000; t += 100) {
+        for (uint32_t id = 0; id < stations; ++id) {
+            uint8_t type = DEBOUNCE_EVENT_ACCEPTED;
+            if (id % 1000 == 0) {
+                unsigned long every = 2 + (id / 1000) % 5;   // 1/2 ... 1/6 of readings
+                type = (t / 100) % every == 0 ? DEBOUNCE_EVENT_INVALID_RESET : DEBOUNCE_EVENT_ACCEPTED;
+            }
+            feed(model, id, CHANNEL_HEIGHT, type, t);
+        }
+    }
+    ASSERT_EQ(static_cast<size_t>(stations), model.getStationCount());
+    ASSERT_EQ(100u, model.getAlertCount());
+
+    std::vector<StationHealthSnapshot> alerts;
+    ASSERT_EQ(10u, model.getAlerts(alerts, 10));
+    for (size_t i = 0; i < alerts.size(); ++i) {
+        ASSERT_EQ(0u, alerts[i].stationId % 1000);
+        ASSERT_EQ(0u, (alerts[i].stationId / 1000) % 5);   // the 1-in-2 droppers rank first
+        if (i > 0) {
+            ASSERT_TRUE(alerts[i - 1].severity >= alerts[i].severity);
+        }
+    }
+    ASSERT_EQ(100u, model.getAlerts(alerts, 1000));
+    for (size_t i = 1; i < alerts.size(); ++i) {
+        ASSERT_TRUE(alerts[i - 1].severity >= alerts[i].severity);
+    }
+    ASSERT_EQ(0u, model.getAlerts(alerts, 0));
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Station Health Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_replayer_classifies_updates);
+    RUN_TEST(test_healthy_station_does_not_alert);
+    RUN_TEST(test_dropouts_raise_alert);
+    RUN_TEST(test_reset_rate_raises_alert_and_decays);
+    RUN_TEST(test_time_to_stable_drift_raises_alert);
+    RUN_TEST(test_warmup_suppresses_early_alerts);
+    RUN_TEST(test_height_out_of_range_counts_as_dropout);
+    RUN_TEST(test_silent_channels_expire);
+    RUN_TEST(test_ranked_alerts_across_fleet);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,678 @@
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "station_partition.h"
+#include "station_replication.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+
+// ============================================
+// Helpers
+// ============================================
+
+TraceReplayer makePrototype() {
+    return TraceReplayer(HeightDebouncer(2, 1000, 100), ReadingDebouncer<float>(3.0f, 1000, 100, 30.0f, 220.0f),
+                         ReadingDebouncer<int>(1, 1000, 100, 70, 100), NULL);
+}
+
+TraceSample makeSample(uint32_t stationId, uint8_t channel, unsigned long timeMs, float value) {
+    TraceSample sample;
+    sample.deviceId = stationId;
+    sample.timeMs = timeMs;
+    sample.value = value;
+    sample.channel = channel;
+    return sample;
+}
+
+// Readings every 100 ms on all three channels; height jumps at resetAtMs
+void stationSamples(uint32_t stationId, unsigned long fromMs, unsigned long toMs, unsigned long resetAtMs,
+                    std::vector<TraceSample>& out) {
+    for (unsigned long t = fromMs; t <= toMs; t += 100) {
+        float height = static_cast<float>(150 + stationId % 20 + (t >= resetAtMs ? 10 : 0));
+        out.push_back(makeSample(stationId, CHANNEL_HEIGHT, t, height));
+        out.push_back(makeSample(stationId, CHANNEL_BPM, t, 70.0f + stationId % 10));
+        out.push_back(makeSample(stationId, CHANNEL_SPO2, t, 97.0f));
+    }
+}
+
+template<typename Checkpoint>
+bool sameTimers(const Checkpoint& a, const Checkpoint& b) {
+    return a.lastReading == b.lastReading && a.stableReading == b.stableReading &&
+           a.stabilityStartTime == b.stabilityStartTime && a.lastSampleTime == b.lastSampleTime &&
+           a.isStable == b.isStable && a.hasReading == b.hasReading;
+}
+
+bool sameState(const StationCheckpoint& checkpoint, const TraceReplayer& reference) {
+    return sameTimers(checkpoint.height, reference.getHeightDebouncer().getCheckpoint()) &&
+           checkpoint.height.toleranceCm == reference.getHeightDebouncer().getToleranceCm() &&
+           sameTimers(checkpoint.bpm, reference.getBpmDebouncer().getCheckpoint()) &&
+           checkpoint.bpm.lastReadingValid == reference.getBpmDebouncer().isLastReadingValid() &&
+           sameTimers(checkpoint.spo2, reference.getSpo2Debouncer().getCheckpoint()) &&
+           checkpoint.spo2.lastReadingValid == reference.getSpo2Debouncer().isLastReadingValid();
+}
+
+bool sameCheckpoint(const StationCheckpoint& a, const StationCheckpoint& b) {
+    return a.stationId == b.stationId && sameTimers(a.height, b.height) &&
+           a.height.toleranceCm == b.height.toleranceCm && sameTimers(a.bpm, b.bpm) &&
+           a.bpm.tolerance == b.bpm.tolerance && a.bpm.lastReadingValid == b.bpm.lastReadingValid &&
+           sameTimers(a.spo2, b.spo2) && a.spo2.tolerance == b.spo2.tolerance &&
+           a.spo2.lastReadingValid == b.spo2.lastReadingValid;
+}
+
+bool replicaMatches(const StationPartition& replica, const StationPartition& primary, uint32_t stations) {
+    if (replica.getStationCount() != primary.getStationCount() || replica.getEpoch() != primary.getEpoch()) {
+        return false;
+    }
+    for (uint32_t station = 0; station < stations; ++station) {
+        StationCheckpoint expected;
+        StationCheckpoint actual;
+        bool held = primary.getCheckpoint(station, expected);
+        if (held != replica.getCheckpoint(station, actual) || (held && !sameCheckpoint(expected, actual))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<uint32_t> nodes(uint32_t a, uint32_t b, uint32_t c, uint32_t d = 0) {
+    std::vector<uint32_t> ids;
+    ids.push_back(a);
+    ids.push_back(b);
+    ids.push_back(c);
+    if (d != 0) {
+        ids.push_back(d);
+    }
+    return ids;
+}
+
+bool serveNode(const std::string& directory, uint32_t nodeId) {
+    PartitionNode node(directory, nodeId, makePrototype());
+    return node.listen() && node.run();
+}
+
+bool serveReplicatedNode(const std::string& directory, uint32_t nodeId) {
+    PartitionNode node(directory, nodeId, makePrototype());
+    node.setStandby(ReplicationStandby::socketPath(directory, nodeId));
+    return node.listen() && node.run();
+}
+
+/**
+ * Mirror the node until it fails, then serve in its place
+ */
+bool serveStandby(const std::string& directory, uint32_t nodeId) {
+    PartitionNode node(directory, nodeId, makePrototype());
+    ReplicationStandby standby(ReplicationStandby::socketPath(directory, nodeId));
+    return standby.listen() && standby.runUntilFailover(node.getPartition()) && node.listen() && node.run();
+}
+
+const uint32_t kCrossedStations = 40000;
+
+/**
+ * Serve with every other station already held, as if each node had owned
+ * half of them alone; joining {1, 2} then hands off both ways at once
+ */
+bool serveCrossedNode(const std::string& directory, uint32_t nodeId) {
+    PartitionNode node(directory, nodeId, makePrototype());
+    StationPartition& partition = node.getPartition();
+    std::vector<StationCheckpoint> none;
+    partition.setMembers(0, std::vector<uint32_t>(), std::vector<uint32_t>(1, nodeId), none);
+    for (uint32_t station = nodeId - 1; station < kCrossedStations; station += 2) {
+        TraceReplayer replayer(makePrototype());
+        std::vector<TraceSample> samples;
+        stationSamples(station, 0, 600, 99999, samples);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            replayer.onSample(samples[i]);
+        }
+        StationCheckpoint checkpoint;
+        checkpoint.stationId = station;
+        checkpoint.height = replayer.getHeightDebouncer().getCheckpoint();
+        checkpoint.bpm = replayer.getBpmDebouncer().getCheckpoint();
+        checkpoint.spo2 = replayer.getSpo2Debouncer().getCheckpoint();
+        if (!partition.adopt(checkpoint, 0)) {
+            return false;
+        }
+    }
+    return node.listen() && node.run();
+}
+
+/**
+ * A node process serving until shut down
+ */
+pid_t startNode(const std::string& directory, uint32_t nodeId, bool (*serve)(const std::string&, uint32_t) = serveNode) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        prctl(PR_SET_PDEATHSIG, SIGTERM);   // do not outlive a failed test
+        _exit(serve(directory, nodeId) ? 0 : 1);
+    }
+    return pid;
+}
+
+bool stopNode(PartitionClient& client, uint32_t nodeId, pid_t pid) {
+    int status = 0;
+    return client.shutdown(nodeId) && waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+           WEXITSTATUS(status) == 0;
+}
+
+/**
+ * Send samples to the cluster and to the single-process reference
+ */
+void feed(PartitionClient& client, std::vector<TraceReplayer>& reference, unsigned long fromMs, unsigned long toMs,
+          unsigned long resetAtMs) {
+    for (uint32_t station = 0; station < reference.size(); ++station) {
+        std::vector<TraceSample> samples;
+        stationSamples(station, fromMs, toMs, resetAtMs, samples);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            if (!client.send(samples[i])) {
+                throw std::runtime_error("send failed");
+            }
+            reference[station].onSample(samples[i]);
+        }
+    }
+}
+
+bool clusterMatches(PartitionClient& client, const std::vector<TraceReplayer>& reference) {
+    for (uint32_t station = 0; station < reference.size(); ++station) {
+        StationCheckpoint checkpoint;
+        bool found = false;
+        if (!client.query(station, checkpoint, &found) || !found || !sameState(checkpoint, reference[station])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================
+// Tests
+// ============================================
+
+TEST(test_ring_spreads_stations_evenly) {
+    ConsistentHashRing ring;
+    ring.setMembers(nodes(1, 2, 3, 4));
+    size_t counts[5] = { 0, 0, 0, 0, 0 };
+    for (uint32_t station = 0; station < 20000; ++station) {
+        uint32_t owner = ring.ownerOf(station);
+        ASSERT_TRUE(owner >= 1 && owner <= 4);
+        counts[owner]++;
+    }
+    for (int node = 1; node <= 4; ++node) {
+        ASSERT_TRUE(counts[node] > 20000 * 0.18 && counts[node] < 20000 * 0.32);
+    }
+
+    ConsistentHashRing empty;
+    ASSERT_EQ(PARTITION_NO_NODE, empty.ownerOf(7));
+}
+
+TEST(test_ring_moves_only_the_joining_and_leaving_nodes_stations) {
+    ConsistentHashRing before;
+    before.setMembers(nodes(1, 2, 3, 4));
+
+    // Member order does not matter, so every process agrees
+    ConsistentHashRing reordered;
+    reordered.setMembers(nodes(4, 2, 3, 1));
+    std::vector<uint32_t> withFive = nodes(5, 3, 1, 4);
+    withFive.push_back(2);
+    ConsistentHashRing joined;
+    joined.setMembers(withFive);
+
+    ConsistentHashRing left;
+    left.setMembers(nodes(4, 3, 1));
+
+    size_t movedToFive = 0;
+    for (uint32_t station = 0; station < 20000; ++station) {
+        uint32_t owner = before.ownerOf(station);
+        ASSERT_EQ(owner, reordered.ownerOf(station));
+        if (joined.ownerOf(station) != owner) {
+            ASSERT_EQ(5u, joined.ownerOf(station));
+            movedToFive++;
+        }
+        if (owner != 2) {
+            ASSERT_EQ(owner, left.ownerOf(station));
+        } else {
+            ASSERT_TRUE(left.ownerOf(station) != 2);
+        }
+    }
+    ASSERT_TRUE(movedToFive > 20000 * 0.12 && movedToFive < 20000 * 0.28);
+}
+
+TEST(test_handoff_keeps_stability_progress) {
+    TraceReplayer prototype = makePrototype();
+    StationPartition first(1, prototype);
+    StationPartition second(2, prototype);
+    std::vector<StationCheckpoint> handoff;
+    std::vector<uint32_t> one(1, 1);
+    std::vector<uint32_t> both = one;
+    both.push_back(2);
+    first.setMembers(1, std::vector<uint32_t>(), one, handoff);
+    ASSERT_TRUE(first.isSettled());
+
+    ConsistentHashRing ring;
+    ring.setMembers(both);
+    uint32_t station = 0;
+    while (ring.ownerOf(station) != 2) {
+        station++;
+    }
+
+    std::vector<TraceSample> early;
+    std::vector<TraceSample> late;
+    stationSamples(station, 0, 600, 99999, early);
+    stationSamples(station, 700, 1000, 99999, late);
+    TraceReplayer reference = makePrototype();
+    uint32_t owner = 0;
+    for (size_t i = 0; i < early.size(); ++i) {
+        ASSERT_EQ(static_cast<int>(PARTITION_APPLIED), first.route(early[i], &owner));
+        reference.onSample(early[i]);
+    }
+
+    first.setMembers(2, one, both, handoff);
+    second.setMembers(2, one, both, handoff);
+    ASSERT_EQ(1u, handoff.size());
+    ASSERT_EQ(0u, first.getStationCount());
+    ASSERT_FALSE(second.isSettled());
+
+    // Samples that overtake the checkpoint wait for it
+    ASSERT_EQ(static_cast<int>(PARTITION_FORWARD), first.route(late[0], &owner));
+    ASSERT_EQ(2u, owner);
+    for (size_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(static_cast<int>(PARTITION_QUEUED), second.route(late[i], &owner));
+    }
+    ASSERT_TRUE(second.adopt(handoff[0], 2));
+    ASSERT_EQ(0u, second.getQueuedCount());
+    for (size_t i = 3; i < late.size(); ++i) {
+        ASSERT_EQ(static_cast<int>(PARTITION_APPLIED), second.route(late[i], &owner));
+    }
+    for (size_t i = 0; i < late.size(); ++i) {
+        reference.onSample(late[i]);
+    }
+    second.sourceDone(1, 2);
+    ASSERT_TRUE(second.isSettled());
+
+    StationCheckpoint checkpoint;
+    ASSERT_TRUE(second.getCheckpoint(station, checkpoint));
+    ASSERT_TRUE(checkpoint.height.isStable);    // 0..1000 ms without a restart
+    ASSERT_TRUE(sameState(checkpoint, reference));
+
+    // A checkpoint for a station owned elsewhere is refused
+    ASSERT_FALSE(first.adopt(handoff[0], 2));
+}
+
+TEST(test_queued_samples_start_fresh_once_settled) {
+    StationPartition partition(3, makePrototype());
+    std::vector<StationCheckpoint> handoff;
+    std::vector<uint32_t> sources(1, 1);
+    std::vector<uint32_t> members(1, 3);
+    uint32_t owner = 0;
+
+    // Done reported before the membership arrives
+    partition.sourceDone(1, 4);
+    TraceSample sample = makeSample(42, CHANNEL_HEIGHT, 0, 150.0f);
+    ASSERT_EQ(static_cast<int>(PARTITION_QUEUED), partition.route(sample, &owner));
+    partition.setMembers(4, sources, members, handoff);
+    ASSERT_TRUE(partition.isSettled());
+
+    std::vector<TraceSample> forward;
+    ASSERT_EQ(1u, partition.drainQueued(forward));
+    ASSERT_TRUE(forward.empty());
+    StationCheckpoint checkpoint;
+    ASSERT_TRUE(partition.getCheckpoint(42, checkpoint));
+    ASSERT_TRUE(checkpoint.height.hasReading);
+    ASSERT_EQ(1ULL, static_cast<unsigned long long>(partition.getSamplesApplied()));
+}
+
+TEST(test_processes_rebalance_over_unix_sockets) {
+    char pattern[] = "/tmp/partition-XXXXXX";
+    ASSERT_TRUE(mkdtemp(pattern) != NULL);
+    std::string directory(pattern);
+    const uint32_t kStations = 120;
+
+    pid_t pids[5] = { 0, 0, 0, 0, 0 };
+    for (uint32_t node = 1; node <= 3; ++node) {
+        pids[node] = startNode(directory, node);
+        ASSERT_TRUE(pids[node] > 0);
+    }
+    PartitionClient client(directory);
+    std::vector<TraceReplayer> reference(kStations, makePrototype());
+    ASSERT_TRUE(client.setMembers(nodes(1, 2, 3)));
+    feed(client, reference, 0, 600, 99999);
+
+    // Join mid-stabilization; samples keep flowing without waiting
+    pids[4] = startNode(directory, 4);
+    ASSERT_TRUE(pids[4] > 0);
+    ASSERT_TRUE(client.setMembers(nodes(1, 2, 3, 4)));
+    feed(client, reference, 700, 1000, 99999);
+    ASSERT_TRUE(clusterMatches(client, reference));
+    for (uint32_t station = 0; station < kStations; ++station) {
+        ASSERT_TRUE(reference[station].getHeightDebouncer().isStable());
+    }
+    ASSERT_TRUE(client.waitSettled(PARTITION_CONNECT_TIMEOUT_MS));
+    PartitionNodeStatus joined;
+    ASSERT_TRUE(client.getStatus(4, joined));
+    ASSERT_TRUE(joined.stations > 0);
+    ASSERT_EQ(joined.stations, static_cast<uint32_t>(joined.checkpointsAdopted));
+
+    // Leave: node 2's stations move and some of them restart their timer
+    ASSERT_TRUE(client.setMembers(nodes(1, 3, 4)));
+    feed(client, reference, 1100, 1500, 1200);
+    ASSERT_TRUE(client.waitSettled(PARTITION_CONNECT_TIMEOUT_MS));
+    ASSERT_TRUE(clusterMatches(client, reference));
+    PartitionNodeStatus leaving;
+    ASSERT_TRUE(client.getStatus(2, leaving));
+    ASSERT_EQ(0u, leaving.stations);
+    ASSERT_TRUE(leaving.checkpointsHandedOff > 0);
+
+    uint32_t total = 0;
+    for (uint32_t node = 1; node <= 4; ++node) {
+        PartitionNodeStatus status;
+        ASSERT_TRUE(client.getStatus(node, status));
+        total += status.stations;
+    }
+    ASSERT_EQ(kStations, total);
+
+    for (uint32_t node = 1; node <= 4; ++node) {
+        ASSERT_TRUE(stopNode(client, node, pids[node]));
+    }
+    ASSERT_EQ(0, rmdir(directory.c_str()));
+}
+
+TEST(test_two_way_handoff_larger_than_the_socket_buffer) {
+    char pattern[] = "/tmp/partition-XXXXXX";
+    ASSERT_TRUE(mkdtemp(pattern) != NULL);
+    std::string directory(pattern);
+
+    pid_t pids[3] = { 0, 0, 0 };
+    for (uint32_t node = 1; node <= 2; ++node) {
+        pids[node] = startNode(directory, node, serveCrossedNode);
+        ASSERT_TRUE(pids[node] > 0);
+    }
+    std::vector<TraceReplayer> reference(kCrossedStations, makePrototype());
+    for (uint32_t station = 0; station < kCrossedStations; ++station) {
+        std::vector<TraceSample> samples;
+        stationSamples(station, 0, 600, 99999, samples);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            reference[station].onSample(samples[i]);
+        }
+    }
+
+    // Both nodes send each other about a quarter of the stations at once
+    PartitionClient client(directory);
+    std::vector<uint32_t> members;
+    members.push_back(1);
+    members.push_back(2);
+    ASSERT_TRUE(client.setMembers(members));
+
+    // Every station is held exactly once when neither side has checkpoints in flight
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(PARTITION_CONNECT_TIMEOUT_MS);
+    PartitionNodeStatus status[3];
+    for (;;) {
+        ASSERT_TRUE(client.getStatus(1, status[1]) && client.getStatus(2, status[2]));
+        if (status[1].stations + status[2].stations == kCrossedStations) {
+            break;
+        }
+        ASSERT_TRUE(std::chrono::steady_clock::now() < deadline);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Each direction outgrew what one socket buffer holds
+    int pair[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, pair));
+    int sendBuffer = 0;
+    socklen_t size = sizeof(sendBuffer);
+    ASSERT_EQ(0, getsockopt(pair[0], SOL_SOCKET, SO_SNDBUF, &sendBuffer, &size));
+    ::close(pair[0]);
+    ::close(pair[1]);
+    for (uint32_t node = 1; node <= 2; ++node) {
+        ASSERT_TRUE(status[node].checkpointsHandedOff * sizeof(StationCheckpoint) >
+                    2 * static_cast<uint64_t>(sendBuffer));
+    }
+    ASSERT_TRUE(clusterMatches(client, reference));
+
+    for (uint32_t node = 1; node <= 2; ++node) {
+        ASSERT_TRUE(stopNode(client, node, pids[node]));
+    }
+    ASSERT_EQ(0, rmdir(directory.c_str()));
+}
+
+TEST(test_replication_deltas_mirror_the_partition) {
+    const uint32_t kStations = 200;
+    std::vector<uint32_t> one(1, 1);
+    std::vector<uint32_t> both = one;
+    both.push_back(2);
+    std::vector<StationCheckpoint> handoff;
+    StationPartition primary(1, makePrototype());
+    StationPartition replica(1, makePrototype());
+    primary.setMembers(1, std::vector<uint32_t>(), one, handoff);
+    primary.setChangeTracking(true);
+
+    uint32_t owner = 0;
+    for (uint32_t station = 0; station < kStations; ++station) {
+        std::vector<TraceSample> samples;
+        stationSamples(station, 0, 500, 99999, samples);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            primary.route(samples[i], &owner);
+        }
+    }
+
+    ReplicationCodec encoder;
+    ReplicationCodec decoder;
+    ReplicationBatch batch;
+    batch.sequence = 1;
+    batch.epoch = primary.getEpoch();
+    batch.full = true;
+    batch.members = primary.getRing().getMembers();
+    primary.takeChanges(true, batch.changed, batch.removed);
+    ASSERT_EQ(kStations, static_cast<uint32_t>(batch.changed.size()));
+    std::vector<uint8_t> payload;
+    encoder.encode(batch, payload);
+    ReplicationBatch received;
+    ASSERT_TRUE(decoder.decode(payload.data(), payload.size(), received));
+    ASSERT_TRUE(received.full);
+    replica.applyReplica(received.epoch, received.members, received.full, received.changed, received.removed);
+    ASSERT_TRUE(replicaMatches(replica, primary, kStations));
+
+    // A sample for every other station, and a rebalance that moves some away
+    for (uint32_t station = 0; station < kStations; station += 2) {
+        primary.route(makeSample(station, CHANNEL_HEIGHT, 600, 170.0f), &owner);
+        primary.route(makeSample(station, CHANNEL_BPM, 600, 71.5f), &owner);
+    }
+    primary.setMembers(2, one, both, handoff);
+    ASSERT_TRUE(!handoff.empty());
+
+    ReplicationBatch delta;
+    delta.sequence = 2;
+    delta.epoch = primary.getEpoch();
+    delta.members = primary.getRing().getMembers();
+    primary.takeChanges(false, delta.changed, delta.removed);
+    ASSERT_EQ(static_cast<uint32_t>(handoff.size()), static_cast<uint32_t>(delta.removed.size()));
+    payload.clear();
+    encoder.encode(delta, payload);
+    ASSERT_TRUE(payload.size() * 4 < delta.changed.size() * sizeof(StationCheckpoint));
+    ASSERT_TRUE(decoder.decode(payload.data(), payload.size(), received));
+    ASSERT_FALSE(received.full);
+    replica.applyReplica(received.epoch, received.members, received.full, received.changed, received.removed);
+    ASSERT_TRUE(replicaMatches(replica, primary, kStations));
+    ASSERT_EQ(primary.getStationCount(), decoder.getStationCount());
+
+    // Nothing changed: an empty batch (the heartbeat)
+    ReplicationBatch idle;
+    primary.takeChanges(false, idle.changed, idle.removed);
+    ASSERT_TRUE(idle.changed.empty() && idle.removed.empty());
+
+    // Truncated payloads are rejected
+    ASSERT_FALSE(ReplicationCodec().decode(payload.data(), payload.size() - 1, received));
+}
+
+TEST(test_standby_takes_over_a_killed_primary) {
+    char pattern[] = "/tmp/partition-XXXXXX";
+    ASSERT_TRUE(mkdtemp(pattern) != NULL);
+    std::string directory(pattern);
+    const uint32_t kStations = 50;
+
+    pid_t standby = startNode(directory, 1, serveStandby);
+    ASSERT_TRUE(standby > 0);
+    pid_t primary = startNode(directory, 1, serveReplicatedNode);
+    ASSERT_TRUE(primary > 0);
+    PartitionClient client(directory);
+    std::vector<TraceReplayer> reference(kStations, makePrototype());
+    ASSERT_TRUE(client.setMembers(std::vector<uint32_t>(1, 1)));
+    feed(client, reference, 0, 600, 99999);
+
+    // Let a batch carry the last samples over, then crash the primary
+    usleep((REPLICATION_BATCH_INTERVAL_MS + 2 * REPLICATION_HEARTBEAT_MS) * 1000);
+    int status = 0;
+    ASSERT_EQ(0, kill(primary, SIGKILL));
+    ASSERT_EQ(primary, waitpid(primary, &status, 0));
+    std::chrono::steady_clock::time_point crashed = std::chrono::steady_clock::now();
+
+    // The first send reconnects to the promoted standby
+    TraceSample next = makeSample(0, CHANNEL_HEIGHT, 700, 150.0f);
+    ASSERT_TRUE(client.send(next));
+    reference[0].onSample(next);
+    long long failoverMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - crashed).count();
+    ASSERT_TRUE(failoverMs < 1000);
+
+    // Stability timers carry on from the replicated state
+    feed(client, reference, 800, 1000, 99999);
+    ASSERT_TRUE(clusterMatches(client, reference));
+    for (uint32_t station = 0; station < kStations; ++station) {
+        ASSERT_TRUE(reference[station].getHeightDebouncer().isStable());
+    }
+
+    ASSERT_TRUE(stopNode(client, 1, standby));
+    ASSERT_EQ(0, rmdir(directory.c_str()));
+}
+
+TEST(test_standby_ignores_clean_shutdown_but_not_silence) {
+    char pattern[] = "/tmp/partition-XXXXXX";
+    ASSERT_TRUE(mkdtemp(pattern) != NULL);
+    std::string directory(pattern);
+    std::vector<StationCheckpoint> handoff;
+    StationPartition replica(1, makePrototype());
+    bool connected = false;
+    bool waitedOutShutdown = false;
+    bool failedOver = false;
+    long long silentMs = 0;
+    {
+        ReplicationStandby standby(ReplicationStandby::socketPath(directory, 1));
+        ASSERT_TRUE(standby.listen());
+        std::atomic<bool> returned(false);
+        std::thread watcher([&]() {
+            failedOver = standby.runUntilFailover(replica);
+            returned = true;
+        });
+
+        {
+            StationPartition partition(1, makePrototype());
+            partition.setMembers(1, std::vector<uint32_t>(), std::vector<uint32_t>(1, 1), handoff);
+            ReplicationPrimary primary(partition, ReplicationStandby::socketPath(directory, 1));
+            primary.start();
+            std::vector<TraceSample> samples;
+            stationSamples(7, 0, 300, 99999, samples);
+            uint32_t owner = 0;
+            for (size_t i = 0; i < samples.size(); ++i) {
+                partition.route(samples[i], &owner);
+            }
+            // The first batches are dropped until the sender has connected
+            for (int round = 0; round < 100 && primary.getStats().batches == 0; ++round) {
+                primary.publish();
+                usleep(10 * 1000);
+            }
+            connected = primary.getStats().connects == 1;
+            primary.stop();
+        }
+        usleep(2 * REPLICATION_FAILOVER_MS * 1000);
+        waitedOutShutdown = !returned;
+
+        // A connection that goes quiet is a hung primary
+        int fd = connectFrameSocket(ReplicationStandby::socketPath(directory, 1), PARTITION_CONNECT_TIMEOUT_MS);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        watcher.join();
+        silentMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+                       .count();
+        close(fd);
+    }
+    ASSERT_TRUE(connected);
+    ASSERT_TRUE(waitedOutShutdown);
+    ASSERT_TRUE(failedOver);
+    ASSERT_TRUE(silentMs >= REPLICATION_FAILOVER_MS - 10 && silentMs < 1000);
+
+    StationCheckpoint checkpoint;
+    ASSERT_TRUE(replica.getCheckpoint(7, checkpoint));
+    ASSERT_EQ(300UL, checkpoint.height.lastSampleTime);
+    ASSERT_TRUE(replica.isSettled());
+    ASSERT_EQ(0, rmdir(directory.c_str()));
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "StationPartition Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_ring_spreads_stations_evenly);
+    RUN_TEST(test_ring_moves_only_the_joining_and_leaving_nodes_stations);
+    RUN_TEST(test_handoff_keeps_stability_progress);
+    RUN_TEST(test_queued_samples_start_fresh_once_settled);
+    RUN_TEST(test_processes_rebalance_over_unix_sockets);
+    RUN_TEST(test_two_way_handoff_larger_than_the_socket_buffer);
+    RUN_TEST(test_replication_deltas_mirror_the_partition);
+    RUN_TEST(test_standby_takes_over_a_killed_primary);
+    RUN_TEST(test_standby_ignores_clean_shutdown_but_not_silence);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
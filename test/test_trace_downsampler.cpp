@@ -0,0 +1,357 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "line_tokenizer.h"
+#include "trace_downsampler.h"
+#include "trace_parser.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+
+// ============================================
+// Helpers
+// ============================================
+
+DownsamplePoint makePoint(unsigned long timeMs, float value) {
+    DownsamplePoint point;
+    point.timeMs = timeMs;
+    point.value = value;
+    point.kind = DOWNSAMPLE_POINT_SAMPLE;
+    return point;
+}
+
+/**
+ * Textbook LTTB over the whole series with the same time buckets, for
+ * comparison with the streaming version
+ */
+std::vector<DownsamplePoint> batchLttb(const std::vector<DownsamplePoint>& input, const DownsampleConfig& config) {
+    std::vector<DownsamplePoint> out;
+    if (input.empty()) {
+        return out;
+    }
+    out.push_back(input.front());
+    if (input.size() == 1) {
+        return out;
+    }
+    std::vector<std::vector<DownsamplePoint> > buckets;
+    unsigned long lastIndex = 0;
+    for (size_t i = 1; i + 1 < input.size(); ++i) {
+        unsigned long index = (input[i].timeMs - config.fromMs) / config.bucketMs;
+        if (buckets.empty() || index != lastIndex) {
+            buckets.push_back(std::vector<DownsamplePoint>());
+            lastIndex = index;
+        }
+        buckets.back().push_back(input[i]);
+    }
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        double nextTime = static_cast<double>(input.back().timeMs);
+        double nextValue = input.back().value;
+        if (b + 1 < buckets.size()) {
+            nextTime = 0.0;
+            nextValue = 0.0;
+            for (size_t i = 0; i < buckets[b + 1].size(); ++i) {
+                nextTime += static_cast<double>(buckets[b + 1][i].timeMs);
+                nextValue += buckets[b + 1][i].value;
+            }
+            nextTime /= static_cast<double>(buckets[b + 1].size());
+            nextValue /= static_cast<double>(buckets[b + 1].size());
+        }
+        const DownsamplePoint& a = out.back();
+        double bestArea = -1.0;
+        size_t best = 0;
+        for (size_t i = 0; i < buckets[b].size(); ++i) {
+            const DownsamplePoint& p = buckets[b][i];
+            double area = std::fabs((nextTime - static_cast<double>(a.timeMs)) * (p.value - a.value) -
+                                    (static_cast<double>(p.timeMs) - static_cast<double>(a.timeMs)) *
+                                        (nextValue - a.value));
+            if (area > bestArea) {
+                bestArea = area;
+                best = i;
+            }
+        }
+        out.push_back(buckets[b][best]);
+    }
+    out.push_back(input.back());
+    return out;
+}
+
+bool samePoints(const std::vector<DownsamplePoint>& a, const std::vector<DownsamplePoint>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].timeMs != b[i].timeMs || a[i].value != b[i].value || a[i].kind != b[i].kind) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class TransitionRecorder : public StabilityTransitionSink {
+public:
+    virtual void onTransition(const StabilityTransition& transition) { transitions.push_back(transition); }
+
+    std::vector<StabilityTransition> transitions;
+};
+
+/**
+ * An oximeter log: settles, is disturbed, loses the finger, settles again
+ */
+std::string makeOximeterLog(unsigned long durationMs) {
+    std::string log;
+    char line[96];
+    uint32_t state = 17;
+    for (unsigned long t = 0; t < durationMs; t += 100) {
+        state = state * 1664525u + 1013904223u;
+        unsigned long phase = (t / 20000) % 4;
+        float bpm = 72.0f + static_cast<float>((state >> 28) & 1);
+        unsigned spo2 = 97;
+        if (phase == 1) {
+            bpm = 60.0f + static_cast<float>((state >> 24) % 60);
+        } else if (phase == 2 && (t / 100) % 50 < 10) {
+            bpm = 0.0f;
+            spo2 = 0;
+        }
+        std::snprintf(line, sizeof(line), "[%lums] RAW - BPM:%.2f SpO2:%u%%\n", t, bpm, spo2);
+        log += line;
+        if ((t / 100) % 5 == 0) {
+            std::snprintf(line, sizeof(line), "Raw: %u cm | Stable: NO\n", 170 + ((state >> 20) & 3));
+            log += line;
+        }
+    }
+    return log;
+}
+
+// ============================================
+// LttbDownsampler
+// ============================================
+
+TEST(test_config_for_range) {
+    DownsampleConfig config = DownsampleConfig::forRange(1000, 101000, 102);
+    ASSERT_EQ(1000ul, config.fromMs);
+    ASSERT_EQ(1000ul, config.bucketMs);
+    config = DownsampleConfig::forRange(0, 10, 1000);
+    ASSERT_EQ(1ul, config.bucketMs);
+    config = DownsampleConfig::forRange(0, 1000, 0);
+    ASSERT_EQ(1000ul, config.bucketMs);
+}
+
+TEST(test_streaming_matches_batch_lttb) {
+    std::vector<DownsamplePoint> input;
+    uint32_t state = 5;
+    unsigned long t = 40;
+    for (int i = 0; i < 20000; ++i) {
+        state = state * 1664525u + 1013904223u;
+        t += 1 + (state >> 24) % 200;   // uneven spacing, some buckets empty
+        float value = 80.0f + 20.0f * std::sin(static_cast<float>(i) * 0.01f) + static_cast<float>(state >> 29);
+        input.push_back(makePoint(t, value));
+    }
+    DownsampleConfig config = DownsampleConfig::forRange(0, t, 500);
+    LttbDownsampler lttb(config);
+    std::vector<DownsamplePoint> out;
+    for (size_t i = 0; i < input.size(); ++i) {
+        lttb.add(input[i], out);
+    }
+    lttb.finish(out);
+
+    ASSERT_TRUE(samePoints(batchLttb(input, config), out));
+    ASSERT_TRUE(out.size() <= 500);
+    ASSERT_TRUE(out.size() > 450);
+    ASSERT_EQ(input.size(), lttb.getPointsIn());
+    ASSERT_EQ(out.size(), lttb.getPointsOut());
+}
+
+TEST(test_keeps_spikes_and_endpoints) {
+    DownsampleConfig config;
+    config.bucketMs = 1000;
+    LttbDownsampler lttb(config);
+    std::vector<DownsamplePoint> out;
+    for (unsigned long t = 0; t <= 10000; t += 10) {
+        lttb.add(makePoint(t, t == 5550 ? 200.0f : 70.0f), out);
+    }
+    lttb.finish(out);
+
+    ASSERT_EQ(0ul, out.front().timeMs);
+    ASSERT_EQ(10000ul, out.back().timeMs);
+    bool spike = false;
+    for (size_t i = 0; i < out.size(); ++i) {
+        spike = spike || out[i].timeMs == 5550;
+        if (i > 0) {
+            ASSERT_TRUE(out[i - 1].timeMs < out[i].timeMs);
+        }
+    }
+    ASSERT_TRUE(spike);
+    ASSERT_EQ(12u, out.size());   // first, one per bucket 0..10 (the last bucket only holds the end), last
+
+    // A single point and an empty series
+    LttbDownsampler single(config);
+    std::vector<DownsamplePoint> one;
+    single.add(makePoint(5, 1.0f), one);
+    single.finish(one);
+    ASSERT_EQ(1u, one.size());
+    single.finish(one);
+    ASSERT_EQ(1u, one.size());
+}
+
+TEST(test_transition_points_are_always_kept) {
+    DownsampleConfig config;
+    config.bucketMs = 1000;
+    LttbDownsampler lttb(config);
+    std::vector<DownsamplePoint> out;
+    for (unsigned long t = 0; t < 5000; t += 10) {
+        DownsamplePoint point = makePoint(t, t == 2500 ? 150.0f : 70.0f);
+        if (t == 1230 || t == 1240) {
+            point.kind = t == 1230 ? DOWNSAMPLE_POINT_STABLE : DOWNSAMPLE_POINT_UNSTABLE;
+        }
+        lttb.add(point, out);
+    }
+    lttb.finish(out);
+
+    size_t marked = 0;
+    for (size_t i = 0; i < out.size(); ++i) {
+        marked += out[i].kind != DOWNSAMPLE_POINT_SAMPLE ? 1 : 0;
+        if (i > 0) {
+            ASSERT_TRUE(out[i - 1].timeMs < out[i].timeMs);
+        }
+    }
+    ASSERT_EQ(2u, marked);
+    ASSERT_EQ(7u + 2u, out.size());   // the bucket with transitions keeps its pick too
+}
+
+// ============================================
+// TraceDownsampler
+// ============================================
+
+TEST(test_trace_keeps_every_debouncer_transition) {
+    const std::string log = makeOximeterLog(200000);
+    DownsampleConfig config = DownsampleConfig::forRange(0, 200000, 200);
+    TraceDownsampler downsampler(config);
+    TraceParser parser(&downsampler, 0);
+    parser.feed(log.data(), log.size());
+    parser.finish();
+    downsampler.finish();
+
+    TransitionRecorder recorder;
+    TraceReplayer replayer(&recorder);
+    TraceParser reference(&replayer, 0);
+    reference.feed(log.data(), log.size());
+    reference.finish();
+    ASSERT_TRUE(recorder.transitions.size() > 10);
+
+    size_t transitionPoints = 0;
+    for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        const std::vector<DownsamplePoint>& points = downsampler.getPoints(channel);
+        for (size_t i = 0; i < points.size(); ++i) {
+            transitionPoints += points[i].kind != DOWNSAMPLE_POINT_SAMPLE ? 1 : 0;
+        }
+        ASSERT_TRUE(downsampler.getSeries(channel).getPointsIn() > 300);
+        ASSERT_TRUE(points.size() <= 200 + recorder.transitions.size());
+    }
+    ASSERT_EQ(recorder.transitions.size(), transitionPoints);
+    for (size_t i = 0; i < recorder.transitions.size(); ++i) {
+        const StabilityTransition& transition = recorder.transitions[i];
+        const std::vector<DownsamplePoint>& points = downsampler.getPoints(transition.channel);
+        bool found = false;
+        for (size_t p = 0; p < points.size() && !found; ++p) {
+            found = points[p].timeMs == transition.timeMs &&
+                    points[p].kind == (transition.stable ? DOWNSAMPLE_POINT_STABLE : DOWNSAMPLE_POINT_UNSTABLE);
+        }
+        ASSERT_TRUE(found);
+    }
+}
+
+TEST(test_columns_match_parsed_samples) {
+    const std::string log = makeOximeterLog(100000);
+    DownsampleConfig config = DownsampleConfig::forRange(0, 100000, 150);
+
+    TraceDownsampler fromSamples(config);
+    TraceParser parser(&fromSamples, 0);
+    TraceDownsampler fromColumns(config);
+    LineTokenizer tokenizer;
+    LogColumns columns;
+    // Blocks that split lines, as a reader delivers them
+    for (size_t offset = 0; offset < log.size(); offset += 4096) {
+        size_t length = log.size() - offset < 4096 ? log.size() - offset : 4096;
+        parser.feed(log.data() + offset, length);
+        tokenizer.feed(log.data() + offset, length, columns);
+        fromColumns.addColumns(columns);
+        columns.clear();
+    }
+    parser.finish();
+    tokenizer.finish(columns);
+    fromColumns.addColumns(columns);
+    fromSamples.finish();
+    fromColumns.finish();
+
+    for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        ASSERT_TRUE(samePoints(fromSamples.getPoints(channel), fromColumns.getPoints(channel)));
+        ASSERT_TRUE(fromSamples.getPoints(channel).size() > 20);
+    }
+
+    // Points handed on are dropped
+    fromColumns.clearPoints();
+    ASSERT_TRUE(fromColumns.getPoints(CHANNEL_BPM).empty());
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Trace Downsampler Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_config_for_range);
+    RUN_TEST(test_streaming_matches_batch_lttb);
+    RUN_TEST(test_keeps_spikes_and_endpoints);
+    RUN_TEST(test_transition_points_are_always_kept);
+    RUN_TEST(test_trace_keeps_every_debouncer_transition);
+    RUN_TEST(test_columns_match_parsed_samples);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
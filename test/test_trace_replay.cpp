@@ -0,0 +1,334 @@
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "trace_parser.h"
+#include "trace_reader.h"
+#include "trace_replayer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+class CollectingSink : public TraceSampleSink {
+public:
+    std::vector<TraceSample> samples;
+    virtual void onSample(const TraceSample& sample) { samples.push_back(sample); }
+};
+
+class TransitionCollector : public StabilityTransitionSink {
+public:
+    std::vector<StabilityTransition> transitions;
+    virtual void onTransition(const StabilityTransition& transition) { transitions.push_back(transition); }
+};
+
+class ContentCollector : public TraceBlockHandler {
+public:
+    std::vector<std::string> contents;
+    std::vector<int> endCount;
+
+    virtual void onBlock(size_t fileIndex, const char* data, size_t length) {
+        grow(fileIndex);
+        contents[fileIndex].append(data, length);
+    }
+    virtual void onFileEnd(size_t fileIndex) {
+        grow(fileIndex);
+        endCount[fileIndex]++;
+    }
+
+private:
+    void grow(size_t fileIndex) {
+        if (fileIndex >= contents.size()) {
+            contents.resize(fileIndex + 1);
+            endCount.resize(fileIndex + 1, 0);
+        }
+    }
+};
+
+std::string writeTempFile(const std::string& contents) {
+    char path[] = "/tmp/trace_replay_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        throw std::runtime_error("mkstemp failed");
+    }
+    size_t written = 0;
+    while (written < contents.size()) {
+        ssize_t n = write(fd, contents.data() + written, contents.size() - written);
+        if (n <= 0) {
+            close(fd);
+            throw std::runtime_error("write failed");
+        }
+        written += static_cast<size_t>(n);
+    }
+    close(fd);
+    return path;
+}
+
+std::string heightLog(int lines) {
+    std::string log;
+    for (int i = 0; i < lines; ++i) {
+        int distance = 150 + (i % 3);
+        log += "Raw: " + std::to_string(distance) + " cm | Stable: NO\n";
+    }
+    return log;
+}
+
+// ============================================
+// Parser Tests
+// ============================================
+
+TEST(test_parse_height_lines) {
+    CollectingSink sink;
+    TraceParser parser(&sink, 7, 100);
+    std::string log = "Raw: 150 cm | Stable: NO\nRaw: 151 cm | Stable: YES (151 cm)\n";
+    parser.feed(log.data(), log.size());
+
+    ASSERT_EQ(2u, sink.samples.size());
+    ASSERT_EQ(7u, sink.samples[0].deviceId);
+    ASSERT_EQ(CHANNEL_HEIGHT, sink.samples[0].channel);
+    ASSERT_TRUE(sink.samples[0].value == 150.0f);
+    ASSERT_EQ(0ul, sink.samples[0].timeMs);
+    ASSERT_EQ(100ul, sink.samples[1].timeMs);   // Synthesized from loop period
+    ASSERT_EQ(2ul, parser.getLinesParsed());
+}
+
+TEST(test_parse_oximeter_lines) {
+    CollectingSink sink;
+    TraceParser parser(&sink, 0, 100);
+    std::string log = "[12345ms] RAW - BPM:72.50 SpO2:97%\n      DEBOUNCE - BPM:valid SpO2:valid\n";
+    parser.feed(log.data(), log.size());
+
+    ASSERT_EQ(2u, sink.samples.size());
+    ASSERT_EQ(CHANNEL_BPM, sink.samples[0].channel);
+    ASSERT_TRUE(sink.samples[0].value == 72.5f);
+    ASSERT_EQ(12345ul, sink.samples[0].timeMs);
+    ASSERT_EQ(CHANNEL_SPO2, sink.samples[1].channel);
+    ASSERT_TRUE(sink.samples[1].value == 97.0f);
+    ASSERT_EQ(1ul, parser.getLinesSkipped());
+}
+
+TEST(test_lines_split_across_blocks) {
+    std::string log = "[100ms] RAW - BPM:60.25 SpO2:98%\r\nRaw: 42 cm | Stable: NO\n[200ms] RAW - BPM:0.00 SpO2:0%";
+
+    CollectingSink whole;
+    TraceParser wholeParser(&whole, 0, 100);
+    wholeParser.feed(log.data(), log.size());
+    wholeParser.finish();
+
+    // Feeding byte by byte must give exactly the same samples
+    CollectingSink pieces;
+    TraceParser piecesParser(&pieces, 0, 100);
+    for (size_t i = 0; i < log.size(); ++i) {
+        piecesParser.feed(log.data() + i, 1);
+    }
+    piecesParser.finish();
+
+    ASSERT_EQ(5u, whole.samples.size());
+    ASSERT_EQ(whole.samples.size(), pieces.samples.size());
+    for (size_t i = 0; i < whole.samples.size(); ++i) {
+        ASSERT_TRUE(whole.samples[i].value == pieces.samples[i].value);
+        ASSERT_EQ(whole.samples[i].timeMs, pieces.samples[i].timeMs);
+        ASSERT_EQ(whole.samples[i].channel, pieces.samples[i].channel);
+    }
+}
+
+TEST(test_malformed_lines_skipped) {
+    CollectingSink sink;
+    TraceParser parser(&sink, 0, 100);
+    std::string log = "Beat!\nRaw: cm\n[12ms] RAW - BPM:x SpO2:1%\n\n";
+    parser.feed(log.data(), log.size());
+
+    ASSERT_EQ(0u, sink.samples.size());
+    ASSERT_EQ(3ul, parser.getLinesSkipped());
+}
+
+// ============================================
+// Replayer Tests
+// ============================================
+
+TEST(test_replayer_reports_transitions) {
+    TransitionCollector collector;
+    TraceReplayer replayer(HeightDebouncer(2, 300, 100),
+                           ReadingDebouncer<float>(5.0f, 300, 100, 40.0f, 200.0f),
+                           ReadingDebouncer<int>(2, 300, 100, 50, 100),
+                           &collector);
+    TraceParser parser(&replayer, 3, 100);
+
+    std::string log = "Raw: 150 cm | Stable: NO\nRaw: 150 cm | Stable: NO\n"
+                      "Raw: 151 cm | Stable: NO\nRaw: 150 cm | Stable: YES (150 cm)\n"
+                      "Raw: 180 cm | Stable: NO\n";
+    parser.feed(log.data(), log.size());
+
+    ASSERT_EQ(5ul, replayer.getSamplesProcessed());
+    ASSERT_EQ(2u, collector.transitions.size());
+    ASSERT_TRUE(collector.transitions[0].stable);
+    ASSERT_EQ(300ul, collector.transitions[0].timeMs);
+    ASSERT_TRUE(collector.transitions[0].value == 150.0f);
+    ASSERT_EQ(3u, collector.transitions[0].deviceId);
+    ASSERT_FALSE(collector.transitions[1].stable);
+    ASSERT_TRUE(collector.transitions[1].value == 180.0f);
+}
+
+// ============================================
+// Reader Tests
+// ============================================
+
+void checkReaderDeliversInOrder(bool useIoUring) {
+    std::vector<std::string> contents;
+    std::vector<std::string> paths;
+    for (int i = 0; i < 5; ++i) {
+        contents.push_back(heightLog(200 + i * 150));  // Several blocks each
+        paths.push_back(writeTempFile(contents.back()));
+    }
+    contents.push_back("");
+    paths.push_back(writeTempFile(""));
+
+    TraceReaderOptions options;
+    options.blockSize = 4096;
+    options.queueDepth = 8;
+    options.maxInFlightPerFile = 3;
+    options.useIoUring = useIoUring;
+    AsyncTraceReader reader(options);
+    ContentCollector collector;
+    bool ok = reader.run(paths, collector);
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        unlink(paths[i].c_str());
+    }
+
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(0u, reader.getFilesFailed());
+    if (!useIoUring) {
+        ASSERT_FALSE(reader.isUsingIoUring());
+    }
+    ASSERT_EQ(contents.size(), collector.contents.size());
+    for (size_t i = 0; i < contents.size(); ++i) {
+        ASSERT_TRUE(contents[i] == collector.contents[i]);
+        ASSERT_EQ(1, collector.endCount[i]);
+    }
+}
+
+TEST(test_reader_sync_backend) {
+    checkReaderDeliversInOrder(false);
+}
+
+TEST(test_reader_io_uring_backend) {
+    // Falls back to pread where io_uring is unavailable
+    checkReaderDeliversInOrder(true);
+}
+
+TEST(test_reader_missing_file) {
+    std::vector<std::string> paths;
+    paths.push_back("/nonexistent/trace.log");
+    paths.push_back(writeTempFile("Raw: 1 cm | Stable: NO\n"));
+
+    AsyncTraceReader reader;
+    ContentCollector collector;
+    bool ok = reader.run(paths, collector);
+    unlink(paths[1].c_str());
+
+    ASSERT_FALSE(ok);
+    ASSERT_EQ(1u, reader.getFilesFailed());
+    ASSERT_EQ(1, collector.endCount[0]);
+    ASSERT_EQ(1, collector.endCount[1]);
+    ASSERT_TRUE(collector.contents[1] == "Raw: 1 cm | Stable: NO\n");
+}
+
+TEST(test_file_replay_end_to_end) {
+    std::vector<std::string> paths;
+    paths.push_back(writeTempFile(heightLog(100)));
+    paths.push_back(writeTempFile("[0ms] RAW - BPM:70.00 SpO2:97%\n[1000ms] RAW - BPM:71.00 SpO2:97%\n"
+                                  "[2000ms] RAW - BPM:70.50 SpO2:98%\n[3000ms] RAW - BPM:70.00 SpO2:97%\n"));
+
+    TraceReaderOptions options;
+    options.blockSize = 4096;
+    AsyncTraceReader reader(options);
+    TransitionCollector collector;
+    TraceFileReplay replay(&collector);
+    bool ok = reader.run(paths, replay);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        unlink(paths[i].c_str());
+    }
+
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(2ul, replay.getFilesCompleted());
+    ASSERT_EQ(108ul, replay.getSamplesProcessed());
+    ASSERT_EQ(104ul, replay.getLinesParsed());
+
+    // Height (device 0) and both oximeter channels (device 1) settle
+    int heightStable = 0;
+    int oximeterStable = 0;
+    for (size_t i = 0; i < collector.transitions.size(); ++i) {
+        if (collector.transitions[i].stable && collector.transitions[i].deviceId == 0) heightStable++;
+        if (collector.transitions[i].stable && collector.transitions[i].deviceId == 1) oximeterStable++;
+    }
+    ASSERT_EQ(1, heightStable);
+    ASSERT_EQ(2, oximeterStable);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Trace Replay Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_parse_height_lines);
+    RUN_TEST(test_parse_oximeter_lines);
+    RUN_TEST(test_lines_split_across_blocks);
+    RUN_TEST(test_malformed_lines_skipped);
+    RUN_TEST(test_replayer_reports_transitions);
+    RUN_TEST(test_reader_sync_backend);
+    RUN_TEST(test_reader_io_uring_backend);
+    RUN_TEST(test_reader_missing_file);
+    RUN_TEST(test_file_replay_end_to_end);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
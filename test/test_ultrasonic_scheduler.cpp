@@ -0,0 +1,261 @@
+#include <iostream>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "config.h"
+#include "height_debouncer.h"
+#include "host_devices.h"
+#include "ultrasonic_scheduler.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+// ============================================
+// Helpers
+// ============================================
+
+struct RecordingPort : public UltrasonicPort {
+    std::vector<uint8_t> heads;
+    std::vector<unsigned long> timesUs;
+    unsigned long nowUs;
+
+    RecordingPort() : nowUs(0) {}
+
+    virtual void trigger(uint8_t head) {
+        heads.push_back(head);
+        timesUs.push_back(nowUs);
+    }
+};
+
+/**
+ * Run the scheduler against the simulated heads until a frame completes
+ */
+bool runFrame(UltrasonicScheduler& scheduler, SimulatedUltrasonicHeads& heads, UltrasonicFrame& frame) {
+    for (int step = 0; step < 100000; ++step) {
+        heads.deliverEdges(scheduler);
+        if (scheduler.poll(micros())) {
+            return scheduler.takeFrame(frame);
+        }
+        unsigned long long now = hostClock().nowUs();
+        unsigned long long next = heads.nextEdgeUs();
+        hostClock().advanceUs(next > now && next - now < 100 ? next - now : 100);
+    }
+    return false;
+}
+
+// ============================================
+// Slot Assignment Tests
+// ============================================
+
+TEST(test_heads_that_hear_each_other_get_separate_slots) {
+    RecordingPort port;
+    UltrasonicSchedulerConfig config;
+    config.heads = 4;
+    UltrasonicScheduler scheduler(&port, config);
+    ASSERT_EQ(4, scheduler.getSlotCount());
+    ASSERT_EQ(DEBOUNCE_SAMPLE_INTERVAL_MS * 1000UL, scheduler.getFramePeriodUs());
+
+    // Heads 0/1 and 2/3 face away from each other and can fire together
+    for (uint8_t h = 0; h < 4; ++h) {
+        config.hears[h] = static_cast<uint8_t>(0x0F & ~(0x3 << (h & ~1)));
+    }
+    UltrasonicScheduler paired(&port, config);
+    ASSERT_EQ(2, paired.getSlotCount());
+    ASSERT_EQ(paired.getSlot(0), paired.getSlot(1));
+    ASSERT_EQ(paired.getSlot(2), paired.getSlot(3));
+    ASSERT_TRUE(paired.getSlot(0) != paired.getSlot(2));
+
+    for (uint8_t h = 0; h < 4; ++h) {
+        config.hears[h] = 0;
+    }
+    UltrasonicScheduler isolated(&port, config);
+    ASSERT_EQ(1, isolated.getSlotCount());
+}
+
+TEST(test_frame_stretches_when_guards_do_not_fit) {
+    RecordingPort port;
+    UltrasonicSchedulerConfig config;
+    config.heads = 4;
+    config.guardUs = 30000;
+    UltrasonicScheduler scheduler(&port, config);
+    ASSERT_EQ(120000UL, scheduler.getFramePeriodUs());
+}
+
+TEST(test_triggers_are_interleaved_by_the_guard) {
+    RecordingPort port;
+    UltrasonicSchedulerConfig config;
+    config.heads = 3;
+    UltrasonicScheduler scheduler(&port, config);
+    scheduler.begin(0);
+    int frames = 0;
+    for (port.nowUs = 0; port.nowUs < 300000; port.nowUs += 100) {
+        frames += scheduler.poll(port.nowUs) ? 1 : 0;
+    }
+    ASSERT_EQ(2, frames);
+    ASSERT_EQ(9u, port.heads.size());
+    for (size_t i = 0; i < port.heads.size(); ++i) {
+        ASSERT_EQ(i % 3, port.heads[i]);
+        ASSERT_EQ((i / 3) * 100000UL + (i % 3) * ULTRASONIC_GUARD_US, port.timesUs[i]);
+    }
+}
+
+// ============================================
+// Echo Tests
+// ============================================
+
+TEST(test_echoes_are_decoded_and_fused) {
+    hostClock().reset();
+    SimulatedUltrasonicHeads heads(hostClock(), 3, 1);
+    heads.setNoise(0.0f);
+    heads.setDistance(0, 60.0f);
+    heads.setDistance(1, 64.0f);
+    heads.setDistance(2, 61.0f);
+    UltrasonicSchedulerConfig config;
+    config.heads = 3;
+    UltrasonicScheduler scheduler(&heads, config);
+    scheduler.begin(micros());
+
+    UltrasonicFrame frame;
+    ASSERT_TRUE(runFrame(scheduler, heads, frame));
+    ASSERT_EQ(0x7, frame.validMask);
+    ASSERT_EQ(60, frame.distanceCm[0]);
+    ASSERT_EQ(64, frame.distanceCm[1]);
+    ASSERT_EQ(61, frame.distanceCm[2]);
+    ASSERT_EQ(61, frame.fusedCm);
+    ASSERT_EQ(100u, frame.timeMs);
+    ASSERT_EQ(0u, heads.getCrosstalkHits());
+}
+
+TEST(test_missing_echo_is_left_out) {
+    hostClock().reset();
+    SimulatedUltrasonicHeads heads(hostClock(), 2, 1);
+    heads.setNoise(0.0f);
+    heads.setDistance(0, 0.0f);     // nothing in range: 38 ms echo
+    heads.setDistance(1, 75.0f);
+    UltrasonicSchedulerConfig config;
+    config.heads = 2;
+    UltrasonicScheduler scheduler(&heads, config);
+    scheduler.begin(micros());
+
+    UltrasonicFrame frame;
+    ASSERT_TRUE(runFrame(scheduler, heads, frame));
+    ASSERT_EQ(0x2, frame.validMask);
+    ASSERT_EQ(0, frame.distanceCm[0]);
+    ASSERT_EQ(75, frame.fusedCm);
+}
+
+TEST(test_short_guard_lets_crosstalk_through) {
+    hostClock().reset();
+    SimulatedUltrasonicHeads heads(hostClock(), 2, 1);
+    heads.setNoise(0.0f);
+    heads.setDistance(0, 150.0f);
+    heads.setDistance(1, 150.0f);
+    UltrasonicSchedulerConfig config;
+    config.heads = 2;
+    config.guardUs = 2000;          // head 1 fires while head 0 still listens
+    UltrasonicScheduler scheduler(&heads, config);
+    scheduler.begin(micros());
+
+    UltrasonicFrame frame;
+    ASSERT_TRUE(runFrame(scheduler, heads, frame));
+    ASSERT_TRUE(heads.getCrosstalkHits() > 0);
+    ASSERT_TRUE(frame.distanceCm[0] < 150);
+}
+
+// ============================================
+// Debouncer Integration Tests
+// ============================================
+
+TEST(test_four_heads_keep_the_single_head_rate) {
+    hostClock().reset();
+    SimulatedUltrasonicHeads heads(hostClock(), 4, 7);
+    heads.setNoise(0.5f);
+    for (uint8_t h = 0; h < 4; ++h) {
+        heads.setDistance(h, 80.0f);
+    }
+    UltrasonicSchedulerConfig config;
+    config.heads = 4;
+    UltrasonicScheduler scheduler(&heads, config);
+    HeightDebouncer fused;
+    HeightDebouncer perHead[4];
+    scheduler.begin(micros());
+
+    UltrasonicFrame frame;
+    unsigned long frames = 0;
+    while (millis() < 5000) {
+        ASSERT_TRUE(runFrame(scheduler, heads, frame));
+        fused.update(frame.fusedCm, frame.timeMs);
+        for (uint8_t h = 0; h < 4; ++h) {
+            perHead[h].update(frame.distanceCm[h], frame.timeMs);
+        }
+        frames++;
+    }
+    ASSERT_EQ(50u, frames);
+    ASSERT_EQ(0u, heads.getCrosstalkHits());
+    ASSERT_TRUE(fused.isStable());
+    ASSERT_EQ(80, fused.getStableReading());
+    for (uint8_t h = 0; h < 4; ++h) {
+        ASSERT_TRUE(perHead[h].hasValidReading());
+    }
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Ultrasonic Scheduler Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_heads_that_hear_each_other_get_separate_slots);
+    RUN_TEST(test_frame_stretches_when_guards_do_not_fit);
+    RUN_TEST(test_triggers_are_interleaved_by_the_guard);
+    RUN_TEST(test_echoes_are_decoded_and_fused);
+    RUN_TEST(test_missing_echo_is_left_out);
+    RUN_TEST(test_short_guard_lets_crosstalk_through);
+    RUN_TEST(test_four_heads_keep_the_single_head_rate);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
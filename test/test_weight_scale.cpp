@@ -0,0 +1,279 @@
+#include <iostream>
+#include <cassert>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "cic_decimator.h"
+#include "config.h"
+#include "host_devices.h"
+#include "hx711_reader.h"
+#include "reading_debouncer.h"
+
+// Simple test framework
+int testsRun = 0;
+int testsPassed = 0;
+int testsFailed = 0;
+
+#define TEST(name) void name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running " << #name << "... "; \
+    testsRun++; \
+    try { \
+        name(); \
+        testsPassed++; \
+        std::cout << "PASSED" << std::endl; \
+    } catch (const std::exception& e) { \
+        testsFailed++; \
+        std::cout << "FAILED: " << e.what() << std::endl; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(condition) do { \
+    if (!(condition)) { \
+        throw std::runtime_error("Assertion failed: " #condition); \
+    } \
+} while(0)
+
+#define ASSERT_FALSE(condition) ASSERT_TRUE(!(condition))
+
+#define ASSERT_EQ(expected, actual) do { \
+    if ((expected) != (actual)) { \
+        throw std::runtime_error("Assertion failed: " #expected " == " #actual \
+            " (expected: " + std::to_string(expected) + ", actual: " + std::to_string(actual) + ")"); \
+    } \
+} while(0)
+
+
+// ============================================
+// Helpers
+// ============================================
+
+/**
+ * A simulated HX711 on the config.h pins, from a fresh clock
+ */
+struct ScaleRig {
+    SimulatedHx711 hx711;
+    Hx711Reader reader;
+
+    explicit ScaleRig(unsigned int gpioCostUs = 0)
+        : hx711(hostClock(), HX711_DOUT_PIN, HX711_SCK_PIN, 7)
+        , reader(HX711_DOUT_PIN, HX711_SCK_PIN, HX711_GAIN_PULSES)
+    {
+        hostClock().reset();
+        hostAttachPin(HX711_DOUT_PIN, &hx711);
+        hostAttachPin(HX711_SCK_PIN, &hx711);
+        hostSetGpioCostUs(gpioCostUs);
+        reader.begin();
+    }
+
+    ~ScaleRig() {
+        hostAttachPin(HX711_DOUT_PIN, NULL);
+        hostAttachPin(HX711_SCK_PIN, NULL);
+        hostSetGpioCostUs(0);
+    }
+};
+
+// ============================================
+// CicDecimator
+// ============================================
+
+TEST(test_cic_passes_dc_in_input_units) {
+    CicDecimator<2, 3> cic;
+    ASSERT_EQ(8, cic.getRate());
+    int outputs = 0;
+    int32_t out = 0;
+    for (int i = 0; i < 8 * 10; ++i) {
+        if (cic.push(-123456, out)) {
+            ASSERT_EQ(-123456, out);
+            outputs++;
+        }
+    }
+    // The first ORDER outputs only prime the combs
+    ASSERT_EQ(8, outputs);
+}
+
+TEST(test_cic_survives_integrator_wraparound) {
+    // Full-scale 24-bit input wraps the 32-bit integrators within a few
+    // hundred samples; the combs must still recover the value
+    CicDecimator<2, 3> cic;
+    int32_t out = 0;
+    int outputs = 0;
+    for (int i = 0; i < 8 * 1000; ++i) {
+        if (cic.push(0x7FFFFF, out)) {
+            ASSERT_EQ(0x7FFFFF, out);
+            outputs++;
+        }
+    }
+    ASSERT_EQ(998, outputs);
+}
+
+TEST(test_cic_step_settles_within_order_outputs) {
+    CicDecimator<2, 3> cic;
+    int32_t out = 0;
+    std::vector<int32_t> outputs;
+    for (int i = 0; i < 8 * 10; ++i) {
+        if (cic.push(i < 8 * 5 ? 1000 : 5000, out)) {
+            outputs.push_back(out);
+        }
+    }
+    ASSERT_EQ(8u, outputs.size());
+    ASSERT_EQ(1000, outputs[2]);
+    ASSERT_TRUE(outputs[3] > 1000 && outputs[3] < 5000);   // mid-transition
+    ASSERT_EQ(5000, outputs[4]);
+}
+
+TEST(test_cic_reduces_noise) {
+    CicDecimator<WEIGHT_CIC_ORDER, WEIGHT_CIC_LOG2_RATE> cic;
+    std::mt19937 rng(3);
+    std::normal_distribution<float> noise(0.0f, 400.0f);
+    double inputVar = 0.0;
+    double outputVar = 0.0;
+    int inputs = 0;
+    int outputs = 0;
+    int32_t out = 0;
+    for (int i = 0; i < 8000; ++i) {
+        int32_t sample = 30000 + static_cast<int32_t>(noise(rng));
+        inputVar += static_cast<double>(sample - 30000) * (sample - 30000);
+        inputs++;
+        if (cic.push(sample, out)) {
+            outputVar += static_cast<double>(out - 30000) * (out - 30000);
+            outputs++;
+        }
+    }
+    inputVar /= inputs;
+    outputVar /= outputs;
+    // An order-2 CIC of rate 8 cuts white noise power about 12-fold
+    ASSERT_TRUE(outputVar * 6.0 < inputVar);
+}
+
+// ============================================
+// Hx711Reader
+// ============================================
+
+TEST(test_reader_does_not_wait_for_a_conversion) {
+    ScaleRig rig;
+    int32_t raw = 42;
+    ASSERT_FALSE(rig.reader.poll(raw));
+    ASSERT_EQ(42, raw);
+    ASSERT_EQ(0ul, rig.hx711.getReads());
+}
+
+TEST(test_reader_decodes_signed_conversions) {
+    ScaleRig rig;
+    rig.hx711.setOffset(-52000);
+    rig.hx711.setLoad(0, 0.0f);
+    rig.hx711.setLoad(30, 10000.0f);    // 10 kg
+    hostClock().advanceUs(13000);
+    int32_t raw = 0;
+    ASSERT_TRUE(rig.reader.poll(raw));
+    ASSERT_EQ(-52000, raw);
+    ASSERT_FALSE(rig.reader.poll(raw));  // consumed
+
+    hostClock().advanceUs(25000);
+    ASSERT_TRUE(rig.reader.poll(raw));
+    ASSERT_EQ(-52000 + 10000 * HX711_COUNTS_PER_100G / 100, raw);
+    ASSERT_EQ(2ul, rig.reader.getReadCount());
+    ASSERT_EQ(2ul, rig.hx711.getReads());
+}
+
+TEST(test_polling_keeps_up_at_80_sps) {
+    // Uno-like GPIO cost; a 25-pulse read takes about 0.35 ms
+    ScaleRig rig(4);
+    rig.hx711.setNoise(200.0f);
+    int32_t raw = 0;
+    while (millis() < 2000) {
+        rig.reader.poll(raw);
+        hostClock().advanceUs(500);
+    }
+    ASSERT_TRUE(rig.hx711.getConversions() >= 159);
+    ASSERT_EQ(0ul, rig.hx711.getMissed());
+    ASSERT_EQ(0ul, rig.hx711.getPowerDowns());
+    ASSERT_TRUE(rig.hx711.getReads() + 1 >= rig.hx711.getConversions());
+}
+
+TEST(test_slow_loop_misses_conversions) {
+    ScaleRig rig(4);
+    int32_t raw = 0;
+    while (millis() < 1000) {
+        rig.reader.poll(raw);
+        hostClock().advanceUs(30000);   // a blocking 30 ms display update
+    }
+    ASSERT_TRUE(rig.hx711.getMissed() > 0);
+}
+
+// ============================================
+// Integration
+// ============================================
+
+TEST(test_decimated_weight_settles_in_the_debouncer) {
+    ScaleRig rig(4);
+    rig.hx711.setOffset(-52000);
+    rig.hx711.setNoise(300.0f);
+    rig.hx711.setLoad(0, 0.0f);
+    rig.hx711.setLoad(2000, 72400.0f);
+    CicDecimator<WEIGHT_CIC_ORDER, WEIGHT_CIC_LOG2_RATE> cic;
+    ReadingDebouncer<long> debouncer(WEIGHT_TOLERANCE_G, WEIGHT_STABILITY_DURATION_MS, WEIGHT_SAMPLE_INTERVAL_MS,
+                                     WEIGHT_MIN_VALID_G, WEIGHT_MAX_VALID_G);
+    int32_t tareSum = 0;
+    int tareCount = 0;
+    int32_t tare = 0;
+    unsigned long stableAtMs = 0;
+
+    while (millis() < 8000) {
+        int32_t raw = 0;
+        int32_t filtered = 0;
+        if (rig.reader.poll(raw) && cic.push(raw, filtered)) {
+            if (tareCount < WEIGHT_TARE_READINGS) {
+                tareSum += filtered;
+                if (++tareCount == WEIGHT_TARE_READINGS) {
+                    tare = tareSum / WEIGHT_TARE_READINGS;
+                }
+            } else {
+                long grams = static_cast<long>(filtered - tare) * 100L / HX711_COUNTS_PER_100G;
+                debouncer.update(grams, millis());
+                if (stableAtMs == 0 && debouncer.isStable()) {
+                    stableAtMs = millis();
+                }
+            }
+        }
+        hostClock().advanceUs(1000);
+    }
+    ASSERT_TRUE(debouncer.isStable());
+    ASSERT_TRUE(debouncer.getStableReading() > 72400 - WEIGHT_TOLERANCE_G);
+    ASSERT_TRUE(debouncer.getStableReading() < 72400 + WEIGHT_TOLERANCE_G);
+    // Stability duration plus a few decimated periods of filter delay
+    ASSERT_TRUE(stableAtMs > 2000 + WEIGHT_STABILITY_DURATION_MS);
+    ASSERT_TRUE(stableAtMs < 2000 + WEIGHT_STABILITY_DURATION_MS + 500);
+}
+
+// ============================================
+// Main Test Runner
+// ============================================
+
+int main() {
+    std::cout << "========================================" << std::endl;
+    std::cout << "Weight Scale Unit Tests" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    RUN_TEST(test_cic_passes_dc_in_input_units);
+    RUN_TEST(test_cic_survives_integrator_wraparound);
+    RUN_TEST(test_cic_step_settles_within_order_outputs);
+    RUN_TEST(test_cic_reduces_noise);
+    RUN_TEST(test_reader_does_not_wait_for_a_conversion);
+    RUN_TEST(test_reader_decodes_signed_conversions);
+    RUN_TEST(test_polling_keeps_up_at_80_sps);
+    RUN_TEST(test_slow_loop_misses_conversions);
+    RUN_TEST(test_decimated_weight_settles_in_the_debouncer);
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "Results: " << testsPassed << "/" << testsRun << " passed";
+    if (testsFailed > 0) {
+        std::cout << " (" << testsFailed << " failed)";
+    }
+    std::cout << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    return testsFailed > 0 ? 1 : 0;
+}
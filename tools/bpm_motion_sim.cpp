@@ -0,0 +1,396 @@
+// ============================================
+// bpm_motion_sim - Beat detector vs FFT heart rate under motion
+// ============================================
+// Synthesizes raw MAX30100 IR (100 Hz) for finger placements with random
+// rate, pulse amplitude and motion, and measures, per session, the time
+// from placing the finger to a settled bpmDebouncer reading and its error.
+// The rate handed to the debouncer once per REPORTING_PERIOD_MS comes from:
+//
+//   beat     - the MAX30100 library's path (DC remover, 6 Hz low-pass,
+//              threshold beat detector), as PulseOximeter::getHeartRate()
+//   fft      - FftBpmEstimator at the ESP32 size
+//   fft-uno  - FftBpmEstimator at the Uno size
+//   fft+beat - the ESP32 estimate, or the beat rate while it has none
+//
+// A session counts as settled at the first stable reading within
+// BPM_TOLERANCE of the true rate; "wrong" is the share of sessions that
+// were stable on a reading further off at some point.
+//
+// With --replay, a file of raw IR samples (one per line; the first number
+// on a line is used, "#" lines are skipped) is run as one session.
+//
+// Usage: bpm_motion_sim [--sessions N] [--seed N] [--motion RATIO]
+//        bpm_motion_sim --replay FILE [--bpm REFERENCE]
+// ============================================
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "config.h"
+#include "fft_bpm_estimator.h"
+#include "reading_debouncer.h"
+
+namespace {
+
+const unsigned long kSampleMs = 1000 / FFT_BPM_SAMPLE_RATE_HZ;
+const unsigned long kSessionMs = 30000;   // finger on the sensor
+const unsigned long kBootMs = 10000;      // device uptime when the finger is placed
+const uint16_t kUnoHop = FFT_BPM_HOP_MS * FFT_BPM_SAMPLE_RATE_HZ / 10 / 1000;
+
+enum Mode { MODE_BEAT, MODE_FFT, MODE_FFT_UNO, MODE_FFT_BEAT, MODE_COUNT };
+const char* const kModeNames[MODE_COUNT] = { "beat", "fft", "fft-uno", "fft+beat" };
+
+struct SessionResult {
+    bool settled;
+    bool wrong;
+    unsigned long timeToStableMs;
+    float errorBpm;
+};
+
+// ============================================
+// MAX30100 library heart-rate path
+// ============================================
+
+/**
+ * PulseOximeter::checkSample() up to getHeartRate(): the IR DC remover,
+ * the 6 Hz Butterworth low-pass on the inverted AC and BeatDetector, with
+ * the library's constants
+ */
+class LibraryBeatPath {
+public:
+    LibraryBeatPath()
+        : dcw_(0.0f)
+        , lpfState_(0.0f)
+        , state_(STATE_INIT)
+        , threshold_(kMinThreshold)
+        , beatPeriod_(0.0f)
+        , lastMaxValue_(0.0f)
+        , tsLastBeat_(0)
+    {
+    }
+
+    void addSample(uint16_t ir, unsigned long nowMs) {
+        float previous = dcw_;
+        dcw_ = static_cast<float>(ir) + 0.95f * dcw_;
+        float ac = dcw_ - previous;
+        float v0 = lpfState_;
+        lpfState_ = 2.452372752527856026e-1f * -ac + 0.50952544949442879485f * v0;
+        checkForBeat(v0 + lpfState_, nowMs);
+    }
+
+    float getRate() const { return beatPeriod_ != 0.0f ? 60000.0f / beatPeriod_ : 0.0f; }
+
+private:
+    enum State { STATE_INIT, STATE_WAITING, STATE_FOLLOWING_SLOPE, STATE_MAYBE_DETECTED, STATE_MASKING };
+
+    static const unsigned long kInitHoldoffMs = 2000;
+    static const unsigned long kMaskingHoldoffMs = 200;
+    static const unsigned long kInvalidReadoutDelayMs = 2000;
+    static const float kMinThreshold;
+    static const float kMaxThreshold;
+
+    float dcw_;
+    float lpfState_;
+    State state_;
+    float threshold_;
+    float beatPeriod_;
+    float lastMaxValue_;
+    unsigned long tsLastBeat_;
+
+    void checkForBeat(float sample, unsigned long nowMs) {
+        switch (state_) {
+            case STATE_INIT:
+                if (nowMs > kInitHoldoffMs) {
+                    state_ = STATE_WAITING;
+                }
+                break;
+            case STATE_WAITING:
+                if (sample > threshold_) {
+                    threshold_ = std::min(sample, kMaxThreshold);
+                    state_ = STATE_FOLLOWING_SLOPE;
+                }
+                if (nowMs - tsLastBeat_ > kInvalidReadoutDelayMs) {
+                    beatPeriod_ = 0.0f;
+                    lastMaxValue_ = 0.0f;
+                }
+                decreaseThreshold();
+                break;
+            case STATE_FOLLOWING_SLOPE:
+                if (sample < threshold_) {
+                    state_ = STATE_MAYBE_DETECTED;
+                } else {
+                    threshold_ = std::min(sample, kMaxThreshold);
+                }
+                break;
+            case STATE_MAYBE_DETECTED:
+                if (sample + 30.0f < threshold_) {
+                    lastMaxValue_ = sample;
+                    state_ = STATE_MASKING;
+                    float delta = static_cast<float>(nowMs - tsLastBeat_);
+                    if (delta > 0.0f) {
+                        beatPeriod_ = 0.6f * delta + 0.4f * beatPeriod_;
+                    }
+                    tsLastBeat_ = nowMs;
+                } else {
+                    state_ = STATE_FOLLOWING_SLOPE;
+                }
+                break;
+            case STATE_MASKING:
+                if (nowMs - tsLastBeat_ > kMaskingHoldoffMs) {
+                    state_ = STATE_WAITING;
+                }
+                decreaseThreshold();
+                break;
+        }
+    }
+
+    void decreaseThreshold() {
+        if (lastMaxValue_ > 0.0f && beatPeriod_ > 0.0f) {
+            threshold_ -= lastMaxValue_ * (1.0f - 0.3f) / (beatPeriod_ / 10.0f);
+        } else {
+            threshold_ *= 0.99f;
+        }
+        if (threshold_ < kMinThreshold) {
+            threshold_ = kMinThreshold;
+        }
+    }
+};
+
+const float LibraryBeatPath::kMinThreshold = 20.0f;
+const float LibraryBeatPath::kMaxThreshold = 800.0f;
+
+// ============================================
+// Synthetic sessions
+// ============================================
+
+/**
+ * IR of one finger placement: the pulse wave with a dicrotic second
+ * harmonic and a slow rate drift, plus (scaled by motionRatio times the
+ * pulse amplitude) finger pressure steps that relax over a second, short
+ * jerks and a 0.2-0.5 Hz sway, and sensor noise
+ */
+std::vector<uint16_t> synthesizeSession(std::mt19937& rng, float bpm, float amplitude, float motionRatio) {
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    std::uniform_real_distribution<double> sway(0.2, 0.5);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::normal_distribution<double> noise(0.0, 4.0);
+    const double motion = motionRatio * amplitude;
+    const double swayHz = sway(rng);
+    const double dc = 45000.0 + 5000.0 * unit(rng);
+    std::vector<uint16_t> out(kSessionMs / kSampleMs);
+    double phase = 0.0;
+    double pressure = 0.0;
+    double jerk = 0.0;
+    int jerkLeft = 0;
+    for (size_t i = 0; i < out.size(); ++i) {
+        double t = static_cast<double>(i) / FFT_BPM_SAMPLE_RATE_HZ;
+        double rate = bpm * (1.0 + 0.02 * std::sin(2.0 * M_PI * t / 20.0));
+        phase += 2.0 * M_PI * rate / 60.0 / FFT_BPM_SAMPLE_RATE_HZ;
+        double value = dc - amplitude * (std::sin(phase) + 0.4 * std::sin(2.0 * phase + 0.8));
+        if (motion > 0.0) {
+            if (chance(rng) < 1.0 / 150.0) {
+                pressure += motion * unit(rng);
+            }
+            pressure *= 0.99;
+            if (jerkLeft == 0 && chance(rng) < 1.0 / 300.0) {
+                jerk = motion * unit(rng);
+                jerkLeft = 20;
+            }
+            if (jerkLeft > 0) {
+                value += jerk * std::sin(M_PI * jerkLeft / 20.0);
+                jerkLeft--;
+            }
+            value += pressure + 0.6 * motion * std::sin(2.0 * M_PI * swayHz * t);
+        }
+        value += noise(rng);
+        out[i] = static_cast<uint16_t>(std::max(0.0, std::min(65535.0, value)));
+    }
+    return out;
+}
+
+/**
+ * Feed one mode's rate to a fresh bpmDebouncer over the samples; with a
+ * reference rate the first stable reading near it ends the session,
+ * without one the first stable reading does
+ */
+SessionResult runSession(Mode mode, const std::vector<uint16_t>& samples, float referenceBpm) {
+    LibraryBeatPath beat;
+    FftBpmEstimator<8> fft(FFT_BPM_SAMPLE_RATE_HZ, 4, FFT_BPM_HOP_MS * FFT_BPM_SAMPLE_RATE_HZ / 4 / 1000,
+                           BPM_MIN_VALID, BPM_MAX_VALID, FFT_BPM_MIN_AMPLITUDE, FFT_BPM_MIN_CONFIDENCE_PCT,
+                           FFT_BPM_MAX_MISSES);
+    FftBpmEstimator<6> fftUno(FFT_BPM_SAMPLE_RATE_HZ, 10, kUnoHop, BPM_MIN_VALID, BPM_MAX_VALID,
+                              FFT_BPM_MIN_AMPLITUDE, FFT_BPM_MIN_CONFIDENCE_PCT, FFT_BPM_MAX_MISSES);
+    ReadingDebouncer<float> debouncer(BPM_TOLERANCE, BPM_STABILITY_DURATION_MS, BPM_SAMPLE_INTERVAL_MS,
+                                      BPM_MIN_VALID, BPM_MAX_VALID);
+    SessionResult result = { false, false, 0, 0.0f };
+    for (size_t i = 0; i < samples.size() && !result.settled; ++i) {
+        unsigned long elapsedMs = static_cast<unsigned long>(i) * kSampleMs;
+        float rate = 0.0f;
+        switch (mode) {
+            case MODE_BEAT:
+                beat.addSample(samples[i], kBootMs + elapsedMs);
+                rate = beat.getRate();
+                break;
+            case MODE_FFT:
+                fft.addSample(samples[i]);
+                rate = fft.getBpm();
+                break;
+            case MODE_FFT_UNO:
+                fftUno.addSample(samples[i]);
+                rate = fftUno.getBpm();
+                break;
+            default:
+                beat.addSample(samples[i], kBootMs + elapsedMs);
+                fft.addSample(samples[i]);
+                rate = fft.getBpm() > 0.0f ? fft.getBpm() : beat.getRate();
+                break;
+        }
+        if (elapsedMs == 0 || elapsedMs % REPORTING_PERIOD_MS != 0) {
+            continue;
+        }
+        debouncer.update(rate, elapsedMs);
+        if (!debouncer.isStable()) {
+            continue;
+        }
+        float error = referenceBpm > 0.0f ? std::fabs(debouncer.getStableReading() - referenceBpm) : 0.0f;
+        if (error < BPM_TOLERANCE) {
+            result.settled = true;
+            result.timeToStableMs = elapsedMs;
+            result.errorBpm = error;
+        } else {
+            result.wrong = true;
+        }
+    }
+    return result;
+}
+
+void printHeader() {
+    std::printf("%-9s %8s %10s %8s %8s %8s %8s %9s\n", "mode", "sessions", "mean_ms", "p50_ms", "p95_ms", "never",
+                "wrong", "error_bpm");
+}
+
+void printSummary(const char* mode, const std::vector<SessionResult>& results) {
+    std::vector<unsigned long> times;
+    double error = 0.0;
+    size_t wrong = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].settled) {
+            times.push_back(results[i].timeToStableMs);
+            error += results[i].errorBpm;
+        }
+        if (results[i].wrong) {
+            wrong++;
+        }
+    }
+    std::sort(times.begin(), times.end());
+    double mean = 0.0;
+    for (size_t i = 0; i < times.size(); ++i) {
+        mean += static_cast<double>(times[i]);
+    }
+    double settled = static_cast<double>(times.size());
+    unsigned long p50 = times.empty() ? 0 : times[times.size() / 2];
+    unsigned long p95 = times.empty() ? 0 : times[std::min(times.size() - 1, times.size() * 95 / 100)];
+    double total = results.empty() ? 1.0 : static_cast<double>(results.size());
+    std::printf("%-9s %8zu %10.0f %8lu %8lu %7.1f%% %7.1f%% %9.2f\n", mode, results.size(),
+                times.empty() ? 0.0 : mean / settled, p50, p95, 100.0 * (results.size() - times.size()) / total,
+                100.0 * wrong / total, times.empty() ? 0.0 : error / settled);
+}
+
+// ============================================
+// Replay of recorded IR
+// ============================================
+
+bool replayFile(const char* path, float referenceBpm) {
+    FILE* file = std::fopen(path, "r");
+    if (file == NULL) {
+        std::fprintf(stderr, "Cannot read %s\n", path);
+        return false;
+    }
+    std::vector<uint16_t> samples;
+    char line[256];
+    while (std::fgets(line, sizeof(line), file) != NULL) {
+        char* end = NULL;
+        long value = std::strtol(line, &end, 10);
+        if (line[0] == '#' || end == line || value < 0 || value > 65535) {
+            continue;
+        }
+        samples.push_back(static_cast<uint16_t>(value));
+    }
+    std::fclose(file);
+
+    std::printf("%zu samples (%.1f s)\n", samples.size(), samples.size() * kSampleMs / 1000.0);
+    std::printf("%-9s %10s %9s\n", "mode", "stable_ms", "error_bpm");
+    for (int m = 0; m < MODE_COUNT; ++m) {
+        SessionResult result = runSession(static_cast<Mode>(m), samples, referenceBpm);
+        if (result.settled) {
+            std::printf("%-9s %10lu %9.2f\n", kModeNames[m], result.timeToStableMs, result.errorBpm);
+        } else {
+            std::printf("%-9s %10s %9s\n", kModeNames[m], "never", "-");
+        }
+    }
+    return true;
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--sessions N] [--seed N] [--motion RATIO]\n", program);
+    std::fprintf(stderr, "       %s --replay FILE [--bpm REFERENCE]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int sessions = 500;
+    uint32_t seed = 1;
+    float maxMotion = 4.0f;
+    float referenceBpm = 0.0f;
+    const char* replayPath = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessions = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--motion") == 0 && i + 1 < argc) {
+            maxMotion = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--bpm") == 0 && i + 1 < argc) {
+            referenceBpm = static_cast<float>(std::atof(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (replayPath != NULL) {
+        return replayFile(replayPath, referenceBpm) ? 0 : 1;
+    }
+    if (sessions <= 0 || maxMotion < 0.0f) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // Rate, pulse amplitude and motion (up to --motion times the pulse) drawn per session
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> bpm(50.0f, 150.0f);
+    std::uniform_real_distribution<float> amplitude(60.0f, 300.0f);
+    std::uniform_real_distribution<float> motion(0.0f, maxMotion);
+    std::vector<SessionResult> results[MODE_COUNT];
+    for (int s = 0; s < sessions; ++s) {
+        float sessionBpm = bpm(rng);
+        float sessionAmplitude = amplitude(rng);
+        float sessionMotion = motion(rng);
+        std::vector<uint16_t> samples = synthesizeSession(rng, sessionBpm, sessionAmplitude, sessionMotion);
+        for (int m = 0; m < MODE_COUNT; ++m) {
+            results[m].push_back(runSession(static_cast<Mode>(m), samples, sessionBpm));
+        }
+    }
+
+    printHeader();
+    for (int m = 0; m < MODE_COUNT; ++m) {
+        printSummary(kModeNames[m], results[m]);
+    }
+    return 0;
+}
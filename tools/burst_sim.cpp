@@ -0,0 +1,321 @@
+// ============================================
+// burst_sim - Single-ping vs burst-consensus height ranging
+// ============================================
+// Simulates height-meter stations (Gaussian echo noise plus occasional
+// stray echoes) and measures, per patient session, the time from stepping
+// on to a settled height, its error and the pings it took: once with one
+// ping per DEBOUNCE_SAMPLE_INTERVAL_MS and the 3 s debouncer, once with a
+// BurstRanger burst per BURST_INTERVAL_MS and the shorter burst window.
+//
+// With --replay, a recorded height_meter serial log is used instead: its
+// consecutive pings become the echoes of the bursts, sessions start
+// wherever the reading jumps to a new level, and the error is measured
+// against the session's first reading.
+//
+// Usage: burst_sim [--stations N] [--sessions N] [--seed N]
+//                  [--noise CM] [--stray P]
+//        burst_sim --replay LOG
+// ============================================
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "burst_ranger.h"
+#include "config.h"
+#include "height_debouncer.h"
+#include "trace_parser.h"
+
+namespace {
+
+const unsigned long kEmptyMs = 4000;      // platform empty between patients
+const unsigned long kSettleMs = 800;      // patient stepping on
+const unsigned long kSessionMs = 15000;   // patient standing still
+const int kEmptyCm = 0;                   // no echo from an empty platform
+const int kSessionJumpCm = 10;            // replay: a jump this large starts a session
+
+struct SessionResult {
+    bool settled;
+    unsigned long timeToStableMs;
+    unsigned long pings;
+    float errorCm;
+};
+
+/**
+ * Echo model of one station; the random stream depends only on the seed
+ */
+class Sonar {
+public:
+    Sonar(uint32_t seed, float noiseCm, float strayProbability)
+        : rng_(seed)
+        , noise_(0.0f, noiseCm)
+        , stray_(strayProbability)
+        , strayDistance_(20, HEIGHT_MAX_DISTANCE_CM)
+        , pings_(0)
+    {
+    }
+
+    int ping(float distanceCm) {
+        pings_++;
+        if (stray_(rng_)) {
+            return strayDistance_(rng_);
+        }
+        if (distanceCm <= 0.0f) {
+            return kEmptyCm;
+        }
+        return static_cast<int>(std::lround(distanceCm + noise_(rng_)));
+    }
+
+    unsigned long getPings() const { return pings_; }
+
+private:
+    std::mt19937 rng_;
+    std::normal_distribution<float> noise_;
+    std::bernoulli_distribution stray_;
+    std::uniform_int_distribution<int> strayDistance_;
+    unsigned long pings_;
+};
+
+/**
+ * Distance seen at time t of a session that starts at arrivalMs
+ */
+float sessionDistance(float heightCm, unsigned long arrivalMs, unsigned long t) {
+    if (t < arrivalMs) {
+        return 0.0f;
+    }
+    return t - arrivalMs >= kSettleMs ? heightCm : heightCm * static_cast<float>(t - arrivalMs) / kSettleMs;
+}
+
+void simulateStation(uint32_t seed, float noiseCm, float stray, int sessions, bool burst,
+                     std::vector<SessionResult>& out) {
+    std::mt19937 heights(seed ^ 0x9E3779B9u);
+    std::uniform_real_distribution<float> height(100.0f, 195.0f);
+    Sonar sonar(seed, noiseCm, stray);
+    HeightDebouncer debouncer = burst
+        ? HeightDebouncer(DEBOUNCE_TOLERANCE_CM, BURST_STABILITY_DURATION_MS, BURST_INTERVAL_MS)
+        : HeightDebouncer();
+    BurstRanger ranger;
+    unsigned long period = burst ? BURST_INTERVAL_MS : DEBOUNCE_SAMPLE_INTERVAL_MS;
+
+    unsigned long t = 0;
+    for (int s = 0; s < sessions; ++s) {
+        float heightCm = height(heights);
+        unsigned long arrivalMs = t + kEmptyMs;
+        unsigned long endMs = arrivalMs + kSettleMs + kSessionMs;
+        unsigned long pingsAtArrival = 0;
+        bool arrived = false;
+        SessionResult result = { false, 0, 0, 0.0f };
+
+        for (; t < endMs; t += period) {
+            if (!arrived && t >= arrivalMs) {
+                arrived = true;
+                pingsAtArrival = sonar.getPings();
+            }
+            int reading;
+            unsigned long readingMs = t;
+            if (burst) {
+                // The sketch paces bursts, so the consensus is reported at the end of the period
+                unsigned long pingMs = t;
+                ranger.begin();
+                while (!ranger.addEcho(sonar.ping(sessionDistance(heightCm, arrivalMs, pingMs)))) {
+                    pingMs += BURST_PING_GAP_MS;
+                }
+                if (!ranger.hasConsensus()) {
+                    continue;
+                }
+                reading = ranger.getConsensus();
+                readingMs = t + period;
+            } else {
+                reading = sonar.ping(sessionDistance(heightCm, arrivalMs, readingMs));
+            }
+            debouncer.update(reading, readingMs);
+            if (arrived && !result.settled && debouncer.isStable() &&
+                std::abs(debouncer.getStableReading() - static_cast<int>(heightCm)) < kSessionJumpCm) {
+                result.settled = true;
+                result.timeToStableMs = readingMs - arrivalMs;
+                result.pings = sonar.getPings() - pingsAtArrival;
+                result.errorCm = std::fabs(static_cast<float>(debouncer.getStableReading()) - heightCm);
+            }
+        }
+        out.push_back(result);
+    }
+}
+
+void printSummary(const char* mode, const std::vector<SessionResult>& results) {
+    std::vector<unsigned long> times;
+    double pings = 0.0;
+    double error = 0.0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].settled) {
+            times.push_back(results[i].timeToStableMs);
+            pings += static_cast<double>(results[i].pings);
+            error += results[i].errorCm;
+        }
+    }
+    std::sort(times.begin(), times.end());
+    double mean = 0.0;
+    for (size_t i = 0; i < times.size(); ++i) {
+        mean += static_cast<double>(times[i]);
+    }
+    double settled = static_cast<double>(times.size());
+    unsigned long p50 = times.empty() ? 0 : times[times.size() / 2];
+    unsigned long p95 = times.empty() ? 0 : times[std::min(times.size() - 1, times.size() * 95 / 100)];
+    double never = results.empty() ? 0.0 : 100.0 * (results.size() - times.size()) / results.size();
+    std::printf("%-7s %8zu %10.0f %8lu %8lu %9.1f%% %8.1f %9.2f\n", mode, results.size(),
+                times.empty() ? 0.0 : mean / settled, p50, p95, never, times.empty() ? 0.0 : pings / settled,
+                times.empty() ? 0.0 : error / settled);
+}
+
+void printHeader() {
+    std::printf("%-7s %8s %10s %8s %8s %10s %8s %9s\n", "mode", "sessions", "mean_ms", "p50_ms", "p95_ms", "never",
+                "pings", "error_cm");
+}
+
+// ============================================
+// Replay of a recorded log
+// ============================================
+
+class HeightCollector : public TraceSampleSink {
+public:
+    virtual void onSample(const TraceSample& sample) {
+        if (sample.channel == CHANNEL_HEIGHT) {
+            readings.push_back(static_cast<int>(sample.value));
+            times.push_back(sample.timeMs);
+        }
+    }
+
+    std::vector<int> readings;
+    std::vector<unsigned long> times;
+};
+
+/**
+ * Sessions of a log: from each jump to a new level that holds for the next
+ * reading (a lone stray echo does not start one) to the next such jump
+ */
+void replaySessions(const HeightCollector& log, bool burst, std::vector<SessionResult>& out) {
+    HeightDebouncer debouncer = burst
+        ? HeightDebouncer(DEBOUNCE_TOLERANCE_CM, BURST_STABILITY_DURATION_MS, BURST_INTERVAL_MS)
+        : HeightDebouncer();
+    BurstRanger ranger;
+    size_t n = log.readings.size();
+    size_t sessionStart = 0;
+    int level = n > 0 ? log.readings[0] : 0;
+    SessionResult result = { false, 0, 0, 0.0f };
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0 && i + 1 < n && std::abs(log.readings[i] - level) >= kSessionJumpCm &&
+            std::abs(log.readings[i + 1] - log.readings[i]) <= DEBOUNCE_TOLERANCE_CM) {
+            out.push_back(result);
+            result = SessionResult();
+            sessionStart = i;
+            level = log.readings[i];
+        }
+        if (burst) {
+            if (ranger.isComplete()) {
+                ranger.begin();
+            }
+            if (!ranger.addEcho(log.readings[i]) || !ranger.hasConsensus()) {
+                continue;
+            }
+            debouncer.update(ranger.getConsensus(), log.times[i]);
+        } else {
+            debouncer.update(log.readings[i], log.times[i]);
+        }
+        if (!result.settled && debouncer.isStable()) {
+            result.settled = true;
+            result.timeToStableMs = log.times[i] - log.times[sessionStart];
+            result.pings = i - sessionStart + 1;
+            result.errorCm = static_cast<float>(std::abs(debouncer.getStableReading() - level));
+        }
+    }
+    if (n > 0) {
+        out.push_back(result);
+    }
+}
+
+bool replayLog(const char* path) {
+    FILE* file = std::fopen(path, "rb");
+    if (file == NULL) {
+        std::fprintf(stderr, "Cannot read %s\n", path);
+        return false;
+    }
+    HeightCollector log;
+    TraceParser parser(&log, 0);
+    char buffer[65536];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        parser.feed(buffer, n);
+    }
+    parser.finish();
+    std::fclose(file);
+
+    std::vector<SessionResult> single;
+    std::vector<SessionResult> burst;
+    replaySessions(log, false, single);
+    replaySessions(log, true, burst);
+    std::printf("%zu pings\n", log.readings.size());
+    printHeader();
+    printSummary("single", single);
+    printSummary("burst", burst);
+    return true;
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--stations N] [--sessions N] [--seed N] [--noise CM] [--stray P]\n", program);
+    std::fprintf(stderr, "       %s --replay LOG\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned long stations = 1000;
+    int sessions = 20;
+    uint32_t seed = 1;
+    float maxNoise = 1.0f;
+    float stray = 0.03f;
+    const char* replayPath = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--stations") == 0 && i + 1 < argc) {
+            stations = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessions = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--noise") == 0 && i + 1 < argc) {
+            maxNoise = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--stray") == 0 && i + 1 < argc) {
+            stray = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (replayPath != NULL) {
+        return replayLog(replayPath) ? 0 : 1;
+    }
+    if (stations == 0 || sessions <= 0 || maxNoise <= 0.0f || stray < 0.0f || stray >= 1.0f) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // Echo noise spread uniformly from a tenth of --noise up to it
+    std::mt19937 fleet(seed);
+    std::uniform_real_distribution<float> noise(0.1f * maxNoise, maxNoise);
+    std::vector<SessionResult> single;
+    std::vector<SessionResult> burst;
+    for (unsigned long s = 0; s < stations; ++s) {
+        float noiseCm = noise(fleet);
+        uint32_t stationSeed = static_cast<uint32_t>(fleet());
+        simulateStation(stationSeed, noiseCm, stray, sessions, false, single);
+        simulateStation(stationSeed, noiseCm, stray, sessions, true, burst);
+    }
+
+    printHeader();
+    printSummary("single", single);
+    printSummary("burst", burst);
+    return 0;
+}
@@ -0,0 +1,181 @@
+// ============================================
+// debounce_trace - Decode a debouncer trace ring into a timeline
+// ============================================
+// Reads the ring file a process created with debounceTraceAttach() and
+// prints each recorded decision, oldest first. The ring can be read, and
+// tracing switched on or off, while the process is running.
+//
+// Usage: debounce_trace [--enable | --disable] [--follow] [--last N]
+//                       [--summary] RING_FILE
+// ============================================
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <vector>
+#include "debounce_trace.h"
+
+namespace {
+
+/**
+ * Names debouncer instances d0, d1, ... in order of first appearance
+ */
+class SourceNames {
+public:
+    unsigned long idFor(uint64_t source) {
+        std::map<uint64_t, unsigned long>::iterator it = ids_.find(source);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+        unsigned long id = static_cast<unsigned long>(ids_.size());
+        ids_[source] = id;
+        order_.push_back(source);
+        return id;
+    }
+
+    const std::vector<uint64_t>& sources() const { return order_; }
+
+private:
+    std::map<uint64_t, unsigned long> ids_;
+    std::vector<uint64_t> order_;
+};
+
+struct Timeline {
+    SourceNames names;
+    std::map<uint64_t, uint64_t> lastTimeBySource;
+    unsigned long eventCounts[DEBOUNCE_TRACE_EVENT_COUNT];
+    uint64_t expectedIndex;
+    uint64_t dropped;
+
+    Timeline() : expectedIndex(0), dropped(0) {
+        std::memset(eventCounts, 0, sizeof(eventCounts));
+    }
+};
+
+void printEntries(const std::vector<DebounceTraceEntry>& entries, Timeline& timeline, bool quiet) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const DebounceTraceEntry& entry = entries[i];
+        if (entry.index > timeline.expectedIndex) {
+            // Overwritten before we read them, or torn by a concurrent writer
+            uint64_t missed = entry.index - timeline.expectedIndex;
+            timeline.dropped += missed;
+            if (!quiet) {
+                std::printf("%12s  ... %llu record(s) lost ...\n", "",
+                            static_cast<unsigned long long>(missed));
+            }
+        }
+        timeline.expectedIndex = entry.index + 1;
+        if (entry.event < DEBOUNCE_TRACE_EVENT_COUNT) {
+            timeline.eventCounts[entry.event]++;
+        }
+
+        unsigned long id = timeline.names.idFor(entry.source);
+        std::map<uint64_t, uint64_t>::iterator last = timeline.lastTimeBySource.find(entry.source);
+        long long delta = last != timeline.lastTimeBySource.end()
+                              ? static_cast<long long>(entry.timeMs - last->second) : 0;
+        timeline.lastTimeBySource[entry.source] = entry.timeMs;
+        if (quiet) {
+            continue;
+        }
+        std::printf("%12llu  d%-6lu %-16s %10.2f  +%lldms\n", static_cast<unsigned long long>(entry.timeMs), id,
+                    debounceTraceEventName(entry.event), entry.reading, delta);
+    }
+}
+
+void printSummary(const Timeline& timeline) {
+    std::printf("\nDebouncers:\n");
+    const std::vector<uint64_t>& sources = timeline.names.sources();
+    for (size_t i = 0; i < sources.size(); ++i) {
+        std::printf("  d%-6lu 0x%llx\n", static_cast<unsigned long>(i),
+                    static_cast<unsigned long long>(sources[i]));
+    }
+    std::printf("Events:\n");
+    for (int event = 0; event < DEBOUNCE_TRACE_EVENT_COUNT; ++event) {
+        std::printf("  %-16s %lu\n", debounceTraceEventName(static_cast<uint8_t>(event)),
+                    timeline.eventCounts[event]);
+    }
+    if (timeline.dropped > 0) {
+        std::printf("Lost: %llu record(s)\n", static_cast<unsigned long long>(timeline.dropped));
+    }
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--enable | --disable] [--follow] [--last N] [--summary] RING_FILE\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int setEnabled = -1;
+    bool follow = false;
+    bool summaryOnly = false;
+    unsigned long last = 0;
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--enable") == 0) {
+            setEnabled = 1;
+        } else if (std::strcmp(argv[i], "--disable") == 0) {
+            setEnabled = 0;
+        } else if (std::strcmp(argv[i], "--follow") == 0) {
+            follow = true;
+        } else if (std::strcmp(argv[i], "--summary") == 0) {
+            summaryOnly = true;
+        } else if (std::strcmp(argv[i], "--last") == 0 && i + 1 < argc) {
+            last = std::strtoul(argv[++i], NULL, 10);
+        } else if (argv[i][0] == '-' || path != NULL) {
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    DebounceTraceMapping mapping;
+    if (!mapping.open(path, 0)) {
+        std::fprintf(stderr, "%s: not a debounce trace ring\n", path);
+        return 1;
+    }
+    DebounceTraceRingHeader* ring = mapping.header();
+
+    if (setEnabled >= 0) {
+        ring->enabled.store(static_cast<uint32_t>(setEnabled), std::memory_order_relaxed);
+        std::printf("Tracing %s (%u-record ring, %llu recorded so far)\n", setEnabled ? "enabled" : "disabled",
+                    ring->capacity, static_cast<unsigned long long>(ring->head.load()));
+        return 0;
+    }
+
+    Timeline timeline;
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t from = (last != 0 && head > last) ? head - last : 0;
+    // Records older than the ring can hold were never readable; don't report them lost
+    if (head > ring->capacity && from < head - ring->capacity) {
+        from = head - ring->capacity;
+    }
+    timeline.expectedIndex = from;
+
+    if (!summaryOnly) {
+        std::printf("%12s  %-7s %-16s %10s  %s\n", "time_ms", "source", "event", "reading", "since-prev");
+    }
+    std::vector<DebounceTraceEntry> entries;
+    do {
+        entries.clear();
+        from = debounceTraceSnapshot(ring, from, entries);
+        printEntries(entries, timeline, summaryOnly);
+        std::fflush(stdout);
+        if (follow) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+    } while (follow);
+
+    printSummary(timeline);
+    return 0;
+}
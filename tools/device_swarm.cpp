@@ -0,0 +1,108 @@
+// ============================================
+// device_swarm - Virtual instrument load generator
+// ============================================
+// Simulates many height meters and pulse oximeters on one thread and
+// writes their serial traffic to a file or stdout for ingestion tests.
+//
+// Usage: device_swarm [--height N] [--oximeter N] [--duration-ms MS]
+//                     [--binary] [--height-interval-ms MS]
+//                     [--report-period-ms MS] [--seed N] [--output FILE]
+// ============================================
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "device_swarm.h"
+
+namespace {
+
+class FileSink : public SwarmSink {
+public:
+    explicit FileSink(std::FILE* file) : file_(file) {}
+
+    void onData(uint32_t, unsigned long, const uint8_t* data, size_t length) override {
+        std::fwrite(data, 1, length, file_);
+    }
+
+private:
+    std::FILE* file_;
+};
+
+void printUsage(const char* program) {
+    std::fprintf(stderr,
+                 "Usage: %s [--height N] [--oximeter N] [--duration-ms MS] [--binary]\n"
+                 "          [--height-interval-ms MS] [--report-period-ms MS] [--seed N] [--output FILE]\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SwarmOptions options;
+    options.heightMeters = 50000;
+    options.pulseOximeters = 50000;
+    unsigned long durationMs = 60000;
+    const char* outputPath = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--height") == 0 && hasValue) {
+            options.heightMeters = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--oximeter") == 0 && hasValue) {
+            options.pulseOximeters = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--duration-ms") == 0 && hasValue) {
+            durationMs = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--binary") == 0) {
+            options.protocol = SWARM_PROTOCOL_BINARY;
+        } else if (std::strcmp(argv[i], "--height-interval-ms") == 0 && hasValue) {
+            options.heightSampleIntervalMs = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--report-period-ms") == 0 && hasValue) {
+            options.oximeterReportPeriodMs = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::FILE* output = nullptr;
+    if (outputPath != nullptr) {
+        output = std::strcmp(outputPath, "-") == 0 ? stdout : std::fopen(outputPath, "wb");
+        if (output == nullptr) {
+            std::perror(outputPath);
+            return 1;
+        }
+    }
+    FileSink fileSink(output);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    DeviceSwarm swarm(options, output != nullptr ? &fileSink : nullptr);
+    double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    swarm.run(durationMs);
+    double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (output != nullptr && output != stdout) {
+        std::fclose(output);
+    }
+
+    std::fprintf(stderr, "Devices: %lu (%u height, %u oximeter), protocol: %s\n",
+                 static_cast<unsigned long>(swarm.getDeviceCount()), options.heightMeters,
+                 options.pulseOximeters, options.protocol == SWARM_PROTOCOL_BINARY ? "binary" : "text");
+    std::fprintf(stderr, "Virtual time: %lu ms, wall time: %.3f s (+%.3f s setup)\n", durationMs, runSeconds,
+                 setupSeconds);
+    std::fprintf(stderr, "Messages: %lu, bytes: %llu, resumes: %lu\n", swarm.getMessagesSent(),
+                 static_cast<unsigned long long>(swarm.getBytesSent()), swarm.getResumeCount());
+    if (runSeconds > 0.0) {
+        std::fprintf(stderr, "Rate: %.0f messages/s, %.1f MiB/s, %.1fx real time\n",
+                     static_cast<double>(swarm.getMessagesSent()) / runSeconds,
+                     static_cast<double>(swarm.getBytesSent()) / runSeconds / (1024.0 * 1024.0),
+                     static_cast<double>(durationMs) / 1000.0 / runSeconds);
+    }
+    return 0;
+}
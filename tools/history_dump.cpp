@@ -0,0 +1,167 @@
+// ============================================
+// history_dump - Decode history ring dumps captured from the serial port
+// ============================================
+// Scans a serial capture for HistoryRing bulk dumps (any text or frames
+// around them are skipped), verifies them and prints every recovered
+// sample as CSV, or writes it as SampleFrames so the gap can be backfilled
+// through the binary ingestion path.
+//
+// Usage: history_dump CAPTURE [--kind height|oximeter] [--frames OUT]
+// ============================================
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "history_ring.h"
+#include "sample_frame.h"
+#include "trace_sample.h"
+
+namespace {
+
+const char* kChannelNames[SAMPLE_CHANNEL_COUNT] = { "height", "bpm", "spo2" };
+
+/**
+ * Turns decoded samples into CSV rows or frames
+ */
+class SampleWriter {
+public:
+    SampleWriter(const uint8_t* channelMap, uint8_t channels, FILE* frames)
+        : channelMap_(channelMap)
+        , channels_(channels)
+        , frames_(frames)
+        , deviceId_(0)
+        , stableMask_(0)
+        , samples_(0)
+    {
+    }
+
+    void beginDump(uint32_t deviceId) {
+        deviceId_ = deviceId;
+        stableMask_ = 0;   // the oldest block may start mid-session; unknown until a marker
+    }
+
+    void onHistorySample(const HistorySample& sample) {
+        stableMask_ = static_cast<uint8_t>((stableMask_ | sample.stableMask) & ~sample.unstableMask);
+        for (uint8_t c = 0; c < channels_; ++c) {
+            bool stable = (stableMask_ >> c) & 1;
+            if (frames_ != NULL) {
+                SampleFrame frame;
+                frame.deviceId = deviceId_;
+                frame.timeMs = sample.timeMs;
+                frame.valueHundredths = static_cast<uint16_t>(sample.values[c] * 100);
+                frame.channel = channelMap_[c];
+                frame.stable = stable;
+                frame.valid = true;
+                uint8_t bytes[SAMPLE_FRAME_SIZE];
+                encodeSampleFrame(frame, bytes);
+                std::fwrite(bytes, 1, sizeof(bytes), frames_);
+            } else {
+                std::printf("%u,%u,%s,%d,%d\n", deviceId_, sample.timeMs, kChannelNames[channelMap_[c]],
+                            sample.values[c], stable ? 1 : 0);
+            }
+        }
+        samples_++;
+    }
+
+    unsigned long getSamples() const { return samples_; }
+
+private:
+    const uint8_t* channelMap_;
+    uint8_t channels_;
+    FILE* frames_;
+    uint32_t deviceId_;
+    uint8_t stableMask_;
+    unsigned long samples_;
+};
+
+bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* file = std::fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out.insert(out.end(), buffer, buffer + n);
+    }
+    std::fclose(file);
+    return true;
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s CAPTURE [--kind height|oximeter] [--frames OUT]\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    const char* capturePath = argv[1];
+    const char* framesPath = NULL;
+    bool oximeter = false;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--kind") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "oximeter") == 0) {
+                oximeter = true;
+            } else if (std::strcmp(argv[i], "height") != 0) {
+                printUsage(argv[0]);
+                return 2;
+            }
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            framesPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<uint8_t> capture;
+    if (!readFile(capturePath, capture)) {
+        std::fprintf(stderr, "Cannot read %s\n", capturePath);
+        return 1;
+    }
+    FILE* frames = NULL;
+    if (framesPath != NULL && (frames = std::fopen(framesPath, "wb")) == NULL) {
+        std::fprintf(stderr, "Cannot write %s\n", framesPath);
+        return 1;
+    }
+
+    static const uint8_t kHeightChannels[] = { CHANNEL_HEIGHT };
+    static const uint8_t kOximeterChannels[] = { CHANNEL_BPM, CHANNEL_SPO2 };
+    uint8_t channels = oximeter ? 2 : 1;
+    SampleWriter writer(oximeter ? kOximeterChannels : kHeightChannels, channels, frames);
+    if (frames == NULL) {
+        std::printf("device,time_ms,channel,value,stable\n");
+    }
+
+    unsigned long dumps = 0;
+    unsigned long badBlocks = 0;
+    size_t pos = 0;
+    while (pos < capture.size()) {
+        HistoryDumpInfo info;
+        if (capture[pos] != HISTORY_DUMP_SYNC ||
+            !decodeHistoryDump(&capture[pos], capture.size() - pos, &info) || info.channels != channels) {
+            pos++;
+            continue;
+        }
+        writer.beginDump(info.deviceId);
+        for (uint8_t b = 0; b < info.blockCount; ++b) {
+            if (decodeHistoryBlock(info.blocks + static_cast<size_t>(b) * info.blockSize, info.blockSize,
+                                   info.channels, info.sampleIntervalMs, writer) < 0) {
+                badBlocks++;
+            }
+        }
+        dumps++;
+        pos += historyDumpSize(&capture[pos], capture.size() - pos);
+    }
+
+    if (frames != NULL) {
+        std::fclose(frames);
+    }
+    std::fprintf(stderr, "%lu dumps, %lu samples, %lu malformed blocks\n", dumps, writer.getSamples(), badBlocks);
+    return dumps > 0 ? 0 : 1;
+}
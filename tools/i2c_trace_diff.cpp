@@ -0,0 +1,111 @@
+// ============================================
+// i2c_trace_diff - Compare the bus traffic of two firmware runs
+// ============================================
+// Reads two traces recorded by oximeter_host (base and candidate firmware)
+// and reports transactions and bytes per loop, overall and per address.
+// With --max-increase, exits non-zero when the candidate's bytes per loop
+// grew by more than the given percentage (for use as a CI gate).
+//
+// Usage: i2c_trace_diff [--max-increase PCT] BASE_TRACE NEW_TRACE
+// ============================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include "i2c_trace.h"
+
+namespace {
+
+double perLoop(unsigned long long value, unsigned long loops) {
+    return loops > 0 ? static_cast<double>(value) / static_cast<double>(loops) : 0.0;
+}
+
+double percentChange(double base, double candidate) {
+    return base > 0.0 ? (candidate - base) * 100.0 / base : (candidate > 0.0 ? 100.0 : 0.0);
+}
+
+void printRow(const char* label, double base, double candidate) {
+    std::printf("%-24s %12.2f %12.2f %+12.2f %+8.1f%%\n", label, base, candidate, candidate - base,
+                percentChange(base, candidate));
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--max-increase PCT] BASE_TRACE NEW_TRACE\n", program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double maxIncrease = -1.0;
+    const char* paths[2] = { NULL, NULL };
+    int pathCount = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--max-increase") == 0 && i + 1 < argc) {
+            maxIncrease = std::atof(argv[++i]);
+        } else if (argv[i][0] != '-' && pathCount < 2) {
+            paths[pathCount++] = argv[i];
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (pathCount != 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    I2cTraceStats stats[2];
+    for (int t = 0; t < 2; ++t) {
+        I2cTrace trace;
+        if (!trace.load(paths[t])) {
+            std::fprintf(stderr, "Failed to load trace %s\n", paths[t]);
+            return 1;
+        }
+        stats[t].compute(trace);
+    }
+    const I2cTraceStats& base = stats[0];
+    const I2cTraceStats& candidate = stats[1];
+
+    std::printf("%-24s %12s %12s %12s %9s\n", "", "base", "new", "delta", "change");
+    printRow("loops", base.loops, candidate.loops);
+    printRow("setup transactions", base.setup.transactions, candidate.setup.transactions);
+    printRow("setup bytes", static_cast<double>(base.setup.bytes), static_cast<double>(candidate.setup.bytes));
+    printRow("transactions/loop", base.getTransactionsPerLoop(), candidate.getTransactionsPerLoop());
+    printRow("bytes/loop", base.getBytesPerLoop(), candidate.getBytesPerLoop());
+    printRow("bus bits/loop", base.getBusBitsPerLoop(), candidate.getBusBitsPerLoop());
+    printRow("max transactions/loop", base.maxLoopTransactions, candidate.maxLoopTransactions);
+    printRow("max bytes/loop", static_cast<double>(base.maxLoopBytes), static_cast<double>(candidate.maxLoopBytes));
+
+    // Per address, over the union of addresses seen in either run
+    std::map<uint8_t, bool> addresses;
+    for (int t = 0; t < 2; ++t) {
+        for (std::map<uint8_t, I2cAddressStats>::const_iterator it = stats[t].byAddress.begin();
+             it != stats[t].byAddress.end(); ++it) {
+            addresses[it->first] = true;
+        }
+    }
+    for (std::map<uint8_t, bool>::const_iterator it = addresses.begin(); it != addresses.end(); ++it) {
+        I2cAddressStats empty = { 0, 0, 0 };
+        std::map<uint8_t, I2cAddressStats>::const_iterator b = base.byAddress.find(it->first);
+        std::map<uint8_t, I2cAddressStats>::const_iterator c = candidate.byAddress.find(it->first);
+        const I2cAddressStats& baseAddress = b != base.byAddress.end() ? b->second : empty;
+        const I2cAddressStats& candidateAddress = c != candidate.byAddress.end() ? c->second : empty;
+
+        char label[32];
+        std::snprintf(label, sizeof(label), "0x%02x transactions/loop", it->first);
+        printRow(label, perLoop(baseAddress.transactions, base.loops),
+                 perLoop(candidateAddress.transactions, candidate.loops));
+        std::snprintf(label, sizeof(label), "0x%02x bytes/loop", it->first);
+        printRow(label, perLoop(baseAddress.bytes, base.loops), perLoop(candidateAddress.bytes, candidate.loops));
+    }
+
+    if (maxIncrease >= 0.0) {
+        double change = percentChange(base.getBytesPerLoop(), candidate.getBytesPerLoop());
+        if (change > maxIncrease) {
+            std::printf("FAIL: bytes/loop grew %.1f%% (limit %.1f%%)\n", change, maxIncrease);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,252 @@
+// ============================================
+// multi_head_sim - Multi-head height station on the host simulator
+// ============================================
+// Runs 1-4 simulated HC-SR04 heads over a patient session two ways:
+//   naive      loop() { delay(100); ping_cm() each head in turn; }
+//   scheduled  UltrasonicScheduler slots with the crosstalk guard
+// and reports the fused sample rate, the share of head readings cut short
+// by crosstalk, and when the fused HeightDebouncer settled.
+//
+// Usage: multi_head_sim [--heads N] [--duration-ms N] [--seed N]
+//                       [--noise CM] [--guard-us N] [--ring-down-us N]
+//                       [--pairs]   (heads 0/1 and 2/3 cannot hear each other)
+// ============================================
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Arduino.h"
+#include "config.h"
+#include "height_debouncer.h"
+#include "host_devices.h"
+#include "ultrasonic_scheduler.h"
+
+namespace {
+
+const unsigned long kArrivalMs = 1000;      // patient steps under the heads
+const float kHeadDistanceCm = 62.0f;        // sensor to the top of the head
+const unsigned long kPollUs = 100;          // loop() granularity of the scheduled run
+
+struct Options {
+    uint8_t heads;
+    unsigned long durationMs;
+    uint32_t seed;
+    float noiseCm;
+    unsigned long guardUs;
+    unsigned long ringDownUs;
+    bool pairs;
+};
+
+struct RunResult {
+    unsigned long frames;
+    unsigned long headReadings;
+    unsigned long crosstalkHits;
+    unsigned long stableAtMs;       // 0 if never
+    int stableCm;
+};
+
+/**
+ * NewPing's blocking ping_cm() for the naive loop: waits for the echo to
+ * fall, or for the maximum distance to pass
+ */
+class BlockingPing : public UltrasonicEchoSink {
+public:
+    explicit BlockingPing(SimulatedUltrasonicHeads& heads)
+        : heads_(heads), head_(0), high_(false), riseUs_(0), widthUs_(0), done_(false)
+    {
+    }
+
+    int ping(uint8_t head) {
+        head_ = head;
+        high_ = false;
+        done_ = false;
+        heads_.trigger(head);
+        unsigned long long deadline = hostClock().nowUs() + 1000 + ULTRASONIC_ECHO_TIMEOUT_US;
+        for (;;) {
+            heads_.deliverEdges(*this);
+            unsigned long long now = hostClock().nowUs();
+            if (done_ || now >= deadline) {
+                break;
+            }
+            unsigned long long next = heads_.nextEdgeUs();
+            hostClock().advanceUs((next > now && next < deadline ? next : deadline) - now);
+        }
+        if (!done_ || widthUs_ > ULTRASONIC_ECHO_TIMEOUT_US) {
+            return 0;
+        }
+        return static_cast<int>((widthUs_ + ULTRASONIC_ROUNDTRIP_US_PER_CM / 2) / ULTRASONIC_ROUNDTRIP_US_PER_CM);
+    }
+
+    virtual void onEchoEdge(uint8_t head, bool high, unsigned long nowUs) {
+        if (head != head_) {
+            return;   // other heads' pins are not being watched
+        }
+        if (high) {
+            high_ = true;
+            riseUs_ = nowUs;
+        } else if (high_) {
+            widthUs_ = nowUs - riseUs_;
+            done_ = true;
+        }
+    }
+
+private:
+    SimulatedUltrasonicHeads& heads_;
+    uint8_t head_;
+    bool high_;
+    unsigned long riseUs_;
+    unsigned long widthUs_;
+    bool done_;
+};
+
+void setupHeads(SimulatedUltrasonicHeads& heads, const Options& options) {
+    heads.setNoise(options.noiseCm);
+    heads.setRingDownUs(options.ringDownUs);
+    for (uint8_t h = 0; h < options.heads; ++h) {
+        heads.setDistance(h, 0.0f);
+        if (options.pairs) {
+            heads.setHears(h, static_cast<uint8_t>(0x0F & ~(0x3 << (h & ~1))));   // only the other pair
+        }
+    }
+}
+
+void updatePatient(SimulatedUltrasonicHeads& heads, const Options& options, bool arrived) {
+    for (uint8_t h = 0; h < options.heads; ++h) {
+        // Heads look at slightly different spots of the head
+        heads.setDistance(h, arrived ? kHeadDistanceCm + 0.5f * h : 0.0f);
+    }
+}
+
+void recordStable(const HeightDebouncer& debouncer, unsigned long nowMs, RunResult& result) {
+    if (result.stableAtMs == 0 && nowMs >= kArrivalMs && debouncer.isStable() && debouncer.getStableReading() > 0) {
+        result.stableAtMs = nowMs;
+        result.stableCm = debouncer.getStableReading();
+    }
+}
+
+RunResult runNaive(const Options& options) {
+    hostClock().reset();
+    SimulatedUltrasonicHeads heads(hostClock(), options.heads, options.seed);
+    setupHeads(heads, options);
+    BlockingPing sonar(heads);
+    HeightDebouncer debouncer;
+    RunResult result = { 0, 0, 0, 0, 0 };
+
+    while (millis() < options.durationMs) {
+        delay(DEBOUNCE_SAMPLE_INTERVAL_MS);
+        updatePatient(heads, options, millis() >= kArrivalMs);
+        int readings[ULTRASONIC_MAX_HEADS];
+        int count = 0;
+        for (uint8_t h = 0; h < options.heads; ++h) {
+            int distance = sonar.ping(h);
+            result.headReadings++;
+            if (distance > 0) {
+                readings[count++] = distance;
+            }
+        }
+        std::sort(readings, readings + count);
+        int fused = count == 0 ? 0 : ((count & 1) ? readings[count / 2]
+                                                   : (readings[count / 2 - 1] + readings[count / 2] + 1) / 2);
+        debouncer.update(fused, millis());
+        result.frames++;
+        recordStable(debouncer, millis(), result);
+    }
+    result.crosstalkHits = heads.getCrosstalkHits();
+    return result;
+}
+
+RunResult runScheduled(const Options& options) {
+    hostClock().reset();
+    SimulatedUltrasonicHeads heads(hostClock(), options.heads, options.seed);
+    setupHeads(heads, options);
+    UltrasonicSchedulerConfig config;
+    config.heads = options.heads;
+    config.guardUs = options.guardUs;
+    if (options.pairs) {
+        for (uint8_t h = 0; h < options.heads; ++h) {
+            config.hears[h] = static_cast<uint8_t>(0x0F & ~(0x3 << (h & ~1)));
+        }
+    }
+    UltrasonicScheduler scheduler(&heads, config);
+    HeightDebouncer debouncer;
+    RunResult result = { 0, 0, 0, 0, 0 };
+
+    scheduler.begin(micros());
+    while (millis() < options.durationMs) {
+        updatePatient(heads, options, millis() >= kArrivalMs);
+        heads.deliverEdges(scheduler);
+        if (scheduler.poll(micros())) {
+            UltrasonicFrame frame;
+            scheduler.takeFrame(frame);
+            debouncer.update(frame.fusedCm, frame.timeMs);
+            result.frames++;
+            result.headReadings += options.heads;
+            recordStable(debouncer, frame.timeMs, result);
+        }
+        // Next poll, or the next edge if it comes sooner
+        unsigned long long now = hostClock().nowUs();
+        unsigned long long next = heads.nextEdgeUs();
+        hostClock().advanceUs(next > now && next - now < kPollUs ? next - now : kPollUs);
+    }
+    result.crosstalkHits = heads.getCrosstalkHits();
+    std::printf("# %u heads in %u slots, frame %lu us\n", options.heads, scheduler.getSlotCount(),
+                scheduler.getFramePeriodUs());
+    return result;
+}
+
+void printResult(const char* mode, const RunResult& result, const Options& options) {
+    double seconds = static_cast<double>(options.durationMs) / 1000.0;
+    double crosstalk = result.headReadings == 0 ? 0.0 : 100.0 * result.crosstalkHits / result.headReadings;
+    if (result.stableAtMs != 0) {
+        std::printf("%-10s %10.1f %11.1f%% %12lu %9d\n", mode, result.frames / seconds, crosstalk,
+                    result.stableAtMs - kArrivalMs, result.stableCm);
+    } else {
+        std::printf("%-10s %10.1f %11.1f%% %12s %9s\n", mode, result.frames / seconds, crosstalk, "never", "-");
+    }
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr,
+                 "Usage: %s [--heads N] [--duration-ms N] [--seed N] [--noise CM] [--guard-us N] "
+                 "[--ring-down-us N] [--pairs]\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options = { 4, 10000, 1, 0.5f, ULTRASONIC_GUARD_US, 18000, false };
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--heads") == 0 && i + 1 < argc) {
+            options.heads = static_cast<uint8_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--duration-ms") == 0 && i + 1 < argc) {
+            options.durationMs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--noise") == 0 && i + 1 < argc) {
+            options.noiseCm = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--guard-us") == 0 && i + 1 < argc) {
+            options.guardUs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--ring-down-us") == 0 && i + 1 < argc) {
+            options.ringDownUs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--pairs") == 0) {
+            options.pairs = true;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.heads == 0 || options.heads > ULTRASONIC_MAX_HEADS || options.durationMs <= kArrivalMs ||
+        options.noiseCm < 0.0f) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    RunResult naive = runNaive(options);
+    RunResult scheduled = runScheduled(options);
+    std::printf("%-10s %10s %12s %12s %9s\n", "mode", "samples/s", "crosstalk", "settle_ms", "height");
+    printResult("naive", naive, options);
+    printResult("scheduled", scheduled, options);
+    return 0;
+}
@@ -0,0 +1,162 @@
+// ============================================
+// oximeter_host - Run pulse_oximeter.ino against the host HAL
+// ============================================
+// Builds the sketch with host versions of Wire, the display libraries and
+// the MAX30100 library, runs it on a virtual clock and records every I2C
+// transaction. The MAX30100 is either simulated from a scripted patient
+// or replayed from a captured trace, so two firmware versions see the
+// same sensor data and their traces differ only by the firmware's own
+// bus traffic (compare them with i2c_trace_diff). --dump-at sends the
+// history dump request at that time; the dump goes to stdout with the
+// rest of the serial output, ready for history_dump.
+//
+// Usage: oximeter_host [--display lcd|oled|none] [--duration-ms MS]
+//                      [--patient FROM_MS:BPM:SPO2]... [--replay TRACE]
+//                      [--record TRACE] [--loop-us US] [--dump-at MS] [--quiet]
+// ============================================
+
+#include <cstdlib>
+#include "Arduino.h"
+#include "Wire.h"
+#include "host_devices.h"
+
+#ifndef APPTECH_OXIMETER_SKETCH
+#define APPTECH_OXIMETER_SKETCH "../instruments/pulse_oximeter/pulse_oximeter.ino"
+#endif
+
+#include APPTECH_OXIMETER_SKETCH
+
+namespace {
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--display lcd|oled|none] [--duration-ms MS] [--patient FROM_MS:BPM:SPO2]...\n"
+                         "          [--replay TRACE] [--record TRACE] [--loop-us US] [--dump-at MS] [--quiet]\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* display = "lcd";
+    unsigned long durationMs = 10000;
+    unsigned long loopUs = 50;
+    unsigned long dumpAtMs = 0;
+    bool dumpRequested = false;
+    const char* replayPath = NULL;
+    const char* recordPath = NULL;
+    bool quiet = false;
+    SimulatedMax30100 sensor(hostClock());
+    bool scripted = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--display") == 0 && i + 1 < argc) {
+            display = argv[++i];
+        } else if (std::strcmp(argv[i], "--duration-ms") == 0 && i + 1 < argc) {
+            durationMs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--patient") == 0 && i + 1 < argc) {
+            unsigned long fromMs = 0;
+            float bpm = 0.0f;
+            int spo2 = 0;
+            if (std::sscanf(argv[++i], "%lu:%f:%d", &fromMs, &bpm, &spo2) != 3) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            sensor.setPatient(fromMs, bpm, spo2);
+            scripted = true;
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--loop-us") == 0 && i + 1 < argc) {
+            loopUs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--dump-at") == 0 && i + 1 < argc) {
+            dumpAtMs = std::strtoul(argv[++i], NULL, 10);
+            dumpRequested = true;
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (!scripted) {
+        sensor.setPatient(0, 0.0f, 0);       // no finger at first
+        sensor.setPatient(3000, 72.0f, 97);  // then a steady patient
+    }
+
+    // Devices on the bus
+    I2cBus& bus = hostI2cBus();
+    I2cAckDevice lcd;
+    I2cAckDevice oled;
+    if (std::strcmp(display, "lcd") == 0) {
+        bus.attach(LCD_I2C_ADDRESS, &lcd);
+    } else if (std::strcmp(display, "oled") == 0) {
+        bus.attach(OLED_I2C_ADDRESS, &oled);
+    } else if (std::strcmp(display, "none") != 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    I2cTrace captured;
+    I2cReplayDevice* replay = NULL;
+    if (replayPath != NULL) {
+        if (!captured.load(replayPath)) {
+            std::fprintf(stderr, "Failed to load trace %s\n", replayPath);
+            return 1;
+        }
+        replay = new I2cReplayDevice(captured, MAX30100_I2C_ADDRESS);
+        if (replay->getResponseCount() == 0) {
+            std::fprintf(stderr, "Trace %s has no MAX30100 responses\n", replayPath);
+            delete replay;
+            return 1;
+        }
+        bus.attach(MAX30100_I2C_ADDRESS, replay);
+    } else {
+        bus.attach(MAX30100_I2C_ADDRESS, &sensor);
+    }
+
+    I2cTrace trace;
+    bus.setRecorder(&trace);
+    if (quiet) {
+        Serial.setOutput(NULL);
+    }
+
+    setup();
+    while (millis() < durationMs) {
+        bus.markLoop();
+        if (dumpRequested && millis() >= dumpAtMs) {
+            static const char kRequest[] = { HISTORY_DUMP_REQUEST, '\0' };
+            Serial.feed(kRequest);
+            dumpRequested = false;
+        }
+        loop();
+        hostClock().advanceUs(loopUs);   // the loop's own CPU time
+    }
+    std::fflush(stdout);
+
+    bool ok = true;
+    if (recordPath != NULL && !trace.save(recordPath)) {
+        std::fprintf(stderr, "Failed to write trace %s\n", recordPath);
+        ok = false;
+    }
+
+    I2cTraceStats stats;
+    stats.compute(trace);
+    std::fprintf(stderr, "Loops: %lu in %lu ms\n", stats.loops, durationMs);
+    std::fprintf(stderr, "Setup: %lu transactions, %llu bytes\n", stats.setup.transactions, stats.setup.bytes);
+    std::fprintf(stderr, "Loop: %.2f transactions, %.2f bytes per loop (max %lu / %llu)\n",
+                 stats.getTransactionsPerLoop(), stats.getBytesPerLoop(), stats.maxLoopTransactions,
+                 stats.maxLoopBytes);
+#if OXIMETER_HISTORY
+    std::fprintf(stderr, "History: %lu reports in %u of %u blocks (%lu bytes of RAM)\n", history.getSamplesAdded(),
+                 static_cast<unsigned>(history.getBlockCount()), static_cast<unsigned>(history.kBlockCount),
+                 static_cast<unsigned long>(sizeof(history)));
+#endif
+    if (replay != NULL) {
+        std::fprintf(stderr, "Replay: %lu of %lu responses used, %lu mismatched reads\n",
+                     static_cast<unsigned long>(replay->getResponseCount() - replay->getRemaining()),
+                     static_cast<unsigned long>(replay->getResponseCount()), replay->getMismatches());
+        delete replay;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// ============================================
+// stable_query - Historical stability queries against an interval index
+// ============================================
+// Answers questions like "was BPM stable below 60 between 10:00 and
+// 10:30?" from an index written by trace_replay --index, without
+// replaying the raw logs.
+//
+// Usage: stable_query INDEX DEVICE height|bpm|spo2 --at TIME_MS
+//        stable_query INDEX DEVICE height|bpm|spo2 --range FROM_MS TO_MS
+//                     [--below VALUE | --above VALUE] [--list]
+// ============================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "stable_interval_index.h"
+
+namespace {
+
+const char* kChannelNames[SAMPLE_CHANNEL_COUNT] = { "height", "bpm", "spo2" };
+
+bool parseChannel(const char* name, uint8_t& channel) {
+    for (uint8_t c = 0; c < SAMPLE_CHANNEL_COUNT; ++c) {
+        if (std::strcmp(name, kChannelNames[c]) == 0) {
+            channel = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+void printInterval(const StableInterval& interval) {
+    if (interval.endMs == STABLE_INTERVAL_OPEN) {
+        std::printf("%lu\topen\t%.2f\t%.2f\n", interval.startMs, interval.minValue, interval.maxValue);
+    } else {
+        std::printf("%lu\t%lu\t%.2f\t%.2f\n", interval.startMs, interval.endMs, interval.minValue,
+                    interval.maxValue);
+    }
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s INDEX DEVICE height|bpm|spo2 --at TIME_MS\n"
+                         "       %s INDEX DEVICE height|bpm|spo2 --range FROM_MS TO_MS\n"
+                         "          [--below VALUE | --above VALUE] [--list]\n",
+                 program, program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint8_t channel = 0;
+    if (argc < 5 || !parseChannel(argv[3], channel)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    uint32_t deviceId = static_cast<uint32_t>(std::strtoul(argv[2], NULL, 10));
+
+    bool stabbing = false;
+    bool listIntervals = false;
+    unsigned long fromMs = 0;
+    unsigned long toMs = 0;
+    const char* predicate = NULL;
+    float threshold = 0.0f;
+    for (int i = 4; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--at") == 0 && i + 1 < argc) {
+            stabbing = true;
+            fromMs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--range") == 0 && i + 2 < argc) {
+            fromMs = std::strtoul(argv[++i], NULL, 10);
+            toMs = std::strtoul(argv[++i], NULL, 10);
+        } else if ((std::strcmp(argv[i], "--below") == 0 || std::strcmp(argv[i], "--above") == 0) &&
+                   i + 1 < argc) {
+            predicate = argv[i] + 2;
+            threshold = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            listIntervals = true;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    StableIntervalIndex index;
+    if (!index.load(argv[1])) {
+        std::fprintf(stderr, "Failed to load index %s\n", argv[1]);
+        return 1;
+    }
+
+    if (stabbing) {
+        StableInterval interval;
+        if (!index.stab(deviceId, channel, fromMs, interval)) {
+            std::printf("unstable\n");
+            return 1;
+        }
+        printInterval(interval);
+        return 0;
+    }
+
+    if (predicate != NULL) {
+        bool answer = predicate[0] == 'b'
+                          ? index.wasStableBelow(deviceId, channel, fromMs, toMs, threshold)
+                          : index.wasStableAbove(deviceId, channel, fromMs, toMs, threshold);
+        std::printf("%s\n", answer ? "yes" : "no");
+        return answer ? 0 : 1;
+    }
+
+    StableIntervalSummary summary;
+    if (!index.summarize(deviceId, channel, fromMs, toMs, summary)) {
+        std::printf("never stable\n");
+        return 1;
+    }
+    std::printf("intervals: %lu, stable: %lu ms, min: %.2f, max: %.2f\n",
+                static_cast<unsigned long>(summary.intervals), summary.stableMs, summary.minValue,
+                summary.maxValue);
+    if (listIntervals) {
+        std::vector<StableInterval> intervals;
+        index.overlapping(deviceId, channel, fromMs, toMs, intervals);
+        for (size_t i = 0; i < intervals.size(); ++i) {
+            printInterval(intervals[i]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,205 @@
+// ============================================
+// tolerance_sim - Fleet simulation of adaptive debounce tolerance
+// ============================================
+// Simulates height-meter stations whose ultrasonic noise ranges from quiet
+// to badly worn, replays the same patient sessions through the debouncers
+// with the fixed DEBOUNCE_TOLERANCE_CM and with adaptive tolerance, and
+// reports time-to-stable, sessions that never stabilized and the error of
+// the stable reading, overall and per noise band.
+//
+// Usage: tolerance_sim [--stations N] [--sessions N] [--seed N]
+//                      [--min-noise CM] [--max-noise CM]
+// ============================================
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "config.h"
+#include "trace_replayer.h"
+
+namespace {
+
+const unsigned long kSampleMs = DEBOUNCE_SAMPLE_INTERVAL_MS;
+const unsigned long kEmptyMs = 4000;      // platform empty between patients
+const unsigned long kSettleMs = 800;      // patient stepping on
+const unsigned long kSessionMs = 20000;   // patient standing still
+
+const int kBandCount = 3;
+const char* kBandNames[kBandCount] = { "quiet", "medium", "noisy" };
+
+struct SessionResult {
+    int band;
+    bool stabilized;
+    unsigned long timeToStableMs;
+    float errorCm;
+};
+
+/**
+ * Captures the first stable reading of the current session
+ */
+class FirstStable : public StabilityTransitionSink {
+public:
+    FirstStable() : armed_(false), stabilized_(false), timeMs_(0), value_(0.0f) {}
+
+    void arm() {
+        armed_ = true;
+        stabilized_ = false;
+    }
+
+    void disarm() { armed_ = false; }
+
+    virtual void onTransition(const StabilityTransition& transition) {
+        if (armed_ && transition.stable && !stabilized_) {
+            stabilized_ = true;
+            timeMs_ = transition.timeMs;
+            value_ = transition.value;
+        }
+    }
+
+    bool stabilized() const { return stabilized_; }
+    unsigned long timeMs() const { return timeMs_; }
+    float value() const { return value_; }
+
+private:
+    bool armed_;
+    bool stabilized_;
+    unsigned long timeMs_;
+    float value_;
+};
+
+int bandFor(float noiseCm) {
+    return noiseCm < 0.5f ? 0 : (noiseCm < 1.2f ? 1 : 2);
+}
+
+/**
+ * One station's sessions; the random stream depends only on the seed
+ */
+void simulateStation(uint32_t seed, float noiseCm, int sessions, bool adaptive, std::vector<SessionResult>& out) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, noiseCm);
+    std::uniform_real_distribution<float> heights(100.0f, 195.0f);
+
+    FirstStable first;
+    TraceReplayer replayer(&first);
+    replayer.setAdaptiveTolerance(adaptive);
+
+    TraceSample sample;
+    sample.deviceId = seed;
+    sample.channel = CHANNEL_HEIGHT;
+    unsigned long t = 0;
+    for (int s = 0; s < sessions; ++s) {
+        float height = heights(rng);
+
+        first.disarm();
+        for (unsigned long end = t + kEmptyMs; t < end; t += kSampleMs) {
+            sample.timeMs = t;
+            sample.value = std::round(noise(rng));   // nobody on the platform
+            replayer.onSample(sample);
+        }
+
+        unsigned long arrivalMs = t;
+        first.arm();
+        for (unsigned long end = t + kSettleMs + kSessionMs; t < end; t += kSampleMs) {
+            float settled = t - arrivalMs >= kSettleMs ? 1.0f : static_cast<float>(t - arrivalMs) / kSettleMs;
+            sample.timeMs = t;
+            sample.value = std::round(height * settled + noise(rng));
+            replayer.onSample(sample);
+        }
+
+        SessionResult result;
+        result.band = bandFor(noiseCm);
+        result.stabilized = first.stabilized();
+        result.timeToStableMs = first.stabilized() ? first.timeMs() - arrivalMs : 0;
+        result.errorCm = first.stabilized() ? std::fabs(first.value() - height) : 0.0f;
+        out.push_back(result);
+    }
+}
+
+void printSummary(const char* mode, const std::vector<SessionResult>& results, int band) {
+    std::vector<unsigned long> times;
+    unsigned long sessions = 0;
+    double errorSum = 0.0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (band >= 0 && results[i].band != band) {
+            continue;
+        }
+        sessions++;
+        if (results[i].stabilized) {
+            times.push_back(results[i].timeToStableMs);
+            errorSum += results[i].errorCm;
+        }
+    }
+    if (sessions == 0) {
+        return;
+    }
+    std::sort(times.begin(), times.end());
+    double mean = 0.0;
+    for (size_t i = 0; i < times.size(); ++i) {
+        mean += static_cast<double>(times[i]);
+    }
+    mean = times.empty() ? 0.0 : mean / static_cast<double>(times.size());
+    unsigned long p50 = times.empty() ? 0 : times[times.size() / 2];
+    unsigned long p95 = times.empty() ? 0 : times[std::min(times.size() - 1, times.size() * 95 / 100)];
+    double never = 100.0 * static_cast<double>(sessions - times.size()) / static_cast<double>(sessions);
+    std::printf("%-9s %-7s %8lu %10.0f %8lu %8lu %9.1f%% %9.2f\n", mode, band >= 0 ? kBandNames[band] : "all",
+                sessions, mean, p50, p95, never, times.empty() ? 0.0 : errorSum / static_cast<double>(times.size()));
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--stations N] [--sessions N] [--seed N] [--min-noise CM] [--max-noise CM]\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned long stations = 1000;
+    int sessions = 20;
+    uint32_t seed = 1;
+    float minNoise = 0.2f;
+    float maxNoise = 2.0f;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--stations") == 0 && i + 1 < argc) {
+            stations = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessions = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--min-noise") == 0 && i + 1 < argc) {
+            minNoise = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--max-noise") == 0 && i + 1 < argc) {
+            maxNoise = static_cast<float>(std::atof(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (stations == 0 || sessions <= 0 || minNoise <= 0.0f || maxNoise < minNoise) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // Noise levels spread log-uniformly over the fleet
+    std::mt19937 fleet(seed);
+    std::uniform_real_distribution<float> logNoise(std::log(minNoise), std::log(maxNoise));
+    std::vector<SessionResult> fixed;
+    std::vector<SessionResult> adaptive;
+    for (unsigned long s = 0; s < stations; ++s) {
+        float noiseCm = std::exp(logNoise(fleet));
+        uint32_t stationSeed = static_cast<uint32_t>(fleet());
+        simulateStation(stationSeed, noiseCm, sessions, false, fixed);
+        simulateStation(stationSeed, noiseCm, sessions, true, adaptive);
+    }
+
+    std::printf("%-9s %-7s %8s %10s %8s %8s %10s %9s\n", "mode", "noise", "sessions", "mean_ms", "p50_ms",
+                "p95_ms", "never", "error_cm");
+    for (int band = -1; band < kBandCount; ++band) {
+        printSummary("fixed", fixed, band);
+        printSummary("adaptive", adaptive, band);
+    }
+    return 0;
+}
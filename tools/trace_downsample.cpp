@@ -0,0 +1,179 @@
+// ============================================
+// trace_downsample - Plot-ready points from an instrument log
+// ============================================
+// Reduces one serial log from height_meter.ino / pulse_oximeter.ino to
+// about one point per bucket per channel with streaming LTTB, keeping
+// every reading at which the debouncer became stable or unstable, and
+// writes the points as JSON lines or CSV while the log is read.
+// --columns parses with the vectorized LineTokenizer instead of
+// TraceParser (same points).
+//
+// Usage: trace_downsample [--range FROM_MS TO_MS --points N | --bucket MS]
+//                         [--columns] [--format json|csv] FILE
+// ============================================
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "line_tokenizer.h"
+#include "record_emitter.h"
+#include "trace_downsampler.h"
+#include "trace_parser.h"
+
+namespace {
+
+/**
+ * One output point; transition points carry the state the debouncer entered
+ */
+struct PlotRecord {
+    unsigned long timeMs;
+    float value;
+    uint8_t channel;
+    bool transition;
+    bool stable;
+};
+
+const FieldSpec kPlotFields[] = {
+    { "time_ms", FIELD_ULONG, offsetof(PlotRecord, timeMs) },
+    { "channel", FIELD_CHANNEL, offsetof(PlotRecord, channel) },
+    { "value", FIELD_FLOAT, offsetof(PlotRecord, value) },
+    { "transition", FIELD_BOOL, offsetof(PlotRecord, transition) },
+    { "stable", FIELD_BOOL, offsetof(PlotRecord, stable) },
+};
+
+const RecordSchema kPlotSchema = { kPlotFields, sizeof(kPlotFields) / sizeof(kPlotFields[0]) };
+
+class StdoutChunkSink : public ChunkSink {
+public:
+    virtual void onChunk(const char* data, size_t length) {
+        std::fwrite(data, 1, length, stdout);
+    }
+};
+
+/**
+ * Write the points decided so far and drop them
+ */
+unsigned long emitPoints(TraceDownsampler& downsampler, RecordEmitter& emitter) {
+    unsigned long written = 0;
+    for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        const std::vector<DownsamplePoint>& points = downsampler.getPoints(channel);
+        for (size_t i = 0; i < points.size(); ++i) {
+            PlotRecord record;
+            record.timeMs = points[i].timeMs;
+            record.value = points[i].value;
+            record.channel = channel;
+            record.transition = points[i].kind != DOWNSAMPLE_POINT_SAMPLE;
+            record.stable = points[i].kind == DOWNSAMPLE_POINT_STABLE;
+            emitter.emit(kPlotSchema, &record);
+        }
+        written += points.size();
+    }
+    downsampler.clearPoints();
+    return written;
+}
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--range FROM_MS TO_MS --points N | --bucket MS]\n"
+                         "          [--columns] [--format json|csv] FILE\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    DownsampleConfig config;
+    unsigned long fromMs = 0;
+    unsigned long toMs = 0;
+    size_t points = 0;
+    bool useColumns = false;
+    const char* format = "json";
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--range") == 0 && i + 2 < argc) {
+            fromMs = std::strtoul(argv[++i], NULL, 10);
+            toMs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--points") == 0 && i + 1 < argc) {
+            points = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--bucket") == 0 && i + 1 < argc) {
+            config.bucketMs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--columns") == 0) {
+            useColumns = true;
+        } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (argv[i][0] == '-' || path != NULL) {
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL || config.bucketMs == 0 || (points != 0) != (toMs > fromMs)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (points != 0) {
+        config = DownsampleConfig::forRange(fromMs, toMs, points);
+    }
+
+    static char outputBuffer[64 * 1024];
+    StdoutChunkSink stdoutSink;
+    JsonEmitter jsonEmitter(outputBuffer, sizeof(outputBuffer), &stdoutSink);
+    CsvEmitter csvEmitter(outputBuffer, sizeof(outputBuffer), &stdoutSink);
+    RecordEmitter* emitter = &jsonEmitter;
+    if (std::strcmp(format, "csv") == 0) {
+        emitter = &csvEmitter;
+        csvEmitter.emitHeader(kPlotSchema);
+    } else if (std::strcmp(format, "json") != 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    FILE* file = std::fopen(path, "rb");
+    if (file == NULL) {
+        std::perror(path);
+        return 1;
+    }
+
+    TraceDownsampler downsampler(config);
+    TraceParser parser(&downsampler, 0);
+    LineTokenizer tokenizer;
+    LogColumns columns;
+    static char block[64 * 1024];
+    unsigned long written = 0;
+    size_t length;
+    while ((length = std::fread(block, 1, sizeof(block), file)) > 0) {
+        if (useColumns) {
+            tokenizer.feed(block, length, columns);
+            downsampler.addColumns(columns);
+            columns.clear();
+        } else {
+            parser.feed(block, length);
+        }
+        written += emitPoints(downsampler, *emitter);
+    }
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+    if (useColumns) {
+        tokenizer.finish(columns);
+        downsampler.addColumns(columns);
+    } else {
+        parser.finish();
+    }
+    downsampler.finish();
+    written += emitPoints(downsampler, *emitter);
+    emitter->flush();
+    std::fflush(stdout);
+
+    unsigned long samples = 0;
+    for (uint8_t channel = 0; channel < SAMPLE_CHANNEL_COUNT; ++channel) {
+        samples += downsampler.getSeries(channel).getPointsIn();
+    }
+    std::fprintf(stderr, "Samples: %lu -> %lu points (%lu ms buckets)\n", samples, written, config.bucketMs);
+    if (!ok) {
+        std::fprintf(stderr, "Failed to read %s\n", path);
+        return 1;
+    }
+    return 0;
+}
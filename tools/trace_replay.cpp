@@ -0,0 +1,250 @@
+// ============================================
+// trace_replay - Reprocess archived instrument logs
+// ============================================
+// Streams serial logs from height_meter.ino / pulse_oximeter.ino through
+// the debouncers and reports throughput and stability transitions.
+// --index writes the stable-interval index of the replay (device id =
+// position of the log on the command line) for stable_query.
+// --health N scores every log's sensor health and prints the N most
+// severe alerts. --adaptive-tolerance tunes each log's tolerances to its
+// measured noise floor. --cache FILE keeps per-block results between runs,
+// so a re-run skips files whose size and mtime are unchanged and only
+// replays the blocks whose lines or debouncer configuration changed (not
+// with --health or --adaptive-tolerance).
+//
+// Usage: trace_replay [--sync] [--block-size BYTES] [--queue-depth N]
+//                     [--transitions] [--format text|json|csv]
+//                     [--index FILE] [--health N] [--adaptive-tolerance]
+//                     [--cache FILE] FILE...
+// ============================================
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "record_emitter.h"
+#include "replay_cache.h"
+#include "stable_interval_index.h"
+#include "station_health.h"
+#include "trace_reader.h"
+#include "trace_replayer.h"
+
+namespace {
+
+const char* kChannelNames[SAMPLE_CHANNEL_COUNT] = { "height", "bpm", "spo2" };
+
+class TransitionPrinter : public StabilityTransitionSink {
+public:
+    explicit TransitionPrinter(const std::vector<std::string>& paths)
+        : paths_(paths)
+    {
+    }
+
+    virtual void onTransition(const StabilityTransition& transition) {
+        std::printf("%s\t%lu\t%s\t%s\t%.2f\n", paths_[transition.deviceId].c_str(), transition.timeMs,
+                    kChannelNames[transition.channel], transition.stable ? "STABLE" : "UNSTABLE",
+                    transition.value);
+    }
+
+private:
+    const std::vector<std::string>& paths_;
+};
+
+class StdoutChunkSink : public ChunkSink {
+public:
+    virtual void onChunk(const char* data, size_t length) {
+        std::fwrite(data, 1, length, stdout);
+    }
+};
+
+class TransitionExporter : public StabilityTransitionSink {
+public:
+    explicit TransitionExporter(RecordEmitter* emitter) : emitter_(emitter) {}
+
+    virtual void onTransition(const StabilityTransition& transition) {
+        emitter_->emitTransition(transition);
+    }
+
+private:
+    RecordEmitter* emitter_;
+};
+
+class TransitionTee : public StabilityTransitionSink {
+public:
+    TransitionTee(StabilityTransitionSink* first, StabilityTransitionSink* second)
+        : first_(first)
+        , second_(second)
+    {
+    }
+
+    virtual void onTransition(const StabilityTransition& transition) {
+        first_->onTransition(transition);
+        second_->onTransition(transition);
+    }
+
+    virtual void onStableUpdate(const StabilityTransition& transition) {
+        first_->onStableUpdate(transition);
+        second_->onStableUpdate(transition);
+    }
+
+private:
+    StabilityTransitionSink* first_;
+    StabilityTransitionSink* second_;
+};
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--sync] [--block-size BYTES] [--queue-depth N] [--transitions]\n"
+                         "          [--format text|json|csv] [--index FILE] [--health N] [--adaptive-tolerance]\n"
+                         "          [--cache FILE] FILE...\n",
+                 program);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TraceReaderOptions options;
+    bool printTransitions = false;
+    const char* format = "text";
+    const char* indexPath = NULL;
+    long healthAlerts = -1;
+    bool adaptiveTolerance = false;
+    const char* cachePath = NULL;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--sync") == 0) {
+            options.useIoUring = false;
+        } else if (std::strcmp(argv[i], "--block-size") == 0 && i + 1 < argc) {
+            options.blockSize = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--queue-depth") == 0 && i + 1 < argc) {
+            options.queueDepth = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--transitions") == 0) {
+            printTransitions = true;
+        } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (std::strcmp(argv[i], "--index") == 0 && i + 1 < argc) {
+            indexPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--health") == 0 && i + 1 < argc) {
+            healthAlerts = std::strtol(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--adaptive-tolerance") == 0) {
+            adaptiveTolerance = true;
+        } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cachePath = argv[++i];
+        } else if (argv[i][0] == '-') {
+            printUsage(argv[0]);
+            return 2;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty() || (cachePath != NULL && (healthAlerts >= 0 || adaptiveTolerance))) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // Transitions go out as text lines, or through a streaming emitter
+    static char outputBuffer[64 * 1024];
+    StdoutChunkSink stdoutSink;
+    JsonEmitter jsonEmitter(outputBuffer, sizeof(outputBuffer), &stdoutSink);
+    CsvEmitter csvEmitter(outputBuffer, sizeof(outputBuffer), &stdoutSink);
+    RecordEmitter* emitter = NULL;
+    if (std::strcmp(format, "json") == 0) {
+        emitter = &jsonEmitter;
+    } else if (std::strcmp(format, "csv") == 0) {
+        emitter = &csvEmitter;
+        csvEmitter.emitHeader(kTransitionRecordSchema);
+    } else if (std::strcmp(format, "text") != 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    TransitionPrinter printer(paths);
+    TransitionExporter exporter(emitter);
+    StabilityTransitionSink* transitionSink = NULL;
+    if (printTransitions) {
+        transitionSink = emitter != NULL ? static_cast<StabilityTransitionSink*>(&exporter) : &printer;
+    }
+    StableIntervalIndex index;
+    TransitionTee tee(transitionSink, &index);
+    if (indexPath != NULL) {
+        transitionSink = transitionSink != NULL ? static_cast<StabilityTransitionSink*>(&tee) : &index;
+    }
+    TraceFileReplay replay(transitionSink);
+    StationHealthModel health((StationHealthConfig()), paths.size());
+    if (healthAlerts >= 0) {
+        replay.setEventSink(&health);
+    }
+    replay.setAdaptiveTolerance(adaptiveTolerance);
+    ReplayCache cache;
+    CachedTraceFileReplay cachedReplay(transitionSink, &cache);
+    if (cachePath != NULL && !cache.load(cachePath)) {
+        std::fprintf(stderr, "Cache: starting %s\n", cachePath);
+    }
+    AsyncTraceReader reader(options);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = cachePath != NULL ? cachedReplay.run(reader, paths) : reader.run(paths, replay);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (emitter != NULL) {
+        emitter->flush();
+    }
+    std::fflush(stdout);
+
+    if (indexPath != NULL) {
+        index.finish();
+        if (!index.save(indexPath)) {
+            std::fprintf(stderr, "Failed to write index %s\n", indexPath);
+            ok = false;
+        } else {
+            std::fprintf(stderr, "Index: %lu intervals on %lu channels -> %s\n",
+                         static_cast<unsigned long>(index.getIntervalCount()),
+                         static_cast<unsigned long>(index.getChannelCount()), indexPath);
+        }
+    }
+
+    if (healthAlerts >= 0) {
+        std::vector<StationHealthSnapshot> alerts;
+        health.getAlerts(alerts, static_cast<size_t>(healthAlerts));
+        std::fprintf(stderr, "Health: %lu of %lu logs alerting\n", static_cast<unsigned long>(health.getAlertCount()),
+                     static_cast<unsigned long>(health.getStationCount()));
+        for (size_t i = 0; i < alerts.size(); ++i) {
+            const StationHealthSnapshot& alert = alerts[i];
+            std::printf("%s\t%s\t%s\tseverity=%.2f\tresets=%.3f\tdropouts=%.3f\ttts=%.0fms\tdrift=%+.2f\n",
+                        paths[alert.stationId].c_str(), kChannelNames[alert.channel],
+                        stationHealthReasonName(alert.reason), alert.severity, alert.resetRate, alert.dropoutRatio,
+                        alert.timeToStableMs, alert.timeToStableDrift);
+        }
+    }
+
+    if (cachePath != NULL) {
+        std::fprintf(stderr, "Cache: %lu files unchanged, %lu blocks reused (%.1f MiB), %lu replayed, "
+                     "%lu entries -> %s\n",
+                     cachedReplay.getFilesUnchanged(), cachedReplay.getBlocksReused(),
+                     static_cast<double>(cachedReplay.getBytesReused()) / (1024.0 * 1024.0),
+                     cachedReplay.getBlocksReplayed(), static_cast<unsigned long>(cache.getEntryCount()), cachePath);
+        if (cache.isModified() && !cache.save(cachePath)) {
+            std::fprintf(stderr, "Failed to write cache %s\n", cachePath);
+            ok = false;
+        }
+    }
+
+    double megabytes = static_cast<double>(reader.getBytesRead()) / (1024.0 * 1024.0);
+    std::fprintf(stderr, "Backend: %s%s\n", reader.isUsingIoUring() ? "io_uring" : "pread",
+                 reader.hasRegisteredBuffers() ? " (registered buffers)" : "");
+    bool cached = cachePath != NULL;
+    unsigned long filesCompleted = cached ? cachedReplay.getFilesCompleted() : replay.getFilesCompleted();
+    std::fprintf(stderr, "Files: %lu read, %lu failed\n", filesCompleted - reader.getFilesFailed(),
+                 static_cast<unsigned long>(reader.getFilesFailed()));
+    std::fprintf(stderr, "Lines: %lu parsed, %lu skipped\n",
+                 cached ? cachedReplay.getLinesParsed() : replay.getLinesParsed(),
+                 cached ? cachedReplay.getLinesSkipped() : replay.getLinesSkipped());
+    std::fprintf(stderr, "Samples: %lu, transitions: %lu\n",
+                 cached ? cachedReplay.getSamplesProcessed() : replay.getSamplesProcessed(),
+                 cached ? cachedReplay.getTransitionCount() : replay.getTransitionCount());
+    std::fprintf(stderr, "Read %.1f MiB in %.3f s (%.1f MiB/s)\n", megabytes, seconds,
+                 seconds > 0.0 ? megabytes / seconds : 0.0);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+// ============================================
+// weight_scale_host - Run weight_scale.ino against the host HAL
+// ============================================
+// Builds the sketch with host versions of Wire and the LCD library, wires
+// a simulated HX711 to its DOUT/PD_SCK pins and runs it on the virtual
+// clock, charging every GPIO access and I2C transfer. Reports the budgets
+// the sketch has to keep on an Uno:
+//   loop time    every loop() must return well within one HX711
+//                conversion (12.5 ms at 80 SPS), or conversions are lost
+//   conversions  none missed, no PD_SCK power-down
+//   RAM          the sketch's own globals (host sizeof, an upper bound:
+//                long and pointers are wider here than on the AVR)
+// and the weight the debouncer settled on. Flash cannot be measured on the
+// host; that takes avr-size on a real build.
+//
+// Usage: weight_scale_host [--duration-ms MS] [--load FROM_MS:KG]...
+//                          [--noise COUNTS] [--gpio-us US] [--loop-us US]
+//                          [--quiet] [--check]
+// ============================================
+
+#include <cstdlib>
+#include "Arduino.h"
+#include "Wire.h"
+#include "host_devices.h"
+
+#ifndef APPTECH_WEIGHT_SKETCH
+#define APPTECH_WEIGHT_SKETCH "../instruments/weight_scale/weight_scale.ino"
+#endif
+
+#include APPTECH_WEIGHT_SKETCH
+
+namespace {
+
+const unsigned long kConversionUs = 1000000UL / 80;     // HX711 at 80 SPS
+const unsigned long kLoopBudgetUs = kConversionUs / 2;  // leave room for the rest of the firmware
+const size_t kRamBudgetBytes = 256;                     // of the Nano's 2 KB
+
+void printUsage(const char* program) {
+    std::fprintf(stderr, "Usage: %s [--duration-ms MS] [--load FROM_MS:KG]... [--noise COUNTS]\n"
+                         "          [--gpio-us US] [--loop-us US] [--quiet] [--check]\n",
+                 program);
+}
+
+size_t sketchRamBytes() {
+    return sizeof(scale) + sizeof(decimator) + sizeof(debouncer) + sizeof(tareSum) + sizeof(tareCount) +
+           sizeof(tareOffset) + sizeof(lcdLine) + sizeof(lcdPos);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned long durationMs = 10000;
+    unsigned long loopUs = 20;
+    unsigned int gpioUs = 4;
+    float noiseCounts = 150.0f;
+    bool quiet = false;
+    bool check = false;
+    SimulatedHx711 hx711(hostClock(), HX711_DOUT_PIN, HX711_SCK_PIN, 1);
+    float lastLoadKg = 0.0f;
+    bool scripted = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--duration-ms") == 0 && i + 1 < argc) {
+            durationMs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            unsigned long fromMs = 0;
+            float kg = 0.0f;
+            if (std::sscanf(argv[++i], "%lu:%f", &fromMs, &kg) != 2) {
+                printUsage(argv[0]);
+                return 2;
+            }
+            hx711.setLoad(fromMs, kg * 1000.0f);
+            lastLoadKg = kg;
+            scripted = true;
+        } else if (std::strcmp(argv[i], "--noise") == 0 && i + 1 < argc) {
+            noiseCounts = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--gpio-us") == 0 && i + 1 < argc) {
+            gpioUs = static_cast<unsigned int>(std::strtoul(argv[++i], NULL, 10));
+        } else if (std::strcmp(argv[i], "--loop-us") == 0 && i + 1 < argc) {
+            loopUs = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (std::strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (noiseCounts < 0.0f) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (!scripted) {
+        hx711.setLoad(0, 0.0f);          // empty platform while taring
+        hx711.setLoad(3000, 72400.0f);   // then a patient steps on
+        lastLoadKg = 72.4f;
+    }
+    hx711.setOffset(-52000);             // load cell zero is never at 0 counts
+    hx711.setNoise(noiseCounts);
+
+    I2cAckDevice display;
+    hostI2cBus().attach(LCD_I2C_ADDRESS, &display);
+    hostAttachPin(HX711_DOUT_PIN, &hx711);
+    hostAttachPin(HX711_SCK_PIN, &hx711);
+    hostSetGpioCostUs(gpioUs);
+    if (quiet) {
+        Serial.setOutput(NULL);
+    }
+
+    setup();
+    unsigned long loops = 0;
+    unsigned long long totalLoopUs = 0;
+    unsigned long long maxLoopUs = 0;
+    while (millis() < durationMs) {
+        unsigned long long start = hostClock().nowUs();
+        loop();
+        unsigned long long elapsed = hostClock().nowUs() - start;
+        totalLoopUs += elapsed;
+        if (elapsed > maxLoopUs) {
+            maxLoopUs = elapsed;
+        }
+        loops++;
+        hostClock().advanceUs(loopUs);   // the rest of the loop's CPU time
+    }
+    std::fflush(stdout);
+
+    double meanLoopUs = loops == 0 ? 0.0 : static_cast<double>(totalLoopUs) / loops;
+    size_t ramBytes = sketchRamBytes();
+    long expectedG = static_cast<long>(lastLoadKg * 1000.0f + (lastLoadKg >= 0.0f ? 0.5f : -0.5f));
+    bool settled = debouncer.isStable();
+    long stableG = debouncer.getStableReading();
+
+    std::fprintf(stderr, "Loops: %lu in %lu ms\n", loops, durationMs);
+    std::fprintf(stderr, "Loop time: mean %.1f us, max %llu us (budget %lu us)\n", meanLoopUs, maxLoopUs,
+                 kLoopBudgetUs);
+    std::fprintf(stderr, "Conversions: %lu produced, %lu read, %lu missed, %lu power-downs\n",
+                 hx711.getConversions(), hx711.getReads(), hx711.getMissed(), hx711.getPowerDowns());
+    std::fprintf(stderr, "RAM: %lu bytes of sketch state (budget %lu bytes)\n", static_cast<unsigned long>(ramBytes),
+                 static_cast<unsigned long>(kRamBudgetBytes));
+    if (settled) {
+        std::fprintf(stderr, "Stable: %ld g (load %ld g)\n", stableG, expectedG);
+    } else {
+        std::fprintf(stderr, "Stable: never\n");
+    }
+
+    if (!check) {
+        return 0;
+    }
+    bool ok = true;
+    if (maxLoopUs > kLoopBudgetUs) {
+        std::fprintf(stderr, "FAIL: loop time over budget\n");
+        ok = false;
+    }
+    if (hx711.getMissed() != 0 || hx711.getPowerDowns() != 0) {
+        std::fprintf(stderr, "FAIL: conversions lost\n");
+        ok = false;
+    }
+    if (ramBytes > kRamBudgetBytes) {
+        std::fprintf(stderr, "FAIL: RAM over budget\n");
+        ok = false;
+    }
+    if (expectedG >= WEIGHT_MIN_VALID_G &&
+        (!settled || stableG < expectedG - WEIGHT_TOLERANCE_G || stableG > expectedG + WEIGHT_TOLERANCE_G)) {
+        std::fprintf(stderr, "FAIL: weight did not settle on the load\n");
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}